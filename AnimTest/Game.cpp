@@ -250,12 +250,12 @@ void Game::Render()
 
     m_tank->boneMatrices[barricadeBone] = XMMatrixTranslation(0.f, cosf(time) * 2.f, 0.f);
 
-    auto bones = ModelBone::MakeArray(nbones);
-    m_tank->CopyAbsoluteBoneTransformsTo(nbones, bones.get());
+    auto bones = m_frameTransforms.Allocate(nbones);
+    m_tank->CopyAbsoluteBoneTransformsTo(nbones, bones);
         // For SDKMESH rigid-body, the matrix data is the local position to use.
 
     Model::UpdateEffectMatrices(m_tankNormal, local, m_view, m_projection);
-    m_tank->Draw(commandList, nbones, bones.get(), local, m_tankNormal.cbegin());
+    m_tank->Draw(commandList, nbones, bones, local, m_tankNormal.cbegin());
 
     // Teapot (direct-mapped bones)
     for (auto it : m_teapotNormal)
@@ -269,12 +269,11 @@ void Game::Render()
     m_teapot->Draw(commandList, m_teapotNormal.cbegin());
 
     nbones = static_cast<uint32_t>(m_teapot->bones.size());
-    bones = ModelBone::MakeArray(nbones);
-    m_teapotAnim.Apply(*m_teapot, m_teapot->bones.size(), bones.get());
+    bones = m_teapotAnim.Apply(*m_teapot, m_frameTransforms);
 
     local = XMMatrixMultiply(XMMatrixScaling(0.01f, 0.01f, 0.01f), XMMatrixTranslation(-2.f, row1, 0.f));
     Model::UpdateEffectMatrices(m_teapotNormal, local, m_view, m_projection);
-    m_teapot->DrawSkinned(commandList, nbones, bones.get(), local, m_teapotNormal.cbegin());
+    m_teapot->DrawSkinned(commandList, nbones, bones, local, m_teapotNormal.cbegin());
 
     // Draw SDKMESH models (bone influences)
     for(auto it : m_soldierNormal)
@@ -308,15 +307,14 @@ void Game::Render()
     local = XMMatrixMultiply(world, local);
 
     nbones = static_cast<uint32_t>(m_soldier->bones.size());
-    bones = ModelBone::MakeArray(nbones);
-    m_soldierAnim.Apply(*m_soldier, m_soldier->bones.size(), bones.get());
+    bones = m_soldierAnim.Apply(*m_soldier, m_frameTransforms);
 
-    m_soldier->DrawSkinned(commandList, nbones, bones.get(), local, m_soldierNormal.cbegin());
+    m_soldier->DrawSkinned(commandList, nbones, bones, local, m_soldierNormal.cbegin());
 
     local = XMMatrixMultiply(XMMatrixScaling(2.f, 2.f, 2.f), XMMatrixTranslation(4.f, row1, 0.f));
     local = XMMatrixMultiply(XMMatrixRotationY(XM_PI), local);
     local = XMMatrixMultiply(world, local);
-    m_soldier->DrawSkinned(commandList, nbones, bones.get(), local, m_soldierDiffuse.cbegin());
+    m_soldier->DrawSkinned(commandList, nbones, bones, local, m_soldierDiffuse.cbegin());
 
     PIXEndEvent(commandList);
 
@@ -328,6 +326,17 @@ void Game::Render()
     // Sample stats to update peak values
     std::ignore = m_graphicsMemory->GetStatistics();
 
+    // Bone palettes are only used by this frame's command list, which has been recorded.
+    m_frameTransforms.Reset();
+    if (m_frameTransforms.GetHeapAllocationCount() > 0)
+    {
+        char buff[128] = {};
+        sprintf_s(buff, "ERROR: Bone palette allocator hit the heap %llu times in steady state\n",
+            m_frameTransforms.GetHeapAllocationCount());
+        OutputDebugStringA(buff);
+        m_frameTransforms.ResetCounters();
+    }
+
     PIXEndEvent(m_deviceResources->GetCommandQueue());
 }
 
@@ -455,6 +464,10 @@ void Game::CreateDeviceDependentResources()
         OutputDebugStringA("'teapot.cmo' contains animation clips.\n");
     }
 
+    // Size the per-frame bone palette allocator for every model drawn in Render.
+    m_frameTransforms = DX::FrameTransformAllocator(m_tank->bones.size() + m_teapot->bones.size() + m_soldier->bones.size());
+    m_frameTransforms.ResetCounters();
+
     // Load textures & effects
     m_resourceDescriptors = std::make_unique<DescriptorPile>(device, 128, StaticDescriptors::Reserve);
 
@@ -121,6 +121,7 @@ private:
     DirectX::SimpleMath::Matrix                     m_projection;
 
     DirectX::ModelBone::TransformArray              m_bones;
+    DX::FrameTransformAllocator                     m_frameTransforms;
 
     DX::AnimationSDKMESH                            m_soldierAnim;
     DX::AnimationCMO                                m_teapotAnim;
@@ -12,6 +12,9 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
+#include "SpatialAudioBatchX3D.h"
+
 #define GAMMA_CORRECT_RENDERING
 
 // Build for LH vs. RH coords
@@ -27,6 +30,7 @@
 //#define USE_CUSTOM_CURVES
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -221,6 +225,8 @@ void Game::Initialize(
 
     // Set to the proper setup for this sound
     m_emitter.EnableDefaultMultiChannel(m_effect->GetChannelCount());
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -438,6 +444,277 @@ void Game::AudioRender()
 }
 #pragma endregion
 
+#pragma region Unit Tests
+namespace
+{
+    struct SpeakerLayout
+    {
+        const char* name;
+        uint32_t    channelMask;
+    };
+
+    constexpr SpeakerLayout c_speakerLayouts[] =
+    {
+        { "Stereo", SPEAKER_STEREO },
+        { "5.1", SPEAKER_5POINT1 },
+        { "Surround7.1", SPEAKER_7POINT1_SURROUND },
+    };
+
+    constexpr X3DAUDIO_CONE Test_EmitterCone = { X3DAUDIO_PI / 2.0f, X3DAUDIO_PI * 3.0f / 2.0f, 1.0f, 0.5f, 0.0f, 0.3f, 1.0f, 0.6f };
+
+    constexpr X3DAUDIO_DISTANCE_CURVE_POINT Test_Volume_CurvePoints[4] = { { 0.0f, 1.0f }, { 0.2f, 0.9f }, { 0.6f, 0.3f }, { 1.0f, 0.0f } };
+    constexpr X3DAUDIO_DISTANCE_CURVE       Test_Volume_Curve = { (X3DAUDIO_DISTANCE_CURVE_POINT*)&Test_Volume_CurvePoints[0], 4 };
+
+    constexpr X3DAUDIO_DISTANCE_CURVE_POINT Test_Reverb_CurvePoints[3] = { { 0.0f, 0.5f }, { 0.75f, 1.0f }, { 1.0f, 0.0f } };
+    constexpr X3DAUDIO_DISTANCE_CURVE       Test_Reverb_Curve = { (X3DAUDIO_DISTANCE_CURVE_POINT*)&Test_Reverb_CurvePoints[0], 3 };
+
+    struct TestEmitter
+    {
+        XMFLOAT3 position;
+        XMFLOAT3 velocity;
+        XMFLOAT3 front;
+        XMFLOAT3 top;
+    };
+
+    // Random emitters around the listener, with orthonormal orientations as X3DAudio requires.
+    std::vector<TestEmitter> MakeTestEmitters(size_t count, uint32_t seed)
+    {
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> position(-30.f, 30.f);
+        std::uniform_real_distribution<float> velocity(-20.f, 20.f);
+        std::uniform_real_distribution<float> direction(-1.f, 1.f);
+
+        std::vector<TestEmitter> emitters(count);
+        for (auto& it : emitters)
+        {
+            it.position = XMFLOAT3(position(rng), position(rng), position(rng));
+            it.velocity = XMFLOAT3(velocity(rng), velocity(rng), velocity(rng));
+
+            Vector3 front;
+            do
+            {
+                front = Vector3(direction(rng), direction(rng), direction(rng));
+            } while (front.LengthSquared() < 0.01f);
+            front.Normalize();
+
+            Vector3 top = front.Cross((fabsf(front.y) < 0.9f) ? Vector3::UnitY : Vector3::UnitX);
+            top.Normalize();
+            top = top.Cross(front);
+
+            it.front = front;
+            it.top = top;
+        }
+
+        return emitters;
+    }
+
+    // X3DAudioCalculate with the transforms SoundEffectInstance::Apply3D makes.
+    void Calculate3D(const X3DAUDIO_HANDLE handle, X3DAUDIO_LISTENER listener, X3DAUDIO_EMITTER emitter,
+        uint32_t flags, bool rhcoords, X3DAUDIO_DSP_SETTINGS& dsp)
+    {
+        if (rhcoords)
+        {
+            for (auto v : { &listener.OrientFront, &listener.OrientTop, &listener.Position, &listener.Velocity,
+                            &emitter.OrientFront, &emitter.OrientTop, &emitter.Position, &emitter.Velocity })
+            {
+                v->z = -v->z;
+            }
+        }
+
+        X3DAudioCalculate(handle, &listener, &emitter, flags, &dsp);
+    }
+
+    constexpr uint32_t c_calculateFlags = X3DAUDIO_CALCULATE_MATRIX | X3DAUDIO_CALCULATE_DOPPLER
+        | X3DAUDIO_CALCULATE_LPF_DIRECT | X3DAUDIO_CALCULATE_LPF_REVERB | X3DAUDIO_CALCULATE_REVERB;
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+#ifdef LH_COORDS
+    bool rhcoords = false;
+#else
+    bool rhcoords = true;
+#endif
+
+    // The scene's listener and emitter, plus a variant with custom curves and a real emitter cone.
+    X3DAUDIO_LISTENER sceneListener = m_listener;
+    sceneListener.Position = XMFLOAT3(1.f, 2.f, 7.f);
+    sceneListener.Velocity = XMFLOAT3(2.f, 0.f, -1.f);
+
+    X3DAUDIO_LISTENER turnedListener = sceneListener;
+    turnedListener.OrientFront = XMFLOAT3(0.70710678f, 0.f, -0.70710678f);
+
+    X3DAUDIO_EMITTER sceneEmitter = m_emitter;
+    sceneEmitter.ChannelCount = 1;
+    sceneEmitter.InnerRadius = 0.f;
+    sceneEmitter.InnerRadiusAngle = 0.f;
+
+    X3DAUDIO_EMITTER customEmitter = sceneEmitter;
+    customEmitter.pCone = const_cast<X3DAUDIO_CONE*>(&Test_EmitterCone);
+    customEmitter.pVolumeCurve = const_cast<X3DAUDIO_DISTANCE_CURVE*>(&Test_Volume_Curve);
+    customEmitter.pReverbCurve = const_cast<X3DAUDIO_DISTANCE_CURVE*>(&Test_Reverb_Curve);
+    customEmitter.DopplerScaler = 2.f;
+
+    const auto testEmitters = MakeTestEmitters(512, 0x3D);
+
+    DX::SpatialAudioBatch batch;
+
+    for (auto const& layout : c_speakerLayouts)
+    {
+        X3DAUDIO_HANDLE handle = {};
+        DX::ThrowIfFailed(X3DAudioInitialize(layout.channelMask, X3DAUDIO_SPEED_OF_SOUND, handle));
+
+        DX::SpatialPanTable panTable;
+        DX::BuildSpatialPanTable(panTable, handle, layout.channelMask);
+
+        const uint32_t channels = panTable.GetChannelCount();
+
+        // Every emitter must match X3DAudioCalculate, in both handedness.
+        for (bool rh : { true, false })
+        {
+            for (auto listenerCase : { &sceneListener, &turnedListener })
+            {
+                for (auto emitterCase : { &sceneEmitter, &customEmitter })
+                {
+                    auto const& listener = *listenerCase;
+                    auto const& emitter = *emitterCase;
+                    DX::SpatialEmitterArrays emitters;
+                    emitters.Resize(testEmitters.size());
+                    for (size_t j = 0; j < testEmitters.size(); ++j)
+                    {
+                        emitters.Set(j, testEmitters[j].position, testEmitters[j].velocity, testEmitters[j].front);
+                    }
+
+                    DX::SpatialResults results;
+                    batch.Calculate(DX::MakeSpatialListener(listener), DX::MakeSpatialEmitterProfile(emitter),
+                        panTable, emitters, results, rh);
+
+                    float matrix[XAUDIO2_MAX_AUDIO_CHANNELS] = {};
+                    X3DAUDIO_DSP_SETTINGS dsp = {};
+                    dsp.pMatrixCoefficients = matrix;
+                    dsp.SrcChannelCount = 1;
+                    dsp.DstChannelCount = channels;
+
+                    float maxMatrix = 0.f;
+                    float maxOther = 0.f;
+                    for (size_t j = 0; j < testEmitters.size(); ++j)
+                    {
+                        X3DAUDIO_EMITTER reference = emitter;
+                        reference.Position = testEmitters[j].position;
+                        reference.Velocity = testEmitters[j].velocity;
+                        reference.OrientFront = testEmitters[j].front;
+                        reference.OrientTop = testEmitters[j].top;
+
+                        Calculate3D(handle, listener, reference, c_calculateFlags, rh, dsp);
+
+                        const float* gains = results.GetMatrix(j);
+                        for (uint32_t c = 0; c < channels; ++c)
+                        {
+                            maxMatrix = std::max(maxMatrix, fabsf(gains[c] - matrix[c]));
+                        }
+
+                        maxOther = std::max({ maxOther,
+                            fabsf(results.dopplerFactor[j] - dsp.DopplerFactor),
+                            fabsf(results.lpfDirect[j] - dsp.LPFDirectCoefficient),
+                            fabsf(results.lpfReverb[j] - dsp.LPFReverbCoefficient),
+                            fabsf(results.reverbLevel[j] - dsp.ReverbLevel),
+                            fabsf(results.distance[j] - dsp.EmitterToListenerDistance) / std::max(1.f, dsp.EmitterToListenerDistance) });
+                    }
+
+                    char buff[256] = {};
+                    sprintf_s(buff, "SpatialAudioBatch %-11s %s %s %s: max error %g matrix, %g other\n",
+                        layout.name, rh ? "RH" : "LH",
+                        (listenerCase == &turnedListener) ? "turned" : "scene ",
+                        (emitterCase == &customEmitter) ? "custom" : "scene ",
+                        double(maxMatrix), double(maxOther));
+                    OutputDebugStringA(buff);
+
+                    // The pan table interpolates between 1024 azimuths.
+                    if (maxMatrix > 5e-3f || maxOther > 1e-4f)
+                    {
+                        OutputDebugStringA("ERROR: SpatialAudioBatch differs from X3DAudioCalculate\n");
+                        success = false;
+                    }
+                }
+            }
+        }
+
+        // Per-frame cost for many emitters: one X3DAudioCalculate each against the batch.
+        if (g_benchmarks)
+        {
+            constexpr uint32_t c_frames = 20;
+
+            const auto many = MakeTestEmitters(1024, 0x1024);
+
+            DX::SpatialEmitterArrays emitters;
+            emitters.Resize(many.size());
+            for (size_t j = 0; j < many.size(); ++j)
+            {
+                emitters.Set(j, many[j].position, many[j].velocity, many[j].front);
+            }
+
+            const auto listener = DX::MakeSpatialListener(sceneListener);
+            const auto profile = DX::MakeSpatialEmitterProfile(sceneEmitter);
+
+            float matrix[XAUDIO2_MAX_AUDIO_CHANNELS] = {};
+            X3DAUDIO_DSP_SETTINGS dsp = {};
+            dsp.pMatrixCoefficients = matrix;
+            dsp.SrcChannelCount = 1;
+            dsp.DstChannelCount = channels;
+
+            DX::CpuTimer timer;
+
+            timer.Start();
+            float checksum = 0.f;
+            for (uint32_t frame = 0; frame < c_frames; ++frame)
+            {
+                for (auto const& it : many)
+                {
+                    X3DAUDIO_EMITTER emitter = sceneEmitter;
+                    emitter.Position = it.position;
+                    emitter.Velocity = it.velocity;
+                    emitter.OrientFront = it.front;
+                    emitter.OrientTop = it.top;
+
+                    Calculate3D(handle, sceneListener, emitter, c_calculateFlags, rhcoords, dsp);
+                    checksum += matrix[0];
+                }
+            }
+            timer.Stop();
+            const double scalar = timer.GetElapsedMilliseconds() / c_frames;
+
+            DX::SpatialResults results;
+
+            timer.Reset();
+            timer.Start();
+            for (uint32_t frame = 0; frame < c_frames; ++frame)
+            {
+                batch.Calculate(listener, profile, panTable, emitters, results, rhcoords);
+                checksum += results.matrix[0];
+            }
+            timer.Stop();
+            const double batched = timer.GetElapsedMilliseconds() / c_frames;
+
+            char buff[256] = {};
+            sprintf_s(buff, "SpatialAudioBatch %-11s %zu emitters: %.3f ms X3DAudioCalculate, %.3f ms batched (%.1fx) [%g]\n",
+                layout.name, many.size(), scalar, batched, (batched > 0.0) ? scalar / batched : 0.0, double(checksum));
+            OutputDebugStringA(buff);
+        }
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
+#pragma endregion
+
 #pragma region Message Handlers
 // Message handlers
 void Game::OnActivated()
@@ -102,10 +102,12 @@
 #include <exception>
 #include <iterator>
 #include <memory>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <system_error>
 #include <tuple>
+#include <vector>
 
 #include "Audio.h"
 #include "CommonStates.h"
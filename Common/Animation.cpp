@@ -250,6 +250,16 @@ void AnimationSDKMESH::Apply(
     }
 }
 
+XMMATRIX* AnimationSDKMESH::Apply(
+    const DirectX::Model& model,
+    FrameTransformAllocator& allocator) const
+{
+    const size_t nbones = model.bones.size();
+    auto boneTransforms = allocator.Allocate(nbones);
+    Apply(model, nbones, boneTransforms);
+    return boneTransforms;
+}
+
 
 //--------------------------------------------------------------------------------------
 // Visual Studio Starter Kit CMO animation
@@ -448,3 +458,13 @@ void AnimationCMO::Apply(
         boneTransforms[j] = XMMatrixMultiply(model.invBindPoseMatrices[j], boneTransforms[j]);
     }
 }
+
+XMMATRIX* AnimationCMO::Apply(
+    const Model& model,
+    FrameTransformAllocator& allocator) const
+{
+    const size_t nbones = model.bones.size();
+    auto boneTransforms = allocator.Allocate(nbones);
+    Apply(model, nbones, boneTransforms);
+    return boneTransforms;
+}
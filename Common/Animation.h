@@ -11,6 +11,8 @@
 #include <DirectXMath.h>
 #include <Model.h>
 
+#include "FrameTransformAllocator.h"
+
 #include <memory>
 #include <utility>
 #include <vector>
@@ -50,6 +52,11 @@ namespace DX
             size_t nbones,
             _Out_writes_(nbones) DirectX::XMMATRIX* boneTransforms) const;
 
+        // Applies into a bone palette taken from the per-frame allocator (valid until its next Reset).
+        DirectX::XMMATRIX* Apply(
+            const DirectX::Model& model,
+            FrameTransformAllocator& allocator) const;
+
     private:
         double                              m_animTime;
         std::unique_ptr<uint8_t[]>          m_animData;
@@ -89,6 +96,11 @@ namespace DX
             size_t nbones,
             _Out_writes_(nbones) DirectX::XMMATRIX* boneTransforms) const;
 
+        // Applies into a bone palette taken from the per-frame allocator (valid until its next Reset).
+        DirectX::XMMATRIX* Apply(
+            const DirectX::Model& model,
+            FrameTransformAllocator& allocator) const;
+
     private:
         using Key = std::pair<uint32_t, float>;
 
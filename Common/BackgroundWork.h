@@ -0,0 +1,157 @@
+//--------------------------------------------------------------------------------------
+// File: BackgroundWork.h
+//
+// Worker threads and key hashing shared by the CPU-side caches
+//
+// PipelineStateCache and TessellationCache both key their entries with
+// PipelineStateHasher and run misses on a BackgroundWorkQueue. Neither needs a
+// device, so this header uses only the standard library.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // FNV-1a 64-bit. Callers feed fields individually so struct padding never reaches the hash.
+    class PipelineStateHasher
+    {
+    public:
+        PipelineStateHasher() noexcept : m_hash(14695981039346656037ull) {}
+
+        void AddBytes(const void* data, size_t size) noexcept
+        {
+            auto bytes = static_cast<const uint8_t*>(data);
+            for (size_t j = 0; j < size; ++j)
+            {
+                m_hash ^= bytes[j];
+                m_hash *= 1099511628211ull;
+            }
+        }
+
+        template<typename T>
+        void Add(const T& value) noexcept
+        {
+            static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "Add fields one at a time");
+            AddBytes(&value, sizeof(T));
+        }
+
+        // Hashes the string contents (and terminator) rather than the pointer.
+        void AddString(const char* str) noexcept
+        {
+            if (str)
+            {
+                while (*str)
+                {
+                    Add(*str++);
+                }
+            }
+            Add('\0');
+        }
+
+        uint64_t Get() const noexcept { return m_hash; }
+
+    private:
+        uint64_t m_hash;
+    };
+
+    // Fixed set of worker threads draining a FIFO of tasks, so a burst of requests queues up
+    // instead of starting one OS thread each. Destruction finishes the queued work first.
+    class BackgroundWorkQueue
+    {
+    public:
+        explicit BackgroundWorkQueue(size_t workerCount = 0) noexcept(false) :
+            m_exit(false)
+        {
+            if (!workerCount)
+            {
+                const unsigned int cores = std::thread::hardware_concurrency();
+                workerCount = (cores > 1) ? (cores - 1) : 1;
+            }
+
+            m_workers.reserve(workerCount);
+            for (size_t j = 0; j < workerCount; ++j)
+            {
+                m_workers.emplace_back(&BackgroundWorkQueue::WorkerLoop, this);
+            }
+        }
+
+        BackgroundWorkQueue(BackgroundWorkQueue const&) = delete;
+        BackgroundWorkQueue& operator= (BackgroundWorkQueue const&) = delete;
+
+        ~BackgroundWorkQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_exit = true;
+            }
+            m_wake.notify_all();
+
+            for (auto& worker : m_workers)
+            {
+                worker.join();
+            }
+        }
+
+        // Queues 'func'; its result (or exception) is delivered through the returned future.
+        template<typename TFunc>
+        auto Submit(TFunc&& func) -> std::future<decltype(func())>
+        {
+            using Result = decltype(func());
+
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<TFunc>(func));
+            auto result = task->get_future();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.emplace_back([task]() { (*task)(); });
+            }
+            m_wake.notify_one();
+
+            return result;
+        }
+
+        size_t GetWorkerCount() const noexcept { return m_workers.size(); }
+
+    private:
+        void WorkerLoop()
+        {
+            for (;;)
+            {
+                std::function<void()> task;
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [this]() { return m_exit || !m_tasks.empty(); });
+
+                    if (m_tasks.empty())
+                        return;
+
+                    task = std::move(m_tasks.front());
+                    m_tasks.pop_front();
+                }
+
+                task();
+            }
+        }
+
+        std::mutex                          m_mutex;
+        std::condition_variable             m_wake;
+        std::deque<std::function<void()>>   m_tasks;
+        std::vector<std::thread>            m_workers;
+        bool                                m_exit;
+    };
+}
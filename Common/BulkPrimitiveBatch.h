@@ -0,0 +1,262 @@
+//--------------------------------------------------------------------------------------
+// File: BulkPrimitiveBatch.h
+//
+// DirectX Tool Kit PrimitiveBatch with bulk vertex/index submission
+//
+// PrimitiveBatch::Draw rejects more vertices than the batch holds, and DrawLine /
+// DrawTriangle pay one mapped-memory copy per primitive. The bulk calls here take
+// whole arrays, split them on primitive boundaries at the batch limits, and copy each
+// piece straight into the batch's upload memory. Reserve/Generate hand out that
+// memory so callers can build geometry in place with no intermediate array.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <PrimitiveBatch.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+
+namespace DX
+{
+    // How a topology may be cut into independent pieces: each piece starts on a multiple of
+    // 'stride' and repeats the previous piece's last 'overlap' vertices. A zero stride means
+    // the topology cannot be split.
+    struct PrimitiveSplit
+    {
+        size_t stride;
+        size_t overlap;
+    };
+
+    inline PrimitiveSplit GetPrimitiveSplit(D3D_PRIMITIVE_TOPOLOGY topology) noexcept
+    {
+        switch (topology)
+        {
+        case D3D_PRIMITIVE_TOPOLOGY_POINTLIST:      return { 1, 0 };
+        case D3D_PRIMITIVE_TOPOLOGY_LINELIST:       return { 2, 0 };
+        case D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST:   return { 3, 0 };
+        case D3D_PRIMITIVE_TOPOLOGY_LINESTRIP:      return { 1, 1 };
+        case D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP:  return { 2, 2 };     // even starts keep the winding
+        default:                                    return { 0, 0 };
+        }
+    }
+
+    // Calls func(first, count) for each piece of a 'vertexCount' draw that fits in 'maxVertices'.
+    template<typename TFunc>
+    void ForEachVertexChunk(D3D_PRIMITIVE_TOPOLOGY topology, size_t vertexCount, size_t maxVertices, TFunc&& func)
+    {
+        if (vertexCount <= maxVertices)
+        {
+            if (vertexCount > 0)
+            {
+                func(size_t(0), vertexCount);
+            }
+            return;
+        }
+
+        const PrimitiveSplit split = GetPrimitiveSplit(topology);
+        if (!split.stride || maxVertices < split.stride + split.overlap)
+            throw std::invalid_argument("Topology cannot be split to fit the batch");
+
+        const size_t step = ((maxVertices - split.overlap) / split.stride) * split.stride;
+        for (size_t first = 0; first + split.overlap < vertexCount; first += step)
+        {
+            func(first, std::min(vertexCount - first, step + split.overlap));
+        }
+    }
+
+    // Cuts an indexed point, line, or triangle list into pieces with at most 'maxIndices' indices
+    // and 'maxVertices' distinct vertices each, rebasing the indices of each piece onto its own
+    // compact vertex range.
+    class IndexedPrimitiveSplitter
+    {
+    public:
+        IndexedPrimitiveSplitter() noexcept : m_generation(0) {}
+
+        // Calls emit(indices, indexCount, vertexMap, vertexCount) per piece, where 'indices' are
+        // 16-bit offsets into 'vertexMap', which holds the source vertex numbers.
+        template<typename TIndex, typename TFunc>
+        void Split(D3D_PRIMITIVE_TOPOLOGY topology,
+            _In_reads_(indexCount) const TIndex* indices, size_t indexCount, size_t vertexCount,
+            size_t maxIndices, size_t maxVertices, TFunc&& emit)
+        {
+            static_assert(std::is_integral<TIndex>::value && std::is_unsigned<TIndex>::value, "Indices must be unsigned");
+
+            const PrimitiveSplit split = GetPrimitiveSplit(topology);
+            maxVertices = std::min<size_t>(maxVertices, UINT16_MAX + 1);
+            if (!split.stride || split.overlap > 0 || maxIndices < split.stride || maxVertices < split.stride)
+                throw std::invalid_argument("Topology cannot be split to fit the batch");
+
+            maxIndices -= maxIndices % split.stride;
+
+            if (m_stamp.size() < vertexCount)
+            {
+                m_stamp.resize(vertexCount, m_generation);
+                m_remap.resize(vertexCount);
+            }
+            NextPiece();
+
+            for (size_t j = 0; j < indexCount; j += split.stride)
+            {
+                const size_t count = std::min(split.stride, indexCount - j);
+                const TIndex* primitive = indices + j;
+
+                size_t added = 0;
+                for (size_t k = 0; k < count; ++k)
+                {
+                    const size_t v = primitive[k];
+                    if (v >= vertexCount)
+                        throw std::out_of_range("Index references a vertex past the end of the array");
+
+                    if (m_stamp[v] != m_generation && std::find(primitive, primitive + k, primitive[k]) == primitive + k)
+                        ++added;
+                }
+
+                if (m_indices.size() + count > maxIndices || m_vertices.size() + added > maxVertices)
+                {
+                    emit(m_indices.data(), m_indices.size(), m_vertices.data(), m_vertices.size());
+                    NextPiece();
+                }
+
+                for (size_t k = 0; k < count; ++k)
+                {
+                    const size_t v = primitive[k];
+                    if (m_stamp[v] != m_generation)
+                    {
+                        m_stamp[v] = m_generation;
+                        m_remap[v] = static_cast<uint16_t>(m_vertices.size());
+                        m_vertices.push_back(static_cast<uint32_t>(v));
+                    }
+                    m_indices.push_back(m_remap[v]);
+                }
+            }
+
+            if (!m_indices.empty())
+            {
+                emit(m_indices.data(), m_indices.size(), m_vertices.data(), m_vertices.size());
+            }
+        }
+
+    private:
+        void NextPiece()
+        {
+            m_indices.clear();
+            m_vertices.clear();
+
+            if (++m_generation == 0)
+            {
+                std::fill(m_stamp.begin(), m_stamp.end(), 0u);
+                m_generation = 1;
+            }
+        }
+
+        uint32_t                m_generation;
+        std::vector<uint32_t>   m_stamp;        // m_generation when the vertex is in the current piece
+        std::vector<uint16_t>   m_remap;
+        std::vector<uint16_t>   m_indices;
+        std::vector<uint32_t>   m_vertices;
+    };
+
+    template<typename TVertex>
+    class BulkPrimitiveBatch : public DirectX::PrimitiveBatch<TVertex>
+    {
+        using Batch = DirectX::PrimitiveBatch<TVertex>;
+        using BatchBase = typename Batch::PrimitiveBatchBase;
+
+    public:
+        static constexpr size_t DefaultBatchSize = 4096;
+
+        explicit BulkPrimitiveBatch(_In_ ID3D12Device* device, size_t maxIndices = DefaultBatchSize * 3, size_t maxVertices = DefaultBatchSize) :
+            Batch(device, maxIndices, maxVertices),
+            m_maxIndices(maxIndices),
+            m_maxVertices(maxVertices)
+        {
+        }
+
+        size_t GetMaxIndices() const noexcept { return m_maxIndices; }
+        size_t GetMaxVertices() const noexcept { return m_maxVertices; }
+
+        // Like Draw, for any number of vertices. Strips are continued across pieces.
+        void DrawBulk(D3D_PRIMITIVE_TOPOLOGY topology, _In_reads_(vertexCount) const TVertex* vertices, size_t vertexCount)
+        {
+            ForEachVertexChunk(topology, vertexCount, m_maxVertices, [&](size_t first, size_t count)
+                {
+                    Batch::Draw(topology, vertices + first, count);
+                });
+        }
+
+        // Like DrawIndexed, for any number of indices and vertices of a point, line, or triangle
+        // list. 32-bit indices are accepted so meshes past 64K vertices need no pre-splitting.
+        template<typename TIndex>
+        void DrawIndexedBulk(D3D_PRIMITIVE_TOPOLOGY topology,
+            _In_reads_(indexCount) const TIndex* indices, size_t indexCount,
+            _In_reads_(vertexCount) const TVertex* vertices, size_t vertexCount)
+        {
+            if (std::is_same<TIndex, uint16_t>::value && indexCount <= m_maxIndices && vertexCount <= m_maxVertices)
+            {
+                Batch::DrawIndexed(topology, reinterpret_cast<const uint16_t*>(indices), indexCount, vertices, vertexCount);
+                return;
+            }
+
+            m_splitter.Split(topology, indices, indexCount, vertexCount, m_maxIndices, m_maxVertices,
+                [&](const uint16_t* pieceIndices, size_t pieceIndexCount, const uint32_t* vertexMap, size_t pieceVertexCount)
+                {
+                    void* mappedVertices = nullptr;
+                    BatchBase::Draw(topology, true, pieceIndices, pieceIndexCount, pieceVertexCount, &mappedVertices);
+
+                    auto dest = static_cast<TVertex*>(mappedVertices);
+                    for (size_t j = 0; j < pieceVertexCount; ++j)
+                    {
+                        dest[j] = vertices[vertexMap[j]];
+                    }
+                });
+        }
+
+        // Queues a draw of 'vertexCount' (up to GetMaxVertices) vertices and returns their upload
+        // memory, which must be filled before the next call on this batch.
+        _Ret_writes_(vertexCount) TVertex* Reserve(D3D_PRIMITIVE_TOPOLOGY topology, size_t vertexCount)
+        {
+            assert(vertexCount > 0);
+
+            void* mappedVertices = nullptr;
+            BatchBase::Draw(topology, false, nullptr, 0, vertexCount, &mappedVertices);
+            return static_cast<TVertex*>(mappedVertices);
+        }
+
+        // As Reserve, for an indexed draw. The indices are copied (and rebased by the batch) at once.
+        _Ret_writes_(vertexCount) TVertex* ReserveIndexed(D3D_PRIMITIVE_TOPOLOGY topology,
+            _In_reads_(indexCount) const uint16_t* indices, size_t indexCount, size_t vertexCount)
+        {
+            assert(indexCount > 0 && indexCount <= m_maxIndices && vertexCount > 0 && vertexCount <= m_maxVertices);
+
+            void* mappedVertices = nullptr;
+            BatchBase::Draw(topology, true, indices, indexCount, vertexCount, &mappedVertices);
+            return static_cast<TVertex*>(mappedVertices);
+        }
+
+        // Draws 'vertexCount' vertices produced by fill(dest, first, count), which writes vertices
+        // [first, first + count) to 'dest' in upload memory. Pieces of a strip overlap, so the
+        // vertices at a seam are requested twice.
+        template<typename TFunc>
+        void Generate(D3D_PRIMITIVE_TOPOLOGY topology, size_t vertexCount, TFunc&& fill)
+        {
+            ForEachVertexChunk(topology, vertexCount, m_maxVertices, [&](size_t first, size_t count)
+                {
+                    fill(Reserve(topology, count), first, count);
+                });
+        }
+
+    private:
+        size_t                      m_maxIndices;
+        size_t                      m_maxVertices;
+        IndexedPrimitiveSplitter    m_splitter;
+    };
+}
@@ -0,0 +1,517 @@
+//--------------------------------------------------------------------------------------
+// File: BulkSpriteBatch.h
+//
+// Draws large numbers of sprites from structure-of-arrays data
+//
+// SpriteBatch::Draw queues one sprite per call and expands each into four vertices on
+// its own. Here the caller fills SpriteArrays (one array per attribute), a stable radix
+// sort orders them by texture or depth, and the quad vertices are generated four sprites
+// at a time with DirectXMath straight into a BulkPrimitiveBatch's upload memory. The
+// vertices match SpriteBatch's, so either path can draw the same scene.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "BulkPrimitiveBatch.h"
+
+#include <CommonStates.h>
+#include <DirectXColors.h>
+#include <DirectXMath.h>
+#include <Effects.h>
+#include <SpriteBatch.h>
+#include <VertexTypes.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // One array per sprite attribute; every array holds GetCount() entries.
+    struct SpriteArrays
+    {
+        std::vector<float>      x;              // position of the origin, in pixels
+        std::vector<float>      y;
+        std::vector<float>      width;          // destination size, in pixels
+        std::vector<float>      height;
+        std::vector<float>      originX;        // pivot, as a fraction of the size
+        std::vector<float>      originY;
+        std::vector<float>      rotation;       // radians, clockwise on screen
+        std::vector<float>      u0;             // texture coordinates of the top-left and bottom-right
+        std::vector<float>      v0;             // corners; swapped to flip
+        std::vector<float>      u1;
+        std::vector<float>      v1;
+        std::vector<float>      red;
+        std::vector<float>      green;
+        std::vector<float>      blue;
+        std::vector<float>      alpha;
+        std::vector<float>      depth;
+        std::vector<uint32_t>   texture;        // index into the table passed to BulkSpriteBatch::Draw
+
+        size_t GetCount() const noexcept { return texture.size(); }
+
+        void Resize(size_t count)
+        {
+            ForEachArray([count](auto& a) { a.resize(count); });
+        }
+
+        void Reserve(size_t count)
+        {
+            ForEachArray([count](auto& a) { a.reserve(count); });
+        }
+
+        void Clear() noexcept
+        {
+            ForEachArray([](auto& a) { a.clear(); });
+        }
+
+        // Appends a sprite placed as SpriteBatch::Draw(texture, textureSize, position, sourceRectangle,
+        // color, rotation, origin, scale, effects, layerDepth) would place it.
+        void XM_CALLCONV Add(uint32_t textureIndex, const DirectX::XMUINT2& textureSize,
+            const DirectX::XMFLOAT2& position, _In_opt_ const RECT* sourceRectangle = nullptr,
+            DirectX::FXMVECTOR color = DirectX::Colors::White, float rotationAngle = 0.f,
+            const DirectX::XMFLOAT2& origin = DirectX::XMFLOAT2(0.f, 0.f),
+            const DirectX::XMFLOAT2& scale = DirectX::XMFLOAT2(1.f, 1.f),
+            DirectX::SpriteEffects effects = DirectX::SpriteEffects_None, float layerDepth = 0.f)
+        {
+            float sx = 0.f;
+            float sy = 0.f;
+            float sw = float(textureSize.x);
+            float sh = float(textureSize.y);
+            if (sourceRectangle)
+            {
+                sx = float(sourceRectangle->left);
+                sy = float(sourceRectangle->top);
+                sw = float(sourceRectangle->right - sourceRectangle->left);
+                sh = float(sourceRectangle->bottom - sourceRectangle->top);
+            }
+
+            const float invWidth = textureSize.x ? 1.f / float(textureSize.x) : 0.f;
+            const float invHeight = textureSize.y ? 1.f / float(textureSize.y) : 0.f;
+
+            float left = sx * invWidth;
+            float top = sy * invHeight;
+            float right = (sx + sw) * invWidth;
+            float bottom = (sy + sh) * invHeight;
+            if (effects & DirectX::SpriteEffects_FlipHorizontally)
+                std::swap(left, right);
+            if (effects & DirectX::SpriteEffects_FlipVertically)
+                std::swap(top, bottom);
+
+            DirectX::XMFLOAT4 rgba;
+            DirectX::XMStoreFloat4(&rgba, color);
+
+            x.push_back(position.x);
+            y.push_back(position.y);
+            width.push_back(sw * scale.x);
+            height.push_back(sh * scale.y);
+            originX.push_back(sw != 0.f ? origin.x / sw : 0.f);
+            originY.push_back(sh != 0.f ? origin.y / sh : 0.f);
+            rotation.push_back(rotationAngle);
+            u0.push_back(left);
+            v0.push_back(top);
+            u1.push_back(right);
+            v1.push_back(bottom);
+            red.push_back(rgba.x);
+            green.push_back(rgba.y);
+            blue.push_back(rgba.z);
+            alpha.push_back(rgba.w);
+            depth.push_back(layerDepth);
+            texture.push_back(textureIndex);
+        }
+
+    private:
+        template<typename TFunc>
+        void ForEachArray(TFunc&& func)
+        {
+            std::vector<float>* arrays[] =
+            {
+                &x, &y, &width, &height, &originX, &originY, &rotation,
+                &u0, &v0, &u1, &v1, &red, &green, &blue, &alpha, &depth,
+            };
+            for (auto a : arrays)
+            {
+                func(*a);
+            }
+            func(texture);
+        }
+    };
+
+    // Writes the four vertices of sprites order[first], ..., order[first + count - 1] (or of sprites
+    // first, ..., first + count - 1 when 'order' is null) in SpriteBatch's corner order: top-left,
+    // top-right, bottom-left, bottom-right.
+    inline void GenerateSpriteVertices(const SpriteArrays& sprites, _In_opt_ const uint32_t* order, size_t first, size_t count,
+        _Out_writes_(count * 4) DirectX::VertexPositionColorTexture* vertices) noexcept
+    {
+        using namespace DirectX;
+
+        assert(first + count <= sprites.GetCount());
+
+        for (size_t j = 0; j < count; j += 4)
+        {
+            // A short last group repeats its final sprite in the unused lanes.
+            const size_t lanes = std::min<size_t>(count - j, 4);
+            uint32_t index[4];
+            for (size_t k = 0; k < 4; ++k)
+            {
+                const size_t n = first + j + std::min(k, lanes - 1);
+                index[k] = order ? order[n] : static_cast<uint32_t>(n);
+            }
+            const bool contiguous = (index[1] == index[0] + 1) && (index[2] == index[0] + 2) && (index[3] == index[0] + 3);
+
+            auto load = [&](const std::vector<float>& a) -> XMVECTOR
+                {
+                    return contiguous
+                        ? XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a[index[0]]))
+                        : XMVectorSet(a[index[0]], a[index[1]], a[index[2]], a[index[3]]);
+                };
+
+            XMVECTOR sinR, cosR;
+            XMVectorSinCos(&sinR, &cosR, load(sprites.rotation));
+
+            // Corner offsets from the origin, before rotation.
+            const XMVECTOR w = load(sprites.width);
+            const XMVECTOR h = load(sprites.height);
+            const XMVECTOR left = XMVectorNegate(XMVectorMultiply(load(sprites.originX), w));
+            const XMVECTOR top = XMVectorNegate(XMVectorMultiply(load(sprites.originY), h));
+            const XMVECTOR right = XMVectorAdd(left, w);
+            const XMVECTOR bottom = XMVectorAdd(top, h);
+
+            // Rotated (dx, dy) is (dx cos - dy sin, dx sin + dy cos).
+            const XMVECTOR px = load(sprites.x);
+            const XMVECTOR py = load(sprites.y);
+            const XMVECTOR leftX = XMVectorMultiplyAdd(left, cosR, px);
+            const XMVECTOR leftY = XMVectorMultiplyAdd(left, sinR, py);
+            const XMVECTOR rightX = XMVectorMultiplyAdd(right, cosR, px);
+            const XMVECTOR rightY = XMVectorMultiplyAdd(right, sinR, py);
+            const XMVECTOR topX = XMVectorMultiply(top, sinR);
+            const XMVECTOR topY = XMVectorMultiply(top, cosR);
+            const XMVECTOR bottomX = XMVectorMultiply(bottom, sinR);
+            const XMVECTOR bottomY = XMVectorMultiply(bottom, cosR);
+
+            const XMVECTOR z = load(sprites.depth);
+            const XMVECTOR zero = XMVectorZero();
+
+            // Transposing turns each attribute-per-vector set into one vector per sprite.
+            const XMMATRIX corners[4] =
+            {
+                XMMatrixTranspose(XMMATRIX(XMVectorSubtract(leftX, topX), XMVectorAdd(leftY, topY), z, zero)),
+                XMMatrixTranspose(XMMATRIX(XMVectorSubtract(rightX, topX), XMVectorAdd(rightY, topY), z, zero)),
+                XMMatrixTranspose(XMMATRIX(XMVectorSubtract(leftX, bottomX), XMVectorAdd(leftY, bottomY), z, zero)),
+                XMMatrixTranspose(XMMATRIX(XMVectorSubtract(rightX, bottomX), XMVectorAdd(rightY, bottomY), z, zero)),
+            };
+            const XMMATRIX colors = XMMatrixTranspose(XMMATRIX(load(sprites.red), load(sprites.green), load(sprites.blue), load(sprites.alpha)));
+            const XMMATRIX uvs = XMMatrixTranspose(XMMATRIX(load(sprites.u0), load(sprites.v0), load(sprites.u1), load(sprites.v1)));
+
+            for (size_t k = 0; k < lanes; ++k)
+            {
+                auto v = vertices + (j + k) * 4;
+                const XMVECTOR uv = uvs.r[k];
+
+                XMStoreFloat3(&v[0].position, corners[0].r[k]);
+                XMStoreFloat3(&v[1].position, corners[1].r[k]);
+                XMStoreFloat3(&v[2].position, corners[2].r[k]);
+                XMStoreFloat3(&v[3].position, corners[3].r[k]);
+
+                XMStoreFloat4(&v[0].color, colors.r[k]);
+                XMStoreFloat4(&v[1].color, colors.r[k]);
+                XMStoreFloat4(&v[2].color, colors.r[k]);
+                XMStoreFloat4(&v[3].color, colors.r[k]);
+
+                XMStoreFloat2(&v[0].textureCoordinate, uv);
+                XMStoreFloat2(&v[1].textureCoordinate, XMVectorSwizzle<2, 1, 2, 1>(uv));
+                XMStoreFloat2(&v[2].textureCoordinate, XMVectorSwizzle<0, 3, 0, 3>(uv));
+                XMStoreFloat2(&v[3].textureCoordinate, XMVectorSwizzle<2, 3, 2, 3>(uv));
+            }
+        }
+    }
+
+    // Orders sprites for drawing with a stable LSD radix sort on 32-bit keys, eight bits per pass.
+    // A pass whose digit is the same in every key is skipped, so a small texture index costs one.
+    class SpriteSorter
+    {
+    public:
+        SpriteSorter() noexcept : m_passes(0) {}
+
+        // Returns the sprite indices in drawing order. Deferred and Immediate keep submission order;
+        // the others order as SpriteBatch does, keeping submission order between equal keys.
+        const std::vector<uint32_t>& Sort(const SpriteArrays& sprites, DirectX::SpriteSortMode sortMode)
+        {
+            const size_t count = sprites.GetCount();
+            m_keys.resize(count);
+
+            switch (sortMode)
+            {
+            case DirectX::SpriteSortMode_Texture:
+                std::copy(sprites.texture.cbegin(), sprites.texture.cend(), m_keys.begin());
+                break;
+
+            case DirectX::SpriteSortMode_BackToFront:
+                for (size_t j = 0; j < count; ++j)
+                {
+                    m_keys[j] = ~GetDepthKey(sprites.depth[j]);
+                }
+                break;
+
+            case DirectX::SpriteSortMode_FrontToBack:
+                for (size_t j = 0; j < count; ++j)
+                {
+                    m_keys[j] = GetDepthKey(sprites.depth[j]);
+                }
+                break;
+
+            default:
+                m_keys.clear();
+                break;
+            }
+
+            SortKeys(count);
+            return m_order;
+        }
+
+        // Passes that moved data in the last Sort.
+        uint32_t GetLastPassCount() const noexcept { return m_passes; }
+
+        // Orders floats as unsigned integers: flip the sign bit of positives, every bit of negatives.
+        static uint32_t GetDepthKey(float depth) noexcept
+        {
+            uint32_t bits = 0;
+            std::memcpy(&bits, &depth, sizeof(bits));
+            if (bits == 0x80000000u)
+                bits = 0;       // -0 sorts with +0
+
+            return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+        }
+
+    private:
+        static constexpr uint32_t c_RadixBits = 8;
+        static constexpr uint32_t c_Buckets = 1u << c_RadixBits;
+        static constexpr uint32_t c_Passes = 32 / c_RadixBits;
+
+        void SortKeys(size_t count)
+        {
+            m_order.resize(count);
+            for (size_t j = 0; j < count; ++j)
+            {
+                m_order[j] = static_cast<uint32_t>(j);
+            }
+
+            m_passes = 0;
+            if (m_keys.empty() || count < 2)
+                return;
+
+            // Every pass's histogram in one read of the keys.
+            uint32_t histograms[c_Passes][c_Buckets] = {};
+            for (size_t j = 0; j < count; ++j)
+            {
+                const uint32_t key = m_keys[j];
+                for (uint32_t pass = 0; pass < c_Passes; ++pass)
+                {
+                    ++histograms[pass][(key >> (pass * c_RadixBits)) & (c_Buckets - 1)];
+                }
+            }
+
+            m_scratchKeys.resize(count);
+            m_scratchOrder.resize(count);
+
+            for (uint32_t pass = 0; pass < c_Passes; ++pass)
+            {
+                const uint32_t shift = pass * c_RadixBits;
+                auto& histogram = histograms[pass];
+                if (histogram[(m_keys[0] >> shift) & (c_Buckets - 1)] == count)
+                    continue;
+
+                uint32_t offset = 0;
+                for (uint32_t b = 0; b < c_Buckets; ++b)
+                {
+                    const uint32_t bucket = histogram[b];
+                    histogram[b] = offset;
+                    offset += bucket;
+                }
+
+                for (size_t j = 0; j < count; ++j)
+                {
+                    const uint32_t key = m_keys[j];
+                    const uint32_t dest = histogram[(key >> shift) & (c_Buckets - 1)]++;
+                    m_scratchKeys[dest] = key;
+                    m_scratchOrder[dest] = m_order[j];
+                }
+
+                m_keys.swap(m_scratchKeys);
+                m_order.swap(m_scratchOrder);
+                ++m_passes;
+            }
+        }
+
+        uint32_t                m_passes;
+        std::vector<uint32_t>   m_keys;
+        std::vector<uint32_t>   m_order;
+        std::vector<uint32_t>   m_scratchKeys;
+        std::vector<uint32_t>   m_scratchOrder;
+    };
+
+    class BulkSpriteBatch
+    {
+    public:
+        // Sprites per draw, as SpriteBatch.
+        static constexpr size_t MaxBatchSize = 2048;
+
+        // 'blend' defaults to premultiplied alpha, as SpriteBatch.
+        BulkSpriteBatch(_In_ ID3D12Device* device, const DirectX::RenderTargetState& rtState,
+            _In_opt_ const D3D12_BLEND_DESC* blend = nullptr) :
+            m_viewport{},
+            m_rotation(DXGI_MODE_ROTATION_IDENTITY),
+            m_lastBatchCount(0)
+        {
+            using namespace DirectX;
+
+            m_batch = std::make_unique<BulkPrimitiveBatch<VertexPositionColorTexture>>(device, MaxBatchSize * 6, MaxBatchSize * 4);
+
+            const EffectPipelineStateDescription pd(
+                &VertexPositionColorTexture::InputLayout,
+                blend ? *blend : CommonStates::AlphaBlend,
+                CommonStates::DepthNone,
+                CommonStates::CullNone,
+                rtState);
+
+            m_effect = std::make_unique<BasicEffect>(device, EffectFlags::Texture | EffectFlags::VertexColor, pd);
+
+            m_quadIndices.resize(MaxBatchSize * 6);
+            for (size_t j = 0; j < MaxBatchSize; ++j)
+            {
+                const auto v = static_cast<uint16_t>(j * 4);
+                uint16_t* quad = &m_quadIndices[j * 6];
+                quad[0] = v;
+                quad[1] = uint16_t(v + 1);
+                quad[2] = uint16_t(v + 2);
+                quad[3] = uint16_t(v + 1);
+                quad[4] = uint16_t(v + 3);
+                quad[5] = uint16_t(v + 2);
+            }
+        }
+
+        BulkSpriteBatch(BulkSpriteBatch&&) = default;
+        BulkSpriteBatch& operator= (BulkSpriteBatch&&) = default;
+
+        BulkSpriteBatch(BulkSpriteBatch const&) = delete;
+        BulkSpriteBatch& operator= (BulkSpriteBatch const&) = delete;
+
+        void SetViewport(const D3D12_VIEWPORT& viewport) noexcept { m_viewport = viewport; }
+        void SetRotation(DXGI_MODE_ROTATION mode) noexcept { m_rotation = mode; }
+
+        // Draws every sprite in 'sprites'. Sprite j samples textures[sprites.texture[j]] with 'sampler';
+        // the caller sets the descriptor heaps holding them.
+        void Draw(_In_ ID3D12GraphicsCommandList* commandList, const SpriteArrays& sprites,
+            _In_reads_(textureCount) const D3D12_GPU_DESCRIPTOR_HANDLE* textures, size_t textureCount,
+            D3D12_GPU_DESCRIPTOR_HANDLE sampler,
+            DirectX::SpriteSortMode sortMode = DirectX::SpriteSortMode_Deferred)
+        {
+            using namespace DirectX;
+
+            m_lastBatchCount = 0;
+
+            const size_t count = sprites.GetCount();
+            if (!count)
+                return;
+
+            if (m_viewport.Width <= 0.f || m_viewport.Height <= 0.f)
+                throw std::logic_error("BulkSpriteBatch viewport not set");
+
+            if (*std::max_element(sprites.texture.cbegin(), sprites.texture.cend()) >= textureCount)
+                throw std::out_of_range("Sprite texture index past the end of the texture table");
+
+            const bool sorted = (sortMode == SpriteSortMode_Texture || sortMode == SpriteSortMode_BackToFront || sortMode == SpriteSortMode_FrontToBack);
+            const uint32_t* order = sorted ? m_sorter.Sort(sprites, sortMode).data() : nullptr;
+
+            m_effect->SetProjection(GetViewportTransform());
+
+            // One Begin/End per run of a texture, since the batch only draws when it is flushed.
+            size_t runStart = 0;
+            while (runStart < count)
+            {
+                const uint32_t texture = sprites.texture[order ? order[runStart] : runStart];
+                size_t runEnd = runStart + 1;
+                while (runEnd < count && sprites.texture[order ? order[runEnd] : runEnd] == texture)
+                {
+                    ++runEnd;
+                }
+
+                m_effect->SetTexture(textures[texture], sampler);
+                m_effect->Apply(commandList);
+
+                m_batch->Begin(commandList);
+                for (size_t first = runStart; first < runEnd; first += MaxBatchSize)
+                {
+                    const size_t n = std::min(runEnd - first, MaxBatchSize);
+                    auto vertices = m_batch->ReserveIndexed(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, m_quadIndices.data(), n * 6, n * 4);
+                    GenerateSpriteVertices(sprites, order, first, n, vertices);
+                }
+                m_batch->End();
+
+                ++m_lastBatchCount;
+                runStart = runEnd;
+            }
+        }
+
+        // Texture runs (Begin/End pairs) in the last Draw.
+        size_t GetLastBatchCount() const noexcept { return m_lastBatchCount; }
+
+    private:
+        // Pixels to clip space, with the display rotation, as SpriteBatch.
+        DirectX::XMMATRIX GetViewportTransform() const noexcept
+        {
+            using namespace DirectX;
+
+            const float xScale = 2.f / m_viewport.Width;
+            const float yScale = 2.f / m_viewport.Height;
+
+            switch (m_rotation)
+            {
+            case DXGI_MODE_ROTATION_ROTATE90:
+                return XMMATRIX(
+                    0, -yScale, 0, 0,
+                    -xScale, 0, 0, 0,
+                    0, 0, 1, 0,
+                    1, 1, 0, 1);
+
+            case DXGI_MODE_ROTATION_ROTATE270:
+                return XMMATRIX(
+                    0, yScale, 0, 0,
+                    xScale, 0, 0, 0,
+                    0, 0, 1, 0,
+                    -1, -1, 0, 1);
+
+            case DXGI_MODE_ROTATION_ROTATE180:
+                return XMMATRIX(
+                    -xScale, 0, 0, 0,
+                    0, yScale, 0, 0,
+                    0, 0, 1, 0,
+                    1, -1, 0, 1);
+
+            default:
+                return XMMATRIX(
+                    xScale, 0, 0, 0,
+                    0, -yScale, 0, 0,
+                    0, 0, 1, 0,
+                    -1, 1, 0, 1);
+            }
+        }
+
+        std::unique_ptr<BulkPrimitiveBatch<DirectX::VertexPositionColorTexture>>   m_batch;
+        std::unique_ptr<DirectX::BasicEffect>                                       m_effect;
+        std::vector<uint16_t>                                                       m_quadIndices;
+        SpriteSorter                                                                m_sorter;
+        D3D12_VIEWPORT                                                              m_viewport;
+        DXGI_MODE_ROTATION                                                          m_rotation;
+        size_t                                                                      m_lastBatchCount;
+    };
+}
@@ -0,0 +1,69 @@
+//
+// CpuTimer.h - A simple stopwatch for timing CPU workloads in the test suite
+//
+
+#pragma once
+
+#include <cstdint>
+#include <exception>
+
+
+namespace DX
+{
+    // Helper class for measuring elapsed CPU time of benchmark loops.
+    class CpuTimer
+    {
+    public:
+        CpuTimer() noexcept(false) :
+            m_qpcStart{},
+            m_elapsedQpc(0)
+        {
+            if (!QueryPerformanceFrequency(&m_qpcFrequency))
+            {
+                throw std::exception();
+            }
+        }
+
+        // Begin a new measurement interval.
+        void Start()
+        {
+            if (!QueryPerformanceCounter(&m_qpcStart))
+            {
+                throw std::exception();
+            }
+        }
+
+        // End the current interval, accumulating it into the elapsed total.
+        void Stop()
+        {
+            LARGE_INTEGER currentTime;
+            if (!QueryPerformanceCounter(&currentTime))
+            {
+                throw std::exception();
+            }
+
+            m_elapsedQpc += static_cast<uint64_t>(currentTime.QuadPart - m_qpcStart.QuadPart);
+        }
+
+        void Reset() noexcept { m_elapsedQpc = 0; }
+
+        double GetElapsedSeconds() const noexcept
+        {
+            return static_cast<double>(m_elapsedQpc) / static_cast<double>(m_qpcFrequency.QuadPart);
+        }
+
+        double GetElapsedMilliseconds() const noexcept { return GetElapsedSeconds() * 1000.0; }
+
+        // Convenience for reporting throughput of 'count' items processed during the elapsed time.
+        double GetRate(uint64_t count) const noexcept
+        {
+            const double seconds = GetElapsedSeconds();
+            return (seconds > 0.0) ? static_cast<double>(count) / seconds : 0.0;
+        }
+
+    private:
+        LARGE_INTEGER m_qpcFrequency;
+        LARGE_INTEGER m_qpcStart;
+        uint64_t m_elapsedQpc;
+    };
+}
@@ -0,0 +1,261 @@
+//--------------------------------------------------------------------------------------
+// File: DeviceResourcesCore.h
+//
+// Frame ring, fence values, back buffer index, and resize state shared by the
+// DeviceResources implementations
+//
+// Each DeviceResources owns its platform objects (device, swap chain, PresentX) and
+// drives a FrameRing through the same sequence:
+//
+//   CreateDeviceResources               fence = CreateFence(ring.BeginDevice())
+//   CreateWindowSizeDependentResources  ring.BeginResize(); ...; ring.EndResize(current back buffer)
+//   Present                             ring.MoveToNextFrame(current back buffer)
+//   HandleDeviceLost                    ring.EndDevice()
+//
+// The fence is reached through TFence, so the frame loop also runs with no GPU and no
+// window on NullFrameFence. TFence must provide:
+//
+//   bool     IsBound() const;                      // false before the fence exists
+//   uint64_t GetCompletedFenceValue() const;
+//   void     Signal(uint64_t value);               // on the presenting queue
+//   void     WaitForFenceValue(uint64_t value);    // blocks the CPU
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    enum class FrameRingState : uint32_t
+    {
+        NoDevice,       // before BeginDevice, or after EndDevice
+        Resizing,       // the back buffers are not (or no longer) available
+        Ready,
+    };
+
+    template<typename TFence>
+    class FrameRing
+    {
+    public:
+        explicit FrameRing(uint32_t backBufferCount, TFence fence = TFence()) :
+            m_fence(std::move(fence)),
+            m_fenceValues(backBufferCount, 0),
+            m_backBufferIndex(0),
+            m_signaledValue(0),
+            m_state(FrameRingState::NoDevice),
+            m_frameCount(0),
+            m_fenceStalls(0)
+        {
+            if (!backBufferCount)
+                throw std::invalid_argument("FrameRing needs at least one back buffer");
+        }
+
+        FrameRing(FrameRing&&) = default;
+        FrameRing& operator= (FrameRing&&) = default;
+
+        FrameRing(FrameRing const&) = delete;
+        FrameRing& operator= (FrameRing const&) = delete;
+
+        TFence& GetFence() noexcept { return m_fence; }
+        const TFence& GetFence() const noexcept { return m_fence; }
+
+        FrameRingState GetState() const noexcept { return m_state; }
+        uint32_t GetBackBufferCount() const noexcept { return static_cast<uint32_t>(m_fenceValues.size()); }
+        uint32_t GetBackBufferIndex() const noexcept { return m_backBufferIndex; }
+
+        // The value the next frame rendered to back buffer 'index' will signal.
+        uint64_t GetFenceValue(uint32_t index) const noexcept { assert(index < m_fenceValues.size()); return m_fenceValues[index]; }
+
+        uint64_t GetFrameCount() const noexcept { return m_frameCount; }
+
+        // Frames whose back buffer was still in use by the GPU in MoveToNextFrame.
+        uint64_t GetFenceStalls() const noexcept { return m_fenceStalls; }
+
+        // Returns the initial value for a new fence. Fence values keep increasing across
+        // device loss, so a value from the old device is never mistaken for a new one.
+        uint64_t BeginDevice() noexcept
+        {
+            m_state = FrameRingState::Resizing;
+            return m_fenceValues[m_backBufferIndex]++;
+        }
+
+        void EndDevice() noexcept
+        {
+            m_state = FrameRingState::NoDevice;
+        }
+
+        // Drains the GPU so the back buffers can be released; every buffer then waits on the same value.
+        void BeginResize() noexcept
+        {
+            WaitForGpu();
+
+            const uint64_t value = m_fenceValues[m_backBufferIndex];
+            std::fill(m_fenceValues.begin(), m_fenceValues.end(), value);
+
+            if (m_state != FrameRingState::NoDevice)
+            {
+                m_state = FrameRingState::Resizing;
+            }
+        }
+
+        void EndResize(uint32_t backBufferIndex)
+        {
+            if (m_state == FrameRingState::NoDevice)
+                throw std::logic_error("FrameRing::EndResize without a device");
+            if (backBufferIndex >= m_fenceValues.size())
+                throw std::out_of_range("FrameRing::EndResize back buffer index");
+
+            m_backBufferIndex = backBufferIndex;
+            m_state = FrameRingState::Ready;
+        }
+
+        // Blocks until the GPU has finished all submitted work. Does nothing without a fence.
+        void WaitForGpu() noexcept
+        {
+            if (!m_fence.IsBound())
+                return;
+
+            try
+            {
+                const uint64_t value = m_fenceValues[m_backBufferIndex];
+                m_fence.Signal(value);
+                m_fence.WaitForFenceValue(value);
+                m_fenceValues[m_backBufferIndex]++;
+            }
+            catch (...)
+            {
+                // As with a failed Signal, the GPU is left to finish in its own time.
+            }
+        }
+
+        // After Present: signals the frame just submitted, moves to 'backBufferIndex', and
+        // blocks until the GPU has finished the last frame that used that buffer.
+        void MoveToNextFrame(uint32_t backBufferIndex)
+        {
+            std::ignore = Signal();
+
+            const uint64_t value = Advance(backBufferIndex);
+            if (m_fence.GetCompletedFenceValue() < value)
+            {
+                ++m_fenceStalls;
+                m_fence.WaitForFenceValue(value);
+            }
+        }
+
+        // MoveToNextFrame in two halves, for a caller that times the wait itself:
+        // Signal returns the value the GPU signals when it finishes this frame, and Advance
+        // returns the value to wait for before the new back buffer can be reused.
+        uint64_t Signal()
+        {
+            if (m_state != FrameRingState::Ready)
+                throw std::logic_error("FrameRing::Signal while not ready");
+
+            m_signaledValue = m_fenceValues[m_backBufferIndex];
+            m_fence.Signal(m_signaledValue);
+            return m_signaledValue;
+        }
+
+        uint64_t Advance(uint32_t backBufferIndex)
+        {
+            if (backBufferIndex >= m_fenceValues.size())
+                throw std::out_of_range("FrameRing::Advance back buffer index");
+
+            m_backBufferIndex = backBufferIndex;
+            const uint64_t value = m_fenceValues[backBufferIndex];
+            m_fenceValues[backBufferIndex] = m_signaledValue + 1;
+            ++m_frameCount;
+            return value;
+        }
+
+        // For presentation that paces the CPU itself (PresentX): rotates to the next back buffer
+        // without a signal, carrying the fence value forward for WaitForGpu.
+        void AdvanceUnsignaled() noexcept
+        {
+            const uint64_t value = m_fenceValues[m_backBufferIndex];
+            m_backBufferIndex = (m_backBufferIndex + 1) % GetBackBufferCount();
+            m_fenceValues[m_backBufferIndex] = value;
+            ++m_frameCount;
+        }
+
+    private:
+        TFence                  m_fence;
+        std::vector<uint64_t>   m_fenceValues;
+        uint32_t                m_backBufferIndex;
+        uint64_t                m_signaledValue;
+        FrameRingState          m_state;
+        uint64_t                m_frameCount;
+        uint64_t                m_fenceStalls;
+    };
+
+    // Simulated fence for running the frame loop with no GPU. The "GPU" finishes each signal
+    // 'gpuLatency' signals later, or as soon as the CPU waits for it, and every call is logged.
+    class NullFrameFence
+    {
+    public:
+        enum class Call : uint32_t
+        {
+            Signal,
+            Wait,
+        };
+
+        explicit NullFrameFence(uint32_t gpuLatency = 0) :
+            m_gpuLatency(gpuLatency),
+            m_completed(0)
+        {
+        }
+
+        bool IsBound() const noexcept { return true; }
+
+        uint64_t GetCompletedFenceValue() const noexcept { return m_completed; }
+
+        void Signal(uint64_t value)
+        {
+            assert(m_pending.empty() || value >= m_pending.back());
+            m_calls.emplace_back(Call::Signal, value);
+            m_pending.push_back(value);
+
+            while (m_pending.size() > m_gpuLatency)
+            {
+                Complete(m_pending.front());
+            }
+        }
+
+        void WaitForFenceValue(uint64_t value)
+        {
+            m_calls.emplace_back(Call::Wait, value);
+            Complete(value);
+        }
+
+        void SetGpuLatency(uint32_t signals) noexcept { m_gpuLatency = signals; }
+
+        const std::vector<std::pair<Call, uint64_t>>& GetCalls() const noexcept { return m_calls; }
+        void ClearCalls() noexcept { m_calls.clear(); }
+
+    private:
+        void Complete(uint64_t value)
+        {
+            m_completed = std::max(m_completed, value);
+            while (!m_pending.empty() && m_pending.front() <= m_completed)
+            {
+                m_pending.pop_front();
+            }
+        }
+
+        uint32_t                                    m_gpuLatency;
+        uint64_t                                    m_completed;
+        std::deque<uint64_t>                        m_pending;
+        std::vector<std::pair<Call, uint64_t>>      m_calls;
+    };
+}
@@ -0,0 +1,59 @@
+//--------------------------------------------------------------------------------------
+// File: DeviceResourcesCoreD3D12.h
+//
+// Direct3D 12 fence for DX::FrameRing
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "DeviceResourcesCore.h"
+
+
+namespace DX
+{
+    // Holds non-owning references; DeviceResources rebinds it whenever the queue or fence is recreated.
+    class D3D12FrameFence
+    {
+    public:
+        D3D12FrameFence() noexcept :
+            m_commandQueue(nullptr),
+            m_fence(nullptr),
+            m_fenceEvent(nullptr)
+        {
+        }
+
+        void Bind(ID3D12CommandQueue* commandQueue, ID3D12Fence* fence, HANDLE fenceEvent) noexcept
+        {
+            m_commandQueue = commandQueue;
+            m_fence = fence;
+            m_fenceEvent = fenceEvent;
+        }
+
+        bool IsBound() const noexcept { return m_commandQueue && m_fence && m_fenceEvent; }
+
+        uint64_t GetCompletedFenceValue() const noexcept
+        {
+            return m_fence ? m_fence->GetCompletedValue() : UINT64_MAX;
+        }
+
+        void Signal(uint64_t value)
+        {
+            ThrowIfFailed(m_commandQueue->Signal(m_fence, value));
+        }
+
+        void WaitForFenceValue(uint64_t value)
+        {
+            ThrowIfFailed(m_fence->SetEventOnCompletion(value, m_fenceEvent));
+            std::ignore = WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+        }
+
+    private:
+        ID3D12CommandQueue*     m_commandQueue;
+        ID3D12Fence*            m_fence;
+        HANDLE                  m_fenceEvent;
+    };
+
+    using D3D12FrameRing = FrameRing<D3D12FrameFence>;
+}
@@ -39,8 +39,7 @@ DeviceResources::DeviceResources(
     DXGI_FORMAT depthBufferFormat,
     UINT backBufferCount,
     unsigned int flags) noexcept(false) :
-        m_backBufferIndex(0),
-        m_fenceValues{},
+        m_frameRing(backBufferCount),
 #ifdef _GAMING_XBOX
         m_framePipelineToken{},
 #endif
@@ -316,8 +315,7 @@ void DeviceResources::CreateDeviceResources()
     m_commandList->SetName(L"DeviceResources");
 
     // Create a fence for tracking GPU execution progress.
-    ThrowIfFailed(m_d3dDevice->CreateFence(m_fenceValues[m_backBufferIndex], D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
-    m_fenceValues[m_backBufferIndex]++;
+    ThrowIfFailed(m_d3dDevice->CreateFence(m_frameRing.BeginDevice(), D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
 
     m_fence->SetName(L"DeviceResources");
 
@@ -327,6 +325,8 @@ void DeviceResources::CreateDeviceResources()
         throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
     }
 
+    m_frameRing.GetFence().Bind(m_commandQueue.Get(), m_fence.Get(), m_fenceEvent.Get());
+
 #ifdef _GAMING_XBOX
     RegisterFrameEvents();
 #endif
@@ -340,19 +340,18 @@ void DeviceResources::CreateWindowSizeDependentResources()
         throw std::logic_error("Call SetWindow with a valid Win32 window handle");
     }
 
-    // Wait until all previous GPU work is complete.
-    WaitForGpu();
+    // Wait until all previous GPU work is complete, so every back buffer is free to release.
+    m_frameRing.BeginResize();
 
 #ifdef _GAMING_XBOX
     // Ensure we present a blank screen before cleaning up resources.
     ThrowIfFailed(m_commandQueue->PresentX(0, nullptr, nullptr));
 #endif
 
-    // Release resources that are tied to the swap chain and update fence values.
+    // Release resources that are tied to the swap chain.
     for (UINT n = 0; n < m_backBufferCount; n++)
     {
         m_renderTargets[n].Reset();
-        m_fenceValues[n] = m_fenceValues[m_backBufferIndex];
     }
 
     // Determine the render target size in pixels.
@@ -401,7 +400,7 @@ void DeviceResources::CreateWindowSizeDependentResources()
     }
 
     // Reset the index to the current back buffer.
-    m_backBufferIndex = 0;
+    m_frameRing.EndResize(0);
 
 #else // _GAMING_DESKTOP
 
@@ -495,7 +494,7 @@ void DeviceResources::CreateWindowSizeDependentResources()
     }
 
     // Reset the index to the current back buffer.
-    m_backBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
+    m_frameRing.EndResize(m_swapChain->GetCurrentBackBufferIndex());
 
 #endif
 
@@ -594,6 +593,8 @@ void DeviceResources::HandleDeviceLost()
     m_depthStencil.Reset();
     m_commandQueue.Reset();
     m_commandList.Reset();
+    m_frameRing.GetFence().Bind(nullptr, nullptr, nullptr);
+    m_frameRing.EndDevice();
     m_fence.Reset();
     m_rtvDescriptorHeap.Reset();
     m_dsvDescriptorHeap.Reset();
@@ -625,14 +626,14 @@ void DeviceResources::HandleDeviceLost()
 void DeviceResources::Prepare(D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState)
 {
     // Reset command list and allocator.
-    ThrowIfFailed(m_commandAllocators[m_backBufferIndex]->Reset());
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_backBufferIndex].Get(), nullptr));
+    ThrowIfFailed(m_commandAllocators[m_frameRing.GetBackBufferIndex()]->Reset());
+    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameRing.GetBackBufferIndex()].Get(), nullptr));
 
     if (beforeState != afterState)
     {
         // Transition the render target into the correct state to allow for drawing into it.
         const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            m_renderTargets[m_backBufferIndex].Get(),
+            m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(),
             beforeState, afterState);
         m_commandList->ResourceBarrier(1, &barrier);
     }
@@ -645,7 +646,7 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState)
     {
         // Transition the render target to the state that allows it to be presented to the display.
         const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            m_renderTargets[m_backBufferIndex].Get(),
+            m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(),
             beforeState, D3D12_RESOURCE_STATE_PRESENT);
         m_commandList->ResourceBarrier(1, &barrier);
     }
@@ -660,7 +661,7 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState)
     D3D12XBOX_PRESENT_PLANE_PARAMETERS planeParameters = {};
     planeParameters.Token = m_framePipelineToken;
     planeParameters.ResourceCount = 1;
-    planeParameters.ppResources = m_renderTargets[m_backBufferIndex].GetAddressOf();
+    planeParameters.ppResources = m_renderTargets[m_frameRing.GetBackBufferIndex()].GetAddressOf();
 
     ThrowIfFailed(
         m_commandQueue->PresentX(1, &planeParameters, nullptr)
@@ -669,9 +670,7 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState)
     // Xbox apps do not need to handle DXGI_ERROR_DEVICE_REMOVED or DXGI_ERROR_DEVICE_RESET.
 
     // Update the back buffer index.
-    const UINT64 currentFenceValue = m_fenceValues[m_backBufferIndex];
-    m_backBufferIndex = (m_backBufferIndex + 1) % m_backBufferCount;
-    m_fenceValues[m_backBufferIndex] = currentFenceValue;
+    m_frameRing.AdvanceUnsignaled();
 
 #else // _GAMING_DESKTOP
 
@@ -720,22 +719,7 @@ void DeviceResources::Resume()
 // Wait for pending GPU work to complete.
 void DeviceResources::WaitForGpu() noexcept
 {
-    if (m_commandQueue && m_fence && m_fenceEvent.IsValid())
-    {
-        // Schedule a Signal command in the GPU queue.
-        const UINT64 fenceValue = m_fenceValues[m_backBufferIndex];
-        if (SUCCEEDED(m_commandQueue->Signal(m_fence.Get(), fenceValue)))
-        {
-            // Wait until the Signal has been processed.
-            if (SUCCEEDED(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent.Get())))
-            {
-                std::ignore = WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
-
-                // Increment the fence value for the current frame.
-                m_fenceValues[m_backBufferIndex]++;
-            }
-        }
-    }
+    m_frameRing.WaitForGpu();
 }
 
 #ifdef _GAMING_XBOX
@@ -786,22 +770,8 @@ void DeviceResources::RegisterFrameEvents()
 // Prepare to render the next frame.
 void DeviceResources::MoveToNextFrame()
 {
-    // Schedule a Signal command in the queue.
-    const UINT64 currentFenceValue = m_fenceValues[m_backBufferIndex];
-    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), currentFenceValue));
-
-    // Update the back buffer index.
-    m_backBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
-
-    // If the next frame is not ready to be rendered yet, wait until it is ready.
-    if (m_fence->GetCompletedValue() < m_fenceValues[m_backBufferIndex])
-    {
-        ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_backBufferIndex], m_fenceEvent.Get()));
-        std::ignore = WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
-    }
-
-    // Set the fence value for the next frame.
-    m_fenceValues[m_backBufferIndex] = currentFenceValue + 1;
+    // Signal the frame just submitted, then wait until the next back buffer is free.
+    m_frameRing.MoveToNextFrame(m_swapChain->GetCurrentBackBufferIndex());
 }
 
 // This method acquires the first available hardware adapter that supports Direct3D 12.
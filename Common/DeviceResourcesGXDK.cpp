@@ -27,8 +27,7 @@ DeviceResources::DeviceResources(
     DXGI_FORMAT depthBufferFormat,
     UINT backBufferCount,
     unsigned int flags) noexcept(false) :
-        m_backBufferIndex(0),
-        m_fenceValue(0),
+        m_frameRing(backBufferCount),
         m_framePipelineToken{},
         m_rtvDescriptorSize(0),
         m_screenViewport{},
@@ -166,8 +165,7 @@ void DeviceResources::CreateDeviceResources()
     m_commandList->SetName(L"DeviceResources");
 
     // Create a fence for tracking GPU execution progress.
-    ThrowIfFailed(m_d3dDevice->CreateFence(m_fenceValue, D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
-    m_fenceValue++;
+    ThrowIfFailed(m_d3dDevice->CreateFence(m_frameRing.BeginDevice(), D3D12_FENCE_FLAG_NONE, IID_GRAPHICS_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
 
     m_fence->SetName(L"DeviceResources");
 
@@ -177,6 +175,8 @@ void DeviceResources::CreateDeviceResources()
         throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
     }
 
+    m_frameRing.GetFence().Bind(m_commandQueue.Get(), m_fence.Get(), m_fenceEvent.Get());
+
     if (m_options & (c_Enable4K_UHD | c_EnableQHD))
     {
         switch (XSystemGetDeviceType())
@@ -225,13 +225,13 @@ void DeviceResources::CreateWindowSizeDependentResources()
         throw std::logic_error("Call SetWindow with a valid Win32 window handle");
     }
 
-    // Wait until all previous GPU work is complete.
-    WaitForGpu();
+    // Wait until all previous GPU work is complete, so every back buffer is free to release.
+    m_frameRing.BeginResize();
 
     // Ensure we present a blank screen before cleaning up resources.
     ThrowIfFailed(m_commandQueue->PresentX(0, nullptr, nullptr));
 
-    // Release resources that are tied to the swap chain and update fence values.
+    // Release resources that are tied to the swap chain.
     for (UINT n = 0; n < m_backBufferCount; n++)
     {
         m_renderTargets[n].Reset();
@@ -311,7 +311,7 @@ void DeviceResources::CreateWindowSizeDependentResources()
     }
 
     // Reset the index to the current back buffer.
-    m_backBufferIndex = 0;
+    m_frameRing.EndResize(0);
 
     if (m_depthBufferFormat != DXGI_FORMAT_UNKNOWN)
     {
@@ -364,8 +364,8 @@ void DeviceResources::CreateWindowSizeDependentResources()
 void DeviceResources::Prepare(D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState)
 {
     // Reset command list and allocator.
-    ThrowIfFailed(m_commandAllocators[m_backBufferIndex]->Reset());
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_backBufferIndex].Get(), nullptr));
+    ThrowIfFailed(m_commandAllocators[m_frameRing.GetBackBufferIndex()]->Reset());
+    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameRing.GetBackBufferIndex()].Get(), nullptr));
 
     if (beforeState != afterState)
     {
@@ -374,9 +374,9 @@ void DeviceResources::Prepare(D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_
         {
             const D3D12_RESOURCE_BARRIER barriers[2] =
             {
-                CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_backBufferIndex].Get(),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(),
                     beforeState, afterState),
-                CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargetsGameDVR[m_backBufferIndex].Get(),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargetsGameDVR[m_frameRing.GetBackBufferIndex()].Get(),
                     beforeState, afterState),
             };
             m_commandList->ResourceBarrier(static_cast<UINT>(std::size(barriers)), barriers);
@@ -384,7 +384,7 @@ void DeviceResources::Prepare(D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_
         else
         {
             const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-                m_renderTargets[m_backBufferIndex].Get(),
+                m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(),
                 beforeState, afterState);
             m_commandList->ResourceBarrier(1, &barrier);
         }
@@ -401,15 +401,15 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState, _In_opt_ const
         {
             const D3D12_RESOURCE_BARRIER barriers[2] =
             {
-                CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_backBufferIndex].Get(), beforeState, D3D12_RESOURCE_STATE_PRESENT),
-                CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargetsGameDVR[m_backBufferIndex].Get(), beforeState, D3D12_RESOURCE_STATE_PRESENT),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(), beforeState, D3D12_RESOURCE_STATE_PRESENT),
+                CD3DX12_RESOURCE_BARRIER::Transition(m_renderTargetsGameDVR[m_frameRing.GetBackBufferIndex()].Get(), beforeState, D3D12_RESOURCE_STATE_PRESENT),
             };
             m_commandList->ResourceBarrier(static_cast<UINT>(std::size(barriers)), barriers);
         }
         else
         {
             const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-                m_renderTargets[m_backBufferIndex].Get(),
+                m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(),
                 beforeState, D3D12_RESOURCE_STATE_PRESENT);
             m_commandList->ResourceBarrier(1, &barrier);
         }
@@ -423,13 +423,13 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState, _In_opt_ const
     D3D12XBOX_PRESENT_PLANE_PARAMETERS planeParameters[2] = {};
     planeParameters[0].Token = planeParameters[1].Token = m_framePipelineToken;
     planeParameters[0].ResourceCount = planeParameters[1].ResourceCount = 1;
-    planeParameters[0].ppResources = m_renderTargets[m_backBufferIndex].GetAddressOf();
+    planeParameters[0].ppResources = m_renderTargets[m_frameRing.GetBackBufferIndex()].GetAddressOf();
 
     if (m_options & c_EnableHDR)
     {
         planeParameters[0].pSrcViewRects = planeParameters[1].pSrcViewRects = &m_outputSize;
         planeParameters[0].ColorSpace = DXGI_COLOR_SPACE_RGB_FULL_G2084_NONE_P2020;
-        planeParameters[1].ppResources = m_renderTargetsGameDVR[m_backBufferIndex].GetAddressOf();
+        planeParameters[1].ppResources = m_renderTargetsGameDVR[m_frameRing.GetBackBufferIndex()].GetAddressOf();
         planeParameters[1].ColorSpace = DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709;
 
         ThrowIfFailed(
@@ -446,7 +446,7 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState, _In_opt_ const
     // Xbox apps do not need to handle DXGI_ERROR_DEVICE_REMOVED or DXGI_ERROR_DEVICE_RESET.
 
     // Update the back buffer index.
-    m_backBufferIndex = (m_backBufferIndex + 1) % m_backBufferCount;
+    m_frameRing.AdvanceUnsignaled();
 }
 
 // Handle GPU suspend/resume
@@ -465,22 +465,7 @@ void DeviceResources::Resume()
 // Wait for pending GPU work to complete.
 void DeviceResources::WaitForGpu() noexcept
 {
-    if (m_commandQueue && m_fence && m_fenceEvent.IsValid())
-    {
-        // Schedule a Signal command in the GPU queue.
-        const UINT64 fenceValue = m_fenceValue;
-        if (SUCCEEDED(m_commandQueue->Signal(m_fence.Get(), fenceValue)))
-        {
-            // Wait until the Signal has been processed.
-            if (SUCCEEDED(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent.Get())))
-            {
-                std::ignore = WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
-
-                // Increment the fence value for the current frame.
-                m_fenceValue++;
-            }
-        }
-    }
+    m_frameRing.WaitForGpu();
 }
 
 // For PresentX rendering, we should wait for the origin event just before processing input.
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include "DeviceResourcesCoreD3D12.h"
+
 namespace DX
 {
     // Controls all the DirectX device resources.
@@ -59,16 +61,16 @@ namespace DX
         auto                        GetD3DDevice() const noexcept          { return m_d3dDevice.Get(); }
         HWND                        GetWindow() const noexcept             { return m_window; }
         D3D_FEATURE_LEVEL           GetDeviceFeatureLevel() const noexcept { return m_d3dFeatureLevel; }
-        ID3D12Resource*             GetRenderTarget() const noexcept       { return m_renderTargets[m_backBufferIndex].Get(); }
+        ID3D12Resource*             GetRenderTarget() const noexcept       { return m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(); }
         ID3D12Resource*             GetDepthStencil() const noexcept       { return m_depthStencil.Get(); }
         ID3D12CommandQueue*         GetCommandQueue() const noexcept       { return m_commandQueue.Get(); }
-        ID3D12CommandAllocator*     GetCommandAllocator() const noexcept   { return m_commandAllocators[m_backBufferIndex].Get(); }
+        ID3D12CommandAllocator*     GetCommandAllocator() const noexcept   { return m_commandAllocators[m_frameRing.GetBackBufferIndex()].Get(); }
         auto                        GetCommandList() const noexcept        { return m_commandList.Get(); }
         DXGI_FORMAT                 GetBackBufferFormat() const noexcept   { return m_backBufferFormat; }
         DXGI_FORMAT                 GetDepthBufferFormat() const noexcept  { return m_depthBufferFormat; }
         D3D12_VIEWPORT              GetScreenViewport() const noexcept     { return m_screenViewport; }
         D3D12_RECT                  GetScissorRect() const noexcept        { return m_scissorRect; }
-        UINT                        GetCurrentFrameIndex() const noexcept  { return m_backBufferIndex; }
+        UINT                        GetCurrentFrameIndex() const noexcept  { return m_frameRing.GetBackBufferIndex(); }
         UINT                        GetBackBufferCount() const noexcept    { return m_backBufferCount; }
         unsigned int                GetDeviceOptions() const noexcept      { return m_options; }
 
@@ -76,7 +78,7 @@ namespace DX
         {
             return CD3DX12_CPU_DESCRIPTOR_HANDLE(
                 m_rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-                static_cast<INT>(m_backBufferIndex), m_rtvDescriptorSize);
+                static_cast<INT>(m_frameRing.GetBackBufferIndex()), m_rtvDescriptorSize);
         }
         CD3DX12_CPU_DESCRIPTOR_HANDLE GetDepthStencilView() const noexcept
         {
@@ -84,14 +86,14 @@ namespace DX
         }
 
         // Direct3D HDR Game DVR support for Xbox One.
-        ID3D12Resource* GetGameDVRRenderTarget() const noexcept { return m_renderTargetsGameDVR[m_backBufferIndex].Get(); }
+        ID3D12Resource* GetGameDVRRenderTarget() const noexcept { return m_renderTargetsGameDVR[m_frameRing.GetBackBufferIndex()].Get(); }
         DXGI_FORMAT GetGameDVRFormat() const noexcept { return m_gameDVRFormat; }
 
         CD3DX12_CPU_DESCRIPTOR_HANDLE GetGameDVRRenderTargetView() const noexcept
         {
             return CD3DX12_CPU_DESCRIPTOR_HANDLE(
                 m_rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-                static_cast<INT>(m_backBufferCount + m_backBufferIndex), m_rtvDescriptorSize);
+                static_cast<INT>(m_backBufferCount + m_frameRing.GetBackBufferIndex()), m_rtvDescriptorSize);
         }
 
     private:
@@ -99,8 +101,6 @@ namespace DX
 
         static constexpr size_t MAX_BACK_BUFFER_COUNT = 3;
 
-        UINT                                                m_backBufferIndex;
-
         // Direct3D objects.
 #ifdef _GAMING_XBOX_SCARLETT
         Microsoft::WRL::ComPtr<ID3D12Device8>               m_d3dDevice;
@@ -118,7 +118,7 @@ namespace DX
 
         // Presentation fence objects.
         Microsoft::WRL::ComPtr<ID3D12Fence>                 m_fence;
-        UINT64                                              m_fenceValue;
+        D3D12FrameRing                                      m_frameRing;
         Microsoft::WRL::Wrappers::Event                     m_fenceEvent;
         D3D12XBOX_FRAME_PIPELINE_TOKEN                      m_framePipelineToken;
 
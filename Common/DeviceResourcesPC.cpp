@@ -40,6 +40,62 @@ namespace
     }
 }
 
+SwapChainPacingBackend::SwapChainPacingBackend() noexcept :
+    m_frequency(1),
+    m_swapChain(nullptr),
+    m_frameLatencyWaitable(nullptr),
+    m_fence(nullptr),
+    m_fenceEvent(nullptr)
+{
+    LARGE_INTEGER frequency;
+    if (QueryPerformanceFrequency(&frequency))
+    {
+        m_frequency = static_cast<uint64_t>(frequency.QuadPart);
+    }
+}
+
+void SwapChainPacingBackend::Bind(IDXGISwapChain2* swapChain, HANDLE frameLatencyWaitable, ID3D12Fence* fence, HANDLE fenceEvent) noexcept
+{
+    m_swapChain = swapChain;
+    m_frameLatencyWaitable = frameLatencyWaitable;
+    m_fence = fence;
+    m_fenceEvent = fenceEvent;
+}
+
+uint64_t SwapChainPacingBackend::GetTicks() const noexcept
+{
+    LARGE_INTEGER counter;
+    std::ignore = QueryPerformanceCounter(&counter);
+    return static_cast<uint64_t>(counter.QuadPart);
+}
+
+void SwapChainPacingBackend::SetMaximumFrameLatency(uint32_t frames)
+{
+    if (m_swapChain)
+    {
+        ThrowIfFailed(m_swapChain->SetMaximumFrameLatency(frames));
+    }
+}
+
+bool SwapChainPacingBackend::WaitForFrameLatency(uint32_t timeoutMs) noexcept
+{
+    if (!m_frameLatencyWaitable)
+        return true;
+
+    return WaitForSingleObjectEx(m_frameLatencyWaitable, timeoutMs, FALSE) == WAIT_OBJECT_0;
+}
+
+uint64_t SwapChainPacingBackend::GetCompletedFenceValue() const noexcept
+{
+    return m_fence ? m_fence->GetCompletedValue() : UINT64_MAX;
+}
+
+void SwapChainPacingBackend::WaitForFenceValue(uint64_t value)
+{
+    ThrowIfFailed(m_fence->SetEventOnCompletion(value, m_fenceEvent));
+    std::ignore = WaitForSingleObjectEx(m_fenceEvent, INFINITE, FALSE);
+}
+
 bool DeviceResources::s_debugForceWarp = false;
 bool DeviceResources::s_debugPreferMinPower = false;
 int DeviceResources::s_debugAdapterOrdinal = -1;
@@ -51,8 +107,7 @@ DeviceResources::DeviceResources(
     UINT backBufferCount,
     D3D_FEATURE_LEVEL minFeatureLevel,
     unsigned int flags) noexcept(false) :
-        m_backBufferIndex(0),
-        m_fenceValues{},
+        m_frameRing(backBufferCount),
         m_rtvDescriptorSize(0),
         m_screenViewport{},
         m_scissorRect{},
@@ -289,8 +344,7 @@ void DeviceResources::CreateDeviceResources()
     m_commandList->SetName(L"DeviceResources");
 
     // Create a fence for tracking GPU execution progress.
-    ThrowIfFailed(m_d3dDevice->CreateFence(m_fenceValues[m_backBufferIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
-    m_fenceValues[m_backBufferIndex]++;
+    ThrowIfFailed(m_d3dDevice->CreateFence(m_frameRing.BeginDevice(), D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_fence.ReleaseAndGetAddressOf())));
 
     m_fence->SetName(L"DeviceResources");
 
@@ -300,6 +354,8 @@ void DeviceResources::CreateDeviceResources()
         throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "CreateEventEx");
     }
 
+    m_frameRing.GetFence().Bind(m_commandQueue.Get(), m_fence.Get(), m_fenceEvent.Get());
+
     // Some additional caps information
 #ifdef _DEBUG
     const char* featLevel = "Unknown";
@@ -392,14 +448,13 @@ void DeviceResources::CreateWindowSizeDependentResources()
         throw std::logic_error("Call SetWindow with a valid Win32 window handle");
     }
 
-    // Wait until all previous GPU work is complete.
-    WaitForGpu();
+    // Wait until all previous GPU work is complete, so every back buffer is free to release.
+    m_frameRing.BeginResize();
 
-    // Release resources that are tied to the swap chain and update fence values.
+    // Release resources that are tied to the swap chain.
     for (UINT n = 0; n < m_backBufferCount; n++)
     {
         m_renderTargets[n].Reset();
-        m_fenceValues[n] = m_fenceValues[m_backBufferIndex];
     }
 
     // Determine the render target size in pixels.
@@ -407,6 +462,11 @@ void DeviceResources::CreateWindowSizeDependentResources()
     const UINT backBufferHeight = std::max<UINT>(static_cast<UINT>(m_outputSize.bottom - m_outputSize.top), 1u);
     const DXGI_FORMAT backBufferFormat = NoSRGB(m_backBufferFormat);
 
+    // The frame latency waitable lets Prepare block before a frame starts rather than after it is queued.
+    const bool latencyWaitable = (m_options & c_FrameLatencyWaitable) != 0;
+    const UINT swapChainFlags = (latencyWaitable ? DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT : 0u)
+        | ((m_options & c_AllowTearing) ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0u);
+
     // If the swap chain already exists, resize it, otherwise create one.
     if (m_swapChain)
     {
@@ -416,7 +476,7 @@ void DeviceResources::CreateWindowSizeDependentResources()
             backBufferWidth,
             backBufferHeight,
             backBufferFormat,
-            (m_options & c_AllowTearing) ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0u
+            swapChainFlags
             );
 
         if (hr == DXGI_ERROR_DEVICE_REMOVED || hr == DXGI_ERROR_DEVICE_RESET)
@@ -453,7 +513,7 @@ void DeviceResources::CreateWindowSizeDependentResources()
         swapChainDesc.Scaling = DXGI_SCALING_STRETCH;
         swapChainDesc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_DISCARD;
         swapChainDesc.AlphaMode = DXGI_ALPHA_MODE_IGNORE;
-        swapChainDesc.Flags = (m_options & c_AllowTearing) ? DXGI_SWAP_CHAIN_FLAG_ALLOW_TEARING : 0u;
+        swapChainDesc.Flags = swapChainFlags;
 
         DXGI_SWAP_CHAIN_FULLSCREEN_DESC fsSwapChainDesc = {};
         fsSwapChainDesc.Windowed = TRUE;
@@ -471,10 +531,25 @@ void DeviceResources::CreateWindowSizeDependentResources()
 
         ThrowIfFailed(swapChain.As(&m_swapChain));
 
+        if (latencyWaitable)
+        {
+            m_frameLatencyWaitable.Attach(m_swapChain->GetFrameLatencyWaitableObject());
+            if (!m_frameLatencyWaitable.IsValid())
+            {
+                throw std::runtime_error("GetFrameLatencyWaitableObject");
+            }
+        }
+
         // This class does not support exclusive full-screen mode and prevents DXGI from responding to the ALT+ENTER shortcut
         ThrowIfFailed(m_dxgiFactory->MakeWindowAssociation(m_window, DXGI_MWA_NO_ALT_ENTER));
     }
 
+    // The GPU was drained above, so pacing restarts from an idle queue. Without the waitable the
+    // pacer only records stalls; the swap chain keeps the DXGI default frame latency.
+    m_framePacer.GetBackend().Bind(latencyWaitable ? m_swapChain.Get() : nullptr,
+        m_frameLatencyWaitable.Get(), m_fence.Get(), m_fenceEvent.Get());
+    m_framePacer.Reset();
+
     // Handle color space settings for HDR
     UpdateColorSpace();
 
@@ -506,7 +581,7 @@ void DeviceResources::CreateWindowSizeDependentResources()
     }
 
     // Reset the index to the current back buffer.
-    m_backBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
+    m_frameRing.EndResize(m_swapChain->GetCurrentBackBufferIndex());
 
     if (m_depthBufferFormat != DXGI_FORMAT_UNKNOWN)
     {
@@ -612,6 +687,10 @@ void DeviceResources::HandleDeviceLost()
     m_depthStencil.Reset();
     m_commandQueue.Reset();
     m_commandList.Reset();
+    m_framePacer.GetBackend().Bind(nullptr, nullptr, nullptr, nullptr);
+    m_frameLatencyWaitable.Attach(nullptr);
+    m_frameRing.GetFence().Bind(nullptr, nullptr, nullptr);
+    m_frameRing.EndDevice();
     m_fence.Reset();
     m_rtvDescriptorHeap.Reset();
     m_dsvDescriptorHeap.Reset();
@@ -641,15 +720,18 @@ void DeviceResources::HandleDeviceLost()
 // Prepare the command list and render target for rendering.
 void DeviceResources::Prepare(D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState)
 {
+    // Wait for the swap chain to accept another frame before any work for it is recorded.
+    std::ignore = m_framePacer.BeginFrame();
+
     // Reset command list and allocator.
-    ThrowIfFailed(m_commandAllocators[m_backBufferIndex]->Reset());
-    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_backBufferIndex].Get(), nullptr));
+    ThrowIfFailed(m_commandAllocators[m_frameRing.GetBackBufferIndex()]->Reset());
+    ThrowIfFailed(m_commandList->Reset(m_commandAllocators[m_frameRing.GetBackBufferIndex()].Get(), nullptr));
 
     if (beforeState != afterState)
     {
         // Transition the render target into the correct state to allow for drawing into it.
         const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            m_renderTargets[m_backBufferIndex].Get(),
+            m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(),
             beforeState, afterState);
         m_commandList->ResourceBarrier(1, &barrier);
     }
@@ -662,7 +744,7 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState)
     {
         // Transition the render target to the state that allows it to be presented to the display.
         const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-            m_renderTargets[m_backBufferIndex].Get(),
+            m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(),
             beforeState, D3D12_RESOURCE_STATE_PRESENT);
         m_commandList->ResourceBarrier(1, &barrier);
     }
@@ -713,43 +795,18 @@ void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState)
 // Wait for pending GPU work to complete.
 void DeviceResources::WaitForGpu() noexcept
 {
-    if (m_commandQueue && m_fence && m_fenceEvent.IsValid())
-    {
-        // Schedule a Signal command in the GPU queue.
-        const UINT64 fenceValue = m_fenceValues[m_backBufferIndex];
-        if (SUCCEEDED(m_commandQueue->Signal(m_fence.Get(), fenceValue)))
-        {
-            // Wait until the Signal has been processed.
-            if (SUCCEEDED(m_fence->SetEventOnCompletion(fenceValue, m_fenceEvent.Get())))
-            {
-                std::ignore = WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
-
-                // Increment the fence value for the current frame.
-                m_fenceValues[m_backBufferIndex]++;
-            }
-        }
-    }
+    m_frameRing.WaitForGpu();
 }
 
 // Prepare to render the next frame.
 void DeviceResources::MoveToNextFrame()
 {
     // Schedule a Signal command in the queue.
-    const UINT64 currentFenceValue = m_fenceValues[m_backBufferIndex];
-    ThrowIfFailed(m_commandQueue->Signal(m_fence.Get(), currentFenceValue));
-
-    // Update the back buffer index.
-    m_backBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
-
-    // If the next frame is not ready to be rendered yet, wait until it is ready.
-    if (m_fence->GetCompletedValue() < m_fenceValues[m_backBufferIndex])
-    {
-        ThrowIfFailed(m_fence->SetEventOnCompletion(m_fenceValues[m_backBufferIndex], m_fenceEvent.Get()));
-        std::ignore = WaitForSingleObjectEx(m_fenceEvent.Get(), INFINITE, FALSE);
-    }
+    const UINT64 currentFenceValue = m_frameRing.Signal();
+    m_framePacer.EndFrame(currentFenceValue);
 
-    // Set the fence value for the next frame.
-    m_fenceValues[m_backBufferIndex] = currentFenceValue + 1;
+    // Update the back buffer index, and if the next frame is not ready to be rendered yet, wait until it is ready.
+    std::ignore = m_framePacer.WaitForFence(m_frameRing.Advance(m_swapChain->GetCurrentBackBufferIndex()));
 }
 
 // This method acquires the first available hardware adapter that supports Direct3D 12.
@@ -4,8 +4,35 @@
 
 #pragma once
 
+#include "DeviceResourcesCoreD3D12.h"
+#include "FramePacing.h"
+
 namespace DX
 {
+    // FramePacer backend for a DXGI swap chain created with DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT.
+    // Holds non-owning references; DeviceResources rebinds it whenever the swap chain or fence is recreated.
+    class SwapChainPacingBackend
+    {
+    public:
+        SwapChainPacingBackend() noexcept;
+
+        void Bind(IDXGISwapChain2* swapChain, HANDLE frameLatencyWaitable, ID3D12Fence* fence, HANDLE fenceEvent) noexcept;
+
+        uint64_t GetTicks() const noexcept;
+        uint64_t GetTickFrequency() const noexcept { return m_frequency; }
+        void SetMaximumFrameLatency(uint32_t frames);
+        bool WaitForFrameLatency(uint32_t timeoutMs) noexcept;
+        uint64_t GetCompletedFenceValue() const noexcept;
+        void WaitForFenceValue(uint64_t value);
+
+    private:
+        uint64_t            m_frequency;
+        IDXGISwapChain2*    m_swapChain;
+        HANDLE              m_frameLatencyWaitable;
+        ID3D12Fence*        m_fence;
+        HANDLE              m_fenceEvent;
+    };
+
     // Provides an interface for an application that owns DeviceResources to be notified of the device being lost or created.
     interface IDeviceNotify
     {
@@ -23,6 +50,7 @@ namespace DX
         static constexpr unsigned int c_AllowTearing = 0x1;
         static constexpr unsigned int c_EnableHDR    = 0x2;
         static constexpr unsigned int c_ReverseDepth = 0x4;
+        static constexpr unsigned int c_FrameLatencyWaitable = 0x8;   // Prepare waits on the swap chain; see FramePacing.h
 
         DeviceResources(DXGI_FORMAT backBufferFormat = DXGI_FORMAT_B8G8R8A8_UNORM,
                         DXGI_FORMAT depthBufferFormat = DXGI_FORMAT_D32_FLOAT,
@@ -48,6 +76,7 @@ namespace DX
         void Present(D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET);
         void WaitForGpu() noexcept;
         void UpdateColorSpace();
+        void SetMaximumFrameLatency(UINT frames) { m_framePacer.SetMaximumFrameLatency(frames); } // c_FrameLatencyWaitable only
         void Suspend() noexcept {}
         void Resume() noexcept {}
 
@@ -60,19 +89,21 @@ namespace DX
         auto                        GetDXGIFactory() const noexcept        { return m_dxgiFactory.Get(); }
         HWND                        GetWindow() const noexcept             { return m_window; }
         D3D_FEATURE_LEVEL           GetDeviceFeatureLevel() const noexcept { return m_d3dFeatureLevel; }
-        ID3D12Resource*             GetRenderTarget() const noexcept       { return m_renderTargets[m_backBufferIndex].Get(); }
+        ID3D12Resource*             GetRenderTarget() const noexcept       { return m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(); }
         ID3D12Resource*             GetDepthStencil() const noexcept       { return m_depthStencil.Get(); }
         ID3D12CommandQueue*         GetCommandQueue() const noexcept       { return m_commandQueue.Get(); }
-        ID3D12CommandAllocator*     GetCommandAllocator() const noexcept   { return m_commandAllocators[m_backBufferIndex].Get(); }
+        ID3D12CommandAllocator*     GetCommandAllocator() const noexcept   { return m_commandAllocators[m_frameRing.GetBackBufferIndex()].Get(); }
         auto                        GetCommandList() const noexcept        { return m_commandList.Get(); }
         DXGI_FORMAT                 GetBackBufferFormat() const noexcept   { return m_backBufferFormat; }
         DXGI_FORMAT                 GetDepthBufferFormat() const noexcept  { return m_depthBufferFormat; }
         D3D12_VIEWPORT              GetScreenViewport() const noexcept     { return m_screenViewport; }
         D3D12_RECT                  GetScissorRect() const noexcept        { return m_scissorRect; }
-        UINT                        GetCurrentFrameIndex() const noexcept  { return m_backBufferIndex; }
+        UINT                        GetCurrentFrameIndex() const noexcept  { return m_frameRing.GetBackBufferIndex(); }
         UINT                        GetBackBufferCount() const noexcept    { return m_backBufferCount; }
         DXGI_COLOR_SPACE_TYPE       GetColorSpace() const noexcept         { return m_colorSpace; }
         unsigned int                GetDeviceOptions() const noexcept      { return m_options; }
+        UINT                        GetMaximumFrameLatency() const noexcept { return m_framePacer.GetMaximumFrameLatency(); }
+        auto&                       GetFramePacing() const noexcept        { return m_framePacer; }
 
         CD3DX12_CPU_DESCRIPTOR_HANDLE GetRenderTargetView() const noexcept
         {
@@ -83,7 +114,7 @@ namespace DX
             auto cpuHandle = m_rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart();
         #endif
 
-            return CD3DX12_CPU_DESCRIPTOR_HANDLE(cpuHandle, static_cast<INT>(m_backBufferIndex), m_rtvDescriptorSize);
+            return CD3DX12_CPU_DESCRIPTOR_HANDLE(cpuHandle, static_cast<INT>(m_frameRing.GetBackBufferIndex()), m_rtvDescriptorSize);
         }
         CD3DX12_CPU_DESCRIPTOR_HANDLE GetDepthStencilView() const noexcept
         {
@@ -118,8 +149,6 @@ namespace DX
 
         static constexpr size_t MAX_BACK_BUFFER_COUNT = 3;
 
-        UINT                                                m_backBufferIndex;
-
         // Direct3D objects.
         Microsoft::WRL::ComPtr<ID3D12Device>                m_d3dDevice;
         Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>   m_commandList;
@@ -134,9 +163,13 @@ namespace DX
 
         // Presentation fence objects.
         Microsoft::WRL::ComPtr<ID3D12Fence>                 m_fence;
-        UINT64                                              m_fenceValues[MAX_BACK_BUFFER_COUNT];
+        D3D12FrameRing                                      m_frameRing;
         Microsoft::WRL::Wrappers::Event                     m_fenceEvent;
 
+        // Frame latency pacing.
+        Microsoft::WRL::Wrappers::Event                     m_frameLatencyWaitable;
+        FramePacer<SwapChainPacingBackend>                  m_framePacer;
+
         // Direct3D rendering objects.
         Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>        m_rtvDescriptorHeap;
         Microsoft::WRL::ComPtr<ID3D12DescriptorHeap>        m_dsvDescriptorHeap;
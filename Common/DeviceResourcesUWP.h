@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include "DeviceResourcesCoreD3D12.h"
+
 namespace DX
 {
     // Provides an interface for an application that owns DeviceResources to be notified of the device being lost or created.
@@ -63,16 +65,16 @@ namespace DX
         auto                        GetSwapChain() const noexcept              { return m_swapChain.Get(); }
         auto                        GetDXGIFactory() const noexcept            { return m_dxgiFactory.Get(); }
         D3D_FEATURE_LEVEL           GetDeviceFeatureLevel() const noexcept     { return m_d3dFeatureLevel; }
-        ID3D12Resource*             GetRenderTarget() const noexcept           { return m_renderTargets[m_backBufferIndex].Get(); }
+        ID3D12Resource*             GetRenderTarget() const noexcept           { return m_renderTargets[m_frameRing.GetBackBufferIndex()].Get(); }
         ID3D12Resource*             GetDepthStencil() const noexcept           { return m_depthStencil.Get(); }
         ID3D12CommandQueue*         GetCommandQueue() const noexcept           { return m_commandQueue.Get(); }
-        ID3D12CommandAllocator*     GetCommandAllocator() const noexcept       { return m_commandAllocators[m_backBufferIndex].Get(); }
+        ID3D12CommandAllocator*     GetCommandAllocator() const noexcept       { return m_commandAllocators[m_frameRing.GetBackBufferIndex()].Get(); }
         auto                        GetCommandList() const noexcept            { return m_commandList.Get(); }
         DXGI_FORMAT                 GetBackBufferFormat() const noexcept       { return m_backBufferFormat; }
         DXGI_FORMAT                 GetDepthBufferFormat() const noexcept      { return m_depthBufferFormat; }
         D3D12_VIEWPORT              GetScreenViewport() const noexcept         { return m_screenViewport; }
         D3D12_RECT                  GetScissorRect() const noexcept            { return m_scissorRect; }
-        UINT                        GetCurrentFrameIndex() const noexcept      { return m_backBufferIndex; }
+        UINT                        GetCurrentFrameIndex() const noexcept      { return m_frameRing.GetBackBufferIndex(); }
         UINT                        GetBackBufferCount() const noexcept        { return m_backBufferCount; }
         DirectX::XMFLOAT4X4         GetOrientationTransform3D() const noexcept { return m_orientationTransform3D; }
         DXGI_COLOR_SPACE_TYPE       GetColorSpace() const noexcept             { return m_colorSpace; }
@@ -82,7 +84,7 @@ namespace DX
         {
             return CD3DX12_CPU_DESCRIPTOR_HANDLE(
                 m_rtvDescriptorHeap->GetCPUDescriptorHandleForHeapStart(),
-                static_cast<INT>(m_backBufferIndex), m_rtvDescriptorSize);
+                static_cast<INT>(m_frameRing.GetBackBufferIndex()), m_rtvDescriptorSize);
         }
         CD3DX12_CPU_DESCRIPTOR_HANDLE GetDepthStencilView() const noexcept
         {
@@ -95,8 +97,6 @@ namespace DX
 
         static constexpr size_t MAX_BACK_BUFFER_COUNT = 3;
 
-        UINT                                                m_backBufferIndex;
-
         // Direct3D objects.
         Microsoft::WRL::ComPtr<ID3D12Device>                m_d3dDevice;
         Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>   m_commandList;
@@ -111,7 +111,7 @@ namespace DX
 
         // Presentation fence objects.
         Microsoft::WRL::ComPtr<ID3D12Fence>                 m_fence;
-        UINT64                                              m_fenceValues[MAX_BACK_BUFFER_COUNT];
+        D3D12FrameRing                                      m_frameRing;
         Microsoft::WRL::Wrappers::Event                     m_fenceEvent;
 
         // Direct3D rendering objects.
@@ -0,0 +1,307 @@
+//--------------------------------------------------------------------------------------
+// File: FramePacing.h
+//
+// Frame-latency pacing and CPU/GPU stall instrumentation for DeviceResources
+//
+// BeginFrame blocks on the swap chain's frame latency waitable object before any
+// input is read or any commands are recorded, so the CPU never runs more than the
+// maximum frame latency ahead of the display. Each frame records how long the CPU
+// was blocked on the waitable and on the back buffer fence, the present-to-present
+// interval, and the time from the start of the frame to the GPU finishing it.
+//
+// The backend supplies the clock, the waitable, and the fence:
+//
+//   uint64_t GetTicks();                                // monotonic
+//   uint64_t GetTickFrequency();                        // ticks per second, read once
+//   void     SetMaximumFrameLatency(uint32_t frames);
+//   bool     WaitForFrameLatency(uint32_t timeoutMs);   // false on timeout; true if there is no waitable
+//   uint64_t GetCompletedFenceValue();
+//   void     WaitForFenceValue(uint64_t value);
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    struct FramePacingSample
+    {
+        uint64_t    frame;
+        double      latencyWaitMs;      // blocked on the frame latency waitable before this frame started
+        double      fenceWaitMs;        // blocked on the GPU fence for the back buffer this frame reuses
+        double      presentIntervalMs;  // since the previous present; zero after a Reset
+        double      gpuLatencyMs;       // start of the frame to the GPU finishing it; zero until observed
+        bool        latencyTimeout;     // the waitable wait gave up
+
+        double GetBlockedMs() const noexcept { return latencyWaitMs + fenceWaitMs; }
+    };
+
+    struct FramePacingSummary
+    {
+        size_t      frames;             // samples in the window
+        double      avgLatencyWaitMs;
+        double      maxLatencyWaitMs;
+        double      avgFenceWaitMs;
+        double      maxFenceWaitMs;
+        double      avgPresentIntervalMs;
+        double      minPresentIntervalMs;
+        double      maxPresentIntervalMs;
+        size_t      gpuLatencyFrames;   // samples whose GPU completion has been observed
+        double      avgGpuLatencyMs;
+        double      maxGpuLatencyMs;
+        uint64_t    latencyTimeouts;    // since construction
+    };
+
+    template<typename TBackend>
+    class FramePacer
+    {
+    public:
+        static constexpr uint32_t c_MaxFrameLatency = 16;        // DXGI limit for SetMaximumFrameLatency
+        static constexpr uint32_t c_DefaultWaitTimeout = 1000;
+
+        explicit FramePacer(TBackend backend = TBackend(), uint32_t maxFrameLatency = 1, size_t capacity = 600) :
+            m_backend(std::move(backend)),
+            m_tickFrequency(m_backend.GetTickFrequency()),
+            m_maxFrameLatency(ClampFrameLatency(maxFrameLatency)),
+            m_waitTimeout(c_DefaultWaitTimeout),
+            m_samples(capacity),
+            m_count(0),
+            m_frame(0),
+            m_current{},
+            m_frameStart(0),
+            m_lastPresent(0),
+            m_hasLastPresent(false),
+            m_latencyTimeouts(0)
+        {
+            assert(capacity > 0);
+        }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+        const TBackend& GetBackend() const noexcept { return m_backend; }
+
+        // Clamped to [1, c_MaxFrameLatency]. Lower values trade GPU overlap for less latency.
+        void SetMaximumFrameLatency(uint32_t frames)
+        {
+            m_maxFrameLatency = ClampFrameLatency(frames);
+            m_backend.SetMaximumFrameLatency(m_maxFrameLatency);
+        }
+
+        uint32_t GetMaximumFrameLatency() const noexcept { return m_maxFrameLatency; }
+
+        // A missed wait is counted and the frame goes ahead, so a stuck waitable cannot hang the app.
+        void SetWaitTimeout(uint32_t timeoutMs) noexcept { m_waitTimeout = timeoutMs; }
+        uint32_t GetWaitTimeout() const noexcept { return m_waitTimeout; }
+
+        // Call once the backend is bound to a new swap chain or the GPU has been drained: pushes
+        // the frame latency to the backend and forgets frames that can no longer be timed.
+        void Reset()
+        {
+            m_backend.SetMaximumFrameLatency(m_maxFrameLatency);
+            m_pending.clear();
+            m_hasLastPresent = false;
+            m_current = {};
+        }
+
+        // Top of the frame, before input is read. Returns false if the waitable timed out.
+        bool BeginFrame()
+        {
+            const uint64_t start = m_backend.GetTicks();
+            const bool signaled = m_backend.WaitForFrameLatency(m_waitTimeout);
+            const uint64_t now = m_backend.GetTicks();
+
+            m_current.latencyWaitMs += ToMilliseconds(now - start);
+            if (!signaled)
+            {
+                m_current.latencyTimeout = true;
+                ++m_latencyTimeouts;
+            }
+
+            m_frameStart = now;
+            ObserveCompletedFrames(now);
+            return signaled;
+        }
+
+        // After Present, with the fence value signaled when the GPU finishes the frame.
+        void EndFrame(uint64_t fenceValue)
+        {
+            const uint64_t now = m_backend.GetTicks();
+
+            FramePacingSample& sample = m_samples[m_frame % m_samples.size()];
+            sample = m_current;
+            sample.frame = m_frame;
+            sample.presentIntervalMs = m_hasLastPresent ? ToMilliseconds(now - m_lastPresent) : 0.0;
+            sample.gpuLatencyMs = 0.0;
+
+            if (m_count < m_samples.size())
+            {
+                ++m_count;
+            }
+
+            if (m_pending.size() >= m_samples.size())
+            {
+                m_pending.erase(m_pending.begin());
+            }
+            m_pending.push_back({ fenceValue, m_frameStart, m_frame });
+
+            ++m_frame;
+            m_lastPresent = now;
+            m_hasLastPresent = true;
+            m_current = {};
+        }
+
+        // Blocks until the GPU reaches 'fenceValue', timing the stall only if there is one.
+        // Returns true if it had to wait.
+        bool WaitForFence(uint64_t fenceValue)
+        {
+            if (m_backend.GetCompletedFenceValue() >= fenceValue)
+                return false;
+
+            const uint64_t start = m_backend.GetTicks();
+            m_backend.WaitForFenceValue(fenceValue);
+            const uint64_t now = m_backend.GetTicks();
+
+            m_current.fenceWaitMs += ToMilliseconds(now - start);
+            ObserveCompletedFrames(now);
+            return true;
+        }
+
+        // Samples in the window, oldest first.
+        size_t GetSampleCount() const noexcept { return m_count; }
+
+        const FramePacingSample& GetSample(size_t index) const noexcept
+        {
+            assert(index < m_count);
+            return m_samples[(m_frame - m_count + index) % m_samples.size()];
+        }
+
+        uint64_t GetFrameCount() const noexcept { return m_frame; }
+        uint64_t GetLatencyTimeouts() const noexcept { return m_latencyTimeouts; }
+
+        FramePacingSummary GetSummary() const noexcept
+        {
+            FramePacingSummary summary = {};
+            summary.frames = m_count;
+            summary.latencyTimeouts = m_latencyTimeouts;
+            if (!m_count)
+                return summary;
+
+            summary.minPresentIntervalMs = DBL_MAX;
+
+            double latencyWaitSum = 0.0;
+            double fenceWaitSum = 0.0;
+            double intervalSum = 0.0;
+            double gpuLatencySum = 0.0;
+            size_t intervals = 0;
+            for (size_t j = 0; j < m_count; ++j)
+            {
+                const auto& sample = GetSample(j);
+                latencyWaitSum += sample.latencyWaitMs;
+                fenceWaitSum += sample.fenceWaitMs;
+                summary.maxLatencyWaitMs = std::max(summary.maxLatencyWaitMs, sample.latencyWaitMs);
+                summary.maxFenceWaitMs = std::max(summary.maxFenceWaitMs, sample.fenceWaitMs);
+
+                if (sample.presentIntervalMs > 0.0)
+                {
+                    ++intervals;
+                    intervalSum += sample.presentIntervalMs;
+                    summary.minPresentIntervalMs = std::min(summary.minPresentIntervalMs, sample.presentIntervalMs);
+                    summary.maxPresentIntervalMs = std::max(summary.maxPresentIntervalMs, sample.presentIntervalMs);
+                }
+
+                if (sample.gpuLatencyMs > 0.0)
+                {
+                    ++summary.gpuLatencyFrames;
+                    gpuLatencySum += sample.gpuLatencyMs;
+                    summary.maxGpuLatencyMs = std::max(summary.maxGpuLatencyMs, sample.gpuLatencyMs);
+                }
+            }
+
+            summary.avgLatencyWaitMs = latencyWaitSum / double(m_count);
+            summary.avgFenceWaitMs = fenceWaitSum / double(m_count);
+            summary.avgPresentIntervalMs = intervals ? intervalSum / double(intervals) : 0.0;
+            summary.minPresentIntervalMs = intervals ? summary.minPresentIntervalMs : 0.0;
+            summary.avgGpuLatencyMs = summary.gpuLatencyFrames ? gpuLatencySum / double(summary.gpuLatencyFrames) : 0.0;
+            return summary;
+        }
+
+        // One-line report of the window for debug output.
+        void FormatSummary(_Out_writes_z_(size) char* buffer, size_t size) const
+        {
+            const auto summary = GetSummary();
+            sprintf_s(buffer, size, "Frame pacing (%zu of %llu frames, latency %u): present interval avg %.2f ms, min %.2f ms, max %.2f ms; "
+                "waitable avg %.2f ms, max %.2f ms; fence avg %.2f ms, max %.2f ms; frame to GPU done avg %.2f ms, max %.2f ms; %llu timeouts\n",
+                summary.frames, static_cast<unsigned long long>(m_frame), m_maxFrameLatency,
+                summary.avgPresentIntervalMs, summary.minPresentIntervalMs, summary.maxPresentIntervalMs,
+                summary.avgLatencyWaitMs, summary.maxLatencyWaitMs,
+                summary.avgFenceWaitMs, summary.maxFenceWaitMs,
+                summary.avgGpuLatencyMs, summary.maxGpuLatencyMs,
+                static_cast<unsigned long long>(summary.latencyTimeouts));
+        }
+
+    private:
+        struct PendingFrame
+        {
+            uint64_t    fenceValue;
+            uint64_t    startTicks;
+            uint64_t    frame;
+        };
+
+        static uint32_t ClampFrameLatency(uint32_t frames) noexcept
+        {
+            return std::min(std::max(frames, 1u), uint32_t(c_MaxFrameLatency));
+        }
+
+        double ToMilliseconds(uint64_t ticks) const noexcept
+        {
+            return double(ticks) * 1000.0 / double(m_tickFrequency);
+        }
+
+        // GPU completion is only seen when the fence is polled, so this is an upper bound at the
+        // granularity of BeginFrame and WaitForFence.
+        void ObserveCompletedFrames(uint64_t now)
+        {
+            if (m_pending.empty())
+                return;
+
+            const uint64_t completed = m_backend.GetCompletedFenceValue();
+
+            auto it = m_pending.begin();
+            for (; it != m_pending.end() && it->fenceValue <= completed; ++it)
+            {
+                if (m_frame - it->frame <= m_count)
+                {
+                    m_samples[it->frame % m_samples.size()].gpuLatencyMs = ToMilliseconds(now - it->startTicks);
+                }
+            }
+            m_pending.erase(m_pending.begin(), it);
+        }
+
+        TBackend                        m_backend;
+        uint64_t                        m_tickFrequency;
+        uint32_t                        m_maxFrameLatency;
+        uint32_t                        m_waitTimeout;
+
+        std::vector<FramePacingSample>  m_samples;      // frame N is at N % capacity
+        size_t                          m_count;
+        uint64_t                        m_frame;
+
+        FramePacingSample               m_current;      // stalls accumulated since the last present
+        uint64_t                        m_frameStart;
+        uint64_t                        m_lastPresent;
+        bool                            m_hasLastPresent;
+        std::vector<PendingFrame>       m_pending;      // presented frames not yet seen complete, in fence order
+
+        uint64_t                        m_latencyTimeouts;
+    };
+}
@@ -0,0 +1,136 @@
+//--------------------------------------------------------------------------------------
+// File: FrameTransformAllocator.h
+//
+// Per-frame linear allocator for transform arrays (bone palettes, instance matrices)
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <DirectXMath.h>
+#include <Model.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace DX
+{
+    // Hands out 16-byte aligned XMMATRIX arrays from a single block which is rewound
+    // by Reset at the end of each frame. If a frame needs more than the current block,
+    // an overflow block is allocated and the next Reset grows the main block to the
+    // high-water mark, so steady-state frames perform no heap allocations.
+    class FrameTransformAllocator
+    {
+    public:
+        explicit FrameTransformAllocator(size_t initialCapacity = 0) noexcept(false) :
+            m_capacity(0),
+            m_offset(0),
+            m_frameUsed(0),
+            m_highWater(0),
+            m_heapAllocations(0),
+            m_allocations(0)
+        {
+            if (initialCapacity > 0)
+            {
+                Grow(initialCapacity);
+            }
+        }
+
+        FrameTransformAllocator(FrameTransformAllocator&&) = default;
+        FrameTransformAllocator& operator= (FrameTransformAllocator&&) = default;
+
+        FrameTransformAllocator(FrameTransformAllocator const&) = delete;
+        FrameTransformAllocator& operator= (FrameTransformAllocator const&) = delete;
+
+        ~FrameTransformAllocator() = default;
+
+        // Returns storage for 'count' matrices valid until the next Reset. Contents are uninitialized.
+        DirectX::XMMATRIX* Allocate(size_t count) noexcept(false)
+        {
+            if (!count)
+                return nullptr;
+
+            ++m_allocations;
+            m_frameUsed += count;
+
+            if (m_offset + count <= m_capacity)
+            {
+                auto result = m_block.get() + m_offset;
+                m_offset += count;
+                return result;
+            }
+
+            // Overflow for this frame; earlier pointers must remain valid so the main block can't be resized here.
+            // Growing the list of overflow blocks is a heap allocation too (clear keeps its capacity).
+            if (m_overflow.size() == m_overflow.capacity())
+            {
+                ++m_heapAllocations;
+            }
+            m_overflow.emplace_back(DirectX::ModelBone::MakeArray(count));
+            ++m_heapAllocations;
+            return m_overflow.back().get();
+        }
+
+        // Rewinds the allocator. All pointers returned since the last Reset are invalidated.
+        void Reset() noexcept(false)
+        {
+            if (m_frameUsed > m_highWater)
+            {
+                m_highWater = m_frameUsed;
+            }
+
+            if (!m_overflow.empty())
+            {
+                m_overflow.clear();
+                Grow(m_highWater);
+            }
+
+            m_offset = 0;
+            m_frameUsed = 0;
+        }
+
+        // Total matrices available without allocating.
+        size_t GetCapacity() const noexcept { return m_capacity; }
+
+        // Matrices handed out since the last Reset.
+        size_t GetFrameUsage() const noexcept { return m_frameUsed; }
+
+        // Largest per-frame usage seen so far.
+        size_t GetHighWaterMark() const noexcept { return m_highWater; }
+
+        // Number of heap allocations performed by the allocator since creation (or ResetCounters).
+        uint64_t GetHeapAllocationCount() const noexcept { return m_heapAllocations; }
+
+        // Number of Allocate calls serviced since creation (or ResetCounters).
+        uint64_t GetAllocationCount() const noexcept { return m_allocations; }
+
+        void ResetCounters() noexcept
+        {
+            m_heapAllocations = 0;
+            m_allocations = 0;
+        }
+
+    private:
+        void Grow(size_t count)
+        {
+            if (count <= m_capacity)
+                return;
+
+            m_block = DirectX::ModelBone::MakeArray(count);
+            m_capacity = count;
+            ++m_heapAllocations;
+        }
+
+        DirectX::ModelBone::TransformArray              m_block;
+        std::vector<DirectX::ModelBone::TransformArray> m_overflow;
+        size_t                                          m_capacity;
+        size_t                                          m_offset;
+        size_t                                          m_frameUsed;
+        size_t                                          m_highWater;
+        uint64_t                                        m_heapAllocations;
+        uint64_t                                        m_allocations;
+    };
+}
@@ -0,0 +1,210 @@
+//--------------------------------------------------------------------------------------
+// File: FrustumCulling.h
+//
+// Batched bounding sphere vs. frustum culling with optional distance-based LOD
+//
+// Spheres are tested four at a time in structure-of-arrays form against six
+// pre-splatted planes, and the survivors are compacted into an index list that
+// drives instance packing (see InstanceTransforms.h).
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+
+#include <cassert>
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace DX
+{
+    class FrustumCuller
+    {
+    public:
+        static constexpr size_t c_MaxLodDistances = 7;
+
+        // Planes are taken in the frustum's space (usually world space).
+        explicit FrustumCuller(const DirectX::BoundingFrustum& frustum) noexcept :
+            m_lodCount(0)
+        {
+            using namespace DirectX;
+
+            XMVECTOR planes[6];
+            frustum.GetPlanes(&planes[0], &planes[1], &planes[2], &planes[3], &planes[4], &planes[5]);
+            for (size_t p = 0; p < 6; ++p)
+            {
+                SetPlane(p, planes[p]);
+            }
+            m_eye = g_XMZero;
+        }
+
+        // Extracts the planes from a combined matrix, so passing world * view * projection culls
+        // in object space. Handles LH/RH, reversed Z, and a display orientation transform alike.
+        explicit FrustumCuller(DirectX::CXMMATRIX matrix) noexcept :
+            m_lodCount(0)
+        {
+            using namespace DirectX;
+
+            // Clip space is -w <= x,y <= w and 0 <= z <= w; negate for outward-facing normals.
+            const XMMATRIX t = XMMatrixTranspose(matrix);
+            SetPlane(0, XMVectorNegate(t.r[2]));                    // near
+            SetPlane(1, XMVectorSubtract(t.r[2], t.r[3]));          // far
+            SetPlane(2, XMVectorSubtract(t.r[0], t.r[3]));          // right
+            SetPlane(3, XMVectorNegate(XMVectorAdd(t.r[3], t.r[0])));   // left
+            SetPlane(4, XMVectorSubtract(t.r[1], t.r[3]));          // top
+            SetPlane(5, XMVectorNegate(XMVectorAdd(t.r[3], t.r[1])));   // bottom
+            m_eye = g_XMZero;
+        }
+
+        // LOD n is chosen once the distance from 'eye' to the sphere center reaches distances[n-1].
+        // 'distances' must be ascending and in the same space as the bounds.
+        void XM_CALLCONV SetLodDistances(DirectX::FXMVECTOR eye, _In_reads_(count) const float* distances, size_t count) noexcept
+        {
+            assert(count <= c_MaxLodDistances);
+            m_eye = eye;
+            m_lodCount = (count < c_MaxLodDistances) ? count : c_MaxLodDistances;
+            for (size_t j = 0; j < m_lodCount; ++j)
+            {
+                m_lodDistancesSq[j] = DirectX::XMVectorReplicate(distances[j] * distances[j]);
+            }
+        }
+
+        bool IsVisible(const DirectX::BoundingSphere& sphere) const noexcept
+        {
+            using namespace DirectX;
+
+            const XMVECTOR center = XMLoadFloat3(&sphere.Center);
+            return (TestBatch(XMVectorSplatX(center), XMVectorSplatY(center), XMVectorSplatZ(center), XMVectorReplicate(sphere.Radius)) & 1) != 0;
+        }
+
+        // Writes the indices of visible spheres to 'visible' (and their LOD to 'lods' if provided),
+        // preserving order. Returns the visible count.
+        size_t Cull(_In_reads_(count) const DirectX::BoundingSphere* spheres, size_t count,
+            _Out_writes_to_(count, return) uint32_t* visible, _Out_writes_opt_(count) uint8_t* lods = nullptr) const noexcept
+        {
+            size_t visibleCount = 0;
+            for (size_t j = 0; j < count; j += 4)
+            {
+                visibleCount = CullBatch(spheres + j, (count - j < 4) ? (count - j) : 4, j, visible, lods, visibleCount);
+            }
+            return visibleCount;
+        }
+
+        // As Cull, for instances of a mesh with object-space 'bounds' placed by transform(j).
+        template<typename TFunc>
+        size_t CullInstances(const DirectX::BoundingSphere& bounds, size_t count, TFunc&& transform,
+            _Out_writes_to_(count, return) uint32_t* visible, _Out_writes_opt_(count) uint8_t* lods = nullptr) const
+        {
+            DirectX::BoundingSphere batch[4];
+
+            size_t visibleCount = 0;
+            for (size_t j = 0; j < count; j += 4)
+            {
+                const size_t n = (count - j < 4) ? (count - j) : 4;
+                for (size_t k = 0; k < n; ++k)
+                {
+                    bounds.Transform(batch[k], transform(j + k));
+                }
+                visibleCount = CullBatch(batch, n, j, visible, lods, visibleCount);
+            }
+            return visibleCount;
+        }
+
+    private:
+        void XM_CALLCONV SetPlane(size_t index, DirectX::FXMVECTOR plane) noexcept
+        {
+            using namespace DirectX;
+
+            // A degenerate plane (e.g. the far plane of an infinite projection) never rejects.
+            const XMVECTOR lengthSq = XMVector3LengthSq(plane);
+            XMVECTOR p = XMVector3Less(lengthSq, XMVectorReplicate(1e-12f))
+                ? XMVectorSet(0.f, 0.f, 0.f, -FLT_MAX)
+                : XMVectorDivide(plane, XMVectorSqrt(lengthSq));
+
+            m_planes[index][0] = XMVectorSplatX(p);
+            m_planes[index][1] = XMVectorSplatY(p);
+            m_planes[index][2] = XMVectorSplatZ(p);
+            m_planes[index][3] = XMVectorSplatW(p);
+        }
+
+        // Returns a bit per lane that is at least partially inside all six planes.
+        uint32_t XM_CALLCONV TestBatch(DirectX::FXMVECTOR x, DirectX::FXMVECTOR y, DirectX::FXMVECTOR z, DirectX::GXMVECTOR radius) const noexcept
+        {
+            using namespace DirectX;
+
+            XMVECTOR outside = XMVectorFalseInt();
+            for (size_t p = 0; p < 6; ++p)
+            {
+                XMVECTOR dist = XMVectorMultiplyAdd(x, m_planes[p][0], m_planes[p][3]);
+                dist = XMVectorMultiplyAdd(y, m_planes[p][1], dist);
+                dist = XMVectorMultiplyAdd(z, m_planes[p][2], dist);
+                outside = XMVectorOrInt(outside, XMVectorGreater(dist, radius));
+            }
+
+#if defined(_XM_SSE_INTRINSICS_)
+            return static_cast<uint32_t>(_mm_movemask_ps(outside)) ^ 0xFu;
+#else
+            XMUINT4 lanes;
+            XMStoreUInt4(&lanes, outside);
+            return (lanes.x ? 0u : 1u) | (lanes.y ? 0u : 2u) | (lanes.z ? 0u : 4u) | (lanes.w ? 0u : 8u);
+#endif
+        }
+
+        size_t CullBatch(_In_reads_(n) const DirectX::BoundingSphere* spheres, size_t n, size_t base,
+            uint32_t* visible, uint8_t* lods, size_t visibleCount) const noexcept
+        {
+            using namespace DirectX;
+
+            static_assert(sizeof(BoundingSphere) == sizeof(XMFLOAT4), "Center and Radius load as one float4");
+
+            // Short batches repeat the last sphere; the extra lanes are never emitted.
+            XMMATRIX soa;
+            for (size_t k = 0; k < 4; ++k)
+            {
+                soa.r[k] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&spheres[(k < n) ? k : (n - 1)]));
+            }
+            soa = XMMatrixTranspose(soa);
+
+            const uint32_t mask = TestBatch(soa.r[0], soa.r[1], soa.r[2], soa.r[3]);
+
+            XMFLOAT4 lod = {};
+            if (lods)
+            {
+                const XMVECTOR dx = XMVectorSubtract(soa.r[0], XMVectorSplatX(m_eye));
+                const XMVECTOR dy = XMVectorSubtract(soa.r[1], XMVectorSplatY(m_eye));
+                const XMVECTOR dz = XMVectorSubtract(soa.r[2], XMVectorSplatZ(m_eye));
+                const XMVECTOR distSq = XMVectorMultiplyAdd(dz, dz, XMVectorMultiplyAdd(dy, dy, XMVectorMultiply(dx, dx)));
+
+                XMVECTOR level = XMVectorZero();
+                for (size_t j = 0; j < m_lodCount; ++j)
+                {
+                    level = XMVectorAdd(level, XMVectorAndInt(XMVectorGreaterOrEqual(distSq, m_lodDistancesSq[j]), g_XMOne));
+                }
+                XMStoreFloat4(&lod, level);
+            }
+
+            const float* lodLanes = &lod.x;
+            for (size_t k = 0; k < n; ++k)
+            {
+                visible[visibleCount] = static_cast<uint32_t>(base + k);
+                if (lods)
+                {
+                    lods[visibleCount] = static_cast<uint8_t>(lodLanes[k]);
+                }
+                visibleCount += (mask >> k) & 1;
+            }
+
+            return visibleCount;
+        }
+
+        DirectX::XMVECTOR   m_planes[6][4];
+        DirectX::XMVECTOR   m_lodDistancesSq[c_MaxLodDistances];
+        DirectX::XMVECTOR   m_eye;
+        size_t              m_lodCount;
+    };
+}
@@ -0,0 +1,128 @@
+//--------------------------------------------------------------------------------------
+// File: GlyphTable.h
+//
+// Constant-time character-to-glyph lookup for SpriteFont
+//
+// SpriteFont::FindGlyph binary-searches the font's sorted glyphs for every character,
+// which for a CJK font is a dozen or more dependent loads per character. The table
+// here is built once at font load: a 256-entry page index selects one of 256-glyph
+// pages, so a lookup is two loads. Pages with no glyphs share a single empty page.
+//
+// SpriteFont looks characters up by wchar_t, so the table covers U+0000..U+FFFF; any
+// other character is reported as missing.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <SpriteFont.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+
+namespace DX
+{
+    template<typename TGlyph>
+    class BasicGlyphTable
+    {
+    public:
+        static constexpr uint32_t PageBits = 8;
+        static constexpr uint32_t PageSize = 1u << PageBits;
+        static constexpr uint32_t PageCount = 0x10000u >> PageBits;
+
+        BasicGlyphTable() :
+            m_glyphCount(0)
+        {
+            Clear();
+        }
+
+        BasicGlyphTable(BasicGlyphTable&&) = default;
+        BasicGlyphTable& operator= (BasicGlyphTable&&) = default;
+
+        BasicGlyphTable(BasicGlyphTable const&) = default;
+        BasicGlyphTable& operator= (BasicGlyphTable const&) = default;
+
+        void Clear()
+        {
+            std::fill(std::begin(m_pageIndex), std::end(m_pageIndex), uint16_t(0));
+            m_entries.assign(PageSize, nullptr);
+            m_glyphCount = 0;
+        }
+
+        // Indexes 'glyphs', which must outlive the table (as a SpriteFont's do). Each character
+        // should appear once; SpriteFont rejects duplicates.
+        void Build(_In_reads_(glyphCount) const TGlyph* glyphs, size_t glyphCount)
+        {
+            Clear();
+
+            for (size_t j = 0; j < glyphCount; ++j)
+            {
+                Add(glyphs[j].Character, &glyphs[j]);
+            }
+        }
+
+        // Indexes a loaded font through its public interface (ContainsCharacter, FindGlyph).
+        template<typename TFont>
+        void Build(const TFont& font)
+        {
+            Clear();
+
+            for (uint32_t character = 0; character < 0x10000u; ++character)
+            {
+                const auto c = static_cast<wchar_t>(character);
+                if (font.ContainsCharacter(c))
+                {
+                    Add(character, font.FindGlyph(c));
+                }
+            }
+        }
+
+        // The glyph for 'character', or null if the font lacks it.
+        TGlyph const* Find(uint32_t character) const noexcept
+        {
+            if (character > 0xFFFFu)
+                return nullptr;
+
+            return m_entries[(size_t(m_pageIndex[character >> PageBits]) << PageBits) | (character & (PageSize - 1))];
+        }
+
+        size_t GetGlyphCount() const noexcept { return m_glyphCount; }
+
+        // Pages holding glyphs, excluding the shared empty page.
+        size_t GetPageCount() const noexcept { return m_entries.size() / PageSize - 1; }
+
+        size_t GetSizeInBytes() const noexcept { return sizeof(m_pageIndex) + m_entries.size() * sizeof(TGlyph const*); }
+
+    private:
+        void Add(uint32_t character, TGlyph const* glyph)
+        {
+            if (character > 0xFFFFu)
+                return;
+
+            uint16_t& page = m_pageIndex[character >> PageBits];
+            if (!page)
+            {
+                page = static_cast<uint16_t>(m_entries.size() / PageSize);
+                m_entries.resize(m_entries.size() + PageSize, nullptr);
+            }
+
+            auto& entry = m_entries[(size_t(page) << PageBits) | (character & (PageSize - 1))];
+            if (!entry)
+            {
+                ++m_glyphCount;
+            }
+            entry = glyph;
+        }
+
+        uint16_t                    m_pageIndex[PageCount];     // 0 is the shared empty page
+        std::vector<TGlyph const*>  m_entries;
+        size_t                      m_glyphCount;
+    };
+
+    using GlyphTable = BasicGlyphTable<DirectX::SpriteFont::Glyph>;
+}
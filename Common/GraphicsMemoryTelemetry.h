@@ -0,0 +1,189 @@
+//--------------------------------------------------------------------------------------
+// File: GraphicsMemoryTelemetry.h
+//
+// Per-frame history of DirectX Tool Kit GraphicsMemory usage with an upload budget
+//
+// Call Record once per frame after GraphicsMemory::Commit. Samples go into a fixed
+// ring buffer, and a frame over budget triggers the budget callback, so upload heap
+// growth shows up as it happens rather than only as a peak at exit.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <GraphicsMemory.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    struct GraphicsMemorySample
+    {
+        uint64_t    frame;
+        size_t      committedBytes;     // in flight: allocated and not yet retired by the GPU fence
+        size_t      totalBytes;         // upload pages owned by GraphicsMemory
+        size_t      totalPages;
+
+        // Page memory that is held but not in flight.
+        size_t GetIdleBytes() const noexcept { return (totalBytes > committedBytes) ? (totalBytes - committedBytes) : 0; }
+    };
+
+    // A zero limit is not enforced.
+    struct GraphicsMemoryBudget
+    {
+        size_t      committedBytes;
+        size_t      totalBytes;
+        size_t      totalPages;
+
+        bool IsExceededBy(const GraphicsMemorySample& sample) const noexcept
+        {
+            return (committedBytes && sample.committedBytes > committedBytes)
+                || (totalBytes && sample.totalBytes > totalBytes)
+                || (totalPages && sample.totalPages > totalPages);
+        }
+    };
+
+    struct GraphicsMemorySummary
+    {
+        size_t      frames;             // samples in the window
+        size_t      minCommittedBytes;
+        size_t      maxCommittedBytes;
+        size_t      avgCommittedBytes;
+        size_t      maxTotalBytes;
+        size_t      maxTotalPages;
+        int64_t     totalGrowthBytes;   // newest minus oldest total in the window
+        uint64_t    overBudgetFrames;   // since construction
+    };
+
+    class GraphicsMemoryTelemetry
+    {
+    public:
+        using BudgetCallback = std::function<void(const GraphicsMemorySample& sample, const GraphicsMemoryBudget& budget)>;
+
+        explicit GraphicsMemoryTelemetry(size_t capacity = 600) :
+            m_samples(capacity),
+            m_next(0),
+            m_count(0),
+            m_frame(0),
+            m_budget{},
+            m_overBudgetFrames(0)
+        {
+            assert(capacity > 0);
+        }
+
+        // 'callback' runs on the recording thread for every frame over 'budget'.
+        void SetBudget(const GraphicsMemoryBudget& budget, BudgetCallback callback)
+        {
+            m_budget = budget;
+            m_callback = std::move(callback);
+        }
+
+        const GraphicsMemoryBudget& GetBudget() const noexcept { return m_budget; }
+
+        // Returns false if the frame was over budget.
+        bool Record(size_t committedBytes, size_t totalBytes, size_t totalPages)
+        {
+            GraphicsMemorySample& sample = m_samples[m_next];
+            sample.frame = m_frame++;
+            sample.committedBytes = committedBytes;
+            sample.totalBytes = totalBytes;
+            sample.totalPages = totalPages;
+
+            m_next = (m_next + 1) % m_samples.size();
+            if (m_count < m_samples.size())
+            {
+                ++m_count;
+            }
+
+            if (!m_budget.IsExceededBy(sample))
+                return true;
+
+            ++m_overBudgetFrames;
+            if (m_callback)
+            {
+                m_callback(sample, m_budget);
+            }
+            return false;
+        }
+
+        // Also updates the GraphicsMemory peak values, as GetStatistics always does.
+        bool Record(DirectX::GraphicsMemory& graphicsMemory)
+        {
+            const auto stats = graphicsMemory.GetStatistics();
+            return Record(stats.committedMemory, stats.totalMemory, stats.totalPages);
+        }
+
+        // Samples in the window, oldest first.
+        size_t GetSampleCount() const noexcept { return m_count; }
+
+        const GraphicsMemorySample& GetSample(size_t index) const noexcept
+        {
+            assert(index < m_count);
+            return m_samples[(m_next + m_samples.size() - m_count + index) % m_samples.size()];
+        }
+
+        uint64_t GetFrameCount() const noexcept { return m_frame; }
+        uint64_t GetOverBudgetFrames() const noexcept { return m_overBudgetFrames; }
+
+        GraphicsMemorySummary GetSummary() const noexcept
+        {
+            GraphicsMemorySummary summary = {};
+            summary.frames = m_count;
+            summary.overBudgetFrames = m_overBudgetFrames;
+            if (!m_count)
+                return summary;
+
+            summary.minCommittedBytes = SIZE_MAX;
+
+            uint64_t committedSum = 0;
+            for (size_t j = 0; j < m_count; ++j)
+            {
+                const auto& sample = GetSample(j);
+                committedSum += sample.committedBytes;
+                if (sample.committedBytes < summary.minCommittedBytes)
+                    summary.minCommittedBytes = sample.committedBytes;
+                if (sample.committedBytes > summary.maxCommittedBytes)
+                    summary.maxCommittedBytes = sample.committedBytes;
+                if (sample.totalBytes > summary.maxTotalBytes)
+                    summary.maxTotalBytes = sample.totalBytes;
+                if (sample.totalPages > summary.maxTotalPages)
+                    summary.maxTotalPages = sample.totalPages;
+            }
+
+            summary.avgCommittedBytes = static_cast<size_t>(committedSum / m_count);
+            summary.totalGrowthBytes = static_cast<int64_t>(GetSample(m_count - 1).totalBytes) - static_cast<int64_t>(GetSample(0).totalBytes);
+            return summary;
+        }
+
+        // One-line report of the window for debug output.
+        void FormatSummary(_Out_writes_z_(size) char* buffer, size_t size) const
+        {
+            const auto summary = GetSummary();
+            sprintf_s(buffer, size, "GraphicsMemory telemetry (%zu of %llu frames): committed min %zu KB, avg %zu KB, max %zu KB; "
+                "total max %zu KB (%zu pages), growth %lld KB; %llu frames over budget\n",
+                summary.frames, static_cast<unsigned long long>(m_frame),
+                summary.minCommittedBytes / 1024, summary.avgCommittedBytes / 1024, summary.maxCommittedBytes / 1024,
+                summary.maxTotalBytes / 1024, summary.maxTotalPages,
+                static_cast<long long>(summary.totalGrowthBytes / 1024),
+                static_cast<unsigned long long>(summary.overBudgetFrames));
+        }
+
+    private:
+        std::vector<GraphicsMemorySample>   m_samples;
+        size_t                              m_next;
+        size_t                              m_count;
+        uint64_t                            m_frame;
+
+        GraphicsMemoryBudget                m_budget;
+        BudgetCallback                      m_callback;
+        uint64_t                            m_overBudgetFrames;
+    };
+}
@@ -0,0 +1,381 @@
+//--------------------------------------------------------------------------------------
+// File: HDRImage.h
+//
+// CPU loader for HDR DDS images into linear float pixels
+//
+// Reads the top mip of a 2D R16G16B16A16_FLOAT, R32G32B32A32_FLOAT, or BC6H texture,
+// decoding BC6H blocks per the Direct3D 11 format specification, so HDR test content
+// can be checked without a GPU.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    struct HDRImage
+    {
+        uint32_t                        width;
+        uint32_t                        height;
+        std::vector<DirectX::XMFLOAT4>  pixels;     // row-major, linear RGBA
+    };
+
+    namespace BC6H
+    {
+        enum Field : uint8_t { End, D, RW, RX, RY, RZ, GW, GX, GY, GZ, BW, BX, BY, BZ };
+
+        // Bits [first..last] of a field in stream order; 'first' above 'last' runs high bit first.
+        // Unused slots are zero, which reads as End.
+        struct Run
+        {
+            uint8_t field;
+            uint8_t first;
+            uint8_t last;
+        };
+
+        struct ModeInfo
+        {
+            bool        transformed;
+            uint8_t     regions;
+            uint8_t     endpointBits;
+            uint8_t     deltaBits[3];
+            Run         runs[24];
+        };
+
+        // Header layouts of the 14 modes after the mode bits, from the format specification.
+        constexpr ModeInfo c_Modes[14] =
+        {
+            { true, 2, 10, { 5, 5, 5 }, { {GY,4,4}, {BY,4,4}, {BZ,4,4}, {RW,0,9}, {GW,0,9}, {BW,0,9}, {RX,0,4}, {GZ,4,4}, {GY,0,3}, {GX,0,4}, {BZ,0,0}, {GZ,0,3}, {BX,0,4}, {BZ,1,1}, {BY,0,3}, {RY,0,4}, {BZ,2,2}, {RZ,0,4}, {BZ,3,3}, {D,0,4} } },
+            { true, 2, 7, { 6, 6, 6 }, { {GY,5,5}, {GZ,4,5}, {RW,0,6}, {BZ,0,1}, {BY,4,4}, {GW,0,6}, {BY,5,5}, {BZ,2,2}, {GY,4,4}, {BW,0,6}, {BZ,3,3}, {BZ,5,5}, {BZ,4,4}, {RX,0,5}, {GY,0,3}, {GX,0,5}, {GZ,0,3}, {BX,0,5}, {BY,0,3}, {RY,0,5}, {RZ,0,5}, {D,0,4} } },
+            { true, 2, 11, { 5, 4, 4 }, { {RW,0,9}, {GW,0,9}, {BW,0,9}, {RX,0,4}, {RW,10,10}, {GY,0,3}, {GX,0,3}, {GW,10,10}, {BZ,0,0}, {GZ,0,3}, {BX,0,3}, {BW,10,10}, {BZ,1,1}, {BY,0,3}, {RY,0,4}, {BZ,2,2}, {RZ,0,4}, {BZ,3,3}, {D,0,4} } },
+            { true, 2, 11, { 4, 5, 4 }, { {RW,0,9}, {GW,0,9}, {BW,0,9}, {RX,0,3}, {RW,10,10}, {GZ,4,4}, {GY,0,3}, {GX,0,4}, {GW,10,10}, {GZ,0,3}, {BX,0,3}, {BW,10,10}, {BZ,1,1}, {BY,0,3}, {RY,0,3}, {BZ,0,0}, {BZ,2,2}, {RZ,0,3}, {GY,4,4}, {BZ,3,3}, {D,0,4} } },
+            { true, 2, 11, { 4, 4, 5 }, { {RW,0,9}, {GW,0,9}, {BW,0,9}, {RX,0,3}, {RW,10,10}, {BY,4,4}, {GY,0,3}, {GX,0,3}, {GW,10,10}, {BZ,0,0}, {GZ,0,3}, {BX,0,4}, {BW,10,10}, {BY,0,3}, {RY,0,3}, {BZ,1,2}, {RZ,0,3}, {BZ,4,4}, {BZ,3,3}, {D,0,4} } },
+            { true, 2, 9, { 5, 5, 5 }, { {RW,0,8}, {BY,4,4}, {GW,0,8}, {GY,4,4}, {BW,0,8}, {BZ,4,4}, {RX,0,4}, {GZ,4,4}, {GY,0,3}, {GX,0,4}, {BZ,0,0}, {GZ,0,3}, {BX,0,4}, {BZ,1,1}, {BY,0,3}, {RY,0,4}, {BZ,2,2}, {RZ,0,4}, {BZ,3,3}, {D,0,4} } },
+            { true, 2, 8, { 6, 5, 5 }, { {RW,0,7}, {GZ,4,4}, {BY,4,4}, {GW,0,7}, {BZ,2,2}, {GY,4,4}, {BW,0,7}, {BZ,3,4}, {RX,0,5}, {GY,0,3}, {GX,0,4}, {BZ,0,0}, {GZ,0,3}, {BX,0,4}, {BZ,1,1}, {BY,0,3}, {RY,0,5}, {RZ,0,5}, {D,0,4} } },
+            { true, 2, 8, { 5, 6, 5 }, { {RW,0,7}, {BZ,0,0}, {BY,4,4}, {GW,0,7}, {GY,5,5}, {GY,4,4}, {BW,0,7}, {GZ,5,5}, {BZ,4,4}, {RX,0,4}, {GZ,4,4}, {GY,0,3}, {GX,0,5}, {GZ,0,3}, {BX,0,4}, {BZ,1,1}, {BY,0,3}, {RY,0,4}, {BZ,2,2}, {RZ,0,4}, {BZ,3,3}, {D,0,4} } },
+            { true, 2, 8, { 5, 5, 6 }, { {RW,0,7}, {BZ,1,1}, {BY,4,4}, {GW,0,7}, {BY,5,5}, {GY,4,4}, {BW,0,7}, {BZ,5,5}, {BZ,4,4}, {RX,0,4}, {GZ,4,4}, {GY,0,3}, {GX,0,4}, {BZ,0,0}, {GZ,0,3}, {BX,0,5}, {BY,0,3}, {RY,0,4}, {BZ,2,2}, {RZ,0,4}, {BZ,3,3}, {D,0,4} } },
+            { false, 2, 6, { 6, 6, 6 }, { {RW,0,5}, {GZ,4,4}, {BZ,0,1}, {BY,4,4}, {GW,0,5}, {GY,5,5}, {BY,5,5}, {BZ,2,2}, {GY,4,4}, {BW,0,5}, {GZ,5,5}, {BZ,3,3}, {BZ,5,5}, {BZ,4,4}, {RX,0,5}, {GY,0,3}, {GX,0,5}, {GZ,0,3}, {BX,0,5}, {BY,0,3}, {RY,0,5}, {RZ,0,5}, {D,0,4} } },
+            { false, 1, 10, { 10, 10, 10 }, { {RW,0,9}, {GW,0,9}, {BW,0,9}, {RX,0,9}, {GX,0,9}, {BX,0,9} } },
+            { true, 1, 11, { 9, 9, 9 }, { {RW,0,9}, {GW,0,9}, {BW,0,9}, {RX,0,8}, {RW,10,10}, {GX,0,8}, {GW,10,10}, {BX,0,8}, {BW,10,10} } },
+            { true, 1, 12, { 8, 8, 8 }, { {RW,0,9}, {GW,0,9}, {BW,0,9}, {RX,0,7}, {RW,11,10}, {GX,0,7}, {GW,11,10}, {BX,0,7}, {BW,11,10} } },
+            { true, 1, 16, { 4, 4, 4 }, { {RW,0,9}, {GW,0,9}, {BW,0,9}, {RX,0,3}, {RW,15,10}, {GX,0,3}, {GW,15,10}, {BX,0,3}, {BW,15,10} } },
+        };
+
+        // Region of each pixel (bit i) for the 32 two-region shapes, and the second region's anchor pixel.
+        constexpr uint16_t c_Partitions[32] =
+        {
+            0xCCCC, 0x8888, 0xEEEE, 0xECC8, 0xC880, 0xFEEC, 0xFEC8, 0xEC80,
+            0xC800, 0xFFEC, 0xFE80, 0xE800, 0xFFE8, 0xFF00, 0xFFF0, 0xF000,
+            0xF710, 0x008E, 0x7100, 0x08CE, 0x008C, 0x7310, 0x3100, 0x8CCE,
+            0x088C, 0x3110, 0x6666, 0x366C, 0x17E8, 0x0FF0, 0x718E, 0x399C,
+        };
+
+        constexpr uint8_t c_Anchors[32] =
+        {
+            15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+            15,  2,  8,  2,  2,  8,  8, 15,  2,  8,  2,  2,  8,  8,  2,  2,
+        };
+
+        constexpr int c_Weights3[8] = { 0, 9, 18, 27, 37, 46, 55, 64 };
+        constexpr int c_Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+        class BitReader
+        {
+        public:
+            explicit BitReader(_In_reads_bytes_(16) const uint8_t* block) noexcept : m_position(0)
+            {
+                memcpy(m_bits, block, 16);
+            }
+
+            uint32_t GetBit() noexcept
+            {
+                const uint32_t bit = (m_bits[m_position >> 3] >> (m_position & 7)) & 1u;
+                ++m_position;
+                return bit;
+            }
+
+            uint32_t GetBits(uint32_t count) noexcept
+            {
+                uint32_t value = 0;
+                for (uint32_t j = 0; j < count; ++j)
+                {
+                    value |= GetBit() << j;
+                }
+                return value;
+            }
+
+        private:
+            uint8_t     m_bits[16];
+            uint32_t    m_position;
+        };
+
+        inline int SignExtend(int value, uint32_t bits) noexcept
+        {
+            const int sign = 1 << (bits - 1);
+            value &= (1 << bits) - 1;
+            return (value ^ sign) - sign;
+        }
+
+        inline int Unquantize(int comp, uint32_t bits, bool isSigned) noexcept
+        {
+            if (!isSigned)
+            {
+                if (bits >= 15 || comp == 0)
+                    return comp;
+                if (comp == (1 << bits) - 1)
+                    return 0xFFFF;
+                return ((comp << 16) + 0x8000) >> bits;
+            }
+
+            if (bits >= 16)
+                return comp;
+
+            const bool negative = comp < 0;
+            int magnitude = negative ? -comp : comp;
+            if (magnitude != 0)
+            {
+                magnitude = (magnitude >= (1 << (bits - 1)) - 1) ? 0x7FFF : ((magnitude << 15) + 0x4000) >> (bits - 1);
+            }
+            return negative ? -magnitude : magnitude;
+        }
+
+        // Interpolated, unquantized value to half-float bits.
+        inline uint16_t FinishUnquantize(int comp, bool isSigned) noexcept
+        {
+            if (!isSigned)
+                return static_cast<uint16_t>((comp * 31) >> 6);
+
+            return (comp < 0)
+                ? static_cast<uint16_t>(((-comp * 31) >> 5) | 0x8000)
+                : static_cast<uint16_t>((comp * 31) >> 5);
+        }
+
+        inline void DecodeBlock(_In_reads_bytes_(16) const uint8_t* block, bool isSigned, _Out_writes_(16) DirectX::XMFLOAT4* pixels) noexcept
+        {
+            using DirectX::PackedVector::XMConvertHalfToFloat;
+
+            BitReader reader(block);
+
+            uint32_t modeBits = reader.GetBits(2);
+            if (modeBits > 1)
+            {
+                modeBits |= reader.GetBits(3) << 2;
+            }
+
+            int mode = -1;
+            switch (modeBits)
+            {
+            case 0x00: mode = 0; break;
+            case 0x01: mode = 1; break;
+            case 0x02: mode = 2; break;
+            case 0x06: mode = 3; break;
+            case 0x0A: mode = 4; break;
+            case 0x0E: mode = 5; break;
+            case 0x12: mode = 6; break;
+            case 0x16: mode = 7; break;
+            case 0x1A: mode = 8; break;
+            case 0x1E: mode = 9; break;
+            case 0x03: mode = 10; break;
+            case 0x07: mode = 11; break;
+            case 0x0B: mode = 12; break;
+            case 0x0F: mode = 13; break;
+            default: break;
+            }
+
+            if (mode < 0)
+            {
+                // Reserved modes decode to black.
+                for (size_t j = 0; j < 16; ++j)
+                {
+                    pixels[j] = DirectX::XMFLOAT4(0.f, 0.f, 0.f, 1.f);
+                }
+                return;
+            }
+
+            const ModeInfo& info = c_Modes[mode];
+
+            // fields[D] is the shape; RW..BZ hold the w, x, y, z endpoints per channel.
+            int fields[BZ + 1] = {};
+            for (auto& run : info.runs)
+            {
+                if (run.field == End)
+                    break;
+
+                const int step = (run.first <= run.last) ? 1 : -1;
+                for (int bit = run.first; ; bit += step)
+                {
+                    fields[run.field] |= static_cast<int>(reader.GetBit()) << bit;
+                    if (bit == run.last)
+                        break;
+                }
+            }
+
+            // endpoints[region][end][channel]
+            int endpoints[2][2][3] = {};
+            for (uint32_t c = 0; c < 3; ++c)
+            {
+                const int base = RW + int(c) * 4;
+                int w = fields[base];
+                int others[3] = { fields[base + 1], fields[base + 2], fields[base + 3] };
+
+                if (isSigned)
+                {
+                    w = SignExtend(w, info.endpointBits);
+                }
+
+                for (auto& value : others)
+                {
+                    if (info.transformed)
+                    {
+                        value = SignExtend(value, info.deltaBits[c]);
+                        value = (w + value) & ((1 << info.endpointBits) - 1);
+                        if (isSigned)
+                        {
+                            value = SignExtend(value, info.endpointBits);
+                        }
+                    }
+                    else if (isSigned)
+                    {
+                        value = SignExtend(value, info.endpointBits);
+                    }
+                }
+
+                endpoints[0][0][c] = Unquantize(w, info.endpointBits, isSigned);
+                endpoints[0][1][c] = Unquantize(others[0], info.endpointBits, isSigned);
+                endpoints[1][0][c] = Unquantize(others[1], info.endpointBits, isSigned);
+                endpoints[1][1][c] = Unquantize(others[2], info.endpointBits, isSigned);
+            }
+
+            const uint32_t shape = static_cast<uint32_t>(fields[D]);
+            const uint32_t partition = (info.regions > 1) ? c_Partitions[shape] : 0u;
+            const uint32_t anchor = (info.regions > 1) ? c_Anchors[shape] : 0u;
+            const uint32_t indexBits = (info.regions > 1) ? 3u : 4u;
+            const int* weights = (info.regions > 1) ? c_Weights3 : c_Weights4;
+
+            for (uint32_t j = 0; j < 16; ++j)
+            {
+                const bool isAnchor = (j == 0) || (info.regions > 1 && j == anchor);
+                const int weight = weights[reader.GetBits(isAnchor ? indexBits - 1 : indexBits)];
+                const uint32_t region = (partition >> j) & 1u;
+
+                float rgb[3];
+                for (uint32_t c = 0; c < 3; ++c)
+                {
+                    const int value = (endpoints[region][0][c] * (64 - weight) + endpoints[region][1][c] * weight + 32) >> 6;
+                    rgb[c] = XMConvertHalfToFloat(FinishUnquantize(value, isSigned));
+                }
+
+                pixels[j] = DirectX::XMFLOAT4(rgb[0], rgb[1], rgb[2], 1.f);
+            }
+        }
+    }
+
+    // Decodes the top mip of a DDS file image in memory. Throws for formats other than
+    // R16G16B16A16_FLOAT, R32G32B32A32_FLOAT, BC6H_UF16, and BC6H_SF16.
+    inline HDRImage LoadHDRImage(_In_reads_bytes_(size) const uint8_t* data, size_t size)
+    {
+        constexpr uint32_t c_magic = 0x20534444; // "DDS "
+        constexpr size_t c_headerSize = 4 + 124;
+        constexpr size_t c_dx10HeaderSize = 20;
+
+        auto read32 = [&](size_t offset)
+            {
+                uint32_t value;
+                memcpy(&value, data + offset, sizeof(value));
+                return value;
+            };
+
+        if (size < c_headerSize || read32(0) != c_magic || read32(4) != 124)
+            throw std::runtime_error("Not a DDS file");
+
+        HDRImage image = {};
+        image.height = read32(12);
+        image.width = read32(16);
+
+        const uint32_t fourCC = read32(84);
+
+        size_t offset = c_headerSize;
+        uint32_t format = 0;
+        if (fourCC == 0x30315844) // "DX10"
+        {
+            if (size < c_headerSize + c_dx10HeaderSize)
+                throw std::runtime_error("Truncated DDS file");
+
+            format = read32(c_headerSize);
+            offset += c_dx10HeaderSize;
+        }
+        else if (fourCC == 113) // D3DFMT_A16B16G16R16F
+        {
+            format = 10;
+        }
+        else if (fourCC == 116) // D3DFMT_A32B32G32R32F
+        {
+            format = 2;
+        }
+
+        const size_t pixelCount = size_t(image.width) * size_t(image.height);
+        image.pixels.resize(pixelCount);
+
+        switch (format)
+        {
+        case 2: // DXGI_FORMAT_R32G32B32A32_FLOAT
+            if (size - offset < pixelCount * 16)
+                throw std::runtime_error("Truncated DDS file");
+
+            memcpy(image.pixels.data(), data + offset, pixelCount * 16);
+            break;
+
+        case 10: // DXGI_FORMAT_R16G16B16A16_FLOAT
+            if (size - offset < pixelCount * 8)
+                throw std::runtime_error("Truncated DDS file");
+
+            DirectX::PackedVector::XMConvertHalfToFloatStream(&image.pixels.front().x, sizeof(float),
+                reinterpret_cast<const DirectX::PackedVector::HALF*>(data + offset), sizeof(uint16_t), pixelCount * 4);
+            break;
+
+        case 95: // DXGI_FORMAT_BC6H_UF16
+        case 96: // DXGI_FORMAT_BC6H_SF16
+            {
+                const size_t blocksWide = (size_t(image.width) + 3) / 4;
+                const size_t blocksHigh = (size_t(image.height) + 3) / 4;
+                if (size - offset < blocksWide * blocksHigh * 16)
+                    throw std::runtime_error("Truncated DDS file");
+
+                DirectX::XMFLOAT4 block[16];
+                const uint8_t* source = data + offset;
+                for (size_t by = 0; by < blocksHigh; ++by)
+                {
+                    for (size_t bx = 0; bx < blocksWide; ++bx, source += 16)
+                    {
+                        BC6H::DecodeBlock(source, format == 96, block);
+
+                        for (size_t y = 0; y < 4 && by * 4 + y < image.height; ++y)
+                        {
+                            for (size_t x = 0; x < 4 && bx * 4 + x < image.width; ++x)
+                            {
+                                image.pixels[(by * 4 + y) * image.width + bx * 4 + x] = block[y * 4 + x];
+                            }
+                        }
+                    }
+                }
+            }
+            break;
+
+        default:
+            throw std::runtime_error("Unsupported DDS format for HDRImage");
+        }
+
+        return image;
+    }
+}
@@ -0,0 +1,285 @@
+//--------------------------------------------------------------------------------------
+// File: InputEvents.h
+//
+// Coalesces polled Keyboard, Mouse, and GamePad state into a per-frame event queue
+//
+// Consumers iterate only the edges that occurred this frame (key and button
+// transitions, axis motion beyond a dead zone, connect/disconnect) rather than
+// re-testing every button of every device.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "InputRecorder.h"
+#include "KeyboardTransitions.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <intrin.h>
+
+
+namespace DX
+{
+    struct InputEvent
+    {
+        enum Type : uint8_t
+        {
+            KeyPressed,
+            KeyReleased,
+            MouseButtonPressed,
+            MouseButtonReleased,
+            MouseMoved,
+            MouseWheel,
+            GamePadConnected,
+            GamePadDisconnected,
+            GamePadButtonPressed,
+            GamePadButtonReleased,
+            GamePadAxisMoved,
+        };
+
+        // Mouse button codes (bit order of InputStream::GetMouseButtons).
+        enum MouseButton : uint8_t
+        {
+            MouseLeft,
+            MouseMiddle,
+            MouseRight,
+            MouseX1,
+            MouseX2,
+        };
+
+        // GamePad button codes (bit order of InputStream::GetGamePadButtons).
+        enum GamePadButton : uint8_t
+        {
+            ButtonA,
+            ButtonB,
+            ButtonX,
+            ButtonY,
+            ButtonLeftStick,
+            ButtonRightStick,
+            ButtonLeftShoulder,
+            ButtonRightShoulder,
+            ButtonBack,
+            ButtonStart,
+            ButtonDPadUp,
+            ButtonDPadDown,
+            ButtonDPadRight,
+            ButtonDPadLeft,
+        };
+
+        // GamePad axis codes (order of InputStream::GetGamePadAxes).
+        enum GamePadAxis : uint8_t
+        {
+            AxisLeftX,
+            AxisLeftY,
+            AxisRightX,
+            AxisRightY,
+            AxisLeftTrigger,
+            AxisRightTrigger,
+        };
+
+        Type        type;
+        uint8_t     code;       // Keyboard::Keys, MouseButton, GamePadButton, or GamePadAxis
+        uint16_t    player;     // GamePad slot for GamePad events
+
+        union
+        {
+            float   value;      // GamePadAxisMoved: new axis position
+            int32_t x;          // MouseMoved: position (absolute) or delta (relative); MouseWheel: delta
+        };
+
+        union
+        {
+            float   delta;      // GamePadAxisMoved: change since the last reported position
+            int32_t y;          // MouseMoved
+        };
+    };
+
+    class InputEventQueue
+    {
+    public:
+        explicit InputEventQueue(float axisDeadZone = 0.05f) noexcept(false) :
+            m_axisDeadZone(axisDeadZone),
+            m_lastMouse{},
+            m_lastMouseButtons(0)
+        {
+            m_events.reserve(64);
+        }
+
+        InputEventQueue(InputEventQueue&&) = default;
+        InputEventQueue& operator= (InputEventQueue&&) = default;
+
+        InputEventQueue(InputEventQueue const&) = delete;
+        InputEventQueue& operator= (InputEventQueue const&) = delete;
+
+        // Call once at the start of each frame before feeding device state.
+        void BeginFrame() noexcept { m_events.clear(); }
+
+        // Convenience for a full InputFrame (e.g. from InputReplayer).
+        void Update(const InputFrame& frame)
+        {
+            BeginFrame();
+            UpdateKeyboard(frame.keyboard);
+            UpdateMouse(frame.mouse);
+            for (size_t j = 0; j < InputStream::c_MaxPlayers; ++j)
+            {
+                UpdateGamePad(j, frame.gamePads[j]);
+            }
+        }
+
+        void UpdateKeyboard(const DirectX::Keyboard::State& state)
+        {
+            m_keys.Update(state);
+            if (!m_keys.changed.Any())
+                return;
+
+            m_keys.pressed.ForEach([&](DirectX::Keyboard::Keys key)
+                {
+                    Push(InputEvent::KeyPressed, static_cast<uint8_t>(key), 0);
+                });
+            m_keys.released.ForEach([&](DirectX::Keyboard::Keys key)
+                {
+                    Push(InputEvent::KeyReleased, static_cast<uint8_t>(key), 0);
+                });
+        }
+
+        void UpdateMouse(const DirectX::Mouse::State& state)
+        {
+            const uint32_t buttons = InputStream::GetMouseButtons(state);
+            EmitButtons(buttons, m_lastMouseButtons, InputEvent::MouseButtonPressed, InputEvent::MouseButtonReleased, 0);
+            m_lastMouseButtons = buttons;
+
+            const bool moved = (state.positionMode == DirectX::Mouse::MODE_RELATIVE)
+                ? (state.x != 0 || state.y != 0)
+                : (state.x != m_lastMouse.x || state.y != m_lastMouse.y);
+            if (moved)
+            {
+                auto& evt = Push(InputEvent::MouseMoved, 0, 0);
+                evt.x = state.x;
+                evt.y = state.y;
+            }
+
+            if (state.scrollWheelValue != m_lastMouse.scrollWheelValue)
+            {
+                auto& evt = Push(InputEvent::MouseWheel, 0, 0);
+                evt.x = state.scrollWheelValue - m_lastMouse.scrollWheelValue;
+                evt.y = 0;
+            }
+
+            m_lastMouse = state;
+        }
+
+        // Player may exceed GamePad::MAX_PLAYER_COUNT so that simulated controllers can be fed in.
+        void UpdateGamePad(size_t player, const DirectX::GamePad::State& state)
+        {
+            if (player >= m_pads.size())
+            {
+                m_pads.resize(player + 1);
+            }
+
+            auto& last = m_pads[player];
+            const auto slot = static_cast<uint16_t>(player);
+
+            if (!state.connected)
+            {
+                if (last.connected)
+                {
+                    // Held buttons are implicitly released by a disconnect.
+                    Push(InputEvent::GamePadDisconnected, 0, slot);
+                    last = {};
+                }
+                return;
+            }
+
+            if (!last.connected)
+            {
+                Push(InputEvent::GamePadConnected, 0, slot);
+                last.connected = true;
+            }
+            else if (state.packet != 0 && state.packet == last.packet)
+            {
+                // Nothing changed since the previous poll.
+                return;
+            }
+
+            last.packet = state.packet;
+
+            const uint32_t buttons = InputStream::GetGamePadButtons(state);
+            EmitButtons(buttons, last.buttons, InputEvent::GamePadButtonPressed, InputEvent::GamePadButtonReleased, slot);
+            last.buttons = buttons;
+
+            float axes[InputStream::c_GamePadAxes];
+            InputStream::GetGamePadAxes(state, axes);
+            for (size_t j = 0; j < InputStream::c_GamePadAxes; ++j)
+            {
+                const float delta = axes[j] - last.axes[j];
+
+                // Always report returning to rest so consumers don't keep a stale small value.
+                if (std::fabs(delta) > m_axisDeadZone || (axes[j] == 0.f && last.axes[j] != 0.f))
+                {
+                    auto& evt = Push(InputEvent::GamePadAxisMoved, static_cast<uint8_t>(j), slot);
+                    evt.value = axes[j];
+                    evt.delta = delta;
+                    last.axes[j] = axes[j];
+                }
+            }
+        }
+
+        // Forget all previous device state (e.g. after focus loss).
+        void Reset() noexcept
+        {
+            m_events.clear();
+            m_keys.Reset();
+            m_lastMouse = {};
+            m_lastMouseButtons = 0;
+            m_pads.clear();
+        }
+
+        const std::vector<InputEvent>& GetEvents() const noexcept { return m_events; }
+
+        void SetAxisDeadZone(float deadZone) noexcept { m_axisDeadZone = deadZone; }
+
+    private:
+        struct PadState
+        {
+            bool        connected;
+            uint64_t    packet;
+            uint32_t    buttons;
+            float       axes[InputStream::c_GamePadAxes];
+        };
+
+        InputEvent& Push(InputEvent::Type type, uint8_t code, uint16_t player)
+        {
+            InputEvent evt = {};
+            evt.type = type;
+            evt.code = code;
+            evt.player = player;
+            m_events.push_back(evt);
+            return m_events.back();
+        }
+
+        void EmitButtons(uint32_t buttons, uint32_t last, InputEvent::Type pressed, InputEvent::Type released, uint16_t player)
+        {
+            uint32_t changed = buttons ^ last;
+            while (changed)
+            {
+                unsigned long index;
+                _BitScanForward(&index, changed);
+                changed &= changed - 1;
+
+                Push((buttons & (1u << index)) ? pressed : released, static_cast<uint8_t>(index), player);
+            }
+        }
+
+        float                       m_axisDeadZone;
+        KeyboardTransitions         m_keys;
+        DirectX::Mouse::State       m_lastMouse;
+        uint32_t                    m_lastMouseButtons;
+        std::vector<PadState>       m_pads;
+        std::vector<InputEvent>     m_events;
+    };
+}
@@ -0,0 +1,387 @@
+//--------------------------------------------------------------------------------------
+// File: InputRecorder.h
+//
+// Deterministic record/replay of per-frame Keyboard, Mouse, and GamePad state
+//
+// The stream is delta-encoded: each frame stores a change mask followed by a packed
+// record for every device whose state differs from the previous frame. Replaying it
+// feeds the DirectX Tool Kit state trackers without requiring any OS input device.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <GamePad.h>
+#include <Keyboard.h>
+#include <Mouse.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // Snapshot of all input devices for a single frame.
+    struct InputFrame
+    {
+        DirectX::Keyboard::State    keyboard;
+        DirectX::Mouse::State       mouse;
+        DirectX::GamePad::State     gamePads[DirectX::GamePad::MAX_PLAYER_COUNT];
+    };
+
+    namespace InputStream
+    {
+        constexpr uint32_t c_Magic = 0x52495844; // "DXIR"
+        constexpr uint32_t c_Version = 1;
+
+        constexpr size_t c_MaxPlayers = static_cast<size_t>(DirectX::GamePad::MAX_PLAYER_COUNT);
+
+        constexpr size_t c_KeyboardSize = 32;
+        constexpr size_t c_MouseSize = 2 + 3 * sizeof(int32_t);
+        constexpr size_t c_GamePadSize = 1 + sizeof(uint32_t) + sizeof(uint64_t) + 6 * sizeof(float);
+        constexpr size_t c_MaxRecordSize = c_GamePadSize;
+
+        constexpr uint32_t c_KeyboardBit = 0x1;
+        constexpr uint32_t c_MouseBit = 0x2;
+        constexpr uint32_t c_FirstGamePadBit = 2;
+
+        static_assert(sizeof(DirectX::Keyboard::State) == c_KeyboardSize, "Keyboard::State is expected to be a 256-bit mask");
+        static_assert(c_KeyboardSize <= c_MaxRecordSize && c_MouseSize <= c_MaxRecordSize, "Record buffer too small");
+        static_assert(c_FirstGamePadBit + c_MaxPlayers <= 16, "Change mask is 16 bits");
+
+        inline void PackKeyboard(const DirectX::Keyboard::State& state, uint8_t* out) noexcept
+        {
+            memcpy(out, &state, c_KeyboardSize);
+        }
+
+        inline void UnpackKeyboard(const uint8_t* in, DirectX::Keyboard::State& state) noexcept
+        {
+            memcpy(&state, in, c_KeyboardSize);
+        }
+
+        // Mouse buttons as a bitmask: left, middle, right, xButton1, xButton2.
+        inline uint32_t GetMouseButtons(const DirectX::Mouse::State& state) noexcept
+        {
+            return (state.leftButton ? 0x1u : 0u)
+                | (state.middleButton ? 0x2u : 0u)
+                | (state.rightButton ? 0x4u : 0u)
+                | (state.xButton1 ? 0x8u : 0u)
+                | (state.xButton2 ? 0x10u : 0u);
+        }
+
+        inline void PackMouse(const DirectX::Mouse::State& state, uint8_t* out) noexcept
+        {
+            out[0] = static_cast<uint8_t>(GetMouseButtons(state));
+            out[1] = static_cast<uint8_t>(state.positionMode);
+
+            const int32_t values[3] = { state.x, state.y, state.scrollWheelValue };
+            memcpy(out + 2, values, sizeof(values));
+        }
+
+        inline void UnpackMouse(const uint8_t* in, DirectX::Mouse::State& state) noexcept
+        {
+            state.leftButton = (in[0] & 0x1) != 0;
+            state.middleButton = (in[0] & 0x2) != 0;
+            state.rightButton = (in[0] & 0x4) != 0;
+            state.xButton1 = (in[0] & 0x8) != 0;
+            state.xButton2 = (in[0] & 0x10) != 0;
+            state.positionMode = static_cast<DirectX::Mouse::Mode>(in[1]);
+
+            int32_t values[3] = {};
+            memcpy(values, in + 2, sizeof(values));
+            state.x = values[0];
+            state.y = values[1];
+            state.scrollWheelValue = values[2];
+        }
+
+        // GamePad digital buttons as a bitmask: a, b, x, y, leftStick, rightStick, leftShoulder,
+        // rightShoulder, back, start, dpad up, down, right, left.
+        constexpr size_t c_GamePadButtons = 14;
+
+        inline uint32_t GetGamePadButtons(const DirectX::GamePad::State& state) noexcept
+        {
+            const bool buttons[c_GamePadButtons] =
+            {
+                state.buttons.a, state.buttons.b, state.buttons.x, state.buttons.y,
+                state.buttons.leftStick, state.buttons.rightStick,
+                state.buttons.leftShoulder, state.buttons.rightShoulder,
+                state.buttons.back, state.buttons.start,
+                state.dpad.up, state.dpad.down, state.dpad.right, state.dpad.left,
+            };
+
+            uint32_t mask = 0;
+            for (size_t j = 0; j < c_GamePadButtons; ++j)
+            {
+                if (buttons[j])
+                    mask |= (1u << j);
+            }
+            return mask;
+        }
+
+        // GamePad analog axes: left X/Y, right X/Y, left trigger, right trigger.
+        constexpr size_t c_GamePadAxes = 6;
+
+        inline void GetGamePadAxes(const DirectX::GamePad::State& state, float* axes) noexcept
+        {
+            axes[0] = state.thumbSticks.leftX;
+            axes[1] = state.thumbSticks.leftY;
+            axes[2] = state.thumbSticks.rightX;
+            axes[3] = state.thumbSticks.rightY;
+            axes[4] = state.triggers.left;
+            axes[5] = state.triggers.right;
+        }
+
+        inline void PackGamePad(const DirectX::GamePad::State& state, uint8_t* out) noexcept
+        {
+            const uint32_t mask = GetGamePadButtons(state);
+
+            float axes[c_GamePadAxes];
+            GetGamePadAxes(state, axes);
+
+            out[0] = state.connected ? 1 : 0;
+            memcpy(out + 1, &mask, sizeof(mask));
+            memcpy(out + 1 + sizeof(mask), &state.packet, sizeof(uint64_t));
+            memcpy(out + 1 + sizeof(mask) + sizeof(uint64_t), axes, sizeof(axes));
+        }
+
+        inline void UnpackGamePad(const uint8_t* in, DirectX::GamePad::State& state) noexcept
+        {
+            uint32_t mask = 0;
+            float axes[c_GamePadAxes] = {};
+            memcpy(&mask, in + 1, sizeof(mask));
+            memcpy(&state.packet, in + 1 + sizeof(mask), sizeof(uint64_t));
+            memcpy(axes, in + 1 + sizeof(mask) + sizeof(uint64_t), sizeof(axes));
+
+            state.connected = (in[0] != 0);
+
+            bool* const buttons[c_GamePadButtons] =
+            {
+                &state.buttons.a, &state.buttons.b, &state.buttons.x, &state.buttons.y,
+                &state.buttons.leftStick, &state.buttons.rightStick,
+                &state.buttons.leftShoulder, &state.buttons.rightShoulder,
+                &state.buttons.back, &state.buttons.start,
+                &state.dpad.up, &state.dpad.down, &state.dpad.right, &state.dpad.left,
+            };
+
+            for (size_t j = 0; j < std::size(buttons); ++j)
+            {
+                *buttons[j] = (mask & (1u << j)) != 0;
+            }
+
+            state.thumbSticks.leftX = axes[0];
+            state.thumbSticks.leftY = axes[1];
+            state.thumbSticks.rightX = axes[2];
+            state.thumbSticks.rightY = axes[3];
+            state.triggers.left = axes[4];
+            state.triggers.right = axes[5];
+        }
+    }
+
+    // Captures per-frame input state into a compact binary stream.
+    class InputRecorder
+    {
+    public:
+        InputRecorder() noexcept(false) :
+            m_frameCount(0),
+            m_last{}
+        {
+            Clear();
+        }
+
+        InputRecorder(InputRecorder&&) = default;
+        InputRecorder& operator= (InputRecorder&&) = default;
+
+        InputRecorder(InputRecorder const&) = delete;
+        InputRecorder& operator= (InputRecorder const&) = delete;
+
+        void Record(const InputFrame& frame)
+        {
+            using namespace InputStream;
+
+            const size_t maskOffset = m_stream.size();
+            m_stream.resize(maskOffset + sizeof(uint16_t));
+
+            uint32_t mask = 0;
+            uint8_t packed[c_MaxRecordSize] = {};
+
+            PackKeyboard(frame.keyboard, packed);
+            mask |= Append(c_KeyboardBit, packed, m_last.keyboard, c_KeyboardSize);
+
+            PackMouse(frame.mouse, packed);
+            mask |= Append(c_MouseBit, packed, m_last.mouse, c_MouseSize);
+
+            for (size_t j = 0; j < InputStream::c_MaxPlayers; ++j)
+            {
+                PackGamePad(frame.gamePads[j], packed);
+                mask |= Append(1u << (c_FirstGamePadBit + j), packed, m_last.gamePads[j], c_GamePadSize);
+            }
+
+            const auto mask16 = static_cast<uint16_t>(mask);
+            memcpy(m_stream.data() + maskOffset, &mask16, sizeof(mask16));
+
+            ++m_frameCount;
+        }
+
+        void Clear()
+        {
+            m_stream.clear();
+            m_frameCount = 0;
+
+            const uint32_t header[3] = { InputStream::c_Magic, InputStream::c_Version, static_cast<uint32_t>(InputStream::c_MaxPlayers) };
+            m_stream.resize(sizeof(header));
+            memcpy(m_stream.data(), header, sizeof(header));
+        }
+
+        void Save(_In_z_ const wchar_t* fileName) const
+        {
+            std::ofstream outFile(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+            if (!outFile)
+                throw std::runtime_error("InputRecorder::Save");
+
+            outFile.write(reinterpret_cast<const char*>(m_stream.data()), static_cast<std::streamsize>(m_stream.size()));
+            if (!outFile)
+                throw std::runtime_error("InputRecorder::Save");
+        }
+
+        const std::vector<uint8_t>& GetStream() const noexcept { return m_stream; }
+        size_t GetFrameCount() const noexcept { return m_frameCount; }
+
+    private:
+        struct LastState
+        {
+            uint8_t keyboard[InputStream::c_KeyboardSize];
+            uint8_t mouse[InputStream::c_MouseSize];
+            uint8_t gamePads[InputStream::c_MaxPlayers][InputStream::c_GamePadSize];
+        };
+
+        uint32_t Append(uint32_t bit, const uint8_t* packed, uint8_t* last, size_t size)
+        {
+            if (m_frameCount > 0 && memcmp(packed, last, size) == 0)
+                return 0;
+
+            memcpy(last, packed, size);
+            m_stream.insert(m_stream.end(), packed, packed + size);
+            return bit;
+        }
+
+        std::vector<uint8_t>    m_stream;
+        size_t                  m_frameCount;
+        LastState               m_last;
+    };
+
+    // Ends an interactive capture: writes the stream to 'fileName' and clears the recorder
+    // either way, so a session that toggles capture never holds more than one recording.
+    inline void SaveCapture(InputRecorder& recorder, _In_z_ const wchar_t* fileName) noexcept
+    {
+        char buff[128] = {};
+        try
+        {
+            recorder.Save(fileName);
+            sprintf_s(buff, "INFO: Saved %zu captured input frames to %ls\n", recorder.GetFrameCount(), fileName);
+        }
+        catch (const std::exception&)
+        {
+            sprintf_s(buff, "ERROR: Failed saving captured input to %ls\n", fileName);
+        }
+        OutputDebugStringA(buff);
+
+        recorder.Clear();
+    }
+
+    // Plays back a stream produced by InputRecorder (e.g. loaded with DX::ReadData).
+    class InputReplayer
+    {
+    public:
+        explicit InputReplayer(std::vector<uint8_t> stream) noexcept(false) :
+            m_stream(std::move(stream)),
+            m_offset(0),
+            m_current{}
+        {
+            uint32_t header[3] = {};
+            if (m_stream.size() < sizeof(header))
+                throw std::runtime_error("InputReplayer: stream too small");
+
+            memcpy(header, m_stream.data(), sizeof(header));
+            if (header[0] != InputStream::c_Magic || header[1] != InputStream::c_Version)
+                throw std::runtime_error("InputReplayer: not an input recording");
+
+            if (header[2] != InputStream::c_MaxPlayers)
+                throw std::runtime_error("InputReplayer: recorded with a different player count");
+
+            Rewind();
+        }
+
+        InputReplayer(InputReplayer&&) = default;
+        InputReplayer& operator= (InputReplayer&&) = default;
+
+        InputReplayer(InputReplayer const&) = delete;
+        InputReplayer& operator= (InputReplayer const&) = delete;
+
+        // Advances to the next frame. Returns false at the end of the stream.
+        bool Next(InputFrame& frame)
+        {
+            using namespace InputStream;
+
+            if (m_offset >= m_stream.size())
+                return false;
+
+            uint16_t mask = 0;
+            Read(&mask, sizeof(mask));
+
+            if (mask & c_KeyboardBit)
+            {
+                UnpackKeyboard(Consume(c_KeyboardSize), m_current.keyboard);
+            }
+
+            if (mask & c_MouseBit)
+            {
+                UnpackMouse(Consume(c_MouseSize), m_current.mouse);
+            }
+
+            for (size_t j = 0; j < InputStream::c_MaxPlayers; ++j)
+            {
+                if (mask & (1u << (c_FirstGamePadBit + j)))
+                {
+                    UnpackGamePad(Consume(c_GamePadSize), m_current.gamePads[j]);
+                }
+            }
+
+            frame = m_current;
+            return true;
+        }
+
+        void Rewind() noexcept
+        {
+            m_offset = 3 * sizeof(uint32_t);
+            m_current = {};
+        }
+
+    private:
+        const uint8_t* Consume(size_t size)
+        {
+            if (m_offset + size > m_stream.size())
+                throw std::runtime_error("InputReplayer: truncated stream");
+
+            auto ptr = m_stream.data() + m_offset;
+            m_offset += size;
+            return ptr;
+        }
+
+        void Read(void* dest, size_t size)
+        {
+            memcpy(dest, Consume(size), size);
+        }
+
+        std::vector<uint8_t>    m_stream;
+        size_t                  m_offset;
+        InputFrame              m_current;
+    };
+}
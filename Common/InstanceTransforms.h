@@ -0,0 +1,94 @@
+//--------------------------------------------------------------------------------------
+// File: InstanceTransforms.h
+//
+// Builds per-instance XMFLOAT3X4 vertex streams directly in upload memory
+//
+// Transforms are transposed in registers and written as three full float4 rows,
+// which suits write-combined upload heaps (no staging array, no read-back). Large
+// batches can be split across the workers of a RecordingJobSystem.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "ParallelRecording.h"
+
+#include <DirectXMath.h>
+#include <GraphicsMemory.h>
+
+#include <algorithm>
+#include <cstddef>
+
+
+namespace DX
+{
+    // Batches smaller than this are packed on the calling thread.
+    constexpr size_t c_InstanceParallelThreshold = 16384;
+
+    inline void XM_CALLCONV StoreInstanceTransform(_Out_ DirectX::XMFLOAT3X4* pDestination, _In_ DirectX::FXMMATRIX M) noexcept
+    {
+        using namespace DirectX;
+
+        const XMMATRIX t = XMMatrixTranspose(M);
+
+        auto rows = reinterpret_cast<XMFLOAT4*>(pDestination);
+        XMStoreFloat4(&rows[0], t.r[0]);
+        XMStoreFloat4(&rows[1], t.r[1]);
+        XMStoreFloat4(&rows[2], t.r[2]);
+    }
+
+    // Writes transform(j) for j in [0, count). With 'jobs', a batch that reaches the parallel
+    // threshold is split across its workers, so 'transform' must then be safe to call
+    // concurrently. 'jobs' must not be running another batch (i.e. don't call this from a job).
+    template<typename TFunc>
+    void PackInstanceTransforms(_Out_writes_(count) DirectX::XMFLOAT3X4* pDestination, size_t count, TFunc&& transform,
+        _In_opt_ RecordingJobSystem* jobs = nullptr, size_t parallelThreshold = c_InstanceParallelThreshold)
+    {
+        auto packRange = [&](size_t begin, size_t end)
+        {
+            for (size_t j = begin; j < end; ++j)
+            {
+                StoreInstanceTransform(&pDestination[j], transform(j));
+            }
+        };
+
+        if (!jobs || jobs->GetWorkerCount() < 2 || count < parallelThreshold)
+        {
+            packRange(0, count);
+            return;
+        }
+
+        // Keep each chunk large enough that waking a worker stays negligible.
+        const size_t chunks = std::min(jobs->GetWorkerCount(), std::max<size_t>(count / (parallelThreshold / 2), 1));
+        const size_t chunk = (count + chunks - 1) / chunks;
+
+        jobs->Run(chunks, [&](size_t index, size_t)
+            {
+                const size_t begin = index * chunk;
+                packRange(begin, std::min(count, begin + chunk));
+            });
+    }
+
+    // Allocates upload memory for 'count' instances, packs them in place, and returns the view
+    // to bind as the per-instance vertex stream. An empty batch (e.g. everything culled) yields a
+    // null view.
+    template<typename TFunc>
+    D3D12_VERTEX_BUFFER_VIEW CreateInstanceTransformBuffer(DirectX::GraphicsMemory& graphicsMemory, size_t count, TFunc&& transform,
+        _In_opt_ RecordingJobSystem* jobs = nullptr)
+    {
+        if (!count)
+            return {};
+
+        const size_t instBytes = count * sizeof(DirectX::XMFLOAT3X4);
+
+        DirectX::GraphicsResource inst = graphicsMemory.Allocate(instBytes);
+        PackInstanceTransforms(static_cast<DirectX::XMFLOAT3X4*>(inst.Memory()), count, std::forward<TFunc>(transform), jobs);
+
+        D3D12_VERTEX_BUFFER_VIEW view = {};
+        view.BufferLocation = inst.GpuAddress();
+        view.SizeInBytes = static_cast<UINT>(instBytes);
+        view.StrideInBytes = sizeof(DirectX::XMFLOAT3X4);
+        return view;
+    }
+}
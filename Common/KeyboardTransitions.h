@@ -0,0 +1,117 @@
+//--------------------------------------------------------------------------------------
+// File: KeyboardTransitions.h
+//
+// Batched pressed/released detection for all 256 virtual keys of a Keyboard::State
+//
+// KeyboardStateTracker answers IsKeyPressed/IsKeyReleased one key at a time. This
+// helper computes the full edge bitsets with 128-bit DirectXMath integer operations
+// (two vectors per 256-bit state) so callers can visit only the keys that changed.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <DirectXMath.h>
+#include <Keyboard.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <intrin.h>
+
+
+namespace DX
+{
+    // 256-bit set indexed by virtual key code.
+    struct KeyBitset
+    {
+        uint32_t bits[8];
+
+        bool IsSet(DirectX::Keyboard::Keys key) const noexcept
+        {
+            const auto vk = static_cast<unsigned int>(key);
+            return (bits[vk >> 5] & (1u << (vk & 0x1f))) != 0;
+        }
+
+        bool Any() const noexcept
+        {
+            using namespace DirectX;
+            const XMVECTOR v = XMVectorOrInt(XMLoadInt4(&bits[0]), XMLoadInt4(&bits[4]));
+            return !XMVector4EqualInt(v, XMVectorZero());
+        }
+
+        size_t Count() const noexcept
+        {
+            size_t count = 0;
+            for (auto v : bits)
+            {
+                v = v - ((v >> 1) & 0x55555555u);
+                v = (v & 0x33333333u) + ((v >> 2) & 0x33333333u);
+                count += (((v + (v >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24;
+            }
+            return count;
+        }
+
+        // Invokes func(Keyboard::Keys) for each set key in ascending order.
+        template<typename TFunc>
+        void ForEach(TFunc&& func) const
+        {
+            for (unsigned int word = 0; word < 8; ++word)
+            {
+                uint32_t mask = bits[word];
+                while (mask)
+                {
+                    unsigned long index;
+                    _BitScanForward(&index, mask);
+                    mask &= mask - 1;
+                    func(static_cast<DirectX::Keyboard::Keys>((word << 5) | index));
+                }
+            }
+        }
+    };
+
+    // Tracks keyboard state changes between frames for all keys at once.
+    class KeyboardTransitions
+    {
+    public:
+        KeyboardTransitions() noexcept { Reset(); }
+
+        void Update(const DirectX::Keyboard::State& state) noexcept
+        {
+            using namespace DirectX;
+
+            static_assert(sizeof(DirectX::Keyboard::State) == sizeof(KeyBitset), "Keyboard::State is expected to be a 256-bit mask");
+
+            uint32_t current[8];
+            memcpy(current, &state, sizeof(current));
+
+            for (size_t j = 0; j < 8; j += 4)
+            {
+                const XMVECTOR now = XMLoadInt4(&current[j]);
+                const XMVECTOR last = XMLoadInt4(&m_last.bits[j]);
+
+                XMStoreInt4(&changed.bits[j], XMVectorXorInt(now, last));
+                XMStoreInt4(&pressed.bits[j], XMVectorAndCInt(now, last));
+                XMStoreInt4(&released.bits[j], XMVectorAndCInt(last, now));
+                XMStoreInt4(&m_last.bits[j], now);
+            }
+        }
+
+        void Reset() noexcept
+        {
+            memset(&pressed, 0, sizeof(pressed));
+            memset(&released, 0, sizeof(released));
+            memset(&changed, 0, sizeof(changed));
+            memset(&m_last, 0, sizeof(m_last));
+        }
+
+        KeyBitset pressed;
+        KeyBitset released;
+        KeyBitset changed;
+
+    private:
+        KeyBitset m_last;
+    };
+}
@@ -293,6 +293,9 @@ namespace
 #endif // TRACE_WINDOWS_MESSAGES
 }
 
+// Set by -benchmark; tests only run their timing sweeps when it is set.
+bool g_benchmarks = false;
+
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 void ExitGame() noexcept;
 
@@ -304,6 +307,11 @@ namespace
         {
             g_testTimer = true;
         }
+
+        if (wcsstr(lpCmdLine, L"-benchmark") != nullptr)
+        {
+            g_benchmarks = true;
+        }
     }
 }
 
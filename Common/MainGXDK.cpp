@@ -33,6 +33,9 @@ namespace
 
 bool g_HDRMode = false;
 
+// Set by -benchmark; tests only run their timing sweeps when it is set.
+bool g_benchmarks = false;
+
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 void SetDisplayMode() noexcept;
 void ExitGame() noexcept;
@@ -45,6 +48,11 @@ namespace
         {
             g_testTimer = true;
         }
+
+        if (wcsstr(lpCmdLine, L"-benchmark") != nullptr)
+        {
+            g_benchmarks = true;
+        }
     }
 }
 
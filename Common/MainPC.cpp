@@ -285,6 +285,9 @@ namespace
 #endif // TRACE_WINDOWS_MESSAGES
 }
 
+// Set by -benchmark; tests only run their timing sweeps when it is set.
+bool g_benchmarks = false;
+
 LRESULT CALLBACK WndProc(HWND, UINT, WPARAM, LPARAM);
 void ExitGame() noexcept;
 
@@ -313,6 +316,10 @@ namespace
                 {
                     g_testTimer = true;
                 }
+                else if (_wcsicmp(pArg, L"benchmark") == 0)
+                {
+                    g_benchmarks = true;
+                }
                 else if (_wcsicmp(pArg, L"forcewarp") == 0)
                 {
                     DX::DeviceResources::DebugForceWarp(true);
@@ -22,6 +22,9 @@ using namespace DirectX;
 
 #pragma warning(disable : 4061)
 
+// The UWP entry point does not parse launch arguments, so timing sweeps stay off.
+bool g_benchmarks = false;
+
 void ExitGame() noexcept;
 void GetWindowBounds(_In_ IUnknown* window, _Out_ RECT* rect);
 
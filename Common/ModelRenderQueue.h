@@ -0,0 +1,198 @@
+//--------------------------------------------------------------------------------------
+// File: ModelRenderQueue.h
+//
+// DX::RenderQueue front end for DirectX Tool Kit Model draws
+//
+// Models are collected with the world matrix they would have been drawn with, then
+// submitted in one sorted pass. Effects are applied once per run of parts sharing an
+// effect and object, and vertex/index buffers only when they change.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "RenderQueue.h"
+
+#include <DirectXMath.h>
+#include <Effects.h>
+#include <Model.h>
+
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+
+namespace DX
+{
+    class ModelRenderQueue
+    {
+    public:
+        ModelRenderQueue() noexcept :
+            m_view{},
+            m_projection{},
+            m_farDistance(1.f),
+            m_stats{}
+        {
+        }
+
+        // Starts a new frame. 'farDistance' scales the depth field of the sort key.
+        void XM_CALLCONV Begin(DirectX::FXMMATRIX view, DirectX::CXMMATRIX projection, float farDistance)
+        {
+            using namespace DirectX;
+
+            XMStoreFloat4x4(&m_view, view);
+            XMStoreFloat4x4(&m_projection, projection);
+            m_farDistance = farDistance;
+
+            m_queue.Clear();
+            m_worlds.clear();
+        }
+
+        // Queues every part of 'model'. The effects must not be modified again until Submit,
+        // other than through the matrices this queue sets.
+        void XM_CALLCONV Add(const DirectX::Model& model, const DirectX::Model::EffectCollection& effects, DirectX::FXMMATRIX world)
+        {
+            using namespace DirectX;
+
+            const auto object = static_cast<uint32_t>(m_worlds.size());
+            m_worlds.emplace_back();
+            XMStoreFloat4x4(&m_worlds.back(), world);
+
+            const XMMATRIX worldView = XMMatrixMultiply(world, XMLoadFloat4x4(&m_view));
+
+            for (const auto& mit : model.meshes)
+            {
+                auto mesh = mit.get();
+                assert(mesh != nullptr);
+
+                const XMVECTOR center = XMVector3Transform(XMLoadFloat3(&mesh->boundingSphere.Center), worldView);
+                const uint32_t depth = RenderSortKey::QuantizeDepth(XMVectorGetX(XMVector3Length(center)), m_farDistance);
+
+                AddParts(mesh->opaqueMeshParts, effects, object, depth, false);
+                AddParts(mesh->alphaMeshParts, effects, object, depth, true);
+            }
+        }
+
+        // Sorts and records the queued draws. Returns the bind counts for this submission.
+        const RenderQueueStats& Submit(_In_ ID3D12GraphicsCommandList* commandList)
+        {
+            using namespace DirectX;
+
+            m_queue.Sort();
+
+            const XMMATRIX view = XMLoadFloat4x4(&m_view);
+            const XMMATRIX projection = XMLoadFloat4x4(&m_projection);
+
+            m_stats = m_queue.Emit([&](const RenderPacket& packet, uint32_t binds)
+                {
+                    auto part = static_cast<const ModelMeshPart*>(packet.draw);
+
+                    if (binds & RenderBind_State)
+                    {
+                        auto effect = static_cast<IEffect*>(const_cast<void*>(packet.state));
+
+                        auto imatrices = dynamic_cast<IEffectMatrices*>(effect);
+                        if (imatrices)
+                        {
+                            imatrices->SetMatrices(XMLoadFloat4x4(&m_worlds[packet.object]), view, projection);
+                        }
+
+                        effect->Apply(commandList);
+                    }
+
+                    if (binds & RenderBind_VertexBuffer)
+                    {
+                        D3D12_VERTEX_BUFFER_VIEW vbv;
+                        vbv.BufferLocation = packet.vertexBuffer;
+                        vbv.StrideInBytes = part->vertexStride;
+                        vbv.SizeInBytes = part->vertexBufferSize;
+                        commandList->IASetVertexBuffers(0, 1, &vbv);
+                    }
+
+                    if (binds & RenderBind_IndexBuffer)
+                    {
+                        D3D12_INDEX_BUFFER_VIEW ibv;
+                        ibv.BufferLocation = packet.indexBuffer;
+                        ibv.SizeInBytes = part->indexBufferSize;
+                        ibv.Format = part->indexFormat;
+                        commandList->IASetIndexBuffer(&ibv);
+                    }
+
+                    if (binds & RenderBind_Topology)
+                    {
+                        commandList->IASetPrimitiveTopology(part->primitiveType);
+                    }
+
+                    commandList->DrawIndexedInstanced(part->indexCount, 1, part->startIndex, part->vertexOffset, 0);
+                });
+
+            return m_stats;
+        }
+
+        // Forgets effect and buffer identities (e.g. on device lost).
+        void Reset()
+        {
+            m_queue.Clear();
+            m_worlds.clear();
+            m_stateIds.clear();
+            m_geometryIds.clear();
+        }
+
+        const RenderQueueStats& GetLastStats() const noexcept { return m_stats; }
+
+        // The queued packets, e.g. for recording a frame's draw stream.
+        const RenderQueue& GetQueue() const noexcept { return m_queue; }
+
+    private:
+        void AddParts(const DirectX::ModelMeshPart::Collection& parts, const DirectX::Model::EffectCollection& effects,
+            uint32_t object, uint32_t depth, bool alpha)
+        {
+            for (const auto& it : parts)
+            {
+                auto part = it.get();
+                assert(part != nullptr);
+                assert(part->partIndex < effects.size());
+
+                auto effect = effects[part->partIndex].get();
+                assert(effect != nullptr);
+
+                RenderPacket packet = {};
+                packet.state = effect;
+                packet.object = object;
+                packet.topology = static_cast<uint32_t>(part->primitiveType);
+                packet.vertexBuffer = part->staticVertexBuffer ? part->staticVertexBuffer->GetGPUVirtualAddress() : part->vertexBuffer.GpuAddress();
+                packet.indexBuffer = part->staticIndexBuffer ? part->staticIndexBuffer->GetGPUVirtualAddress() : part->indexBuffer.GpuAddress();
+                packet.draw = part;
+
+                const uint32_t state = Intern(m_stateIds, static_cast<const void*>(effect));
+                const uint32_t geometry = Intern(m_geometryIds, packet.vertexBuffer);
+                packet.key = alpha
+                    ? RenderSortKey::MakeTransparent(state, object, geometry, depth)
+                    : RenderSortKey::MakeOpaque(state, object, geometry, depth);
+
+                m_queue.Push(packet);
+            }
+        }
+
+        // Dense ids keep unrelated effects and buffers from colliding in the narrow key fields.
+        // They persist across frames so the order stays stable.
+        template<typename T>
+        static uint32_t Intern(std::unordered_map<T, uint32_t>& ids, T value)
+        {
+            return ids.emplace(value, static_cast<uint32_t>(ids.size())).first->second;
+        }
+
+        DirectX::XMFLOAT4X4                             m_view;
+        DirectX::XMFLOAT4X4                             m_projection;
+        float                                           m_farDistance;
+
+        RenderQueue                                     m_queue;
+        RenderQueueStats                                m_stats;
+        std::vector<DirectX::XMFLOAT4X4>                m_worlds;
+
+        std::unordered_map<const void*, uint32_t>       m_stateIds;
+        std::unordered_map<uint64_t, uint32_t>          m_geometryIds;
+    };
+}
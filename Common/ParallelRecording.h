@@ -0,0 +1,344 @@
+//--------------------------------------------------------------------------------------
+// File: ParallelRecording.h
+//
+// Records independent scene segments into separate command lists across worker
+// threads and submits them in segment order
+//
+// Each worker owns one command allocator and a pool of command lists per frame in
+// flight. Lists are handed out and reset by the backend (see
+// ParallelRecordingD3D12.h); a mock backend that logs each command lets the
+// submission order be checked against serial recording.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // Worker threads to spawn so that, with the calling thread, every core records.
+    inline size_t GetDefaultRecordingThreadCount() noexcept
+    {
+        const size_t hwThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+        return hwThreads - 1;
+    }
+
+    // Persistent worker threads that run a batch of indexed jobs. The calling thread joins in as
+    // worker 0, so a system with no threads simply runs the batch inline.
+    class RecordingJobSystem
+    {
+    public:
+        explicit RecordingJobSystem(size_t threadCount = GetDefaultRecordingThreadCount()) :
+            m_generation(0),
+            m_active(0),
+            m_exit(false),
+            m_job(nullptr),
+            m_context(nullptr),
+            m_jobCount(0),
+            m_nextJob(0)
+        {
+            m_threads.reserve(threadCount);
+            for (size_t j = 0; j < threadCount; ++j)
+            {
+                m_threads.emplace_back(&RecordingJobSystem::WorkerThread, this, j + 1);
+            }
+        }
+
+        RecordingJobSystem(RecordingJobSystem const&) = delete;
+        RecordingJobSystem& operator= (RecordingJobSystem const&) = delete;
+
+        ~RecordingJobSystem()
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_exit = true;
+            }
+            m_wake.notify_all();
+
+            for (auto& thread : m_threads)
+            {
+                thread.join();
+            }
+        }
+
+        // Including the calling thread.
+        size_t GetWorkerCount() const noexcept { return m_threads.size() + 1; }
+
+        // Calls job(index, worker) for each index in [0, jobCount) and returns once all have
+        // finished. A worker index is only ever used by one thread at a time. The first exception
+        // thrown by a job is rethrown here after the rest of the batch completes.
+        template<typename TFunc>
+        void Run(size_t jobCount, TFunc&& job)
+        {
+            if (!jobCount)
+                return;
+
+            using Job = std::remove_reference_t<TFunc>;
+
+            if (m_threads.empty() || jobCount == 1)
+            {
+                for (size_t j = 0; j < jobCount; ++j)
+                {
+                    job(j, 0);
+                }
+                return;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                assert(m_active == 0);
+
+                m_job = [](void* context, size_t index, size_t worker) { (*static_cast<Job*>(context))(index, worker); };
+                m_context = const_cast<void*>(static_cast<const void*>(&job));
+                m_jobCount = jobCount;
+                m_nextJob.store(0, std::memory_order_relaxed);
+                m_active = m_threads.size();
+                m_error = nullptr;
+                ++m_generation;
+            }
+            m_wake.notify_all();
+
+            Work(0);
+
+            std::exception_ptr error;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_done.wait(lock, [this] { return m_active == 0; });
+                m_job = nullptr;
+                m_context = nullptr;
+                error = std::exchange(m_error, nullptr);
+            }
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+    private:
+        void WorkerThread(size_t worker)
+        {
+            uint64_t seen = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_wake.wait(lock, [&] { return m_exit || m_generation != seen; });
+                    if (m_exit)
+                        return;
+                    seen = m_generation;
+                }
+
+                Work(worker);
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if (--m_active == 0)
+                {
+                    m_done.notify_one();
+                }
+            }
+        }
+
+        void Work(size_t worker) noexcept
+        {
+            for (;;)
+            {
+                const size_t index = m_nextJob.fetch_add(1, std::memory_order_relaxed);
+                if (index >= m_jobCount)
+                    break;
+
+                try
+                {
+                    m_job(m_context, index, worker);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    if (!m_error)
+                    {
+                        m_error = std::current_exception();
+                    }
+                }
+            }
+        }
+
+        std::vector<std::thread>    m_threads;
+        std::mutex                  m_mutex;
+        std::condition_variable     m_wake;
+        std::condition_variable     m_done;
+        uint64_t                    m_generation;
+        size_t                      m_active;
+        bool                        m_exit;
+        std::exception_ptr          m_error;
+
+        void                        (*m_job)(void*, size_t, size_t);
+        void*                       m_context;
+        size_t                      m_jobCount;
+        std::atomic<size_t>         m_nextJob;
+    };
+
+    // TBackend must provide:
+    //
+    //  using Allocator = ...;      // copyable handle that tests false when null, e.g. ComPtr<ID3D12CommandAllocator>
+    //  using CommandList = ...;    // copyable handle, e.g. ComPtr<ID3D12GraphicsCommandList>
+    //  Allocator CreateAllocator();
+    //  CommandList CreateCommandList(const Allocator& allocator);     // returned closed
+    //  void ResetAllocator(const Allocator& allocator);
+    //  void Begin(const CommandList& list, const Allocator& allocator);
+    //  void End(const CommandList& list);
+    //  void Execute(_In_reads_(count) const CommandList* lists, size_t count);
+    //
+    // The Create and Begin/End methods are called from worker threads and must be thread-safe
+    // (ID3D12Device is; each list and allocator is only touched by one thread at a time).
+    template<typename TBackend>
+    class ParallelCommandRecorder
+    {
+    public:
+        using Allocator = typename TBackend::Allocator;
+        using CommandList = typename TBackend::CommandList;
+
+        // 'frameCount' is the number of frames in flight (e.g. DeviceResources::GetBackBufferCount).
+        ParallelCommandRecorder(TBackend backend, size_t frameCount, size_t threadCount = GetDefaultRecordingThreadCount()) :
+            m_backend(std::move(backend)),
+            m_jobs(threadCount),
+            m_frames(frameCount),
+            m_frameIndex(0),
+            m_listCount(0)
+        {
+            assert(frameCount > 0);
+            for (auto& frame : m_frames)
+            {
+                frame.resize(m_jobs.GetWorkerCount());
+            }
+        }
+
+        ParallelCommandRecorder(ParallelCommandRecorder const&) = delete;
+        ParallelCommandRecorder& operator= (ParallelCommandRecorder const&) = delete;
+
+        // Reclaims the pools of 'frameIndex'. The GPU must be done with that frame's previous
+        // submission, as it is for DeviceResources::GetCurrentFrameIndex after Prepare.
+        void BeginFrame(size_t frameIndex)
+        {
+            assert(frameIndex < m_frames.size());
+            assert(m_segments.empty());
+
+            m_frameIndex = frameIndex;
+            for (auto& pool : m_frames[frameIndex])
+            {
+                if (pool.used > 0)
+                {
+                    m_backend.ResetAllocator(pool.allocator);
+                    pool.used = 0;
+                }
+            }
+        }
+
+        // Calls record(segment, commandList) for each segment in [0, segmentCount), each into its
+        // own open command list, across the worker threads. Segments must not share mutable state
+        // (e.g. the same effect instance). May be called more than once per frame; segments queue
+        // up in call order. If any segment throws, the whole batch is dropped from submission.
+        template<typename TFunc>
+        void Record(size_t segmentCount, TFunc&& record)
+        {
+            const size_t base = m_segments.size();
+            m_segments.resize(base + segmentCount);
+
+            auto& pools = m_frames[m_frameIndex];
+            auto recordSegment = [&](size_t segment, size_t worker)
+                {
+                    auto& pool = pools[worker];
+                    if (!pool.allocator)
+                    {
+                        pool.allocator = m_backend.CreateAllocator();
+                    }
+
+                    if (pool.used == pool.lists.size())
+                    {
+                        pool.lists.emplace_back(m_backend.CreateCommandList(pool.allocator));
+                        ++m_listCount;
+                    }
+
+                    const CommandList& list = pool.lists[pool.used++];
+                    m_backend.Begin(list, pool.allocator);
+                    try
+                    {
+                        record(segment, list);
+                    }
+                    catch (...)
+                    {
+                        m_backend.End(list);
+                        throw;
+                    }
+                    m_backend.End(list);
+
+                    m_segments[base + segment] = list;
+                };
+
+            try
+            {
+                m_jobs.Run(segmentCount, recordSegment);
+            }
+            catch (...)
+            {
+                m_segments.resize(base);
+                throw;
+            }
+        }
+
+        // Executes 'first' (if given) followed by every recorded segment in segment order, as one
+        // submission.
+        void Submit(_In_opt_ const CommandList* first = nullptr)
+        {
+            if (first)
+            {
+                m_segments.insert(m_segments.begin(), *first);
+            }
+
+            if (!m_segments.empty())
+            {
+                m_backend.Execute(m_segments.data(), m_segments.size());
+            }
+
+            m_segments.clear();
+        }
+
+        size_t GetWorkerCount() const noexcept { return m_jobs.GetWorkerCount(); }
+
+        // Command lists created so far, across all workers and frames. This levels off once every
+        // pool has grown to its steady-state size.
+        size_t GetCommandListCount() const noexcept { return m_listCount; }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+    private:
+        struct WorkerPool
+        {
+            WorkerPool() noexcept : allocator{}, used(0) {}
+
+            Allocator                   allocator;
+            std::vector<CommandList>    lists;
+            size_t                      used;
+        };
+
+        TBackend                                m_backend;
+        RecordingJobSystem                      m_jobs;
+        std::vector<std::vector<WorkerPool>>    m_frames;
+        size_t                                  m_frameIndex;
+        std::atomic<size_t>                     m_listCount;
+        std::vector<CommandList>                m_segments;
+    };
+}
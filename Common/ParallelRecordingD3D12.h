@@ -0,0 +1,95 @@
+//--------------------------------------------------------------------------------------
+// File: ParallelRecordingD3D12.h
+//
+// Direct3D 12 backend for DX::ParallelCommandRecorder
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "ParallelRecording.h"
+
+#include <vector>
+
+#include <wrl/client.h>
+
+
+namespace DX
+{
+    class D3D12CommandListBackend
+    {
+    public:
+        using Allocator = Microsoft::WRL::ComPtr<ID3D12CommandAllocator>;
+        using CommandList = Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>;
+
+        D3D12CommandListBackend(_In_ ID3D12Device* device, _In_ ID3D12CommandQueue* commandQueue) noexcept :
+            m_device(device),
+            m_commandQueue(commandQueue)
+        {
+        }
+
+        Allocator CreateAllocator()
+        {
+            Allocator allocator;
+            ThrowIfFailed(m_device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_GRAPHICS_PPV_ARGS(allocator.GetAddressOf())));
+            allocator->SetName(L"ParallelCommandRecorder");
+            return allocator;
+        }
+
+        CommandList CreateCommandList(const Allocator& allocator)
+        {
+            CommandList list;
+            ThrowIfFailed(m_device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr, IID_GRAPHICS_PPV_ARGS(list.GetAddressOf())));
+            ThrowIfFailed(list->Close());
+            list->SetName(L"ParallelCommandRecorder");
+            return list;
+        }
+
+        void ResetAllocator(const Allocator& allocator)
+        {
+            ThrowIfFailed(allocator->Reset());
+        }
+
+        void Begin(const CommandList& list, const Allocator& allocator)
+        {
+            ThrowIfFailed(list->Reset(allocator.Get(), nullptr));
+        }
+
+        void End(const CommandList& list)
+        {
+            ThrowIfFailed(list->Close());
+        }
+
+        void Execute(_In_reads_(count) const CommandList* lists, size_t count)
+        {
+            m_executeLists.resize(count);
+            for (size_t j = 0; j < count; ++j)
+            {
+                m_executeLists[j] = lists[j].Get();
+            }
+            m_commandQueue->ExecuteCommandLists(static_cast<UINT>(count), m_executeLists.data());
+        }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12Device>        m_device;
+        Microsoft::WRL::ComPtr<ID3D12CommandQueue>  m_commandQueue;
+        std::vector<ID3D12CommandList*>             m_executeLists;
+    };
+
+    using D3D12ParallelCommandRecorder = ParallelCommandRecorder<D3D12CommandListBackend>;
+
+    // Submits the frame's primary command list (e.g. DeviceResources::GetCommandList holding the
+    // clear) ahead of the recorded segments, then reopens it on 'allocator' so the frame can
+    // continue on it (e.g. the present barrier).
+    inline void SubmitParallelCommandLists(D3D12ParallelCommandRecorder& recorder,
+        _In_ ID3D12GraphicsCommandList* commandList, _In_ ID3D12CommandAllocator* allocator)
+    {
+        ThrowIfFailed(commandList->Close());
+
+        const D3D12CommandListBackend::CommandList primary(commandList);
+        recorder.Submit(&primary);
+
+        ThrowIfFailed(commandList->Reset(allocator, nullptr));
+    }
+}
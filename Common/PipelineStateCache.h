@@ -0,0 +1,352 @@
+//--------------------------------------------------------------------------------------
+// File: PipelineStateCache.h
+//
+// Deduplicating pipeline state cache with background compilation and a
+// serializable blob store
+//
+// Pipelines are keyed by a 64-bit hash of their full description (see
+// PipelineStateCacheD3D12.h for hashing D3D12_GRAPHICS_PIPELINE_STATE_DESC).
+// Compilation is delegated to a backend, so a mock device with a controllable
+// compile time can exercise deduplication, worker bounds, failed compiles, and
+// blobs the driver rejects.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "BackgroundWork.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // TBackend must provide:
+    //
+    //  using Pipeline = ...;       // copyable handle, e.g. ComPtr<ID3D12PipelineState>
+    //  using Description = ...;    // copyable; any memory it points to must outlive the compile
+    //  Pipeline Create(const Description& desc, const std::vector<uint8_t>* cachedBlob, bool& blobAccepted);
+    //  std::vector<uint8_t> GetCachedBlob(const Pipeline& pipeline);
+    //
+    // Create is called from worker threads and must be thread-safe (ID3D12Device is). If the
+    // driver rejects a cached blob, Create should compile from scratch and set 'blobAccepted' to
+    // false; the cache then counts a compile and replaces the stale blob. If Create throws, the
+    // exception reaches every waiter on that request and the key is forgotten, so the next
+    // request compiles again.
+    template<typename TBackend>
+    class PipelineStateCache
+    {
+    public:
+        using Pipeline = typename TBackend::Pipeline;
+        using Description = typename TBackend::Description;
+
+        // Misses compile on 'workerCount' threads (0 picks one fewer than the core count).
+        explicit PipelineStateCache(TBackend backend, size_t workerCount = 0) noexcept(false) :
+            m_backend(std::move(backend)),
+            m_requests(0),
+            m_hits(0),
+            m_blobHits(0),
+            m_compiles(0),
+            m_compileTime(0),
+            m_timeSaved(0),
+            m_workers(workerCount)
+        {
+        }
+
+        PipelineStateCache(PipelineStateCache const&) = delete;
+        PipelineStateCache& operator= (PipelineStateCache const&) = delete;
+
+        ~PipelineStateCache()
+        {
+            WaitForPending();
+        }
+
+        // Returns the pipeline for 'key'. A miss is queued for a worker thread; concurrent
+        // requests for the same key share the one compile.
+        std::shared_future<Pipeline> GetAsync(uint64_t key, const Description& desc)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            ++m_requests;
+
+            auto it = m_pipelines.find(key);
+            if (it != m_pipelines.end())
+            {
+                ++m_hits;
+
+                auto blob = m_blobs.find(key);
+                if (blob != m_blobs.end())
+                {
+                    m_timeSaved += blob->second.compileTime;
+                }
+                else
+                {
+                    // Still compiling; credited once the cost is known.
+                    ++m_pendingHits[key];
+                }
+
+                return it->second;
+            }
+
+            std::shared_ptr<const BlobEntry> cached;
+            {
+                auto blob = m_blobs.find(key);
+                if (blob != m_blobs.end() && !blob->second.blob.empty())
+                {
+                    cached = std::make_shared<const BlobEntry>(blob->second);
+                }
+            }
+
+            std::shared_future<Pipeline> result = m_workers.Submit(
+                [this, key, desc, cached]()
+                {
+                    const auto start = std::chrono::steady_clock::now();
+
+                    Pipeline pipeline;
+                    std::vector<uint8_t> blob;
+                    bool blobAccepted = false;
+                    try
+                    {
+                        pipeline = m_backend.Create(desc, cached ? &cached->blob : nullptr, blobAccepted);
+                        blobAccepted = blobAccepted && cached;
+
+                        if (!blobAccepted)
+                        {
+                            blob = m_backend.GetCachedBlob(pipeline);
+                        }
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_pipelines.erase(key);
+                        m_pendingHits.erase(key);
+                        throw;
+                    }
+
+                    const auto elapsed = std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now() - start);
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_compileTime += elapsed;
+
+                    auto pending = m_pendingHits.find(key);
+                    if (pending != m_pendingHits.end())
+                    {
+                        m_timeSaved += (blobAccepted ? cached->compileTime : elapsed) * pending->second;
+                        m_pendingHits.erase(pending);
+                    }
+
+                    if (blobAccepted)
+                    {
+                        ++m_blobHits;
+                        if (cached->compileTime > elapsed)
+                        {
+                            m_timeSaved += cached->compileTime - elapsed;
+                        }
+                    }
+                    else
+                    {
+                        // Also overwrites a blob the driver rejected, so the next run loads a good one.
+                        ++m_compiles;
+                        auto& entry = m_blobs[key];
+                        entry.blob = std::move(blob);
+                        entry.compileTime = elapsed;
+                    }
+
+                    return pipeline;
+                }).share();
+
+            m_pipelines.emplace(key, result);
+            return result;
+        }
+
+        Pipeline Get(uint64_t key, const Description& desc)
+        {
+            return GetAsync(key, desc).get();
+        }
+
+        void WaitForPending()
+        {
+            std::vector<std::shared_future<Pipeline>> pending;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                pending.reserve(m_pipelines.size());
+                for (auto& it : m_pipelines)
+                {
+                    pending.push_back(it.second);
+                }
+            }
+
+            for (auto& it : pending)
+            {
+                it.wait();
+            }
+        }
+
+        // Drops live pipelines (e.g. on device lost) but keeps the blob store.
+        void ReleasePipelines()
+        {
+            WaitForPending();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pipelines.clear();
+        }
+
+        // Writes every compiled blob. Waits for outstanding compiles first.
+        void Serialize(std::ostream& stream)
+        {
+            WaitForPending();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            // Copies, so the constants are not odr-used (C++14 has no inline variables).
+            Write(stream, uint32_t(c_Magic));
+            Write(stream, uint32_t(c_Version));
+            Write(stream, static_cast<uint32_t>(m_blobs.size()));
+
+            for (auto& it : m_blobs)
+            {
+                Write(stream, it.first);
+                Write(stream, static_cast<uint64_t>(it.second.compileTime.count()));
+                Write(stream, static_cast<uint32_t>(it.second.blob.size()));
+                if (!it.second.blob.empty())
+                {
+                    stream.write(reinterpret_cast<const char*>(it.second.blob.data()), static_cast<std::streamsize>(it.second.blob.size()));
+                }
+            }
+        }
+
+        // Merges a stream written by Serialize. Returns false (and loads nothing) if the stream
+        // is not a compatible cache, so a stale or truncated file just means a cold start.
+        bool Deserialize(std::istream& stream)
+        {
+            uint32_t magic = 0, version = 0, count = 0;
+            if (!Read(stream, magic) || magic != c_Magic
+                || !Read(stream, version) || version != c_Version
+                || !Read(stream, count))
+            {
+                return false;
+            }
+
+            std::vector<std::pair<uint64_t, BlobEntry>> loaded;
+            loaded.reserve(std::min<uint32_t>(count, 4096));
+
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                uint64_t key = 0, ticks = 0;
+                uint32_t size = 0;
+                if (!Read(stream, key) || !Read(stream, ticks) || !Read(stream, size) || size > c_MaxBlobSize)
+                {
+                    return false;
+                }
+
+                BlobEntry entry;
+                entry.compileTime = Duration(static_cast<typename Duration::rep>(ticks));
+                entry.blob.resize(size);
+                if (size > 0
+                    && !stream.read(reinterpret_cast<char*>(entry.blob.data()), static_cast<std::streamsize>(size)))
+                {
+                    return false;
+                }
+
+                loaded.emplace_back(key, std::move(entry));
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& it : loaded)
+            {
+                m_blobs[it.first] = std::move(it.second);
+            }
+
+            return true;
+        }
+
+        size_t GetWorkerCount() const noexcept { return m_workers.GetWorkerCount(); }
+
+        size_t GetPipelineCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_pipelines.size(); }
+        size_t GetBlobCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_blobs.size(); }
+
+        uint64_t GetRequestCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_requests; }
+        uint64_t GetHitCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_hits; }
+        uint64_t GetBlobHitCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_blobHits; }
+        uint64_t GetCompileCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_compiles; }
+
+        // Fraction of requests that did not require a full compile (in-process or blob hit).
+        double GetHitRate() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_requests ? static_cast<double>(m_hits + m_blobHits) / static_cast<double>(m_requests) : 0.0;
+        }
+
+        // Time spent inside the backend (compiles and blob loads).
+        double GetCompileMilliseconds() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return std::chrono::duration<double, std::milli>(m_compileTime).count();
+        }
+
+        // Estimated compile time avoided, from the recorded cost of each reused pipeline.
+        double GetTimeSavedMilliseconds() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return std::chrono::duration<double, std::milli>(m_timeSaved).count();
+        }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+    private:
+        using Duration = std::chrono::microseconds;
+
+        static constexpr uint32_t c_Magic = 0x43505844; // 'DXPC'
+        static constexpr uint32_t c_Version = 1;
+        static constexpr uint32_t c_MaxBlobSize = 64 * 1024 * 1024;
+
+        struct BlobEntry
+        {
+            std::vector<uint8_t>    blob;
+            Duration                compileTime;
+
+            BlobEntry() : compileTime(0) {}
+        };
+
+        template<typename T>
+        static void Write(std::ostream& stream, const T& value)
+        {
+            stream.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        template<typename T>
+        static bool Read(std::istream& stream, T& value)
+        {
+            return static_cast<bool>(stream.read(reinterpret_cast<char*>(&value), sizeof(T)));
+        }
+
+        TBackend                                                    m_backend;
+
+        mutable std::mutex                                          m_mutex;
+        std::unordered_map<uint64_t, std::shared_future<Pipeline>>  m_pipelines;
+        std::unordered_map<uint64_t, BlobEntry>                     m_blobs;
+        std::unordered_map<uint64_t, uint32_t>                      m_pendingHits;
+
+        uint64_t                                                    m_requests;
+        uint64_t                                                    m_hits;
+        uint64_t                                                    m_blobHits;
+        uint64_t                                                    m_compiles;
+        Duration                                                    m_compileTime;
+        Duration                                                    m_timeSaved;
+
+        // Last, so the workers are joined before the state they use is destroyed.
+        BackgroundWorkQueue                                         m_workers;
+    };
+}
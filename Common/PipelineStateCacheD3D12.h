@@ -0,0 +1,226 @@
+//--------------------------------------------------------------------------------------
+// File: PipelineStateCacheD3D12.h
+//
+// Direct3D 12 backend and description hashing for DX::PipelineStateCache
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "PipelineStateCache.h"
+
+#include <DirectXHelpers.h>
+#include <EffectPipelineStateDescription.h>
+
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include <wrl/client.h>
+
+
+namespace DX
+{
+    // Hashes everything that affects the compiled pipeline: shader bytecode contents, all fixed
+    // function state, and the input layout by semantic name. Pointers and CachedPSO are ignored.
+    // The root signature is identified by the caller (e.g. a hash of its serialized blob) since
+    // the ID3D12RootSignature pointer is not stable across runs.
+    inline uint64_t HashPipelineStateDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC& desc, uint64_t rootSignatureHash) noexcept
+    {
+        PipelineStateHasher hasher;
+
+        hasher.Add(rootSignatureHash);
+
+        for (auto const& shader : { desc.VS, desc.PS, desc.DS, desc.HS, desc.GS })
+        {
+            hasher.Add(static_cast<uint64_t>(shader.BytecodeLength));
+            if (shader.pShaderBytecode && shader.BytecodeLength > 0)
+            {
+                hasher.AddBytes(shader.pShaderBytecode, shader.BytecodeLength);
+            }
+        }
+
+        hasher.Add(desc.StreamOutput.NumEntries);
+        for (UINT j = 0; j < desc.StreamOutput.NumEntries && desc.StreamOutput.pSODeclaration; ++j)
+        {
+            auto const& entry = desc.StreamOutput.pSODeclaration[j];
+            hasher.Add(entry.Stream);
+            hasher.AddString(entry.SemanticName);
+            hasher.Add(entry.SemanticIndex);
+            hasher.Add(entry.StartComponent);
+            hasher.Add(entry.ComponentCount);
+            hasher.Add(entry.OutputSlot);
+        }
+        hasher.Add(desc.StreamOutput.NumStrides);
+        for (UINT j = 0; j < desc.StreamOutput.NumStrides && desc.StreamOutput.pBufferStrides; ++j)
+        {
+            hasher.Add(desc.StreamOutput.pBufferStrides[j]);
+        }
+        hasher.Add(desc.StreamOutput.RasterizedStream);
+
+        hasher.Add(desc.BlendState.AlphaToCoverageEnable);
+        hasher.Add(desc.BlendState.IndependentBlendEnable);
+        for (auto const& rt : desc.BlendState.RenderTarget)
+        {
+            hasher.Add(rt.BlendEnable);
+            hasher.Add(rt.LogicOpEnable);
+            hasher.Add(rt.SrcBlend);
+            hasher.Add(rt.DestBlend);
+            hasher.Add(rt.BlendOp);
+            hasher.Add(rt.SrcBlendAlpha);
+            hasher.Add(rt.DestBlendAlpha);
+            hasher.Add(rt.BlendOpAlpha);
+            hasher.Add(rt.LogicOp);
+            hasher.Add(rt.RenderTargetWriteMask);
+        }
+
+        hasher.Add(desc.SampleMask);
+
+        auto const& rs = desc.RasterizerState;
+        hasher.Add(rs.FillMode);
+        hasher.Add(rs.CullMode);
+        hasher.Add(rs.FrontCounterClockwise);
+        hasher.Add(rs.DepthBias);
+        hasher.Add(rs.DepthBiasClamp);
+        hasher.Add(rs.SlopeScaledDepthBias);
+        hasher.Add(rs.DepthClipEnable);
+        hasher.Add(rs.MultisampleEnable);
+        hasher.Add(rs.AntialiasedLineEnable);
+        hasher.Add(rs.ForcedSampleCount);
+        hasher.Add(rs.ConservativeRaster);
+
+        auto const& ds = desc.DepthStencilState;
+        hasher.Add(ds.DepthEnable);
+        hasher.Add(ds.DepthWriteMask);
+        hasher.Add(ds.DepthFunc);
+        hasher.Add(ds.StencilEnable);
+        hasher.Add(ds.StencilReadMask);
+        hasher.Add(ds.StencilWriteMask);
+        for (auto const& face : { ds.FrontFace, ds.BackFace })
+        {
+            hasher.Add(face.StencilFailOp);
+            hasher.Add(face.StencilDepthFailOp);
+            hasher.Add(face.StencilPassOp);
+            hasher.Add(face.StencilFunc);
+        }
+
+        hasher.Add(desc.InputLayout.NumElements);
+        for (UINT j = 0; j < desc.InputLayout.NumElements && desc.InputLayout.pInputElementDescs; ++j)
+        {
+            auto const& element = desc.InputLayout.pInputElementDescs[j];
+            hasher.AddString(element.SemanticName);
+            hasher.Add(element.SemanticIndex);
+            hasher.Add(element.Format);
+            hasher.Add(element.InputSlot);
+            hasher.Add(element.AlignedByteOffset);
+            hasher.Add(element.InputSlotClass);
+            hasher.Add(element.InstanceDataStepRate);
+        }
+
+        hasher.Add(desc.IBStripCutValue);
+        hasher.Add(desc.PrimitiveTopologyType);
+        hasher.Add(desc.NumRenderTargets);
+        for (UINT j = 0; j < desc.NumRenderTargets && j < 8; ++j)
+        {
+            hasher.Add(desc.RTVFormats[j]);
+        }
+        hasher.Add(desc.DSVFormat);
+        hasher.Add(desc.SampleDesc.Count);
+        hasher.Add(desc.SampleDesc.Quality);
+        hasher.Add(desc.NodeMask);
+        hasher.Add(desc.Flags);
+
+        return hasher.Get();
+    }
+
+    // Convenience for DirectX Tool Kit descriptions plus the shaders they will be paired with.
+    inline D3D12_GRAPHICS_PIPELINE_STATE_DESC GetPipelineStateDesc(
+        const DirectX::EffectPipelineStateDescription& description,
+        _In_ ID3D12RootSignature* rootSignature,
+        const D3D12_SHADER_BYTECODE& vertexShader,
+        const D3D12_SHADER_BYTECODE& pixelShader) noexcept
+    {
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+        description.GetDesc(&desc);
+        desc.pRootSignature = rootSignature;
+        desc.VS = vertexShader;
+        desc.PS = pixelShader;
+        return desc;
+    }
+
+    class D3D12PipelineStateBackend
+    {
+    public:
+        using Pipeline = Microsoft::WRL::ComPtr<ID3D12PipelineState>;
+        using Description = D3D12_GRAPHICS_PIPELINE_STATE_DESC;
+
+        explicit D3D12PipelineStateBackend(_In_ ID3D12Device* device) noexcept : m_device(device) {}
+
+        Pipeline Create(const Description& desc, const std::vector<uint8_t>* cachedBlob, bool& blobAccepted)
+        {
+            Pipeline pipeline;
+            blobAccepted = false;
+
+            if (cachedBlob && !cachedBlob->empty())
+            {
+                Description withBlob = desc;
+                withBlob.CachedPSO.pCachedBlob = cachedBlob->data();
+                withBlob.CachedPSO.CachedBlobSizeInBytes = cachedBlob->size();
+
+                // A driver or adapter change invalidates the blob; fall through to a full compile.
+                if (SUCCEEDED(m_device->CreateGraphicsPipelineState(&withBlob, IID_GRAPHICS_PPV_ARGS(pipeline.GetAddressOf()))))
+                {
+                    blobAccepted = true;
+                    return pipeline;
+                }
+            }
+
+            ThrowIfFailed(m_device->CreateGraphicsPipelineState(&desc, IID_GRAPHICS_PPV_ARGS(pipeline.GetAddressOf())));
+            return pipeline;
+        }
+
+        std::vector<uint8_t> GetCachedBlob(const Pipeline& pipeline)
+        {
+            std::vector<uint8_t> result;
+
+            Microsoft::WRL::ComPtr<ID3DBlob> blob;
+            if (pipeline && SUCCEEDED(pipeline->GetCachedBlob(blob.GetAddressOf())) && blob)
+            {
+                auto ptr = static_cast<const uint8_t*>(blob->GetBufferPointer());
+                result.assign(ptr, ptr + blob->GetBufferSize());
+            }
+
+            return result;
+        }
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12Device> m_device;
+    };
+
+    using D3D12PipelineStateCache = PipelineStateCache<D3D12PipelineStateBackend>;
+
+    // Blob store persistence across runs. A missing or stale file is not an error.
+    template<typename TBackend>
+    inline bool LoadPipelineStateCache(PipelineStateCache<TBackend>& cache, _In_z_ const wchar_t* fileName)
+    {
+        std::ifstream inFile(fileName, std::ios::in | std::ios::binary);
+        if (!inFile)
+            return false;
+
+        return cache.Deserialize(inFile);
+    }
+
+    template<typename TBackend>
+    inline void SavePipelineStateCache(PipelineStateCache<TBackend>& cache, _In_z_ const wchar_t* fileName)
+    {
+        std::ofstream outFile(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!outFile)
+            throw std::runtime_error("SavePipelineStateCache");
+
+        cache.Serialize(outFile);
+
+        if (!outFile)
+            throw std::runtime_error("SavePipelineStateCache");
+    }
+}
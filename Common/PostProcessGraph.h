@@ -0,0 +1,531 @@
+//--------------------------------------------------------------------------------------
+// File: PostProcessGraph.h
+//
+// Declarative graph for chains of full-screen post-processing passes
+//
+// Passes name the targets they read and the one they write. Compile folds away
+// pass-through copies, merges pass pairs that have a registered fused equivalent,
+// culls passes whose results are never used, aliases transient targets whose
+// lifetimes do not overlap onto as few physical targets as possible, and works out
+// the state transitions each pass needs. Execution is left to callbacks, so a
+// compiled graph can be inspected (pass counts, aliasing, barriers) without running it.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "RenderTargetPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    enum PostProcessState : uint32_t
+    {
+        PostProcessState_RenderTarget,
+        PostProcessState_ShaderResource,
+    };
+
+    enum PostProcessPassFlags : uint32_t
+    {
+        PostProcessPass_Default = 0,
+
+        // The pass only copies its single input (e.g. BasicPostProcess::Copy). When it writes a
+        // transient target its readers are pointed at the input instead and the pass is dropped.
+        PostProcessPass_PassThrough = 0x1,
+    };
+
+    struct PostProcessBarrier
+    {
+        uint32_t            resource;       // graph handle; for a transient, any handle on the same physical target
+        PostProcessState    before;
+        PostProcessState    after;
+    };
+
+    struct PostProcessCompiledPass
+    {
+        static constexpr uint32_t c_MaxInputs = 4;
+
+        uint32_t    kind;
+        uint32_t    pass;           // declaration index, e.g. for looking up the pass parameters
+        uint32_t    fusedPass;      // declaration index of the pass merged in ahead of it, or c_None
+        uint32_t    inputCount;
+        uint32_t    inputs[c_MaxInputs];
+        uint32_t    output;
+        uint32_t    firstBarrier;   // transitions to issue before the pass
+        uint32_t    barrierCount;
+    };
+
+    struct PostProcessGraphStats
+    {
+        uint32_t    declaredPasses;
+        uint32_t    executedPasses;
+        uint32_t    foldedPasses;
+        uint32_t    fusedPasses;        // passes merged into their reader
+        uint32_t    culledPasses;
+        uint32_t    transientTargets;   // as declared
+        uint32_t    physicalTargets;    // after aliasing
+        uint32_t    barriers;
+        uint32_t    barrierBatches;
+    };
+
+    class PostProcessGraph
+    {
+    public:
+        static constexpr uint32_t c_None = UINT32_MAX;
+
+        PostProcessGraph() noexcept : m_stats{}, m_finalBarrier(0), m_compiled(false) {}
+
+        // Forgets the declared passes and resources. Fusion rules are kept.
+        void Reset()
+        {
+            m_resources.clear();
+            m_passes.clear();
+            m_schedule.clear();
+            m_barriers.clear();
+            m_physical.clear();
+            m_stats = {};
+            m_finalBarrier = 0;
+            m_compiled = false;
+        }
+
+        // A texture owned by the caller (e.g. the scene or the back buffer). It is returned to
+        // 'finalState' once the graph has run.
+        uint32_t Import(PostProcessState initialState, PostProcessState finalState)
+        {
+            Resource resource = {};
+            resource.imported = true;
+            resource.initialState = initialState;
+            resource.finalState = finalState;
+            return AddResource(resource);
+        }
+
+        // A target that only lives within the graph. Transients with the same key may share memory.
+        uint32_t CreateTransient(const RenderTargetKey& key)
+        {
+            Resource resource = {};
+            resource.key = key;
+            return AddResource(resource);
+        }
+
+        // Declares a pass that reads 'inputs' and writes 'output'. Passes run in declaration
+        // order, and every resource may be written by at most one pass. Returns the pass index.
+        uint32_t AddPass(uint32_t kind, std::initializer_list<uint32_t> inputs, uint32_t output, uint32_t flags = PostProcessPass_Default)
+        {
+            if (inputs.size() > PostProcessCompiledPass::c_MaxInputs)
+                throw std::invalid_argument("Too many post-process pass inputs");
+
+            if ((flags & PostProcessPass_PassThrough) && inputs.size() != 1)
+                throw std::invalid_argument("Pass-through passes take exactly one input");
+
+            const auto index = static_cast<uint32_t>(m_passes.size());
+
+            auto& target = GetResource(output);
+            if (target.writer != c_None)
+                throw std::logic_error("Post-process resource written by more than one pass");
+
+            Pass pass = {};
+            pass.kind = kind;
+            pass.flags = flags;
+            pass.pass = index;
+            pass.fusedPass = c_None;
+            pass.output = output;
+            pass.alive = true;
+            for (auto input : inputs)
+            {
+                auto& source = GetResource(input);
+                if (input == output)
+                    throw std::logic_error("Post-process pass reads its own output");
+                if (!source.imported && source.writer == c_None)
+                    throw std::logic_error("Post-process pass reads a transient before it is written");
+
+                pass.inputs[pass.inputCount++] = input;
+            }
+
+            target.writer = index;
+            m_passes.push_back(pass);
+            m_compiled = false;
+            return index;
+        }
+
+        // A pass of kind 'first' whose output is read only by the following pass of kind
+        // 'second' (as its first input) may run as a single pass of kind 'fused'. The fused pass
+        // reads the inputs of 'first' followed by the remaining inputs of 'second'.
+        void AddFusion(uint32_t first, uint32_t second, uint32_t fused)
+        {
+            m_fusions.push_back({ first, second, fused });
+            m_compiled = false;
+        }
+
+        void Compile()
+        {
+            std::vector<Pass> passes = m_passes;
+            m_stats = {};
+            m_stats.declaredPasses = static_cast<uint32_t>(passes.size());
+
+            for (auto& resource : m_resources)
+            {
+                resource.physical = c_None;
+                if (!resource.imported)
+                    ++m_stats.transientTargets;
+            }
+
+            // Fold pass-through copies into transients by pointing their readers at the source.
+            for (auto& pass : passes)
+            {
+                if (!(pass.flags & PostProcessPass_PassThrough) || m_resources[pass.output].imported)
+                    continue;
+
+                // A reader that writes the source itself still needs the copy.
+                const bool sourceWritten = std::any_of(passes.cbegin(), passes.cend(), [&](const Pass& reader)
+                    {
+                        return reader.output == pass.inputs[0]
+                            && std::find(reader.inputs, reader.inputs + reader.inputCount, pass.output) != reader.inputs + reader.inputCount;
+                    });
+                if (sourceWritten)
+                    continue;
+
+                for (auto& reader : passes)
+                {
+                    for (uint32_t j = 0; j < reader.inputCount; ++j)
+                    {
+                        if (reader.inputs[j] == pass.output)
+                        {
+                            reader.inputs[j] = pass.inputs[0];
+                        }
+                    }
+                }
+
+                pass.alive = false;
+                ++m_stats.foldedPasses;
+            }
+
+            // Merge registered pairs, where the first pass feeds only the second.
+            std::vector<uint32_t> readers(m_resources.size());
+            CountReaders(passes, readers);
+
+            for (auto& second : passes)
+            {
+                if (!second.alive || !second.inputCount || second.fusedPass != c_None)
+                    continue;
+
+                const Resource& link = m_resources[second.inputs[0]];
+                if (link.imported || readers[second.inputs[0]] != 1)
+                    continue;
+
+                Pass& first = passes[link.writer];
+                if (!first.alive || first.fusedPass != c_None
+                    || first.inputCount + second.inputCount - 1 > PostProcessCompiledPass::c_MaxInputs)
+                    continue;
+
+                const uint32_t fused = FindFusion(first.kind, second.kind);
+                if (fused == c_None)
+                    continue;
+
+                uint32_t inputs[PostProcessCompiledPass::c_MaxInputs] = {};
+                uint32_t count = 0;
+                for (uint32_t j = 0; j < first.inputCount; ++j)
+                    inputs[count++] = first.inputs[j];
+                for (uint32_t j = 1; j < second.inputCount; ++j)
+                    inputs[count++] = second.inputs[j];
+
+                std::copy(inputs, inputs + count, second.inputs);
+                second.inputCount = count;
+                second.kind = fused;
+                second.fusedPass = first.pass;
+                first.alive = false;
+                ++m_stats.fusedPasses;
+            }
+
+            // Cull passes whose output never reaches an imported resource.
+            std::vector<bool> needed(m_resources.size());
+            for (auto it = passes.rbegin(); it != passes.rend(); ++it)
+            {
+                if (!it->alive)
+                    continue;
+
+                if (!m_resources[it->output].imported && !needed[it->output])
+                {
+                    it->alive = false;
+                    ++m_stats.culledPasses;
+                    continue;
+                }
+
+                for (uint32_t j = 0; j < it->inputCount; ++j)
+                {
+                    needed[it->inputs[j]] = true;
+                }
+            }
+
+            m_schedule.clear();
+            for (auto& pass : passes)
+            {
+                if (pass.alive)
+                    m_schedule.push_back(pass);
+            }
+
+            Allocate();
+            PlanBarriers();
+
+            m_stats.executedPasses = static_cast<uint32_t>(m_schedule.size());
+            m_stats.physicalTargets = static_cast<uint32_t>(m_physical.size());
+            m_compiled = true;
+        }
+
+        bool IsCompiled() const noexcept { return m_compiled; }
+
+        // Calls barrier(barriers, count) and pass(compiledPass) in execution order, ending with
+        // the transitions that return every resource to its final state.
+        template<typename TBarrierFunc, typename TPassFunc>
+        void Execute(TBarrierFunc&& barrier, TPassFunc&& pass) const
+        {
+            if (!m_compiled)
+                throw std::logic_error("PostProcessGraph must be compiled before it is executed");
+
+            for (auto& compiled : m_schedule)
+            {
+                if (compiled.barrierCount > 0)
+                {
+                    barrier(m_barriers.data() + compiled.firstBarrier, compiled.barrierCount);
+                }
+                pass(static_cast<const PostProcessCompiledPass&>(compiled));
+            }
+
+            if (m_finalBarrier < m_barriers.size())
+            {
+                barrier(m_barriers.data() + m_finalBarrier, static_cast<uint32_t>(m_barriers.size() - m_finalBarrier));
+            }
+        }
+
+        bool IsImported(uint32_t handle) const { return GetResource(handle).imported; }
+
+        // Physical target a transient was aliased onto by Compile.
+        uint32_t GetPhysicalTarget(uint32_t handle) const { return GetResource(handle).physical; }
+
+        uint32_t GetPhysicalTargetCount() const noexcept { return static_cast<uint32_t>(m_physical.size()); }
+        const RenderTargetKey& GetPhysicalTargetKey(uint32_t index) const { return m_physical.at(index); }
+
+        const PostProcessGraphStats& GetStats() const noexcept { return m_stats; }
+
+        // Memory of the transients after and before aliasing, sized by e.g. RenderTargetPool's backend.
+        template<typename TSizeFunc>
+        void GetTransientBytes(TSizeFunc&& getAllocationSize, uint64_t& physicalBytes, uint64_t& declaredBytes) const
+        {
+            physicalBytes = declaredBytes = 0;
+            for (auto& key : m_physical)
+            {
+                physicalBytes += getAllocationSize(key);
+            }
+            for (auto& resource : m_resources)
+            {
+                if (!resource.imported)
+                    declaredBytes += getAllocationSize(resource.key);
+            }
+        }
+
+    private:
+        struct Resource
+        {
+            RenderTargetKey     key;
+            bool                imported;
+            PostProcessState    initialState;
+            PostProcessState    finalState;
+            uint32_t            writer;
+            uint32_t            physical;
+        };
+
+        struct Pass : PostProcessCompiledPass
+        {
+            uint32_t    flags;
+            bool        alive;
+        };
+
+        struct Fusion
+        {
+            uint32_t    first;
+            uint32_t    second;
+            uint32_t    fused;
+        };
+
+        uint32_t AddResource(Resource& resource)
+        {
+            resource.writer = c_None;
+            resource.physical = c_None;
+            m_resources.push_back(resource);
+            m_compiled = false;
+            return static_cast<uint32_t>(m_resources.size() - 1);
+        }
+
+        Resource& GetResource(uint32_t handle)
+        {
+            if (handle >= m_resources.size())
+                throw std::out_of_range("Invalid post-process resource");
+            return m_resources[handle];
+        }
+
+        const Resource& GetResource(uint32_t handle) const
+        {
+            if (handle >= m_resources.size())
+                throw std::out_of_range("Invalid post-process resource");
+            return m_resources[handle];
+        }
+
+        uint32_t FindFusion(uint32_t first, uint32_t second) const noexcept
+        {
+            for (auto& fusion : m_fusions)
+            {
+                if (fusion.first == first && fusion.second == second)
+                    return fusion.fused;
+            }
+            return c_None;
+        }
+
+        static void CountReaders(const std::vector<Pass>& passes, std::vector<uint32_t>& readers)
+        {
+            std::fill(readers.begin(), readers.end(), 0u);
+            for (auto& pass : passes)
+            {
+                if (!pass.alive)
+                    continue;
+
+                for (uint32_t j = 0; j < pass.inputCount; ++j)
+                {
+                    if (std::find(pass.inputs, pass.inputs + j, pass.inputs[j]) == pass.inputs + j)
+                        ++readers[pass.inputs[j]];
+                }
+            }
+        }
+
+        // Greedy interval allocation in execution order: a transient takes a free physical target
+        // with its key, and gives it back after its last reader.
+        void Allocate()
+        {
+            m_physical.clear();
+
+            std::vector<uint32_t> lastRead(m_resources.size(), uint32_t(c_None));
+            for (uint32_t j = 0; j < m_schedule.size(); ++j)
+            {
+                auto& pass = m_schedule[j];
+                for (uint32_t k = 0; k < pass.inputCount; ++k)
+                {
+                    lastRead[pass.inputs[k]] = j;
+                }
+            }
+
+            std::vector<bool> busy;
+            for (uint32_t j = 0; j < m_schedule.size(); ++j)
+            {
+                auto& pass = m_schedule[j];
+
+                Resource& output = m_resources[pass.output];
+                if (!output.imported)
+                {
+                    uint32_t physical = 0;
+                    while (physical < m_physical.size() && (busy[physical] || m_physical[physical] != output.key))
+                        ++physical;
+
+                    if (physical == m_physical.size())
+                    {
+                        m_physical.push_back(output.key);
+                        busy.push_back(false);
+                    }
+
+                    busy[physical] = true;
+                    output.physical = physical;
+                }
+
+                for (uint32_t k = 0; k < pass.inputCount; ++k)
+                {
+                    const Resource& input = m_resources[pass.inputs[k]];
+                    if (!input.imported && lastRead[pass.inputs[k]] == j)
+                    {
+                        busy[input.physical] = false;
+                    }
+                }
+            }
+        }
+
+        // Tracks each imported resource and physical target through the schedule. Transients are
+        // render targets between graph executions.
+        void PlanBarriers()
+        {
+            m_barriers.clear();
+
+            std::vector<PostProcessState> importState(m_resources.size());
+            for (size_t j = 0; j < m_resources.size(); ++j)
+            {
+                importState[j] = m_resources[j].initialState;
+            }
+            std::vector<PostProcessState> physicalState(m_physical.size(), PostProcessState_RenderTarget);
+            std::vector<uint32_t> physicalHandle(m_physical.size(), uint32_t(c_None));
+
+            auto require = [&](uint32_t handle, PostProcessState state)
+                {
+                    const Resource& resource = m_resources[handle];
+                    PostProcessState& current = resource.imported ? importState[handle] : physicalState[resource.physical];
+                    if (!resource.imported)
+                    {
+                        physicalHandle[resource.physical] = handle;
+                    }
+
+                    if (current != state)
+                    {
+                        m_barriers.push_back({ handle, current, state });
+                        current = state;
+                    }
+                };
+
+            for (auto& pass : m_schedule)
+            {
+                pass.firstBarrier = static_cast<uint32_t>(m_barriers.size());
+                for (uint32_t k = 0; k < pass.inputCount; ++k)
+                {
+                    require(pass.inputs[k], PostProcessState_ShaderResource);
+                }
+                require(pass.output, PostProcessState_RenderTarget);
+
+                pass.barrierCount = static_cast<uint32_t>(m_barriers.size()) - pass.firstBarrier;
+                if (pass.barrierCount > 0)
+                    ++m_stats.barrierBatches;
+            }
+
+            m_finalBarrier = static_cast<uint32_t>(m_barriers.size());
+            for (uint32_t j = 0; j < m_resources.size(); ++j)
+            {
+                if (m_resources[j].imported)
+                {
+                    require(j, m_resources[j].finalState);
+                }
+            }
+            for (uint32_t j = 0; j < m_physical.size(); ++j)
+            {
+                if (physicalHandle[j] != c_None)
+                {
+                    require(physicalHandle[j], PostProcessState_RenderTarget);
+                }
+            }
+            if (m_finalBarrier < m_barriers.size())
+                ++m_stats.barrierBatches;
+
+            m_stats.barriers = static_cast<uint32_t>(m_barriers.size());
+        }
+
+        std::vector<Resource>           m_resources;
+        std::vector<Pass>               m_passes;
+        std::vector<Fusion>             m_fusions;
+
+        std::vector<Pass>               m_schedule;
+        std::vector<PostProcessBarrier> m_barriers;
+        std::vector<RenderTargetKey>    m_physical;
+        PostProcessGraphStats           m_stats;
+        uint32_t                        m_finalBarrier;
+        bool                            m_compiled;
+    };
+}
@@ -0,0 +1,230 @@
+//--------------------------------------------------------------------------------------
+// File: RenderQueue.h
+//
+// Sorted draw packet queue that skips redundant state binds on submission
+//
+// Packets carry a 64-bit sort key plus the identities of the state they bind. The
+// queue radix-sorts by key and then reports, per packet, which binds actually
+// changed. Packets are plain data, so they can be recorded from Model (see
+// ModelRenderQueue.h) or generated synthetically.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+
+namespace DX
+{
+    // Opaque draws group by state, then geometry, then object, then front-to-back. Geometry
+    // ranks above object so that instances of one mesh share buffer binds.
+    // Transparent draws follow all opaque draws, back-to-front.
+    //
+    //  opaque:       0 | state:15 | geometry:12 | object:12 | depth:24
+    //  transparent:  1 | ~depth:24 | state:15 | geometry:12 | object:12
+    //
+    // Fields wider than their slot are truncated, which only costs grouping, never correctness.
+    namespace RenderSortKey
+    {
+        constexpr uint32_t c_StateBits = 15;
+        constexpr uint32_t c_ObjectBits = 12;
+        constexpr uint32_t c_GeometryBits = 12;
+        constexpr uint32_t c_DepthBits = 24;
+
+        constexpr uint32_t c_MaxDepth = (1u << c_DepthBits) - 1;
+
+        // Maps a view distance in [0, farDistance] to the depth field.
+        inline uint32_t QuantizeDepth(float distance, float farDistance) noexcept
+        {
+            if (!(distance > 0.f) || !(farDistance > 0.f))
+                return 0;
+
+            const float t = distance / farDistance;
+            return (t >= 1.f) ? c_MaxDepth : static_cast<uint32_t>(t * float(c_MaxDepth));
+        }
+
+        constexpr uint64_t Mask(uint32_t value, uint32_t bits) noexcept
+        {
+            return static_cast<uint64_t>(value) & ((uint64_t(1) << bits) - 1);
+        }
+
+        constexpr uint64_t MakeOpaque(uint32_t state, uint32_t object, uint32_t geometry, uint32_t depth) noexcept
+        {
+            return (Mask(state, c_StateBits) << (c_GeometryBits + c_ObjectBits + c_DepthBits))
+                | (Mask(geometry, c_GeometryBits) << (c_ObjectBits + c_DepthBits))
+                | (Mask(object, c_ObjectBits) << c_DepthBits)
+                | Mask(depth, c_DepthBits);
+        }
+
+        constexpr uint64_t MakeTransparent(uint32_t state, uint32_t object, uint32_t geometry, uint32_t depth) noexcept
+        {
+            return (uint64_t(1) << 63)
+                | (Mask(c_MaxDepth - (depth & c_MaxDepth), c_DepthBits) << (c_StateBits + c_GeometryBits + c_ObjectBits))
+                | (Mask(state, c_StateBits) << (c_GeometryBits + c_ObjectBits))
+                | (Mask(geometry, c_GeometryBits) << c_ObjectBits)
+                | Mask(object, c_ObjectBits);
+        }
+    }
+
+    struct RenderPacket
+    {
+        uint64_t    key;
+        const void* state;          // bound as a unit, e.g. an IEffect (PSO, root signature, material, textures)
+        uint32_t    object;         // per-object constants, e.g. an index into a world matrix table
+        uint32_t    topology;
+        uint64_t    vertexBuffer;   // GPU virtual addresses
+        uint64_t    indexBuffer;
+        const void* draw;           // backend payload, e.g. a ModelMeshPart
+    };
+
+    enum RenderBind : uint32_t
+    {
+        RenderBind_State = 0x1,
+        RenderBind_VertexBuffer = 0x2,
+        RenderBind_IndexBuffer = 0x4,
+        RenderBind_Topology = 0x8,
+    };
+
+    struct RenderQueueStats
+    {
+        uint64_t draws;
+        uint64_t stateBinds;
+        uint64_t vertexBufferBinds;
+        uint64_t indexBufferBinds;
+        uint64_t topologyBinds;
+
+        // Binds avoided relative to rebinding everything per draw (as Model::Draw does).
+        uint64_t GetEliminated() const noexcept
+        {
+            return draws * 4 - (stateBinds + vertexBufferBinds + indexBufferBinds + topologyBinds);
+        }
+    };
+
+    class RenderQueue
+    {
+    public:
+        void Clear() noexcept { m_packets.clear(); }
+        void Reserve(size_t count) { m_packets.reserve(count); }
+
+        void Push(const RenderPacket& packet) { m_packets.push_back(packet); }
+
+        size_t GetCount() const noexcept { return m_packets.size(); }
+        const RenderPacket* GetPackets() const noexcept { return m_packets.data(); }
+
+        // Stable LSD radix sort on the key, one byte per pass. Passes where every key shares the
+        // same byte are skipped, so narrow key populations cost only a couple of passes.
+        void Sort()
+        {
+            const size_t count = m_packets.size();
+            if (count < 2)
+                return;
+
+            size_t histogram[8][256];
+            memset(histogram, 0, sizeof(histogram));
+
+            m_order.resize(count);
+            m_scratch.resize(count);
+            for (size_t j = 0; j < count; ++j)
+            {
+                const uint64_t key = m_packets[j].key;
+                m_order[j] = { key, static_cast<uint32_t>(j) };
+
+                for (size_t pass = 0; pass < 8; ++pass)
+                {
+                    ++histogram[pass][(key >> (pass * 8)) & 0xFF];
+                }
+            }
+
+            SortEntry* src = m_order.data();
+            SortEntry* dst = m_scratch.data();
+            for (size_t pass = 0; pass < 8; ++pass)
+            {
+                size_t* bucket = histogram[pass];
+                if (bucket[(src[0].key >> (pass * 8)) & 0xFF] == count)
+                    continue;
+
+                size_t offset = 0;
+                for (size_t b = 0; b < 256; ++b)
+                {
+                    const size_t n = bucket[b];
+                    bucket[b] = offset;
+                    offset += n;
+                }
+
+                const uint32_t shift = static_cast<uint32_t>(pass * 8);
+                for (size_t j = 0; j < count; ++j)
+                {
+                    dst[bucket[(src[j].key >> shift) & 0xFF]++] = src[j];
+                }
+
+                SortEntry* tmp = src;
+                src = dst;
+                dst = tmp;
+            }
+
+            m_sorted.resize(count);
+            for (size_t j = 0; j < count; ++j)
+            {
+                m_sorted[j] = m_packets[src[j].index];
+            }
+            m_packets.swap(m_sorted);
+        }
+
+        // Calls emit(packet, binds) for each packet in queue order, where 'binds' is the set of
+        // RenderBind flags whose value differs from the previous packet.
+        template<typename TFunc>
+        RenderQueueStats Emit(TFunc&& emit) const
+        {
+            RenderQueueStats stats = {};
+
+            const RenderPacket* last = nullptr;
+            for (auto& packet : m_packets)
+            {
+                uint32_t binds = 0;
+                if (!last || packet.state != last->state || packet.object != last->object)
+                {
+                    binds |= RenderBind_State;
+                    ++stats.stateBinds;
+                }
+                if (!last || packet.vertexBuffer != last->vertexBuffer)
+                {
+                    binds |= RenderBind_VertexBuffer;
+                    ++stats.vertexBufferBinds;
+                }
+                if (!last || packet.indexBuffer != last->indexBuffer)
+                {
+                    binds |= RenderBind_IndexBuffer;
+                    ++stats.indexBufferBinds;
+                }
+                if (!last || packet.topology != last->topology)
+                {
+                    binds |= RenderBind_Topology;
+                    ++stats.topologyBinds;
+                }
+
+                emit(packet, binds);
+                ++stats.draws;
+                last = &packet;
+            }
+
+            return stats;
+        }
+
+    private:
+        struct SortEntry
+        {
+            uint64_t key;
+            uint32_t index;
+        };
+
+        std::vector<RenderPacket>   m_packets;
+        std::vector<RenderPacket>   m_sorted;
+        std::vector<SortEntry>      m_order;
+        std::vector<SortEntry>      m_scratch;
+    };
+}
@@ -0,0 +1,247 @@
+//--------------------------------------------------------------------------------------
+// File: RenderTargetPool.h
+//
+// Transient render target pool keyed by (width, height, format, flags, clear color)
+//
+// The pool does the bookkeeping only; resource creation is delegated to a backend
+// so the same logic drives Direct3D 12 (see RenderTexture.h) or a mock allocator
+// that reports sizes without allocating, for checking reuse and peak memory.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    struct RenderTargetKey
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t format;    // DXGI_FORMAT
+        uint32_t flags;     // D3D12_RESOURCE_FLAGS
+        float clearColor[4];    // optimized clear value; targets are only shared by users that clear alike
+
+        bool operator==(const RenderTargetKey& other) const noexcept
+        {
+            return width == other.width && height == other.height && format == other.format && flags == other.flags
+                && clearColor[0] == other.clearColor[0] && clearColor[1] == other.clearColor[1]
+                && clearColor[2] == other.clearColor[2] && clearColor[3] == other.clearColor[3];
+        }
+
+        bool operator!=(const RenderTargetKey& other) const noexcept { return !(*this == other); }
+    };
+
+    // TBackend must provide:
+    //
+    //  using Resource = ...;                                       // default-constructible, movable
+    //  Resource Create(const RenderTargetKey& key);                // throws on failure
+    //  uint64_t GetAllocationSize(const RenderTargetKey& key);
+    //
+    // A target released during a frame may be handed out again by a later Acquire in the
+    // same frame (aliasing on a single queue). Idle targets are destroyed once they have
+    // gone unused for 'retireFrames' calls to EndFrame, which must be at least the
+    // number of frames in flight.
+    template<typename TBackend>
+    class RenderTargetPool
+    {
+    public:
+        using Resource = typename TBackend::Resource;
+
+        static constexpr size_t c_Invalid = SIZE_MAX;
+
+        explicit RenderTargetPool(TBackend backend, uint32_t retireFrames = 3) noexcept(false) :
+            m_backend(std::move(backend)),
+            m_retireFrames(retireFrames),
+            m_frame(0),
+            m_currentBytes(0),
+            m_peakBytes(0),
+            m_createCount(0),
+            m_reuseCount(0)
+        {
+        }
+
+        RenderTargetPool(RenderTargetPool&&) = default;
+        RenderTargetPool& operator= (RenderTargetPool&&) = default;
+
+        RenderTargetPool(RenderTargetPool const&) = delete;
+        RenderTargetPool& operator= (RenderTargetPool const&) = delete;
+
+        // Returns a slot holding a target matching 'key', creating one only if no idle match exists.
+        size_t Acquire(const RenderTargetKey& key)
+        {
+            size_t freeSlot = c_Invalid;
+            for (size_t j = 0; j < m_entries.size(); ++j)
+            {
+                auto& entry = m_entries[j];
+                if (!entry.valid)
+                {
+                    if (freeSlot == c_Invalid)
+                        freeSlot = j;
+                }
+                else if (!entry.inUse && entry.key == key)
+                {
+                    entry.inUse = true;
+                    entry.lastUsed = m_frame;
+                    ++m_reuseCount;
+                    return j;
+                }
+            }
+
+            const uint64_t bytes = m_backend.GetAllocationSize(key);
+            Resource resource = m_backend.Create(key);
+
+            if (freeSlot == c_Invalid)
+            {
+                freeSlot = m_entries.size();
+                m_entries.emplace_back();
+            }
+
+            auto& entry = m_entries[freeSlot];
+            entry.resource = std::move(resource);
+            entry.key = key;
+            entry.bytes = bytes;
+            entry.lastUsed = m_frame;
+            entry.valid = true;
+            entry.inUse = true;
+
+            ++m_createCount;
+            m_currentBytes += bytes;
+            if (m_currentBytes > m_peakBytes)
+            {
+                m_peakBytes = m_currentBytes;
+            }
+
+            return freeSlot;
+        }
+
+        // Returns a slot to the pool. The target stays alive until it retires.
+        void Release(size_t slot)
+        {
+            if (!TryRelease(slot))
+            {
+                throw std::logic_error("RenderTargetPool slot released twice or invalid");
+            }
+        }
+
+        // As Release, for cleanup paths that cannot throw. Returns false if 'slot' was not held.
+        bool TryRelease(size_t slot) noexcept
+        {
+            if (!IsValid(slot) || !m_entries[slot].inUse)
+                return false;
+
+            auto& entry = m_entries[slot];
+            entry.inUse = false;
+            entry.lastUsed = m_frame;
+            return true;
+        }
+
+        bool IsValid(size_t slot) const noexcept { return slot < m_entries.size() && m_entries[slot].valid; }
+
+        Resource& Get(size_t slot) { return GetEntry(slot).resource; }
+        Resource* TryGet(size_t slot) noexcept { return IsValid(slot) ? &m_entries[slot].resource : nullptr; }
+        const RenderTargetKey& GetKey(size_t slot) { return GetEntry(slot).key; }
+
+        // Call once per frame after Present.
+        void EndFrame()
+        {
+            ++m_frame;
+
+            for (auto& entry : m_entries)
+            {
+                if (entry.valid && !entry.inUse && (m_frame - entry.lastUsed) > m_retireFrames)
+                {
+                    Destroy(entry);
+                }
+            }
+        }
+
+        // Destroys every idle target immediately (e.g. after WaitForGpu on a resize).
+        void Trim()
+        {
+            for (auto& entry : m_entries)
+            {
+                if (entry.valid && !entry.inUse)
+                {
+                    Destroy(entry);
+                }
+            }
+        }
+
+        // Destroys all targets. Outstanding slots become invalid.
+        void Clear()
+        {
+            m_entries.clear();
+            m_currentBytes = 0;
+        }
+
+        uint64_t GetCurrentBytes() const noexcept { return m_currentBytes; }
+        uint64_t GetPeakBytes() const noexcept { return m_peakBytes; }
+        uint64_t GetCreateCount() const noexcept { return m_createCount; }
+        uint64_t GetReuseCount() const noexcept { return m_reuseCount; }
+
+        size_t GetLiveCount() const noexcept
+        {
+            size_t count = 0;
+            for (auto& entry : m_entries)
+            {
+                if (entry.valid)
+                    ++count;
+            }
+            return count;
+        }
+
+        void ResetCounters() noexcept
+        {
+            m_peakBytes = m_currentBytes;
+            m_createCount = 0;
+            m_reuseCount = 0;
+        }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+    private:
+        struct Entry
+        {
+            Resource        resource;
+            RenderTargetKey key;
+            uint64_t        bytes;
+            uint64_t        lastUsed;
+            bool            valid;
+            bool            inUse;
+
+            Entry() : resource{}, key{}, bytes(0), lastUsed(0), valid(false), inUse(false) {}
+        };
+
+        Entry& GetEntry(size_t slot)
+        {
+            if (slot >= m_entries.size() || !m_entries[slot].valid)
+            {
+                throw std::out_of_range("Invalid RenderTargetPool slot");
+            }
+            return m_entries[slot];
+        }
+
+        void Destroy(Entry& entry)
+        {
+            m_currentBytes -= entry.bytes;
+            entry = Entry();
+        }
+
+        TBackend            m_backend;
+        std::vector<Entry>  m_entries;
+        uint32_t            m_retireFrames;
+        uint64_t            m_frame;
+        uint64_t            m_currentBytes;
+        uint64_t            m_peakBytes;
+        uint64_t            m_createCount;
+        uint64_t            m_reuseCount;
+    };
+}
@@ -29,7 +29,9 @@ RenderTexture::RenderTexture(DXGI_FORMAT format) noexcept :
     m_clearColor{},
     m_format(format),
     m_width(0),
-    m_height(0)
+    m_height(0),
+    m_pool(nullptr),
+    m_poolSlot(RenderTexturePool::c_Invalid)
 {
 }
 
@@ -77,6 +79,17 @@ void RenderTexture::SetDevice(_In_ ID3D12Device* device,
     m_rtvDescriptor = rtvDescriptor;
 }
 
+void RenderTexture::SetPool(_In_opt_ RenderTexturePool* pool)
+{
+    if (pool == m_pool)
+        return;
+
+    ReturnToPool();
+    m_resource.Reset();
+    m_pool = pool;
+    m_width = m_height = 0;
+}
+
 void RenderTexture::SizeResources(size_t width, size_t height)
 {
     if (width == m_width && height == m_height)
@@ -92,6 +105,28 @@ void RenderTexture::SizeResources(size_t width, size_t height)
 
     m_width = m_height = 0;
 
+    if (m_pool)
+    {
+        ReturnToPool();
+
+        RenderTargetKey key = { static_cast<uint32_t>(width), static_cast<uint32_t>(height),
+            static_cast<uint32_t>(m_format), static_cast<uint32_t>(D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET) };
+        memcpy(key.clearColor, m_clearColor, sizeof(key.clearColor));
+
+        m_poolSlot = m_pool->Acquire(key);
+
+        auto const& pooled = m_pool->Get(m_poolSlot);
+        m_resource = pooled.resource;
+        m_state = pooled.state;
+
+        m_device->CreateRenderTargetView(m_resource.Get(), nullptr, m_rtvDescriptor);
+        m_device->CreateShaderResourceView(m_resource.Get(), nullptr, m_srvDescriptor);
+
+        m_width = width;
+        m_height = height;
+        return;
+    }
+
     auto const heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
 
     const D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(m_format,
@@ -126,6 +161,7 @@ void RenderTexture::SizeResources(size_t width, size_t height)
 
 void RenderTexture::ReleaseDevice() noexcept
 {
+    ReturnToPool();
     m_resource.Reset();
     m_device.Reset();
 
@@ -150,3 +186,60 @@ void RenderTexture::SetWindow(const RECT& output)
 
     SizeResources(width, height);
 }
+
+void RenderTexture::ReturnToPool() noexcept
+{
+    if (m_pool)
+    {
+        if (auto pooled = m_pool->TryGet(m_poolSlot))
+        {
+            // Hand back the current state so the next user transitions from the right place.
+            pooled->state = m_state;
+            std::ignore = m_pool->TryRelease(m_poolSlot);
+        }
+    }
+
+    m_poolSlot = RenderTexturePool::c_Invalid;
+}
+
+//--------------------------------------------------------------------------------------
+// RenderTextureAllocator
+//--------------------------------------------------------------------------------------
+
+RenderTextureAllocator::Resource RenderTextureAllocator::Create(const RenderTargetKey& key)
+{
+    auto const heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+
+    const D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(key.format),
+        static_cast<UINT64>(key.width),
+        key.height,
+        1, 1, 1, 0, static_cast<D3D12_RESOURCE_FLAGS>(key.flags));
+
+    Resource result = {};
+    result.state = D3D12_RESOURCE_STATE_RENDER_TARGET;
+
+    D3D12_CLEAR_VALUE clearValue = { desc.Format, {} };
+    memcpy(clearValue.Color, key.clearColor, sizeof(clearValue.Color));
+
+    ThrowIfFailed(
+        m_device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES,
+            &desc,
+            result.state, &clearValue,
+            IID_GRAPHICS_PPV_ARGS(result.resource.GetAddressOf()))
+    );
+
+    SetDebugObjectName(result.resource.Get(), L"RenderTexture pooled RT");
+
+    return result;
+}
+
+uint64_t RenderTextureAllocator::GetAllocationSize(const RenderTargetKey& key)
+{
+    const D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(static_cast<DXGI_FORMAT>(key.format),
+        static_cast<UINT64>(key.width),
+        key.height,
+        1, 1, 1, 0, static_cast<D3D12_RESOURCE_FLAGS>(key.flags));
+
+    const auto info = m_device->GetResourceAllocationInfo(0, 1, &desc);
+    return info.SizeInBytes;
+}
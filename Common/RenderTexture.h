@@ -15,8 +15,32 @@
 
 #include <DirectXMath.h>
 
+#include "RenderTargetPool.h"
+
 namespace DX
 {
+    // Direct3D 12 backend for RenderTargetPool
+    class RenderTextureAllocator
+    {
+    public:
+        struct Resource
+        {
+            Microsoft::WRL::ComPtr<ID3D12Resource>  resource;
+            D3D12_RESOURCE_STATES                   state;
+        };
+
+        explicit RenderTextureAllocator(_In_ ID3D12Device* device) noexcept : m_device(device) {}
+
+        Resource Create(const RenderTargetKey& key);
+
+        uint64_t GetAllocationSize(const RenderTargetKey& key);
+
+    private:
+        Microsoft::WRL::ComPtr<ID3D12Device>                m_device;
+    };
+
+    using RenderTexturePool = RenderTargetPool<RenderTextureAllocator>;
+
     class RenderTexture
     {
     public:
@@ -31,6 +55,9 @@ namespace DX
         void SetDevice(_In_ ID3D12Device* device,
             D3D12_CPU_DESCRIPTOR_HANDLE srvDescriptor, D3D12_CPU_DESCRIPTOR_HANDLE rtvDescriptor);
 
+        // Optional; when set, SizeResources acquires targets from the pool and returns the previous one.
+        void SetPool(_In_opt_ RenderTexturePool* pool);
+
         void SizeResources(size_t width, size_t height);
 
         void ReleaseDevice() noexcept;
@@ -68,6 +95,8 @@ namespace DX
         DXGI_FORMAT GetFormat() const noexcept { return m_format; }
 
     private:
+        void ReturnToPool() noexcept;
+
         Microsoft::WRL::ComPtr<ID3D12Device>                m_device;
         Microsoft::WRL::ComPtr<ID3D12Resource>              m_resource;
         D3D12_RESOURCE_STATES                               m_state;
@@ -79,5 +108,8 @@ namespace DX
 
         size_t                                              m_width;
         size_t                                              m_height;
+
+        RenderTexturePool*                                  m_pool;
+        size_t                                              m_poolSlot;
     };
 }
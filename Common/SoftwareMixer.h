@@ -0,0 +1,611 @@
+//--------------------------------------------------------------------------------------
+// File: SoftwareMixer.h
+//
+// Offline CPU voice mixer for audio performance tests
+//
+// Decodes PCM, IEEE float, and MS ADPCM wave data (as returned by WAVFileReader or
+// WaveBankReader) to planar float, then mixes any number of voices through a simple
+// voice graph: source voices with a volume, frequency ratio, and XAudio2-style output
+// matrix feed submixes, which feed the master output. Resampling is linear. Mixing is
+// four frames at a time with DirectXMath, and submixes can be rendered in parallel on a
+// RecordingJobSystem.
+//
+// Nothing is sent to an audio device, so voice-count scaling can be measured on build
+// machines with no audio hardware. It calls no Windows APIs either, so the same runs can
+// be made on Linux.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "ParallelRecording.h"
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    enum class SoftwareSampleFormat : uint32_t
+    {
+        PCM8,
+        PCM16,
+        Float32,
+        MSADPCM,
+    };
+
+    struct SoftwareWaveFormat
+    {
+        SoftwareSampleFormat    sampleFormat;
+        uint32_t                channels;
+        uint32_t                sampleRate;
+        uint32_t                blockAlign;
+        uint32_t                samplesPerBlock;    // MS ADPCM only
+
+        // From WAVEFORMATEX fields; pass the tag from GetFormatTag so WAVE_FORMAT_EXTENSIBLE is
+        // resolved. XMA2 and xWMA need a hardware or platform decoder and are rejected.
+        static SoftwareWaveFormat Make(uint32_t formatTag, uint32_t channels, uint32_t bitsPerSample,
+            uint32_t sampleRate, uint32_t blockAlign, uint32_t samplesPerBlock = 0)
+        {
+            constexpr uint32_t c_formatPCM = 1;         // WAVE_FORMAT_PCM
+            constexpr uint32_t c_formatADPCM = 2;       // WAVE_FORMAT_ADPCM
+            constexpr uint32_t c_formatFloat = 3;       // WAVE_FORMAT_IEEE_FLOAT
+
+            if (!channels || !sampleRate || !blockAlign)
+                throw std::invalid_argument("Invalid wave format");
+
+            SoftwareWaveFormat format = {};
+            format.channels = channels;
+            format.sampleRate = sampleRate;
+            format.blockAlign = blockAlign;
+
+            if (formatTag == c_formatPCM && bitsPerSample == 8)
+            {
+                format.sampleFormat = SoftwareSampleFormat::PCM8;
+            }
+            else if (formatTag == c_formatPCM && bitsPerSample == 16)
+            {
+                format.sampleFormat = SoftwareSampleFormat::PCM16;
+            }
+            else if (formatTag == c_formatFloat && bitsPerSample == 32)
+            {
+                format.sampleFormat = SoftwareSampleFormat::Float32;
+            }
+            else if (formatTag == c_formatADPCM)
+            {
+                if (blockAlign <= 7 * channels)
+                    throw std::invalid_argument("Invalid MS ADPCM block size");
+
+                format.sampleFormat = SoftwareSampleFormat::MSADPCM;
+                format.samplesPerBlock = samplesPerBlock
+                    ? samplesPerBlock
+                    : (blockAlign - 7 * channels) * 2 / channels + 2;
+            }
+            else
+            {
+                throw std::invalid_argument("Unsupported wave format for software mixing");
+            }
+
+            return format;
+        }
+    };
+
+    // Decodes one MS ADPCM block to 'samplesPerBlock' interleaved frames. Uses the seven
+    // standard coefficient pairs, the only ones XAudio2 accepts.
+    inline void DecodeMSADPCMBlock(const uint8_t* block, uint32_t channels, uint32_t samplesPerBlock, int16_t* output)
+    {
+        static const int32_t s_coefficients[7][2] = { { 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 }, { 240, 0 }, { 460, -208 }, { 392, -232 } };
+        static const int32_t s_adaptation[16] = { 230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230 };
+
+        constexpr uint32_t c_maxChannels = 8;
+        if (!channels || channels > c_maxChannels || samplesPerBlock < 2)
+            throw std::invalid_argument("Unsupported MS ADPCM layout");
+
+        auto read16 = [](const uint8_t* p) { return static_cast<int16_t>(uint16_t(p[0]) | (uint16_t(p[1]) << 8)); };
+
+        int32_t coef1[c_maxChannels], coef2[c_maxChannels], delta[c_maxChannels], sample1[c_maxChannels], sample2[c_maxChannels];
+
+        const uint8_t* header = block;
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            const uint32_t predictor = header[c];
+            if (predictor >= 7)
+                throw std::runtime_error("Invalid MS ADPCM predictor");
+
+            coef1[c] = s_coefficients[predictor][0];
+            coef2[c] = s_coefficients[predictor][1];
+            delta[c] = read16(header + channels + 2 * c);
+            sample1[c] = read16(header + 3 * channels + 2 * c);
+            sample2[c] = read16(header + 5 * channels + 2 * c);
+        }
+
+        // The header holds the first two samples, oldest first.
+        for (uint32_t c = 0; c < channels; ++c)
+        {
+            output[c] = static_cast<int16_t>(sample2[c]);
+            output[channels + c] = static_cast<int16_t>(sample1[c]);
+        }
+
+        // Then one nibble per sample, high nibble first, channels interleaved.
+        const uint8_t* nibbles = header + 7 * channels;
+        const size_t count = size_t(samplesPerBlock - 2) * channels;
+        for (size_t j = 0; j < count; ++j)
+        {
+            const uint32_t c = uint32_t(j % channels);
+            const int32_t nibble = (j & 1) ? (nibbles[j >> 1] & 0xF) : (nibbles[j >> 1] >> 4);
+            const int32_t signedNibble = (nibble & 0x8) ? nibble - 16 : nibble;
+
+            const int32_t predicted = (sample1[c] * coef1[c] + sample2[c] * coef2[c]) / 256;
+            const int32_t sample = std::min(std::max(predicted + signedNibble * delta[c], -32768), 32767);
+
+            sample2[c] = sample1[c];
+            sample1[c] = sample;
+            delta[c] = std::max((s_adaptation[nibble] * delta[c]) / 256, 16);
+
+            output[2 * channels + j] = static_cast<int16_t>(sample);
+        }
+    }
+
+    // Decoded wave data, one float array per channel. Each array carries one trailing silent
+    // frame so interpolation past the end reads zero.
+    class SoftwareSound
+    {
+    public:
+        SoftwareSound(const SoftwareWaveFormat& format, const uint8_t* data, size_t bytes) :
+            m_channels(format.channels),
+            m_sampleRate(format.sampleRate),
+            m_frames(0)
+        {
+            if (!data && bytes)
+                throw std::invalid_argument("Missing wave data");
+
+            const uint32_t channels = format.channels;
+
+            switch (format.sampleFormat)
+            {
+            case SoftwareSampleFormat::PCM8:
+                m_frames = bytes / channels;
+                Allocate();
+                for (size_t j = 0; j < m_frames * channels; ++j)
+                {
+                    m_samples[j % channels][j / channels] = (float(data[j]) - 128.f) / 128.f;
+                }
+                break;
+
+            case SoftwareSampleFormat::PCM16:
+                m_frames = bytes / (2 * size_t(channels));
+                Allocate();
+                for (size_t j = 0; j < m_frames * channels; ++j)
+                {
+                    const auto sample = static_cast<int16_t>(uint16_t(data[2 * j]) | (uint16_t(data[2 * j + 1]) << 8));
+                    m_samples[j % channels][j / channels] = float(sample) / 32768.f;
+                }
+                break;
+
+            case SoftwareSampleFormat::Float32:
+                m_frames = bytes / (4 * size_t(channels));
+                Allocate();
+                for (size_t j = 0; j < m_frames * channels; ++j)
+                {
+                    float sample;
+                    memcpy(&sample, data + 4 * j, sizeof(float));
+                    m_samples[j % channels][j / channels] = sample;
+                }
+                break;
+
+            case SoftwareSampleFormat::MSADPCM:
+                {
+                    // A trailing partial block is ignored, as XAudio2 requires whole blocks.
+                    const size_t blocks = bytes / format.blockAlign;
+                    m_frames = blocks * format.samplesPerBlock;
+                    Allocate();
+
+                    std::vector<int16_t> decoded(size_t(format.samplesPerBlock) * channels);
+                    for (size_t b = 0; b < blocks; ++b)
+                    {
+                        DecodeMSADPCMBlock(data + b * format.blockAlign, channels, format.samplesPerBlock, decoded.data());
+
+                        const size_t base = b * format.samplesPerBlock;
+                        for (size_t j = 0; j < decoded.size(); ++j)
+                        {
+                            m_samples[j % channels][base + j / channels] = float(decoded[j]) / 32768.f;
+                        }
+                    }
+                }
+                break;
+
+            default:
+                throw std::invalid_argument("Unknown sample format");
+            }
+        }
+
+        uint32_t GetChannelCount() const noexcept { return m_channels; }
+        uint32_t GetSampleRate() const noexcept { return m_sampleRate; }
+        size_t GetFrameCount() const noexcept { return m_frames; }
+
+        double GetDurationMilliseconds() const noexcept { return double(m_frames) * 1000.0 / double(m_sampleRate); }
+
+        const float* GetChannel(uint32_t channel) const noexcept { return m_samples[channel].data(); }
+
+    private:
+        void Allocate()
+        {
+            m_samples.assign(m_channels, std::vector<float>(m_frames + 1, 0.f));
+        }
+
+        uint32_t                        m_channels;
+        uint32_t                        m_sampleRate;
+        size_t                          m_frames;
+        std::vector<std::vector<float>> m_samples;
+    };
+
+    class SoftwareMixer
+    {
+    public:
+        static constexpr uint32_t MasterSubmix = 0;
+        static constexpr uint32_t MaxChannels = 8;
+
+        // 'quantumFrames' defaults to 10 ms, XAudio2's processing quantum.
+        SoftwareMixer(uint32_t outputChannels, uint32_t sampleRate, uint32_t quantumFrames = 0) :
+            m_outputChannels(outputChannels),
+            m_sampleRate(sampleRate),
+            m_masterVolume(1.f)
+        {
+            if (!outputChannels || outputChannels > MaxChannels || !sampleRate)
+                throw std::invalid_argument("Invalid mixer output format");
+
+            if (!quantumFrames)
+            {
+                quantumFrames = (sampleRate + 99) / 100;
+            }
+
+            // Lanes past the end of a quantum are mixed into padding and discarded.
+            m_quantumFrames = quantumFrames;
+            m_paddedFrames = (quantumFrames + 3) & ~3u;
+            m_master.assign(size_t(m_paddedFrames) * outputChannels, 0.f);
+
+            // Submix 0 collects voices sent straight to the master output.
+            (void)CreateSubmix();
+        }
+
+        SoftwareMixer(SoftwareMixer&&) = default;
+        SoftwareMixer& operator= (SoftwareMixer&&) = default;
+
+        SoftwareMixer(SoftwareMixer const&) = delete;
+        SoftwareMixer& operator= (SoftwareMixer const&) = delete;
+
+        uint32_t CreateSubmix(float volume = 1.f)
+        {
+            Submix submix;
+            submix.volume = volume;
+            submix.buffer.assign(size_t(m_paddedFrames) * m_outputChannels, 0.f);
+            m_submixes.emplace_back(std::move(submix));
+            return uint32_t(m_submixes.size() - 1);
+        }
+
+        // Plays 'sound' from the start. The default output matrix routes mono to the front
+        // pair and otherwise maps channels one to one.
+        uint32_t CreateVoice(std::shared_ptr<const SoftwareSound> sound, uint32_t submix = MasterSubmix, bool loop = false)
+        {
+            if (!sound || sound->GetChannelCount() > MaxChannels)
+                throw std::invalid_argument("Invalid sound for software voice");
+            if (submix >= m_submixes.size())
+                throw std::out_of_range("Invalid submix");
+
+            Voice voice = {};
+            voice.sound = std::move(sound);
+            voice.volume = 1.f;
+            voice.loop = loop;
+            voice.playing = true;
+            voice.position = 0;
+
+            const uint32_t sourceChannels = voice.sound->GetChannelCount();
+            voice.matrix.assign(size_t(m_outputChannels) * sourceChannels, 0.f);
+            if (sourceChannels == 1)
+            {
+                for (uint32_t d = 0; d < std::min(m_outputChannels, 2u); ++d)
+                {
+                    voice.matrix[d] = 1.f;
+                }
+            }
+            else
+            {
+                for (uint32_t c = 0; c < std::min(m_outputChannels, sourceChannels); ++c)
+                {
+                    voice.matrix[size_t(c) * sourceChannels + c] = 1.f;
+                }
+            }
+
+            SetRate(voice, 1.f);
+
+            m_voices.emplace_back(std::move(voice));
+
+            const auto index = uint32_t(m_voices.size() - 1);
+            m_submixes[submix].voices.push_back(index);
+            return index;
+        }
+
+        void SetVoiceVolume(uint32_t voice, float volume) { m_voices.at(voice).volume = volume; }
+
+        // Levels as for IXAudio2Voice::SetOutputMatrix: source channel S to output D is at
+        // D * sourceChannels + S.
+        void SetVoiceOutputMatrix(uint32_t voice, const float* levels)
+        {
+            auto& v = m_voices.at(voice);
+            std::copy_n(levels, v.matrix.size(), v.matrix.begin());
+        }
+
+        // As IXAudio2SourceVoice::SetFrequencyRatio; the source rate is converted as well.
+        void SetVoiceFrequencyRatio(uint32_t voice, float ratio) { SetRate(m_voices.at(voice), ratio); }
+
+        void StopVoice(uint32_t voice) { m_voices.at(voice).playing = false; }
+        bool IsVoicePlaying(uint32_t voice) const { return m_voices.at(voice).playing; }
+
+        void SetSubmixVolume(uint32_t submix, float volume) { m_submixes.at(submix).volume = volume; }
+        void SetMasterVolume(float volume) noexcept { m_masterVolume = volume; }
+
+        size_t GetVoiceCount() const noexcept { return m_voices.size(); }
+        size_t GetSubmixCount() const noexcept { return m_submixes.size(); }
+        uint32_t GetOutputChannelCount() const noexcept { return m_outputChannels; }
+        uint32_t GetSampleRate() const noexcept { return m_sampleRate; }
+
+        size_t GetPlayingVoiceCount() const noexcept
+        {
+            return size_t(std::count_if(m_voices.cbegin(), m_voices.cend(), [](const Voice& v) { return v.playing; }));
+        }
+
+        // Mixes 'frames' interleaved output frames. With 'jobs', submixes are rendered in
+        // parallel, each by one worker; the result does not depend on the thread count.
+        void Render(float* output, size_t frames, RecordingJobSystem* jobs = nullptr)
+        {
+            while (frames > 0)
+            {
+                const uint32_t quantum = uint32_t(std::min<size_t>(frames, m_quantumFrames));
+
+                if (jobs)
+                {
+                    jobs->Run(m_submixes.size(), [&](size_t index, size_t) { RenderSubmix(m_submixes[index], quantum); });
+                }
+                else
+                {
+                    for (auto& submix : m_submixes)
+                    {
+                        RenderSubmix(submix, quantum);
+                    }
+                }
+
+                // Sum the submixes in a fixed order.
+                std::fill(m_master.begin(), m_master.end(), 0.f);
+                for (auto const& submix : m_submixes)
+                {
+                    const DirectX::XMVECTOR volume = DirectX::XMVectorReplicate(submix.volume * m_masterVolume);
+                    for (size_t j = 0; j < m_master.size(); j += 4)
+                    {
+                        auto dest = reinterpret_cast<DirectX::XMFLOAT4*>(&m_master[j]);
+                        DirectX::XMStoreFloat4(dest, DirectX::XMVectorMultiplyAdd(
+                            DirectX::XMLoadFloat4(reinterpret_cast<const DirectX::XMFLOAT4*>(&submix.buffer[j])), volume,
+                            DirectX::XMLoadFloat4(dest)));
+                    }
+                }
+
+                for (uint32_t f = 0; f < quantum; ++f)
+                {
+                    for (uint32_t d = 0; d < m_outputChannels; ++d)
+                    {
+                        *output++ = m_master[size_t(d) * m_paddedFrames + f];
+                    }
+                }
+
+                frames -= quantum;
+            }
+        }
+
+    private:
+        struct Voice
+        {
+            std::shared_ptr<const SoftwareSound>    sound;
+            std::vector<float>                      matrix;
+            float                                   volume;
+            uint64_t                                position;   // source frames, 32.32 fixed point
+            uint64_t                                step;
+            bool                                    loop;
+            bool                                    playing;
+        };
+
+        struct Submix
+        {
+            float                   volume;
+            std::vector<uint32_t>   voices;
+            std::vector<float>      buffer;     // planar, m_paddedFrames per channel
+        };
+
+        void SetRate(Voice& voice, float ratio) const
+        {
+            const double rate = double(ratio) * double(voice.sound->GetSampleRate()) / double(m_sampleRate);
+            if (!(rate > 0.0) || rate > 1024.0)
+                throw std::invalid_argument("Invalid frequency ratio");
+
+            voice.step = static_cast<uint64_t>(rate * 4294967296.0 + 0.5);
+        }
+
+        void RenderSubmix(Submix& submix, uint32_t frames)
+        {
+            std::fill(submix.buffer.begin(), submix.buffer.end(), 0.f);
+
+            for (auto index : submix.voices)
+            {
+                auto& voice = m_voices[index];
+                if (voice.playing)
+                {
+                    MixVoice(voice, submix.buffer.data(), frames);
+                }
+            }
+        }
+
+        void MixVoice(Voice& voice, float* buffer, uint32_t frames) const
+        {
+            using namespace DirectX;
+
+            const SoftwareSound& sound = *voice.sound;
+            const uint32_t sourceChannels = sound.GetChannelCount();
+            const uint64_t length = uint64_t(sound.GetFrameCount()) << 32;
+            if (!length)
+            {
+                voice.playing = false;
+                return;
+            }
+
+            // Voice volume folded into the matrix, splatted once per quantum.
+            XMVECTOR levels[MaxChannels * MaxChannels];
+            for (size_t j = 0; j < voice.matrix.size(); ++j)
+            {
+                levels[j] = XMVectorReplicate(voice.matrix[j] * voice.volume);
+            }
+
+            const float* source[MaxChannels];
+            for (uint32_t c = 0; c < sourceChannels; ++c)
+            {
+                source[c] = sound.GetChannel(c);
+            }
+
+            const size_t lastFrame = sound.GetFrameCount() - 1;
+            const bool unitRate = (voice.step == (uint64_t(1) << 32));
+            XMVECTOR samples[MaxChannels];
+
+            uint64_t position = voice.position;
+            for (uint32_t f = 0; f < frames; f += 4)
+            {
+                const size_t first = size_t(position >> 32);
+                if (unitRate && !(position & 0xFFFFFFFFu) && first + 3 <= lastFrame)
+                {
+                    // Whole-frame stepping inside the sound: no interpolation, direct loads.
+                    for (uint32_t c = 0; c < sourceChannels; ++c)
+                    {
+                        samples[c] = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(source[c] + first));
+                    }
+                    position += uint64_t(4) << 32;
+                }
+                else
+                {
+                    size_t index[4], next[4];
+                    float fraction[4];
+                    for (size_t k = 0; k < 4; ++k)
+                    {
+                        if (position >= length)
+                        {
+                            if (voice.loop)
+                            {
+                                position %= length;
+                            }
+                            else
+                            {
+                                // Read the trailing silent frame.
+                                position = length;
+                            }
+                        }
+
+                        index[k] = size_t(position >> 32);
+                        next[k] = (voice.loop && index[k] == lastFrame) ? 0 : index[k] + 1;
+                        if (index[k] > lastFrame)
+                        {
+                            next[k] = index[k];
+                        }
+                        fraction[k] = float(uint32_t(position)) * (1.f / 4294967296.f);
+
+                        position += voice.step;
+                    }
+
+                    const XMVECTOR t = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(fraction));
+                    for (uint32_t c = 0; c < sourceChannels; ++c)
+                    {
+                        const float* s = source[c];
+                        const XMVECTOR a = XMVectorSet(s[index[0]], s[index[1]], s[index[2]], s[index[3]]);
+                        const XMVECTOR b = XMVectorSet(s[next[0]], s[next[1]], s[next[2]], s[next[3]]);
+                        samples[c] = XMVectorMultiplyAdd(XMVectorSubtract(b, a), t, a);
+                    }
+                }
+
+                for (uint32_t d = 0; d < m_outputChannels; ++d)
+                {
+                    auto dest = reinterpret_cast<XMFLOAT4*>(buffer + size_t(d) * m_paddedFrames + f);
+                    XMVECTOR sum = XMLoadFloat4(dest);
+                    for (uint32_t c = 0; c < sourceChannels; ++c)
+                    {
+                        sum = XMVectorMultiplyAdd(samples[c], levels[size_t(d) * sourceChannels + c], sum);
+                    }
+                    XMStoreFloat4(dest, sum);
+                }
+            }
+
+            // The position after exactly 'frames' output frames; padding lanes do not count.
+            const uint64_t advanced = voice.position + voice.step * frames;
+            if (advanced >= length)
+            {
+                if (voice.loop)
+                {
+                    voice.position = advanced % length;
+                }
+                else
+                {
+                    voice.position = length;
+                    voice.playing = false;
+                }
+            }
+            else
+            {
+                voice.position = advanced;
+            }
+        }
+
+        uint32_t                m_outputChannels;
+        uint32_t                m_sampleRate;
+        uint32_t                m_quantumFrames;
+        uint32_t                m_paddedFrames;
+        float                   m_masterVolume;
+        std::vector<Voice>      m_voices;
+        std::vector<Submix>     m_submixes;
+        std::vector<float>      m_master;   // planar, m_paddedFrames per channel
+    };
+
+    struct SoftwareMixTiming
+    {
+        size_t  voices;
+        size_t  workers;
+        double  audioMilliseconds;
+        double  renderMilliseconds;
+
+        // Voices one core could keep mixing in real time at this load.
+        double GetVoicesPerCore() const noexcept
+        {
+            return (renderMilliseconds > 0.0) ? double(voices) * audioMilliseconds / (renderMilliseconds * double(workers)) : 0.0;
+        }
+    };
+
+    // Renders 'frames' output frames of 'mixer' into a scratch buffer and times it.
+    inline SoftwareMixTiming MeasureSoftwareMix(SoftwareMixer& mixer, size_t frames, RecordingJobSystem* jobs = nullptr)
+    {
+        std::vector<float> output(frames * mixer.GetOutputChannelCount());
+
+        const size_t voices = mixer.GetPlayingVoiceCount();
+
+        const auto start = std::chrono::steady_clock::now();
+        mixer.Render(output.data(), frames, jobs);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+        SoftwareMixTiming timing = {};
+        timing.voices = voices;
+        timing.workers = jobs ? std::min(jobs->GetWorkerCount(), mixer.GetSubmixCount()) : 1;
+        timing.audioMilliseconds = double(frames) * 1000.0 / double(mixer.GetSampleRate());
+        timing.renderMilliseconds = elapsed.count();
+        return timing;
+    }
+}
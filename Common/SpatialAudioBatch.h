@@ -0,0 +1,492 @@
+//--------------------------------------------------------------------------------------
+// File: SpatialAudioBatch.h
+//
+// Batched 3D audio spatialization for many point emitters
+//
+// SoundEffectInstance::Apply3D runs X3DAudioCalculate for one emitter at a time. Here
+// the caller fills SpatialEmitterArrays (one array per attribute), and distance, the
+// listener and emitter cones, the distance curves, Doppler, and the output matrix are
+// evaluated four emitters at a time with DirectXMath. Emitters that share curves and a
+// cone (e.g. every instance of one sound) share one SpatialEmitterProfile.
+//
+// Panning is read from a SpatialPanTable: the output gains of a unit-level point source
+// sampled around the listener. Filling the table from X3DAudio (SpatialAudioBatchX3D.h)
+// makes the batch pan exactly as Apply3D does for any speaker layout. Only point
+// emitters (one channel, no inner radius) are handled; anything else still needs
+// X3DAudioCalculate.
+//
+// Vectors use X3DAudio's left-handed convention unless rhcoords is set, in which case Z
+// is negated as Apply3D does.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <DirectXMath.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    // Layout-compatible with X3DAUDIO_DISTANCE_CURVE_POINT.
+    struct SpatialCurvePoint
+    {
+        float distance;     // normalized: world distance / curve distance scaler
+        float value;
+    };
+
+    // Layout-compatible with X3DAUDIO_CONE. Angles are whole-cone angles in radians. Inside
+    // the inner cone the inner values apply, beyond the outer cone the outer values, and they
+    // are interpolated in between.
+    struct SpatialCone
+    {
+        float innerAngle;
+        float outerAngle;
+        float innerVolume;      // matrix scaler
+        float outerVolume;
+        float innerLPF;         // LPF coefficient subtrahend (direct and reverb paths)
+        float outerLPF;
+        float innerReverb;      // reverb send scaler
+        float outerReverb;
+    };
+
+    // Piecewise-linear over normalized distance, clamped at both ends. Empty selects the
+    // X3DAudio default for that curve.
+    using SpatialCurve = std::vector<SpatialCurvePoint>;
+
+    struct SpatialListener
+    {
+        DirectX::XMFLOAT3   position;
+        DirectX::XMFLOAT3   orientFront;    // orthonormal
+        DirectX::XMFLOAT3   orientTop;
+        DirectX::XMFLOAT3   velocity;
+        const SpatialCone*  cone;           // null for omnidirectional
+    };
+
+    struct SpatialEmitterProfile
+    {
+        SpatialCurve        volumeCurve;        // default: 1 within the scaler, then inverse distance
+        SpatialCurve        lfeCurve;           // default: as volume
+        SpatialCurve        lpfDirectCurve;     // default: 1 to 0.75
+        SpatialCurve        lpfReverbCurve;     // default: 0.75
+        SpatialCurve        reverbCurve;        // default: 1 to 0
+        const SpatialCone*  cone;               // null for omnidirectional
+        float               curveDistanceScaler;
+        float               dopplerScaler;
+
+        SpatialEmitterProfile() noexcept : cone(nullptr), curveDistanceScaler(1.f), dopplerScaler(1.f) {}
+    };
+
+    // One array per emitter attribute; every array holds GetCount() entries. The front
+    // orientation is only read when the profile has a cone.
+    struct SpatialEmitterArrays
+    {
+        std::vector<float>  positionX;
+        std::vector<float>  positionY;
+        std::vector<float>  positionZ;
+        std::vector<float>  velocityX;
+        std::vector<float>  velocityY;
+        std::vector<float>  velocityZ;
+        std::vector<float>  frontX;
+        std::vector<float>  frontY;
+        std::vector<float>  frontZ;
+
+        size_t GetCount() const noexcept { return positionX.size(); }
+
+        void Resize(size_t count)
+        {
+            for (auto a : { &positionX, &positionY, &positionZ, &velocityX, &velocityY, &velocityZ, &frontX, &frontY })
+            {
+                a->resize(count, 0.f);
+            }
+            frontZ.resize(count, 1.f);
+        }
+
+        void Set(size_t index, const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& velocity, const DirectX::XMFLOAT3& front) noexcept
+        {
+            positionX[index] = position.x;
+            positionY[index] = position.y;
+            positionZ[index] = position.z;
+            velocityX[index] = velocity.x;
+            velocityY[index] = velocity.y;
+            velocityZ[index] = velocity.z;
+            frontX[index] = front.x;
+            frontY[index] = front.y;
+            frontZ[index] = front.z;
+        }
+    };
+
+    // Per-emitter outputs, matching the X3DAUDIO_DSP_SETTINGS fields Apply3D uses.
+    struct SpatialResults
+    {
+        uint32_t            channelCount;
+        std::vector<float>  matrix;         // GetCount() rows of channelCount gains
+        std::vector<float>  dopplerFactor;
+        std::vector<float>  lpfDirect;
+        std::vector<float>  lpfReverb;
+        std::vector<float>  reverbLevel;
+        std::vector<float>  distance;
+
+        SpatialResults() noexcept : channelCount(0) {}
+
+        size_t GetCount() const noexcept { return distance.size(); }
+
+        const float* GetMatrix(size_t index) const noexcept { return &matrix[index * channelCount]; }
+    };
+
+    // Output gains of a unit-level point source by azimuth: radians clockwise from the
+    // listener's front, seen from above, over [0, 2pi).
+    class SpatialPanTable
+    {
+    public:
+        static constexpr uint32_t DefaultResolution = 1024;
+        static constexpr uint32_t NoChannel = UINT32_MAX;
+
+        SpatialPanTable() noexcept : m_channelCount(0), m_lfeChannel(NoChannel), m_resolution(0), m_scale(0.f) {}
+
+        // fill(azimuth, gains) writes 'channelCount' gains. The LFE channel, if any, is scaled by
+        // the LFE curve rather than the volume curve.
+        template<typename TFunc>
+        void Build(uint32_t channelCount, uint32_t lfeChannel, TFunc&& fill, uint32_t resolution = DefaultResolution)
+        {
+            if (!channelCount || resolution < 4)
+                throw std::invalid_argument("SpatialPanTable needs at least one channel and four samples");
+
+            m_channelCount = channelCount;
+            m_lfeChannel = (lfeChannel < channelCount) ? lfeChannel : NoChannel;
+            m_resolution = resolution;
+            m_scale = float(resolution) / DirectX::XM_2PI;
+
+            // One extra row repeats azimuth 0 so lookups never wrap.
+            m_gains.assign(size_t(resolution + 1) * channelCount, 0.f);
+            for (uint32_t j = 0; j < resolution; ++j)
+            {
+                fill(float(j) * DirectX::XM_2PI / float(resolution), &m_gains[size_t(j) * channelCount]);
+            }
+            std::copy_n(m_gains.cbegin(), channelCount, m_gains.begin() + ptrdiff_t(resolution) * channelCount);
+        }
+
+        uint32_t GetChannelCount() const noexcept { return m_channelCount; }
+        uint32_t GetLFEChannel() const noexcept { return m_lfeChannel; }
+        uint32_t GetResolution() const noexcept { return m_resolution; }
+
+        // Interpolated gains at 'azimuth' (any angle), each scaled by 'volume' or, for the LFE
+        // channel, 'lfe'.
+        void Lookup(float azimuth, float volume, float lfe, float* gains) const noexcept
+        {
+            float position = azimuth * m_scale;
+            position -= std::floor(position / float(m_resolution)) * float(m_resolution);
+
+            auto row = std::min(static_cast<uint32_t>(position), m_resolution - 1);
+            const float t = std::min(position - float(row), 1.f);
+
+            const float* a = &m_gains[size_t(row) * m_channelCount];
+            const float* b = a + m_channelCount;
+            for (uint32_t c = 0; c < m_channelCount; ++c)
+            {
+                gains[c] = (a[c] + (b[c] - a[c]) * t) * ((c == m_lfeChannel) ? lfe : volume);
+            }
+        }
+
+    private:
+        uint32_t            m_channelCount;
+        uint32_t            m_lfeChannel;
+        uint32_t            m_resolution;
+        float               m_scale;
+        std::vector<float>  m_gains;
+    };
+
+    class SpatialAudioBatch
+    {
+    public:
+        static constexpr float DefaultSpeedOfSound = 343.5f;    // X3DAUDIO_SPEED_OF_SOUND
+
+        explicit SpatialAudioBatch(float speedOfSound = DefaultSpeedOfSound) noexcept : m_speedOfSound(speedOfSound) {}
+
+        // Evaluates every emitter in 'emitters' against 'listener', resizing 'results'.
+        void Calculate(const SpatialListener& listener, const SpatialEmitterProfile& profile,
+            const SpatialPanTable& panTable, const SpatialEmitterArrays& emitters, SpatialResults& results,
+            bool rhcoords = true) const
+        {
+            using namespace DirectX;
+
+            const size_t count = emitters.GetCount();
+            const uint32_t channels = panTable.GetChannelCount();
+            if (!channels)
+                throw std::logic_error("SpatialPanTable has not been built");
+
+            results.channelCount = channels;
+            results.matrix.resize(count * channels);
+            for (auto a : { &results.dopplerFactor, &results.lpfDirect, &results.lpfReverb, &results.reverbLevel, &results.distance })
+            {
+                a->resize(count);
+            }
+
+            if (!count)
+                return;
+
+            static const SpatialCurve s_defaultLPFDirect = { { 0.f, 1.f }, { 1.f, 0.75f } };
+            static const SpatialCurve s_defaultLPFReverb = { { 0.f, 0.75f }, { 1.f, 0.75f } };
+            static const SpatialCurve s_defaultReverb = { { 0.f, 1.f }, { 1.f, 0.f } };
+
+            const CompiledCurve volumeCurve(profile.volumeCurve);
+            const CompiledCurve lfeCurve(profile.lfeCurve);
+            const CompiledCurve lpfDirectCurve(profile.lpfDirectCurve.empty() ? s_defaultLPFDirect : profile.lpfDirectCurve);
+            const CompiledCurve lpfReverbCurve(profile.lpfReverbCurve.empty() ? s_defaultLPFReverb : profile.lpfReverbCurve);
+            const CompiledCurve reverbCurve(profile.reverbCurve.empty() ? s_defaultReverb : profile.reverbCurve);
+
+            const float zSign = rhcoords ? -1.f : 1.f;
+            auto flip = [zSign](const XMFLOAT3& v) { return XMFLOAT3(v.x, v.y, v.z * zSign); };
+
+            const XMFLOAT3 listenerPosition = flip(listener.position);
+            const XMFLOAT3 listenerFront = flip(listener.orientFront);
+            const XMFLOAT3 listenerVelocity = flip(listener.velocity);
+
+            // X3DAudio is left-handed, so right = top x front.
+            const XMFLOAT3 listenerTop = flip(listener.orientTop);
+            XMFLOAT3 listenerRight;
+            XMStoreFloat3(&listenerRight, XMVector3Cross(XMLoadFloat3(&listenerTop), XMLoadFloat3(&listenerFront)));
+
+            const XMVECTOR invScaler = XMVectorReplicate(1.f / profile.curveDistanceScaler);
+            const XMVECTOR zSignV = XMVectorReplicate(zSign);
+            const XMVECTOR zero = XMVectorZero();
+            const XMVECTOR one = XMVectorSplatOne();
+
+            // Doppler: velocity components along emitter-to-listener, each capped below the
+            // scaled speed of sound so the factor stays finite.
+            const float dopplerScaler = profile.dopplerScaler;
+            const XMVECTOR speed = XMVectorReplicate(m_speedOfSound);
+            const XMVECTOR dopplerScalerV = XMVectorReplicate(dopplerScaler);
+            const XMVECTOR componentLimit = XMVectorReplicate((dopplerScaler > 0.f) ? (m_speedOfSound / dopplerScaler) * 0.9999f : 0.f);
+
+            float azimuth[4], volume[4], lfe[4];
+
+            for (size_t j = 0; j < count; j += 4)
+            {
+                // A short last group repeats its final emitter in the unused lanes.
+                const size_t lanes = std::min<size_t>(count - j, 4);
+                auto load = [&](const std::vector<float>& a) -> XMVECTOR
+                    {
+                        return (lanes == 4)
+                            ? XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a[j]))
+                            : XMVectorSet(a[j], a[j + std::min<size_t>(1, lanes - 1)], a[j + std::min<size_t>(2, lanes - 1)], a[j + lanes - 1]);
+                    };
+                auto store = [&](std::vector<float>& a, FXMVECTOR v)
+                    {
+                        XMFLOAT4 values;
+                        XMStoreFloat4(&values, v);
+                        const float* f = &values.x;
+                        std::copy_n(f, lanes, &a[j]);
+                    };
+
+                // Emitter to listener.
+                const XMVECTOR dx = XMVectorSubtract(XMVectorReplicate(listenerPosition.x), load(emitters.positionX));
+                const XMVECTOR dy = XMVectorSubtract(XMVectorReplicate(listenerPosition.y), load(emitters.positionY));
+                const XMVECTOR dz = XMVectorSubtract(XMVectorReplicate(listenerPosition.z), XMVectorMultiply(load(emitters.positionZ), zSignV));
+
+                const XMVECTOR distance = XMVectorSqrt(Dot(dx, dy, dz, dx, dy, dz));
+                const XMVECTOR valid = XMVectorGreater(distance, zero);
+                const XMVECTOR invDistance = XMVectorSelect(zero, XMVectorReciprocal(distance), valid);
+                const XMVECTOR normalized = XMVectorMultiply(distance, invScaler);
+
+                XMVECTOR volumeLevel = volumeCurve.IsEmpty() ? InverseDistance(normalized) : volumeCurve.Evaluate(normalized);
+                XMVECTOR lfeLevel = lfeCurve.IsEmpty() ? InverseDistance(normalized) : lfeCurve.Evaluate(normalized);
+                XMVECTOR lpfDirect = lpfDirectCurve.Evaluate(normalized);
+                XMVECTOR lpfReverb = lpfReverbCurve.Evaluate(normalized);
+                XMVECTOR reverb = reverbCurve.Evaluate(normalized);
+
+                // Listener to emitter, in the listener's frame.
+                const XMVECTOR forward = XMVectorNegate(Dot(dx, dy, dz, listenerFront));
+                const XMVECTOR right = XMVectorNegate(Dot(dx, dy, dz, listenerRight));
+
+                if (listener.cone)
+                {
+                    const ConeValues cone = EvaluateCone(*listener.cone, forward, invDistance, valid);
+                    volumeLevel = XMVectorMultiply(volumeLevel, cone.volume);
+                    lfeLevel = XMVectorMultiply(lfeLevel, cone.volume);
+                    lpfDirect = XMVectorSubtract(lpfDirect, cone.lpf);
+                    lpfReverb = XMVectorSubtract(lpfReverb, cone.lpf);
+                    reverb = XMVectorMultiply(reverb, cone.reverb);
+                }
+
+                if (profile.cone)
+                {
+                    const XMVECTOR cosine = Dot(dx, dy, dz,
+                        load(emitters.frontX), load(emitters.frontY), XMVectorMultiply(load(emitters.frontZ), zSignV));
+
+                    const ConeValues cone = EvaluateCone(*profile.cone, cosine, invDistance, valid);
+                    volumeLevel = XMVectorMultiply(volumeLevel, cone.volume);
+                    lpfDirect = XMVectorSubtract(lpfDirect, cone.lpf);
+                    lpfReverb = XMVectorSubtract(lpfReverb, cone.lpf);
+                    reverb = XMVectorMultiply(reverb, cone.reverb);
+                }
+
+                store(results.distance, distance);
+                store(results.lpfDirect, XMVectorSaturate(lpfDirect));
+                store(results.lpfReverb, XMVectorSaturate(lpfReverb));
+                store(results.reverbLevel, reverb);
+
+                if (dopplerScaler > 0.f)
+                {
+                    const XMVECTOR listenerComponent = XMVectorMin(XMVectorMultiply(Dot(dx, dy, dz, listenerVelocity), invDistance), componentLimit);
+                    const XMVECTOR emitterComponent = XMVectorMin(XMVectorMultiply(
+                        Dot(dx, dy, dz, load(emitters.velocityX), load(emitters.velocityY), XMVectorMultiply(load(emitters.velocityZ), zSignV)),
+                        invDistance), componentLimit);
+
+                    store(results.dopplerFactor, XMVectorDivide(
+                        XMVectorNegativeMultiplySubtract(dopplerScalerV, listenerComponent, speed),
+                        XMVectorNegativeMultiplySubtract(dopplerScalerV, emitterComponent, speed)));
+                }
+                else
+                {
+                    store(results.dopplerFactor, one);
+                }
+
+                // The pan table has no gather, so the matrix rows are written lane by lane.
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(azimuth), XMVectorATan2(right, forward));
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(volume), volumeLevel);
+                XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(lfe), lfeLevel);
+
+                for (size_t k = 0; k < lanes; ++k)
+                {
+                    panTable.Lookup(azimuth[k], volume[k], lfe[k], &results.matrix[(j + k) * channels]);
+                }
+            }
+        }
+
+        float GetSpeedOfSound() const noexcept { return m_speedOfSound; }
+
+    private:
+        // Curve points as segments: value = first + sum of slope * clamp(d - start, 0, width).
+        class CompiledCurve
+        {
+        public:
+            explicit CompiledCurve(const SpatialCurve& curve) :
+                m_first(curve.empty() ? 0.f : curve.front().value)
+            {
+                for (size_t j = 1; j < curve.size(); ++j)
+                {
+                    const float width = curve[j].distance - curve[j - 1].distance;
+                    const float delta = curve[j].value - curve[j - 1].value;
+                    if (width > 0.f)
+                    {
+                        m_segments.push_back({ curve[j - 1].distance, width, delta / width });
+                    }
+                    else if (delta != 0.f)
+                    {
+                        // A vertical step: takes effect just past its distance.
+                        m_segments.push_back({ curve[j - 1].distance, 0.f, delta });
+                    }
+                }
+                m_empty = curve.empty();
+            }
+
+            bool IsEmpty() const noexcept { return m_empty; }
+
+            DirectX::XMVECTOR XM_CALLCONV Evaluate(DirectX::FXMVECTOR distance) const noexcept
+            {
+                using namespace DirectX;
+
+                XMVECTOR value = XMVectorReplicate(m_first);
+                for (auto const& s : m_segments)
+                {
+                    const XMVECTOR offset = XMVectorSubtract(distance, XMVectorReplicate(s.start));
+                    const XMVECTOR step = (s.width > 0.f)
+                        ? XMVectorMultiply(XMVectorClamp(offset, XMVectorZero(), XMVectorReplicate(s.width)), XMVectorReplicate(s.slope))
+                        : XMVectorSelect(XMVectorZero(), XMVectorReplicate(s.slope), XMVectorGreater(offset, XMVectorZero()));
+                    value = XMVectorAdd(value, step);
+                }
+                return value;
+            }
+
+        private:
+            struct Segment
+            {
+                float start;
+                float width;
+                float slope;
+            };
+
+            float                   m_first;
+            bool                    m_empty;
+            std::vector<Segment>    m_segments;
+        };
+
+        struct ConeValues
+        {
+            DirectX::XMVECTOR volume;
+            DirectX::XMVECTOR lpf;
+            DirectX::XMVECTOR reverb;
+        };
+
+        // 'projection' is the front vector dotted with the unnormalized direction; coincident
+        // positions count as inside the inner cone.
+        static ConeValues XM_CALLCONV EvaluateCone(const SpatialCone& cone,
+            DirectX::FXMVECTOR projection, DirectX::FXMVECTOR invDistance, DirectX::FXMVECTOR valid) noexcept
+        {
+            using namespace DirectX;
+
+            const XMVECTOR cosine = XMVectorClamp(XMVectorMultiply(projection, invDistance), XMVectorReplicate(-1.f), XMVectorSplatOne());
+            const XMVECTOR angle = XMVectorACos(cosine);
+
+            const float halfInner = cone.innerAngle * 0.5f;
+            const float halfOuter = cone.outerAngle * 0.5f;
+
+            // 0 on or within the inner cone, 1 beyond the outer, linear in between.
+            XMVECTOR t;
+            if (halfOuter > halfInner)
+            {
+                t = XMVectorSaturate(XMVectorMultiply(XMVectorSubtract(angle, XMVectorReplicate(halfInner)),
+                    XMVectorReplicate(1.f / (halfOuter - halfInner))));
+            }
+            else
+            {
+                t = XMVectorSelect(XMVectorZero(), XMVectorSplatOne(), XMVectorGreater(angle, XMVectorReplicate(halfInner)));
+            }
+            t = XMVectorSelect(XMVectorZero(), t, valid);
+
+            ConeValues values;
+            values.volume = Lerp(cone.innerVolume, cone.outerVolume, t);
+            values.lpf = Lerp(cone.innerLPF, cone.outerLPF, t);
+            values.reverb = Lerp(cone.innerReverb, cone.outerReverb, t);
+            return values;
+        }
+
+        static DirectX::XMVECTOR XM_CALLCONV Lerp(float a, float b, DirectX::FXMVECTOR t) noexcept
+        {
+            using namespace DirectX;
+            return XMVectorMultiplyAdd(XMVectorReplicate(b - a), t, XMVectorReplicate(a));
+        }
+
+        // X3DAudio's default volume and LFE curves: no gain inside the scaler, then 1/d.
+        static DirectX::XMVECTOR XM_CALLCONV InverseDistance(DirectX::FXMVECTOR normalized) noexcept
+        {
+            using namespace DirectX;
+            return XMVectorReciprocal(XMVectorMax(normalized, XMVectorSplatOne()));
+        }
+
+        static DirectX::XMVECTOR XM_CALLCONV Dot(DirectX::FXMVECTOR ax, DirectX::FXMVECTOR ay, DirectX::FXMVECTOR az,
+            DirectX::GXMVECTOR bx, DirectX::HXMVECTOR by, DirectX::HXMVECTOR bz) noexcept
+        {
+            using namespace DirectX;
+            return XMVectorMultiplyAdd(az, bz, XMVectorMultiplyAdd(ay, by, XMVectorMultiply(ax, bx)));
+        }
+
+        static DirectX::XMVECTOR XM_CALLCONV Dot(DirectX::FXMVECTOR ax, DirectX::FXMVECTOR ay, DirectX::FXMVECTOR az,
+            const DirectX::XMFLOAT3& b) noexcept
+        {
+            using namespace DirectX;
+            return Dot(ax, ay, az, XMVectorReplicate(b.x), XMVectorReplicate(b.y), XMVectorReplicate(b.z));
+        }
+
+        float m_speedOfSound;
+    };
+}
@@ -0,0 +1,153 @@
+//--------------------------------------------------------------------------------------
+// File: SpatialAudioBatchX3D.h
+//
+// X3DAudio/XAudio2 glue for DX::SpatialAudioBatch
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "SpatialAudioBatch.h"
+
+#include <Audio.h>
+
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+
+namespace DX
+{
+    static_assert(sizeof(SpatialCurvePoint) == sizeof(X3DAUDIO_DISTANCE_CURVE_POINT), "SpatialCurvePoint mismatch");
+    static_assert(sizeof(SpatialCone) == sizeof(X3DAUDIO_CONE), "SpatialCone mismatch");
+
+    inline uint32_t GetSpeakerCount(uint32_t channelMask) noexcept
+    {
+        uint32_t count = 0;
+        for (; channelMask; channelMask &= channelMask - 1)
+        {
+            ++count;
+        }
+        return count;
+    }
+
+    // Samples the panning X3DAudio applies for 'handle' (initialized with 'channelMask'): a point
+    // emitter at the curve distance scaler, so the default curves give unit gain, is walked
+    // around a listener at the origin. 'calculateFlags' may add X3DAUDIO_CALCULATE_REDIRECT_TO_LFE
+    // or X3DAUDIO_CALCULATE_ZEROCENTER to match the flags used elsewhere.
+    inline void BuildSpatialPanTable(SpatialPanTable& table, const X3DAUDIO_HANDLE handle, uint32_t channelMask,
+        uint32_t calculateFlags = 0, uint32_t resolution = SpatialPanTable::DefaultResolution)
+    {
+        const uint32_t channels = GetSpeakerCount(channelMask);
+        if (!channels || channels > XAUDIO2_MAX_AUDIO_CHANNELS)
+            throw std::invalid_argument("Unsupported channel mask");
+
+        const uint32_t lfeChannel = (channelMask & SPEAKER_LOW_FREQUENCY)
+            ? GetSpeakerCount(channelMask & (SPEAKER_LOW_FREQUENCY - 1))
+            : SpatialPanTable::NoChannel;
+
+        X3DAUDIO_LISTENER listener = {};
+        listener.OrientFront = DirectX::XMFLOAT3(0.f, 0.f, 1.f);
+        listener.OrientTop = DirectX::XMFLOAT3(0.f, 1.f, 0.f);
+
+        X3DAUDIO_EMITTER emitter = {};
+        emitter.OrientFront = DirectX::XMFLOAT3(0.f, 0.f, 1.f);
+        emitter.OrientTop = DirectX::XMFLOAT3(0.f, 1.f, 0.f);
+        emitter.ChannelCount = 1;
+        emitter.CurveDistanceScaler = 1.f;
+        emitter.DopplerScaler = 1.f;
+
+        float matrix[XAUDIO2_MAX_AUDIO_CHANNELS] = {};
+
+        X3DAUDIO_DSP_SETTINGS dsp = {};
+        dsp.pMatrixCoefficients = matrix;
+        dsp.SrcChannelCount = 1;
+        dsp.DstChannelCount = channels;
+
+        table.Build(channels, lfeChannel, [&](float azimuth, float* gains)
+            {
+                // X3DAudio is left-handed: +X is the listener's right.
+                emitter.Position = DirectX::XMFLOAT3(sinf(azimuth), 0.f, cosf(azimuth));
+
+                X3DAudioCalculate(handle, &listener, &emitter, calculateFlags | X3DAUDIO_CALCULATE_MATRIX, &dsp);
+
+                for (uint32_t c = 0; c < channels; ++c)
+                {
+                    gains[c] = matrix[c];
+                }
+            }, resolution);
+    }
+
+    inline SpatialListener MakeSpatialListener(const X3DAUDIO_LISTENER& listener) noexcept
+    {
+        SpatialListener result;
+        result.position = listener.Position;
+        result.orientFront = listener.OrientFront;
+        result.orientTop = listener.OrientTop;
+        result.velocity = listener.Velocity;
+        result.cone = reinterpret_cast<const SpatialCone*>(listener.pCone);
+        return result;
+    }
+
+    // The curves, cone, and scalers of a point emitter. The cone is referenced, not copied.
+    inline SpatialEmitterProfile MakeSpatialEmitterProfile(const X3DAUDIO_EMITTER& emitter)
+    {
+        if (emitter.ChannelCount != 1 || emitter.InnerRadius > 0.f)
+            throw std::invalid_argument("SpatialAudioBatch supports mono point emitters only");
+
+        auto copyCurve = [](const X3DAUDIO_DISTANCE_CURVE* curve) -> SpatialCurve
+            {
+                if (!curve || !curve->pPoints)
+                    return SpatialCurve();
+
+                auto points = reinterpret_cast<const SpatialCurvePoint*>(curve->pPoints);
+                return SpatialCurve(points, points + curve->PointCount);
+            };
+
+        SpatialEmitterProfile profile;
+        profile.volumeCurve = copyCurve(emitter.pVolumeCurve);
+        profile.lfeCurve = copyCurve(emitter.pLFECurve);
+        profile.lpfDirectCurve = copyCurve(emitter.pLPFDirectCurve);
+        profile.lpfReverbCurve = copyCurve(emitter.pLPFReverbCurve);
+        profile.reverbCurve = copyCurve(emitter.pReverbCurve);
+        profile.cone = reinterpret_cast<const SpatialCone*>(emitter.pCone);
+        profile.curveDistanceScaler = emitter.CurveDistanceScaler;
+        profile.dopplerScaler = emitter.DopplerScaler;
+        return profile;
+    }
+
+    inline void SetSpatialEmitter(SpatialEmitterArrays& emitters, size_t index, const X3DAUDIO_EMITTER& emitter) noexcept
+    {
+        emitters.Set(index, emitter.Position, emitter.Velocity, emitter.OrientFront);
+    }
+
+    // Applies one emitter's results to a source voice the way SoundEffectInstance::Apply3D does:
+    // Doppler-scaled pitch, the direct output matrix, the reverb send, and (optionally) the
+    // low-pass filters on both sends.
+    inline void ApplySpatialResults(const SpatialResults& results, size_t index, _In_ IXAudio2SourceVoice* voice,
+        _In_opt_ IXAudio2Voice* direct, _In_opt_ IXAudio2Voice* reverb,
+        float frequencyRatio = 1.f, bool useFilters = false)
+    {
+        ThrowIfFailed(voice->SetFrequencyRatio(frequencyRatio * results.dopplerFactor[index]));
+        ThrowIfFailed(voice->SetOutputMatrix(direct, 1, results.channelCount, results.GetMatrix(index)));
+
+        if (reverb)
+        {
+            ThrowIfFailed(voice->SetOutputMatrix(reverb, 1, 1, &results.reverbLevel[index]));
+        }
+
+        if (useFilters)
+        {
+            const XAUDIO2_FILTER_PARAMETERS filterDirect = { LowPassFilter, 2.0f * sinf(X3DAUDIO_PI / 6.0f * results.lpfDirect[index]), 1.0f };
+            ThrowIfFailed(voice->SetOutputFilterParameters(direct, &filterDirect));
+
+            if (reverb)
+            {
+                const XAUDIO2_FILTER_PARAMETERS filterReverb = { LowPassFilter, 2.0f * sinf(X3DAUDIO_PI / 6.0f * results.lpfReverb[index]), 1.0f };
+                ThrowIfFailed(voice->SetOutputFilterParameters(reverb, &filterReverb));
+            }
+        }
+    }
+}
@@ -0,0 +1,331 @@
+//--------------------------------------------------------------------------------------
+// File: TessellationCache.h
+//
+// Memoizing primitive tessellation on worker threads
+//
+// GeometricPrimitive::Create* regenerates its vertices and indices on every call, on
+// the calling thread. The cache here keys generated geometry by shape, parameters,
+// and handedness, runs each miss on a worker thread, and hands every later request
+// for the same primitive the one shared result. Generation is delegated to a backend
+// (see TessellationCacheD3D12.h for GeometricPrimitive), which lets a test substitute
+// one that fails on demand. Nothing here touches a device, so the cache and its timing
+// can also be built for CPU-only runs, such as Linux build machines.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "BackgroundWork.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    enum class PrimitiveShape : uint32_t
+    {
+        Cube,
+        Box,
+        Sphere,
+        GeoSphere,
+        Cylinder,
+        Cone,
+        Torus,
+        Tetrahedron,
+        Octahedron,
+        Dodecahedron,
+        Icosahedron,
+        Teapot,
+    };
+
+    inline const char* GetPrimitiveShapeName(PrimitiveShape shape) noexcept
+    {
+        switch (shape)
+        {
+        case PrimitiveShape::Cube:          return "Cube";
+        case PrimitiveShape::Box:           return "Box";
+        case PrimitiveShape::Sphere:        return "Sphere";
+        case PrimitiveShape::GeoSphere:     return "GeoSphere";
+        case PrimitiveShape::Cylinder:      return "Cylinder";
+        case PrimitiveShape::Cone:          return "Cone";
+        case PrimitiveShape::Torus:         return "Torus";
+        case PrimitiveShape::Tetrahedron:   return "Tetrahedron";
+        case PrimitiveShape::Octahedron:    return "Octahedron";
+        case PrimitiveShape::Dodecahedron:  return "Dodecahedron";
+        case PrimitiveShape::Icosahedron:   return "Icosahedron";
+        case PrimitiveShape::Teapot:        return "Teapot";
+        default:                            return "Unknown";
+        }
+    }
+
+    // Everything that selects a generated mesh. Use the factories so parameters a shape
+    // ignores stay zero and equal primitives compare equal.
+    struct PrimitiveDesc
+    {
+        PrimitiveShape  shape;
+        float           size[3];        // Box extents; size[0] is the size or diameter of the other shapes
+        float           height;         // Cylinder and Cone height, Torus thickness
+        uint32_t        tessellation;
+        bool            rhcoords;
+        bool            invertn;        // Box and Sphere only
+
+        static PrimitiveDesc Cube(float size, bool rhcoords = true) noexcept { return Make(PrimitiveShape::Cube, size, 0.f, 0, rhcoords); }
+
+        static PrimitiveDesc Box(float x, float y, float z, bool rhcoords = true, bool invertn = false) noexcept
+        {
+            PrimitiveDesc desc = Make(PrimitiveShape::Box, x, 0.f, 0, rhcoords);
+            desc.size[1] = y;
+            desc.size[2] = z;
+            desc.invertn = invertn;
+            return desc;
+        }
+
+        static PrimitiveDesc Sphere(float diameter, uint32_t tessellation = 16, bool rhcoords = true, bool invertn = false) noexcept
+        {
+            PrimitiveDesc desc = Make(PrimitiveShape::Sphere, diameter, 0.f, tessellation, rhcoords);
+            desc.invertn = invertn;
+            return desc;
+        }
+
+        static PrimitiveDesc GeoSphere(float diameter, uint32_t tessellation = 3, bool rhcoords = true) noexcept { return Make(PrimitiveShape::GeoSphere, diameter, 0.f, tessellation, rhcoords); }
+
+        // Height first, as GeometricPrimitive::CreateCylinder takes it.
+        static PrimitiveDesc Cylinder(float height, float diameter, uint32_t tessellation = 32, bool rhcoords = true) noexcept { return Make(PrimitiveShape::Cylinder, diameter, height, tessellation, rhcoords); }
+        static PrimitiveDesc Cone(float diameter, float height, uint32_t tessellation = 32, bool rhcoords = true) noexcept { return Make(PrimitiveShape::Cone, diameter, height, tessellation, rhcoords); }
+        static PrimitiveDesc Torus(float diameter, float thickness, uint32_t tessellation = 32, bool rhcoords = true) noexcept { return Make(PrimitiveShape::Torus, diameter, thickness, tessellation, rhcoords); }
+        static PrimitiveDesc Tetrahedron(float size, bool rhcoords = true) noexcept { return Make(PrimitiveShape::Tetrahedron, size, 0.f, 0, rhcoords); }
+        static PrimitiveDesc Octahedron(float size, bool rhcoords = true) noexcept { return Make(PrimitiveShape::Octahedron, size, 0.f, 0, rhcoords); }
+        static PrimitiveDesc Dodecahedron(float size, bool rhcoords = true) noexcept { return Make(PrimitiveShape::Dodecahedron, size, 0.f, 0, rhcoords); }
+        static PrimitiveDesc Icosahedron(float size, bool rhcoords = true) noexcept { return Make(PrimitiveShape::Icosahedron, size, 0.f, 0, rhcoords); }
+        static PrimitiveDesc Teapot(float size, uint32_t tessellation = 8, bool rhcoords = true) noexcept { return Make(PrimitiveShape::Teapot, size, 0.f, tessellation, rhcoords); }
+
+        bool operator== (const PrimitiveDesc& other) const noexcept
+        {
+            return shape == other.shape
+                && size[0] == other.size[0] && size[1] == other.size[1] && size[2] == other.size[2]
+                && height == other.height
+                && tessellation == other.tessellation
+                && rhcoords == other.rhcoords
+                && invertn == other.invertn;
+        }
+
+        bool operator!= (const PrimitiveDesc& other) const noexcept { return !(*this == other); }
+
+        uint64_t Hash() const noexcept
+        {
+            PipelineStateHasher hasher;
+            hasher.Add(shape);
+            hasher.Add(size[0]);
+            hasher.Add(size[1]);
+            hasher.Add(size[2]);
+            hasher.Add(height);
+            hasher.Add(tessellation);
+            hasher.Add(rhcoords);
+            hasher.Add(invertn);
+            return hasher.Get();
+        }
+
+    private:
+        static PrimitiveDesc Make(PrimitiveShape shape, float size, float height, uint32_t tessellation, bool rhcoords) noexcept
+        {
+            PrimitiveDesc desc = {};
+            desc.shape = shape;
+            desc.size[0] = size;
+            desc.height = height;
+            desc.tessellation = tessellation;
+            desc.rhcoords = rhcoords;
+            return desc;
+        }
+    };
+
+    struct PrimitiveDescHash
+    {
+        size_t operator() (const PrimitiveDesc& desc) const noexcept { return static_cast<size_t>(desc.Hash()); }
+    };
+
+    // TBackend must provide:
+    //
+    //  using Mesh = ...;                               // generated geometry, e.g. vertex and index collections
+    //  Mesh Generate(const PrimitiveDesc& desc);
+    //
+    // Generate is called from worker threads and must be thread-safe. Exceptions it throws
+    // reach every caller waiting on that primitive; the failed entry is dropped, so a later
+    // request generates it again.
+    template<typename TBackend>
+    class TessellationCache
+    {
+    public:
+        using Mesh = typename TBackend::Mesh;
+        using MeshPtr = std::shared_ptr<const Mesh>;
+
+        explicit TessellationCache(TBackend backend = TBackend(), size_t workerCount = 0) noexcept(false) :
+            m_backend(std::move(backend)),
+            m_requests(0),
+            m_hits(0),
+            m_generates(0),
+            m_generateTime(0),
+            m_workers(workerCount)
+        {
+        }
+
+        TessellationCache(TessellationCache const&) = delete;
+        TessellationCache& operator= (TessellationCache const&) = delete;
+
+        ~TessellationCache()
+        {
+            WaitForPending();
+        }
+
+        // Returns the geometry for 'desc'. A miss is generated on a worker thread (see
+        // BackgroundWorkQueue); concurrent requests for the same primitive share the one generation.
+        std::shared_future<MeshPtr> GetAsync(const PrimitiveDesc& desc)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            ++m_requests;
+
+            auto it = m_meshes.find(desc);
+            if (it != m_meshes.end())
+            {
+                ++m_hits;
+                return it->second;
+            }
+
+            std::shared_future<MeshPtr> result = m_workers.Submit(
+                [this, desc]()
+                {
+                    const auto start = std::chrono::steady_clock::now();
+
+                    std::shared_ptr<const Mesh> mesh;
+                    try
+                    {
+                        mesh = std::make_shared<const Mesh>(m_backend.Generate(desc));
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_meshes.erase(desc);
+                        throw;
+                    }
+
+                    const auto elapsed = std::chrono::duration_cast<Duration>(std::chrono::steady_clock::now() - start);
+
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    ++m_generates;
+                    m_generateTime += elapsed;
+
+                    return MeshPtr(std::move(mesh));
+                }).share();
+
+            m_meshes.emplace(desc, result);
+            return result;
+        }
+
+        MeshPtr Get(const PrimitiveDesc& desc)
+        {
+            return GetAsync(desc).get();
+        }
+
+        // Starts generating every primitive in the list without waiting for any of them.
+        void Prefetch(const PrimitiveDesc* descs, size_t count)
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                (void)GetAsync(descs[j]);
+            }
+        }
+
+        void WaitForPending()
+        {
+            std::vector<std::shared_future<MeshPtr>> pending;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                pending.reserve(m_meshes.size());
+                for (auto& it : m_meshes)
+                {
+                    pending.push_back(it.second);
+                }
+            }
+
+            for (auto& it : pending)
+            {
+                it.wait();
+            }
+        }
+
+        // Drops every cached mesh. Meshes already handed out stay alive with their holders.
+        void Clear()
+        {
+            WaitForPending();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_meshes.clear();
+        }
+
+        size_t GetMeshCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_meshes.size(); }
+
+        uint64_t GetRequestCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_requests; }
+        uint64_t GetHitCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_hits; }
+        uint64_t GetGenerateCount() const { std::lock_guard<std::mutex> lock(m_mutex); return m_generates; }
+
+        // Worker time spent inside the backend, summed over threads.
+        double GetGenerateMilliseconds() const
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return std::chrono::duration<double, std::milli>(m_generateTime).count();
+        }
+
+        size_t GetWorkerCount() const noexcept { return m_workers.GetWorkerCount(); }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+    private:
+        using Duration = std::chrono::microseconds;
+
+        TBackend                                                                        m_backend;
+
+        mutable std::mutex                                                              m_mutex;
+        std::unordered_map<PrimitiveDesc, std::shared_future<MeshPtr>, PrimitiveDescHash> m_meshes;
+
+        uint64_t                                                                        m_requests;
+        uint64_t                                                                        m_hits;
+        uint64_t                                                                        m_generates;
+        Duration                                                                        m_generateTime;
+
+        // Last, so the workers are joined before the state they use is destroyed.
+        BackgroundWorkQueue                                                             m_workers;
+    };
+
+    // Average milliseconds for one uncached generation of 'desc', over 'iterations' runs on the
+    // calling thread. The last result is returned through 'mesh' if given.
+    template<typename TBackend>
+    double MeasureTessellation(TBackend& backend, const PrimitiveDesc& desc, uint32_t iterations,
+        typename TBackend::Mesh* mesh = nullptr)
+    {
+        if (!iterations)
+            return 0.0;
+
+        const auto start = std::chrono::steady_clock::now();
+
+        for (uint32_t j = 0; j < iterations; ++j)
+        {
+            auto result = backend.Generate(desc);
+            if (mesh && j + 1 == iterations)
+            {
+                *mesh = std::move(result);
+            }
+        }
+
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / static_cast<double>(iterations);
+    }
+}
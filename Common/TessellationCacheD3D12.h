@@ -0,0 +1,81 @@
+//--------------------------------------------------------------------------------------
+// File: TessellationCacheD3D12.h
+//
+// DirectX Tool Kit GeometricPrimitive backend for DX::TessellationCache
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "TessellationCache.h"
+
+#include <GeometricPrimitive.h>
+
+#include <future>
+#include <memory>
+#include <stdexcept>
+
+
+namespace DX
+{
+    struct GeometricPrimitiveMesh
+    {
+        DirectX::GeometricPrimitive::VertexCollection   vertices;
+        DirectX::GeometricPrimitive::IndexCollection    indices;
+    };
+
+    // Generates through the CPU-only GeometricPrimitive::Create* overloads, which are safe to
+    // call concurrently.
+    class GeometricPrimitiveTessellator
+    {
+    public:
+        using Mesh = GeometricPrimitiveMesh;
+
+        Mesh Generate(const PrimitiveDesc& desc) const
+        {
+            using DirectX::GeometricPrimitive;
+
+            Mesh mesh;
+            auto& v = mesh.vertices;
+            auto& i = mesh.indices;
+
+            switch (desc.shape)
+            {
+            case PrimitiveShape::Cube:          GeometricPrimitive::CreateCube(v, i, desc.size[0], desc.rhcoords); break;
+            case PrimitiveShape::Box:           GeometricPrimitive::CreateBox(v, i, DirectX::XMFLOAT3(desc.size[0], desc.size[1], desc.size[2]), desc.rhcoords, desc.invertn); break;
+            case PrimitiveShape::Sphere:        GeometricPrimitive::CreateSphere(v, i, desc.size[0], desc.tessellation, desc.rhcoords, desc.invertn); break;
+            case PrimitiveShape::GeoSphere:     GeometricPrimitive::CreateGeoSphere(v, i, desc.size[0], desc.tessellation, desc.rhcoords); break;
+            case PrimitiveShape::Cylinder:      GeometricPrimitive::CreateCylinder(v, i, desc.height, desc.size[0], desc.tessellation, desc.rhcoords); break;
+            case PrimitiveShape::Cone:          GeometricPrimitive::CreateCone(v, i, desc.size[0], desc.height, desc.tessellation, desc.rhcoords); break;
+            case PrimitiveShape::Torus:         GeometricPrimitive::CreateTorus(v, i, desc.size[0], desc.height, desc.tessellation, desc.rhcoords); break;
+            case PrimitiveShape::Tetrahedron:   GeometricPrimitive::CreateTetrahedron(v, i, desc.size[0], desc.rhcoords); break;
+            case PrimitiveShape::Octahedron:    GeometricPrimitive::CreateOctahedron(v, i, desc.size[0], desc.rhcoords); break;
+            case PrimitiveShape::Dodecahedron:  GeometricPrimitive::CreateDodecahedron(v, i, desc.size[0], desc.rhcoords); break;
+            case PrimitiveShape::Icosahedron:   GeometricPrimitive::CreateIcosahedron(v, i, desc.size[0], desc.rhcoords); break;
+            case PrimitiveShape::Teapot:        GeometricPrimitive::CreateTeapot(v, i, desc.size[0], desc.tessellation, desc.rhcoords); break;
+            default:
+                throw std::invalid_argument("Unknown primitive shape");
+            }
+
+            return mesh;
+        }
+    };
+
+    using GeometricPrimitiveCache = TessellationCache<GeometricPrimitiveTessellator>;
+
+    // Creates a primitive on a worker thread once its geometry is ready. CreateCustom copies the
+    // cached vertices and indices directly into GraphicsMemory upload memory, which is safe to
+    // allocate from any thread; the primitive can then be drawn as-is or moved to static
+    // buffers with LoadStaticBuffers on the render thread.
+    inline std::future<std::unique_ptr<DirectX::GeometricPrimitive>> CreateGeometricPrimitiveAsync(
+        GeometricPrimitiveCache& cache, const PrimitiveDesc& desc, _In_opt_ ID3D12Device* device = nullptr)
+    {
+        auto mesh = cache.GetAsync(desc);
+        return std::async(std::launch::async, [mesh, device]()
+            {
+                auto const& geometry = *mesh.get();
+                return DirectX::GeometricPrimitive::CreateCustom(geometry.vertices, geometry.indices, device);
+            });
+    }
+}
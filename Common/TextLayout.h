@@ -0,0 +1,580 @@
+//--------------------------------------------------------------------------------------
+// File: TextLayout.h
+//
+// Pre-laid-out SpriteFont text, and an LRU cache of layouts for dynamic strings
+//
+// SpriteFont::DrawString and MeasureString convert UTF-8 text, look up every glyph, and
+// walk the advances and line breaks again on every call. A text layout does that once
+// and keeps the resulting glyph run: drawing replays the run with the same offsets
+// SpriteFont computes, and measuring reads the stored extents. Text that never changes
+// can own its layout; text that changes now and then goes through TextLayoutCache.
+//
+// Scale is not part of a layout. SpriteBatch applies it per sprite, so one layout (and
+// one cache entry) serves every scale.
+//
+// Given a GlyphTable for the font, layout looks characters up in constant time instead
+// of through FindGlyph's binary search.
+//
+// TFont must provide (DirectX::SpriteFont does):
+//
+//   struct Glyph;                                  // Character, Subrect, XOffset, YOffset, XAdvance
+//   Glyph const* FindGlyph(wchar_t) const;         // falls back to the default character, or throws
+//   float GetLineSpacing() const;
+//   wchar_t GetDefaultCharacter() const;
+//   D3D12_GPU_DESCRIPTOR_HANDLE GetSpriteSheet() const;
+//   XMUINT2 GetSpriteSheetSize() const;
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "GlyphTable.h"
+
+#include <DirectXColors.h>
+#include <DirectXMath.h>
+#include <SpriteBatch.h>
+#include <SpriteFont.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <iterator>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+
+namespace DX
+{
+    template<typename TFont>
+    class BasicTextLayout
+    {
+    public:
+        using Glyph = typename TFont::Glyph;
+        using GlyphTable = BasicGlyphTable<Glyph>;
+
+        BasicTextLayout() noexcept :
+            m_font(nullptr),
+            m_lineSpacing(0),
+            m_defaultCharacter(0),
+            m_size(0, 0),
+            m_sizeWithWhitespace(0, 0)
+        {
+        }
+
+        BasicTextLayout(const TFont& font, _In_z_ const wchar_t* text, _In_opt_ const GlyphTable* glyphTable = nullptr) :
+            BasicTextLayout()
+        {
+            Build(font, text, glyphTable);
+        }
+
+        BasicTextLayout(BasicTextLayout&&) = default;
+        BasicTextLayout& operator= (BasicTextLayout&&) = default;
+
+        BasicTextLayout(BasicTextLayout const&) = default;
+        BasicTextLayout& operator= (BasicTextLayout const&) = default;
+
+        void Build(const TFont& font, _In_z_ const wchar_t* text, _In_opt_ const GlyphTable* glyphTable = nullptr)
+        {
+            Build(font, text, wcslen(text), glyphTable);
+        }
+
+        // Walks 'text' as SpriteFont does: '\r' is skipped, '\n' starts a new line, and a
+        // glyph's XOffset may not move the pen left of the line start. Throws (as FindGlyph
+        // does) for a character the font lacks when it has no default character. 'glyphTable'
+        // must have been built from 'font'.
+        void Build(const TFont& font, _In_reads_(length) const wchar_t* text, size_t length,
+            _In_opt_ const GlyphTable* glyphTable = nullptr)
+        {
+            m_font = nullptr;
+            m_glyphs.clear();
+
+            const float lineSpacing = font.GetLineSpacing();
+            const auto defaultCharacter = font.GetDefaultCharacter();
+
+            // Resolved once, so a missing character costs no more than a present one.
+            Glyph const* defaultGlyph = nullptr;
+            if (glyphTable && defaultCharacter)
+            {
+                defaultGlyph = glyphTable->Find(static_cast<uint32_t>(defaultCharacter));
+            }
+
+            float x = 0;
+            float y = 0;
+            float sizeX = 0;
+            float sizeY = 0;
+            float wsSizeX = 0;
+            float wsSizeY = 0;
+
+            for (size_t j = 0; j < length; ++j)
+            {
+                const wchar_t character = text[j];
+
+                switch (character)
+                {
+                case '\r':
+                    continue;
+
+                case '\n':
+                    x = 0;
+                    y += lineSpacing;
+                    break;
+
+                default:
+                {
+                    Glyph const* glyph = glyphTable ? glyphTable->Find(static_cast<uint32_t>(character)) : nullptr;
+                    if (!glyph)
+                    {
+                        // FindGlyph falls back to the default character, or throws.
+                        glyph = defaultGlyph ? defaultGlyph : font.FindGlyph(character);
+                    }
+
+                    x += glyph->XOffset;
+
+                    if (x < 0)
+                        x = 0;
+
+                    const auto width = glyph->Subrect.right - glyph->Subrect.left;
+                    const auto height = glyph->Subrect.bottom - glyph->Subrect.top;
+
+                    GlyphPlacement placement = {};
+                    placement.glyph = glyph;
+                    placement.x = x;
+                    placement.y = y;
+                    placement.advance = float(glyph->Subrect.right) - float(glyph->Subrect.left) + glyph->XAdvance;
+                    placement.whitespace = iswspace(character) && width <= 1 && height <= 1;
+                    m_glyphs.push_back(placement);
+
+                    // MeasureString's extent, with and without the whitespace glyphs.
+                    float h = static_cast<float>(height) + glyph->YOffset;
+                    h = iswspace(wchar_t(glyph->Character)) ? lineSpacing : std::max(h, lineSpacing);
+
+                    const float right = x + static_cast<float>(width);
+                    const float bottom = y + h;
+
+                    wsSizeX = std::max(wsSizeX, right);
+                    wsSizeY = std::max(wsSizeY, bottom);
+                    if (!placement.whitespace)
+                    {
+                        sizeX = std::max(sizeX, right);
+                        sizeY = std::max(sizeY, bottom);
+                    }
+
+                    x += placement.advance;
+                    break;
+                }
+                }
+            }
+
+            m_font = &font;
+            m_lineSpacing = lineSpacing;
+            m_defaultCharacter = static_cast<uint32_t>(defaultCharacter);
+            m_size = DirectX::XMFLOAT2(sizeX, sizeY);
+            m_sizeWithWhitespace = DirectX::XMFLOAT2(wsSizeX, wsSizeY);
+        }
+
+        // False once the font's line spacing or default character differs from when the layout was built.
+        bool IsCurrent(const TFont& font) const
+        {
+            return m_font == &font
+                && m_lineSpacing == font.GetLineSpacing()
+                && m_defaultCharacter == static_cast<uint32_t>(font.GetDefaultCharacter());
+        }
+
+        const TFont* GetFont() const noexcept { return m_font; }
+        size_t GetGlyphCount() const noexcept { return m_glyphs.size(); }
+
+        // Same result as SpriteFont::MeasureString.
+        DirectX::XMVECTOR XM_CALLCONV Measure(bool ignoreWhitespace = true) const noexcept
+        {
+            return DirectX::XMLoadFloat2(ignoreWhitespace ? &m_size : &m_sizeWithWhitespace);
+        }
+
+        // Same result as SpriteFont::MeasureDrawBounds.
+        RECT MeasureDrawBounds(const DirectX::XMFLOAT2& position, bool ignoreWhitespace = true) const noexcept
+        {
+            RECT result = { LONG_MAX, LONG_MAX, 0, 0 };
+
+            const float lineSpacing = m_lineSpacing;
+            for (auto const& p : m_glyphs)
+            {
+                if (ignoreWhitespace && p.whitespace)
+                    continue;
+
+                auto const glyph = p.glyph;
+                auto const isWhitespace = iswspace(wchar_t(glyph->Character));
+                auto const w = static_cast<float>(glyph->Subrect.right - glyph->Subrect.left);
+                auto const h = isWhitespace ?
+                    lineSpacing :
+                    static_cast<float>(glyph->Subrect.bottom - glyph->Subrect.top);
+
+                const float minX = position.x + p.x;
+                const float minY = position.y + p.y + (isWhitespace ? 0.0f : glyph->YOffset);
+
+                const float maxX = std::max(minX + p.advance, minX + w);
+                const float maxY = minY + h;
+
+                if (minX < float(result.left))
+                    result.left = long(minX);
+
+                if (minY < float(result.top))
+                    result.top = long(minY);
+
+                if (float(result.right) < maxX)
+                    result.right = long(maxX);
+
+                if (float(result.bottom) < maxY)
+                    result.bottom = long(maxY);
+            }
+
+            if (result.left == LONG_MAX)
+            {
+                result.left = 0;
+                result.top = 0;
+            }
+
+            return result;
+        }
+
+        RECT MeasureDrawBounds(DirectX::FXMVECTOR position, bool ignoreWhitespace = true) const noexcept
+        {
+            DirectX::XMFLOAT2 pos;
+            DirectX::XMStoreFloat2(&pos, position);
+            return MeasureDrawBounds(pos, ignoreWhitespace);
+        }
+
+        // Same sprites as SpriteFont::DrawString, queued on any batch with SpriteBatch's Draw signature.
+        template<typename TSpriteBatch>
+        void XM_CALLCONV Draw(_In_ TSpriteBatch* spriteBatch, DirectX::FXMVECTOR position,
+            DirectX::FXMVECTOR color = DirectX::Colors::White, float rotation = 0,
+            DirectX::FXMVECTOR origin = DirectX::g_XMZero, DirectX::GXMVECTOR scale = DirectX::g_XMOne,
+            DirectX::SpriteEffects effects = DirectX::SpriteEffects_None, float layerDepth = 0) const
+        {
+            using namespace DirectX;
+
+            static_assert(SpriteEffects_FlipHorizontally == 1 &&
+                SpriteEffects_FlipVertically == 2, "If you change these enum values, the following tables must be updated to match");
+
+            // Which way to move along each axis, and which axes are mirrored, per SpriteEffects value.
+            static const XMVECTORF32 s_axisDirection[4] =
+            {
+                { { { -1, -1, 0, 0 } } },
+                { { {  1, -1, 0, 0 } } },
+                { { { -1,  1, 0, 0 } } },
+                { { {  1,  1, 0, 0 } } },
+            };
+
+            static const XMVECTORF32 s_axisIsMirrored[4] =
+            {
+                { { { 0, 0, 0, 0 } } },
+                { { { 1, 0, 0, 0 } } },
+                { { { 0, 1, 0, 0 } } },
+                { { { 1, 1, 0, 0 } } },
+            };
+
+            if (m_glyphs.empty())
+                return;
+
+            const uint32_t flip = static_cast<uint32_t>(effects) & 3;
+
+            XMVECTOR baseOffset = origin;
+            if (flip)
+            {
+                baseOffset = XMVectorNegativeMultiplySubtract(Measure(), s_axisIsMirrored[flip], baseOffset);
+            }
+
+            const auto texture = m_font->GetSpriteSheet();
+            const auto textureSize = m_font->GetSpriteSheetSize();
+
+            for (auto const& p : m_glyphs)
+            {
+                // As in DrawString, blank whitespace glyphs only advance the pen.
+                if (p.whitespace)
+                    continue;
+
+                auto const glyph = p.glyph;
+
+                XMVECTOR offset = XMVectorMultiplyAdd(XMVectorSet(p.x, p.y + glyph->YOffset, 0, 0), s_axisDirection[flip], baseOffset);
+
+                if (flip)
+                {
+                    // Mirrored glyphs are placed by their bottom and/or right edge.
+                    const XMVECTOR glyphSize = XMVectorSet(
+                        float(glyph->Subrect.right) - float(glyph->Subrect.left),
+                        float(glyph->Subrect.bottom) - float(glyph->Subrect.top), 0, 0);
+
+                    offset = XMVectorMultiplyAdd(glyphSize, s_axisIsMirrored[flip], offset);
+                }
+
+                spriteBatch->Draw(texture, textureSize, position, &glyph->Subrect, color, rotation, offset, scale, effects, layerDepth);
+            }
+        }
+
+        template<typename TSpriteBatch>
+        void XM_CALLCONV Draw(_In_ TSpriteBatch* spriteBatch, const DirectX::XMFLOAT2& position,
+            DirectX::FXMVECTOR color = DirectX::Colors::White, float rotation = 0,
+            const DirectX::XMFLOAT2& origin = DirectX::XMFLOAT2(0, 0), float scale = 1,
+            DirectX::SpriteEffects effects = DirectX::SpriteEffects_None, float layerDepth = 0) const
+        {
+            Draw(spriteBatch, DirectX::XMLoadFloat2(&position), color, rotation,
+                DirectX::XMLoadFloat2(&origin), DirectX::XMVectorReplicate(scale), effects, layerDepth);
+        }
+
+    private:
+        struct GlyphPlacement
+        {
+            Glyph const*    glyph;
+            float           x;              // pen position, as ForEachGlyph passes it
+            float           y;
+            float           advance;
+            bool            whitespace;     // skipped when measuring with ignoreWhitespace
+        };
+
+        const TFont*                    m_font;
+        float                           m_lineSpacing;
+        uint32_t                        m_defaultCharacter;
+        DirectX::XMFLOAT2               m_size;
+        DirectX::XMFLOAT2               m_sizeWithWhitespace;
+        std::vector<GlyphPlacement>     m_glyphs;
+    };
+
+    // Converts as SpriteFont does for its UTF-8 overloads.
+    inline void ConvertUTF8(_In_reads_(length) const char* text, size_t length, std::wstring& result)
+    {
+        result.clear();
+        if (!length)
+            return;
+
+        if (length > INT_MAX)
+            throw std::length_error("ConvertUTF8");
+
+        const int count = MultiByteToWideChar(CP_UTF8, 0, text, static_cast<int>(length), nullptr, 0);
+        if (count > 0)
+        {
+            result.resize(static_cast<size_t>(count));
+            if (MultiByteToWideChar(CP_UTF8, 0, text, static_cast<int>(length), &result[0], count) == count)
+                return;
+        }
+
+        throw std::system_error(std::error_code(static_cast<int>(GetLastError()), std::system_category()), "MultiByteToWideChar");
+    }
+
+    // Least-recently-used layouts keyed by font and string contents. A hit costs one hash
+    // and one compare of the string; a miss past capacity reuses the evicted entry's memory.
+    template<typename TFont>
+    class BasicTextLayoutCache
+    {
+    public:
+        using Layout = BasicTextLayout<TFont>;
+
+        static constexpr size_t DefaultCapacity = 256;
+
+        explicit BasicTextLayoutCache(size_t capacity = DefaultCapacity) :
+            m_capacity(capacity),
+            m_hits(0),
+            m_misses(0),
+            m_evictions(0)
+        {
+            if (!capacity)
+                throw std::invalid_argument("TextLayoutCache needs room for at least one layout");
+        }
+
+        BasicTextLayoutCache(BasicTextLayoutCache&&) = default;
+        BasicTextLayoutCache& operator= (BasicTextLayoutCache&&) = default;
+
+        BasicTextLayoutCache(BasicTextLayoutCache const&) = delete;
+        BasicTextLayoutCache& operator= (BasicTextLayoutCache const&) = delete;
+
+        // The layout is valid until the cache evicts it (after at least capacity - 1 other strings) or is cleared.
+        const Layout& Get(const TFont& font, _In_z_ const wchar_t* text)
+        {
+            const size_t length = wcslen(text);
+            return Find(font, false, text, length * sizeof(wchar_t), [&](Layout& layout)
+                {
+                    layout.Build(font, text, length, FindGlyphTable(font));
+                });
+        }
+
+        const Layout& Get(const TFont& font, _In_z_ const char* utf8Text)
+        {
+            const size_t length = strlen(utf8Text);
+            return Find(font, true, utf8Text, length, [&](Layout& layout)
+                {
+                    ConvertUTF8(utf8Text, length, m_utf16);
+                    layout.Build(font, m_utf16.data(), m_utf16.size(), FindGlyphTable(font));
+                });
+        }
+
+        // Layouts of 'font' built from now on use 'glyphTable' (null to stop). The table must
+        // outlive its use here; Reset forgets it.
+        void SetGlyphTable(const TFont& font, _In_opt_ const typename Layout::GlyphTable* glyphTable)
+        {
+            if (glyphTable)
+            {
+                m_glyphTables[&font] = glyphTable;
+            }
+            else
+            {
+                m_glyphTables.erase(&font);
+            }
+        }
+
+        // Drops the layouts; glyph tables stay registered.
+        void Clear() noexcept
+        {
+            m_index.clear();
+            m_entries.clear();
+        }
+
+        // Drops the layouts and the glyph tables, as when the fonts are destroyed.
+        void Reset() noexcept
+        {
+            Clear();
+            m_glyphTables.clear();
+        }
+
+        size_t GetCount() const noexcept { return m_entries.size(); }
+        size_t GetCapacity() const noexcept { return m_capacity; }
+
+        uint64_t GetHits() const noexcept { return m_hits; }
+        uint64_t GetMisses() const noexcept { return m_misses; }
+        uint64_t GetEvictions() const noexcept { return m_evictions; }
+
+    private:
+        struct Entry
+        {
+            uint64_t        hash;
+            const TFont*    font;
+            bool            utf8;
+            std::string     key;        // the string's bytes in its original encoding
+            Layout          layout;
+        };
+
+        using EntryList = std::list<Entry>;
+
+        static uint64_t Hash(const TFont* font, bool utf8, const void* data, size_t size) noexcept
+        {
+            // FNV-1a 64-bit
+            uint64_t hash = 14695981039346656037ull;
+            auto add = [&hash](const void* bytes, size_t count) noexcept
+                {
+                    auto p = static_cast<const uint8_t*>(bytes);
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        hash ^= p[j];
+                        hash *= 1099511628211ull;
+                    }
+                };
+
+            add(&font, sizeof(font));
+            add(&utf8, sizeof(utf8));
+            add(data, size);
+            return hash;
+        }
+
+        const typename Layout::GlyphTable* FindGlyphTable(const TFont& font) const
+        {
+            auto it = m_glyphTables.find(&font);
+            return (it != m_glyphTables.end()) ? it->second : nullptr;
+        }
+
+        template<typename TBuild>
+        const Layout& Find(const TFont& font, bool utf8, const void* data, size_t size, TBuild&& build)
+        {
+            const uint64_t hash = Hash(&font, utf8, data, size);
+
+            auto range = m_index.equal_range(hash);
+            for (auto it = range.first; it != range.second; ++it)
+            {
+                auto entry = it->second;
+                if (entry->font != &font || entry->utf8 != utf8 || entry->key.size() != size
+                    || memcmp(entry->key.data(), data, size) != 0)
+                    continue;
+
+                m_entries.splice(m_entries.begin(), m_entries, entry);
+
+                if (entry->layout.IsCurrent(font))
+                {
+                    ++m_hits;
+                    return entry->layout;
+                }
+
+                // The font changed since the layout was built.
+                ++m_misses;
+                try
+                {
+                    build(entry->layout);
+                }
+                catch (...)
+                {
+                    m_index.erase(it);
+                    m_entries.erase(entry);
+                    throw;
+                }
+                return entry->layout;
+            }
+
+            ++m_misses;
+
+            if (m_entries.size() >= m_capacity)
+            {
+                auto oldest = std::prev(m_entries.end());
+                auto stale = m_index.equal_range(oldest->hash);
+                for (auto it = stale.first; it != stale.second; ++it)
+                {
+                    if (it->second == oldest)
+                    {
+                        m_index.erase(it);
+                        break;
+                    }
+                }
+
+                m_entries.splice(m_entries.begin(), m_entries, oldest);
+                ++m_evictions;
+            }
+            else
+            {
+                m_entries.emplace_front();
+            }
+
+            auto entry = m_entries.begin();
+            entry->hash = hash;
+            entry->font = &font;
+            entry->utf8 = utf8;
+            entry->key.assign(static_cast<const char*>(data), size);
+
+            try
+            {
+                build(entry->layout);
+            }
+            catch (...)
+            {
+                m_entries.erase(entry);
+                throw;
+            }
+
+            m_index.emplace(hash, entry);
+            return entry->layout;
+        }
+
+        size_t                                                      m_capacity;
+        EntryList                                                   m_entries;      // most recently used first
+        std::unordered_multimap<uint64_t, typename EntryList::iterator>  m_index;
+        std::unordered_map<const TFont*, const typename Layout::GlyphTable*>   m_glyphTables;
+        std::wstring                                                m_utf16;
+        uint64_t                                                    m_hits;
+        uint64_t                                                    m_misses;
+        uint64_t                                                    m_evictions;
+    };
+
+    using TextLayout = BasicTextLayout<DirectX::SpriteFont>;
+    using TextLayoutCache = BasicTextLayoutCache<DirectX::SpriteFont>;
+}
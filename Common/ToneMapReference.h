@@ -0,0 +1,255 @@
+//--------------------------------------------------------------------------------------
+// File: ToneMapReference.h
+//
+// CPU reference implementation of DirectX Tool Kit ToneMapPostProcess
+//
+// Evaluates the same operators, transfer functions, and HDR10 color rotations as the
+// ToneMap pixel shaders with DirectXMath, one pixel per SIMD vector, so tone-mapping
+// output can be checked and timed without a GPU.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <PostProcess.h>
+
+#include <DirectXMath.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace DX
+{
+    namespace ToneMapReference
+    {
+        // Rotations for DirectX::ToneMapPostProcess::ColorPrimaryRotation, for row vectors.
+        inline DirectX::XMMATRIX XM_CALLCONV GetColorRotation(DirectX::ToneMapPostProcess::ColorPrimaryRotation value) noexcept
+        {
+            using DirectX::XMMATRIX;
+
+            switch (value)
+            {
+            case DirectX::ToneMapPostProcess::DCI_P3_D65_to_UHDTV:
+                return XMMATRIX(
+                    0.753845f, 0.0457456f, -0.00121055f, 0.f,
+                    0.198593f, 0.941777f,   0.0176041f,  0.f,
+                    0.047562f, 0.0124772f,  0.983607f,   0.f,
+                    0.f,       0.f,         0.f,         1.f);
+
+            case DirectX::ToneMapPostProcess::HDTV_to_DCI_P3_D65:
+                return XMMATRIX(
+                    0.822461969f, 0.033194199f, 0.017082631f, 0.f,
+                    0.1775380f,   0.9668058f,   0.0723974f,   0.f,
+                    0.0000000f,   0.0000000f,   0.9105199f,   0.f,
+                    0.f,          0.f,          0.f,          1.f);
+
+            case DirectX::ToneMapPostProcess::HDTV_to_UHDTV:
+            default:
+                return XMMATRIX(
+                    0.6274040f, 0.0690970f, 0.0163916f, 0.f,
+                    0.3292820f, 0.9195400f, 0.0880132f, 0.f,
+                    0.0433136f, 0.0113612f, 0.8955950f, 0.f,
+                    0.f,        0.f,        0.f,        1.f);
+            }
+        }
+
+        // Operators, applied after exposure. Alpha passes through.
+        inline DirectX::XMVECTOR XM_CALLCONV Saturate(DirectX::FXMVECTOR hdr) noexcept
+        {
+            return DirectX::XMVectorSelect(hdr, DirectX::XMVectorSaturate(hdr), DirectX::g_XMSelect1110);
+        }
+
+        inline DirectX::XMVECTOR XM_CALLCONV Reinhard(DirectX::FXMVECTOR hdr) noexcept
+        {
+            using namespace DirectX;
+            const XMVECTOR sdr = XMVectorDivide(hdr, XMVectorAdd(g_XMOne, hdr));
+            return XMVectorSelect(hdr, sdr, g_XMSelect1110);
+        }
+
+        // Narkowicz 2015, "ACES Filmic Tone Mapping Curve"
+        inline DirectX::XMVECTOR XM_CALLCONV ACESFilmic(DirectX::FXMVECTOR hdr) noexcept
+        {
+            using namespace DirectX;
+            const XMVECTOR a = XMVectorReplicate(2.51f);
+            const XMVECTOR b = XMVectorReplicate(0.03f);
+            const XMVECTOR c = XMVectorReplicate(2.43f);
+            const XMVECTOR d = XMVectorReplicate(0.59f);
+            const XMVECTOR e = XMVectorReplicate(0.14f);
+
+            const XMVECTOR numerator = XMVectorMultiply(hdr, XMVectorMultiplyAdd(a, hdr, b));
+            const XMVECTOR denominator = XMVectorMultiplyAdd(hdr, XMVectorMultiplyAdd(c, hdr, d), e);
+            return XMVectorSelect(hdr, XMVectorSaturate(XMVectorDivide(numerator, denominator)), g_XMSelect1110);
+        }
+
+        // Transfer functions.
+        inline DirectX::XMVECTOR XM_CALLCONV LinearToSRGBEst(DirectX::FXMVECTOR color) noexcept
+        {
+            using namespace DirectX;
+            const XMVECTOR srgb = XMVectorPow(XMVectorAbs(color), XMVectorReplicate(1.f / 2.2f));
+            return XMVectorSelect(color, srgb, g_XMSelect1110);
+        }
+
+        // Normalized linear (1.0 is 10,000 nits) to ST.2084 (PQ).
+        inline DirectX::XMVECTOR XM_CALLCONV LinearToST2084(DirectX::FXMVECTOR normalized) noexcept
+        {
+            using namespace DirectX;
+            const XMVECTOR m1 = XMVectorReplicate(0.1593017578f);
+            const XMVECTOR m2 = XMVectorReplicate(78.84375f);
+            const XMVECTOR c1 = XMVectorReplicate(0.8359375f);
+            const XMVECTOR c2 = XMVectorReplicate(18.8515625f);
+            const XMVECTOR c3 = XMVectorReplicate(18.6875f);
+
+            const XMVECTOR p = XMVectorPow(XMVectorAbs(normalized), m1);
+            const XMVECTOR pq = XMVectorPow(XMVectorDivide(XMVectorMultiplyAdd(c2, p, c1), XMVectorMultiplyAdd(c3, p, g_XMOne)), m2);
+            return XMVectorSelect(normalized, pq, g_XMSelect1110);
+        }
+
+        // Rec.709 linear to HDR10: rotate the primaries, scale paper white, and apply ST.2084.
+        inline DirectX::XMVECTOR XM_CALLCONV HDR10(DirectX::FXMVECTOR color, DirectX::FXMMATRIX rotation, float paperWhiteNits) noexcept
+        {
+            using namespace DirectX;
+            XMVECTOR rgb = XMVector3TransformNormal(color, rotation);
+            rgb = XMVectorScale(rgb, paperWhiteNits / 10000.f);
+            return LinearToST2084(XMVectorSelect(color, rgb, g_XMSelect1110));
+        }
+    }
+
+    // Matches a DirectX::ToneMapPostProcess of the same operator and transfer function. As with
+    // the shaders, ST2084 outputs HDR10 and ignores the operator and exposure.
+    class ToneMapReferenceProcessor
+    {
+    public:
+        using Operator = DirectX::ToneMapPostProcess::Operator;
+        using TransferFunction = DirectX::ToneMapPostProcess::TransferFunction;
+
+        ToneMapReferenceProcessor(Operator op, TransferFunction func) noexcept :
+            m_operator(op),
+            m_transferFunction(func),
+            m_linearExposure(1.f),
+            m_paperWhiteNits(200.f)
+        {
+            SetColorRotation(DirectX::ToneMapPostProcess::HDTV_to_UHDTV);
+        }
+
+        Operator GetOperator() const noexcept { return m_operator; }
+        TransferFunction GetTransferFunction() const noexcept { return m_transferFunction; }
+
+        // Same units as ToneMapPostProcess: exposure in stops, paper white in nits.
+        void SetExposure(float exposureValue) noexcept { m_linearExposure = std::exp2(exposureValue); }
+        void SetST2084Parameter(float paperWhiteNits) noexcept { m_paperWhiteNits = paperWhiteNits; }
+
+        void SetColorRotation(DirectX::ToneMapPostProcess::ColorPrimaryRotation value) noexcept
+        {
+            SetColorRotation(ToneMapReference::GetColorRotation(value));
+        }
+
+        void XM_CALLCONV SetColorRotation(DirectX::FXMMATRIX value) noexcept
+        {
+            DirectX::XMStoreFloat4x4(&m_colorRotation, value);
+        }
+
+        DirectX::XMVECTOR XM_CALLCONV Process(DirectX::FXMVECTOR hdr) const noexcept
+        {
+            using namespace DirectX;
+            const XMMATRIX rotation = XMLoadFloat4x4(&m_colorRotation);
+            const XMVECTOR exposure = XMVectorSet(m_linearExposure, m_linearExposure, m_linearExposure, 1.f);
+            return Apply(hdr, rotation, exposure);
+        }
+
+        // Tone maps 'count' pixels from 'source' to 'dest', which may be the same array.
+        void Process(_In_reads_(count) const DirectX::XMFLOAT4* source, _Out_writes_(count) DirectX::XMFLOAT4* dest, size_t count) const noexcept
+        {
+            using namespace DirectX;
+            const XMMATRIX rotation = XMLoadFloat4x4(&m_colorRotation);
+            const XMVECTOR exposure = XMVectorSet(m_linearExposure, m_linearExposure, m_linearExposure, 1.f);
+
+            // Select the operator once so the inner loop stays branch-free.
+            if (m_transferFunction == DirectX::ToneMapPostProcess::ST2084)
+            {
+                const float paperWhiteNits = m_paperWhiteNits;
+                ProcessPixels(source, dest, count, [&](FXMVECTOR hdr) { return ToneMapReference::HDR10(hdr, rotation, paperWhiteNits); });
+                return;
+            }
+
+            const bool srgb = (m_transferFunction == DirectX::ToneMapPostProcess::SRGB);
+            switch (m_operator)
+            {
+            case DirectX::ToneMapPostProcess::Saturate:
+                ProcessSDR(source, dest, count, exposure, srgb, ToneMapReference::Saturate);
+                break;
+
+            case DirectX::ToneMapPostProcess::Reinhard:
+                ProcessSDR(source, dest, count, exposure, srgb, ToneMapReference::Reinhard);
+                break;
+
+            case DirectX::ToneMapPostProcess::ACESFilmic:
+                ProcessSDR(source, dest, count, exposure, srgb, ToneMapReference::ACESFilmic);
+                break;
+
+            default:
+                if (srgb)
+                {
+                    ProcessPixels(source, dest, count, [](FXMVECTOR hdr) { return ToneMapReference::LinearToSRGBEst(hdr); });
+                }
+                else if (source != dest)
+                {
+                    ProcessPixels(source, dest, count, [](FXMVECTOR hdr) { return hdr; });
+                }
+                break;
+            }
+        }
+
+    private:
+        DirectX::XMVECTOR XM_CALLCONV Apply(DirectX::FXMVECTOR hdr, DirectX::FXMMATRIX rotation, DirectX::FXMVECTOR exposure) const noexcept
+        {
+            using namespace DirectX;
+
+            if (m_transferFunction == DirectX::ToneMapPostProcess::ST2084)
+                return ToneMapReference::HDR10(hdr, rotation, m_paperWhiteNits);
+
+            XMVECTOR sdr = hdr;
+            switch (m_operator)
+            {
+            case DirectX::ToneMapPostProcess::Saturate:     sdr = ToneMapReference::Saturate(XMVectorMultiply(hdr, exposure)); break;
+            case DirectX::ToneMapPostProcess::Reinhard:     sdr = ToneMapReference::Reinhard(XMVectorMultiply(hdr, exposure)); break;
+            case DirectX::ToneMapPostProcess::ACESFilmic:   sdr = ToneMapReference::ACESFilmic(XMVectorMultiply(hdr, exposure)); break;
+            default: break;
+            }
+
+            return (m_transferFunction == DirectX::ToneMapPostProcess::SRGB) ? ToneMapReference::LinearToSRGBEst(sdr) : sdr;
+        }
+
+        template<typename TFunc>
+        static void ProcessPixels(const DirectX::XMFLOAT4* source, DirectX::XMFLOAT4* dest, size_t count, TFunc&& func) noexcept
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                DirectX::XMStoreFloat4(&dest[j], func(DirectX::XMLoadFloat4(&source[j])));
+            }
+        }
+
+        template<typename TOperator>
+        static void XM_CALLCONV ProcessSDR(const DirectX::XMFLOAT4* source, DirectX::XMFLOAT4* dest, size_t count,
+            DirectX::FXMVECTOR exposure, bool srgb, TOperator op) noexcept
+        {
+            using namespace DirectX;
+            if (srgb)
+            {
+                ProcessPixels(source, dest, count, [&](FXMVECTOR hdr) { return ToneMapReference::LinearToSRGBEst(op(XMVectorMultiply(hdr, exposure))); });
+            }
+            else
+            {
+                ProcessPixels(source, dest, count, [&](FXMVECTOR hdr) { return op(XMVectorMultiply(hdr, exposure)); });
+            }
+        }
+
+        Operator                    m_operator;
+        TransferFunction            m_transferFunction;
+        float                       m_linearExposure;
+        float                       m_paperWhiteNits;
+        DirectX::XMFLOAT4X4         m_colorRotation;
+    };
+}
@@ -0,0 +1,391 @@
+//--------------------------------------------------------------------------------------
+// File: VertexCompression.h
+//
+// Streaming conversion of float vertex attributes to packed formats
+//
+// Attributes are converted a whole stream at a time (strided source and
+// destination, DirectXMath stream style) rather than through a per-vertex
+// constructor. Vertices are processed in cache-sized chunks so each chunk of
+// the source stays resident while every attribute of the layout is converted.
+// Half-precision attributes go through XMConvertFloatToHalfStream, which uses
+// F16C when available. Octahedral normals are encoded four vertices at a time in
+// structure-of-arrays form. The other packed formats are converted one vertex per
+// DirectXMath call, as their XMStore* packers work per element anyway.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace DX
+{
+    namespace VertexCompression
+    {
+        // Each converter reads 'count' elements from a strided float source and writes a strided
+        // packed destination. If measureError is set, the value is decoded again and the largest
+        // absolute per-component difference is returned; otherwise 0 is returned.
+
+        // float3 -> DXGI_FORMAT_R11G11B10_FLOAT. If 'biasSigned' is set, input in [-1,1] is mapped
+        // to [0,1] first (the format has no sign bit) and error is measured in the original range.
+        inline float Float3ToR11G11B10(
+            _Out_writes_bytes_(dstStride * count) void* dst, size_t dstStride,
+            _In_reads_bytes_(srcStride * count) const void* src, size_t srcStride,
+            size_t count, bool biasSigned, bool measureError = false)
+        {
+            using namespace DirectX;
+            using namespace DirectX::PackedVector;
+
+            auto out = static_cast<uint8_t*>(dst);
+            auto in = static_cast<const uint8_t*>(src);
+
+            XMVECTOR maxError = XMVectorZero();
+            for (size_t j = 0; j < count; ++j, out += dstStride, in += srcStride)
+            {
+                const XMVECTOR v = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(in));
+                const XMVECTOR packed = biasSigned ? XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf) : v;
+                XMStoreFloat3PK(reinterpret_cast<XMFLOAT3PK*>(out), packed);
+
+                if (measureError)
+                {
+                    XMVECTOR r = XMLoadFloat3PK(reinterpret_cast<const XMFLOAT3PK*>(out));
+                    if (biasSigned)
+                    {
+                        r = XMVectorMultiplyAdd(r, g_XMTwo, g_XMNegativeOne);
+                    }
+                    maxError = XMVectorMax(maxError, XMVectorAbs(XMVectorSubtract(r, v)));
+                }
+            }
+
+            return measureError
+                ? std::max(XMVectorGetX(maxError), std::max(XMVectorGetY(maxError), XMVectorGetZ(maxError)))
+                : 0.f;
+        }
+
+        // float2 -> DXGI_FORMAT_R16G16_FLOAT.
+        inline float Float2ToHalf2(
+            _Out_writes_bytes_(dstStride * count) void* dst, size_t dstStride,
+            _In_reads_bytes_(srcStride * count) const void* src, size_t srcStride,
+            size_t count, bool measureError = false)
+        {
+            using namespace DirectX::PackedVector;
+
+            auto out = static_cast<HALF*>(dst);
+            auto in = static_cast<const float*>(src);
+
+            // One pass per component; each is a contiguous-stride stream the library can vectorize.
+            XMConvertFloatToHalfStream(out, dstStride, in, srcStride, count);
+            XMConvertFloatToHalfStream(out + 1, dstStride, in + 1, srcStride, count);
+
+            if (!measureError)
+                return 0.f;
+
+            float maxError = 0.f;
+            auto outBytes = static_cast<const uint8_t*>(dst);
+            auto inBytes = static_cast<const uint8_t*>(src);
+            for (size_t j = 0; j < count; ++j, outBytes += dstStride, inBytes += srcStride)
+            {
+                auto h = reinterpret_cast<const HALF*>(outBytes);
+                auto f = reinterpret_cast<const float*>(inBytes);
+                maxError = std::max(maxError, std::fabs(XMConvertHalfToFloat(h[0]) - f[0]));
+                maxError = std::max(maxError, std::fabs(XMConvertHalfToFloat(h[1]) - f[1]));
+            }
+            return maxError;
+        }
+
+        // float4 -> DXGI_FORMAT_R8G8B8A8_UNORM.
+        inline float Float4ToUNorm8(
+            _Out_writes_bytes_(dstStride * count) void* dst, size_t dstStride,
+            _In_reads_bytes_(srcStride * count) const void* src, size_t srcStride,
+            size_t count, bool measureError = false)
+        {
+            using namespace DirectX;
+            using namespace DirectX::PackedVector;
+
+            auto out = static_cast<uint8_t*>(dst);
+            auto in = static_cast<const uint8_t*>(src);
+
+            XMVECTOR maxError = XMVectorZero();
+            for (size_t j = 0; j < count; ++j, out += dstStride, in += srcStride)
+            {
+                const XMVECTOR v = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(in));
+                XMStoreUByteN4(reinterpret_cast<XMUBYTEN4*>(out), v);
+
+                if (measureError)
+                {
+                    const XMVECTOR r = XMLoadUByteN4(reinterpret_cast<const XMUBYTEN4*>(out));
+                    maxError = XMVectorMax(maxError, XMVectorAbs(XMVectorSubtract(r, v)));
+                }
+            }
+
+            return measureError
+                ? std::max(std::max(XMVectorGetX(maxError), XMVectorGetY(maxError)), std::max(XMVectorGetZ(maxError), XMVectorGetW(maxError)))
+                : 0.f;
+        }
+
+        // float4 RGBA -> DXGI_FORMAT_B8G8R8A8_UNORM (XMCOLOR).
+        inline float Float4ToColor(
+            _Out_writes_bytes_(dstStride * count) void* dst, size_t dstStride,
+            _In_reads_bytes_(srcStride * count) const void* src, size_t srcStride,
+            size_t count, bool measureError = false)
+        {
+            using namespace DirectX;
+            using namespace DirectX::PackedVector;
+
+            auto out = static_cast<uint8_t*>(dst);
+            auto in = static_cast<const uint8_t*>(src);
+
+            XMVECTOR maxError = XMVectorZero();
+            for (size_t j = 0; j < count; ++j, out += dstStride, in += srcStride)
+            {
+                const XMVECTOR v = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(in));
+                XMStoreColor(reinterpret_cast<XMCOLOR*>(out), v);
+
+                if (measureError)
+                {
+                    const XMVECTOR r = XMLoadColor(reinterpret_cast<const XMCOLOR*>(out));
+                    maxError = XMVectorMax(maxError, XMVectorAbs(XMVectorSubtract(r, XMVectorSaturate(v))));
+                }
+            }
+
+            return measureError
+                ? std::max(std::max(XMVectorGetX(maxError), XMVectorGetY(maxError)), std::max(XMVectorGetZ(maxError), XMVectorGetW(maxError)))
+                : 0.f;
+        }
+
+        // Unit float3 -> octahedral encoding in DXGI_FORMAT_R16G16_SNORM. A zero or degenerate
+        // vector encodes as (0,0), which decodes to +Z.
+        inline DirectX::XMVECTOR XM_CALLCONV EncodeOctahedral(DirectX::FXMVECTOR n) noexcept
+        {
+            using namespace DirectX;
+
+            const XMVECTOR l1 = XMVectorSplatX(XMVector3Dot(XMVectorAbs(n), g_XMOne));
+            if (!(XMVectorGetX(l1) > FLT_EPSILON))
+                return XMVectorZero();
+
+            XMVECTOR p = XMVectorDivide(n, l1);
+
+            if (XMVectorGetZ(p) < 0.f)
+            {
+                // Fold the lower hemisphere over the diagonals.
+                const XMVECTOR yx = XMVectorSwizzle<XM_SWIZZLE_Y, XM_SWIZZLE_X, XM_SWIZZLE_Z, XM_SWIZZLE_W>(p);
+                const XMVECTOR folded = XMVectorSubtract(g_XMOne, XMVectorAbs(yx));
+                const XMVECTOR sign = XMVectorSelect(g_XMNegativeOne, g_XMOne, XMVectorGreaterOrEqual(p, XMVectorZero()));
+                p = XMVectorMultiply(folded, sign);
+            }
+
+            return p;
+        }
+
+        // As EncodeOctahedral for four vectors given as component arrays: lane j of 'x', 'y', and
+        // 'z' is vector j. Writes the encoded components of each lane to 'u' and 'v'.
+        inline void XM_CALLCONV EncodeOctahedral4(DirectX::FXMVECTOR x, DirectX::FXMVECTOR y, DirectX::FXMVECTOR z,
+            DirectX::XMVECTOR& u, DirectX::XMVECTOR& v) noexcept
+        {
+            using namespace DirectX;
+
+            const XMVECTOR zero = XMVectorZero();
+            const XMVECTOR l1 = XMVectorAdd(XMVectorAdd(XMVectorAbs(x), XMVectorAbs(y)), XMVectorAbs(z));
+            const XMVECTOR valid = XMVectorGreater(l1, XMVectorReplicate(FLT_EPSILON));
+
+            const XMVECTOR px = XMVectorDivide(x, l1);
+            const XMVECTOR py = XMVectorDivide(y, l1);
+
+            // Fold the lower hemisphere over the diagonals.
+            const XMVECTOR signX = XMVectorSelect(g_XMNegativeOne, g_XMOne, XMVectorGreaterOrEqual(px, zero));
+            const XMVECTOR signY = XMVectorSelect(g_XMNegativeOne, g_XMOne, XMVectorGreaterOrEqual(py, zero));
+            const XMVECTOR foldX = XMVectorMultiply(XMVectorSubtract(g_XMOne, XMVectorAbs(py)), signX);
+            const XMVECTOR foldY = XMVectorMultiply(XMVectorSubtract(g_XMOne, XMVectorAbs(px)), signY);
+            const XMVECTOR lower = XMVectorLess(z, zero);
+
+            u = XMVectorSelect(zero, XMVectorSelect(px, foldX, lower), valid);
+            v = XMVectorSelect(zero, XMVectorSelect(py, foldY, lower), valid);
+        }
+
+        inline DirectX::XMVECTOR XM_CALLCONV DecodeOctahedral(DirectX::FXMVECTOR e) noexcept
+        {
+            using namespace DirectX;
+
+            const float x = XMVectorGetX(e);
+            const float y = XMVectorGetY(e);
+            const float z = 1.f - std::fabs(x) - std::fabs(y);
+            const float t = std::max(-z, 0.f);
+
+            const XMVECTOR n = XMVectorSet(
+                x + ((x >= 0.f) ? -t : t),
+                y + ((y >= 0.f) ? -t : t),
+                z, 0.f);
+
+            return XMVector3Normalize(n);
+        }
+
+        inline float Float3ToOctahedral(
+            _Out_writes_bytes_(dstStride * count) void* dst, size_t dstStride,
+            _In_reads_bytes_(srcStride * count) const void* src, size_t srcStride,
+            size_t count, bool measureError = false)
+        {
+            using namespace DirectX;
+            using namespace DirectX::PackedVector;
+
+            auto out = static_cast<uint8_t*>(dst);
+            auto in = static_cast<const uint8_t*>(src);
+
+            XMVECTOR maxError = XMVectorZero();
+            auto store = [&](uint8_t* o, FXMVECTOR encoded, FXMVECTOR v)
+                {
+                    XMStoreShortN2(reinterpret_cast<XMSHORTN2*>(o), encoded);
+
+                    if (measureError)
+                    {
+                        const XMVECTOR r = DecodeOctahedral(XMLoadShortN2(reinterpret_cast<const XMSHORTN2*>(o)));
+                        maxError = XMVectorMax(maxError, XMVectorAbs(XMVectorSubtract(r, v)));
+                    }
+                };
+
+            size_t j = 0;
+            for (; j + 4 <= count; j += 4, out += 4 * dstStride, in += 4 * srcStride)
+            {
+                XMVECTOR n[4];
+                for (size_t k = 0; k < 4; ++k)
+                {
+                    n[k] = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(in + k * srcStride));
+                }
+
+                const XMMATRIX soa = XMMatrixTranspose(XMMATRIX(n[0], n[1], n[2], n[3]));
+
+                XMVECTOR u, v;
+                EncodeOctahedral4(soa.r[0], soa.r[1], soa.r[2], u, v);
+
+                // (u0 v0 u1 v1) and (u2 v2 u3 v3)
+                const XMVECTOR uv01 = XMVectorMergeXY(u, v);
+                const XMVECTOR uv23 = XMVectorMergeZW(u, v);
+
+                store(out, uv01, n[0]);
+                store(out + dstStride, XMVectorSwizzle<XM_SWIZZLE_Z, XM_SWIZZLE_W, XM_SWIZZLE_X, XM_SWIZZLE_Y>(uv01), n[1]);
+                store(out + 2 * dstStride, uv23, n[2]);
+                store(out + 3 * dstStride, XMVectorSwizzle<XM_SWIZZLE_Z, XM_SWIZZLE_W, XM_SWIZZLE_X, XM_SWIZZLE_Y>(uv23), n[3]);
+            }
+
+            for (; j < count; ++j, out += dstStride, in += srcStride)
+            {
+                const XMVECTOR v = XMLoadFloat3(reinterpret_cast<const XMFLOAT3*>(in));
+                store(out, EncodeOctahedral(v), v);
+            }
+
+            return measureError
+                ? std::max(XMVectorGetX(maxError), std::max(XMVectorGetY(maxError), XMVectorGetZ(maxError)))
+                : 0.f;
+        }
+
+        enum class Format : uint32_t
+        {
+            Copy,                   // raw bytes ('size' in the attribute)
+            Float3_R11G11B10,
+            Float3_R11G11B10_Signed, // [-1,1] biased into [0,1], e.g. normals
+            Float2_R16G16_Float,
+            Float4_R8G8B8A8_UNorm,
+            Float4_B8G8R8A8_UNorm,  // XMCOLOR
+            Float3_Octahedral_R16G16_SNorm,
+        };
+
+        struct Attribute
+        {
+            Format      format;
+            uint32_t    srcOffset;
+            uint32_t    dstOffset;
+            uint32_t    size;       // Copy only
+        };
+
+        // Vertices per chunk; sized so a chunk of a typical float vertex fits in L1/L2.
+        constexpr size_t c_ChunkSize = 1024;
+
+        // Converts 'count' vertices from one layout to another. If maxErrors is non-null, it
+        // receives the largest absolute per-component error for each attribute (0 for Copy).
+        inline void CompressVertices(
+            _In_reads_(attributeCount) const Attribute* attributes, size_t attributeCount,
+            _Out_writes_bytes_(dstStride * count) void* dst, size_t dstStride,
+            _In_reads_bytes_(srcStride * count) const void* src, size_t srcStride,
+            size_t count,
+            _Out_writes_opt_(attributeCount) float* maxErrors = nullptr)
+        {
+            if (!attributes || !dst || !src)
+            {
+                throw std::invalid_argument("CompressVertices");
+            }
+
+            const bool measure = (maxErrors != nullptr);
+            if (measure)
+            {
+                std::fill(maxErrors, maxErrors + attributeCount, 0.f);
+            }
+
+            for (size_t base = 0; base < count; base += c_ChunkSize)
+            {
+                const size_t n = std::min(c_ChunkSize, count - base);
+                auto out = static_cast<uint8_t*>(dst) + base * dstStride;
+                auto in = static_cast<const uint8_t*>(src) + base * srcStride;
+
+                for (size_t a = 0; a < attributeCount; ++a)
+                {
+                    const auto& attr = attributes[a];
+                    auto o = out + attr.dstOffset;
+                    auto i = in + attr.srcOffset;
+
+                    float error = 0.f;
+                    switch (attr.format)
+                    {
+                    case Format::Copy:
+                        for (size_t j = 0; j < n; ++j)
+                        {
+                            memcpy(o + j * dstStride, i + j * srcStride, attr.size);
+                        }
+                        break;
+
+                    case Format::Float3_R11G11B10:
+                        error = Float3ToR11G11B10(o, dstStride, i, srcStride, n, false, measure);
+                        break;
+
+                    case Format::Float3_R11G11B10_Signed:
+                        error = Float3ToR11G11B10(o, dstStride, i, srcStride, n, true, measure);
+                        break;
+
+                    case Format::Float2_R16G16_Float:
+                        error = Float2ToHalf2(o, dstStride, i, srcStride, n, measure);
+                        break;
+
+                    case Format::Float4_R8G8B8A8_UNorm:
+                        error = Float4ToUNorm8(o, dstStride, i, srcStride, n, measure);
+                        break;
+
+                    case Format::Float4_B8G8R8A8_UNorm:
+                        error = Float4ToColor(o, dstStride, i, srcStride, n, measure);
+                        break;
+
+                    case Format::Float3_Octahedral_R16G16_SNorm:
+                        error = Float3ToOctahedral(o, dstStride, i, srcStride, n, measure);
+                        break;
+
+                    default:
+                        throw std::invalid_argument("CompressVertices format");
+                    }
+
+                    if (measure)
+                    {
+                        maxErrors[a] = std::max(maxErrors[a], error);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -12,9 +12,13 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
+#include "FramePacing.h"
+
 #define GAMMA_CORRECT_RENDERING
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -107,6 +111,9 @@ namespace
 #else
     const XMVECTORF32 c_clearColor = Colors::CornflowerBlue;
 #endif
+
+    // Upload heap budget for this test's per-frame PrimitiveBatch and constant buffer traffic.
+    constexpr DX::GraphicsMemoryBudget c_uploadBudget = { 2 * 1024 * 1024, 8 * 1024 * 1024, 0 };
 }
 
 // Constructor.
@@ -134,7 +141,11 @@ Game::Game() noexcept(false)
         DX::DeviceResources::c_Enable4K_Xbox | DX::DeviceResources::c_EnableQHD_Xbox
         );
 #else
-    m_deviceResources = std::make_unique<DX::DeviceResources>(c_RenderFormat);
+    // This test reports frame pacing, so it opts in to waiting on the swap chain's latency waitable.
+    m_deviceResources = std::make_unique<DX::DeviceResources>(
+        c_RenderFormat, DXGI_FORMAT_D32_FLOAT, 2, D3D_FEATURE_LEVEL_11_0,
+        DX::DeviceResources::c_FrameLatencyWaitable
+        );
 #endif
 
 #ifdef _GAMING_XBOX
@@ -144,6 +155,16 @@ Game::Game() noexcept(false)
 #ifdef LOSTDEVICE
     m_deviceResources->RegisterDeviceNotify(this);
 #endif
+
+    m_memoryTelemetry.SetBudget(c_uploadBudget, [](const DX::GraphicsMemorySample& sample, const DX::GraphicsMemoryBudget& budget)
+        {
+            char buff[256] = {};
+            sprintf_s(buff, "WARNING: GraphicsMemory over budget on frame %llu: committed %zu KB (budget %zu KB), total %zu KB (budget %zu KB)\n",
+                static_cast<unsigned long long>(sample.frame),
+                sample.committedBytes / 1024, budget.committedBytes / 1024,
+                sample.totalBytes / 1024, budget.totalBytes / 1024);
+            OutputDebugStringA(buff);
+        });
 }
 
 Game::~Game()
@@ -151,6 +172,22 @@ Game::~Game()
     if (m_deviceResources)
     {
         m_deviceResources->WaitForGpu();
+
+#ifdef PC
+        if (m_deviceResources->GetFramePacing().GetFrameCount() > 0)
+        {
+            char buff[512] = {};
+            m_deviceResources->GetFramePacing().FormatSummary(buff, std::size(buff));
+            OutputDebugStringA(buff);
+        }
+#endif
+    }
+
+    if (m_memoryTelemetry.GetFrameCount() > 0)
+    {
+        char buff[512] = {};
+        m_memoryTelemetry.FormatSummary(buff, std::size(buff));
+        OutputDebugStringA(buff);
     }
 }
 
@@ -362,8 +399,8 @@ void Game::Render()
     m_deviceResources->Present();
     m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
 
-    // Sample stats to update peak values
-    std::ignore = m_graphicsMemory->GetStatistics();
+    // Sample stats to update peak values and the per-frame history
+    m_memoryTelemetry.Record(*m_graphicsMemory);
 
     PIXEndEvent(m_deviceResources->GetCommandQueue());
 }
@@ -460,7 +497,7 @@ void Game::CreateDeviceDependentResources()
 
     m_graphicsMemory = std::make_unique<GraphicsMemory>(device);
 
-    m_batch = std::make_unique<PrimitiveBatch<VertexPositionColor>>(device);
+    m_batch = std::make_unique<DX::BulkPrimitiveBatch<VertexPositionColor>>(device);
 
     const RenderTargetState rtState(m_deviceResources->GetBackBufferFormat(),
         m_deviceResources->GetDepthBufferFormat());
@@ -620,6 +657,156 @@ namespace
 
         return true;
     }
+
+    // Checks that the pieces of a split non-indexed draw cover every whole primitive exactly once
+    // and start on the topology's stride, which keeps strip winding intact.
+    bool TestVertexChunks(D3D_PRIMITIVE_TOPOLOGY topology, size_t vertexCount, size_t maxVertices)
+    {
+        const DX::PrimitiveSplit split = DX::GetPrimitiveSplit(topology);
+        const size_t primitiveCount = split.overlap ? vertexCount - split.overlap : vertexCount / split.stride;
+
+        std::vector<uint32_t> covered(primitiveCount);
+        bool success = true;
+
+        DX::ForEachVertexChunk(topology, vertexCount, maxVertices, [&](size_t first, size_t count)
+            {
+                if (count > maxVertices || (first % split.stride) != 0)
+                {
+                    success = false;
+                    return;
+                }
+
+                const size_t base = split.overlap ? first : first / split.stride;
+                const size_t primitives = split.overlap ? count - split.overlap : count / split.stride;
+                for (size_t j = 0; j < primitives; ++j)
+                {
+                    if (base + j >= primitiveCount)
+                    {
+                        success = false;
+                        return;
+                    }
+                    ++covered[base + j];
+                }
+            });
+
+        return success && std::all_of(covered.cbegin(), covered.cend(), [](uint32_t c) { return c == 1; });
+    }
+
+    // Splits a triangle list (coherent in its first half, random in its second) and checks each
+    // piece respects the limits and that the pieces rebuild the original triangles in order.
+    bool TestIndexedSplit(std::default_random_engine& generator, size_t indexCount, size_t vertexCount, size_t maxIndices, size_t maxVertices)
+    {
+        std::vector<uint32_t> indices(indexCount);
+        std::uniform_int_distribution<uint32_t> dist(0, static_cast<uint32_t>(vertexCount - 1));
+        for (size_t j = 0; j < indexCount; ++j)
+        {
+            indices[j] = (j < indexCount / 2) ? static_cast<uint32_t>((j / 3 + j % 3) % vertexCount) : dist(generator);
+        }
+
+        std::vector<uint32_t> rebuilt;
+        rebuilt.reserve(indexCount);
+        bool success = true;
+
+        DX::IndexedPrimitiveSplitter splitter;
+        splitter.Split(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, indices.data(), indexCount, vertexCount, maxIndices, maxVertices,
+            [&](const uint16_t* pieceIndices, size_t pieceIndexCount, const uint32_t* vertexMap, size_t pieceVertexCount)
+            {
+                if (pieceIndexCount > maxIndices || pieceVertexCount > maxVertices || (pieceIndexCount % 3) != 0)
+                {
+                    success = false;
+                }
+
+                for (size_t j = 0; j < pieceIndexCount; ++j)
+                {
+                    if (pieceIndices[j] >= pieceVertexCount)
+                    {
+                        success = false;
+                        return;
+                    }
+                    rebuilt.push_back(vertexMap[pieceIndices[j]]);
+                }
+            });
+
+        return success && rebuilt == indices;
+    }
+
+    // FramePacer backend simulating a swap chain and a queue on a microsecond clock. The GPU runs
+    // presented frames in order, 'gpuTime' each; the waitable is signaled while fewer than the
+    // maximum frame latency presented frames are unfinished.
+    class FakeFrameQueue
+    {
+    public:
+        explicit FakeFrameQueue(uint64_t gpuTime = 0) noexcept : now(0), gpuTime(gpuTime), maxFrameLatency(3), hung(false) {}
+
+        uint64_t GetTicks() const noexcept { return now; }
+        uint64_t GetTickFrequency() const noexcept { return 1000000; }
+        void SetMaximumFrameLatency(uint32_t frames) noexcept { maxFrameLatency = frames; }
+
+        bool WaitForFrameLatency(uint32_t timeoutMs) noexcept
+        {
+            if (hung)
+            {
+                now += uint64_t(timeoutMs) * 1000;
+                return false;
+            }
+
+            const size_t presented = completion.size();
+            if (presented >= maxFrameLatency)
+            {
+                now = std::max(now, completion[presented - maxFrameLatency]);
+            }
+            return true;
+        }
+
+        uint64_t GetCompletedFenceValue() const noexcept
+        {
+            return static_cast<uint64_t>(std::upper_bound(completion.cbegin(), completion.cend(), now) - completion.cbegin());
+        }
+
+        void WaitForFenceValue(uint64_t value) noexcept
+        {
+            now = std::max(now, completion[static_cast<size_t>(value - 1)]);
+        }
+
+        // Queues a frame as ExecuteCommandLists + Present + Signal, returning its fence value.
+        uint64_t Present()
+        {
+            const uint64_t start = completion.empty() ? now : std::max(now, completion.back());
+            completion.push_back(start + gpuTime);
+            return completion.size();
+        }
+
+        uint64_t                now;
+        uint64_t                gpuTime;
+        uint32_t                maxFrameLatency;
+        bool                    hung;
+        std::vector<uint64_t>   completion;     // GPU finish time of fence value N at [N - 1]
+    };
+
+    // Runs the DeviceResources Prepare / Present / MoveToNextFrame sequence against the fake queue.
+    void RunPacedFrames(DX::FramePacer<FakeFrameQueue>& pacer, size_t frames, uint64_t cpuTime, uint32_t backBufferCount)
+    {
+        auto& queue = pacer.GetBackend();
+        for (size_t j = 0; j < frames; ++j)
+        {
+            pacer.BeginFrame();
+            queue.now += cpuTime;
+
+            const uint64_t fenceValue = queue.Present();
+            pacer.EndFrame(fenceValue);
+
+            // The next back buffer was last used 'backBufferCount - 1' frames ago.
+            if (fenceValue >= backBufferCount)
+            {
+                pacer.WaitForFence(fenceValue - backBufferCount + 1);
+            }
+        }
+    }
+
+    inline bool CheckMilliseconds(double value, double expected) noexcept
+    {
+        return std::abs(value - expected) < 1e-6;
+    }
 }
 
 template<class T>
@@ -820,6 +1007,127 @@ void Game::UnitTests()
 
     auto device = m_deviceResources->GetD3DDevice();
 
+    // BulkPrimitiveBatch
+    {
+        if (!TestVertexChunks(D3D_PRIMITIVE_TOPOLOGY_POINTLIST, 10000, 4096)
+            || !TestVertexChunks(D3D_PRIMITIVE_TOPOLOGY_LINELIST, 4096, 4096)
+            || !TestVertexChunks(D3D_PRIMITIVE_TOPOLOGY_LINELIST, 10001, 4095)
+            || !TestVertexChunks(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, 20000, 4096)
+            || !TestVertexChunks(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST, 1000, 16)
+            || !TestVertexChunks(D3D_PRIMITIVE_TOPOLOGY_LINESTRIP, 10000, 4096)
+            || !TestVertexChunks(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, 10000, 4096)
+            || !TestVertexChunks(D3D_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP, 1001, 7))
+        {
+            OutputDebugStringA("ERROR: Failed BulkPrimitiveBatch vertex split tests\n");
+            success = false;
+        }
+
+        try
+        {
+            DX::ForEachVertexChunk(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ, 10000, 4096, [](size_t, size_t) {});
+
+            OutputDebugStringA("ERROR: Failed to reject splitting an adjacency list\n");
+            success = false;
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+
+        if (!TestIndexedSplit(generator, 30000, 100000, 4096 * 3, 4096)
+            || !TestIndexedSplit(generator, 300000, 70000, 4096 * 3, 4096)
+            || !TestIndexedSplit(generator, 3000, 500, 64, 16))
+        {
+            OutputDebugStringA("ERROR: Failed BulkPrimitiveBatch indexed split tests\n");
+            success = false;
+        }
+
+        // Throughput: DrawLine per line against bulk copies and in-place generation. The command
+        // list is only recorded, never executed, but each pass waits for the GPU to retire its pages.
+        if (g_benchmarks)
+        {
+            constexpr size_t c_lineCount = 50000;
+
+            auto lineVertex = [](size_t j)
+                {
+                    const float t = float(j >> 1) / float(c_lineCount);
+                    return VertexPositionColor(XMFLOAT3(t * 2.f - 1.f, (j & 1) ? 1.f : -1.f, 0.5f), XMFLOAT4(t, 1.f - t, 0.f, 1.f));
+                };
+
+            std::vector<VertexPositionColor> lines(c_lineCount * 2);
+            std::vector<uint32_t> lineIndices(c_lineCount * 2);
+            for (size_t j = 0; j < lines.size(); ++j)
+            {
+                lines[j] = lineVertex(j);
+                lineIndices[j] = static_cast<uint32_t>(j);
+            }
+
+            ComPtr<ID3D12CommandAllocator> allocator;
+            DX::ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+                IID_GRAPHICS_PPV_ARGS(allocator.GetAddressOf())));
+
+            ComPtr<ID3D12GraphicsCommandList> commandList;
+            DX::ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr,
+                IID_GRAPHICS_PPV_ARGS(commandList.GetAddressOf())));
+
+            auto timeBatch = [&](auto&& draw)
+                {
+                    m_effectLine->Apply(commandList.Get());
+
+                    DX::CpuTimer timer;
+                    timer.Start();
+                    m_batch->Begin(commandList.Get());
+                    draw();
+                    m_batch->End();
+                    timer.Stop();
+
+                    // Retire this pass's upload pages before the next one.
+                    DX::ThrowIfFailed(commandList->Close());
+                    m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+                    m_deviceResources->WaitForGpu();
+                    DX::ThrowIfFailed(allocator->Reset());
+                    DX::ThrowIfFailed(commandList->Reset(allocator.Get(), nullptr));
+
+                    return timer.GetElapsedMilliseconds();
+                };
+
+            const double perLine = timeBatch([&]
+                {
+                    for (size_t j = 0; j < lines.size(); j += 2)
+                    {
+                        m_batch->DrawLine(lines[j], lines[j + 1]);
+                    }
+                });
+
+            const double bulk = timeBatch([&]
+                {
+                    m_batch->DrawBulk(D3D_PRIMITIVE_TOPOLOGY_LINELIST, lines.data(), lines.size());
+                });
+
+            const double indexed = timeBatch([&]
+                {
+                    m_batch->DrawIndexedBulk(D3D_PRIMITIVE_TOPOLOGY_LINELIST, lineIndices.data(), lineIndices.size(), lines.data(), lines.size());
+                });
+
+            const double generated = timeBatch([&]
+                {
+                    m_batch->Generate(D3D_PRIMITIVE_TOPOLOGY_LINELIST, c_lineCount * 2, [&](VertexPositionColor* dest, size_t first, size_t count)
+                        {
+                            for (size_t j = 0; j < count; ++j)
+                            {
+                                dest[j] = lineVertex(first + j);
+                            }
+                        });
+                });
+
+            m_graphicsMemory->GarbageCollect();
+
+            char buff[256] = {};
+            sprintf_s(buff, "PrimitiveBatch %zu lines: DrawLine %.3f ms, DrawBulk %.3f ms, DrawIndexedBulk (32-bit) %.3f ms, Generate %.3f ms\n",
+                c_lineCount, perLine, bulk, indexed, generated);
+            OutputDebugStringA(buff);
+        }
+    }
+
     // CreateUploadBuffer (BufferHelpers.h)
     {
         static const VertexPositionColor s_vertexData[3] =
@@ -1078,6 +1386,338 @@ void Game::UnitTests()
         }
     }
 
+    // GraphicsMemory telemetry
+    {
+        DX::GraphicsMemoryTelemetry telemetry(8);
+
+        std::vector<uint64_t> overBudget;
+        telemetry.SetBudget({ 1000, 5000, 4 }, [&](const DX::GraphicsMemorySample& sample, const DX::GraphicsMemoryBudget&)
+            {
+                overBudget.push_back(sample.frame);
+            });
+
+        // committed, total, pages per frame; frames 3 (committed), 6 (total) and 9 (pages) break the budget.
+        static const size_t s_frames[][3] =
+        {
+            { 100, 1000, 1 }, { 200, 1000, 1 }, { 300, 2000, 2 }, { 1500, 2000, 2 },
+            { 400, 2000, 2 }, { 500, 3000, 3 }, { 600, 6000, 3 }, { 700, 3000, 3 },
+            { 800, 4000, 4 }, { 900, 4000, 5 }, { 950, 4000, 4 }, { 100, 4000, 4 },
+        };
+
+        size_t failed = 0;
+        for (auto& frame : s_frames)
+        {
+            if (!telemetry.Record(frame[0], frame[1], frame[2]))
+                ++failed;
+        }
+
+        const auto summary = telemetry.GetSummary();
+
+        // The window holds the last 8 frames (4..11), oldest first.
+        bool windowOk = telemetry.GetSampleCount() == 8 && telemetry.GetFrameCount() == std::size(s_frames);
+        for (size_t j = 0; windowOk && j < telemetry.GetSampleCount(); ++j)
+        {
+            const auto& sample = telemetry.GetSample(j);
+            windowOk = (sample.frame == j + 4) && (sample.committedBytes == s_frames[j + 4][0]) && (sample.totalPages == s_frames[j + 4][2]);
+        }
+
+        if (!windowOk
+            || summary.frames != 8
+            || summary.minCommittedBytes != 100
+            || summary.maxCommittedBytes != 950
+            || summary.avgCommittedBytes != (400 + 500 + 600 + 700 + 800 + 900 + 950 + 100) / 8
+            || summary.maxTotalBytes != 6000
+            || summary.maxTotalPages != 5
+            || summary.totalGrowthBytes != 2000)
+        {
+            OutputDebugStringA("ERROR: Failed GraphicsMemoryTelemetry history tests\n");
+            success = false;
+        }
+
+        if (failed != 3 || overBudget != std::vector<uint64_t>{ 3, 6, 9 } || summary.overBudgetFrames != 3)
+        {
+            OutputDebugStringA("ERROR: Failed GraphicsMemoryTelemetry budget tests\n");
+            success = false;
+        }
+
+        // Live sample from this device's GraphicsMemory
+        telemetry.SetBudget({}, nullptr);
+        if (!telemetry.Record(*m_graphicsMemory)
+            || telemetry.GetSample(telemetry.GetSampleCount() - 1).committedBytes > telemetry.GetSample(telemetry.GetSampleCount() - 1).totalBytes)
+        {
+            OutputDebugStringA("ERROR: Failed GraphicsMemoryTelemetry live sample\n");
+            success = false;
+        }
+    }
+
+    // Frame pacing
+    {
+        // GPU-bound: 4 ms of CPU and 10 ms of GPU per frame with 3 back buffers. Latency 1 serializes
+        // the CPU and GPU for the least latency; each extra frame of latency buys overlap until the
+        // back buffer fence becomes the limit.
+        struct PacingCase { uint32_t latency; uint64_t cpu; uint64_t gpu; double interval; double latencyWait; double fenceWait; double gpuLatency; };
+        static const PacingCase s_cases[] =
+        {
+            { 1, 4000, 10000, 14.0, 10.0, 0.0, 14.0 },
+            { 2, 4000, 10000, 10.0, 6.0, 0.0, 20.0 },
+            { 3, 4000, 10000, 10.0, 0.0, 6.0, 30.0 },
+            { 1, 10000, 4000, 14.0, 4.0, 0.0, 14.0 },
+            { 2, 10000, 4000, 10.0, 0.0, 0.0, 20.0 },
+        };
+
+        for (const auto& test : s_cases)
+        {
+            DX::FramePacer<FakeFrameQueue> pacer(FakeFrameQueue(test.gpu), test.latency, 16);
+            pacer.Reset();
+            RunPacedFrames(pacer, 40, test.cpu, 3);
+
+            const auto summary = pacer.GetSummary();
+            if (pacer.GetFrameCount() != 40
+                || summary.frames != 16
+                || pacer.GetSample(0).frame != 24
+                || summary.gpuLatencyFrames < 14
+                || !CheckMilliseconds(summary.avgPresentIntervalMs, test.interval)
+                || !CheckMilliseconds(summary.maxPresentIntervalMs, test.interval)
+                || !CheckMilliseconds(summary.avgLatencyWaitMs, test.latencyWait)
+                || !CheckMilliseconds(summary.avgFenceWaitMs, test.fenceWait)
+                || !CheckMilliseconds(summary.maxGpuLatencyMs, test.gpuLatency)
+                || summary.latencyTimeouts != 0)
+            {
+                char buff[256] = {};
+                sprintf_s(buff, "ERROR: Failed FramePacer latency %u (cpu %llu us, gpu %llu us): interval %f, waitable %f, fence %f, gpu latency %f\n",
+                    test.latency, static_cast<unsigned long long>(test.cpu), static_cast<unsigned long long>(test.gpu),
+                    summary.avgPresentIntervalMs, summary.avgLatencyWaitMs, summary.avgFenceWaitMs, summary.maxGpuLatencyMs);
+                OutputDebugStringA(buff);
+                success = false;
+            }
+        }
+
+        // Latency is clamped to what DXGI accepts, and a fence that is already complete is not waited on.
+        DX::FramePacer<FakeFrameQueue> pacer(FakeFrameQueue(1000), 0, 8);
+        auto& queue = pacer.GetBackend();
+        if (pacer.GetMaximumFrameLatency() != 1)
+        {
+            OutputDebugStringA("ERROR: Failed FramePacer latency clamp\n");
+            success = false;
+        }
+
+        pacer.SetMaximumFrameLatency(100);
+        if (pacer.GetMaximumFrameLatency() != 16 || queue.maxFrameLatency != 16)
+        {
+            OutputDebugStringA("ERROR: Failed FramePacer latency clamp\n");
+            success = false;
+        }
+
+        pacer.SetMaximumFrameLatency(2);
+        RunPacedFrames(pacer, 4, 2000, 2);
+        queue.now += 5000;
+        if (pacer.WaitForFence(queue.completion.size()) || queue.maxFrameLatency != 2)
+        {
+            OutputDebugStringA("ERROR: Failed FramePacer idle fence\n");
+            success = false;
+        }
+
+        // A waitable that never signals times out instead of hanging the frame.
+        queue.hung = true;
+        pacer.SetWaitTimeout(50);
+        const bool signaled = pacer.BeginFrame();
+        pacer.EndFrame(queue.Present());
+        const auto& timedOut = pacer.GetSample(pacer.GetSampleCount() - 1);
+        if (signaled
+            || !timedOut.latencyTimeout
+            || !CheckMilliseconds(timedOut.latencyWaitMs, 50.0)
+            || pacer.GetLatencyTimeouts() != 1)
+        {
+            OutputDebugStringA("ERROR: Failed FramePacer waitable timeout\n");
+            success = false;
+        }
+
+        // After a Reset, the first present has no interval to report.
+        queue.hung = false;
+        pacer.Reset();
+        RunPacedFrames(pacer, 2, 2000, 2);
+        if (pacer.GetSample(pacer.GetSampleCount() - 2).presentIntervalMs != 0.0
+            || pacer.GetSample(pacer.GetSampleCount() - 1).presentIntervalMs <= 0.0
+            || pacer.GetFrameCount() != 7)
+        {
+            OutputDebugStringA("ERROR: Failed FramePacer reset\n");
+            success = false;
+        }
+
+        char buff[512] = {};
+        pacer.FormatSummary(buff, std::size(buff));
+        OutputDebugStringA(buff);
+    }
+
+    // FrameRing on the null fence: the DeviceResources frame loop with no GPU and no window.
+    {
+        using Call = DX::NullFrameFence::Call;
+
+        // A GPU that never catches up on its own: every buffer reuse waits.
+        DX::FrameRing<DX::NullFrameFence> ring(3, DX::NullFrameFence(UINT32_MAX));
+        if (ring.GetState() != DX::FrameRingState::NoDevice || ring.BeginDevice() != 0 || ring.GetFenceValue(0) != 1)
+        {
+            OutputDebugStringA("ERROR: Failed FrameRing device creation\n");
+            success = false;
+        }
+
+        ring.BeginResize();
+        ring.EndResize(0);
+        ring.GetFence().ClearCalls();
+
+        // Simulated swap chain: the back buffer index advances with every present.
+        for (uint32_t frame = 0; frame < 6; ++frame)
+        {
+            ring.MoveToNextFrame((frame + 1) % 3);
+        }
+
+        // Resizing left every buffer on the same value, so the first frame waits for itself;
+        // frames 1 and 2 find their buffers unused, and from frame 3 each waits for the frame three back.
+        const std::pair<Call, uint64_t> expected[] =
+        {
+            { Call::Signal, 2 }, { Call::Wait, 2 },
+            { Call::Signal, 3 }, { Call::Signal, 4 },
+            { Call::Signal, 5 }, { Call::Wait, 3 },
+            { Call::Signal, 6 }, { Call::Wait, 4 },
+            { Call::Signal, 7 }, { Call::Wait, 5 },
+        };
+
+        auto const& calls = ring.GetFence().GetCalls();
+        bool match = calls.size() == std::size(expected);
+        for (size_t j = 0; match && j < std::size(expected); ++j)
+        {
+            match = calls[j] == expected[j];
+        }
+
+        if (!match || ring.GetFrameCount() != 6 || ring.GetFenceStalls() != 4 || ring.GetBackBufferIndex() != 0)
+        {
+            OutputDebugStringA("ERROR: Failed FrameRing frame loop\n");
+            success = false;
+        }
+
+        // Resizing drains the GPU and stops frames until the back buffers are back.
+        ring.GetFence().ClearCalls();
+        ring.BeginResize();
+        const uint64_t drained = ring.GetFenceValue(0);
+        bool threw = false;
+        try
+        {
+            ring.MoveToNextFrame(1);
+        }
+        catch (const std::logic_error&)
+        {
+            threw = true;
+        }
+
+        if (!threw
+            || ring.GetState() != DX::FrameRingState::Resizing
+            || ring.GetFence().GetCalls().size() != 2
+            || ring.GetFence().GetCompletedFenceValue() != drained - 1
+            || ring.GetFenceValue(1) != drained || ring.GetFenceValue(2) != drained)
+        {
+            OutputDebugStringA("ERROR: Failed FrameRing resize\n");
+            success = false;
+        }
+
+        ring.EndResize(2);
+        ring.GetFence().ClearCalls();
+        ring.MoveToNextFrame(0);
+        if (ring.GetState() != DX::FrameRingState::Ready || ring.GetFenceStalls() != 5 || ring.GetFence().GetCalls().size() != 2)
+        {
+            OutputDebugStringA("ERROR: Failed FrameRing after resize\n");
+            success = false;
+        }
+
+        // Device lost: nothing is signaled until the new device; fence values keep increasing.
+        const uint64_t before = ring.GetFenceValue(ring.GetBackBufferIndex());
+        ring.EndDevice();
+        threw = false;
+        try
+        {
+            ring.EndResize(0);
+        }
+        catch (const std::logic_error&)
+        {
+            threw = true;
+        }
+
+        if (!threw || ring.BeginDevice() != before)
+        {
+            OutputDebugStringA("ERROR: Failed FrameRing device lost\n");
+            success = false;
+        }
+    }
+
+    {
+        // A GPU one frame behind, double-buffered: it keeps up, so only the first frame after the resize waits.
+        DX::FrameRing<DX::NullFrameFence> ring(2, DX::NullFrameFence(1));
+        std::ignore = ring.BeginDevice();
+        ring.BeginResize();
+        ring.EndResize(0);
+        for (uint32_t frame = 0; frame < 100; ++frame)
+        {
+            ring.MoveToNextFrame((frame + 1) % 2);
+        }
+
+        if (ring.GetFenceStalls() != 1 || ring.GetFrameCount() != 100)
+        {
+            OutputDebugStringA("ERROR: Failed FrameRing latency\n");
+            success = false;
+        }
+
+        // WaitForGpu signals and waits for the current value, then moves past it.
+        ring.GetFence().ClearCalls();
+        const uint64_t value = ring.GetFenceValue(ring.GetBackBufferIndex());
+        ring.WaitForGpu();
+        auto const& calls = ring.GetFence().GetCalls();
+        if (calls.size() != 2 || calls[0].second != value || calls[1].second != value
+            || ring.GetFence().GetCompletedFenceValue() != value
+            || ring.GetFenceValue(ring.GetBackBufferIndex()) != value + 1)
+        {
+            OutputDebugStringA("ERROR: Failed FrameRing WaitForGpu\n");
+            success = false;
+        }
+    }
+
+    {
+        // PresentX rotation: no signals, and the fence value follows the index.
+        DX::FrameRing<DX::NullFrameFence> ring(3);
+        std::ignore = ring.BeginDevice();
+        ring.BeginResize();
+        ring.EndResize(0);
+        ring.GetFence().ClearCalls();
+
+        const uint32_t indices[] = { 1, 2, 0, 1 };
+        bool rotated = true;
+        for (auto index : indices)
+        {
+            ring.AdvanceUnsignaled();
+            rotated = rotated && ring.GetBackBufferIndex() == index;
+        }
+
+        if (!rotated || !ring.GetFence().GetCalls().empty() || ring.GetFenceValue(1) != ring.GetFenceValue(0))
+        {
+            OutputDebugStringA("ERROR: Failed FrameRing unsignaled rotation\n");
+            success = false;
+        }
+
+        bool threw = false;
+        try
+        {
+            DX::FrameRing<DX::NullFrameFence> empty(0);
+        }
+        catch (const std::invalid_argument&)
+        {
+            threw = true;
+        }
+
+        if (!threw)
+        {
+            OutputDebugStringA("ERROR: Failed FrameRing invalid back buffer count\n");
+            success = false;
+        }
+    }
+
     OutputDebugStringA(success ? "Passed\n" : "Failed\n");
     OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
 
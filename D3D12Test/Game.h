@@ -13,6 +13,9 @@
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
 
+#include "BulkPrimitiveBatch.h"
+#include "GraphicsMemoryTelemetry.h"
+
 constexpr uint32_t c_testTimeout = 5000;
 
 // A basic game implementation that creates a D3D12 device and
@@ -100,10 +103,11 @@ private:
 
     // DirectXTK Test Objects
     std::unique_ptr<DirectX::GraphicsMemory>                                m_graphicsMemory;
+    DX::GraphicsMemoryTelemetry                                             m_memoryTelemetry;
     std::unique_ptr<DirectX::BasicEffect>                                   m_effectPoint;
     std::unique_ptr<DirectX::BasicEffect>                                   m_effectLine;
     std::unique_ptr<DirectX::BasicEffect>                                   m_effectTri;
-    std::unique_ptr<DirectX::PrimitiveBatch<DirectX::VertexPositionColor>>  m_batch;
+    std::unique_ptr<DX::BulkPrimitiveBatch<DirectX::VertexPositionColor>>   m_batch;
     std::unique_ptr<DirectX::CommonStates>                                  m_states;
     std::unique_ptr<DirectX::DescriptorHeap>                                m_resourceDescriptors;
 
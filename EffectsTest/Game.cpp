@@ -13,12 +13,17 @@
 #include "Game.h"
 #include "Bezier.h"
 
+#ifdef PC
+#include <d3dcompiler.h>
+#endif
+
 #define GAMMA_CORRECT_RENDERING
 
 // Build for LH vs. RH coords
 //#define LH_COORDS
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -140,6 +145,42 @@ namespace
 #else
     const XMVECTORF32 c_clearColor = Colors::CornflowerBlue;
 #endif
+
+    // State combinations for the pipelines built through DX::PipelineStateCache.
+    const D3D12_BLEND_DESC* const c_pipelineBlends[] = { &CommonStates::Opaque, &CommonStates::AlphaBlend, &CommonStates::Additive, &CommonStates::NonPremultiplied };
+    const D3D12_DEPTH_STENCIL_DESC* const c_pipelineDepths[] = { &CommonStates::DepthDefault, &CommonStates::DepthNone };
+    const D3D12_RASTERIZER_DESC* const c_pipelineRasters[] = { &CommonStates::CullNone, &CommonStates::CullCounterClockwise };
+
+#ifdef PC
+    const wchar_t* c_pipelineCacheFile = L"EffectsTest.psocache";
+
+    // The effects create their pipeline state objects internally, so the cached pipelines
+    // use these minimal shaders instead.
+    const char c_cachedPipelineShaders[] =
+        "float4 VSMain(float4 position : SV_Position) : SV_Position { return position; }\n"
+        "float4 PSMain() : SV_Target0 { return float4(1, 1, 1, 1); }\n";
+
+    // Returns nullptr if d3dcompiler_47.dll is not available.
+    ComPtr<ID3DBlob> CompileCachedPipelineShader(_In_z_ const char* entryPoint, _In_z_ const char* target)
+    {
+        static const HMODULE s_compiler = LoadLibraryExW(L"d3dcompiler_47.dll", nullptr, LOAD_LIBRARY_SEARCH_SYSTEM32);
+        if (!s_compiler)
+            return nullptr;
+
+        auto compile = reinterpret_cast<pD3DCompile>(reinterpret_cast<void*>(GetProcAddress(s_compiler, "D3DCompile")));
+        if (!compile)
+            return nullptr;
+
+        ComPtr<ID3DBlob> code;
+        if (FAILED(compile(c_cachedPipelineShaders, sizeof(c_cachedPipelineShaders) - 1, "EffectsTest", nullptr, nullptr,
+            entryPoint, target, D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, code.GetAddressOf(), nullptr)))
+        {
+            return nullptr;
+        }
+
+        return code;
+    }
+#endif
 } // anonymous namespace
 
 
@@ -274,6 +315,8 @@ void Game::Initialize(
 
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -758,6 +801,394 @@ void Game::Clear()
 }
 #pragma endregion
 
+#pragma region Unit Tests
+namespace
+{
+    // Stands in for ID3D12Device so the cache bookkeeping runs without compiling anything.
+    class MockPipelineStateBackend
+    {
+    public:
+        using Pipeline = std::shared_ptr<const uint64_t>;
+        using Description = D3D12_GRAPHICS_PIPELINE_STATE_DESC;
+
+        explicit MockPipelineStateBackend(uint32_t driverVersion = 1) noexcept :
+            m_creates(0), m_blobCreates(0), m_failures(0), m_peakActive(0), m_driverVersion(driverVersion), m_active(0), m_next(0) {}
+
+        MockPipelineStateBackend(MockPipelineStateBackend&& other) noexcept :
+            m_creates(other.m_creates.load()),
+            m_blobCreates(other.m_blobCreates.load()),
+            m_failures(other.m_failures.load()),
+            m_peakActive(other.m_peakActive.load()),
+            m_driverVersion(other.m_driverVersion),
+            m_active(other.m_active.load()),
+            m_next(other.m_next.load())
+        {
+        }
+
+        Pipeline Create(const Description&, const std::vector<uint8_t>* cachedBlob, bool& blobAccepted)
+        {
+            const uint32_t active = ++m_active;
+            uint32_t peak = m_peakActive;
+            while (active > peak && !m_peakActive.compare_exchange_weak(peak, active)) {}
+
+            blobAccepted = false;
+            if (cachedBlob)
+            {
+                ++m_blobCreates;
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+                // As after a driver update, a blob stamped with another version is rejected.
+                uint32_t version = 0;
+                if (cachedBlob->size() >= sizeof(uint64_t) + sizeof(version))
+                {
+                    memcpy(&version, cachedBlob->data() + sizeof(uint64_t), sizeof(version));
+                }
+                blobAccepted = (version == m_driverVersion);
+            }
+
+            if (!blobAccepted)
+            {
+                ++m_creates;
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            }
+
+            --m_active;
+
+            // Fails the next m_failures compiles, as a driver would for a bad description.
+            uint32_t failures = m_failures;
+            while (failures > 0)
+            {
+                if (m_failures.compare_exchange_weak(failures, failures - 1))
+                    throw std::runtime_error("MockPipelineStateBackend compile failed");
+            }
+
+            return std::make_shared<const uint64_t>(++m_next);
+        }
+
+        std::vector<uint8_t> GetCachedBlob(const Pipeline& pipeline)
+        {
+            std::vector<uint8_t> blob(16);
+            memcpy(blob.data(), pipeline.get(), sizeof(uint64_t));
+            memcpy(blob.data() + sizeof(uint64_t), &m_driverVersion, sizeof(m_driverVersion));
+            return blob;
+        }
+
+        std::atomic<uint32_t> m_creates;
+        std::atomic<uint32_t> m_blobCreates;
+        std::atomic<uint32_t> m_failures;
+        std::atomic<uint32_t> m_peakActive;
+        uint32_t              m_driverVersion;
+
+    private:
+        std::atomic<uint32_t> m_active;
+        std::atomic<uint64_t> m_next;
+    };
+
+    using MockPipelineStateCache = DX::PipelineStateCache<MockPipelineStateBackend>;
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    const RenderTargetState rtState(m_deviceResources->GetBackBufferFormat(), m_deviceResources->GetDepthBufferFormat());
+
+    // Stand-in shader bytecode; only its contents matter to the hash.
+    std::vector<uint8_t> vsA(512), vsB(512), ps(768);
+    for (size_t j = 0; j < vsA.size(); ++j) { vsA[j] = static_cast<uint8_t>(j * 7); vsB[j] = static_cast<uint8_t>(j * 7); }
+    for (size_t j = 0; j < ps.size(); ++j) { ps[j] = static_cast<uint8_t>(j * 13); }
+    vsB[100] ^= 1;
+
+    const D3D12_SHADER_BYTECODE shaderVSA = { vsA.data(), vsA.size() };
+    const D3D12_SHADER_BYTECODE shaderVSB = { vsB.data(), vsB.size() };
+    const D3D12_SHADER_BYTECODE shaderPS = { ps.data(), ps.size() };
+
+    std::vector<D3D12_GRAPHICS_PIPELINE_STATE_DESC> descs;
+    for (auto blend : c_pipelineBlends)
+    {
+        for (auto depth : c_pipelineDepths)
+        {
+            for (auto raster : c_pipelineRasters)
+            {
+                const EffectPipelineStateDescription pd(&TestVertex::InputLayout, *blend, *depth, *raster, rtState);
+                descs.push_back(DX::GetPipelineStateDesc(pd, nullptr, shaderVSA, shaderPS));
+                descs.push_back(DX::GetPipelineStateDesc(pd, nullptr, shaderVSB, shaderPS));
+            }
+        }
+    }
+
+    constexpr uint64_t c_rootSignatureHash = 0x1234;
+
+    // Hashing sees through pointers and ignores CachedPSO.
+    {
+        std::vector<uint8_t> vsCopy(vsA);
+        std::vector<D3D12_INPUT_ELEMENT_DESC> layoutCopy(TestVertex::InputLayout.pInputElementDescs,
+            TestVertex::InputLayout.pInputElementDescs + TestVertex::InputLayout.NumElements);
+        std::vector<std::string> semantics;
+        semantics.reserve(layoutCopy.size());
+        for (auto& element : layoutCopy)
+        {
+            semantics.emplace_back(element.SemanticName);
+            element.SemanticName = semantics.back().c_str();
+        }
+
+        auto copy = descs[0];
+        copy.VS = { vsCopy.data(), vsCopy.size() };
+        copy.InputLayout = { layoutCopy.data(), static_cast<UINT>(layoutCopy.size()) };
+        copy.CachedPSO = { vsCopy.data(), 16 };
+
+        if (DX::HashPipelineStateDesc(copy, c_rootSignatureHash) != DX::HashPipelineStateDesc(descs[0], c_rootSignatureHash))
+        {
+            OutputDebugStringA("ERROR: HashPipelineStateDesc depends on pointers rather than contents\n");
+            success = false;
+        }
+
+        if (DX::HashPipelineStateDesc(descs[0], c_rootSignatureHash) == DX::HashPipelineStateDesc(descs[1], c_rootSignatureHash)
+            || DX::HashPipelineStateDesc(descs[0], c_rootSignatureHash) == DX::HashPipelineStateDesc(descs[0], c_rootSignatureHash + 1))
+        {
+            OutputDebugStringA("ERROR: HashPipelineStateDesc missed a shader or root signature difference\n");
+            success = false;
+        }
+
+        std::vector<uint64_t> keys;
+        for (auto const& desc : descs)
+        {
+            keys.push_back(DX::HashPipelineStateDesc(desc, c_rootSignatureHash));
+        }
+        std::sort(keys.begin(), keys.end());
+        if (std::adjacent_find(keys.begin(), keys.end()) != keys.end())
+        {
+            OutputDebugStringA("ERROR: HashPipelineStateDesc collision between distinct descriptions\n");
+            success = false;
+        }
+    }
+
+    // Several effects share each description, as in CreateDeviceDependentResources.
+    constexpr size_t c_usesPerDesc = 3;
+
+    std::stringstream blobStore;
+    {
+        MockPipelineStateCache cache{ MockPipelineStateBackend() };
+
+        std::vector<std::shared_future<MockPipelineStateBackend::Pipeline>> futures;
+        for (size_t use = 0; use < c_usesPerDesc; ++use)
+        {
+            for (auto const& desc : descs)
+            {
+                futures.push_back(cache.GetAsync(DX::HashPipelineStateDesc(desc, c_rootSignatureHash), desc));
+            }
+        }
+
+        for (size_t j = 0; j < futures.size(); ++j)
+        {
+            if (futures[j].get() != futures[j % descs.size()].get())
+            {
+                OutputDebugStringA("ERROR: PipelineStateCache returned different pipelines for one description\n");
+                success = false;
+                break;
+            }
+        }
+
+        if (cache.GetBackend().m_creates != descs.size() || cache.GetHitCount() != descs.size() * (c_usesPerDesc - 1))
+        {
+            OutputDebugStringA("ERROR: PipelineStateCache failed to deduplicate\n");
+            success = false;
+        }
+
+        char buff[256] = {};
+        sprintf_s(buff, "PipelineStateCache cold: %llu requests, %.0f%% hit rate, %.2f ms compiling, %.2f ms saved\n",
+            cache.GetRequestCount(), cache.GetHitRate() * 100.0, cache.GetCompileMilliseconds(), cache.GetTimeSavedMilliseconds());
+        OutputDebugStringA(buff);
+
+        cache.Serialize(blobStore);
+    }
+
+    // A second run starts from the serialized blobs.
+    {
+        const std::string bytes = blobStore.str();
+
+        MockPipelineStateCache cache{ MockPipelineStateBackend() };
+
+        std::istringstream stream(bytes);
+        if (!cache.Deserialize(stream) || cache.GetBlobCount() != descs.size())
+        {
+            OutputDebugStringA("ERROR: PipelineStateCache failed to reload its blob store\n");
+            success = false;
+        }
+
+        for (auto const& desc : descs)
+        {
+            std::ignore = cache.Get(DX::HashPipelineStateDesc(desc, c_rootSignatureHash), desc);
+        }
+
+        if (cache.GetBackend().m_creates != 0 || cache.GetBackend().m_blobCreates != descs.size() || cache.GetTimeSavedMilliseconds() <= 0.0)
+        {
+            OutputDebugStringA("ERROR: PipelineStateCache warm start did not use cached blobs\n");
+            success = false;
+        }
+
+        char buff[256] = {};
+        sprintf_s(buff, "PipelineStateCache warm: %llu requests, %.0f%% hit rate, %.2f ms compiling, %.2f ms saved\n",
+            cache.GetRequestCount(), cache.GetHitRate() * 100.0, cache.GetCompileMilliseconds(), cache.GetTimeSavedMilliseconds());
+        OutputDebugStringA(buff);
+
+        // A truncated file is rejected without loading anything.
+        MockPipelineStateCache other{ MockPipelineStateBackend() };
+        std::istringstream truncated(bytes.substr(0, bytes.size() / 2));
+        if (other.Deserialize(truncated) || other.GetBlobCount() != 0)
+        {
+            OutputDebugStringA("ERROR: PipelineStateCache accepted a truncated blob store\n");
+            success = false;
+        }
+    }
+
+    // After a driver update every stored blob is rejected: each request compiles, nothing is
+    // credited as a blob hit, and the rejected blobs are replaced so the next run is warm again.
+    {
+        std::stringstream updatedStore;
+        {
+            MockPipelineStateCache cache{ MockPipelineStateBackend(2) };
+
+            std::istringstream stream(blobStore.str());
+            std::ignore = cache.Deserialize(stream);
+
+            for (auto const& desc : descs)
+            {
+                std::ignore = cache.Get(DX::HashPipelineStateDesc(desc, c_rootSignatureHash), desc);
+            }
+
+            if (cache.GetBlobHitCount() != 0 || cache.GetCompileCount() != descs.size()
+                || cache.GetBackend().m_creates != descs.size() || cache.GetTimeSavedMilliseconds() != 0.0)
+            {
+                OutputDebugStringA("ERROR: PipelineStateCache counted a rejected blob as a hit\n");
+                success = false;
+            }
+
+            cache.Serialize(updatedStore);
+        }
+
+        MockPipelineStateCache cache{ MockPipelineStateBackend(2) };
+        std::ignore = cache.Deserialize(updatedStore);
+
+        for (auto const& desc : descs)
+        {
+            std::ignore = cache.Get(DX::HashPipelineStateDesc(desc, c_rootSignatureHash), desc);
+        }
+
+        if (cache.GetBlobHitCount() != descs.size() || cache.GetBackend().m_creates != 0)
+        {
+            OutputDebugStringA("ERROR: PipelineStateCache did not replace rejected blobs\n");
+            success = false;
+        }
+    }
+
+    // Misses queue for a fixed set of workers rather than each starting a thread.
+    {
+        MockPipelineStateCache cache(MockPipelineStateBackend(), 2);
+
+        for (auto const& desc : descs)
+        {
+            std::ignore = cache.GetAsync(DX::HashPipelineStateDesc(desc, c_rootSignatureHash), desc);
+        }
+        cache.WaitForPending();
+
+        if (cache.GetWorkerCount() != 2 || cache.GetBackend().m_peakActive > 2 || cache.GetBackend().m_creates != descs.size())
+        {
+            OutputDebugStringA("ERROR: PipelineStateCache exceeded its worker count\n");
+            success = false;
+        }
+    }
+
+    // A failed compile reaches the caller and is not cached, so the next request retries.
+    {
+        MockPipelineStateCache cache{ MockPipelineStateBackend() };
+        cache.GetBackend().m_failures = 1;
+
+        const uint64_t key = DX::HashPipelineStateDesc(descs[0], c_rootSignatureHash);
+
+        bool threw = false;
+        try
+        {
+            std::ignore = cache.Get(key, descs[0]);
+        }
+        catch (const std::exception&)
+        {
+            threw = true;
+        }
+
+        const size_t failedCount = cache.GetPipelineCount();
+
+        MockPipelineStateBackend::Pipeline retried;
+        try
+        {
+            retried = cache.Get(key, descs[0]);
+        }
+        catch (const std::exception&)
+        {
+        }
+
+        if (!threw || failedCount != 0 || !retried || cache.GetBackend().m_creates != 2)
+        {
+            OutputDebugStringA("ERROR: PipelineStateCache kept a failed compile\n");
+            success = false;
+        }
+    }
+
+#ifdef PC
+    // The device pipelines requested in CreateDeviceDependentResources, warm-started from disk.
+    if (m_pipelineCache)
+    {
+        for (auto& pipeline : m_cachedPipelines)
+        {
+            try
+            {
+                if (!pipeline.get())
+                {
+                    OutputDebugStringA("ERROR: PipelineStateCache returned a null device pipeline\n");
+                    success = false;
+                }
+            }
+            catch (const std::exception& e)
+            {
+                char buff[256] = {};
+                sprintf_s(buff, "ERROR: PipelineStateCache device compile failed (%s)\n", e.what());
+                OutputDebugStringA(buff);
+                success = false;
+            }
+        }
+
+        char buff[256] = {};
+        sprintf_s(buff, "PipelineStateCache device: %zu pipelines, %llu compiled, %llu from disk, %.2f ms in driver on %zu workers\n",
+            m_cachedPipelines.size(), m_pipelineCache->GetCompileCount(), m_pipelineCache->GetBlobHitCount(),
+            m_pipelineCache->GetCompileMilliseconds(), m_pipelineCache->GetWorkerCount());
+        OutputDebugStringA(buff);
+
+        // Only timing runs leave a cache file behind, so a normal run never writes to the working directory.
+        if (g_benchmarks)
+        {
+            try
+            {
+                DX::SavePipelineStateCache(*m_pipelineCache, c_pipelineCacheFile);
+            }
+            catch (const std::exception&)
+            {
+                OutputDebugStringA("WARNING: Failed to save the pipeline state cache\n");
+            }
+        }
+    }
+#endif
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
+#pragma endregion
+
 #pragma region Message Handlers
 // Message handlers
 void Game::OnSuspending()
@@ -828,6 +1259,9 @@ void Game::CreateDeviceDependentResources()
 
     m_states = std::make_unique<CommonStates>(device);
 
+    // Queued first so the driver compiles overlap with the effect creation below.
+    CreateCachedPipelines();
+
     CreateTeapot();
 
     // Create test effects
@@ -1306,6 +1740,12 @@ void Game::CreateWindowSizeDependentResources()
 #ifdef LOSTDEVICE
 void Game::OnDeviceLost()
 {
+    m_cachedPipelines.clear();
+    m_pipelineCache.reset();
+    m_cachedRootSignature.Reset();
+    m_cachedVS.Reset();
+    m_cachedPS.Reset();
+
     m_abstractEffect.reset();
 
     m_basicEffectUnlit.reset();
@@ -1377,6 +1817,54 @@ void Game::OnDeviceRestored()
 #endif
 #pragma endregion
 
+// Requests one pipeline per state combination from the cache, seeded with the blobs saved
+// by the previous run. UnitTests waits for them and saves the updated blob store.
+void Game::CreateCachedPipelines()
+{
+#ifdef PC
+    auto device = m_deviceResources->GetD3DDevice();
+
+    m_cachedVS = CompileCachedPipelineShader("VSMain", "vs_5_0");
+    m_cachedPS = CompileCachedPipelineShader("PSMain", "ps_5_0");
+    if (!m_cachedVS || !m_cachedPS)
+    {
+        OutputDebugStringA("WARNING: D3DCompile is not available; skipping cached pipelines\n");
+        return;
+    }
+
+    ComPtr<ID3DBlob> signature;
+    const CD3DX12_ROOT_SIGNATURE_DESC rsigDesc(0, nullptr, 0, nullptr, D3D12_ROOT_SIGNATURE_FLAG_ALLOW_INPUT_ASSEMBLER_INPUT_LAYOUT);
+    DX::ThrowIfFailed(D3D12SerializeRootSignature(&rsigDesc, D3D_ROOT_SIGNATURE_VERSION_1, signature.GetAddressOf(), nullptr));
+    DX::ThrowIfFailed(
+        device->CreateRootSignature(0, signature->GetBufferPointer(), signature->GetBufferSize(),
+            IID_GRAPHICS_PPV_ARGS(m_cachedRootSignature.ReleaseAndGetAddressOf())));
+
+    DX::PipelineStateHasher rootSignatureHash;
+    rootSignatureHash.AddBytes(signature->GetBufferPointer(), signature->GetBufferSize());
+
+    m_pipelineCache = std::make_unique<DX::D3D12PipelineStateCache>(DX::D3D12PipelineStateBackend(device));
+    std::ignore = DX::LoadPipelineStateCache(*m_pipelineCache, c_pipelineCacheFile);
+
+    const RenderTargetState rtState(m_deviceResources->GetBackBufferFormat(), m_deviceResources->GetDepthBufferFormat());
+    const D3D12_SHADER_BYTECODE vertexShader = { m_cachedVS->GetBufferPointer(), m_cachedVS->GetBufferSize() };
+    const D3D12_SHADER_BYTECODE pixelShader = { m_cachedPS->GetBufferPointer(), m_cachedPS->GetBufferSize() };
+
+    m_cachedPipelines.clear();
+    for (auto blend : c_pipelineBlends)
+    {
+        for (auto depth : c_pipelineDepths)
+        {
+            for (auto raster : c_pipelineRasters)
+            {
+                const EffectPipelineStateDescription pd(&TestVertex::InputLayout, *blend, *depth, *raster, rtState);
+                const auto desc = DX::GetPipelineStateDesc(pd, m_cachedRootSignature.Get(), vertexShader, pixelShader);
+                m_cachedPipelines.push_back(m_pipelineCache->GetAsync(DX::HashPipelineStateDesc(desc, rootSignatureHash.Get()), desc));
+            }
+        }
+    }
+#endif
+}
+
 // Creates a teapot primitive with test input layout.
 void Game::CreateTeapot()
 {
@@ -13,6 +13,8 @@
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
 
+#include "PipelineStateCacheD3D12.h"
+
 constexpr uint32_t c_testTimeout = 15000;
 
 // A basic game implementation that creates a D3D12 device and
@@ -87,6 +89,9 @@ private:
     void CreateWindowSizeDependentResources();
 
     void CreateTeapot();
+    void CreateCachedPipelines();
+
+    void UnitTests();
 
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
@@ -164,6 +169,13 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_brickNormal;
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_brickSpecular;
 
+    // Pipelines built through the persistent pipeline state cache (PC only).
+    Microsoft::WRL::ComPtr<ID3D12RootSignature>     m_cachedRootSignature;
+    Microsoft::WRL::ComPtr<ID3DBlob>                m_cachedVS;
+    Microsoft::WRL::ComPtr<ID3DBlob>                m_cachedPS;
+    std::unique_ptr<DX::D3D12PipelineStateCache>    m_pipelineCache;    // destroyed before the shaders it compiles
+    std::vector<std::shared_future<DX::D3D12PipelineStateBackend::Pipeline>> m_cachedPipelines;
+
     enum Descriptors
     {
         Cat,
@@ -94,11 +94,14 @@
 #include <exception>
 #include <iterator>
 #include <memory>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 
 #include "CommonStates.h"
 #include "DDSTextureLoader.h"
@@ -12,6 +12,7 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
 #include "FindMedia.h"
 
 #define GAMMA_CORRECT_RENDERING
@@ -25,6 +26,7 @@
 #endif
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 
@@ -48,6 +50,7 @@ namespace
 // Constructor.
 Game::Game() noexcept(false) :
     m_state{},
+    m_captureInput(false),
     m_lastStr(nullptr)
 {
 #ifdef GAMMA_CORRECT_RENDERING
@@ -187,6 +190,8 @@ void Game::Initialize(
 
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -234,108 +239,122 @@ void Game::Update(DX::StepTimer const&)
 
 #endif
 
+    DX::InputFrame frame = {};
+
     for (int j = 0; j < GamePad::MAX_PLAYER_COUNT; ++j)
     {
-        auto state2 = m_gamePad->GetState(j);
-        auto caps = m_gamePad->GetCapabilities(j);
+        frame.gamePads[j] = m_gamePad->GetState(j);
+    }
+
+    if (m_captureInput)
+        m_recorder.Record(frame);
+
+    // Capabilities are only queried when a slot's connection state changes.
+    m_inputEvents.BeginFrame();
+    for (size_t j = 0; j < DX::InputStream::c_MaxPlayers; ++j)
+    {
+        m_inputEvents.UpdateGamePad(j, frame.gamePads[j]);
+    }
 
-        assert(state2.IsConnected() == caps.IsConnected());
+    for (const auto& evt : m_inputEvents.GetEvents())
+    {
+        const int j = static_cast<int>(evt.player);
 
-        if (state2.IsConnected())
+        if (evt.type == DX::InputEvent::GamePadConnected)
         {
-            if (!m_found[size_t(j)])
+            m_found[size_t(j)] = true;
+
+            auto caps = m_gamePad->GetCapabilities(j);
+
+            assert(caps.IsConnected());
+
+            if (caps.IsConnected())
             {
-                m_found[size_t(j)] = true;
+#ifdef USING_GAMEINPUT
+                char idstr[128] = {};
+                for (size_t l = 0; l < APP_LOCAL_DEVICE_ID_SIZE; ++l)
+                {
+                    sprintf_s(idstr + l * 2, 128 - l * 2, "%02x", caps.id.value[l]);
+                }
+                char buff[128] = {};
+                sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id %s)\n", j, caps.gamepadType, caps.vid, caps.pid, idstr);
+                OutputDebugStringA(buff);
 
-                if (caps.IsConnected())
                 {
-#ifdef USING_GAMEINPUT
-                    char idstr[128] = {};
-                    for (size_t l = 0; l < APP_LOCAL_DEVICE_ID_SIZE; ++l)
+                    ComPtr<IGameInputDevice> idevice;
+                    m_gamePad->GetDevice(j, idevice.GetAddressOf());
+
+                    if (!idevice)
                     {
-                        sprintf_s(idstr + l * 2, 128 - l * 2, "%02x", caps.id.value[l]);
+                        OutputDebugStringA("             **ERROR** GetDevice failed unexpectedly\n");
                     }
-                    char buff[128] = {};
-                    sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id %s)\n", j, caps.gamepadType, caps.vid, caps.pid, idstr);
-                    OutputDebugStringA(buff);
-
+                    else
                     {
-                        ComPtr<IGameInputDevice> idevice;
-                        m_gamePad->GetDevice(j, idevice.GetAddressOf());
-
-                        if (!idevice)
+                        GameInputBatteryState battery;
+                        idevice->GetBatteryState(&battery);
+                        switch (battery.status)
                         {
-                            OutputDebugStringA("             **ERROR** GetDevice failed unexpectedly\n");
-                        }
-                        else
-                        {
-                            GameInputBatteryState battery;
-                            idevice->GetBatteryState(&battery);
-                            switch (battery.status)
-                            {
-                            case GameInputBatteryUnknown:       break;
-                            case GameInputBatteryNotPresent:    OutputDebugStringA("             Battery not present\n"); break;
-                            case GameInputBatteryDischarging:   OutputDebugStringA("             Battery discharging\n"); break;
-                            case GameInputBatteryIdle:          OutputDebugStringA("             Battery idle\n"); break;
-                            case GameInputBatteryCharging:      OutputDebugStringA("             Battery charging\n"); break;
-                            }
+                        case GameInputBatteryUnknown:       break;
+                        case GameInputBatteryNotPresent:    OutputDebugStringA("             Battery not present\n"); break;
+                        case GameInputBatteryDischarging:   OutputDebugStringA("             Battery discharging\n"); break;
+                        case GameInputBatteryIdle:          OutputDebugStringA("             Battery idle\n"); break;
+                        case GameInputBatteryCharging:      OutputDebugStringA("             Battery charging\n"); break;
                         }
                     }
+                }
 #elif defined(USING_WINDOWS_GAMING_INPUT)
-                    if (!caps.id.empty())
+                if (!caps.id.empty())
+                {
+                    using namespace Microsoft::WRL;
+                    using namespace Microsoft::WRL::Wrappers;
+                    using namespace ABI::Windows::Foundation;
+                    using namespace ABI::Windows::System;
+
+                    ComPtr<IUserStatics> statics;
+                    DX::ThrowIfFailed(GetActivationFactory(HStringReference(RuntimeClass_Windows_System_User).Get(), statics.GetAddressOf()));
+
+                    ComPtr<IUser> user;
+                    HString str;
+                    str.Set(caps.id.c_str(), static_cast<unsigned int>(caps.id.length()));
+                    HRESULT hr = statics->GetFromId(str.Get(), user.GetAddressOf());
+                    if (SUCCEEDED(hr))
                     {
-                        using namespace Microsoft::WRL;
-                        using namespace Microsoft::WRL::Wrappers;
-                        using namespace ABI::Windows::Foundation;
-                        using namespace ABI::Windows::System;
-
-                        ComPtr<IUserStatics> statics;
-                        DX::ThrowIfFailed(GetActivationFactory(HStringReference(RuntimeClass_Windows_System_User).Get(), statics.GetAddressOf()));
-
-                        ComPtr<IUser> user;
-                        HString str;
-                        str.Set(caps.id.c_str(), static_cast<unsigned int>(caps.id.length()));
-                        HRESULT hr = statics->GetFromId(str.Get(), user.GetAddressOf());
-                        if (SUCCEEDED(hr))
-                        {
-                            UserType userType = UserType_RemoteUser;
-                            DX::ThrowIfFailed(user->get_Type(&userType));
+                        UserType userType = UserType_RemoteUser;
+                        DX::ThrowIfFailed(user->get_Type(&userType));
 
-                            char buff[1024] = {};
-                            sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id \"%ls\" (user found))\n", j, caps.gamepadType, caps.vid, caps.pid, caps.id.c_str());
-                            OutputDebugStringA(buff);
-                        }
-                        else
-                        {
-                            char buff[1024] = {};
-                            sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id \"%ls\" (user fail %08X))\n", j, caps.gamepadType, caps.vid, caps.pid, caps.id.c_str(), static_cast<unsigned int>(hr));
-                            OutputDebugStringA(buff);
-                        }
+                        char buff[1024] = {};
+                        sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id \"%ls\" (user found))\n", j, caps.gamepadType, caps.vid, caps.pid, caps.id.c_str());
+                        OutputDebugStringA(buff);
                     }
                     else
                     {
-                        char buff[64] = {};
-                        sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id is empty!)\n", j, caps.gamepadType, caps.vid, caps.pid);
+                        char buff[1024] = {};
+                        sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id \"%ls\" (user fail %08X))\n", j, caps.gamepadType, caps.vid, caps.pid, caps.id.c_str(), static_cast<unsigned int>(hr));
                         OutputDebugStringA(buff);
                     }
-#else
+                }
+                else
+                {
                     char buff[64] = {};
-                    sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id %llu)\n", j, caps.gamepadType, caps.vid, caps.pid, caps.id);
+                    sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id is empty!)\n", j, caps.gamepadType, caps.vid, caps.pid);
                     OutputDebugStringA(buff);
-#endif
                 }
+#else
+                char buff[64] = {};
+                sprintf_s(buff, "Player %d -> connected (type %u, %04X/%04X, id %llu)\n", j, caps.gamepadType, caps.vid, caps.pid, caps.id);
+                OutputDebugStringA(buff);
+#endif
             }
         }
-        else
+        else if (evt.type == DX::InputEvent::GamePadDisconnected)
         {
-            if (m_found[size_t(j)])
-            {
-                m_found[size_t(j)] = false;
+            m_found[size_t(j)] = false;
 
-                char buff[32];
-                sprintf_s(buff, "Player %d <- disconnected\n", j);
-                OutputDebugStringA(buff);
-            }
+            assert(!m_gamePad->GetCapabilities(j).IsConnected());
+
+            char buff[32];
+            sprintf_s(buff, "Player %d <- disconnected\n", j);
+            OutputDebugStringA(buff);
         }
     }
 
@@ -447,6 +466,10 @@ void Game::Update(DX::StepTimer const&)
         assert(m_tracker.back == m_tracker.view);
         assert(m_tracker.start == m_tracker.menu);
 
+        // Hold VIEW and press MENU to start or stop capturing input.
+        if (m_state.IsViewPressed() && m_tracker.menu == ButtonState::PRESSED)
+            ToggleInputCapture();
+
         m_gamePad->SetVibration(GamePad::c_MostRecent, m_state.triggers.left, m_state.triggers.right);
     }
     else
@@ -459,6 +482,22 @@ void Game::Update(DX::StepTimer const&)
 
     PIXEndEvent();
 }
+
+// Live input is only recorded between two toggles; stopping writes the capture out.
+void Game::ToggleInputCapture()
+{
+    m_captureInput = !m_captureInput;
+
+    if (m_captureInput)
+    {
+        m_recorder.Clear();
+        OutputDebugStringA("INFO: Input capture started\n");
+    }
+    else
+    {
+        DX::SaveCapture(m_recorder, L"GamePadTest.dxir");
+    }
+}
 #pragma endregion
 
 #pragma region Frame Render
@@ -631,6 +670,390 @@ void Game::Clear()
 }
 #pragma endregion
 
+#pragma region Unit Tests
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    using ButtonState = GamePad::ButtonStateTracker::ButtonState;
+
+    // Synthesize a reproducible stream (fixed seed) for every player slot with button toggles and stick motion.
+    // Timing runs replay a longer stream.
+    const size_t frameCount = g_benchmarks ? 20000 : 2000;
+    constexpr size_t c_buttons = 14;
+
+    std::mt19937 generator(0x50414453);
+    std::uniform_int_distribution<int> buttonDist(0, int(c_buttons) * 4 - 1);
+    std::uniform_real_distribution<float> axisDist(-1.f, 1.f);
+    std::uniform_int_distribution<int> moveDist(0, 3);
+
+    std::vector<DX::InputFrame> reference;
+    reference.reserve(frameCount);
+
+    DX::InputRecorder recorder;
+    DX::InputFrame frame = {};
+    size_t expectedPressed = 0;
+    size_t expectedReleased = 0;
+    for (size_t j = 0; j < frameCount; ++j)
+    {
+        for (size_t p = 0; p < DX::InputStream::c_MaxPlayers; ++p)
+        {
+            auto& pad = frame.gamePads[p];
+            pad.connected = true;
+
+            bool* const buttons[c_buttons] =
+            {
+                &pad.buttons.a, &pad.buttons.b, &pad.buttons.x, &pad.buttons.y,
+                &pad.buttons.leftStick, &pad.buttons.rightStick,
+                &pad.buttons.leftShoulder, &pad.buttons.rightShoulder,
+                &pad.buttons.back, &pad.buttons.start,
+                &pad.dpad.up, &pad.dpad.down, &pad.dpad.right, &pad.dpad.left,
+            };
+
+            bool changed = false;
+
+            const int toggle = buttonDist(generator);
+            if (toggle < int(c_buttons))
+            {
+                *buttons[toggle] = !*buttons[toggle];
+                changed = true;
+                if (j > 0)
+                {
+                    if (*buttons[toggle])
+                        ++expectedPressed;
+                    else
+                        ++expectedReleased;
+                }
+            }
+
+            if (!moveDist(generator))
+            {
+                pad.thumbSticks.leftX = axisDist(generator);
+                pad.thumbSticks.leftY = axisDist(generator);
+                pad.triggers.right = std::abs(axisDist(generator));
+                changed = true;
+            }
+
+            if (changed)
+            {
+                ++pad.packet;
+            }
+        }
+
+        recorder.Record(frame);
+        reference.push_back(frame);
+    }
+
+    // Round-trip
+    {
+        DX::InputReplayer replayer(recorder.GetStream());
+
+        size_t count = 0;
+        while (replayer.Next(frame) && success)
+        {
+            if (count >= reference.size())
+            {
+                success = false;
+                break;
+            }
+
+            for (size_t p = 0; p < DX::InputStream::c_MaxPlayers; ++p)
+            {
+                uint8_t expected[DX::InputStream::c_GamePadSize] = {};
+                uint8_t actual[DX::InputStream::c_GamePadSize] = {};
+                DX::InputStream::PackGamePad(reference[count].gamePads[p], expected);
+                DX::InputStream::PackGamePad(frame.gamePads[p], actual);
+                if (memcmp(expected, actual, sizeof(expected)) != 0)
+                {
+                    success = false;
+                    break;
+                }
+            }
+            ++count;
+        }
+
+        if (!success || count != frameCount)
+        {
+            OutputDebugStringA("ERROR: Failed InputReplayer round-trip test\n");
+            success = false;
+        }
+    }
+
+    // Tracker throughput from the replayed stream
+    {
+        DX::InputReplayer replayer(recorder.GetStream());
+        GamePad::ButtonStateTracker trackers[DX::InputStream::c_MaxPlayers];
+
+        size_t pressed = 0;
+        size_t released = 0;
+        bool first = true;
+
+        DX::CpuTimer timer;
+        timer.Start();
+        while (replayer.Next(frame))
+        {
+            for (size_t p = 0; p < DX::InputStream::c_MaxPlayers; ++p)
+            {
+                auto& tracker = trackers[p];
+                tracker.Update(frame.gamePads[p]);
+                if (first)
+                    continue;
+
+                const ButtonState states[c_buttons] =
+                {
+                    tracker.a, tracker.b, tracker.x, tracker.y,
+                    tracker.leftStick, tracker.rightStick,
+                    tracker.leftShoulder, tracker.rightShoulder,
+                    tracker.back, tracker.start,
+                    tracker.dpadUp, tracker.dpadDown, tracker.dpadRight, tracker.dpadLeft,
+                };
+
+                for (auto it : states)
+                {
+                    if (it == ButtonState::PRESSED)
+                        ++pressed;
+                    else if (it == ButtonState::RELEASED)
+                        ++released;
+                }
+            }
+
+            first = false;
+        }
+        timer.Stop();
+
+        if (pressed != expectedPressed || released != expectedReleased)
+        {
+            OutputDebugStringA("ERROR: Failed GamePad::ButtonStateTracker replay test\n");
+            success = false;
+        }
+
+        if (g_benchmarks)
+        {
+            char buff[256] = {};
+            sprintf_s(buff, "INFO: Replayed %zu frames x %zu players (%zu bytes, %.2f bytes/frame) in %.3f ms: %.2f Mframes/s, %.1f ns/frame\n",
+                frameCount, DX::InputStream::c_MaxPlayers, recorder.GetStream().size(),
+                double(recorder.GetStream().size()) / double(frameCount),
+                timer.GetElapsedMilliseconds(),
+                timer.GetRate(frameCount) / 1000000.0,
+                timer.GetElapsedSeconds() * 1e9 / double(frameCount));
+            OutputDebugStringA(buff);
+        }
+    }
+
+    // Event queue vs. full-state polling over many simulated controllers
+    {
+        // Each simulated controller replays one recorded player slot from its own offset, advancing
+        // only every few frames so that most controllers are idle on any given frame.
+        constexpr size_t c_controllers = 1024;
+        // Timing runs simulate more frames.
+        const size_t simFrames = g_benchmarks ? 2000 : 100;
+
+        auto replayState = [&](size_t controller, size_t simFrame) -> const GamePad::State&
+            {
+                const size_t rate = 1 + (controller % 8);
+                const size_t index = (controller * 7919 + simFrame / rate) % reference.size();
+                return reference[index].gamePads[controller % DX::InputStream::c_MaxPlayers];
+            };
+
+        size_t pollPressed = 0;
+        size_t pollReleased = 0;
+        DX::CpuTimer pollTimer;
+        {
+            std::vector<GamePad::ButtonStateTracker> trackers(c_controllers);
+
+            pollTimer.Start();
+            for (size_t f = 0; f < simFrames; ++f)
+            {
+                for (size_t c = 0; c < c_controllers; ++c)
+                {
+                    auto& tracker = trackers[c];
+                    tracker.Update(replayState(c, f));
+
+                    const ButtonState states[c_buttons] =
+                    {
+                        tracker.a, tracker.b, tracker.x, tracker.y,
+                        tracker.leftStick, tracker.rightStick,
+                        tracker.leftShoulder, tracker.rightShoulder,
+                        tracker.back, tracker.start,
+                        tracker.dpadUp, tracker.dpadDown, tracker.dpadRight, tracker.dpadLeft,
+                    };
+
+                    for (auto it : states)
+                    {
+                        if (it == ButtonState::PRESSED)
+                            ++pollPressed;
+                        else if (it == ButtonState::RELEASED)
+                            ++pollReleased;
+                    }
+                }
+            }
+            pollTimer.Stop();
+        }
+
+        size_t eventPressed = 0;
+        size_t eventReleased = 0;
+        size_t totalEvents = 0;
+        size_t connects = 0;
+        DX::CpuTimer eventTimer;
+        {
+            DX::InputEventQueue queue;
+
+            eventTimer.Start();
+            for (size_t f = 0; f < simFrames; ++f)
+            {
+                queue.BeginFrame();
+                for (size_t c = 0; c < c_controllers; ++c)
+                {
+                    queue.UpdateGamePad(c, replayState(c, f));
+                }
+
+                for (const auto& evt : queue.GetEvents())
+                {
+                    switch (evt.type)
+                    {
+                    case DX::InputEvent::GamePadButtonPressed: ++eventPressed; break;
+                    case DX::InputEvent::GamePadButtonReleased: ++eventReleased; break;
+                    case DX::InputEvent::GamePadConnected: ++connects; break;
+                    default: break;
+                    }
+                }
+
+                totalEvents += queue.GetEvents().size();
+            }
+            eventTimer.Stop();
+        }
+
+        // The first poll reports any held buttons as pressed; the queue reports them as pressed after connecting.
+        if (eventPressed != pollPressed || eventReleased != pollReleased || connects != c_controllers)
+        {
+            OutputDebugStringA("ERROR: Failed InputEventQueue vs. ButtonStateTracker test\n");
+            success = false;
+        }
+
+        if (g_benchmarks)
+        {
+            char buff[256] = {};
+            sprintf_s(buff, "INFO: %zu controllers x %zu frames: polling %.3f ms (%.1f us/frame); events %.3f ms (%.1f us/frame, %.1f events/frame)\n",
+                c_controllers, simFrames,
+                pollTimer.GetElapsedMilliseconds(),
+                pollTimer.GetElapsedSeconds() * 1e6 / double(simFrames),
+                eventTimer.GetElapsedMilliseconds(),
+                eventTimer.GetElapsedSeconds() * 1e6 / double(simFrames),
+                double(totalEvents) / double(simFrames));
+            OutputDebugStringA(buff);
+        }
+    }
+
+    // Event queue axis dead zone, return to rest, and disconnect
+    {
+        DX::InputEventQueue queue(0.1f);
+
+        GamePad::State state = {};
+        state.connected = true;
+        state.packet = 1;
+        state.thumbSticks.leftX = 0.05f;
+
+        struct Step
+        {
+            float   leftX;
+            size_t  axisEvents;
+            float   delta;
+        };
+
+        // Movement is measured from the last reported position, so slow drift stays quiet, but
+        // returning to rest is reported even when the step is inside the dead zone.
+        const Step steps[] =
+        {
+            { 0.2f, 1, 0.2f },
+            { 0.25f, 0, 0.f },
+            { 0.05f, 1, -0.15f },
+            { 0.f, 1, -0.05f },
+        };
+
+        bool matched = true;
+
+        queue.BeginFrame();
+        queue.UpdateGamePad(0, state);
+        if (queue.GetEvents().size() != 1 || queue.GetEvents()[0].type != DX::InputEvent::GamePadConnected)
+        {
+            matched = false;
+        }
+
+        for (const auto& step : steps)
+        {
+            ++state.packet;
+            state.thumbSticks.leftX = step.leftX;
+
+            queue.BeginFrame();
+            queue.UpdateGamePad(0, state);
+
+            size_t axisEvents = 0;
+            for (const auto& evt : queue.GetEvents())
+            {
+                if (evt.type != DX::InputEvent::GamePadAxisMoved
+                    || evt.code != DX::InputEvent::AxisLeftX
+                    || evt.value != step.leftX
+                    || std::abs(evt.delta - step.delta) > 1e-6f)
+                {
+                    matched = false;
+                }
+                ++axisEvents;
+            }
+
+            if (axisEvents != step.axisEvents)
+            {
+                matched = false;
+            }
+        }
+
+        // A value that never left the dead zone is not reported on its way back to rest.
+        ++state.packet;
+        state.triggers.left = 0.05f;
+        queue.BeginFrame();
+        queue.UpdateGamePad(0, state);
+        ++state.packet;
+        state.triggers.left = 0.f;
+        queue.BeginFrame();
+        queue.UpdateGamePad(0, state);
+        if (!queue.GetEvents().empty())
+        {
+            matched = false;
+        }
+
+        // An unchanged packet is skipped even if the caller passes the same state again.
+        queue.BeginFrame();
+        queue.UpdateGamePad(0, state);
+        if (!queue.GetEvents().empty())
+        {
+            matched = false;
+        }
+
+        state.connected = false;
+        queue.BeginFrame();
+        queue.UpdateGamePad(0, state);
+        if (queue.GetEvents().size() != 1 || queue.GetEvents()[0].type != DX::InputEvent::GamePadDisconnected)
+        {
+            matched = false;
+        }
+
+        if (!matched)
+        {
+            OutputDebugStringA("ERROR: Failed InputEventQueue axis test\n");
+            success = false;
+        }
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
+#pragma endregion
+
 #pragma region Message Handlers
 // Message handlers
 void Game::OnActivated()
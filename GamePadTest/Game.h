@@ -11,6 +11,8 @@
 #pragma once
 
 #include "DirectXTKTest.h"
+#include "InputEvents.h"
+#include "InputRecorder.h"
 #include "StepTimer.h"
 
 constexpr uint32_t c_testTimeout = 5000;
@@ -86,6 +88,9 @@ private:
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
+    void UnitTests();
+    void ToggleInputCapture();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
 
@@ -103,6 +108,9 @@ private:
     DirectX::GamePad::ButtonStateTracker            m_tracker;
     DirectX::GamePad::State                         m_state;
     std::unique_ptr<bool[]>                         m_found;
+    DX::InputRecorder                               m_recorder;
+    bool                                            m_captureInput;
+    DX::InputEventQueue                             m_inputEvents;
 
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_defaultTex;
 
@@ -12,6 +12,11 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
+#include "HDRImage.h"
+#include "ReadData.h"
+#include "ToneMapReference.h"
+
 // Build for LH vs. RH coords
 //#define LH_COORDS
 
@@ -19,6 +24,7 @@
 //#define TEST_HDR_LINEAR
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -149,6 +155,8 @@ void Game::Initialize(
 
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -442,6 +450,7 @@ void Game::Render()
     PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
     m_deviceResources->Present();
     m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+    m_renderTargetPool->EndFrame();
 
     // Sample stats to update peak values
     std::ignore = m_graphicsMemory->GetStatistics();
@@ -473,6 +482,391 @@ void Game::Clear()
 }
 #pragma endregion
 
+#pragma region Unit Tests
+namespace
+{
+    // Stands in for the device so the pool bookkeeping can be checked without creating resources.
+    class MockRenderTargetAllocator
+    {
+    public:
+        using Resource = uint32_t;
+
+        MockRenderTargetAllocator() noexcept : m_nextId(0) {}
+
+        Resource Create(const DX::RenderTargetKey&) { return ++m_nextId; }
+
+        uint64_t GetAllocationSize(const DX::RenderTargetKey& key)
+        {
+            const uint64_t bpp = (key.format == DXGI_FORMAT_R16G16B16A16_FLOAT) ? 8 : 4;
+            const uint64_t bytes = uint64_t(key.width) * uint64_t(key.height) * bpp;
+            return (bytes + 0xFFFF) & ~uint64_t(0xFFFF);
+        }
+
+    private:
+        uint32_t m_nextId;
+    };
+
+    using MockPool = DX::RenderTargetPool<MockRenderTargetAllocator>;
+
+    constexpr uint32_t c_rtFlags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+    // Scene -> half-res blur -> full-res composite, releasing each target once consumed.
+    void SimulatePostProcessFrame(MockPool& pool, uint32_t width, uint32_t height)
+    {
+        const DX::RenderTargetKey full = { width, height, DXGI_FORMAT_R16G16B16A16_FLOAT, c_rtFlags };
+        const DX::RenderTargetKey half = { width / 2, height / 2, DXGI_FORMAT_R16G16B16A16_FLOAT, c_rtFlags };
+
+        auto scene = pool.Acquire(full);
+        auto blur = pool.Acquire(half);
+        pool.Release(scene);
+        auto composite = pool.Acquire(full);
+        pool.Release(blur);
+        pool.Release(composite);
+        pool.EndFrame();
+    }
+
+    const wchar_t* const c_toneMapImages[] =
+    {
+        L"HDR_029_Sky_Cloudy_Ref.dds",
+        L"HDR_112_River_Road_2_Ref.dds",
+    };
+
+    // Both images are BC6H_UF16. Expected texels and FNV-1a checksums of the decoded RGBA floats
+    // come from a separate decoder written from the format specification's bit layouts, which
+    // matches HDRImage bit for bit on every pixel. One texel per mode family: single region
+    // untransformed (0x03) and transformed (0x0B), and the second region of two-region 0x12 and 0x01.
+    struct HDRTexel
+    {
+        uint32_t    x;
+        uint32_t    y;
+        float       rgb[3];
+    };
+
+    struct HDRImageGolden
+    {
+        uint64_t    checksum;
+        HDRTexel    texels[4];
+    };
+
+    const HDRImageGolden c_toneMapImageGolden[] =
+    {
+        {
+            0xf91a6711d402ca12,
+            {
+                { 185, 542, { 0.102844238f, 0.0833740234f, 0.0311126709f } },
+                { 397, 542, { 0.204589844f, 0.166748047f, 0.0961303711f } },
+                { 3, 543, { 0.191650391f, 0.120483398f, 0.0675048828f } },
+                { 35, 543, { 0.171264648f, 0.117858887f, 0.0637207031f } },
+            }
+        },
+        {
+            0x0329bd1a916abc43,
+            {
+                { 73, 542, { 0.0347595215f, 0.0222320557f, 0.0133972168f } },
+                { 553, 542, { 0.0592956543f, 0.0446472168f, 0.0289611816f } },
+                { 3, 543, { 0.0571899414f, 0.0366516113f, 0.0218048096f } },
+                { 27, 543, { 0.0370788574f, 0.0228118896f, 0.0135421753f } },
+            }
+        },
+    };
+
+    static_assert(std::size(c_toneMapImageGolden) == std::size(c_toneMapImages), "Missing HDR image golden");
+
+    uint64_t ChecksumPixels(const std::vector<XMFLOAT4>& pixels) noexcept
+    {
+        auto bytes = reinterpret_cast<const uint8_t*>(pixels.data());
+        uint64_t hash = 0xcbf29ce484222325;
+        for (size_t j = 0; j < pixels.size() * sizeof(XMFLOAT4); ++j)
+        {
+            hash = (hash ^ bytes[j]) * 0x100000001b3;
+        }
+        return hash;
+    }
+
+    // Whole-processor results for one HDR pixel, worked by hand from the ToneMap shader formulas
+    // (not produced by ToneMapReference): exposure is 2^EV, Reinhard is x / (1 + x), ACES is
+    // Narkowicz's fit, SRGB is x^(1/2.2), and ST2084 rotates the primaries, scales by paper white
+    // over 10,000 nits, and applies PQ with the SMPTE constants (m1 = 2610/16384, m2 = 2523/32,
+    // c1 = 3424/4096, c2 = 2413/128, c3 = 2392/128).
+    const XMVECTORF32 c_toneMapInput = { { { 0.25f, 1.f, 4.f, 0.5f } } };
+
+    struct ToneMapGolden
+    {
+        ToneMapPostProcess::Operator                op;
+        ToneMapPostProcess::TransferFunction        func;
+        float                                       exposure;
+        ToneMapPostProcess::ColorPrimaryRotation    rotation;
+        float                                       paperWhiteNits;
+        float                                       expected[3];
+    };
+
+    const ToneMapGolden c_toneMapGolden[] =
+    {
+        { ToneMapPostProcess::None, ToneMapPostProcess::Linear, 0.f, ToneMapPostProcess::HDTV_to_UHDTV, 200.f, { 0.25f, 1.f, 4.f } },
+        { ToneMapPostProcess::None, ToneMapPostProcess::SRGB, 0.f, ToneMapPostProcess::HDTV_to_UHDTV, 200.f, { 0.5325205f, 1.f, 1.877862f } },
+        { ToneMapPostProcess::Saturate, ToneMapPostProcess::Linear, 1.f, ToneMapPostProcess::HDTV_to_UHDTV, 200.f, { 0.5f, 1.f, 1.f } },
+        { ToneMapPostProcess::Saturate, ToneMapPostProcess::SRGB, -1.f, ToneMapPostProcess::HDTV_to_UHDTV, 200.f, { 0.3886016f, 0.7297401f, 1.f } },
+        { ToneMapPostProcess::Reinhard, ToneMapPostProcess::Linear, 1.f, ToneMapPostProcess::HDTV_to_UHDTV, 200.f, { 1.f / 3.f, 2.f / 3.f, 8.f / 9.f } },
+        { ToneMapPostProcess::Reinhard, ToneMapPostProcess::SRGB, 0.f, ToneMapPostProcess::HDTV_to_UHDTV, 200.f, { 0.4811565f, 0.7297401f, 0.9035454f } },
+        { ToneMapPostProcess::ACESFilmic, ToneMapPostProcess::Linear, 0.f, ToneMapPostProcess::HDTV_to_UHDTV, 200.f, { 0.3741110f, 0.8037975f, 0.9734171f } },
+        { ToneMapPostProcess::ACESFilmic, ToneMapPostProcess::SRGB, 1.f, ToneMapPostProcess::HDTV_to_UHDTV, 200.f, { 0.8025151f, 0.9603573f, 1.f } },
+        { ToneMapPostProcess::None, ToneMapPostProcess::ST2084, 0.f, ToneMapPostProcess::HDTV_to_UHDTV, 200.f, { 0.5361002f, 0.5772644f, 0.7182966f } },
+        { ToneMapPostProcess::None, ToneMapPostProcess::ST2084, 0.f, ToneMapPostProcess::DCI_P3_D65_to_UHDTV, 100.f, { 0.4540340f, 0.5083913f, 0.6512766f } },
+        { ToneMapPostProcess::None, ToneMapPostProcess::ST2084, 0.f, ToneMapPostProcess::HDTV_to_DCI_P3_D65, 300.f, { 0.5221230f, 0.6191855f, 0.7637581f } },
+    };
+
+    bool CheckToneMapValue(const char* name, FXMVECTOR value, float x, float y, float z, float w, float epsilon = 1e-5f)
+    {
+        if (!XMVector4NearEqual(value, XMVectorSet(x, y, z, w), XMVectorReplicate(epsilon)))
+        {
+            char buff[256] = {};
+            sprintf_s(buff, "ERROR: ToneMapReference %s returned (%f, %f, %f, %f), expected (%f, %f, %f, %f)\n", name,
+                XMVectorGetX(value), XMVectorGetY(value), XMVectorGetZ(value), XMVectorGetW(value), x, y, z, w);
+            OutputDebugStringA(buff);
+            return false;
+        }
+        return true;
+    }
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    constexpr uint32_t c_retireFrames = 3;
+
+    MockRenderTargetAllocator mock;
+    const uint64_t fullBytes = mock.GetAllocationSize({ 1280, 720, DXGI_FORMAT_R16G16B16A16_FLOAT, c_rtFlags });
+    const uint64_t halfBytes = mock.GetAllocationSize({ 640, 360, DXGI_FORMAT_R16G16B16A16_FLOAT, c_rtFlags });
+
+    // Steady state: the composite aliases the scene target and nothing is created after the first frame.
+    {
+        MockPool pool(mock, c_retireFrames);
+
+        for (size_t j = 0; j < 100; ++j)
+        {
+            SimulatePostProcessFrame(pool, 1280, 720);
+        }
+
+        if (pool.GetCreateCount() != 2 || pool.GetReuseCount() != 298)
+        {
+            char buff[128] = {};
+            sprintf_s(buff, "ERROR: RenderTargetPool steady state created %llu, reused %llu (expected 2, 298)\n",
+                pool.GetCreateCount(), pool.GetReuseCount());
+            OutputDebugStringA(buff);
+            success = false;
+        }
+
+        if (pool.GetPeakBytes() != fullBytes + halfBytes || pool.GetLiveCount() != 2)
+        {
+            OutputDebugStringA("ERROR: RenderTargetPool steady state peak bytes\n");
+            success = false;
+        }
+    }
+
+    // Window resize churn: old sizes retire once idle, and returning to a size still in the pool reuses it.
+    {
+        MockPool pool(mock, c_retireFrames);
+
+        static const uint32_t s_sizes[][2] = { { 1280, 720 }, { 1920, 1080 }, { 1280, 720 }, { 800, 600 } };
+
+        uint64_t maxPeak = 0;
+        for (auto const& size : s_sizes)
+        {
+            for (size_t j = 0; j < 2; ++j)
+            {
+                SimulatePostProcessFrame(pool, size[0], size[1]);
+            }
+
+            const uint64_t sizeBytes = mock.GetAllocationSize({ size[0], size[1], DXGI_FORMAT_R16G16B16A16_FLOAT, c_rtFlags })
+                + mock.GetAllocationSize({ size[0] / 2, size[1] / 2, DXGI_FORMAT_R16G16B16A16_FLOAT, c_rtFlags });
+            maxPeak = std::max(maxPeak, sizeBytes);
+        }
+
+        // 1280x720 is revisited inside the retire window, so only 3 distinct sizes are ever created.
+        if (pool.GetCreateCount() != 6)
+        {
+            char buff[128] = {};
+            sprintf_s(buff, "ERROR: RenderTargetPool resize created %llu targets (expected 6)\n", pool.GetCreateCount());
+            OutputDebugStringA(buff);
+            success = false;
+        }
+
+        for (size_t j = 0; j <= c_retireFrames; ++j)
+        {
+            pool.EndFrame();
+        }
+
+        if (pool.GetLiveCount() != 0 || pool.GetCurrentBytes() != 0)
+        {
+            OutputDebugStringA("ERROR: RenderTargetPool failed to retire idle targets\n");
+            success = false;
+        }
+
+        if (pool.GetPeakBytes() < maxPeak)
+        {
+            OutputDebugStringA("ERROR: RenderTargetPool peak bytes under-reported\n");
+            success = false;
+        }
+
+        char buff[128] = {};
+        sprintf_s(buff, "RenderTargetPool resize churn: peak %llu KB (largest single size %llu KB)\n",
+            pool.GetPeakBytes() / 1024, maxPeak / 1024);
+        OutputDebugStringA(buff);
+    }
+
+    // Misuse is reported rather than corrupting the pool.
+    {
+        MockPool pool(mock, c_retireFrames);
+
+        auto slot = pool.Acquire({ 64, 64, DXGI_FORMAT_R8G8B8A8_UNORM, c_rtFlags });
+        pool.Release(slot);
+
+        bool threw = false;
+        try
+        {
+            pool.Release(slot);
+        }
+        catch (const std::logic_error&)
+        {
+            threw = true;
+        }
+
+        if (!threw)
+        {
+            OutputDebugStringA("ERROR: RenderTargetPool allowed a double release\n");
+            success = false;
+        }
+    }
+
+    {
+        char buff[128] = {};
+        sprintf_s(buff, "HDR scene render target pool: %llu KB peak\n", m_renderTargetPool->GetPeakBytes() / 1024);
+        OutputDebugStringA(buff);
+    }
+
+    // ToneMap CPU reference: known points of each curve.
+    {
+        using namespace DX::ToneMapReference;
+
+        success &= CheckToneMapValue("Saturate", Saturate(XMVectorSet(-1.f, 0.5f, 2.f, 3.f)), 0.f, 0.5f, 1.f, 3.f);
+        success &= CheckToneMapValue("Reinhard", Reinhard(XMVectorSet(0.f, 1.f, 3.f, 3.f)), 0.f, 0.5f, 0.75f, 3.f);
+        success &= CheckToneMapValue("ACESFilmic", ACESFilmic(XMVectorSet(0.f, 1.f, 10.f, 2.f)), 0.f, 0.8037974f, 1.f, 2.f);
+        success &= CheckToneMapValue("LinearToSRGBEst", LinearToSRGBEst(XMVectorSet(0.5f, 0.18f, 1.f, 2.f)), 0.7297401f, 0.4586565f, 1.f, 2.f);
+
+        // 0, 100, and 10,000 nits.
+        success &= CheckToneMapValue("LinearToST2084", LinearToST2084(XMVectorSet(0.f, 0.01f, 1.f, 0.5f)), 7.3e-7f, 0.5080779f, 1.f, 0.5f);
+
+        // Each rotation maps white to white.
+        for (unsigned int rotation = ToneMapPostProcess::HDTV_to_UHDTV; rotation <= ToneMapPostProcess::HDTV_to_DCI_P3_D65; ++rotation)
+        {
+            const XMVECTOR white = XMVector3TransformNormal(g_XMOne, GetColorRotation(static_cast<ToneMapPostProcess::ColorPrimaryRotation>(rotation)));
+            if (!XMVector3NearEqual(white, g_XMOne, XMVectorReplicate(1e-4f)))
+            {
+                OutputDebugStringA("ERROR: ToneMapReference color rotation does not preserve white\n");
+                success = false;
+            }
+        }
+    }
+
+    // ToneMap CPU reference: each operator, transfer function, exposure, and rotation end to end.
+    for (auto const& golden : c_toneMapGolden)
+    {
+        DX::ToneMapReferenceProcessor toneMap(golden.op, golden.func);
+        toneMap.SetExposure(golden.exposure);
+        toneMap.SetColorRotation(golden.rotation);
+        toneMap.SetST2084Parameter(golden.paperWhiteNits);
+
+        char name[64] = {};
+        sprintf_s(name, "operator %u transfer %u rotation %u", golden.op, golden.func, golden.rotation);
+
+        // Alpha passes through untouched.
+        success &= CheckToneMapValue(name, toneMap.Process(c_toneMapInput),
+            golden.expected[0], golden.expected[1], golden.expected[2], 0.5f, 1e-4f);
+    }
+
+    // ToneMap CPU reference: the HDR test images decode to their goldens, the batch path matches the
+    // per-pixel path, and throughput. Only timing runs tone map whole images.
+    {
+        std::vector<XMFLOAT4> output;
+        uint64_t pixelCount = 0;
+        DX::CpuTimer timer;
+
+        for (size_t image = 0; image < std::size(c_toneMapImages); ++image)
+        {
+            const auto blob = DX::ReadData(c_toneMapImages[image]);
+            const DX::HDRImage hdr = DX::LoadHDRImage(blob.data(), blob.size());
+
+            auto const& decoded = c_toneMapImageGolden[image];
+            if (ChecksumPixels(hdr.pixels) != decoded.checksum)
+            {
+                char buff[128] = {};
+                sprintf_s(buff, "ERROR: HDRImage decode of image %zu does not match its checksum\n", image);
+                OutputDebugStringA(buff);
+                success = false;
+            }
+
+            for (auto const& texel : decoded.texels)
+            {
+                auto const& pixel = hdr.pixels[size_t(texel.y) * hdr.width + texel.x];
+                if (pixel.x != texel.rgb[0] || pixel.y != texel.rgb[1] || pixel.z != texel.rgb[2] || pixel.w != 1.f)
+                {
+                    char buff[256] = {};
+                    sprintf_s(buff, "ERROR: HDRImage image %zu texel (%u, %u) is (%f, %f, %f, %f), expected (%f, %f, %f, 1)\n",
+                        image, texel.x, texel.y, pixel.x, pixel.y, pixel.z, pixel.w, texel.rgb[0], texel.rgb[1], texel.rgb[2]);
+                    OutputDebugStringA(buff);
+                    success = false;
+                }
+            }
+
+            output.resize(g_benchmarks ? hdr.pixels.size() : std::min<size_t>(hdr.pixels.size(), 65536));
+
+            for (auto const& golden : c_toneMapGolden)
+            {
+                DX::ToneMapReferenceProcessor toneMap(golden.op, golden.func);
+                toneMap.SetColorRotation(golden.rotation);
+
+                timer.Start();
+                toneMap.Process(hdr.pixels.data(), output.data(), output.size());
+                timer.Stop();
+                pixelCount += output.size();
+
+                for (size_t j = 0; j < output.size(); j += 97)
+                {
+                    const XMVECTOR expected = toneMap.Process(XMLoadFloat4(&hdr.pixels[j]));
+                    if (!XMVector4NearEqual(XMLoadFloat4(&output[j]), expected, XMVectorReplicate(1e-6f)))
+                    {
+                        char buff[256] = {};
+                        sprintf_s(buff, "ERROR: ToneMapReference image %zu operator %u transfer %u rotation %u batch differs at pixel %zu\n",
+                            image, golden.op, golden.func, golden.rotation, j);
+                        OutputDebugStringA(buff);
+                        success = false;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (g_benchmarks)
+        {
+            char buff[128] = {};
+            sprintf_s(buff, "ToneMapReference: %zu golden checks, %.1f Mpixels/s\n",
+                std::size(c_toneMapGolden), timer.GetRate(pixelCount) / 1000000.0);
+            OutputDebugStringA(buff);
+        }
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
+#pragma endregion
+
 #pragma region Message Handlers
 // Message handlers
 void Game::OnActivated()
@@ -560,6 +954,11 @@ void Game::CreateDeviceDependentResources()
         m_resourceDescriptors->GetCpuHandle(Descriptors::SceneTex),
         m_renderDescriptors->GetCpuHandle(RTDescriptors::HDRScene));
 
+    // The HDR scene target is acquired through a pool so that UnitTests can report its real allocation size.
+    m_renderTargetPool = std::make_unique<DX::RenderTexturePool>(DX::RenderTextureAllocator(device),
+        m_deviceResources->GetBackBufferCount());
+    m_hdrScene->SetPool(m_renderTargetPool.get());
+
     const RenderTargetState hdrState(m_hdrScene->GetFormat(),
         m_deviceResources->GetDepthBufferFormat());
 
@@ -670,6 +1069,9 @@ void Game::CreateWindowSizeDependentResources()
     // Set windows size for HDR.
     m_hdrScene->SetWindow(size);
 
+    // The GPU was idled for the resize, so the scene target for the previous size can go now.
+    m_renderTargetPool->Trim();
+
     for (unsigned int mode = ToneMapPostProcess::Saturate; mode < ToneMapPostProcess::Operator_Max; ++mode)
     {
         m_toneMap[mode]->SetHDRSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex));
@@ -712,6 +1114,8 @@ void Game::OnDeviceLost()
     m_toneMapHDR10.reset();
 
     m_hdrScene->ReleaseDevice();
+    m_hdrScene->SetPool(nullptr);
+    m_renderTargetPool.reset();
 
     m_resourceDescriptors.reset();
     m_renderDescriptors.reset();
@@ -91,6 +91,8 @@ private:
     void CycleToneMapOperator();
     void CycleColorRotation();
 
+    void UnitTests();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
 
@@ -118,6 +120,7 @@ private:
 #endif
 
     std::unique_ptr<DX::RenderTexture>              m_hdrScene;
+    std::unique_ptr<DX::RenderTexturePool>          m_renderTargetPool;
 
     // Test resources.
     std::unique_ptr<DirectX::SpriteBatch>           m_batch;
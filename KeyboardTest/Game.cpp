@@ -12,11 +12,14 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
 #include "FindMedia.h"
+#include "InputEvents.h"
 
 #define GAMMA_CORRECT_RENDERING
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -57,6 +60,7 @@ static_assert(std::is_nothrow_move_assignable<Keyboard::KeyboardStateTracker>::v
 
 Game::Game() noexcept(false) :
     m_kb{},
+    m_captureInput(false),
     m_lastStr(nullptr),
     m_lastStrBuff{}
 {
@@ -172,6 +176,8 @@ void Game::Initialize(
 
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -207,6 +213,16 @@ void Game::Update(DX::StepTimer const&)
 
     m_tracker.Update(kb);
 
+    if (m_tracker.pressed.F11)
+        ToggleInputCapture();
+
+    if (m_captureInput)
+    {
+        DX::InputFrame frame = {};
+        frame.keyboard = kb;
+        m_recorder.Record(frame);
+    }
+
     if (m_tracker.pressed.Q)
         m_lastStr = L"Q was pressed";
     else if (m_tracker.released.Q)
@@ -393,6 +409,22 @@ void Game::Update(DX::StepTimer const&)
 
     PIXEndEvent();
 }
+
+// Live input is only recorded between two toggles; stopping writes the capture out.
+void Game::ToggleInputCapture()
+{
+    m_captureInput = !m_captureInput;
+
+    if (m_captureInput)
+    {
+        m_recorder.Clear();
+        OutputDebugStringA("INFO: Input capture started\n");
+    }
+    else
+    {
+        DX::SaveCapture(m_recorder, L"KeyboardTest.dxir");
+    }
+}
 #pragma endregion
 
 #pragma region Frame Render
@@ -654,6 +686,309 @@ void Game::Clear()
 }
 #pragma endregion
 
+#pragma region Unit Tests
+namespace
+{
+    inline void ToggleKey(Keyboard::State& state, int vk) noexcept
+    {
+        auto ptr = reinterpret_cast<uint32_t*>(&state);
+        ptr[(vk >> 5)] ^= (1u << (vk & 0x1f));
+    }
+
+    inline bool IsKeyDown(const Keyboard::State& state, int vk) noexcept
+    {
+        auto ptr = reinterpret_cast<const uint32_t*>(&state);
+        return (ptr[(vk >> 5)] & (1u << (vk & 0x1f))) != 0;
+    }
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    // Synthesize a reproducible keyboard stream (fixed seed) with 0-3 key transitions per frame.
+    // Timing runs replay a longer stream.
+    const size_t frameCount = g_benchmarks ? 100000 : 5000;
+
+    std::mt19937 generator(0x4b455953);
+    std::uniform_int_distribution<int> keyDist(0x08, 0xFE);
+    std::uniform_int_distribution<int> countDist(0, 3);
+
+    std::vector<Keyboard::State> reference;
+    reference.reserve(frameCount);
+
+    DX::InputRecorder recorder;
+    DX::InputFrame frame = {};
+    size_t expectedPressed = 0;
+    size_t expectedReleased = 0;
+    for (size_t j = 0; j < frameCount; ++j)
+    {
+        for (int k = countDist(generator); k > 0; --k)
+        {
+            ToggleKey(frame.keyboard, keyDist(generator));
+        }
+
+        if (j > 0)
+        {
+            for (int vk = 0; vk < 256; ++vk)
+            {
+                const bool last = IsKeyDown(reference.back(), vk);
+                const bool now = IsKeyDown(frame.keyboard, vk);
+                if (now && !last)
+                    ++expectedPressed;
+                else if (!now && last)
+                    ++expectedReleased;
+            }
+        }
+
+        recorder.Record(frame);
+        reference.push_back(frame.keyboard);
+    }
+
+    // Round-trip
+    {
+        DX::InputReplayer replayer(recorder.GetStream());
+
+        size_t count = 0;
+        while (replayer.Next(frame))
+        {
+            if (count >= reference.size()
+                || memcmp(&frame.keyboard, &reference[count], sizeof(Keyboard::State)) != 0)
+            {
+                OutputDebugStringA("ERROR: Failed InputReplayer round-trip test\n");
+                success = false;
+                break;
+            }
+            ++count;
+        }
+
+        if (success && count != frameCount)
+        {
+            OutputDebugStringA("ERROR: Failed InputReplayer frame count test\n");
+            success = false;
+        }
+    }
+
+    // Tracker throughput from the replayed stream
+    {
+        DX::InputReplayer replayer(recorder.GetStream());
+        Keyboard::KeyboardStateTracker tracker;
+
+        size_t pressed = 0;
+        size_t released = 0;
+        bool first = true;
+
+        DX::CpuTimer timer;
+        timer.Start();
+        while (replayer.Next(frame))
+        {
+            tracker.Update(frame.keyboard);
+            if (first)
+            {
+                // Keys already down on the first frame are reported as pressed.
+                first = false;
+                continue;
+            }
+
+            for (int vk = 0; vk < 256; ++vk)
+            {
+                if (tracker.IsKeyPressed(static_cast<Keyboard::Keys>(vk)))
+                    ++pressed;
+                else if (tracker.IsKeyReleased(static_cast<Keyboard::Keys>(vk)))
+                    ++released;
+            }
+        }
+        timer.Stop();
+
+        if (pressed != expectedPressed || released != expectedReleased)
+        {
+            OutputDebugStringA("ERROR: Failed KeyboardStateTracker replay test\n");
+            success = false;
+        }
+
+        if (g_benchmarks)
+        {
+            char buff[256] = {};
+            sprintf_s(buff, "INFO: Replayed %zu frames (%zu bytes, %.2f bytes/frame) in %.3f ms: %.2f Mframes/s, %.1f ns/frame\n",
+                frameCount, recorder.GetStream().size(),
+                double(recorder.GetStream().size()) / double(frameCount),
+                timer.GetElapsedMilliseconds(),
+                timer.GetRate(frameCount) / 1000000.0,
+                timer.GetElapsedSeconds() * 1e9 / double(frameCount));
+            OutputDebugStringA(buff);
+        }
+    }
+
+    // Batched transitions vs. per-key tracker queries
+    {
+        // Timing runs repeat the stream to smooth out the measurement.
+        const size_t passes = g_benchmarks ? 10 : 1;
+
+        size_t perKeyPressed = 0;
+        size_t perKeyReleased = 0;
+        DX::CpuTimer perKeyTimer;
+        {
+            Keyboard::KeyboardStateTracker tracker;
+            for (size_t pass = 0; pass < passes; ++pass)
+            {
+                tracker.Reset();
+                perKeyTimer.Start();
+                for (const auto& state : reference)
+                {
+                    tracker.Update(state);
+                    for (int vk = 0; vk < 256; ++vk)
+                    {
+                        if (tracker.IsKeyPressed(static_cast<Keyboard::Keys>(vk)))
+                            ++perKeyPressed;
+                        else if (tracker.IsKeyReleased(static_cast<Keyboard::Keys>(vk)))
+                            ++perKeyReleased;
+                    }
+                }
+                perKeyTimer.Stop();
+            }
+        }
+
+        size_t batchPressed = 0;
+        size_t batchReleased = 0;
+        size_t visited = 0;
+        DX::CpuTimer batchTimer;
+        {
+            DX::KeyboardTransitions transitions;
+            for (size_t pass = 0; pass < passes; ++pass)
+            {
+                transitions.Reset();
+                batchTimer.Start();
+                for (const auto& state : reference)
+                {
+                    transitions.Update(state);
+                    if (transitions.changed.Any())
+                    {
+                        batchPressed += transitions.pressed.Count();
+                        transitions.released.ForEach([&](Keyboard::Keys) { ++batchReleased; });
+                        transitions.changed.ForEach([&](Keyboard::Keys) { ++visited; });
+                    }
+                }
+                batchTimer.Stop();
+            }
+        }
+
+        if (batchPressed != perKeyPressed || batchReleased != perKeyReleased || visited != (batchPressed + batchReleased))
+        {
+            OutputDebugStringA("ERROR: Failed KeyboardTransitions vs. KeyboardStateTracker test\n");
+            success = false;
+        }
+
+        // Spot-check the bitsets against the tracker for a single frame
+        {
+            Keyboard::KeyboardStateTracker tracker;
+            DX::KeyboardTransitions transitions;
+            for (size_t j = 0; j < 2; ++j)
+            {
+                tracker.Update(reference[j]);
+                transitions.Update(reference[j]);
+            }
+
+            for (int vk = 0; vk < 256; ++vk)
+            {
+                const auto key = static_cast<Keyboard::Keys>(vk);
+                if (transitions.pressed.IsSet(key) != tracker.IsKeyPressed(key)
+                    || transitions.released.IsSet(key) != tracker.IsKeyReleased(key))
+                {
+                    OutputDebugStringA("ERROR: Failed KeyboardTransitions bitset test\n");
+                    success = false;
+                    break;
+                }
+            }
+        }
+
+        if (g_benchmarks)
+        {
+            const size_t frames = frameCount * passes;
+
+            char buff[256] = {};
+            sprintf_s(buff, "INFO: Per-key queries: %.3f ms (%.1f ns/frame); batched transitions: %.3f ms (%.1f ns/frame), %.1fx\n",
+                perKeyTimer.GetElapsedMilliseconds(),
+                perKeyTimer.GetElapsedSeconds() * 1e9 / double(frames),
+                batchTimer.GetElapsedMilliseconds(),
+                batchTimer.GetElapsedSeconds() * 1e9 / double(frames),
+                (batchTimer.GetElapsedSeconds() > 0.0) ? perKeyTimer.GetElapsedSeconds() / batchTimer.GetElapsedSeconds() : 0.0);
+            OutputDebugStringA(buff);
+        }
+    }
+
+    // Event queue edges from the replayed stream against the tracker
+    {
+        DX::InputReplayer replayer(recorder.GetStream());
+        DX::InputEventQueue queue;
+        Keyboard::KeyboardStateTracker tracker;
+
+        bool matched = true;
+        while (matched && replayer.Next(frame))
+        {
+            queue.Update(frame);
+            tracker.Update(frame.keyboard);
+
+            // 1 = pressed, 2 = released. The stream has no mouse or gamepad input, so any other event is an error.
+            uint8_t edges[256] = {};
+            for (const auto& evt : queue.GetEvents())
+            {
+                if ((evt.type != DX::InputEvent::KeyPressed && evt.type != DX::InputEvent::KeyReleased) || edges[evt.code])
+                {
+                    matched = false;
+                    break;
+                }
+
+                edges[evt.code] = (evt.type == DX::InputEvent::KeyPressed) ? 1 : 2;
+            }
+
+            for (int vk = 0; vk < 256 && matched; ++vk)
+            {
+                const auto key = static_cast<Keyboard::Keys>(vk);
+                const uint8_t expected = tracker.IsKeyPressed(key) ? 1 : (tracker.IsKeyReleased(key) ? 2 : 0);
+                if (edges[vk] != expected)
+                {
+                    matched = false;
+                }
+            }
+        }
+
+        // After a reset, keys still held are reported as pressed again.
+        if (matched && !reference.empty())
+        {
+            queue.Reset();
+            queue.UpdateKeyboard(reference.back());
+
+            size_t held = 0;
+            for (int vk = 0; vk < 256; ++vk)
+            {
+                if (IsKeyDown(reference.back(), vk))
+                    ++held;
+            }
+
+            if (queue.GetEvents().size() != held)
+            {
+                matched = false;
+            }
+        }
+
+        if (!matched)
+        {
+            OutputDebugStringA("ERROR: Failed InputEventQueue keyboard test\n");
+            success = false;
+        }
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
+#pragma endregion
+
 #pragma region Message Handlers
 // Message handlers
 void Game::OnActivated()
@@ -11,6 +11,8 @@
 #pragma once
 
 #include "DirectXTKTest.h"
+#include "InputRecorder.h"
+#include "KeyboardTransitions.h"
 #include "StepTimer.h"
 
 constexpr uint32_t c_testTimeout = 5000;
@@ -86,6 +88,9 @@ private:
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
+    void UnitTests();
+    void ToggleInputCapture();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
 
@@ -102,6 +107,8 @@ private:
     std::unique_ptr<DirectX::Keyboard>                  m_keyboard;
     DirectX::Keyboard::KeyboardStateTracker             m_tracker;
     DirectX::Keyboard::State                            m_kb;
+    DX::InputRecorder                                   m_recorder;
+    bool                                                m_captureInput;
     std::unique_ptr<DirectX::GeometricPrimitive>        m_room;
     std::unique_ptr<DirectX::BasicEffect>               m_roomEffect;
     Microsoft::WRL::ComPtr<ID3D12Resource>              m_roomTex;
@@ -12,6 +12,10 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
+#include "FrustumCulling.h"
+#include "InstanceTransforms.h"
+
 extern void ExitGame() noexcept;
 
 using namespace DirectX;
@@ -41,6 +45,8 @@ namespace
     constexpr float row1 = 0.f;
     constexpr float row2 = -2.f;
 
+    constexpr float c_farz = 15.f;
+
 #ifdef GAMMA_CORRECT_RENDERING
     const XMVECTORF32 c_clearColor = { { { 0.127437726f, 0.300543845f, 0.846873462f, 1.f } } };
 #else
@@ -155,6 +161,8 @@ void Game::Initialize(
     {
         m_bones[j] = id;
     }
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -300,10 +308,11 @@ void Game::Render()
 
     // Prepare the command list to render a new frame.
     m_deviceResources->Prepare();
+    m_recorder->BeginFrame(m_deviceResources->GetCurrentFrameIndex());
     Clear();
 
-    auto commandList = m_deviceResources->GetCommandList();
-    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Render");
+    auto primaryList = m_deviceResources->GetCommandList();
+    PIXBeginEvent(primaryList, PIX_COLOR_DEFAULT, L"Render");
 
     if (m_firstFrame)
     {
@@ -313,14 +322,14 @@ void Game::Render()
 
         // Copy queue resources are left in D3D12_RESOURCE_STATE_COPY_DEST state
         #ifdef USE_COPY_QUEUE
-        m_cupMesh->Transition(commandList,
+        m_cupMesh->Transition(primaryList,
             D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
             D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER);
         #endif
 
         // Compute queue IBs are in D3D12_RESOURCE_STATE_COPY_DEST state
         #ifdef USE_COMPUTE_QUEUE
-        m_vbo->Transition(commandList,
+        m_vbo->Transition(primaryList,
             D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER, D3D12_RESOURCE_STATE_VERTEX_AND_CONSTANT_BUFFER,
             D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_INDEX_BUFFER);
         #endif
@@ -328,243 +337,258 @@ void Game::Render()
         m_firstFrame = false;
     }
 
-    // Set the descriptor heaps
-    ID3D12DescriptorHeap* heaps[] = { m_resourceDescriptors->Heap(), m_states->Heap() };
-    commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
-
-    //--- Draw Wavefront OBJ models --------------------------------------------------------
-    for (auto& it : m_cupNormal)
+    // Each group below owns the effects it touches, so the groups record into their own
+    // command lists on worker threads. They execute in this order, after the clear above.
+    const std::function<void(ID3D12GraphicsCommandList*)> segments[] =
     {
-        auto lights = dynamic_cast<IEffectLights*>(it.get());
-        if (lights)
+        [&](ID3D12GraphicsCommandList* commandList)
         {
-            lights->EnableDefaultLighting();
-        }
-    }
+            //--- Draw Wavefront OBJ models --------------------------------------------------------
+            for (auto& it : m_cupNormal)
+            {
+                auto lights = dynamic_cast<IEffectLights*>(it.get());
+                if (lights)
+                {
+                    lights->EnableDefaultLighting();
+                }
+            }
 
-    XMMATRIX local = XMMatrixTranslation(1.5f, row0, 0.f);
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_cupNormal, local, m_view, m_projection);
-    m_cup->Draw(commandList, m_cupNormal.cbegin());
-
-        // Wireframe
-    local = XMMatrixTranslation(3.f, row0, 0.f);
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_cupWireframe, local, m_view, m_projection);
-    m_cup->Draw(commandList, m_cupWireframe.cbegin());
-
-        // Custom settings
-    local = XMMatrixTranslation(0.f, row0, 0.f);
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_cupCustom, local, m_view, m_projection);
-    m_cup->Draw(commandList, m_cupCustom.cbegin());
-
-        // Lighting settings
-    for (auto& it : m_cupNormal)
-    {
-        auto lights = dynamic_cast<IEffectLights*>(it.get());
-        if (lights)
-        {
-            XMVECTOR dir = XMVector3Rotate(g_XMOne, quat);
-            lights->SetLightDirection(0, dir);
-        }
-    }
+            XMMATRIX local = XMMatrixTranslation(1.5f, row0, 0.f);
+            local = XMMatrixMultiply(world, local);
+            Model::UpdateEffectMatrices(m_cupNormal, local, m_view, m_projection);
+            m_cup->Draw(commandList, m_cupNormal.cbegin());
+
+                // Wireframe
+            local = XMMatrixTranslation(3.f, row0, 0.f);
+            local = XMMatrixMultiply(world, local);
+            Model::UpdateEffectMatrices(m_cupWireframe, local, m_view, m_projection);
+            m_cup->Draw(commandList, m_cupWireframe.cbegin());
+
+                // Custom settings
+            local = XMMatrixTranslation(0.f, row0, 0.f);
+            local = XMMatrixMultiply(world, local);
+            Model::UpdateEffectMatrices(m_cupCustom, local, m_view, m_projection);
+            m_cup->Draw(commandList, m_cupCustom.cbegin());
+
+                // Lighting settings
+            for (auto& it : m_cupNormal)
+            {
+                auto lights = dynamic_cast<IEffectLights*>(it.get());
+                if (lights)
+                {
+                    XMVECTOR dir = XMVector3Rotate(g_XMOne, quat);
+                    lights->SetLightDirection(0, dir);
+                }
+            }
 
-    local = XMMatrixTranslation(-1.5f, row0, 0.f);
-    Model::UpdateEffectMatrices(m_cupNormal, local, m_view, m_projection);
-    m_cup->Draw(commandList, m_cupNormal.cbegin());
+            local = XMMatrixTranslation(-1.5f, row0, 0.f);
+            Model::UpdateEffectMatrices(m_cupNormal, local, m_view, m_projection);
+            m_cup->Draw(commandList, m_cupNormal.cbegin());
 
-        // No per pixel lighting
-    local = XMMatrixTranslation(-3.f, row0, 0.f);
-    Model::UpdateEffectMatrices(m_cupVertexLighting, local, m_view, m_projection);
-    for (auto& it : m_cupVertexLighting)
-    {
-        auto lights = dynamic_cast<IEffectLights*>(it.get());
-        if (lights)
-        {
-            XMVECTOR dir = XMVector3Rotate(g_XMOne, quat);
-            lights->SetLightDirection(0, dir);
+                // No per pixel lighting
+            local = XMMatrixTranslation(-3.f, row0, 0.f);
+            Model::UpdateEffectMatrices(m_cupVertexLighting, local, m_view, m_projection);
+            for (auto& it : m_cupVertexLighting)
+            {
+                auto lights = dynamic_cast<IEffectLights*>(it.get());
+                if (lights)
+                {
+                    XMVECTOR dir = XMVector3Rotate(g_XMOne, quat);
+                    lights->SetLightDirection(0, dir);
 
-        }
-    }
-    m_cup->Draw(commandList, m_cupVertexLighting.cbegin());
+                }
+            }
+            m_cup->Draw(commandList, m_cupVertexLighting.cbegin());
 
-        // Fog settings
-    local = XMMatrixTranslation(-4.f, row0, cos(time) * 2.f);
-    Model::UpdateEffectMatrices(m_cupFog, local, m_view, m_projection);
-    m_cup->Draw(commandList, m_cupFog.cbegin());
+                // Fog settings
+            local = XMMatrixTranslation(-4.f, row0, cos(time) * 2.f);
+            Model::UpdateEffectMatrices(m_cupFog, local, m_view, m_projection);
+            m_cup->Draw(commandList, m_cupFog.cbegin());
 
-        // Custom drawing
-    local = XMMatrixRotationX(cos(time)) * XMMatrixTranslation(-5.f, row0, cos(time) * 2.f);
-    for (const auto& mit : m_cup->meshes)
-    {
-        auto mesh = mit.get();
-        assert(mesh != nullptr);
+                // Custom drawing
+            local = XMMatrixRotationX(cos(time)) * XMMatrixTranslation(-5.f, row0, cos(time) * 2.f);
+            const DX::FrustumCuller cupCuller(XMMatrixMultiply(XMMatrixMultiply(local, m_view), m_projection));
+            for (const auto& mit : m_cup->meshes)
+            {
+                auto mesh = mit.get();
+                assert(mesh != nullptr);
 
-        for (const auto& it : mesh->opaqueMeshParts)
-        {
-            auto part = it.get();
-            assert(part != nullptr);
+                if (!cupCuller.IsVisible(mesh->boundingSphere))
+                    continue;
 
-            auto effect = m_cupNormal[part->partIndex].get();
+                for (const auto& it : mesh->opaqueMeshParts)
+                {
+                    auto part = it.get();
+                    assert(part != nullptr);
 
-            auto imatrices = dynamic_cast<IEffectMatrices*>(effect);
-            if (imatrices) imatrices->SetWorld(local);
+                    auto effect = m_cupNormal[part->partIndex].get();
 
-            effect->Apply(commandList);
-            part->Draw(commandList);
-        }
+                    auto imatrices = dynamic_cast<IEffectMatrices*>(effect);
+                    if (imatrices) imatrices->SetWorld(local);
 
-        // Skipping alphaMeshParts for this model since we know it's empty...
-        assert(mesh->alphaMeshParts.empty());
-    }
+                    effect->Apply(commandList);
+                    part->Draw(commandList);
+                }
 
-        // Custom drawing using instancing
-    local = XMMatrixTranslation(6.f, 0, 0);
-    {
-        size_t j = 0;
-        for (float y = -4.f; y <= 4.f; y += 1.f)
+                // Skipping alphaMeshParts for this model since we know it's empty...
+                assert(mesh->alphaMeshParts.empty());
+            }
+        },
+
+        [&](ID3D12GraphicsCommandList* commandList)
         {
-            XMMATRIX m = world * XMMatrixTranslation(0.f, y, cos(time + float(j) * XM_PIDIV4));
-            XMStoreFloat3x4(&m_instanceTransforms[j], m);
-            ++j;
-        }
+            // Custom drawing using instancing
+            XMMATRIX local = XMMatrixTranslation(6.f, 0, 0);
+            {
+                auto instanceTransform = [&](size_t j) { return world * XMMatrixTranslation(0.f, -4.f + float(j), cos(time + float(j) * XM_PIDIV4)); };
 
-        assert(j == m_instanceCount);
+                const DX::FrustumCuller culler(XMMatrixMultiply(XMMatrixMultiply(local, m_view), m_projection));
+                const size_t visibleCount = culler.CullInstances(m_instanceBounds, m_instanceCount, instanceTransform, m_visibleInstances.get());
 
-        const size_t instBytes = j * sizeof(XMFLOAT3X4);
+                auto vertexBufferInst = DX::CreateInstanceTransformBuffer(*m_graphicsMemory, visibleCount,
+                    [&](size_t j) { return instanceTransform(m_visibleInstances[j]); });
+                commandList->IASetVertexBuffers(1, 1, &vertexBufferInst);
 
-        GraphicsResource inst = m_graphicsMemory->Allocate(instBytes);
-        memcpy(inst.Memory(), m_instanceTransforms.get(), instBytes);
+                for (const auto& mit : m_cupInst->meshes)
+                {
+                    auto mesh = mit.get();
+                    assert(mesh != nullptr);
 
-        D3D12_VERTEX_BUFFER_VIEW vertexBufferInst = {};
-        vertexBufferInst.BufferLocation = inst.GpuAddress();
-        vertexBufferInst.SizeInBytes = static_cast<UINT>(instBytes);
-        vertexBufferInst.StrideInBytes = sizeof(XMFLOAT3X4);
-        commandList->IASetVertexBuffers(1, 1, &vertexBufferInst);
+                    for (const auto& it : mesh->opaqueMeshParts)
+                    {
+                        auto part = it.get();
+                        assert(part != nullptr);
 
-        for (const auto& mit : m_cupInst->meshes)
+                        auto effect = m_cupInstNormal[part->partIndex].get();
+
+                        auto imatrices = dynamic_cast<IEffectMatrices*>(effect);
+                        if (imatrices) imatrices->SetMatrices(local, m_view, m_projection);
+
+                        effect->Apply(commandList);
+                        part->DrawInstanced(commandList, static_cast<UINT>(visibleCount));
+                    }
+
+                    // Skipping alphaMeshParts for this model since we know it's empty...
+                    assert(mesh->alphaMeshParts.empty());
+                }
+            }
+
+            //--- Draw VBO models ------------------------------------------------------------------
+            local = XMMatrixMultiply(XMMatrixScaling(0.25f, 0.25f, 0.25f), XMMatrixTranslation(4.5f, row0, 0.f));
+            local = XMMatrixMultiply(world, local);
+            m_vboNormal->SetWorld(local);
+            m_vbo->Draw(commandList, m_vboNormal.get());
+
+            local = XMMatrixMultiply(XMMatrixScaling(0.25f, 0.25f, 0.25f), XMMatrixTranslation(4.5f, row2, 0.f));
+            local = XMMatrixMultiply(world, local);
+            m_vboEnvMap->SetWorld(local);
+            m_vbo->Draw(commandList, m_vboEnvMap.get());
+        },
+
+        [&](ID3D12GraphicsCommandList* commandList)
         {
-            auto mesh = mit.get();
-            assert(mesh != nullptr);
+            //--- Draw CMO models ------------------------------------------------------------------
+            for (auto& it : m_teapotNormal)
+            {
+                auto skinnedEffect = dynamic_cast<IEffectSkinning*>(it.get());
+                if (skinnedEffect)
+                    skinnedEffect->ResetBoneTransforms();
+            }
+            XMMATRIX local = XMMatrixMultiply(XMMatrixScaling(0.01f, 0.01f, 0.01f), XMMatrixTranslation(-2.f, row1, 0.f));
+            local = XMMatrixMultiply(world, local);
+            Model::UpdateEffectMatrices(m_teapotNormal, local, m_view, m_projection);
+            m_teapot->Draw(commandList, m_teapotNormal.cbegin());
 
-            for (const auto& it : mesh->opaqueMeshParts)
+            for (auto& it : m_teapotNormal)
             {
-                auto part = it.get();
-                assert(part != nullptr);
+                auto skinnedEffect = dynamic_cast<IEffectSkinning*>(it.get());
+                if (skinnedEffect)
+                    skinnedEffect->SetBoneTransforms(m_bones.get(), IEffectSkinning::MaxBones);
+            }
+            local = XMMatrixMultiply(XMMatrixScaling(0.01f, 0.01f, 0.01f), XMMatrixTranslation(-3.5f, row1, 0.f));
+            local = XMMatrixMultiply(world, local);
+            Model::UpdateEffectMatrices(m_teapotNormal, local, m_view, m_projection);
+            m_teapot->Draw(commandList, m_teapotNormal.cbegin());
+        },
 
-                auto effect = m_cupInstNormal[part->partIndex].get();
+        [&](ID3D12GraphicsCommandList* commandList)
+        {
+            // Models whose effects are not otherwise touched this frame go through the sorted queue.
+            m_renderQueue.Begin(m_view, m_projection, c_farz);
 
-                auto imatrices = dynamic_cast<IEffectMatrices*>(effect);
-                if (imatrices) imatrices->SetMatrices(local, m_view, m_projection);
+            XMMATRIX local = XMMatrixMultiply(XMMatrixScaling(0.1f, 0.1f, 0.1f), XMMatrixTranslation(0.f, row1, 0.f));
+            local = XMMatrixMultiply(world, local);
+            m_renderQueue.Add(*m_gamelevel, m_gamelevelNormal, local);
 
-                effect->Apply(commandList);
-                part->DrawInstanced(commandList, m_instanceCount);
-            }
+            local = XMMatrixMultiply(XMMatrixScaling(.2f, .2f, .2f), XMMatrixTranslation(0.f, row2, 0.f));
+            local = XMMatrixMultiply(world, local);
+            m_renderQueue.Add(*m_ship, m_shipNormal, local);
 
-            // Skipping alphaMeshParts for this model since we know it's empty...
-            assert(mesh->alphaMeshParts.empty());
-        }
-    }
+            //--- Draw SDKMESH models --------------------------------------------------------------
+            local = XMMatrixTranslation(-1.f, row2, 0.f);
+            local = XMMatrixMultiply(world, local);
+            m_renderQueue.Add(*m_cupMesh, m_cupMeshNormal, local);
 
-    //--- Draw VBO models ------------------------------------------------------------------
-    local = XMMatrixMultiply(XMMatrixScaling(0.25f, 0.25f, 0.25f), XMMatrixTranslation(4.5f, row0, 0.f));
-    local = XMMatrixMultiply(world, local);
-    m_vboNormal->SetWorld(local);
-    m_vbo->Draw(commandList, m_vboNormal.get());
+            local = XMMatrixMultiply(XMMatrixScaling(0.005f, 0.005f, 0.005f), XMMatrixTranslation(2.5f, row2, 0.f));
+            local = XMMatrixMultiply(world, local);
+            m_renderQueue.Add(*m_tiny, m_tinyNormal, local);
 
-    local = XMMatrixMultiply(XMMatrixScaling(0.25f, 0.25f, 0.25f), XMMatrixTranslation(4.5f, row2, 0.f));
-    local = XMMatrixMultiply(world, local);
-    m_vboEnvMap->SetWorld(local);
-    m_vbo->Draw(commandList, m_vboEnvMap.get());
+            local = XMMatrixTranslation(-2.5f, row2, 0.f);
+            local = XMMatrixMultiply(world, local);
+            m_renderQueue.Add(*m_dwarf, m_dwarfNormal, local);
 
-    //--- Draw CMO models ------------------------------------------------------------------
-    for (auto& it : m_teapotNormal)
-    {
-        auto skinnedEffect = dynamic_cast<IEffectSkinning*>(it.get());
-        if (skinnedEffect)
-            skinnedEffect->ResetBoneTransforms();
-    }
-    local = XMMatrixMultiply(XMMatrixScaling(0.01f, 0.01f, 0.01f), XMMatrixTranslation(-2.f, row1, 0.f));
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_teapotNormal, local, m_view, m_projection);
-    m_teapot->Draw(commandList, m_teapotNormal.cbegin());
+            local = XMMatrixMultiply(XMMatrixScaling(0.01f, 0.01f, 0.01f), XMMatrixTranslation(-5.0f, row2, 0.f));
+            local = XMMatrixMultiply(XMMatrixRotationRollPitchYaw(0, XM_PI, roll), local);
+            m_renderQueue.Add(*m_lmap, m_lmapNormal, local);
 
-    for (auto& it : m_teapotNormal)
-    {
-        auto skinnedEffect = dynamic_cast<IEffectSkinning*>(it.get());
-        if (skinnedEffect)
-            skinnedEffect->SetBoneTransforms(m_bones.get(), IEffectSkinning::MaxBones);
-    }
-    local = XMMatrixMultiply(XMMatrixScaling(0.01f, 0.01f, 0.01f), XMMatrixTranslation(-3.5f, row1, 0.f));
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_teapotNormal, local, m_view, m_projection);
-    m_teapot->Draw(commandList, m_teapotNormal.cbegin());
-
-    local = XMMatrixMultiply(XMMatrixScaling(0.1f, 0.1f, 0.1f), XMMatrixTranslation(0.f, row1, 0.f));
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_gamelevelNormal, local, m_view, m_projection);
-    m_gamelevel->Draw(commandList, m_gamelevelNormal.cbegin());
-
-    local = XMMatrixMultiply(XMMatrixScaling(.2f, .2f, .2f), XMMatrixTranslation(0.f, row2, 0.f));
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_shipNormal, local, m_view, m_projection);
-    m_ship->Draw(commandList, m_shipNormal.cbegin());
-
-    //--- Draw SDKMESH models --------------------------------------------------------------
-    local = XMMatrixTranslation(-1.f, row2, 0.f);
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_cupMeshNormal, local, m_view, m_projection);
-    m_cupMesh->Draw(commandList, m_cupMeshNormal.cbegin());
-
-    local = XMMatrixMultiply(XMMatrixScaling(0.005f, 0.005f, 0.005f), XMMatrixTranslation(2.5f, row2, 0.f));
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_tinyNormal, local, m_view, m_projection);
-    m_tiny->Draw(commandList, m_tinyNormal.cbegin());
-
-    local = XMMatrixTranslation(-2.5f, row2, 0.f);
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_dwarfNormal, local, m_view, m_projection);
-    m_dwarf->Draw(commandList, m_dwarfNormal.cbegin());
-
-    local = XMMatrixMultiply(XMMatrixScaling(0.01f, 0.01f, 0.01f), XMMatrixTranslation(-5.0f, row2, 0.f));
-    local = XMMatrixMultiply(XMMatrixRotationRollPitchYaw(0, XM_PI, roll), local);
-    Model::UpdateEffectMatrices(m_lmapNormal, local, m_view, m_projection);
-    m_lmap->Draw(commandList, m_lmapNormal.cbegin());
-
-    local = XMMatrixMultiply(XMMatrixScaling(0.05f, 0.05f, 0.05f), XMMatrixTranslation(-5.0f, row1, 0.f));
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_nmapNormal, local, m_view, m_projection);
-    m_nmap->Draw(commandList, m_nmapNormal.cbegin());
-
-    for (auto& it : m_soldierNormal)
-    {
-        auto skin = dynamic_cast<IEffectSkinning*>(it.get());
-        if (skin)
+            local = XMMatrixMultiply(XMMatrixScaling(0.05f, 0.05f, 0.05f), XMMatrixTranslation(-5.0f, row1, 0.f));
+            local = XMMatrixMultiply(world, local);
+            m_renderQueue.Add(*m_nmap, m_nmapNormal, local);
+
+            m_renderQueue.Submit(commandList);
+        },
+
+        [&](ID3D12GraphicsCommandList* commandList)
         {
-            skin->ResetBoneTransforms();
-        }
-    }
+            for (auto& it : m_soldierNormal)
+            {
+                auto skin = dynamic_cast<IEffectSkinning*>(it.get());
+                if (skin)
+                {
+                    skin->ResetBoneTransforms();
+                }
+            }
 
-    local = XMMatrixMultiply(XMMatrixScaling(2.f, 2.f, 2.f), XMMatrixTranslation(3.5f, row1, 0.f));
-    local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_soldierNormal, local, m_view, m_projection);
-    m_soldier->Draw(commandList, m_soldierNormal.cbegin());
+            XMMATRIX local = XMMatrixMultiply(XMMatrixScaling(2.f, 2.f, 2.f), XMMatrixTranslation(3.5f, row1, 0.f));
+            local = XMMatrixMultiply(world, local);
+            Model::UpdateEffectMatrices(m_soldierNormal, local, m_view, m_projection);
+            m_soldier->Draw(commandList, m_soldierNormal.cbegin());
 
-    for (auto& it : m_soldierNormal)
-    {
-        auto skin = dynamic_cast<IEffectSkinning*>(it.get());
-        if (skin)
+            for (auto& it : m_soldierNormal)
+            {
+                auto skin = dynamic_cast<IEffectSkinning*>(it.get());
+                if (skin)
+                {
+                    skin->SetBoneTransforms(m_bones.get(), IEffectSkinning::MaxBones);
+                }
+            }
+
+            local = XMMatrixMultiply(XMMatrixScaling(2.f, 2.f, 2.f), XMMatrixTranslation(2.5f, row1, 0.f));
+            Model::UpdateEffectMatrices(m_soldierNormal, local, m_view, m_projection);
+            m_soldier->Draw(commandList, m_soldierNormal.cbegin());
+        },
+    };
+
+    m_recorder->Record(std::size(segments), [&](size_t index, const DX::D3D12CommandListBackend::CommandList& list)
         {
-            skin->SetBoneTransforms(m_bones.get(), IEffectSkinning::MaxBones);
-        }
-    }
+            SetFrameState(list.Get());
+            segments[index](list.Get());
+        });
 
-    local = XMMatrixMultiply(XMMatrixScaling(2.f, 2.f, 2.f), XMMatrixTranslation(2.5f, row1, 0.f));
-    Model::UpdateEffectMatrices(m_soldierNormal, local, m_view, m_projection);
-    m_soldier->Draw(commandList, m_soldierNormal.cbegin());
+    PIXEndEvent(primaryList);
 
-    PIXEndEvent(commandList);
+    // The clear executes first, then the groups recorded on worker threads in order.
+    DX::SubmitParallelCommandLists(*m_recorder, primaryList, m_deviceResources->GetCommandAllocator());
 
     // Show the new frame.
     PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
@@ -600,6 +624,183 @@ void Game::Clear()
 
     PIXEndEvent(commandList);
 }
+
+// Helper method to bind the frame's targets and heaps on a command list recorded after Clear.
+void Game::SetFrameState(_In_ ID3D12GraphicsCommandList* commandList)
+{
+    ID3D12DescriptorHeap* heaps[] = { m_resourceDescriptors->Heap(), m_states->Heap() };
+    commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+
+    auto const rtvDescriptor = m_deviceResources->GetRenderTargetView();
+    auto const dsvDescriptor = m_deviceResources->GetDepthStencilView();
+    commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, &dsvDescriptor);
+
+    auto const viewport = m_deviceResources->GetScreenViewport();
+    auto const scissorRect = m_deviceResources->GetScissorRect();
+    commandList->RSSetViewports(1, &viewport);
+    commandList->RSSetScissorRects(1, &scissorRect);
+}
+#pragma endregion
+
+#pragma region Unit Tests
+namespace
+{
+    // Sorts a copy of a recorded packet stream, checks it against std::stable_sort and a replay of
+    // the bind flags, and reports the binds saved relative to submission order.
+    bool TestRenderQueue(const char* name, const DX::RenderQueue& recorded)
+    {
+        bool success = true;
+
+        const size_t count = recorded.GetCount();
+
+        std::vector<DX::RenderPacket> expected(recorded.GetPackets(), recorded.GetPackets() + count);
+        std::stable_sort(expected.begin(), expected.end(),
+            [](const DX::RenderPacket& a, const DX::RenderPacket& b) { return a.key < b.key; });
+
+        DX::RenderQueue sorted = recorded;
+
+        DX::CpuTimer timer;
+        timer.Start();
+        sorted.Sort();
+        timer.Stop();
+
+        for (size_t j = 0; j < count; ++j)
+        {
+            auto& a = sorted.GetPackets()[j];
+            auto& b = expected[j];
+            if (a.key != b.key || a.draw != b.draw || a.object != b.object)
+            {
+                char buff[128] = {};
+                sprintf_s(buff, "ERROR: RenderQueue (%s) sort differs from std::stable_sort at %zu\n", name, j);
+                OutputDebugStringA(buff);
+                success = false;
+                break;
+            }
+        }
+
+        auto noop = [](const DX::RenderPacket&, uint32_t) {};
+        const DX::RenderQueueStats unsortedStats = recorded.Emit(noop);
+
+        // Replay the binds through a simple state tracker; every draw must see its own state.
+        const void* state = nullptr;
+        uint32_t object = 0;
+        uint32_t topology = 0;
+        uint64_t vertexBuffer = 0;
+        uint64_t indexBuffer = 0;
+        size_t stale = 0;
+        const DX::RenderQueueStats sortedStats = sorted.Emit([&](const DX::RenderPacket& packet, uint32_t binds)
+            {
+                if (binds & DX::RenderBind_State) { state = packet.state; object = packet.object; }
+                if (binds & DX::RenderBind_VertexBuffer) vertexBuffer = packet.vertexBuffer;
+                if (binds & DX::RenderBind_IndexBuffer) indexBuffer = packet.indexBuffer;
+                if (binds & DX::RenderBind_Topology) topology = packet.topology;
+
+                if (state != packet.state || object != packet.object || topology != packet.topology
+                    || vertexBuffer != packet.vertexBuffer || indexBuffer != packet.indexBuffer)
+                {
+                    ++stale;
+                }
+            });
+
+        if (stale > 0 || sortedStats.draws != count || unsortedStats.draws != count)
+        {
+            char buff[128] = {};
+            sprintf_s(buff, "ERROR: RenderQueue (%s) emitted %zu draws with stale state\n", name, stale);
+            OutputDebugStringA(buff);
+            success = false;
+        }
+
+        char buff[512] = {};
+        sprintf_s(buff, "Render queue (%s): %zu draws, sort %.3f ms\n"
+            "    source order: %llu effect, %llu VB, %llu IB, %llu topology binds\n"
+            "    sorted:       %llu effect, %llu VB, %llu IB, %llu topology binds (%llu of %llu per-draw binds eliminated)\n",
+            name, count, timer.GetElapsedMilliseconds(),
+            unsortedStats.stateBinds, unsortedStats.vertexBufferBinds, unsortedStats.indexBufferBinds, unsortedStats.topologyBinds,
+            sortedStats.stateBinds, sortedStats.vertexBufferBinds, sortedStats.indexBufferBinds, sortedStats.topologyBinds,
+            sortedStats.GetEliminated(), sortedStats.draws * 4);
+        OutputDebugStringA(buff);
+
+        return success;
+    }
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    // Packet stream recorded from this test's models, each placed several times.
+    {
+        DX::ModelRenderQueue queue;
+        queue.Begin(m_view, m_projection, c_farz);
+
+        for (int j = 0; j < 4; ++j)
+        {
+            const XMMATRIX offset = XMMatrixTranslation(float(j) - 1.5f, 0.f, float(j));
+            queue.Add(*m_gamelevel, m_gamelevelNormal, XMMatrixMultiply(XMMatrixScaling(0.1f, 0.1f, 0.1f), offset));
+            queue.Add(*m_ship, m_shipNormal, XMMatrixMultiply(XMMatrixScaling(.2f, .2f, .2f), offset));
+            queue.Add(*m_cupMesh, m_cupMeshNormal, offset);
+            queue.Add(*m_tiny, m_tinyNormal, XMMatrixMultiply(XMMatrixScaling(0.005f, 0.005f, 0.005f), offset));
+            queue.Add(*m_dwarf, m_dwarfNormal, offset);
+            queue.Add(*m_lmap, m_lmapNormal, XMMatrixMultiply(XMMatrixScaling(0.01f, 0.01f, 0.01f), offset));
+            queue.Add(*m_nmap, m_nmapNormal, XMMatrixMultiply(XMMatrixScaling(0.05f, 0.05f, 0.05f), offset));
+        }
+
+        if (!TestRenderQueue("models", queue.GetQueue()))
+            success = false;
+    }
+
+    // Synthetic stream: many objects drawing interleaved parts over a small pool of effects and meshes.
+    {
+        constexpr size_t c_objectCount = 25000;
+        constexpr size_t c_partsPerObject = 4;
+        constexpr uint32_t c_effectCount = 48;
+        constexpr uint32_t c_meshCount = 96;
+
+        std::mt19937 generator(0x52515545);
+        std::uniform_int_distribution<uint32_t> effectDist(0, c_effectCount - 1);
+        std::uniform_int_distribution<uint32_t> meshDist(0, c_meshCount - 1);
+        std::uniform_int_distribution<uint32_t> depthDist(0, DX::RenderSortKey::c_MaxDepth);
+        std::uniform_int_distribution<uint32_t> alphaDist(0, 15);
+
+        DX::RenderQueue recorded;
+        recorded.Reserve(c_objectCount * c_partsPerObject);
+        for (size_t j = 0; j < c_objectCount; ++j)
+        {
+            // Objects share a mesh and material set, as instances of the same model would.
+            const uint32_t mesh = meshDist(generator);
+            const uint32_t depth = depthDist(generator);
+            for (uint32_t k = 0; k < c_partsPerObject; ++k)
+            {
+                const uint32_t effect = (mesh + k * 7) % c_effectCount;
+
+                DX::RenderPacket packet = {};
+                packet.state = reinterpret_cast<const void*>(uintptr_t(0x1000) + effect * 64);
+                packet.object = static_cast<uint32_t>(j);
+                packet.topology = 4; // D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST
+                packet.vertexBuffer = 0x10000000ull + uint64_t(mesh) * 0x100000;
+                packet.indexBuffer = 0x20000000ull + uint64_t(mesh) * 0x100000;
+                packet.draw = reinterpret_cast<const void*>(uintptr_t(j * c_partsPerObject + k + 1));
+                packet.key = (alphaDist(generator) == 0)
+                    ? DX::RenderSortKey::MakeTransparent(effect, packet.object, mesh, depth)
+                    : DX::RenderSortKey::MakeOpaque(effect, packet.object, mesh, depth);
+
+                recorded.Push(packet);
+            }
+        }
+
+        if (!TestRenderQueue("synthetic", recorded))
+            success = false;
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
 #pragma endregion
 
 #pragma region Message Handlers
@@ -678,6 +879,10 @@ void Game::CreateDeviceDependentResources()
 
     m_graphicsMemory = std::make_unique<GraphicsMemory>(device);
 
+    m_recorder = std::make_unique<DX::D3D12ParallelCommandRecorder>(
+        DX::D3D12CommandListBackend(device, m_deviceResources->GetCommandQueue()),
+        m_deviceResources->GetBackBufferCount());
+
     m_states = std::make_unique<CommonStates>(device);
 
     const RenderTargetState rtState(m_deviceResources->GetBackBufferFormat(),
@@ -1136,17 +1341,12 @@ void Game::CreateDeviceDependentResources()
             ++j;
         }
         m_instanceCount = static_cast<UINT>(j);
+        m_visibleInstances = std::make_unique<uint32_t[]>(j);
 
-        m_instanceTransforms = std::make_unique<XMFLOAT3X4[]>(j);
-
-        constexpr XMFLOAT3X4 s_identity = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f };
-
-        j = 0;
-        for (float y = -4.f; y <= 4.f; y += 1.f)
+        m_instanceBounds = m_cupInst->meshes.front()->boundingSphere;
+        for (const auto& mit : m_cupInst->meshes)
         {
-            m_instanceTransforms[j] = s_identity;
-            m_instanceTransforms[j]._24 = y;
-            ++j;
+            BoundingSphere::CreateMerged(m_instanceBounds, m_instanceBounds, mit->boundingSphere);
         }
     }
 }
@@ -1161,12 +1361,12 @@ void Game::CreateWindowSizeDependentResources()
 
 #ifdef LH_COORDS
     m_view = XMMatrixLookAtLH(cameraPosition, g_XMZero, XMVectorSet(0, 1, 0, 0));
-    m_projection = XMMatrixPerspectiveFovLH(1, aspect, 1, 15);
+    m_projection = XMMatrixPerspectiveFovLH(1, aspect, 1, c_farz);
     constexpr float fogstart = -5;
     constexpr float fogend = -8;
 #else
     m_view = XMMatrixLookAtRH(cameraPosition, g_XMZero, XMVectorSet(0, 1, 0, 0));
-    m_projection = XMMatrixPerspectiveFovRH(1, aspect, 1, 15);
+    m_projection = XMMatrixPerspectiveFovRH(1, aspect, 1, c_farz);
     constexpr float fogstart = 5;
     constexpr float fogend = 8;
 #endif
@@ -1207,6 +1407,8 @@ void Game::CreateWindowSizeDependentResources()
 #ifdef LOSTDEVICE
 void Game::OnDeviceLost()
 {
+    m_renderQueue.Reset();
+
     m_cup.reset();
     m_cupInst.reset();
     m_cupMesh.reset();
@@ -1253,6 +1455,7 @@ void Game::OnDeviceLost()
 
     m_resourceDescriptors.reset();
     m_states.reset();
+    m_recorder.reset();
     m_graphicsMemory.reset();
 
     m_copyQueue.Reset();
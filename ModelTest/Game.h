@@ -13,6 +13,9 @@
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
 
+#include "ModelRenderQueue.h"
+#include "ParallelRecordingD3D12.h"
+
 constexpr uint32_t c_testTimeout = 15000;
 
 // A basic game implementation that creates a D3D12 device and
@@ -82,10 +85,13 @@ private:
     void Render();
 
     void Clear();
+    void SetFrameState(_In_ ID3D12GraphicsCommandList* commandList);
 
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
+    void UnitTests();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
 
@@ -101,6 +107,7 @@ private:
 
     // DirectXTK Test Objects
     std::unique_ptr<DirectX::GraphicsMemory>        m_graphicsMemory;
+    std::unique_ptr<DX::D3D12ParallelCommandRecorder>   m_recorder;
     std::unique_ptr<DirectX::CommonStates>          m_states;
     std::unique_ptr<DirectX::DescriptorPile>        m_resourceDescriptors;
 
@@ -157,8 +164,11 @@ private:
     DirectX::SimpleMath::Matrix                     m_view;
     DirectX::SimpleMath::Matrix                     m_projection;
 
+    DX::ModelRenderQueue                            m_renderQueue;
+
     UINT                                            m_instanceCount;
-    std::unique_ptr<DirectX::XMFLOAT3X4[]>          m_instanceTransforms;
+    std::unique_ptr<uint32_t[]>                     m_visibleInstances;
+    DirectX::BoundingSphere                         m_instanceBounds;
     DirectX::ModelBone::TransformArray              m_bones;
 
     bool m_spinning;
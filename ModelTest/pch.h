@@ -95,13 +95,16 @@
 #include <cstring>
 #include <cwchar>
 #include <exception>
+#include <functional>
 #include <iterator>
 #include <memory>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <system_error>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 
 #include "CommonStates.h"
 #include "DDSTextureLoader.h"
@@ -12,7 +12,9 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
 #include "FindMedia.h"
+#include "InputEvents.h"
 
 #define GAMMA_CORRECT_RENDERING
 
@@ -23,6 +25,7 @@
 //#define RELY_ON_AUTO_RESET
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -49,6 +52,7 @@ static_assert(std::is_nothrow_move_constructible<Mouse::ButtonStateTracker>::val
 static_assert(std::is_nothrow_move_assignable<Mouse::ButtonStateTracker>::value, "Move Assign.");
 
 Game::Game() noexcept(false) :
+    m_captureInput(false),
     m_ms{},
     m_lastMode(Mouse::MODE_ABSOLUTE),
     m_pitch(0),
@@ -178,6 +182,8 @@ void Game::Initialize(
 
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -268,6 +274,17 @@ void Game::Update(DX::StepTimer const&)
 
     m_tracker.Update(mouse);
 
+    if (m_keyboardButtons.IsKeyPressed(Keyboard::F11))
+        ToggleInputCapture();
+
+    if (m_captureInput)
+    {
+        DX::InputFrame frame = {};
+        frame.keyboard = kb;
+        frame.mouse = mouse;
+        m_recorder.Record(frame);
+    }
+
     using ButtonState = Mouse::ButtonStateTracker::ButtonState;
 
     if (m_tracker.leftButton == ButtonState::PRESSED)
@@ -306,6 +323,22 @@ void Game::Update(DX::StepTimer const&)
 
     PIXEndEvent();
 }
+
+// Live input is only recorded between two toggles; stopping writes the capture out.
+void Game::ToggleInputCapture()
+{
+    m_captureInput = !m_captureInput;
+
+    if (m_captureInput)
+    {
+        m_recorder.Clear();
+        OutputDebugStringA("INFO: Input capture started\n");
+    }
+    else
+    {
+        DX::SaveCapture(m_recorder, L"MouseTest.dxir");
+    }
+}
 #pragma endregion
 
 #pragma region Frame Render
@@ -438,6 +471,264 @@ void Game::Clear()
 }
 #pragma endregion
 
+#pragma region Unit Tests
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    using ButtonState = Mouse::ButtonStateTracker::ButtonState;
+
+    // Synthesize a reproducible mouse stream (fixed seed) with button toggles, motion, and wheel changes.
+    // Timing runs replay a longer stream.
+    const size_t frameCount = g_benchmarks ? 100000 : 5000;
+
+    std::mt19937 generator(0x4d4f5553);
+    std::uniform_int_distribution<int> buttonDist(0, 15);
+    std::uniform_int_distribution<int> deltaDist(-8, 8);
+    std::uniform_int_distribution<int> wheelDist(-1, 1);
+
+    std::vector<Mouse::State> reference;
+    reference.reserve(frameCount);
+
+    DX::InputRecorder recorder;
+    DX::InputFrame frame = {};
+    size_t expectedPressed = 0;
+    size_t expectedReleased = 0;
+    for (size_t j = 0; j < frameCount; ++j)
+    {
+        bool* const buttons[] =
+        {
+            &frame.mouse.leftButton, &frame.mouse.middleButton, &frame.mouse.rightButton,
+            &frame.mouse.xButton1, &frame.mouse.xButton2
+        };
+
+        // Roughly one transition every three frames.
+        const int toggle = buttonDist(generator);
+        if (toggle < 5)
+        {
+            *buttons[toggle] = !*buttons[toggle];
+            if (j > 0)
+            {
+                if (*buttons[toggle])
+                    ++expectedPressed;
+                else
+                    ++expectedReleased;
+            }
+        }
+
+        if (!(j % 1000))
+        {
+            frame.mouse.positionMode = (frame.mouse.positionMode == Mouse::MODE_ABSOLUTE) ? Mouse::MODE_RELATIVE : Mouse::MODE_ABSOLUTE;
+        }
+
+        if (frame.mouse.positionMode == Mouse::MODE_RELATIVE)
+        {
+            frame.mouse.x = deltaDist(generator);
+            frame.mouse.y = deltaDist(generator);
+        }
+        else
+        {
+            frame.mouse.x = std::max(0, frame.mouse.x + deltaDist(generator));
+            frame.mouse.y = std::max(0, frame.mouse.y + deltaDist(generator));
+        }
+
+        frame.mouse.scrollWheelValue += wheelDist(generator) * 120;
+
+        recorder.Record(frame);
+        reference.push_back(frame.mouse);
+    }
+
+    // Round-trip
+    {
+        DX::InputReplayer replayer(recorder.GetStream());
+
+        size_t count = 0;
+        while (replayer.Next(frame))
+        {
+            uint8_t expected[DX::InputStream::c_MouseSize] = {};
+            uint8_t actual[DX::InputStream::c_MouseSize] = {};
+            if (count < reference.size())
+            {
+                DX::InputStream::PackMouse(reference[count], expected);
+                DX::InputStream::PackMouse(frame.mouse, actual);
+            }
+
+            if (count >= reference.size() || memcmp(expected, actual, sizeof(expected)) != 0)
+            {
+                OutputDebugStringA("ERROR: Failed InputReplayer round-trip test\n");
+                success = false;
+                break;
+            }
+            ++count;
+        }
+
+        if (success && count != frameCount)
+        {
+            OutputDebugStringA("ERROR: Failed InputReplayer frame count test\n");
+            success = false;
+        }
+    }
+
+    // Tracker throughput from the replayed stream
+    {
+        DX::InputReplayer replayer(recorder.GetStream());
+        Mouse::ButtonStateTracker tracker;
+
+        size_t pressed = 0;
+        size_t released = 0;
+        bool first = true;
+
+        DX::CpuTimer timer;
+        timer.Start();
+        while (replayer.Next(frame))
+        {
+            tracker.Update(frame.mouse);
+            if (first)
+            {
+                first = false;
+                continue;
+            }
+
+            const ButtonState states[] =
+            {
+                tracker.leftButton, tracker.middleButton, tracker.rightButton,
+                tracker.xButton1, tracker.xButton2
+            };
+
+            for (auto it : states)
+            {
+                if (it == ButtonState::PRESSED)
+                    ++pressed;
+                else if (it == ButtonState::RELEASED)
+                    ++released;
+            }
+        }
+        timer.Stop();
+
+        if (pressed != expectedPressed || released != expectedReleased)
+        {
+            OutputDebugStringA("ERROR: Failed Mouse::ButtonStateTracker replay test\n");
+            success = false;
+        }
+
+        if (g_benchmarks)
+        {
+            char buff[256] = {};
+            sprintf_s(buff, "INFO: Replayed %zu frames (%zu bytes, %.2f bytes/frame) in %.3f ms: %.2f Mframes/s, %.1f ns/frame\n",
+                frameCount, recorder.GetStream().size(),
+                double(recorder.GetStream().size()) / double(frameCount),
+                timer.GetElapsedMilliseconds(),
+                timer.GetRate(frameCount) / 1000000.0,
+                timer.GetElapsedSeconds() * 1e9 / double(frameCount));
+            OutputDebugStringA(buff);
+        }
+    }
+
+    // Event queue edges, motion, and wheel from the replayed stream
+    {
+        DX::InputReplayer replayer(recorder.GetStream());
+        DX::InputEventQueue queue;
+        Mouse::ButtonStateTracker tracker;
+        Mouse::State last = {};
+
+        bool matched = true;
+        int wheel = 0;
+        while (matched && replayer.Next(frame))
+        {
+            queue.Update(frame);
+            tracker.Update(frame.mouse);
+
+            // Relative positions are deltas, so any non-zero value is motion.
+            const bool moved = (frame.mouse.positionMode == Mouse::MODE_RELATIVE)
+                ? (frame.mouse.x != 0 || frame.mouse.y != 0)
+                : (frame.mouse.x != last.x || frame.mouse.y != last.y);
+            const int wheelDelta = frame.mouse.scrollWheelValue - last.scrollWheelValue;
+            last = frame.mouse;
+
+            // 1 = pressed, 2 = released, in InputEvent::MouseButton order.
+            uint8_t edges[5] = {};
+            size_t moves = 0;
+            size_t wheels = 0;
+            for (const auto& evt : queue.GetEvents())
+            {
+                switch (evt.type)
+                {
+                case DX::InputEvent::MouseButtonPressed:
+                case DX::InputEvent::MouseButtonReleased:
+                    if (evt.code >= std::size(edges) || edges[evt.code])
+                    {
+                        matched = false;
+                    }
+                    else
+                    {
+                        edges[evt.code] = (evt.type == DX::InputEvent::MouseButtonPressed) ? 1 : 2;
+                    }
+                    break;
+
+                case DX::InputEvent::MouseMoved:
+                    ++moves;
+                    if (evt.x != frame.mouse.x || evt.y != frame.mouse.y)
+                    {
+                        matched = false;
+                    }
+                    break;
+
+                case DX::InputEvent::MouseWheel:
+                    ++wheels;
+                    wheel += evt.x;
+                    if (evt.x != wheelDelta)
+                    {
+                        matched = false;
+                    }
+                    break;
+
+                default:
+                    // The stream has no keyboard or gamepad input.
+                    matched = false;
+                    break;
+                }
+            }
+
+            const ButtonState states[] =
+            {
+                tracker.leftButton, tracker.middleButton, tracker.rightButton,
+                tracker.xButton1, tracker.xButton2
+            };
+
+            for (size_t j = 0; j < std::size(states); ++j)
+            {
+                const uint8_t expected = (states[j] == ButtonState::PRESSED) ? 1 : ((states[j] == ButtonState::RELEASED) ? 2 : 0);
+                if (edges[j] != expected)
+                {
+                    matched = false;
+                }
+            }
+
+            if (moves != (moved ? 1u : 0u) || wheels != (wheelDelta ? 1u : 0u))
+            {
+                matched = false;
+            }
+        }
+
+        // The wheel deltas add up to the final position since the queue started from zero.
+        if (!matched || wheel != last.scrollWheelValue)
+        {
+            OutputDebugStringA("ERROR: Failed InputEventQueue mouse test\n");
+            success = false;
+        }
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
+#pragma endregion
+
 #pragma region Message Handlers
 // Message handlers
 void Game::OnActivated()
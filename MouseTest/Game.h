@@ -11,6 +11,7 @@
 #pragma once
 
 #include "DirectXTKTest.h"
+#include "InputRecorder.h"
 #include "StepTimer.h"
 
 constexpr uint32_t c_testTimeout = 5000;
@@ -86,6 +87,9 @@ private:
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
+    void UnitTests();
+    void ToggleInputCapture();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
 
@@ -98,6 +102,8 @@ private:
 
     DirectX::Keyboard::KeyboardStateTracker     m_keyboardButtons;
     DirectX::Mouse::ButtonStateTracker          m_tracker;
+    DX::InputRecorder                           m_recorder;
+    bool                                        m_captureInput;
 
     // DirectXTK Test Objects
     std::unique_ptr<DirectX::GraphicsMemory>    m_graphicsMemory;
@@ -96,11 +96,13 @@
 #include <exception>
 #include <iterator>
 #include <memory>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <system_error>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 
 #include "CommonStates.h"
 #include "DDSTextureLoader.h"
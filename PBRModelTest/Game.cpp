@@ -12,6 +12,9 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "FrustumCulling.h"
+#include "InstanceTransforms.h"
+
 // Build for LH vs. RH coords
 //#define LH_COORDS
 
@@ -41,6 +44,9 @@ namespace
     constexpr float row1 = 0.f;
     constexpr float row2 = -1.5f;
 
+    // Farthest view distance used by the projection (either depth direction), for draw sorting.
+    constexpr float c_viewDistance = 15.f;
+
     constexpr XMVECTORF32 c_clearColor = { { { 0.127437726f, 0.300543845f, 0.846873462f, 1.f } } };
 }
 
@@ -383,10 +389,11 @@ void Game::Render()
     }
 
     //--- Draw SDKMESH models ---
+    m_renderQueue.Begin(m_view, m_projection, c_viewDistance);
+
     XMMATRIX local = XMMatrixTranslation(1.5f, row0, 0.f);
     local = XMMatrixMultiply(world, local);
-    Model::UpdateEffectMatrices(m_cubeNormal, local, m_view, m_projection);
-    m_cube->Draw(commandList, m_cubeNormal.cbegin());
+    m_renderQueue.Add(*m_cube, m_cubeNormal, local);
 
     {
         XMMATRIX scale = XMMatrixScaling(0.75f, 0.75f, 0.75f);
@@ -394,8 +401,7 @@ void Game::Render()
         local = XMMatrixMultiply(scale, trans);
         local = XMMatrixMultiply(world, local);
     }
-    Model::UpdateEffectMatrices(m_sphereNormal, local, m_view, m_projection);
-    m_sphere->Draw(commandList, m_sphereNormal.cbegin());
+    m_renderQueue.Add(*m_sphere, m_sphereNormal, local);
 
     {
         XMMATRIX scale = XMMatrixScaling(0.75f, 0.75f, 0.75f);
@@ -403,8 +409,7 @@ void Game::Render()
         local = XMMatrixMultiply(scale, trans);
         local = XMMatrixMultiply(world, local);
     }
-    Model::UpdateEffectMatrices(m_sphere2Normal, local, m_view, m_projection);
-    m_sphere2->Draw(commandList, m_sphere2Normal.cbegin());
+    m_renderQueue.Add(*m_sphere2, m_sphere2Normal, local);
 
     {
         XMMATRIX scale = XMMatrixScaling(0.1f, 0.1f, 0.1f);
@@ -412,31 +417,20 @@ void Game::Render()
         local = XMMatrixMultiply(scale, trans);
         local = XMMatrixMultiply(world, local);
     }
-    Model::UpdateEffectMatrices(m_robotNormal, local, m_view, m_projection);
-    m_robot->Draw(commandList, m_robotNormal.cbegin());
+    m_renderQueue.Add(*m_robot, m_robotNormal, local);
+
+    m_renderQueue.Submit(commandList);
 
     //--- Draw with instancing ---
     local = XMMatrixTranslation(0.f, rowtop, 0.f) * XMMatrixScaling(0.25f, 0.25f, 0.25f);
     {
-        size_t j = 0;
-        for (float x = -16.f; x <= 16.f; x += 4.f)
-        {
-            XMMATRIX m = world * XMMatrixTranslation(x, rowtop, cos(time + float(j) * XM_PIDIV4));
-            XMStoreFloat3x4(&m_instanceTransforms[j], m);
-            ++j;
-        }
-
-        assert(j == m_instanceCount);
+        auto instanceTransform = [&](size_t j) { return world * XMMatrixTranslation(-16.f + 4.f * float(j), rowtop, cos(time + float(j) * XM_PIDIV4)); };
 
-        const size_t instBytes = j * sizeof(XMFLOAT3X4);
+        const DX::FrustumCuller culler(XMMatrixMultiply(XMMatrixMultiply(local, m_view), m_projection));
+        const size_t visibleCount = culler.CullInstances(m_instanceBounds, m_instanceCount, instanceTransform, m_visibleInstances.get());
 
-        GraphicsResource inst = m_graphicsMemory->Allocate(instBytes);
-        memcpy(inst.Memory(), m_instanceTransforms.get(), instBytes);
-
-        D3D12_VERTEX_BUFFER_VIEW vertexBufferInst = {};
-        vertexBufferInst.BufferLocation = inst.GpuAddress();
-        vertexBufferInst.SizeInBytes = static_cast<UINT>(instBytes);
-        vertexBufferInst.StrideInBytes = sizeof(XMFLOAT3X4);
+        auto vertexBufferInst = DX::CreateInstanceTransformBuffer(*m_graphicsMemory, visibleCount,
+            [&](size_t j) { return instanceTransform(m_visibleInstances[j]); });
         commandList->IASetVertexBuffers(1, 1, &vertexBufferInst);
 
         for (const auto& mit : m_cubeInst->meshes)
@@ -455,7 +449,7 @@ void Game::Render()
                 if (imatrices) imatrices->SetMatrices(local, m_view, m_projection);
 
                 effect->Apply(commandList);
-                part->DrawInstanced(commandList, m_instanceCount);
+                part->DrawInstanced(commandList, static_cast<UINT>(visibleCount));
             }
 
             // Skipping alphaMeshParts for this model since we know it's empty...
@@ -511,6 +505,7 @@ void Game::Render()
     PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
     m_deviceResources->Present();
     m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+    m_renderTargetPool->EndFrame();
 
     // Sample stats to update peak values
     std::ignore = m_graphicsMemory->GetStatistics();
@@ -639,6 +634,11 @@ void Game::CreateDeviceDependentResources()
         m_resourceDescriptors->GetCpuHandle(Descriptors::SceneTex),
         m_renderDescriptors->GetCpuHandle(RTDescriptors::HDRScene));
 
+    // The HDR scene target is pooled; idle targets retire after as many frames as there are back buffers.
+    m_renderTargetPool = std::make_unique<DX::RenderTexturePool>(DX::RenderTextureAllocator(device),
+        m_deviceResources->GetBackBufferCount());
+    m_hdrScene->SetPool(m_renderTargetPool.get());
+
     // DirectX SDK Mesh
     m_cube = Model::CreateFromSDKMESH(device, L"BrokenCube.sdkmesh");
     m_sphere = Model::CreateFromSDKMESH(device, L"Sphere.sdkmesh");
@@ -847,17 +847,12 @@ void Game::CreateDeviceDependentResources()
             ++j;
         }
         m_instanceCount = static_cast<UINT>(j);
+        m_visibleInstances = std::make_unique<uint32_t[]>(j);
 
-        m_instanceTransforms = std::make_unique<XMFLOAT3X4[]>(j);
-
-        constexpr XMFLOAT3X4 s_identity = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f };
-
-        j = 0;
-        for (float x = -16.f; x <= 16.f; x += 4.f)
+        m_instanceBounds = m_cubeInst->meshes.front()->boundingSphere;
+        for (const auto& mit : m_cubeInst->meshes)
         {
-            m_instanceTransforms[j] = s_identity;
-            m_instanceTransforms[j]._14 = x;
-            ++j;
+            BoundingSphere::CreateMerged(m_instanceBounds, m_instanceBounds, mit->boundingSphere);
         }
     }
 
@@ -899,6 +894,9 @@ void Game::CreateWindowSizeDependentResources()
     // Set windows size for HDR.
     m_hdrScene->SetWindow(size);
 
+    // DeviceResources waited for the GPU before resizing, so the previous scene target is no longer in use.
+    m_renderTargetPool->Trim();
+
     m_toneMap->SetHDRSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex));
 
 #ifndef XBOX
@@ -910,6 +908,8 @@ void Game::CreateWindowSizeDependentResources()
 #ifdef LOSTDEVICE
 void Game::OnDeviceLost()
 {
+    m_renderQueue.Reset();
+
     m_cube.reset();
     m_cubeInst.reset();
     m_sphere.reset();
@@ -937,6 +937,8 @@ void Game::OnDeviceLost()
     m_toneMapHDR10.reset();
 
     m_hdrScene->ReleaseDevice();
+    m_hdrScene->SetPool(nullptr);
+    m_renderTargetPool.reset();
 
     m_modelResources.reset();
     m_fxFactory.reset();
@@ -13,6 +13,7 @@
 #include "Animation.h"
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
+#include "ModelRenderQueue.h"
 #include "RenderTexture.h"
 
 constexpr uint32_t c_testTimeout = 15000;
@@ -143,6 +144,7 @@ private:
 #endif
 
     std::unique_ptr<DX::RenderTexture>              m_hdrScene;
+    std::unique_ptr<DX::RenderTexturePool>          m_renderTargetPool;
 
     enum Descriptors
     {
@@ -169,8 +171,11 @@ private:
     DirectX::SimpleMath::Matrix             m_view;
     DirectX::SimpleMath::Matrix             m_projection;
 
+    DX::ModelRenderQueue                    m_renderQueue;
+
     UINT                                    m_instanceCount;
-    std::unique_ptr<DirectX::XMFLOAT3X4[]>  m_instanceTransforms;
+    std::unique_ptr<uint32_t[]>             m_visibleInstances;
+    DirectX::BoundingSphere                 m_instanceBounds;
 
     uint32_t                                m_ibl;
     bool                                    m_spinning;
@@ -705,6 +705,7 @@ void Game::Render()
     PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
     m_deviceResources->Present();
     m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+    m_renderTargetPool->EndFrame();
 
     // Sample stats to update peak values
     std::ignore = m_graphicsMemory->GetStatistics();
@@ -825,6 +826,11 @@ void Game::CreateDeviceDependentResources()
         m_resourceDescriptors->GetCpuHandle(Descriptors::SceneTex),
         m_renderDescriptors->GetCpuHandle(RTDescriptors::HDRScene));
 
+    // SetWindow acquires the HDR scene target from this pool and hands the previous size back to it.
+    m_renderTargetPool = std::make_unique<DX::RenderTexturePool>(DX::RenderTextureAllocator(device),
+        m_deviceResources->GetBackBufferCount());
+    m_hdrScene->SetPool(m_renderTargetPool.get());
+
     const RenderTargetState hdrState(m_hdrScene->GetFormat(),
         m_deviceResources->GetDepthBufferFormat());
 
@@ -1103,6 +1109,9 @@ void Game::CreateWindowSizeDependentResources()
     // Set windows size for HDR.
     m_hdrScene->SetWindow(size);
 
+    // Nothing else shares the pool, so free the old size now rather than after the retire frames.
+    m_renderTargetPool->Trim();
+
     m_toneMap->SetHDRSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex));
 
 #ifndef XBOX
@@ -1150,6 +1159,8 @@ void Game::OnDeviceLost()
     m_toneMapHDR10.reset();
 
     m_hdrScene->ReleaseDevice();
+    m_hdrScene->SetPool(nullptr);
+    m_renderTargetPool.reset();
 
     m_resourceDescriptors.reset();
     m_renderDescriptors.reset();
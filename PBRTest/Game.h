@@ -116,6 +116,7 @@ private:
 #endif
 
     std::unique_ptr<DX::RenderTexture>              m_hdrScene;
+    std::unique_ptr<DX::RenderTexturePool>          m_renderTargetPool;
 
     // Test geometry
     UINT                                            m_indexCount;
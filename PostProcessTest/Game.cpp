@@ -21,13 +21,87 @@ using Microsoft::WRL::ComPtr;
 
 namespace
 {
-    constexpr int MaxScene = 27;
+    constexpr int MaxScene = 28;
+
+    // Bloom as in scene 11, with the blur chain at half resolution.
+    constexpr int c_halfResBloomScene = 27;
 
     constexpr float ADVANCE_TIME = 1.f;
     constexpr float INTERACTIVE_TIME = 10.f;
 
     constexpr DXGI_FORMAT c_sdrFormat = DXGI_FORMAT_R10G10B10A2_UNORM;
     constexpr DXGI_FORMAT c_hdrFormat = DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+    // Post-process graph pass kinds
+    enum PostProcessPassKind : uint32_t
+    {
+        PassBloomExtract,
+        PassBloomBlurHorizontal,
+        PassBloomBlurVertical,
+        PassBloomCombine,
+    };
+
+    inline D3D12_RESOURCE_STATES ToResourceState(DX::PostProcessState state) noexcept
+    {
+        return (state == DX::PostProcessState_ShaderResource)
+            ? D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE : D3D12_RESOURCE_STATE_RENDER_TARGET;
+    }
+
+    // Declares the bloom chain of 'scene' (8 to 12, or c_halfResBloomScene) reading 'input' and
+    // writing 'output', with the parameters of each pass appended to 'params' in pass order.
+    void DeclareBloomGraph(DX::PostProcessGraph& graph, int scene, uint32_t width, uint32_t height,
+        uint32_t input, uint32_t output, std::vector<XMFLOAT4>& params)
+    {
+        auto addPass = [&](uint32_t kind, std::initializer_list<uint32_t> inputs, uint32_t target, const XMFLOAT4& values)
+            {
+                graph.AddPass(kind, inputs, target);
+                params.push_back(values);
+            };
+
+        const bool halfResolution = (scene == c_halfResBloomScene);
+        const DX::RenderTargetKey blurKey =
+        {
+            halfResolution ? std::max(width / 2, 1u) : width,
+            halfResolution ? std::max(height / 2, 1u) : height,
+            static_cast<uint32_t>(c_sdrFormat),
+            static_cast<uint32_t>(D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET)
+        };
+
+        const uint32_t extract = graph.CreateTransient(blurKey);
+        addPass(PassBloomExtract, { input }, extract, XMFLOAT4(0.25f, 0.f, 0.f, 0.f));
+
+        switch (scene)
+        {
+        case 8:
+            addPass(PassBloomBlurHorizontal, { extract }, output, XMFLOAT4(4.f, 1.f, 0.f, 0.f));
+            break;
+
+        case 9:
+            addPass(PassBloomBlurVertical, { extract }, output, XMFLOAT4(4.f, 1.f, 0.f, 0.f));
+            break;
+
+        case 10:
+            {
+                const uint32_t horizontal = graph.CreateTransient(blurKey);
+                addPass(PassBloomBlurHorizontal, { extract }, horizontal, XMFLOAT4(4.f, 1.f, 0.f, 0.f));
+                addPass(PassBloomBlurVertical, { horizontal }, output, XMFLOAT4(4.f, 1.f, 0.f, 0.f));
+            }
+            break;
+
+        default:
+            {
+                const uint32_t horizontal = graph.CreateTransient(blurKey);
+                addPass(PassBloomBlurHorizontal, { extract }, horizontal, XMFLOAT4(4.f, 1.f, 0.f, 0.f));
+
+                const uint32_t vertical = graph.CreateTransient(blurKey);
+                addPass(PassBloomBlurVertical, { horizontal }, vertical, XMFLOAT4(4.f, 1.f, 0.f, 0.f));
+
+                addPass(PassBloomCombine, { input, vertical }, output,
+                    (scene == 12) ? XMFLOAT4(2.f, 1.f, 2.f, 0.f) : XMFLOAT4(1.25f, 1.f, 1.f, 1.f));
+            }
+            break;
+        }
+    }
 }
 
 //--------------------------------------------------------------------------------------
@@ -45,6 +119,9 @@ static_assert(std::is_nothrow_move_assignable<ToneMapPostProcess>::value, "Move
 
 Game::Game() noexcept(false)  :
     m_scene(0),
+    m_postProcessGraphScene(-1),
+    m_postProcessInput(0),
+    m_postProcessOutput(0),
     m_delay(0)
 {
 #ifdef XBOX
@@ -113,6 +190,8 @@ void Game::Initialize(
     CreateWindowSizeDependentResources();
 
     m_delay = ADVANCE_TIME;
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -231,10 +310,12 @@ void Game::Render()
 
     auto size = m_deviceResources->GetOutputSize();
 
+    const bool hdrBackground = (m_scene >= 16 && m_scene != c_halfResBloomScene);
+
     m_spriteBatch->Begin(commandList);
     m_spriteBatch->Draw(
-        m_resourceDescriptors->GetGpuHandle(m_scene >= 16 ? Descriptors::HDRTexture : Descriptors::Background),
-        GetTextureSize(m_scene >= 16 ? m_hdrTexture.Get() : m_background.Get()),
+        m_resourceDescriptors->GetGpuHandle(hdrBackground ? Descriptors::HDRTexture : Descriptors::Background),
+        GetTextureSize(hdrBackground ? m_hdrTexture.Get() : m_background.Get()),
         size);
     m_spriteBatch->End();
 
@@ -335,315 +416,28 @@ void Game::Render()
         break;
 
     case 8:
-        {
-            descstr = L"BloomBlur (extract + horizontal)";
-
-            // Pass 1 (scene -> blur1)
-            auto pp = m_basicPostProcess[BasicPostProcess::BloomExtract].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex), m_sceneTex.Get());
-            pp->SetBloomExtractParameter(0.25f);
-
-            auto blurRT1 = m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur1RT);
-            commandList->OMSetRenderTargets(1, &blurRT1, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-
-            // Pass 2 (blur1 -> rt)
-            pp = m_basicPostProcess[BasicPostProcess::BloomBlur].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur1Tex), m_blur1Tex.Get());
-            pp->SetBloomBlurParameters(true, 4.f, 1.f);
-
-            auto rtvDescriptor = m_deviceResources->GetRenderTargetView();
-            commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                    D3D12_RESOURCE_STATE_RENDER_TARGET, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-        }
+        descstr = L"BloomBlur (extract + horizontal)";
+        RenderPostProcessGraph(commandList);
         break;
 
     case 9:
-        {
-            descstr = L"BloomBlur (extract + vertical)";
-
-            // Pass 1 (scene -> blur1)
-            auto pp = m_basicPostProcess[BasicPostProcess::BloomExtract].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex), m_sceneTex.Get());
-            pp->SetBloomExtractParameter(0.25f);
-
-            auto const blurRT1 = m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur1RT);
-            commandList->OMSetRenderTargets(1, &blurRT1, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-
-            // Pass 2 (blur1 -> rt)
-            pp = m_basicPostProcess[BasicPostProcess::BloomBlur].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur1Tex), m_blur1Tex.Get());
-            pp->SetBloomBlurParameters(false, 4.f, 1.f);
-
-            auto const rtvDescriptor = m_deviceResources->GetRenderTargetView();
-            commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                    D3D12_RESOURCE_STATE_RENDER_TARGET, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-        }
+        descstr = L"BloomBlur (extract + vertical)";
+        RenderPostProcessGraph(commandList);
         break;
 
     case 10:
-        {
-            descstr = L"BloomBlur (extract + horz + vert)";
-
-            // Pass 1 (scene -> blur1)
-            auto pp = m_basicPostProcess[BasicPostProcess::BloomExtract].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex), m_sceneTex.Get());
-            pp->SetBloomExtractParameter(0.25f);
-
-            auto const blurRT1 = m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur1RT);
-            commandList->OMSetRenderTargets(1, &blurRT1, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-
-            // Pass 2 (blur1 -> blur2)
-            pp = m_basicPostProcess[BasicPostProcess::BloomBlur].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur1Tex), m_blur1Tex.Get());
-            pp->SetBloomBlurParameters(true, 4.f, 1.f);
-
-            auto const blurRT2 = m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur2RT);
-            commandList->OMSetRenderTargets(1, &blurRT2, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur2Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-
-            // Pass 3 (blur2 -> rt)
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur2Tex), m_blur2Tex.Get());
-            pp->SetBloomBlurParameters(false, 4.f, 1.f);
-
-            auto const rtvDescriptor = m_deviceResources->GetRenderTargetView();
-            commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                CD3DX12_RESOURCE_BARRIER barriers[2] =
-                {
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                        D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur2Tex.Get(),
-                        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                        D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-                };
-                commandList->ResourceBarrier(2, barriers);
-            }
-        }
+        descstr = L"BloomBlur (extract + horz + vert)";
+        RenderPostProcessGraph(commandList);
         break;
 
     case 11:
-        {
-            descstr = L"Bloom";
-
-            // Pass 1 (scene -> blur1)
-            auto pp = m_basicPostProcess[BasicPostProcess::BloomExtract].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex), m_sceneTex.Get());
-            pp->SetBloomExtractParameter(0.25f);
-
-            auto const blurRT1 = m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur1RT);
-            commandList->OMSetRenderTargets(1, &blurRT1, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-
-            // Pass 2 (blur1 -> blur2)
-            pp = m_basicPostProcess[BasicPostProcess::BloomBlur].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur1Tex), m_blur1Tex.Get());
-            pp->SetBloomBlurParameters(true, 4.f, 1.f);
-
-            auto const blurRT2 = m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur2RT);
-            commandList->OMSetRenderTargets(1, &blurRT2, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                CD3DX12_RESOURCE_BARRIER barriers[2] =
-                {
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                    D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur2Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0),
-                };
-                commandList->ResourceBarrier(2, barriers);
-            }
-
-            // Pass 3 (blur2 -> blur1)
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur2Tex), m_blur2Tex.Get());
-            pp->SetBloomBlurParameters(false, 4.f, 1.f);
-
-            commandList->OMSetRenderTargets(1, &blurRT1, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-
-            // Pass 4 (scene+blur1 -> rt)
-            auto dp = m_dualPostProcess[DualPostProcess::BloomCombine].get();
-            dp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex));
-            dp->SetSourceTexture2(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur1Tex));
-            dp->SetBloomCombineParameters(1.25f, 1.f, 1.f, 1.f);
-
-            auto const rtvDescriptor = m_deviceResources->GetRenderTargetView();
-            commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, nullptr);
-
-            dp->Process(commandList);
-
-            {
-                CD3DX12_RESOURCE_BARRIER barriers[2] =
-                {
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                        D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur2Tex.Get(),
-                        D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                        D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-                };
-                commandList->ResourceBarrier(2, barriers);
-            }
-        }
+        descstr = L"Bloom";
+        RenderPostProcessGraph(commandList);
         break;
 
     case 12:
-        {
-            descstr = L"Bloom (Saturated)";
-
-            // Pass 1 (scene -> blur1)
-            auto pp = m_basicPostProcess[BasicPostProcess::BloomExtract].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex), m_sceneTex.Get());
-            pp->SetBloomExtractParameter(0.25f);
-
-            auto const blurRT1 = m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur1RT);
-            commandList->OMSetRenderTargets(1, &blurRT1, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-
-            // Pass 2 (blur1 -> blur2)
-            pp = m_basicPostProcess[BasicPostProcess::BloomBlur].get();
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur1Tex), m_blur1Tex.Get());
-            pp->SetBloomBlurParameters(true, 4.f, 1.f);
-
-            auto const blurRT2 = m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur2RT);
-            commandList->OMSetRenderTargets(1, &blurRT2, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                CD3DX12_RESOURCE_BARRIER barriers[2] =
-                {
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                    D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur2Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0),
-                };
-                commandList->ResourceBarrier(2, barriers);
-            }
-
-            // Pass 3 (blur2 -> blur1)
-            pp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur2Tex), m_blur2Tex.Get());
-            pp->SetBloomBlurParameters(false, 4.f, 1.f);
-
-            commandList->OMSetRenderTargets(1, &blurRT1, FALSE, nullptr);
-
-            pp->Process(commandList);
-
-            {
-                auto const barrier = CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_RENDER_TARGET,
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE, 0);
-                commandList->ResourceBarrier(1, &barrier);
-            }
-
-            // Pass 4 (scene+blur1 -> rt)
-            auto dp = m_dualPostProcess[DualPostProcess::BloomCombine].get();
-            dp->SetSourceTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex));
-            dp->SetSourceTexture2(m_resourceDescriptors->GetGpuHandle(Descriptors::Blur1Tex));
-            dp->SetBloomCombineParameters(2.f, 1.f, 2.f, 0.f);
-
-            auto const rtvDescriptor = m_deviceResources->GetRenderTargetView();
-            commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, nullptr);
-
-            dp->Process(commandList);
-
-            {
-                CD3DX12_RESOURCE_BARRIER barriers[2] =
-                {
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur1Tex.Get(),
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                    D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-                    CD3DX12_RESOURCE_BARRIER::Transition(m_blur2Tex.Get(),
-                    D3D12_RESOURCE_STATE_PIXEL_SHADER_RESOURCE,
-                    D3D12_RESOURCE_STATE_RENDER_TARGET, 0),
-                };
-                commandList->ResourceBarrier(2, barriers);
-            }
-        }
+        descstr = L"Bloom (Saturated)";
+        RenderPostProcessGraph(commandList);
         break;
 
     case 13:
@@ -784,6 +578,11 @@ void Game::Render()
         }
         break;
 
+    case c_halfResBloomScene:
+        descstr = L"Bloom (half-res blur)";
+        RenderPostProcessGraph(commandList);
+        break;
+
         // ST2084 scenarios and MRT are convered in the HDRTest
     }
 
@@ -808,6 +607,16 @@ void Game::Render()
     PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
     m_deviceResources->Present();
     m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+    m_postProcessPool->EndFrame();
+
+    // Drop views of pooled targets that have retired, so a new target in the slot gets fresh views.
+    for (size_t j = 0; j < c_maxPooledTargets; ++j)
+    {
+        if (m_pooledViews[j] && !m_postProcessPool->IsValid(j))
+        {
+            m_pooledViews[j].Reset();
+        }
+    }
 
     // Sample stats to update peak values
     std::ignore = m_graphicsMemory->GetStatistics();
@@ -840,6 +649,416 @@ void Game::Clear()
 
     PIXEndEvent(commandList);
 }
+
+// Declares and compiles the post-process graph for the current scene and output size.
+void Game::BuildPostProcessGraph()
+{
+    auto const size = m_deviceResources->GetOutputSize();
+
+    m_postProcessGraph.Reset();
+    m_postProcessParams.clear();
+
+    m_postProcessInput = m_postProcessGraph.Import(DX::PostProcessState_ShaderResource, DX::PostProcessState_ShaderResource);
+    m_postProcessOutput = m_postProcessGraph.Import(DX::PostProcessState_RenderTarget, DX::PostProcessState_RenderTarget);
+
+    DeclareBloomGraph(m_postProcessGraph, m_scene,
+        static_cast<uint32_t>(size.right - size.left), static_cast<uint32_t>(size.bottom - size.top),
+        m_postProcessInput, m_postProcessOutput, m_postProcessParams);
+
+    m_postProcessGraph.Compile();
+    m_postProcessGraphScene = m_scene;
+}
+
+// Runs the post-process graph from the scene texture into the bound back buffer, backing its
+// physical targets with pooled render targets for this frame.
+void Game::RenderPostProcessGraph(_In_ ID3D12GraphicsCommandList* commandList)
+{
+    if (m_postProcessGraphScene != m_scene)
+    {
+        BuildPostProcessGraph();
+    }
+
+    auto device = m_deviceResources->GetD3DDevice();
+
+    const uint32_t targetCount = m_postProcessGraph.GetPhysicalTargetCount();
+    m_postProcessSlots.resize(targetCount);
+    for (uint32_t j = 0; j < targetCount; ++j)
+    {
+        const size_t slot = m_postProcessPool->Acquire(m_postProcessGraph.GetPhysicalTargetKey(j));
+        if (slot >= c_maxPooledTargets)
+        {
+            throw std::runtime_error("Too many pooled post-process targets");
+        }
+
+        // Views belong to the pool slot; they are only rewritten once the slot's previous target retired.
+        auto resource = m_postProcessPool->Get(slot).resource.Get();
+        if (m_pooledViews[slot].Get() != resource)
+        {
+            device->CreateRenderTargetView(resource, nullptr, m_rtvDescriptors->GetCpuHandle(RTDescriptors::PooledRT + slot));
+            device->CreateShaderResourceView(resource, nullptr, m_resourceDescriptors->GetCpuHandle(Descriptors::PooledTex + slot));
+            m_pooledViews[slot] = resource;
+        }
+
+        m_postProcessSlots[j] = slot;
+    }
+
+    m_postProcessGraph.Execute(
+        [&](const DX::PostProcessBarrier* barriers, uint32_t count)
+        {
+            m_postProcessBarriers.clear();
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                m_postProcessBarriers.push_back(CD3DX12_RESOURCE_BARRIER::Transition(GetPostProcessTarget(barriers[j].resource).resource,
+                    ToResourceState(barriers[j].before), ToResourceState(barriers[j].after), 0));
+            }
+            commandList->ResourceBarrier(count, m_postProcessBarriers.data());
+        },
+        [&](const DX::PostProcessCompiledPass& pass)
+        {
+            const auto target = GetPostProcessTarget(pass.output);
+            commandList->OMSetRenderTargets(1, &target.rtv, FALSE, nullptr);
+
+            const D3D12_VIEWPORT viewport = { 0.f, 0.f, float(target.width), float(target.height), D3D12_MIN_DEPTH, D3D12_MAX_DEPTH };
+            const D3D12_RECT scissorRect = { 0, 0, LONG(target.width), LONG(target.height) };
+            commandList->RSSetViewports(1, &viewport);
+            commandList->RSSetScissorRects(1, &scissorRect);
+
+            const auto source = GetPostProcessTarget(pass.inputs[0]);
+            const XMFLOAT4& params = m_postProcessParams[pass.pass];
+
+            switch (pass.kind)
+            {
+            case PassBloomExtract:
+                {
+                    auto pp = m_basicPostProcess[BasicPostProcess::BloomExtract].get();
+                    pp->SetSourceTexture(source.srv, source.resource);
+                    pp->SetBloomExtractParameter(params.x);
+                    pp->Process(commandList);
+                }
+                break;
+
+            case PassBloomBlurHorizontal:
+            case PassBloomBlurVertical:
+                {
+                    auto pp = m_basicPostProcess[BasicPostProcess::BloomBlur].get();
+                    pp->SetSourceTexture(source.srv, source.resource);
+                    pp->SetBloomBlurParameters(pass.kind == PassBloomBlurHorizontal, params.x, params.y);
+                    pp->Process(commandList);
+                }
+                break;
+
+            case PassBloomCombine:
+                {
+                    auto dp = m_dualPostProcess[DualPostProcess::BloomCombine].get();
+                    dp->SetSourceTexture(source.srv);
+                    dp->SetSourceTexture2(GetPostProcessTarget(pass.inputs[1]).srv);
+                    dp->SetBloomCombineParameters(params.x, params.y, params.z, params.w);
+                    dp->Process(commandList);
+                }
+                break;
+
+            default:
+                throw std::logic_error("Unknown post-process pass");
+            }
+        });
+
+    auto const viewport = m_deviceResources->GetScreenViewport();
+    auto const scissorRect = m_deviceResources->GetScissorRect();
+    commandList->RSSetViewports(1, &viewport);
+    commandList->RSSetScissorRects(1, &scissorRect);
+
+    // Released targets are handed out again next frame in the same order.
+    for (auto slot : m_postProcessSlots)
+    {
+        m_postProcessPool->Release(slot);
+    }
+}
+
+Game::PostProcessTarget Game::GetPostProcessTarget(uint32_t handle)
+{
+    PostProcessTarget target = {};
+
+    if (handle == m_postProcessInput || handle == m_postProcessOutput)
+    {
+        auto const size = m_deviceResources->GetOutputSize();
+        target.width = static_cast<uint32_t>(size.right - size.left);
+        target.height = static_cast<uint32_t>(size.bottom - size.top);
+
+        if (handle == m_postProcessInput)
+        {
+            target.resource = m_sceneTex.Get();
+            target.srv = m_resourceDescriptors->GetGpuHandle(Descriptors::SceneTex);
+            target.rtv = m_rtvDescriptors->GetCpuHandle(RTDescriptors::SceneRT);
+        }
+        else
+        {
+            target.resource = m_deviceResources->GetRenderTarget();
+            target.rtv = m_deviceResources->GetRenderTargetView();
+        }
+        return target;
+    }
+
+    const uint32_t physical = m_postProcessGraph.GetPhysicalTarget(handle);
+    const size_t slot = m_postProcessSlots[physical];
+    auto const& key = m_postProcessGraph.GetPhysicalTargetKey(physical);
+
+    target.resource = m_postProcessPool->Get(slot).resource.Get();
+    target.srv = m_resourceDescriptors->GetGpuHandle(Descriptors::PooledTex + slot);
+    target.rtv = m_rtvDescriptors->GetCpuHandle(RTDescriptors::PooledRT + slot);
+    target.width = key.width;
+    target.height = key.height;
+    return target;
+}
+#pragma endregion
+
+#pragma region Unit Tests
+namespace
+{
+    constexpr uint32_t c_rtFlags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+    void DeclareImports(DX::PostProcessGraph& graph, uint32_t& input, uint32_t& output)
+    {
+        input = graph.Import(DX::PostProcessState_ShaderResource, DX::PostProcessState_ShaderResource);
+        output = graph.Import(DX::PostProcessState_RenderTarget, DX::PostProcessState_RenderTarget);
+    }
+
+    bool CheckStats(const DX::PostProcessGraph& graph, const char* name,
+        uint32_t executedPasses, uint32_t physicalTargets, uint32_t barriers)
+    {
+        auto const& stats = graph.GetStats();
+        if (stats.executedPasses != executedPasses || stats.physicalTargets != physicalTargets || stats.barriers != barriers)
+        {
+            char buff[256] = {};
+            sprintf_s(buff, "ERROR: PostProcessGraph %s executed %u passes, %u targets, %u barriers (expected %u, %u, %u)\n",
+                name, stats.executedPasses, stats.physicalTargets, stats.barriers, executedPasses, physicalTargets, barriers);
+            OutputDebugStringA(buff);
+            return false;
+        }
+        return true;
+    }
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    DX::PostProcessGraph graph;
+    std::vector<XMFLOAT4> params;
+    uint32_t input = 0;
+    uint32_t output = 0;
+
+    // Bloom: the vertical blur reuses the extract target, and each pass needs one batch of barriers.
+    {
+        DeclareImports(graph, input, output);
+        DeclareBloomGraph(graph, 11, 1280, 720, input, output, params);
+        graph.Compile();
+
+        if (!CheckStats(graph, "bloom", 4, 2, 6) || graph.GetStats().barrierBatches != 4)
+        {
+            success = false;
+        }
+
+        if (graph.GetPhysicalTargetKey(0).width != 1280 || params.size() != 4)
+        {
+            OutputDebugStringA("ERROR: PostProcessGraph bloom blur targets are not full resolution\n");
+            success = false;
+        }
+
+        // Every target must be written before it is read, and left as it was found.
+        std::vector<DX::PostProcessState> states(graph.GetPhysicalTargetCount(), DX::PostProcessState_RenderTarget);
+        bool validStates = true;
+        graph.Execute(
+            [&](const DX::PostProcessBarrier* barriers, uint32_t count)
+            {
+                for (uint32_t j = 0; j < count; ++j)
+                {
+                    if (graph.IsImported(barriers[j].resource))
+                        continue;
+
+                    auto& state = states[graph.GetPhysicalTarget(barriers[j].resource)];
+                    validStates &= (state == barriers[j].before);
+                    state = barriers[j].after;
+                }
+            },
+            [&](const DX::PostProcessCompiledPass& pass)
+            {
+                validStates &= graph.IsImported(pass.output) || states[graph.GetPhysicalTarget(pass.output)] == DX::PostProcessState_RenderTarget;
+                for (uint32_t j = 0; j < pass.inputCount; ++j)
+                {
+                    validStates &= graph.IsImported(pass.inputs[j]) || states[graph.GetPhysicalTarget(pass.inputs[j])] == DX::PostProcessState_ShaderResource;
+                }
+            });
+
+        for (auto state : states)
+        {
+            validStates &= (state == DX::PostProcessState_RenderTarget);
+        }
+
+        if (!validStates)
+        {
+            OutputDebugStringA("ERROR: PostProcessGraph bloom barriers do not match resource use\n");
+            success = false;
+        }
+    }
+
+    // The half-resolution variant only shrinks the blur chain.
+    {
+        graph.Reset();
+        params.clear();
+        DeclareImports(graph, input, output);
+        DeclareBloomGraph(graph, c_halfResBloomScene, 1280, 720, input, output, params);
+        graph.Compile();
+
+        if (!CheckStats(graph, "half-res bloom", 4, 2, 6)
+            || graph.GetPhysicalTargetKey(0).width != 640 || graph.GetPhysicalTargetKey(0).height != 360)
+        {
+            OutputDebugStringA("ERROR: PostProcessGraph half-res bloom blur targets are not half resolution\n");
+            success = false;
+        }
+    }
+
+    // A long ping-pong chain still only needs two targets.
+    {
+        graph.Reset();
+        DeclareImports(graph, input, output);
+
+        const DX::RenderTargetKey key = { 1280, 720, static_cast<uint32_t>(c_sdrFormat), c_rtFlags };
+
+        uint32_t source = input;
+        for (uint32_t j = 0; j < 8; ++j)
+        {
+            const uint32_t target = graph.CreateTransient(key);
+            graph.AddPass(PassBloomBlurHorizontal + (j & 1), { source }, target);
+            source = target;
+        }
+        graph.AddPass(PassBloomCombine, { input, source }, output);
+        graph.Compile();
+
+        if (!CheckStats(graph, "ping-pong", 9, 2, 16))
+        {
+            success = false;
+        }
+    }
+
+    // Pass-through folding, pass fusion, and culling of passes nothing reads.
+    {
+        graph.Reset();
+        graph.AddFusion(1, 2, 12);
+        DeclareImports(graph, input, output);
+
+        const DX::RenderTargetKey key = { 1280, 720, static_cast<uint32_t>(c_sdrFormat), c_rtFlags };
+        const uint32_t copy = graph.CreateTransient(key);
+        const uint32_t first = graph.CreateTransient(key);
+        const uint32_t second = graph.CreateTransient(key);
+        const uint32_t unused = graph.CreateTransient(key);
+
+        graph.AddPass(9, { input }, copy, DX::PostProcessPass_PassThrough);
+        graph.AddPass(1, { copy }, first);
+        graph.AddPass(2, { first }, second);
+        graph.AddPass(5, { input }, unused);
+        graph.AddPass(3, { second }, output);
+        graph.Compile();
+
+        auto const& stats = graph.GetStats();
+        if (!CheckStats(graph, "fold/fuse/cull", 2, 1, 2)
+            || stats.foldedPasses != 1 || stats.fusedPasses != 1 || stats.culledPasses != 1)
+        {
+            OutputDebugStringA("ERROR: PostProcessGraph did not fold, fuse, and cull one pass each\n");
+            success = false;
+        }
+
+        bool fusedFromInput = false;
+        graph.Execute([](const DX::PostProcessBarrier*, uint32_t) {},
+            [&](const DX::PostProcessCompiledPass& pass)
+            {
+                if (pass.kind == 12)
+                {
+                    fusedFromInput = (pass.fusedPass == 1 && pass.inputs[0] == input);
+                }
+            });
+
+        if (!fusedFromInput)
+        {
+            OutputDebugStringA("ERROR: PostProcessGraph fused pass does not read the folded input\n");
+            success = false;
+        }
+    }
+
+    // Misuse is rejected.
+    {
+        graph.Reset();
+        DeclareImports(graph, input, output);
+        graph.AddPass(PassBloomExtract, { input }, output);
+
+        try
+        {
+            graph.AddPass(PassBloomExtract, { input }, output);
+            OutputDebugStringA("ERROR: PostProcessGraph allowed a second write of a target\n");
+            success = false;
+        }
+        catch (const std::logic_error&)
+        {
+        }
+
+        try
+        {
+            graph.Execute([](const DX::PostProcessBarrier*, uint32_t) {}, [](const DX::PostProcessCompiledPass&) {});
+            OutputDebugStringA("ERROR: PostProcessGraph executed before it was compiled\n");
+            success = false;
+        }
+        catch (const std::logic_error&)
+        {
+        }
+    }
+
+    // Transient memory of each bloom scene, against the two full-size targets it used to keep.
+    {
+        auto const size = m_deviceResources->GetOutputSize();
+        const auto width = static_cast<uint32_t>(size.right - size.left);
+        const auto height = static_cast<uint32_t>(size.bottom - size.top);
+
+        auto& backend = m_postProcessPool->GetBackend();
+        auto getAllocationSize = [&](const DX::RenderTargetKey& key) { return backend.GetAllocationSize(key); };
+
+        const uint64_t fixedBytes = 2 * getAllocationSize({ width, height, static_cast<uint32_t>(c_sdrFormat), c_rtFlags });
+
+        for (int scene : { 8, 9, 10, 11, 12, c_halfResBloomScene })
+        {
+            graph.Reset();
+            params.clear();
+            DeclareImports(graph, input, output);
+            DeclareBloomGraph(graph, scene, width, height, input, output, params);
+            graph.Compile();
+
+            uint64_t physicalBytes = 0;
+            uint64_t declaredBytes = 0;
+            graph.GetTransientBytes(getAllocationSize, physicalBytes, declaredBytes);
+
+            auto const& stats = graph.GetStats();
+
+            char buff[256] = {};
+            sprintf_s(buff, "Post-process scene %d: %u passes, %u targets, %u barriers in %u batches; %llu KB (%llu KB unaliased, %llu KB fixed)\n",
+                scene, stats.executedPasses, stats.physicalTargets, stats.barriers, stats.barrierBatches,
+                physicalBytes / 1024, declaredBytes / 1024, fixedBytes / 1024);
+            OutputDebugStringA(buff);
+
+            if (physicalBytes > fixedBytes)
+            {
+                OutputDebugStringA("ERROR: PostProcessGraph uses more memory than the fixed targets\n");
+                success = false;
+            }
+        }
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
 #pragma endregion
 
 #pragma region Message Handlers
@@ -1027,6 +1246,10 @@ void Game::CreateDeviceDependentResources()
             }
         }
     }
+
+    m_postProcessPool = std::make_unique<DX::RenderTexturePool>(DX::RenderTextureAllocator(device),
+        m_deviceResources->GetBackBufferCount());
+    m_postProcessGraphScene = -1;
 }
 
 // Allocate all memory resources that change on a window SizeChanged event.
@@ -1062,38 +1285,12 @@ void Game::CreateWindowSizeDependentResources()
         device->CreateShaderResourceView(m_sceneTex.Get(), nullptr, m_resourceDescriptors->GetCpuHandle(Descriptors::SceneTex));
     }
 
-    // Create additional render targets
+    // Bloom targets depend on the output size; stale ones are idle here and can go at once.
+    m_postProcessGraphScene = -1;
+    m_postProcessPool->Trim();
+    for (auto& view : m_pooledViews)
     {
-        D3D12_RESOURCE_DESC desc = CD3DX12_RESOURCE_DESC::Tex2D(c_sdrFormat,
-            width, height,
-            1, 1, 1, 0, D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET);
-
-        D3D12_CLEAR_VALUE clearValue = { c_sdrFormat, {} };
-        memcpy(clearValue.Color, Colors::CornflowerBlue.f, sizeof(clearValue.Color));
-
-        DX::ThrowIfFailed(
-            device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES,
-                &desc,
-                D3D12_RESOURCE_STATE_RENDER_TARGET, &clearValue,
-                IID_GRAPHICS_PPV_ARGS(m_blur1Tex.ReleaseAndGetAddressOf()))
-        );
-
-        device->CreateRenderTargetView(m_blur1Tex.Get(), nullptr,
-            m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur1RT));
-
-        device->CreateShaderResourceView(m_blur1Tex.Get(), nullptr, m_resourceDescriptors->GetCpuHandle(Descriptors::Blur1Tex));
-    
-        DX::ThrowIfFailed(
-            device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_ALLOW_ALL_BUFFERS_AND_TEXTURES,
-                &desc,
-                D3D12_RESOURCE_STATE_RENDER_TARGET, &clearValue,
-                IID_GRAPHICS_PPV_ARGS(m_blur2Tex.ReleaseAndGetAddressOf()))
-        );
-
-        device->CreateRenderTargetView(m_blur2Tex.Get(), nullptr,
-            m_rtvDescriptors->GetCpuHandle(RTDescriptors::Blur2RT));
-
-        device->CreateShaderResourceView(m_blur2Tex.Get(), nullptr, m_resourceDescriptors->GetCpuHandle(Descriptors::Blur2Tex));
+        view.Reset();
     }
 
     // Setup matrices
@@ -1122,8 +1319,12 @@ void Game::OnDeviceLost()
     m_hdrTexture.Reset();
 
     m_sceneTex.Reset();
-    m_blur1Tex.Reset();
-    m_blur2Tex.Reset();
+
+    m_postProcessPool.reset();
+    for (auto& view : m_pooledViews)
+    {
+        view.Reset();
+    }
 
     m_abstractPostProcess.reset();
 
@@ -13,6 +13,11 @@
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
 
+#include "PostProcessGraph.h"
+#include "RenderTexture.h"
+
+#include <vector>
+
 constexpr uint32_t c_testTimeout = 30000;
 
 // A basic game implementation that creates a D3D12 device and
@@ -86,6 +91,21 @@ private:
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
+    void UnitTests();
+
+    struct PostProcessTarget
+    {
+        ID3D12Resource*             resource;
+        D3D12_GPU_DESCRIPTOR_HANDLE srv;
+        D3D12_CPU_DESCRIPTOR_HANDLE rtv;
+        uint32_t                    width;
+        uint32_t                    height;
+    };
+
+    void BuildPostProcessGraph();
+    void RenderPostProcessGraph(_In_ ID3D12GraphicsCommandList* commandList);
+    PostProcessTarget GetPostProcessTarget(uint32_t handle);
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>            m_deviceResources;
 
@@ -124,8 +144,18 @@ private:
 
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_sceneTex;
 
-    Microsoft::WRL::ComPtr<ID3D12Resource>          m_blur1Tex;
-    Microsoft::WRL::ComPtr<ID3D12Resource>          m_blur2Tex;
+    // Bloom chain, with its intermediate targets drawn from a pool
+    static constexpr size_t c_maxPooledTargets = 8;
+
+    std::unique_ptr<DX::RenderTexturePool>          m_postProcessPool;
+    DX::PostProcessGraph                            m_postProcessGraph;
+    int                                             m_postProcessGraphScene;
+    uint32_t                                        m_postProcessInput;
+    uint32_t                                        m_postProcessOutput;
+    std::vector<DirectX::XMFLOAT4>                  m_postProcessParams;
+    std::vector<size_t>                             m_postProcessSlots;
+    std::vector<D3D12_RESOURCE_BARRIER>             m_postProcessBarriers;
+    Microsoft::WRL::ComPtr<ID3D12Resource>          m_pooledViews[c_maxPooledTargets];
 
     std::unique_ptr<DirectX::IPostProcess>          m_abstractPostProcess;
     std::unique_ptr<DirectX::BasicPostProcess>      m_basicPostProcess[DirectX::BasicPostProcess::Effect_Max];
@@ -146,17 +176,15 @@ private:
         Background,
         HDRTexture,
         SceneTex,
-        Blur1Tex,
-        Blur2Tex,
-        Count
+        PooledTex,
+        Count = PooledTex + c_maxPooledTargets
     };
 
     enum RTDescriptors
     {
         SceneRT,
-        Blur1RT,
-        Blur2RT,
-        RTCount
+        PooledRT,
+        RTCount = PooledRT + c_maxPooledTargets
     };
 
     float                                           m_delay;
@@ -12,6 +12,10 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
+#include "FrustumCulling.h"
+#include "InstanceTransforms.h"
+
 #define GAMMA_CORRECT_RENDERING
 #define USE_COPY_QUEUE
 #define USE_COMPUTE_QUEUE
@@ -22,6 +26,7 @@
 #define REVERSEZ
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 
@@ -58,6 +63,7 @@ static_assert(std::is_nothrow_move_constructible<GeometricPrimitive>::value, "Mo
 static_assert(std::is_nothrow_move_assignable<GeometricPrimitive>::value, "Move Assign.");
 
 Game::Game() noexcept(false) :
+    m_tessellation(std::make_unique<DX::GeometricPrimitiveCache>()),
     m_instanceCount(0),
     m_spinning(true),
     m_firstFrame(false),
@@ -145,6 +151,8 @@ void Game::Initialize(
 
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -551,25 +559,13 @@ void Game::Render()
 
     //--- Draw shapes with instancing ------------------------------------------------------
     {
-        size_t j = 0;
-        for (float x = -8.f; x <= 8.f; x += 3.f)
-        {
-            XMMATRIX m = world * XMMatrixTranslation(x, 0.f, cos(time + float(j) * XM_PIDIV4));
-            XMStoreFloat3x4(&m_instanceTransforms[j], m);
-            ++j;
-        }
-
-        assert(j == m_instanceCount);
-
-        const size_t instBytes = j * sizeof(XMFLOAT3X4);
+        auto instanceTransform = [&](size_t j) { return world * XMMatrixTranslation(-8.f + 3.f * float(j), 0.f, cos(time + float(j) * XM_PIDIV4)); };
 
-        GraphicsResource inst = m_graphicsMemory->Allocate(instBytes);
-        memcpy(inst.Memory(), m_instanceTransforms.get(), instBytes);
+        const DX::FrustumCuller culler(XMMatrixMultiply(XMMatrixMultiply(XMMatrixTranslation(0.f, rowtop, 0.f), m_view), m_projection));
+        const size_t visibleCount = culler.CullInstances(m_instanceBounds, m_instanceCount, instanceTransform, m_visibleInstances.get());
 
-        D3D12_VERTEX_BUFFER_VIEW vertexBufferInst = {};
-        vertexBufferInst.BufferLocation = inst.GpuAddress();
-        vertexBufferInst.SizeInBytes = static_cast<UINT>(instBytes);
-        vertexBufferInst.StrideInBytes = sizeof(XMFLOAT3X4);
+        auto vertexBufferInst = DX::CreateInstanceTransformBuffer(*m_graphicsMemory, visibleCount,
+            [&](size_t j) { return instanceTransform(m_visibleInstances[j]); });
         commandList->IASetVertexBuffers(1, 1, &vertexBufferInst);
 
         m_instancedEffect->SetTexture(m_resourceDescriptors->GetGpuHandle(Descriptors::DirectXLogo), m_states->AnisotropicWrap());
@@ -577,7 +573,7 @@ void Game::Render()
         m_instancedEffect->SetWorld(XMMatrixTranslation(0.f, rowtop, 0.f));
 
         m_instancedEffect->Apply(commandList);
-        m_teapot->DrawInstanced(commandList, m_instanceCount);
+        m_teapot->DrawInstanced(commandList, static_cast<UINT>(visibleCount));
     }
 
     PIXEndEvent(commandList);
@@ -623,6 +619,301 @@ void Game::Clear()
 }
 #pragma endregion
 
+#pragma region Unit Tests
+namespace
+{
+    bool SameMesh(const DX::GeometricPrimitiveMesh& mesh,
+        const GeometricPrimitive::VertexCollection& vertices, const GeometricPrimitive::IndexCollection& indices)
+    {
+        return mesh.indices == indices
+            && mesh.vertices.size() == vertices.size()
+            && (vertices.empty() || memcmp(mesh.vertices.data(), vertices.data(), vertices.size() * sizeof(GeometricPrimitive::VertexType)) == 0);
+    }
+
+    // Each tessellated shape over a range of levels; the platonic solids and boxes have none.
+    std::vector<DX::PrimitiveDesc> GetBenchmarkShapes(bool rhcoords)
+    {
+        std::vector<DX::PrimitiveDesc> descs;
+
+        descs.push_back(DX::PrimitiveDesc::Cube(1.f, rhcoords));
+        descs.push_back(DX::PrimitiveDesc::Box(0.5f, 1.f, 1.5f, rhcoords));
+        descs.push_back(DX::PrimitiveDesc::Tetrahedron(0.75f, rhcoords));
+        descs.push_back(DX::PrimitiveDesc::Octahedron(0.75f, rhcoords));
+        descs.push_back(DX::PrimitiveDesc::Dodecahedron(0.5f, rhcoords));
+        descs.push_back(DX::PrimitiveDesc::Icosahedron(0.5f, rhcoords));
+
+        for (uint32_t tessellation : { 8u, 16u, 32u, 64u, 128u })
+        {
+            descs.push_back(DX::PrimitiveDesc::Sphere(1.f, tessellation, rhcoords));
+        }
+
+        for (uint32_t tessellation : { 1u, 2u, 3u, 4u, 5u })
+        {
+            descs.push_back(DX::PrimitiveDesc::GeoSphere(1.f, tessellation, rhcoords));
+        }
+
+        for (uint32_t tessellation : { 8u, 32u, 128u })
+        {
+            descs.push_back(DX::PrimitiveDesc::Cylinder(1.f, 1.f, tessellation, rhcoords));
+            descs.push_back(DX::PrimitiveDesc::Cone(1.f, 1.f, tessellation, rhcoords));
+            descs.push_back(DX::PrimitiveDesc::Torus(1.f, 0.333f, tessellation, rhcoords));
+        }
+
+        for (uint32_t tessellation : { 2u, 4u, 8u, 16u, 32u })
+        {
+            descs.push_back(DX::PrimitiveDesc::Teapot(1.f, tessellation, rhcoords));
+        }
+
+        return descs;
+    }
+
+    // Fails the first 'failures' generations, then generates as GeometricPrimitive does.
+    struct FlakyTessellator
+    {
+        using Mesh = DX::GeometricPrimitiveMesh;
+
+        uint32_t failures = 1;
+
+        Mesh Generate(const DX::PrimitiveDesc& desc)
+        {
+            if (failures > 0)
+            {
+                --failures;
+                throw std::runtime_error("Generate failed");
+            }
+
+            return DX::GeometricPrimitiveTessellator().Generate(desc);
+        }
+    };
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+#ifdef LH_COORDS
+    bool rhcoords = false;
+#else
+    bool rhcoords = true;
+#endif
+
+    DX::GeometricPrimitiveTessellator tessellator;
+
+    // The backend must produce exactly what GeometricPrimitive does, in both handedness.
+    for (bool rh : { true, false })
+    {
+        GeometricPrimitive::VertexCollection vertices;
+        GeometricPrimitive::IndexCollection indices;
+
+        auto check = [&](const DX::PrimitiveDesc& desc)
+            {
+                if (!SameMesh(tessellator.Generate(desc), vertices, indices))
+                {
+                    char buff[128] = {};
+                    sprintf_s(buff, "ERROR: Tessellated %s (%s) differs from GeometricPrimitive\n",
+                        DX::GetPrimitiveShapeName(desc.shape), rh ? "RH" : "LH");
+                    OutputDebugStringA(buff);
+                    success = false;
+                }
+            };
+
+        GeometricPrimitive::CreateCube(vertices, indices, 1.f, rh);
+        check(DX::PrimitiveDesc::Cube(1.f, rh));
+        GeometricPrimitive::CreateBox(vertices, indices, XMFLOAT3(0.5f, 1.f, 1.5f), rh);
+        check(DX::PrimitiveDesc::Box(0.5f, 1.f, 1.5f, rh));
+        GeometricPrimitive::CreateBox(vertices, indices, XMFLOAT3(0.5f, 1.f, 1.5f), rh, true);
+        check(DX::PrimitiveDesc::Box(0.5f, 1.f, 1.5f, rh, true));
+        GeometricPrimitive::CreateSphere(vertices, indices, 1.f, 16, rh);
+        check(DX::PrimitiveDesc::Sphere(1.f, 16, rh));
+        GeometricPrimitive::CreateSphere(vertices, indices, 2.f, 8, rh, true);
+        check(DX::PrimitiveDesc::Sphere(2.f, 8, rh, true));
+        GeometricPrimitive::CreateGeoSphere(vertices, indices, 1.f, 3, rh);
+        check(DX::PrimitiveDesc::GeoSphere(1.f, 3, rh));
+        GeometricPrimitive::CreateCylinder(vertices, indices, 2.f, 0.5f, 32, rh);
+        check(DX::PrimitiveDesc::Cylinder(2.f, 0.5f, 32, rh));
+        GeometricPrimitive::CreateCone(vertices, indices, 0.5f, 2.f, 32, rh);
+        check(DX::PrimitiveDesc::Cone(0.5f, 2.f, 32, rh));
+        GeometricPrimitive::CreateTorus(vertices, indices, 1.f, 0.333f, 32, rh);
+        check(DX::PrimitiveDesc::Torus(1.f, 0.333f, 32, rh));
+        GeometricPrimitive::CreateTetrahedron(vertices, indices, 0.75f, rh);
+        check(DX::PrimitiveDesc::Tetrahedron(0.75f, rh));
+        GeometricPrimitive::CreateOctahedron(vertices, indices, 0.75f, rh);
+        check(DX::PrimitiveDesc::Octahedron(0.75f, rh));
+        GeometricPrimitive::CreateDodecahedron(vertices, indices, 0.5f, rh);
+        check(DX::PrimitiveDesc::Dodecahedron(0.5f, rh));
+        GeometricPrimitive::CreateIcosahedron(vertices, indices, 0.5f, rh);
+        check(DX::PrimitiveDesc::Icosahedron(0.5f, rh));
+        GeometricPrimitive::CreateTeapot(vertices, indices, 1.f, 8, rh);
+        check(DX::PrimitiveDesc::Teapot(1.f, 8, rh));
+    }
+
+    // The scene generates each distinct shape once; the teapot bounds and custom boxes reuse them.
+    if (m_tessellation->GetGenerateCount() != 12 || m_tessellation->GetHitCount() != 3)
+    {
+        char buff[128] = {};
+        sprintf_s(buff, "ERROR: Scene tessellated %llu shapes with %llu reuses (expected 12, 3)\n",
+            m_tessellation->GetGenerateCount(), m_tessellation->GetHitCount());
+        OutputDebugStringA(buff);
+        success = false;
+    }
+
+    // Primitives built from cached geometry share the one generation.
+    {
+        DX::GeometricPrimitiveCache cache;
+        const auto teapotDesc = DX::PrimitiveDesc::Teapot(1.f, 8, rhcoords);
+
+        auto first = DX::CreateGeometricPrimitiveAsync(cache, teapotDesc);
+        auto second = DX::CreateGeometricPrimitiveAsync(cache, teapotDesc);
+
+        const auto firstTeapot = first.get();
+        const auto secondTeapot = second.get();
+        if (!firstTeapot || !secondTeapot || cache.GetGenerateCount() != 1 || cache.GetHitCount() != 1)
+        {
+            OutputDebugStringA("ERROR: CreateGeometricPrimitiveAsync did not reuse the cached teapot\n");
+            success = false;
+        }
+    }
+
+    // Memoization is by shape, parameters, and handedness.
+    {
+        DX::GeometricPrimitiveCache cache;
+
+        auto teapot = cache.Get(DX::PrimitiveDesc::Teapot(1.f, 8, rhcoords));
+        if (cache.Get(DX::PrimitiveDesc::Teapot(1.f, 8, rhcoords)) != teapot
+            || cache.GetGenerateCount() != 1 || cache.GetHitCount() != 1)
+        {
+            OutputDebugStringA("ERROR: TessellationCache regenerated an identical primitive\n");
+            success = false;
+        }
+
+        if (cache.Get(DX::PrimitiveDesc::Teapot(1.f, 8, !rhcoords)) == teapot
+            || cache.Get(DX::PrimitiveDesc::Teapot(1.f, 16, rhcoords)) == teapot
+            || cache.Get(DX::PrimitiveDesc::Teapot(2.f, 8, rhcoords)) == teapot
+            || cache.GetGenerateCount() != 4)
+        {
+            OutputDebugStringA("ERROR: TessellationCache shared geometry between different primitives\n");
+            success = false;
+        }
+
+        // Concurrent requests for one primitive share a single generation.
+        const auto sphereDesc = DX::PrimitiveDesc::Sphere(1.f, 128, rhcoords);
+        std::vector<DX::GeometricPrimitiveCache::MeshPtr> results(8);
+        std::vector<std::thread> threads;
+        for (size_t j = 0; j < results.size(); ++j)
+        {
+            threads.emplace_back([&, j]() { results[j] = cache.Get(sphereDesc); });
+        }
+        for (auto& it : threads)
+        {
+            it.join();
+        }
+
+        if (cache.GetGenerateCount() != 5
+            || std::count(results.cbegin(), results.cend(), results[0]) != ptrdiff_t(results.size()))
+        {
+            OutputDebugStringA("ERROR: TessellationCache generated one primitive more than once under contention\n");
+            success = false;
+        }
+
+        cache.Clear();
+        if (cache.GetMeshCount() != 0 || !results[0] || results[0]->vertices.empty())
+        {
+            OutputDebugStringA("ERROR: TessellationCache Clear released geometry still in use\n");
+            success = false;
+        }
+    }
+
+    // A failed generation reaches the caller and is not cached, so the next request retries.
+    {
+        DX::TessellationCache<FlakyTessellator> cache;
+        const auto desc = DX::PrimitiveDesc::Cube(1.f, rhcoords);
+
+        bool threw = false;
+        try
+        {
+            (void)cache.Get(desc);
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+
+        if (!threw || cache.GetMeshCount() != 0)
+        {
+            OutputDebugStringA("ERROR: TessellationCache kept a failed generation\n");
+            success = false;
+        }
+
+        auto const mesh = cache.Get(desc);
+        if (!mesh || mesh->vertices.size() != 24 || cache.GetGenerateCount() != 1 || cache.GetMeshCount() != 1)
+        {
+            OutputDebugStringA("ERROR: TessellationCache did not retry a failed generation\n");
+            success = false;
+        }
+    }
+
+    // Generation cost per shape and tessellation level (pure CPU).
+    if (g_benchmarks)
+    {
+        constexpr uint32_t c_iterations = 10;
+
+        const auto descs = GetBenchmarkShapes(rhcoords);
+
+        OutputDebugStringA("Tessellation cost per shape:\n");
+        char buff[256] = {};
+        double serial = 0.0;
+        for (auto const& desc : descs)
+        {
+            DX::GeometricPrimitiveMesh mesh;
+            const double ms = DX::MeasureTessellation(tessellator, desc, c_iterations, &mesh);
+            serial += ms;
+
+            sprintf_s(buff, "    %-12s tessellation %3u: %6zu vertices, %6zu indices, %8.4f ms\n",
+                DX::GetPrimitiveShapeName(desc.shape), desc.tessellation, mesh.vertices.size(), mesh.indices.size(), ms);
+            OutputDebugStringA(buff);
+        }
+
+        // The same set through the cache: cold generates on worker threads, warm is all hits.
+        DX::GeometricPrimitiveCache cache;
+        DX::CpuTimer timer;
+
+        timer.Start();
+        cache.Prefetch(descs.data(), descs.size());
+        cache.WaitForPending();
+        timer.Stop();
+        const double cold = timer.GetElapsedMilliseconds();
+
+        timer.Reset();
+        timer.Start();
+        for (auto const& desc : descs)
+        {
+            (void)cache.Get(desc);
+        }
+        timer.Stop();
+        const double warm = timer.GetElapsedMilliseconds();
+
+        sprintf_s(buff, "Tessellation of %zu shapes: %.3f ms serial, %.3f ms on workers, %.3f ms cached\n",
+            descs.size(), serial, cold, warm);
+        OutputDebugStringA(buff);
+
+        if (cache.GetGenerateCount() != descs.size() || cache.GetHitCount() != descs.size())
+        {
+            OutputDebugStringA("ERROR: TessellationCache benchmark set was not memoized\n");
+            success = false;
+        }
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
+#pragma endregion
+
 #pragma region Message Handlers
 // Message handlers
 void Game::OnActivated()
@@ -699,6 +990,29 @@ void Game::CreateDeviceDependentResources()
 
     m_graphicsMemory = std::make_unique<GraphicsMemory>(device);
 
+    // Start the shapes first so they tessellate on worker threads while the effects are created.
+#ifdef LH_COORDS
+    bool rhcoords = false;
+#else
+    bool rhcoords = true;
+#endif
+
+    const auto boxDesc = DX::PrimitiveDesc::Box(1.f / 2.f, 2.f / 2.f, 3.f / 2.f, rhcoords);
+    const auto teapotDesc = DX::PrimitiveDesc::Teapot(1.f, 8, rhcoords);
+
+    auto cube = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::Cube(1.f, rhcoords), device);
+    auto box = DX::CreateGeometricPrimitiveAsync(*m_tessellation, boxDesc, device);
+    auto sphere = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::Sphere(1.f, 16, rhcoords), device);
+    auto geosphere = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::GeoSphere(1.f, 3, rhcoords), device);
+    auto cylinder = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::Cylinder(1.f, 1.f, 32, rhcoords), device);
+    auto cone = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::Cone(1.f, 1.f, 32, rhcoords), device);
+    auto torus = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::Torus(1.f, 0.333f, 32, rhcoords), device);
+    auto teapot = DX::CreateGeometricPrimitiveAsync(*m_tessellation, teapotDesc, device);
+    auto tetra = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::Tetrahedron(0.75f, rhcoords), device);
+    auto octa = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::Octahedron(0.75f, rhcoords), device);
+    auto dodec = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::Dodecahedron(0.5f, rhcoords), device);
+    auto iso = DX::CreateGeometricPrimitiveAsync(*m_tessellation, DX::PrimitiveDesc::Icosahedron(0.5f, rhcoords), device);
+
     m_states = std::make_unique<CommonStates>(device);
 
     // Create effects.
@@ -859,44 +1173,34 @@ void Game::CreateDeviceDependentResources()
             ++j;
         }
         m_instanceCount = static_cast<UINT>(j);
-
-        m_instanceTransforms = std::make_unique<XMFLOAT3X4[]>(j);
-
-        constexpr XMFLOAT3X4 s_identity = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f };
-
-        j = 0;
-        for (float x = -8.f; x <= 8.f; x += 3.f)
-        {
-            m_instanceTransforms[j] = s_identity;
-            m_instanceTransforms[j]._14 = x;
-            ++j;
-        }
+        m_visibleInstances = std::make_unique<uint32_t[]>(j);
     }
 
-    // Create shapes.
-#ifdef LH_COORDS
-    bool rhcoords = false;
-#else
-    bool rhcoords = true;
-#endif
+    // Collect shapes.
+    m_cube = cube.get();
+    m_box = box.get();
+    m_sphere = sphere.get();
+    m_geosphere = geosphere.get();
+    m_cylinder = cylinder.get();
+    m_cone = cone.get();
+    m_torus = torus.get();
+    m_teapot = teapot.get();
+    m_tetra = tetra.get();
+    m_octa = octa.get();
+    m_dodec = dodec.get();
+    m_iso = iso.get();
+
+    // Bounds for culling the instanced teapots.
+    {
+        auto const& vertices = m_tessellation->Get(teapotDesc)->vertices;
 
-    m_cube = GeometricPrimitive::CreateCube(1.f, rhcoords);
-    m_box = GeometricPrimitive::CreateBox(XMFLOAT3(1.f / 2.f, 2.f / 2.f, 3.f / 2.f), rhcoords);
-    m_sphere = GeometricPrimitive::CreateSphere(1.f, 16, rhcoords);
-    m_geosphere = GeometricPrimitive::CreateGeoSphere(1.f, 3, rhcoords);
-    m_cylinder = GeometricPrimitive::CreateCylinder(1.f, 1.f, 32, rhcoords);
-    m_cone = GeometricPrimitive::CreateCone(1.f, 1.f, 32, rhcoords);
-    m_torus = GeometricPrimitive::CreateTorus(1.f, 0.333f, 32, rhcoords);
-    m_teapot = GeometricPrimitive::CreateTeapot(1.f, 8, rhcoords);
-    m_tetra = GeometricPrimitive::CreateTetrahedron(0.75f, rhcoords);
-    m_octa = GeometricPrimitive::CreateOctahedron(0.75f, rhcoords);
-    m_dodec = GeometricPrimitive::CreateDodecahedron(0.5f, rhcoords);
-    m_iso = GeometricPrimitive::CreateIcosahedron(0.5f, rhcoords);
+        BoundingSphere::CreateFromPoints(m_instanceBounds, vertices.size(), &vertices[0].position, sizeof(GeometricPrimitive::VertexType));
+    }
 
     {
-        GeometricPrimitive::VertexCollection customVerts;
-        GeometricPrimitive::IndexCollection customIndices;
-        GeometricPrimitive::CreateBox(customVerts, customIndices, XMFLOAT3(1.f / 2.f, 2.f / 2.f, 3.f / 2.f), rhcoords);
+        auto boxMesh = m_tessellation->Get(boxDesc);
+        GeometricPrimitive::VertexCollection customVerts = boxMesh->vertices;
+        GeometricPrimitive::IndexCollection customIndices = boxMesh->indices;
 
         assert(customVerts.size() == 24);
         assert(customIndices.size() == 36);
@@ -912,9 +1216,9 @@ void Game::CreateDeviceDependentResources()
 
     {
         // Ensure VertexType alias is consistent with alternative client usage
-        GeometricPrimitive::VertexCollection customVerts;
-        GeometricPrimitive::IndexCollection customIndices;
-        GeometricPrimitive::CreateBox(customVerts, customIndices, XMFLOAT3(1.f / 2.f, 2.f / 2.f, 3.f / 2.f), rhcoords);
+        auto boxMesh = m_tessellation->Get(boxDesc);
+        GeometricPrimitive::VertexCollection customVerts = boxMesh->vertices;
+        GeometricPrimitive::IndexCollection customIndices = boxMesh->indices;
 
         assert(customVerts.size() == 24);
         assert(customIndices.size() == 36);
@@ -1071,6 +1375,9 @@ void Game::CreateWindowSizeDependentResources()
     }
 #endif
 
+    m_view = view;
+    m_projection = projection;
+
     m_effect->SetView(view);
     m_effectWireframe->SetView(view);
     m_effectTexture->SetView(view);
@@ -12,6 +12,7 @@
 
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
+#include "TessellationCacheD3D12.h"
 
 constexpr uint32_t c_testTimeout = 15000;
 
@@ -86,6 +87,8 @@ private:
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
+    void UnitTests();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
 
@@ -128,13 +131,20 @@ private:
     std::unique_ptr<DirectX::GeometricPrimitive>    m_customBox;
     std::unique_ptr<DirectX::GeometricPrimitive>    m_customBox2;
 
+    // Generated geometry is device-independent, so it outlives device loss.
+    std::unique_ptr<DX::GeometricPrimitiveCache>    m_tessellation;
+
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_cat;
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_dxLogo;
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_refTexture;
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_normalMap;
 
+    DirectX::SimpleMath::Matrix                     m_view;
+    DirectX::SimpleMath::Matrix                     m_projection;
+
     UINT                                            m_instanceCount;
-    std::unique_ptr<DirectX::XMFLOAT3X4[]>          m_instanceTransforms;
+    std::unique_ptr<uint32_t[]>                     m_visibleInstances;
+    DirectX::BoundingSphere                         m_instanceBounds;
 
     bool m_spinning;
     bool m_firstFrame;
@@ -99,8 +99,10 @@
 #include <stdexcept>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 
 #include "CommonStates.h"
 #include "DDSTextureLoader.h"
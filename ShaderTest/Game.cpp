@@ -12,9 +12,14 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
+#include "FrustumCulling.h"
+#include "InstanceTransforms.h"
+
 #define GAMMA_CORRECT_RENDERING
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -30,6 +35,55 @@ namespace
     constexpr float ortho_width = 6.f;
     constexpr float ortho_height = 6.f;
 
+    // Per-object cubes are laid out left to right, top to bottom. Every row of an effect
+    // collection starts at the same x: the left edge, or just past the previous collection
+    // when the two share a line.
+    struct EffectGrid
+    {
+        float x;
+        float y;
+    };
+
+    // Returns the position of the last of 'count' cubes whose rows start at 'start'.
+    EffectGrid GetEffectGridEnd(size_t count, EffectGrid start) noexcept
+    {
+        const auto perRow = static_cast<size_t>(std::max(std::ceil(ortho_width - start.x), 0.f));
+        assert(count > 0 && perRow > 0);
+
+        const size_t last = count - 1;
+        return { start.x + float(last % perRow), start.y - float(last / perRow) };
+    }
+
+    // Draws one cube per effect following the GetEffectGridEnd layout. 'setup' is called on each
+    // effect before its world matrix is set.
+    template<typename TEffect, typename TFunc>
+    void XM_CALLCONV DrawEffectGrid(
+        _In_ ID3D12GraphicsCommandList* commandList,
+        const std::vector<std::unique_ptr<TEffect>>& effects,
+        EffectGrid start, FXMMATRIX world, UINT indexCount, TFunc&& setup)
+    {
+        float x = start.x;
+        float y = start.y;
+        for (auto& it : effects)
+        {
+            if (x >= ortho_width)
+            {
+                x = start.x;
+                y -= 1.f;
+            }
+
+            // Make sure we are still on screen
+            assert(y > -ortho_height);
+
+            setup(*it);
+            it->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
+            it->Apply(commandList);
+            commandList->DrawIndexedInstanced(indexCount, 1, 0, 0, 0);
+
+            x += 1.f;
+        }
+    }
+
     struct TestVertex
     {
         TestVertex(FXMVECTOR iposition, FXMVECTOR inormal, FXMVECTOR itextureCoordinate, uint32_t icolor)
@@ -107,27 +161,7 @@ namespace
 
     struct TestCompressedVertex
     {
-        TestCompressedVertex(const TestVertex& bn)
-        {
-            position = bn.position;
-            blendIndices = bn.blendIndices;
-
-            XMVECTOR v = XMLoadFloat3(&bn.normal);
-            v = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
-            XMStoreFloat3PK(&this->normal, v);
-
-            v = XMLoadFloat2(&bn.textureCoordinate);
-            XMStoreHalf2(&this->textureCoordinate, v);
-
-            v = XMLoadFloat2(&bn.textureCoordinate2);
-            XMStoreHalf2(&this->textureCoordinate2, v);
-
-            v = XMLoadFloat4(&bn.blendWeight);
-            XMStoreUByteN4(&this->blendWeight, v);
-
-            v = XMLoadFloat4(&bn.color);
-            XMStoreColor(&this->color, v);
-        }
+        TestCompressedVertex() = default;
 
         XMFLOAT3 position;
         XMFLOAT3PK normal;
@@ -140,6 +174,10 @@ namespace
         static const D3D12_INPUT_LAYOUT_DESC InputLayout;
         static const D3D12_INPUT_LAYOUT_DESC InstancedInputLayout;
 
+        // Conversion from TestVertex for DX::VertexCompression::CompressVertices.
+        static constexpr unsigned int CompressionLayoutCount = 7;
+        static const DX::VertexCompression::Attribute CompressionLayout[CompressionLayoutCount];
+
     private:
         static constexpr int InputElementCount = 7;
         static const D3D12_INPUT_ELEMENT_DESC InputElements[InputElementCount];
@@ -185,6 +223,17 @@ namespace
         TestCompressedVertex::InstancedInputElementCount
     };
 
+    const DX::VertexCompression::Attribute TestCompressedVertex::CompressionLayout[] =
+    {
+        { DX::VertexCompression::Format::Copy,                    offsetof(TestVertex, position),           offsetof(TestCompressedVertex, position),           sizeof(XMFLOAT3) },
+        { DX::VertexCompression::Format::Float3_R11G11B10_Signed, offsetof(TestVertex, normal),             offsetof(TestCompressedVertex, normal),             0 },
+        { DX::VertexCompression::Format::Float2_R16G16_Float,     offsetof(TestVertex, textureCoordinate),  offsetof(TestCompressedVertex, textureCoordinate),  0 },
+        { DX::VertexCompression::Format::Float2_R16G16_Float,     offsetof(TestVertex, textureCoordinate2), offsetof(TestCompressedVertex, textureCoordinate2), 0 },
+        { DX::VertexCompression::Format::Copy,                    offsetof(TestVertex, blendIndices),       offsetof(TestCompressedVertex, blendIndices),       sizeof(XMUBYTE4) },
+        { DX::VertexCompression::Format::Float4_R8G8B8A8_UNorm,   offsetof(TestVertex, blendWeight),        offsetof(TestCompressedVertex, blendWeight),        0 },
+        { DX::VertexCompression::Format::Float4_B8G8R8A8_UNorm,   offsetof(TestVertex, color),              offsetof(TestCompressedVertex, color),              0 },
+    };
+
 #ifdef GAMMA_CORRECT_RENDERING
     const XMVECTORF32 c_clearColor = { { { 0.127437726f, 0.300543845f, 0.846873462f, 1.f } } };
 #else
@@ -279,6 +328,8 @@ void Game::Initialize(
     CreateWindowSizeDependentResources();
 
     m_delay = SWAP_TIME;
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -362,6 +413,7 @@ void Game::Render()
 
     // Prepare the command list to render a new frame.
     m_deviceResources->Prepare();
+    m_recorder->BeginFrame(m_deviceResources->GetCurrentFrameIndex());
     Clear();
 
     auto commandList = m_deviceResources->GetCommandList();
@@ -381,25 +433,11 @@ void Game::Render()
     case Render_Instanced:
     case Render_CompressedInstanced:
     {
-        size_t j = 0;
-        for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
-        {
-            XMMATRIX m = world * XMMatrixTranslation(x, 0.f, 0.f);
-            XMStoreFloat3x4(&m_instanceTransforms[j], m);
-            ++j;
-        }
-
-        assert(j == m_instanceCount);
-
-        const size_t instBytes = j * sizeof(XMFLOAT3X4);
-
-        GraphicsResource inst = m_graphicsMemory->Allocate(instBytes);
-        memcpy(inst.Memory(), m_instanceTransforms.get(), instBytes);
+        const float left = -ortho_width + 0.5f;
 
         D3D12_VERTEX_BUFFER_VIEW vertexBuffers[2] = { (m_renderMode == Render_CompressedInstanced) ? m_vertexBufferViewBn : m_vertexBufferView };
-        vertexBuffers[1].BufferLocation = inst.GpuAddress();
-        vertexBuffers[1].SizeInBytes = static_cast<UINT>(instBytes);
-        vertexBuffers[1].StrideInBytes = sizeof(XMFLOAT3X4);
+        vertexBuffers[1] = DX::CreateInstanceTransformBuffer(*m_graphicsMemory, m_instanceCount,
+            [&](size_t j) { return world * XMMatrixTranslation(left + float(j), 0.f, 0.f); });
         commandList->IASetVertexBuffers(0, 2, vertexBuffers);
     }
     break;
@@ -489,351 +527,783 @@ void Game::Render()
     }
     else
     {
-        bool showCompressed = (m_renderMode == Render_Compressed);
+        const bool showCompressed = (m_renderMode == Render_Compressed);
+        const D3D12_VERTEX_BUFFER_VIEW* vertexBuffer = (showCompressed) ? &m_vertexBufferViewBn : &m_vertexBufferView;
 
-        // BasicEffect
+        XMMATRIX bones[4] =
         {
-            auto it = (showCompressed) ? m_basicBn.cbegin() : m_basic.cbegin();
-            auto eit = (showCompressed) ? m_basicBn.cend() : m_basic.cend();
-            assert(it != eit);
+            XMMatrixIdentity(),
+            XMMatrixIdentity(),
+            XMMatrixIdentity(),
+            XMMatrixIdentity(),
+        };
+
+        auto noSetup = [](IEffect&) {};
+        auto setBones = [&](IEffectSkinning& effect) { effect.SetBoneTransforms(bones, 4); };
+
+        // Lay out every effect collection up front, then record each one into its own command
+        // list on a worker thread. Each collection owns its effects, so the segments are independent.
+        struct Segment
+        {
+            EffectGrid start;
+            const D3D12_VERTEX_BUFFER_VIEW* vertexBuffer;
+            std::function<void(ID3D12GraphicsCommandList*, EffectGrid)> draw;
+        };
 
-            for (; y > -ortho_height; y -= 1.f)
-            {
-                for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
-                {
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+        std::vector<Segment> segments;
+        segments.reserve(11);
 
-                    ++it;
-                    if (it == eit)
-                        break;
-                }
+        EffectGrid cursor = { -ortho_width + 0.5f, y };
+        auto addSegment = [&](size_t count, const D3D12_VERTEX_BUFFER_VIEW* vb, bool sharedLine, auto&& draw)
+        {
+            segments.push_back({ cursor, vb, std::forward<decltype(draw)>(draw) });
 
-                if (it == eit)
-                    break;
-            }
+            // The next collection starts on a new row, or just past this one on the same row.
+            const EffectGrid last = GetEffectGridEnd(count, cursor);
+            cursor = (sharedLine) ? EffectGrid{ last.x + 1.f, last.y } : EffectGrid{ -ortho_width + 0.5f, last.y - 1.f };
+        };
 
-            // Make sure we drew all the effects
-            assert(it == eit);
+        auto grid = [&](const auto& effects, auto& setup)
+        {
+            return [&effects, &setup, &world, this](ID3D12GraphicsCommandList* segmentList, EffectGrid start)
+            {
+                DrawEffectGrid(segmentList, effects, start, world, m_indexCount, setup);
+            };
+        };
 
-            y -= 1.f;
-        }
+        // BasicEffect
+        auto& basic = (showCompressed) ? m_basicBn : m_basic;
+        addSegment(basic.size(), vertexBuffer, false, grid(basic, noSetup));
 
         // SkinnedEffect
-        {
-            auto it = (showCompressed) ? m_skinningBn.cbegin() : m_skinning.cbegin();
-            auto eit = (showCompressed) ? m_skinningBn.cend() : m_skinning.cend();
-            assert(it != eit);
+        auto& skinning = (showCompressed) ? m_skinningBn : m_skinning;
+        addSegment(skinning.size(), vertexBuffer, false, grid(skinning, setBones));
 
-            XMMATRIX bones[4] =
-            {
-                XMMatrixIdentity(),
-                XMMatrixIdentity(),
-                XMMatrixIdentity(),
-                XMMatrixIdentity(),
-            };
+        // EnvironmentMapEffect
+        auto& envmap = (showCompressed) ? m_envmapBn : m_envmap;
+        addSegment(envmap.size(), vertexBuffer, false, grid(envmap, noSetup));
 
-            for (; y > -ortho_height; y -= 1.f)
+        // DualTextureEffect
+        addSegment(m_dual.size(), &m_vertexBufferView, false, grid(m_dual, noSetup));
+
+        // AlphaTestEffect
+        addSegment(m_alphTest.size(), &m_vertexBufferView, false, grid(m_alphTest, noSetup));
+
+        // NormalMapEffect, with SkinnedNormalMapEffect on the same line
+        auto& normalMap = (showCompressed) ? m_normalMapBn : m_normalMap;
+        addSegment(normalMap.size(), vertexBuffer, true, grid(normalMap, noSetup));
+
+        auto& skinningNormalMap = (showCompressed) ? m_skinningNormalMapBn : m_skinningNormalMap;
+        addSegment(skinningNormalMap.size(), vertexBuffer, false, grid(skinningNormalMap, noSetup));
+
+        // PBREffect, with SkinnedPBREffect on the same line
+        auto& pbr = (showCompressed) ? m_pbrBn : m_pbr;
+        addSegment(pbr.size(), vertexBuffer, true, grid(pbr, noSetup));
+
+        auto& skinningPbr = (showCompressed) ? m_skinningPbrBn : m_skinningPbr;
+        addSegment(skinningPbr.size(), vertexBuffer, false, grid(skinningPbr, noSetup));
+
+        // DebugEffect
+        auto& debug = (showCompressed) ? m_debugBn : m_debug;
+        addSegment(debug.size(), vertexBuffer, false, grid(debug, noSetup));
+
+        m_recorder->Record(segments.size(), [&](size_t index, const DX::D3D12CommandListBackend::CommandList& list)
             {
-                for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
-                {
-                    (*it)->SetBoneTransforms(bones, 4);
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                auto segmentList = list.Get();
+                const Segment& segment = segments[index];
 
-                    ++it;
-                    if (it == eit)
-                        break;
-                }
+                PIXBeginEvent(segmentList, PIX_COLOR_DEFAULT, L"Render segment");
 
-                if (it == eit)
-                    break;
-            }
+                SetFrameState(segmentList);
+                segmentList->IASetVertexBuffers(0, 1, segment.vertexBuffer);
+                segmentList->IASetIndexBuffer(&m_indexBufferView);
+                segmentList->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
-            // Make sure we drew all the effects
-            assert(it == eit);
+                segment.draw(segmentList, segment.start);
 
-            y -= 1.f;
-        }
+                PIXEndEvent(segmentList);
+            });
+    }
 
-        // EnvironmentMapEffect
+    PIXEndEvent(commandList);
+
+    // The clear executes first, then any segments recorded on worker threads in order.
+    DX::SubmitParallelCommandLists(*m_recorder, commandList, m_deviceResources->GetCommandAllocator());
+
+    // Show the new frame.
+    PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
+    m_deviceResources->Present();
+    m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+    m_renderTargetPool->EndFrame();
+
+    // Sample stats to update peak values
+    std::ignore = m_graphicsMemory->GetStatistics();
+
+    PIXEndEvent(m_deviceResources->GetCommandQueue());
+}
+
+// Helper method to clear the back buffers.
+void Game::Clear()
+{
+    auto commandList = m_deviceResources->GetCommandList();
+    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Clear");
+
+    // Clear the views.
+    auto const rtvDescriptor = m_deviceResources->GetRenderTargetView();
+    auto const dsvDescriptor = m_deviceResources->GetDepthStencilView();
+
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvDescriptors[2] = { rtvDescriptor, m_renderDescriptors->GetCpuHandle(RTDescriptors::RTVelocityBuffer) };
+    commandList->OMSetRenderTargets(2, rtvDescriptors, FALSE, &dsvDescriptor);
+    commandList->ClearRenderTargetView(rtvDescriptor, c_clearColor, 0, nullptr);
+    commandList->ClearDepthStencilView(dsvDescriptor, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+
+    // Set the viewport and scissor rect.
+    auto const viewport = m_deviceResources->GetScreenViewport();
+    auto const scissorRect = m_deviceResources->GetScissorRect();
+    commandList->RSSetViewports(1, &viewport);
+    commandList->RSSetScissorRects(1, &scissorRect);
+
+    PIXEndEvent(commandList);
+}
+
+// Helper method to bind the frame's targets and heaps on a command list recorded after Clear.
+void Game::SetFrameState(_In_ ID3D12GraphicsCommandList* commandList)
+{
+    ID3D12DescriptorHeap* heaps[] = { m_resourceDescriptors->Heap(), m_states->Heap() };
+    commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+
+    auto const dsvDescriptor = m_deviceResources->GetDepthStencilView();
+    D3D12_CPU_DESCRIPTOR_HANDLE rtvDescriptors[2] = { m_deviceResources->GetRenderTargetView(), m_renderDescriptors->GetCpuHandle(RTDescriptors::RTVelocityBuffer) };
+    commandList->OMSetRenderTargets(2, rtvDescriptors, FALSE, &dsvDescriptor);
+
+    auto const viewport = m_deviceResources->GetScreenViewport();
+    auto const scissorRect = m_deviceResources->GetScissorRect();
+    commandList->RSSetViewports(1, &viewport);
+    commandList->RSSetScissorRects(1, &scissorRect);
+}
+#pragma endregion
+
+#pragma region Unit Tests
+namespace
+{
+    // The original one-vertex-at-a-time conversion, kept as the reference for the stream path.
+    void CompressVertexReference(const TestVertex& bn, TestCompressedVertex& cv)
+    {
+        cv.position = bn.position;
+        cv.blendIndices = bn.blendIndices;
+
+        XMVECTOR v = XMLoadFloat3(&bn.normal);
+        v = XMVectorMultiplyAdd(v, g_XMOneHalf, g_XMOneHalf);
+        XMStoreFloat3PK(&cv.normal, v);
+
+        v = XMLoadFloat2(&bn.textureCoordinate);
+        XMStoreHalf2(&cv.textureCoordinate, v);
+
+        v = XMLoadFloat2(&bn.textureCoordinate2);
+        XMStoreHalf2(&cv.textureCoordinate2, v);
+
+        v = XMLoadFloat4(&bn.blendWeight);
+        XMStoreUByteN4(&cv.blendWeight, v);
+
+        v = XMLoadFloat4(&bn.color);
+        XMStoreColor(&cv.color, v);
+    }
+
+    // Command lists that only remember what was recorded into them, so DX::ParallelCommandRecorder
+    // can be exercised without a device. Any misuse of the list/allocator rules is counted.
+    class MockCommandListBackend
+    {
+    public:
+        struct MockAllocator
         {
-            auto it = (showCompressed) ? m_envmapBn.cbegin() : m_envmap.cbegin();
-            auto eit = (showCompressed) ? m_envmapBn.cend() : m_envmap.cend();
-            assert(it != eit);
+            std::atomic<int> openLists;
+        };
 
-            for (; y > -ortho_height; y -= 1.f)
-            {
-                for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
-                {
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+        struct MockList
+        {
+            MockAllocator* allocator;
+            bool open;
+            std::vector<uint32_t> commands;
+        };
 
-                    ++it;
-                    if (it == eit)
-                        break;
-                }
+        using Allocator = MockAllocator*;
+        using CommandList = MockList*;
 
-                if (it == eit)
-                    break;
-            }
+        MockCommandListBackend() : m_state(std::make_unique<State>()) {}
 
-            // Make sure we drew all the effects
-            assert(it == eit);
+        Allocator CreateAllocator()
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            m_state->allocators.emplace_back();
+            m_state->allocators.back().openLists = 0;
+            return &m_state->allocators.back();
+        }
 
-            y -= 1.f;
+        CommandList CreateCommandList(const Allocator& allocator)
+        {
+            std::lock_guard<std::mutex> lock(m_state->mutex);
+            m_state->lists.push_back({ allocator, false, {} });
+            return &m_state->lists.back();
         }
 
-        commandList->IASetVertexBuffers(0, 1, &m_vertexBufferView);
+        void ResetAllocator(const Allocator& allocator)
+        {
+            if (allocator->openLists != 0)
+                ++m_state->violations;
+        }
 
-        // DualTextureEffect
+        void Begin(const CommandList& list, const Allocator& allocator)
         {
-            auto it = m_dual.begin();
-            assert(it != m_dual.end());
+            if (list->open || allocator->openLists.fetch_add(1) != 0)
+                ++m_state->violations;
 
-            for (; y > -ortho_height; y -= 1.f)
-            {
-                for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
-                {
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+            list->open = true;
+            list->allocator = allocator;
+            list->commands.clear();
+        }
 
-                    ++it;
-                    if (it == m_dual.cend())
-                        break;
-                }
+        void End(const CommandList& list)
+        {
+            if (!list->open)
+                ++m_state->violations;
 
-                if (it == m_dual.cend())
-                    break;
+            list->open = false;
+            list->allocator->openLists.fetch_sub(1);
+        }
+
+        void Execute(const CommandList* lists, size_t count)
+        {
+            for (size_t j = 0; j < count; ++j)
+            {
+                if (lists[j]->open)
+                    ++m_state->violations;
+
+                m_state->executed.insert(m_state->executed.end(), lists[j]->commands.cbegin(), lists[j]->commands.cend());
             }
+        }
 
-            // Make sure we drew all the effects
-            assert(it == m_dual.cend());
+        size_t GetViolations() const noexcept { return m_state->violations; }
 
-            y -= 1.f;
+        size_t GetOpenLists() const
+        {
+            size_t open = 0;
+            for (auto& list : m_state->lists)
+            {
+                if (list.open)
+                    ++open;
+            }
+            return open;
         }
 
-        // AlphaTestEffect
+        // Command words in submission order since the last call.
+        std::vector<uint32_t> TakeExecuted() { return std::exchange(m_state->executed, {}); }
+
+    private:
+        struct State
         {
-            auto it = m_alphTest.begin();
-            assert(it != m_alphTest.end());
+            std::mutex                  mutex;
+            std::deque<MockAllocator>   allocators;
+            std::deque<MockList>        lists;
+            std::atomic<size_t>         violations;
+            std::vector<uint32_t>       executed;
 
-            for (; y > -ortho_height; y -= 1.f)
-            {
-                for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
-                {
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+            State() : violations(0) {}
+        };
 
-                    ++it;
-                    if (it == m_alphTest.cend())
-                        break;
-                }
+        std::unique_ptr<State> m_state;
+    };
 
-                if (it == m_alphTest.cend())
-                    break;
-            }
+    using MockRecorder = DX::ParallelCommandRecorder<MockCommandListBackend>;
 
-            // Make sure we drew all the effects
-            assert(it == m_alphTest.cend());
+    constexpr uint32_t c_segmentTag = 0x10000;
 
-            y -= 1.f;
+    // Stands in for effect setup and draw encoding: some CPU work per draw, then a command word
+    // identifying the segment and draw.
+    void RecordMockSegment(size_t segment, MockCommandListBackend::MockList* list, size_t drawCount, uint32_t work)
+    {
+        for (size_t j = 0; j < drawCount; ++j)
+        {
+            uint32_t state = static_cast<uint32_t>(segment * 7919 + j);
+            for (uint32_t k = 0; k < work; ++k)
+            {
+                state = state * 1664525u + 1013904223u;
+            }
+
+            // The high bit of 'state' never reaches the command word, it only keeps the work alive.
+            list->commands.push_back(static_cast<uint32_t>(segment * c_segmentTag + j) | (state & 0x80000000u));
         }
+    }
+
+    // Frames of segments through 'recorder', checking the submission matches serial recording.
+    bool TestParallelRecorder(MockRecorder& recorder, size_t frames, size_t segmentCount, size_t drawCount, uint32_t work, double& elapsedMs)
+    {
+        bool success = true;
+
+        DX::CpuTimer timer;
+        elapsedMs = 0.0;
 
-        commandList->IASetVertexBuffers(0, 1, (showCompressed) ? &m_vertexBufferViewBn : &m_vertexBufferView);
+        MockCommandListBackend::MockList first = { nullptr, false, { 0xFFFFFFFFu } };
+        const MockRecorder::CommandList firstList = &first;
 
-        // NormalMapEffect
-        float lastx = 0.f;
+        for (size_t frame = 0; frame < frames; ++frame)
         {
-            auto it = (showCompressed) ? m_normalMapBn.cbegin() : m_normalMap.cbegin();
-            auto eit = (showCompressed) ? m_normalMapBn.cend() : m_normalMap.cend();
-            assert(it != eit);
+            timer.Reset();
+            timer.Start();
 
-            for (; y > -ortho_height; y -= 1.f)
-            {
-                float x;
-                for (x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
+            recorder.BeginFrame(frame % 3);
+            recorder.Record(segmentCount, [&](size_t segment, const MockRecorder::CommandList& list)
                 {
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                    RecordMockSegment(segment, list, drawCount, work);
+                });
+            recorder.Submit(&firstList);
 
-                    ++it;
-                    if (it == eit)
-                        break;
-                }
-                lastx = x;
+            timer.Stop();
+            elapsedMs += timer.GetElapsedMilliseconds();
 
-                if (it == eit)
-                    break;
-            }
+            const std::vector<uint32_t> executed = recorder.GetBackend().TakeExecuted();
 
-            // Make sure we drew all the effects
-            assert(it == eit);
+            bool ordered = (executed.size() == segmentCount * drawCount + 1) && (executed[0] == 0xFFFFFFFFu);
+            for (size_t j = 1; ordered && j < executed.size(); ++j)
+            {
+                ordered = ((executed[j] & 0x7FFFFFFFu) == static_cast<uint32_t>(((j - 1) / drawCount) * c_segmentTag + (j - 1) % drawCount));
+            }
 
-            // SkinnedNormalMapEffect should be on same line...
+            if (!ordered)
+            {
+                char buff[128] = {};
+                sprintf_s(buff, "ERROR: ParallelCommandRecorder submitted frame %zu out of order\n", frame);
+                OutputDebugStringA(buff);
+                success = false;
+                break;
+            }
         }
 
-        // SkinnedNormalMapEffect
+        if (recorder.GetBackend().GetViolations() > 0)
         {
-            auto it = (showCompressed) ? m_skinningNormalMapBn.cbegin() : m_skinningNormalMap.cbegin();
-            auto eit = (showCompressed) ? m_skinningNormalMapBn.cend() : m_skinningNormalMap.cend();
-            assert(it != eit);
+            OutputDebugStringA("ERROR: ParallelCommandRecorder misused a command list or allocator\n");
+            success = false;
+        }
 
-            for (; y > -ortho_height; y -= 1.f)
+        return success;
+    }
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    std::mt19937 generator(0x56455254);
+    std::uniform_real_distribution<float> unitDist(-1.f, 1.f);
+    std::uniform_real_distribution<float> uvDist(0.f, 1.f);
+    std::uniform_int_distribution<uint32_t> colorDist(0, UINT32_MAX);
+
+    auto makeVertices = [&](size_t count)
+    {
+        std::vector<TestVertex> vertices;
+        vertices.reserve(count);
+        for (size_t j = 0; j < count; ++j)
+        {
+            XMVECTOR normal;
+            do
             {
-                for (float x = lastx + 1.f; x < ortho_width; x += 1.f)
-                {
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                normal = XMVectorSet(unitDist(generator), unitDist(generator), unitDist(generator), 0.f);
+            } while (XMVectorGetX(XMVector3LengthSq(normal)) < 1e-4f);
+            normal = XMVector3Normalize(normal);
 
-                    ++it;
-                    if (it == eit)
-                        break;
-                }
+            const XMVECTOR position = XMVectorSet(unitDist(generator), unitDist(generator), unitDist(generator), 0.f);
+            const XMVECTOR uv = XMVectorSet(uvDist(generator), uvDist(generator), 0.f, 0.f);
 
-                if (it == eit)
-                    break;
-            }
+            vertices.emplace_back(position, normal, uv, colorDist(generator));
 
-            // Make sure we drew all the effects
-            assert(it == eit);
+            auto& vert = vertices.back();
+            const float w = uvDist(generator);
+            vert.blendWeight = XMFLOAT4(w, 1.f - w, 0.f, 0.f);
+        }
+        return vertices;
+    };
 
-            y -= 1.f;
+    DX::CpuTimer timer;
+
+    {
+        // Spans several chunks and ends mid-way through a group of four.
+        constexpr size_t c_vertexCount = 4099;
+
+        const std::vector<TestVertex> vertices = makeVertices(c_vertexCount);
+
+        std::vector<TestCompressedVertex> reference(c_vertexCount);
+        for (size_t j = 0; j < c_vertexCount; ++j)
+        {
+            CompressVertexReference(vertices[j], reference[j]);
         }
 
-        // PBREffect
-        lastx = 0.f;
+        std::vector<TestCompressedVertex> compressed(c_vertexCount);
+        float errors[TestCompressedVertex::CompressionLayoutCount] = {};
+        DX::VertexCompression::CompressVertices(
+            TestCompressedVertex::CompressionLayout, TestCompressedVertex::CompressionLayoutCount,
+            compressed.data(), sizeof(TestCompressedVertex),
+            vertices.data(), sizeof(TestVertex),
+            c_vertexCount, errors);
+
+        if (memcmp(reference.data(), compressed.data(), c_vertexCount * sizeof(TestCompressedVertex)) != 0)
         {
-            auto it = (showCompressed) ? m_pbrBn.cbegin() : m_pbr.cbegin();
-            auto eit = (showCompressed) ? m_pbrBn.cend() : m_pbr.cend();
-            assert(it != eit);
+            OutputDebugStringA("ERROR: CompressVertices output does not match per-vertex reference\n");
+            success = false;
+        }
 
-            for (; y > -ortho_height; y -= 1.f)
-            {
-                float x;
-                for (x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
-                {
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+        // Per-attribute error bounds
+        static const float s_bounds[TestCompressedVertex::CompressionLayoutCount] =
+        {
+            0.f,        // position (copy)
+            0.035f,     // normal R11G11B10 (5-bit mantissa for Z, biased into [0,1])
+            0.001f,     // texcoord half
+            0.001f,     // texcoord2 half (0..3)
+            0.f,        // blend indices (copy)
+            1.f / 255.f + 1e-6f,
+            1.f / 255.f + 1e-6f,
+        };
+
+        static const char* s_names[TestCompressedVertex::CompressionLayoutCount] =
+        {
+            "position", "normal", "texcoord", "texcoord2", "blendIndices", "blendWeight", "color"
+        };
 
-                    ++it;
-                    if (it == eit)
-                        break;
-                }
-                lastx = x;
+        for (size_t a = 0; a < TestCompressedVertex::CompressionLayoutCount; ++a)
+        {
+            char buff[128] = {};
+            sprintf_s(buff, "    %-12s max error %g\n", s_names[a], errors[a]);
+            OutputDebugStringA(buff);
 
-                if (it == eit)
-                    break;
+            if (errors[a] > s_bounds[a])
+            {
+                sprintf_s(buff, "ERROR: CompressVertices %s error %g exceeds %g\n", s_names[a], errors[a], s_bounds[a]);
+                OutputDebugStringA(buff);
+                success = false;
             }
+        }
 
-            // Make sure we drew all the effects
-            assert(it == eit);
+        // Octahedral normals, four at a time plus the tail, against the single-vector encoder
+        std::vector<XMSHORTN2> octNormals(c_vertexCount);
+        const float error = DX::VertexCompression::Float3ToOctahedral(
+            octNormals.data(), sizeof(XMSHORTN2),
+            &vertices[0].normal, sizeof(TestVertex),
+            c_vertexCount, true);
+
+        char buff[128] = {};
+        sprintf_s(buff, "    %-12s max error %g (octahedral R16G16_SNORM)\n", "normal", error);
+        OutputDebugStringA(buff);
 
-            // SkinnedPBREffect should be on same line...
+        if (error > 0.001f)
+        {
+            OutputDebugStringA("ERROR: Octahedral normal error too large\n");
+            success = false;
         }
 
-        // SkinnedPBREffect
+        for (size_t j = 0; j < c_vertexCount; ++j)
         {
-            auto it = (showCompressed) ? m_skinningPbrBn.cbegin() : m_skinningPbr.cbegin();
-            auto eit = (showCompressed) ? m_skinningPbrBn.cend() : m_skinningPbr.cend();
-            assert(it != eit);
+            XMSHORTN2 single;
+            XMStoreShortN2(&single, DX::VertexCompression::EncodeOctahedral(XMLoadFloat3(&vertices[j].normal)));
+            if (single.v != octNormals[j].v)
+            {
+                OutputDebugStringA("ERROR: Octahedral stream does not match EncodeOctahedral\n");
+                success = false;
+                break;
+            }
+        }
 
-            for (; y > -ortho_height; y -= 1.f)
+        // Zero and denormal normals must encode to +Z rather than NaN.
+        const XMFLOAT3 degenerate[5] = { { 0.f, 0.f, 0.f }, { 1e-30f, 0.f, 0.f }, { 0.f, -0.f, 0.f }, { 0.f, 0.f, 0.f }, { 0.f, 0.f, 0.f } };
+        XMSHORTN2 degenerateOct[5] = {};
+        std::ignore = DX::VertexCompression::Float3ToOctahedral(degenerateOct, sizeof(XMSHORTN2), degenerate, sizeof(XMFLOAT3), std::size(degenerate));
+        for (const auto& it : degenerateOct)
+        {
+            if (it.v != 0)
             {
-                for (float x = lastx + 1.f; x < ortho_width; x += 1.f)
-                {
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+                OutputDebugStringA("ERROR: Degenerate normal did not encode as +Z\n");
+                success = false;
+                break;
+            }
+        }
+    }
+
+    if (g_benchmarks)
+    {
+        constexpr size_t c_vertexCount = 1000000;
 
-                    ++it;
-                    if (it == eit)
-                        break;
-                }
+        const std::vector<TestVertex> vertices = makeVertices(c_vertexCount);
 
-                if (it == eit)
-                    break;
+        // Per-vertex reference
+        std::vector<TestCompressedVertex> reference(c_vertexCount);
+        timer.Reset();
+        timer.Start();
+        for (size_t j = 0; j < c_vertexCount; ++j)
+        {
+            CompressVertexReference(vertices[j], reference[j]);
+        }
+        timer.Stop();
+        const double referenceMs = timer.GetElapsedMilliseconds();
+
+        // Stream engine
+        std::vector<TestCompressedVertex> compressed(c_vertexCount);
+        timer.Reset();
+        timer.Start();
+        DX::VertexCompression::CompressVertices(
+            TestCompressedVertex::CompressionLayout, TestCompressedVertex::CompressionLayoutCount,
+            compressed.data(), sizeof(TestCompressedVertex),
+            vertices.data(), sizeof(TestVertex),
+            c_vertexCount);
+        timer.Stop();
+        const double streamMs = timer.GetElapsedMilliseconds();
+
+        std::vector<XMSHORTN2> octNormals(c_vertexCount);
+        timer.Reset();
+        timer.Start();
+        std::ignore = DX::VertexCompression::Float3ToOctahedral(
+            octNormals.data(), sizeof(XMSHORTN2),
+            &vertices[0].normal, sizeof(TestVertex),
+            c_vertexCount);
+        timer.Stop();
+        const double octahedralMs = timer.GetElapsedMilliseconds();
+
+        char buff[256] = {};
+        sprintf_s(buff, "Vertex compression (%zu verts, %zu -> %zu bytes): per-vertex %.2f ms, stream %.2f ms, octahedral normals %.2f ms\n",
+            c_vertexCount, sizeof(TestVertex), sizeof(TestCompressedVertex), referenceMs, streamMs, octahedralMs);
+        OutputDebugStringA(buff);
+    }
+
+    // Instance transform packing
+    {
+        const XMMATRIX world = XMMatrixRotationRollPitchYaw(0.25f, 0.5f, 0.75f);
+        auto transform = [&](size_t j)
+        {
+            return world * XMMatrixTranslation(float(j & 1023), float(j >> 10), 0.f);
+        };
+
+        DX::RecordingJobSystem jobs;
+
+        // 100K is past the parallel threshold, so the split path is always checked; 1M is for timing.
+        const size_t maxCount = g_benchmarks ? 1000000 : 100000;
+        for (size_t count = 10000; count <= maxCount; count *= 10)
+        {
+            std::vector<XMFLOAT3X4> staging(count);
+            std::vector<XMFLOAT3X4> reference(count);
+            std::vector<XMFLOAT3X4> serial(count);
+            std::vector<XMFLOAT3X4> parallel(count);
+
+            // Previous pattern: fill a CPU staging array, then copy it into upload memory.
+            timer.Reset();
+            timer.Start();
+            for (size_t j = 0; j < count; ++j)
+            {
+                XMStoreFloat3x4(&staging[j], transform(j));
+            }
+            memcpy(reference.data(), staging.data(), count * sizeof(XMFLOAT3X4));
+            timer.Stop();
+            const double stagingMs = timer.GetElapsedMilliseconds();
+
+            timer.Reset();
+            timer.Start();
+            DX::PackInstanceTransforms(serial.data(), count, transform);
+            timer.Stop();
+            const double serialMs = timer.GetElapsedMilliseconds();
+
+            timer.Reset();
+            timer.Start();
+            DX::PackInstanceTransforms(parallel.data(), count, transform, &jobs);
+            timer.Stop();
+            const double parallelMs = timer.GetElapsedMilliseconds();
+
+            if (memcmp(reference.data(), serial.data(), count * sizeof(XMFLOAT3X4)) != 0
+                || memcmp(reference.data(), parallel.data(), count * sizeof(XMFLOAT3X4)) != 0)
+            {
+                OutputDebugStringA("ERROR: PackInstanceTransforms output does not match XMStoreFloat3x4\n");
+                success = false;
             }
 
-            // Make sure we drew all the effects
-            assert(it == eit);
+            if (g_benchmarks)
+            {
+                char buff[256] = {};
+                sprintf_s(buff, "Instance transforms (%zu): staging+copy %.2f ms, direct %.2f ms, parallel %.2f ms on %zu workers\n",
+                    count, stagingMs, serialMs, parallelMs, jobs.GetWorkerCount());
+                OutputDebugStringA(buff);
+            }
+        }
+    }
 
-            y -= 1.f;
+    // Frustum culling
+    {
+        // 20K spheres cover every plane and LOD band; timing runs use a million.
+        const size_t sphereCount = g_benchmarks ? 1000000 : 20000;
+
+        std::uniform_real_distribution<float> fieldDist(-200.f, 200.f);
+        std::uniform_real_distribution<float> radiusDist(0.1f, 2.f);
+
+        std::vector<BoundingSphere> spheres(sphereCount);
+        for (auto& it : spheres)
+        {
+            it.Center = XMFLOAT3(fieldDist(generator), fieldDist(generator), fieldDist(generator));
+            it.Radius = radiusDist(generator);
         }
 
-        // DebugEffect
+        const XMVECTOR eye = XMVectorSet(0.f, 10.f, -50.f, 0.f);
+        const XMMATRIX view = XMMatrixLookAtLH(eye, g_XMZero, g_XMIdentityR1);
+        const XMMATRIX proj = XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.f / 9.f, 0.1f, 150.f);
+
+        BoundingFrustum frustum;
+        BoundingFrustum::CreateFromMatrix(frustum, proj);
+        frustum.Transform(frustum, XMMatrixInverse(nullptr, view));
+
+        // Per-sphere reference
+        std::vector<uint8_t> reference(sphereCount);
+        timer.Reset();
+        timer.Start();
+        for (size_t j = 0; j < sphereCount; ++j)
         {
-            auto it = (showCompressed) ? m_debugBn.cbegin() : m_debug.cbegin();
-            auto eit = (showCompressed) ? m_debugBn.cend() : m_debug.cend();
-            assert(it != eit);
+            reference[j] = frustum.Intersects(spheres[j]) ? 1 : 0;
+        }
+        timer.Stop();
+        const double referenceMs = timer.GetElapsedMilliseconds();
+
+        const DX::FrustumCuller culler(frustum);
+        std::vector<uint32_t> visible(sphereCount);
+
+        timer.Reset();
+        timer.Start();
+        const size_t visibleCount = culler.Cull(spheres.data(), sphereCount, visible.data());
+        timer.Stop();
+        const double cullMs = timer.GetElapsedMilliseconds();
+
+        // The batched test is plane-only, so it may keep a few spheres near frustum corners
+        // but must never drop one the exact test keeps.
+        std::vector<uint8_t> kept(sphereCount);
+        for (size_t j = 0; j < visibleCount; ++j)
+        {
+            kept[visible[j]] = 1;
+        }
 
-            for (; y > -ortho_height; y -= 1.f)
-            {
-                for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
-                {
-                    (*it)->SetWorld(world * XMMatrixTranslation(x, y, -1.f));
-                    (*it)->Apply(commandList);
-                    commandList->DrawIndexedInstanced(m_indexCount, 1, 0, 0, 0);
+        size_t missing = 0;
+        size_t referenceCount = 0;
+        for (size_t j = 0; j < sphereCount; ++j)
+        {
+            referenceCount += reference[j];
+            if (reference[j] && !kept[j])
+                ++missing;
+        }
 
-                    ++it;
-                    if (it == eit)
-                        break;
-                }
+        if (missing > 0)
+        {
+            char buff[128] = {};
+            sprintf_s(buff, "ERROR: FrustumCuller dropped %zu visible spheres\n", missing);
+            OutputDebugStringA(buff);
+            success = false;
+        }
 
-                if (it == eit)
-                    break;
-            }
+        // With LOD selection
+        static const float s_lodDistances[] = { 25.f, 60.f, 100.f };
+        DX::FrustumCuller lodCuller(frustum);
+        lodCuller.SetLodDistances(eye, s_lodDistances, std::size(s_lodDistances));
 
-            // Make sure we drew all the effects
-            assert(it == eit);
+        std::vector<uint8_t> lods(sphereCount);
+        timer.Reset();
+        timer.Start();
+        const size_t lodCount = lodCuller.Cull(spheres.data(), sphereCount, visible.data(), lods.data());
+        timer.Stop();
+        const double lodMs = timer.GetElapsedMilliseconds();
 
-            y -= 1.f;
+        size_t lodErrors = (lodCount != visibleCount) ? 1 : 0;
+        for (size_t j = 0; j < lodCount; ++j)
+        {
+            const float distSq = XMVectorGetX(XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&spheres[visible[j]].Center), eye)));
+
+            uint8_t level = 0;
+            for (const float d : s_lodDistances)
+            {
+                if (distSq >= d * d)
+                    ++level;
+            }
+
+            if (level != lods[j])
+                ++lodErrors;
         }
-    }
 
-    PIXEndEvent(commandList);
+        if (lodErrors > 0)
+        {
+            OutputDebugStringA("ERROR: FrustumCuller LOD selection does not match reference\n");
+            success = false;
+        }
 
-    // Show the new frame.
-    PIXBeginEvent(m_deviceResources->GetCommandQueue(), PIX_COLOR_DEFAULT, L"Present");
-    m_deviceResources->Present();
-    m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+        if (g_benchmarks)
+        {
+            char buff[256] = {};
+            sprintf_s(buff, "Frustum culling (%zu spheres, %zu visible, %zu exact): per-sphere %.2f ms, batched %.2f ms (%.1f M/s), with LOD %.2f ms\n",
+                sphereCount, visibleCount, referenceCount, referenceMs, cullMs,
+                (cullMs > 0.0) ? double(sphereCount) / (cullMs * 1000.0) : 0.0, lodMs);
+            OutputDebugStringA(buff);
+        }
+    }
 
-    // Sample stats to update peak values
-    std::ignore = m_graphicsMemory->GetStatistics();
+    // Parallel command list recording (mock device)
+    {
+        constexpr size_t c_frames = 12;
+        constexpr size_t c_segments = 64;
+        constexpr size_t c_draws = 200;
+        constexpr uint32_t c_work = 500;
+
+        MockRecorder serial(MockCommandListBackend(), 3, 0);
+        // At least a few workers, so the scheduling is exercised on any machine.
+        MockRecorder parallel(MockCommandListBackend(), 3, std::max<size_t>(DX::GetDefaultRecordingThreadCount(), 3));
+
+        double serialMs = 0.0;
+        double parallelMs = 0.0;
+        if (!TestParallelRecorder(serial, c_frames, c_segments, c_draws, c_work, serialMs))
+            success = false;
+        if (!TestParallelRecorder(parallel, c_frames, c_segments, c_draws, c_work, parallelMs))
+            success = false;
+
+        // A failing segment surfaces on the calling thread and leaves no list open.
+        bool threw = false;
+        try
+        {
+            parallel.BeginFrame(0);
+            parallel.Record(c_segments, [&](size_t segment, const MockRecorder::CommandList& list)
+                {
+                    if (segment == c_segments / 2)
+                        throw std::runtime_error("segment");
 
-    PIXEndEvent(m_deviceResources->GetCommandQueue());
-}
+                    RecordMockSegment(segment, list, 1, 0);
+                });
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+        parallel.Submit();
+        std::ignore = parallel.GetBackend().TakeExecuted();
 
-// Helper method to clear the back buffers.
-void Game::Clear()
-{
-    auto commandList = m_deviceResources->GetCommandList();
-    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Clear");
+        if (!threw || parallel.GetBackend().GetOpenLists() > 0)
+        {
+            OutputDebugStringA("ERROR: ParallelCommandRecorder did not recover from a failing segment\n");
+            success = false;
+        }
 
-    // Clear the views.
-    auto const rtvDescriptor = m_deviceResources->GetRenderTargetView();
-    auto const dsvDescriptor = m_deviceResources->GetDepthStencilView();
+        double afterMs = 0.0;
+        if (!TestParallelRecorder(parallel, 3, c_segments, 1, 0, afterMs))
+            success = false;
 
-    D3D12_CPU_DESCRIPTOR_HANDLE rtvDescriptors[2] = { rtvDescriptor, m_renderDescriptors->GetCpuHandle(RTDescriptors::RTVelocityBuffer) };
-    commandList->OMSetRenderTargets(2, rtvDescriptors, FALSE, &dsvDescriptor);
-    commandList->ClearRenderTargetView(rtvDescriptor, c_clearColor, 0, nullptr);
-    commandList->ClearDepthStencilView(dsvDescriptor, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+        char buff[256] = {};
+        sprintf_s(buff, "Parallel recording (%zu segments x %zu draws, %zu frames): 1 worker %.2f ms, %zu workers %.2f ms (%.2fx), %zu command lists\n",
+            c_segments, c_draws, c_frames, serialMs, parallel.GetWorkerCount(), parallelMs,
+            (parallelMs > 0.0) ? serialMs / parallelMs : 0.0, parallel.GetCommandListCount());
+        OutputDebugStringA(buff);
+    }
 
-    // Set the viewport and scissor rect.
-    auto const viewport = m_deviceResources->GetScreenViewport();
-    auto const scissorRect = m_deviceResources->GetScissorRect();
-    commandList->RSSetViewports(1, &viewport);
-    commandList->RSSetScissorRects(1, &scissorRect);
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
 
-    PIXEndEvent(commandList);
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
 }
 #pragma endregion
 
@@ -913,6 +1383,10 @@ void Game::CreateDeviceDependentResources()
 
     m_graphicsMemory = std::make_unique<GraphicsMemory>(device);
 
+    m_recorder = std::make_unique<DX::D3D12ParallelCommandRecorder>(
+        DX::D3D12CommandListBackend(device, m_deviceResources->GetCommandQueue()),
+        m_deviceResources->GetBackBufferCount());
+
     m_states = std::make_unique<CommonStates>(device);
 
     CreateCube();
@@ -929,6 +1403,11 @@ void Game::CreateDeviceDependentResources()
         m_resourceDescriptors->GetCpuHandle(Descriptors::VelocityBuffer),
         m_renderDescriptors->GetCpuHandle(RTDescriptors::RTVelocityBuffer));
 
+    // SetWindow takes the velocity buffer from this pool instead of creating it directly.
+    m_renderTargetPool = std::make_unique<DX::RenderTexturePool>(DX::RenderTextureAllocator(device),
+        m_deviceResources->GetBackBufferCount());
+    m_velocityBuffer->SetPool(m_renderTargetPool.get());
+
     ResourceUploadBatch resourceUpload(device);
 
     resourceUpload.Begin();
@@ -1053,18 +1532,6 @@ void Game::CreateDeviceDependentResources()
             ++j;
         }
         m_instanceCount = static_cast<UINT>(j);
-
-        m_instanceTransforms = std::make_unique<XMFLOAT3X4[]>(j);
-
-        constexpr XMFLOAT3X4 s_identity = { 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f, 0.f, 0.f, 1.f, 0.f };
-
-        j = 0;
-        for (float x = -ortho_width + 0.5f; x < ortho_width; x += 1.f)
-        {
-            m_instanceTransforms[j] = s_identity;
-            m_instanceTransforms[j]._14 = x;
-            ++j;
-        }
     }
 
     // Create test effects
@@ -1900,6 +2367,9 @@ void Game::CreateWindowSizeDependentResources()
     auto size = m_deviceResources->GetOutputSize();
     m_velocityBuffer->SetWindow(size);
 
+    // Only the velocity buffer uses the pool; drop the previous size once the resize has idled the GPU.
+    m_renderTargetPool->Trim();
+
     XMMATRIX projection = XMMatrixOrthographicRH(ortho_width * 2.f, ortho_height * 2.f, 0.1f, 10.f);
 
 #ifdef UWP
@@ -2081,10 +2551,13 @@ void Game::OnDeviceLost()
     m_vertexBufferBn.Reset();
 
     m_velocityBuffer->ReleaseDevice();
+    m_velocityBuffer->SetPool(nullptr);
+    m_renderTargetPool.reset();
 
     m_resourceDescriptors.reset();
     m_renderDescriptors.reset();
     m_states.reset();
+    m_recorder.reset();
     m_graphicsMemory.reset();
 }
 
@@ -2175,13 +2648,12 @@ void Game::CreateCube()
 
     // Compressed Vertex data
     {
-        std::vector<TestCompressedVertex> cvertices;
-        cvertices.reserve(vertices.size());
-        for (auto&i : vertices)
-        {
-            TestCompressedVertex cv(i);
-            cvertices.emplace_back(std::move(cv));
-        }
+        std::vector<TestCompressedVertex> cvertices(vertices.size());
+        DX::VertexCompression::CompressVertices(
+            TestCompressedVertex::CompressionLayout, TestCompressedVertex::CompressionLayoutCount,
+            cvertices.data(), sizeof(TestCompressedVertex),
+            vertices.data(), sizeof(TestVertex),
+            vertices.size());
 
         auto verts = reinterpret_cast<const uint8_t*>(cvertices.data());
         size_t vertSizeBytes = cvertices.size() * sizeof(TestCompressedVertex);
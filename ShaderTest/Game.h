@@ -13,7 +13,9 @@
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
 
+#include "ParallelRecordingD3D12.h"
 #include "RenderTexture.h"
+#include "VertexCompression.h"
 
 constexpr uint32_t c_testTimeout = 10000;
 
@@ -84,6 +86,7 @@ private:
     void Render();
 
     void Clear();
+    void SetFrameState(_In_ ID3D12GraphicsCommandList* commandList);
 
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
@@ -92,6 +95,8 @@ private:
 
     void CreateCube();
 
+    void UnitTests();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
 
@@ -107,6 +112,7 @@ private:
 
     // DirectXTK Test Objects
     std::unique_ptr<DirectX::GraphicsMemory>    m_graphicsMemory;
+    std::unique_ptr<DX::D3D12ParallelCommandRecorder>   m_recorder;
 
     std::unique_ptr<DirectX::CommonStates>      m_states;
     std::unique_ptr<DirectX::DescriptorHeap>    m_resourceDescriptors;
@@ -139,6 +145,7 @@ private:
     std::vector<std::unique_ptr<DirectX::DebugEffect>> m_debugInstancedBn;
 
     std::unique_ptr<DX::RenderTexture>              m_velocityBuffer;
+    std::unique_ptr<DX::RenderTexturePool>          m_renderTargetPool;
 
     UINT					                        m_indexCount;
     UINT                                            m_instanceCount;
@@ -166,7 +173,6 @@ private:
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_radianceIBL;
     Microsoft::WRL::ComPtr<ID3D12Resource>          m_irradianceIBL;
 
-    std::unique_ptr<DirectX::XMFLOAT3X4[]>          m_instanceTransforms;
 
     enum RenderMode
     {
@@ -12,9 +12,12 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
+
 #define GAMMA_CORRECT_RENDERING
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -120,6 +123,8 @@ void Game::Initialize(
 
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -156,6 +161,7 @@ void Game::Update(DX::StepTimer const&)
         assert(m_spriteBatch->GetRotation() == DXGI_MODE_ROTATION_ROTATE270);
 
         m_spriteBatchSampler->SetRotation(DXGI_MODE_ROTATION_ROTATE270);
+        m_bulkSprites->SetRotation(DXGI_MODE_ROTATION_ROTATE270);
     }
     else if (kb.Right || (pad.IsConnected() && pad.dpad.right))
     {
@@ -163,6 +169,7 @@ void Game::Update(DX::StepTimer const&)
         assert(m_spriteBatch->GetRotation() == DXGI_MODE_ROTATION_ROTATE90);
 
         m_spriteBatchSampler->SetRotation(DXGI_MODE_ROTATION_ROTATE90);
+        m_bulkSprites->SetRotation(DXGI_MODE_ROTATION_ROTATE90);
     }
     else if (kb.Up || (pad.IsConnected() && pad.dpad.up))
     {
@@ -170,6 +177,7 @@ void Game::Update(DX::StepTimer const&)
         assert(m_spriteBatch->GetRotation() == DXGI_MODE_ROTATION_IDENTITY);
 
         m_spriteBatchSampler->SetRotation(DXGI_MODE_ROTATION_IDENTITY);
+        m_bulkSprites->SetRotation(DXGI_MODE_ROTATION_IDENTITY);
     }
     else if (kb.Down || (pad.IsConnected() && pad.dpad.down))
     {
@@ -177,6 +185,7 @@ void Game::Update(DX::StepTimer const&)
         assert(m_spriteBatch->GetRotation() == DXGI_MODE_ROTATION_ROTATE180);
 
         m_spriteBatchSampler->SetRotation(DXGI_MODE_ROTATION_ROTATE180);
+        m_bulkSprites->SetRotation(DXGI_MODE_ROTATION_ROTATE180);
     }
 
     PIXEndEvent();
@@ -321,6 +330,34 @@ void Game::Render()
     m_spriteBatchSampler->Draw(cat, catSize, XMFLOAT2(1100.f, 600.f), &tileRect, Colors::White, time / 50, XMFLOAT2(256, 256));
     m_spriteBatchSampler->End();
 
+    // Bulk submission: a ring of letters, radix sorted back to front.
+    {
+        const D3D12_GPU_DESCRIPTOR_HANDLE letters[] =
+        {
+            m_resourceDescriptors->GetGpuHandle(Descriptors::A),
+            m_resourceDescriptors->GetGpuHandle(Descriptors::B),
+            m_resourceDescriptors->GetGpuHandle(Descriptors::C),
+        };
+        const XMUINT2 letterSizes[] =
+        {
+            GetTextureSize(m_letterA.Get()),
+            GetTextureSize(m_letterB.Get()),
+            GetTextureSize(m_letterC.Get()),
+        };
+
+        m_spriteArrays.Clear();
+        for (uint32_t j = 0; j < 48; ++j)
+        {
+            const float angle = XM_2PI * float(j) / 48.f + time / 120.f;
+            auto const& size = letterSizes[j % 3];
+            m_spriteArrays.Add(j % 3, size, XMFLOAT2(640.f + cosf(angle) * 160.f, 600.f + sinf(angle) * 60.f),
+                nullptr, Colors::White, -angle, XMFLOAT2(float(size.x) * 0.5f, float(size.y) * 0.5f), XMFLOAT2(0.5f, 0.5f),
+                SpriteEffects_None, 0.5f - sinf(angle) * 0.5f);
+        }
+
+        m_bulkSprites->Draw(commandList, m_spriteArrays, letters, std::size(letters), m_states->LinearClamp(), SpriteSortMode_BackToFront);
+    }
+
     PIXEndEvent(commandList);
 
     // Show the new frame.
@@ -356,6 +393,348 @@ void Game::Clear()
 }
 #pragma endregion
 
+#pragma region Unit Tests
+namespace
+{
+    // The arguments of one SpriteBatch::Draw call.
+    struct SpriteDraw
+    {
+        uint32_t        texture;
+        XMUINT2         textureSize;
+        XMFLOAT2        position;
+        RECT            source;
+        bool            hasSource;
+        XMFLOAT4        color;
+        float           rotation;
+        XMFLOAT2        origin;
+        XMFLOAT2        scale;
+        SpriteEffects   effects;
+        float           depth;
+    };
+
+    SpriteDraw RandomSpriteDraw(std::default_random_engine& generator)
+    {
+        std::uniform_real_distribution<float> unit(0.f, 1.f);
+        std::uniform_int_distribution<uint32_t> pick(0, 3);
+
+        SpriteDraw d = {};
+        d.texture = pick(generator);
+        d.textureSize.x = 64u << pick(generator);
+        d.textureSize.y = 32u << pick(generator);
+        d.position.x = unit(generator) * 1280.f;
+        d.position.y = unit(generator) * 720.f;
+
+        // Some source rectangles have zero size.
+        d.hasSource = pick(generator) != 0;
+        if (d.hasSource)
+        {
+            d.source.left = long(unit(generator) * float(d.textureSize.x));
+            d.source.top = long(unit(generator) * float(d.textureSize.y));
+            d.source.right = d.source.left + long(unit(generator) * float(long(d.textureSize.x) - d.source.left));
+            d.source.bottom = d.source.top + long(unit(generator) * float(long(d.textureSize.y) - d.source.top));
+        }
+
+        d.color.x = unit(generator);
+        d.color.y = unit(generator);
+        d.color.z = unit(generator);
+        d.color.w = unit(generator);
+        d.rotation = (pick(generator) == 0) ? 0.f : (unit(generator) - 0.5f) * XM_2PI * 2.f;
+        d.origin.x = unit(generator) * 64.f;
+        d.origin.y = unit(generator) * 64.f;
+        d.scale.x = 0.25f + unit(generator) * 2.f;
+        d.scale.y = 0.25f + unit(generator) * 2.f;
+        d.effects = static_cast<SpriteEffects>(pick(generator));
+        d.depth = unit(generator);
+        return d;
+    }
+
+    void AddSprite(DX::SpriteArrays& sprites, const SpriteDraw& d)
+    {
+        sprites.Add(d.texture, d.textureSize, d.position, d.hasSource ? &d.source : nullptr, XMLoadFloat4(&d.color),
+            d.rotation, d.origin, d.scale, d.effects, d.depth);
+    }
+
+    // SpriteBatch's placement of one sprite, in scalar code: top-left, top-right, bottom-left,
+    // bottom-right. Flipping swaps corners' texture coordinates, as SpriteBatch does.
+    void ReferenceSpriteVertices(const SpriteDraw& d, _Out_writes_(4) VertexPositionColorTexture* vertices)
+    {
+        float sx = 0.f;
+        float sy = 0.f;
+        float sw = float(d.textureSize.x);
+        float sh = float(d.textureSize.y);
+        if (d.hasSource)
+        {
+            sx = float(d.source.left);
+            sy = float(d.source.top);
+            sw = float(d.source.right - d.source.left);
+            sh = float(d.source.bottom - d.source.top);
+        }
+
+        const float originX = (sw != 0.f) ? d.origin.x / sw : 0.f;
+        const float originY = (sh != 0.f) ? d.origin.y / sh : 0.f;
+        const float cosR = cosf(d.rotation);
+        const float sinR = sinf(d.rotation);
+
+        for (uint32_t corner = 0; corner < 4; ++corner)
+        {
+            const float dx = (float(corner & 1) - originX) * sw * d.scale.x;
+            const float dy = (float(corner >> 1) - originY) * sh * d.scale.y;
+            const uint32_t flipped = corner ^ static_cast<uint32_t>(d.effects);
+
+            auto& v = vertices[corner];
+            v.position = XMFLOAT3(d.position.x + dx * cosR - dy * sinR, d.position.y + dx * sinR + dy * cosR, d.depth);
+            v.color = d.color;
+            v.textureCoordinate = XMFLOAT2(
+                (sx + float(flipped & 1) * sw) / float(d.textureSize.x),
+                (sy + float(flipped >> 1) * sh) / float(d.textureSize.y));
+        }
+    }
+
+    bool NearlyEqual(float a, float b) noexcept
+    {
+        return fabsf(a - b) <= 1e-3f * std::max(1.f, fabsf(b));
+    }
+
+    bool CompareSpriteVertices(const VertexPositionColorTexture* a, const VertexPositionColorTexture* b, size_t count)
+    {
+        for (size_t j = 0; j < count; ++j)
+        {
+            if (!NearlyEqual(a[j].position.x, b[j].position.x)
+                || !NearlyEqual(a[j].position.y, b[j].position.y)
+                || a[j].position.z != b[j].position.z
+                || memcmp(&a[j].color, &b[j].color, sizeof(XMFLOAT4)) != 0
+                || !NearlyEqual(a[j].textureCoordinate.x, b[j].textureCoordinate.x)
+                || !NearlyEqual(a[j].textureCoordinate.y, b[j].textureCoordinate.y))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    std::default_random_engine generator(12345);
+    char buff[256] = {};
+
+    // GenerateSpriteVertices against SpriteBatch's placement, in order and gathered.
+    {
+        std::vector<SpriteDraw> draws(1003);
+        DX::SpriteArrays sprites;
+        std::vector<VertexPositionColorTexture> expected(draws.size() * 4);
+        for (size_t j = 0; j < draws.size(); ++j)
+        {
+            draws[j] = RandomSpriteDraw(generator);
+            AddSprite(sprites, draws[j]);
+            ReferenceSpriteVertices(draws[j], &expected[j * 4]);
+        }
+
+        std::vector<VertexPositionColorTexture> vertices(draws.size() * 4);
+        DX::GenerateSpriteVertices(sprites, nullptr, 0, draws.size(), vertices.data());
+        if (!CompareSpriteVertices(vertices.data(), expected.data(), vertices.size()))
+        {
+            OutputDebugStringA("ERROR: Failed BulkSpriteBatch vertex generation\n");
+            success = false;
+        }
+
+        // Every length of a short last group, through a shuffled order.
+        std::vector<uint32_t> order(draws.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::shuffle(order.begin(), order.end(), generator);
+
+        for (size_t count = 1; count <= 9; ++count)
+        {
+            constexpr size_t first = 17;
+            DX::GenerateSpriteVertices(sprites, order.data(), first, count, vertices.data());
+            for (size_t k = 0; k < count; ++k)
+            {
+                if (!CompareSpriteVertices(&vertices[k * 4], &expected[size_t(order[first + k]) * 4], 4))
+                {
+                    sprintf_s(buff, "ERROR: Failed BulkSpriteBatch gathered vertex generation (%zu sprites)\n", count);
+                    OutputDebugStringA(buff);
+                    success = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    // SpriteSorter against std::stable_sort with SpriteBatch's comparisons.
+    {
+        DX::SpriteArrays sprites;
+        std::uniform_int_distribution<uint32_t> textureDist(0, 200);
+        std::uniform_int_distribution<int> depthDist(-8, 8);
+        for (size_t j = 0; j < 5000; ++j)
+        {
+            // Coarse depths leave many ties, including -0 against +0.
+            const int depth = depthDist(generator);
+            AddSprite(sprites, RandomSpriteDraw(generator));
+            sprites.texture.back() = textureDist(generator);
+            sprites.depth.back() = (depth == 0 && (j & 1)) ? -0.f : float(depth) * 0.125f;
+        }
+
+        DX::SpriteSorter sorter;
+        std::vector<uint32_t> expected(sprites.GetCount());
+
+        auto checkSort = [&](SpriteSortMode mode, auto&& less, const char* name)
+            {
+                std::iota(expected.begin(), expected.end(), 0u);
+                std::stable_sort(expected.begin(), expected.end(), less);
+                if (sorter.Sort(sprites, mode) != expected)
+                {
+                    sprintf_s(buff, "ERROR: Failed SpriteSorter %s\n", name);
+                    OutputDebugStringA(buff);
+                    success = false;
+                }
+            };
+
+        checkSort(SpriteSortMode_Deferred, [](uint32_t, uint32_t) { return false; }, "deferred");
+        checkSort(SpriteSortMode_Texture, [&](uint32_t a, uint32_t b) { return sprites.texture[a] < sprites.texture[b]; }, "texture");
+
+        // Indices under 256 differ only in their low byte.
+        if (sorter.GetLastPassCount() != 1)
+        {
+            OutputDebugStringA("ERROR: Failed SpriteSorter pass skipping\n");
+            success = false;
+        }
+
+        checkSort(SpriteSortMode_BackToFront, [&](uint32_t a, uint32_t b) { return sprites.depth[a] > sprites.depth[b]; }, "back to front");
+        checkSort(SpriteSortMode_FrontToBack, [&](uint32_t a, uint32_t b) { return sprites.depth[a] < sprites.depth[b]; }, "front to back");
+
+        std::fill(sprites.texture.begin(), sprites.texture.end(), 3u);
+        checkSort(SpriteSortMode_Texture, [](uint32_t, uint32_t) { return false; }, "single texture");
+        if (sorter.GetLastPassCount() != 0)
+        {
+            OutputDebugStringA("ERROR: Failed SpriteSorter single texture pass count\n");
+            success = false;
+        }
+
+        const float depths[] = { -FLT_MAX, -1.f, -FLT_MIN, 0.f, FLT_MIN, 0.5f, 1.f, FLT_MAX };
+        for (size_t j = 1; j < std::size(depths); ++j)
+        {
+            if (DX::SpriteSorter::GetDepthKey(depths[j - 1]) >= DX::SpriteSorter::GetDepthKey(depths[j]))
+            {
+                OutputDebugStringA("ERROR: Failed SpriteSorter depth keys\n");
+                success = false;
+                break;
+            }
+        }
+    }
+
+    // Throughput: SpriteBatch::Draw per sprite against filling SpriteArrays and drawing them in
+    // bulk. The command list is only recorded, never executed.
+    if (g_benchmarks)
+    {
+        constexpr size_t c_spriteCount = 100000;
+
+        const D3D12_GPU_DESCRIPTOR_HANDLE textures[] =
+        {
+            m_resourceDescriptors->GetGpuHandle(Descriptors::Cat),
+            m_resourceDescriptors->GetGpuHandle(Descriptors::A),
+            m_resourceDescriptors->GetGpuHandle(Descriptors::B),
+            m_resourceDescriptors->GetGpuHandle(Descriptors::C),
+        };
+        const XMUINT2 textureSizes[] =
+        {
+            GetTextureSize(m_cat.Get()),
+            GetTextureSize(m_letterA.Get()),
+            GetTextureSize(m_letterB.Get()),
+            GetTextureSize(m_letterC.Get()),
+        };
+
+        std::vector<SpriteDraw> draws(c_spriteCount);
+        for (auto& d : draws)
+        {
+            d = RandomSpriteDraw(generator);
+            d.textureSize = textureSizes[d.texture];
+            d.hasSource = false;
+        }
+
+        auto device = m_deviceResources->GetD3DDevice();
+
+        ComPtr<ID3D12CommandAllocator> allocator;
+        DX::ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+            IID_GRAPHICS_PPV_ARGS(allocator.GetAddressOf())));
+
+        ComPtr<ID3D12GraphicsCommandList> commandList;
+        DX::ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr,
+            IID_GRAPHICS_PPV_ARGS(commandList.GetAddressOf())));
+
+        ID3D12DescriptorHeap* heaps[] = { m_resourceDescriptors->Heap(), m_states->Heap() };
+
+        auto timePass = [&](auto&& record)
+            {
+                commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+
+                DX::CpuTimer timer;
+                timer.Start();
+                record();
+                timer.Stop();
+
+                // Retire this pass's upload pages before the next one.
+                DX::ThrowIfFailed(commandList->Close());
+                m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+                m_deviceResources->WaitForGpu();
+                DX::ThrowIfFailed(allocator->Reset());
+                DX::ThrowIfFailed(commandList->Reset(allocator.Get(), nullptr));
+
+                return timer.GetElapsedMilliseconds();
+            };
+
+        const SpriteSortMode modes[] = { SpriteSortMode_Deferred, SpriteSortMode_Texture, SpriteSortMode_BackToFront };
+        const char* modeNames[] = { "Deferred", "Texture", "BackToFront" };
+
+        for (size_t m = 0; m < std::size(modes); ++m)
+        {
+            const double perSprite = timePass([&]
+                {
+                    m_spriteBatch->Begin(commandList.Get(), modes[m]);
+                    for (auto const& d : draws)
+                    {
+                        m_spriteBatch->Draw(textures[d.texture], d.textureSize, d.position, nullptr, XMLoadFloat4(&d.color),
+                            d.rotation, d.origin, d.scale, d.effects, d.depth);
+                    }
+                    m_spriteBatch->End();
+                });
+
+            const double fillAndDraw = timePass([&]
+                {
+                    m_spriteArrays.Clear();
+                    for (auto const& d : draws)
+                    {
+                        AddSprite(m_spriteArrays, d);
+                    }
+                    m_bulkSprites->Draw(commandList.Get(), m_spriteArrays, textures, std::size(textures), m_states->LinearClamp(), modes[m]);
+                });
+
+            const double bulk = timePass([&]
+                {
+                    m_bulkSprites->Draw(commandList.Get(), m_spriteArrays, textures, std::size(textures), m_states->LinearClamp(), modes[m]);
+                });
+
+            sprintf_s(buff, "SpriteBatch %zu sprites (%s): Draw %.3f ms, SpriteArrays::Add + bulk %.3f ms, bulk %.3f ms (%zu batches)\n",
+                c_spriteCount, modeNames[m], perSprite, fillAndDraw, bulk, m_bulkSprites->GetLastBatchCount());
+            OutputDebugStringA(buff);
+        }
+
+        m_spriteArrays.Clear();
+        m_graphicsMemory->GarbageCollect();
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
+#pragma endregion
+
 #pragma region Message Handlers
 // Message handlers
 void Game::OnSuspending()
@@ -454,6 +833,8 @@ void Game::CreateDeviceDependentResources()
         m_spriteBatchSampler = std::make_unique<SpriteBatch>(device, resourceUpload, pd);
     }
 
+    m_bulkSprites = std::make_unique<DX::BulkSpriteBatch>(device, rtState, &CommonStates::NonPremultiplied);
+
 #ifdef GAMMA_CORRECT_RENDERING
     constexpr DDS_LOADER_FLAGS loadFlags = DDS_LOADER_FORCE_SRGB;
 #else
@@ -500,6 +881,7 @@ void Game::CreateWindowSizeDependentResources()
 
     m_spriteBatch->SetViewport(viewport);
     m_spriteBatchSampler->SetViewport(viewport);
+    m_bulkSprites->SetViewport(viewport);
 
 #ifdef XBOX
     unsigned int resflags = DX::DeviceResources::c_Enable4K_UHD;
@@ -512,6 +894,7 @@ void Game::CreateWindowSizeDependentResources()
         static const D3D12_VIEWPORT s_vp1080 = { 0.f, 0.f, 1920.f, 1080.f, D3D12_MIN_DEPTH, D3D12_MAX_DEPTH };
         m_spriteBatch->SetViewport(s_vp1080);
         m_spriteBatchSampler->SetViewport(s_vp1080);
+        m_bulkSprites->SetViewport(s_vp1080);
     }
 #elif defined(UWP)
     if (m_deviceResources->GetDeviceOptions() & (DX::DeviceResources::c_Enable4K_Xbox | DX::DeviceResources::c_EnableQHD_Xbox))
@@ -520,11 +903,13 @@ void Game::CreateWindowSizeDependentResources()
         static const D3D12_VIEWPORT s_vp1080 = { 0.f, 0.f, 1920.f, 1080.f, D3D12_MIN_DEPTH, D3D12_MAX_DEPTH };
         m_spriteBatch->SetViewport(s_vp1080);
         m_spriteBatchSampler->SetViewport(s_vp1080);
+        m_bulkSprites->SetViewport(s_vp1080);
     }
 
     auto rotation = m_deviceResources->GetRotation();
     m_spriteBatch->SetRotation(rotation);
     m_spriteBatchSampler->SetRotation(rotation);
+    m_bulkSprites->SetRotation(rotation);
 #endif
 }
 
@@ -539,6 +924,7 @@ void Game::OnDeviceLost()
     
     m_spriteBatch.reset();
     m_spriteBatchSampler.reset();
+    m_bulkSprites.reset();
 
     m_states.reset();
     m_graphicsMemory.reset();
@@ -13,6 +13,8 @@
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
 
+#include "BulkSpriteBatch.h"
+
 constexpr uint32_t c_testTimeout = 15000;
 
 // A basic game implementation that creates a D3D12 device and
@@ -86,6 +88,8 @@ private:
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
+    void UnitTests();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>    m_deviceResources;
 
@@ -101,6 +105,8 @@ private:
     std::unique_ptr<DirectX::CommonStates>      m_states;
     std::unique_ptr<DirectX::SpriteBatch>       m_spriteBatch;
     std::unique_ptr<DirectX::SpriteBatch>       m_spriteBatchSampler;
+    std::unique_ptr<DX::BulkSpriteBatch>        m_bulkSprites;
+    DX::SpriteArrays                            m_spriteArrays;
 
     std::unique_ptr<DirectX::DescriptorHeap>    m_resourceDescriptors;
 
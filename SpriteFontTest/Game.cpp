@@ -12,6 +12,8 @@
 #include "pch.h"
 #include "Game.h"
 
+#include "CpuTimer.h"
+
 #define GAMMA_CORRECT_RENDERING
 
 #ifdef __clang__
@@ -22,6 +24,7 @@
 #pragma warning(disable : 4061)
 
 extern void ExitGame() noexcept;
+extern bool g_benchmarks;
 
 using namespace DirectX;
 using namespace DirectX::SimpleMath;
@@ -39,6 +42,28 @@ namespace
 #else
     const XMVECTORF32 c_clearColor = Colors::CornflowerBlue;
 #endif
+
+    // Draws through the layout cache when one is given, otherwise straight through SpriteFont.
+    template<typename TChar>
+    void DrawCachedString(SpriteBatch* spriteBatch, const SpriteFont& font, DX::TextLayoutCache* layouts, _In_z_ const TChar* text,
+        XMFLOAT2 const& position, FXMVECTOR color = Colors::White, float rotation = 0, XMFLOAT2 const& origin = XMFLOAT2(0, 0),
+        float scale = 1, SpriteEffects effects = SpriteEffects_None)
+    {
+        if (layouts)
+        {
+            layouts->Get(font, text).Draw(spriteBatch, position, color, rotation, origin, scale, effects);
+        }
+        else
+        {
+            font.DrawString(spriteBatch, text, position, color, rotation, origin, scale, effects);
+        }
+    }
+
+    template<typename TChar>
+    XMVECTOR MeasureCachedString(const SpriteFont& font, DX::TextLayoutCache* layouts, _In_z_ const TChar* text)
+    {
+        return layouts ? layouts->Get(font, text).Measure() : font.MeasureString(text);
+    }
 }
 
 static_assert(std::is_nothrow_move_constructible<SpriteFont>::value, "Move Ctor.");
@@ -47,6 +72,7 @@ static_assert(std::is_nothrow_move_assignable<SpriteFont>::value, "Move Assign."
 Game::Game() noexcept(false) :
     m_frame(0),
     m_showUTF8(false),
+    m_useTextLayouts(false),
     m_delay(0)
 {
 #ifdef GAMMA_CORRECT_RENDERING
@@ -191,6 +217,11 @@ void Game::Update(DX::StepTimer const& timer)
         assert(m_spriteBatch->GetRotation() == DXGI_MODE_ROTATION_ROTATE180);
     }
 
+    if (m_keyboardButtons.IsKeyPressed(Keyboard::L) || (m_gamePadButtons.x == GamePad::ButtonStateTracker::PRESSED))
+    {
+        m_useTextLayouts = !m_useTextLayouts;
+    }
+
     if (m_keyboardButtons.IsKeyPressed(Keyboard::Space) || (m_gamePadButtons.y == GamePad::ButtonStateTracker::PRESSED))
     {
         m_showUTF8 = !m_showUTF8;
@@ -251,73 +282,78 @@ void Game::Render()
     ID3D12DescriptorHeap* heaps[] = { m_resourceDescriptors->Heap() };
     commandList->SetDescriptorHeaps(1, heaps);
 
+    // Unchanged strings replay a cached glyph run; the rest are laid out once per change.
+    // Off by default, so this test shows what SpriteFont::DrawString itself renders; L or the
+    // X button switches to the cache to compare the two.
+    DX::TextLayoutCache* layouts = m_useTextLayouts ? &m_textLayouts : nullptr;
+
     m_spriteBatch->Begin(commandList);
 
     float time = 60.f * static_cast<float>(m_timer.GetTotalSeconds());
 
     if (m_showUTF8)
     {
-        m_comicFont->DrawString(m_spriteBatch.get(), "Hello, world!", XMFLOAT2(0, 0));
-        m_italicFont->DrawString(m_spriteBatch.get(), "This text is in italics.\nIs it well spaced?", XMFLOAT2(220, 0));
-        m_scriptFont->DrawString(m_spriteBatch.get(), "Script font, yo...", XMFLOAT2(0, 50));
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, "Hello, world!", XMFLOAT2(0, 0));
+        DrawCachedString(m_spriteBatch.get(), *m_italicFont, layouts, "This text is in italics.\nIs it well spaced?", XMFLOAT2(220, 0));
+        DrawCachedString(m_spriteBatch.get(), *m_scriptFont, layouts, "Script font, yo...", XMFLOAT2(0, 50));
 
         SpriteEffects flip = (SpriteEffects)((int)(time / 100) & 3);
-        m_multicoloredFont->DrawString(m_spriteBatch.get(), "OMG it's full of stars!", XMFLOAT2(610, 130), Colors::White, XM_PIDIV2, XMFLOAT2(0, 0), 1, flip);
+        DrawCachedString(m_spriteBatch.get(), *m_multicoloredFont, layouts, "OMG it's full of stars!", XMFLOAT2(610, 130), Colors::White, XM_PIDIV2, XMFLOAT2(0, 0), 1, flip);
 
-        m_comicFont->DrawString(m_spriteBatch.get(), u8"This is a larger block\nof text using a\nfont scaled to a\nsmaller size.\nSome c\xffha\xferac\xfdte\xffr\xfas are not in the font, but should show up as hyphens.", XMFLOAT2(10, 90), Colors::Black, 0, XMFLOAT2(0, 0), 0.5f);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, u8"This is a larger block\nof text using a\nfont scaled to a\nsmaller size.\nSome c\xffha\xferac\xfdte\xffr\xfas are not in the font, but should show up as hyphens.", XMFLOAT2(10, 90), Colors::Black, 0, XMFLOAT2(0, 0), 0.5f);
 
         char tmp[256] = {};
         sprintf_s(tmp, "%llu frames", m_frame);
 
-        m_nonproportionalFont->DrawString(m_spriteBatch.get(), tmp, XMFLOAT2(201, 130), Colors::Black);
-        m_nonproportionalFont->DrawString(m_spriteBatch.get(), tmp, XMFLOAT2(200, 131), Colors::Black);
-        m_nonproportionalFont->DrawString(m_spriteBatch.get(), tmp, XMFLOAT2(200, 130), red);
+        DrawCachedString(m_spriteBatch.get(), *m_nonproportionalFont, layouts, tmp, XMFLOAT2(201, 130), Colors::Black);
+        DrawCachedString(m_spriteBatch.get(), *m_nonproportionalFont, layouts, tmp, XMFLOAT2(200, 131), Colors::Black);
+        DrawCachedString(m_spriteBatch.get(), *m_nonproportionalFont, layouts, tmp, XMFLOAT2(200, 130), red);
 
         float scale = sin(time / 100) + 1;
         auto spinText = "Spinning\nlike a cat";
-        Vector2 size = m_comicFont->MeasureString(spinText);
-        m_comicFont->DrawString(m_spriteBatch.get(), spinText, Vector2(150, 350), blue, time / 60, size / 2, scale);
+        Vector2 size = MeasureCachedString(*m_comicFont, layouts, spinText);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, spinText, Vector2(150, 350), blue, time / 60, size / 2, scale);
 
         auto mirrorText = "It's a\nmirror...";
-        Vector2 mirrorSize = m_comicFont->MeasureString(mirrorText);
-        m_comicFont->DrawString(m_spriteBatch.get(), mirrorText, Vector2(400, 400), Colors::Black, 0, mirrorSize * Vector2(0, 1), 1, SpriteEffects_None);
-        m_comicFont->DrawString(m_spriteBatch.get(), mirrorText, Vector2(400, 400), gray, 0, mirrorSize * Vector2(1, 1), 1, SpriteEffects_FlipHorizontally);
-        m_comicFont->DrawString(m_spriteBatch.get(), mirrorText, Vector2(400, 400), gray, 0, mirrorSize * Vector2(0, 0), 1, SpriteEffects_FlipVertically);
-        m_comicFont->DrawString(m_spriteBatch.get(), mirrorText, Vector2(400, 400), dgray, 0, mirrorSize * Vector2(1, 0), 1, SpriteEffects_FlipBoth);
+        Vector2 mirrorSize = MeasureCachedString(*m_comicFont, layouts, mirrorText);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, mirrorText, Vector2(400, 400), Colors::Black, 0, mirrorSize * Vector2(0, 1), 1, SpriteEffects_None);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, mirrorText, Vector2(400, 400), gray, 0, mirrorSize * Vector2(1, 1), 1, SpriteEffects_FlipHorizontally);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, mirrorText, Vector2(400, 400), gray, 0, mirrorSize * Vector2(0, 0), 1, SpriteEffects_FlipVertically);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, mirrorText, Vector2(400, 400), dgray, 0, mirrorSize * Vector2(1, 0), 1, SpriteEffects_FlipBoth);
 
-        m_japaneseFont->DrawString(m_spriteBatch.get(), L"\x79C1\x306F\x65E5\x672C\x8A9E\x304C\x8A71\x305B\x306A\x3044\x306E\x3067\x3001\n\x79C1\x306F\x3053\x308C\x304C\x4F55\x3092\x610F\x5473\x3059\x308B\x306E\x304B\x308F\x304B\x308A\x307E\x305B\x3093", XMFLOAT2(10, 512));
+        DrawCachedString(m_spriteBatch.get(), *m_japaneseFont, layouts, L"\x79C1\x306F\x65E5\x672C\x8A9E\x304C\x8A71\x305B\x306A\x3044\x306E\x3067\x3001\n\x79C1\x306F\x3053\x308C\x304C\x4F55\x3092\x610F\x5473\x3059\x308B\x306E\x304B\x308F\x304B\x308A\x307E\x305B\x3093", XMFLOAT2(10, 512));
     }
     else
     {
-        m_comicFont->DrawString(m_spriteBatch.get(), L"Hello, world!", XMFLOAT2(0, 0));
-        m_italicFont->DrawString(m_spriteBatch.get(), L"This text is in italics.\nIs it well spaced?", XMFLOAT2(220, 0));
-        m_scriptFont->DrawString(m_spriteBatch.get(), L"Script font, yo...", XMFLOAT2(0, 50));
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, L"Hello, world!", XMFLOAT2(0, 0));
+        DrawCachedString(m_spriteBatch.get(), *m_italicFont, layouts, L"This text is in italics.\nIs it well spaced?", XMFLOAT2(220, 0));
+        DrawCachedString(m_spriteBatch.get(), *m_scriptFont, layouts, L"Script font, yo...", XMFLOAT2(0, 50));
 
         SpriteEffects flip = (SpriteEffects)((int)(time / 100) & 3);
-        m_multicoloredFont->DrawString(m_spriteBatch.get(), L"OMG it's full of stars!", XMFLOAT2(610, 130), Colors::White, XM_PIDIV2, XMFLOAT2(0, 0), 1, flip);
+        DrawCachedString(m_spriteBatch.get(), *m_multicoloredFont, layouts, L"OMG it's full of stars!", XMFLOAT2(610, 130), Colors::White, XM_PIDIV2, XMFLOAT2(0, 0), 1, flip);
 
-        m_comicFont->DrawString(m_spriteBatch.get(), L"This is a larger block\nof text using a\nfont scaled to a\nsmaller size.\nSome c\x1234ha\x1543rac\x2453te\x1634r\x1563s are not in the font, but should show up as hyphens.", XMFLOAT2(10, 90), Colors::Black, 0, XMFLOAT2(0, 0), 0.5f);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, L"This is a larger block\nof text using a\nfont scaled to a\nsmaller size.\nSome c\x1234ha\x1543rac\x2453te\x1634r\x1563s are not in the font, but should show up as hyphens.", XMFLOAT2(10, 90), Colors::Black, 0, XMFLOAT2(0, 0), 0.5f);
 
         wchar_t tmp[256] = {};
         swprintf_s(tmp, L"%llu frames", m_frame);
 
-        m_nonproportionalFont->DrawString(m_spriteBatch.get(), tmp, XMFLOAT2(201, 130), Colors::Black);
-        m_nonproportionalFont->DrawString(m_spriteBatch.get(), tmp, XMFLOAT2(200, 131), Colors::Black);
-        m_nonproportionalFont->DrawString(m_spriteBatch.get(), tmp, XMFLOAT2(200, 130), red);
+        DrawCachedString(m_spriteBatch.get(), *m_nonproportionalFont, layouts, tmp, XMFLOAT2(201, 130), Colors::Black);
+        DrawCachedString(m_spriteBatch.get(), *m_nonproportionalFont, layouts, tmp, XMFLOAT2(200, 131), Colors::Black);
+        DrawCachedString(m_spriteBatch.get(), *m_nonproportionalFont, layouts, tmp, XMFLOAT2(200, 130), red);
 
         float scale = sin(time / 100) + 1;
         auto spinText = L"Spinning\nlike a cat";
-        Vector2 size = m_comicFont->MeasureString(spinText);
-        m_comicFont->DrawString(m_spriteBatch.get(), spinText, Vector2(150, 350), blue, time / 60, size / 2, scale);
+        Vector2 size = MeasureCachedString(*m_comicFont, layouts, spinText);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, spinText, Vector2(150, 350), blue, time / 60, size / 2, scale);
 
         auto mirrorText = L"It's a\nmirror...";
-        Vector2 mirrorSize = m_comicFont->MeasureString(mirrorText);
-        m_comicFont->DrawString(m_spriteBatch.get(), mirrorText, Vector2(400, 400), Colors::Black, 0, mirrorSize * Vector2(0, 1), 1, SpriteEffects_None);
-        m_comicFont->DrawString(m_spriteBatch.get(), mirrorText, Vector2(400, 400), gray, 0, mirrorSize * Vector2(1, 1), 1, SpriteEffects_FlipHorizontally);
-        m_comicFont->DrawString(m_spriteBatch.get(), mirrorText, Vector2(400, 400), gray, 0, mirrorSize * Vector2(0, 0), 1, SpriteEffects_FlipVertically);
-        m_comicFont->DrawString(m_spriteBatch.get(), mirrorText, Vector2(400, 400), dgray, 0, mirrorSize * Vector2(1, 0), 1, SpriteEffects_FlipBoth);
+        Vector2 mirrorSize = MeasureCachedString(*m_comicFont, layouts, mirrorText);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, mirrorText, Vector2(400, 400), Colors::Black, 0, mirrorSize * Vector2(0, 1), 1, SpriteEffects_None);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, mirrorText, Vector2(400, 400), gray, 0, mirrorSize * Vector2(1, 1), 1, SpriteEffects_FlipHorizontally);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, mirrorText, Vector2(400, 400), gray, 0, mirrorSize * Vector2(0, 0), 1, SpriteEffects_FlipVertically);
+        DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, mirrorText, Vector2(400, 400), dgray, 0, mirrorSize * Vector2(1, 0), 1, SpriteEffects_FlipBoth);
 
-        m_japaneseFont->DrawString(m_spriteBatch.get(), L"\x79C1\x306F\x65E5\x672C\x8A9E\x304C\x8A71\x305B\x306A\x3044\x306E\x3067\x3001\n\x79C1\x306F\x3053\x308C\x304C\x4F55\x3092\x610F\x5473\x3059\x308B\x306E\x304B\x308F\x304B\x308A\x307E\x305B\x3093", XMFLOAT2(10, 512));
+        DrawCachedString(m_spriteBatch.get(), *m_japaneseFont, layouts, L"\x79C1\x306F\x65E5\x672C\x8A9E\x304C\x8A71\x305B\x306A\x3044\x306E\x3067\x3001\n\x79C1\x306F\x3053\x308C\x304C\x4F55\x3092\x610F\x5473\x3059\x308B\x306E\x304B\x308F\x304B\x308A\x307E\x305B\x3093", XMFLOAT2(10, 512));
     }
 
     {
@@ -348,16 +384,16 @@ void Game::Render()
         if (!MultiByteToWideChar(cp, 0, ascii, i, unicode, 256))
             swprintf_s(unicode, L"<ERROR: %u>\n", GetLastError());
 
-        m_consolasFont->DrawString(m_spriteBatch.get(), unicode, XMFLOAT2(10, 600), cyan);
+        DrawCachedString(m_spriteBatch.get(), *m_consolasFont, layouts, unicode, XMFLOAT2(10, 600), cyan);
     }
 
     m_spriteBatch->End();
 
     m_spriteBatch->Begin(commandList);
 
-    m_ctrlFont->DrawString(m_spriteBatch.get(), L" !\"\n#$%\n&'()\n*+,-", XMFLOAT2(650, 130), Colors::White, 0.f, XMFLOAT2(0.f, 0.f), 0.5f);
+    DrawCachedString(m_spriteBatch.get(), *m_ctrlFont, layouts, L" !\"\n#$%\n&'()\n*+,-", XMFLOAT2(650, 130), Colors::White, 0.f, XMFLOAT2(0.f, 0.f), 0.5f);
 
-    m_ctrlOneFont->DrawString(m_spriteBatch.get(), L" !\"\n#$%\n&'()\n*+,-", XMFLOAT2(950, 130), Colors::White, 0.f, XMFLOAT2(0.f, 0.f), 0.5f);
+    DrawCachedString(m_spriteBatch.get(), *m_ctrlOneFont, layouts, L" !\"\n#$%\n&'()\n*+,-", XMFLOAT2(950, 130), Colors::White, 0.f, XMFLOAT2(0.f, 0.f), 0.5f);
 
 #ifndef XBOX
     {
@@ -383,14 +419,14 @@ void Game::Render()
         {
             wchar_t tmp[16] = {};
             swprintf_s(tmp, L"%d\n", x);
-            m_nonproportionalFont->DrawString(m_spriteBatch.get(), tmp, XMFLOAT2(float(x), float(h - 50)), yellow);
+            DrawCachedString(m_spriteBatch.get(), *m_nonproportionalFont, layouts, tmp, XMFLOAT2(float(x), float(h - 50)), yellow);
         }
 
         for (LONG y = 0; y < h; y += 100)
         {
             wchar_t tmp[16] = {};
             swprintf_s(tmp, L"%d\n", y);
-            m_nonproportionalFont->DrawString(m_spriteBatch.get(), tmp, XMFLOAT2(float(w - 100), float(y)), red);
+            DrawCachedString(m_spriteBatch.get(), *m_nonproportionalFont, layouts, tmp, XMFLOAT2(float(w - 100), float(y)), red);
         }
     }
 #endif
@@ -402,7 +438,7 @@ void Game::Render()
     const RECT r = { 640, 20, 740, 38 };
     commandList->RSSetScissorRects(1, &r);
 
-    m_comicFont->DrawString(m_spriteBatch.get(), L"Clipping!", XMFLOAT2(640, 0), dgreen);
+    DrawCachedString(m_spriteBatch.get(), *m_comicFont, layouts, L"Clipping!", XMFLOAT2(640, 0), dgreen);
 
     m_spriteBatch->End();
 
@@ -565,6 +601,27 @@ void Game::CreateDeviceDependentResources()
     m_consolasFont = std::make_unique<SpriteFont>(device, resourceUpload, L"consolas.spritefont",
         m_resourceDescriptors->GetCpuHandle(Descriptors::ConsolasFont), m_resourceDescriptors->GetGpuHandle(Descriptors::ConsolasFont));
 
+    // Constant-time glyph lookup for the text layouts of every font.
+    const SpriteFont* fonts[Descriptors::Count] =
+    {
+        m_comicFont.get(),
+        m_italicFont.get(),
+        m_scriptFont.get(),
+        m_nonproportionalFont.get(),
+        m_multicoloredFont.get(),
+        m_japaneseFont.get(),
+        m_ctrlFont.get(),
+        m_ctrlOneFont.get(),
+        m_consolasFont.get(),
+    };
+
+    m_glyphTables = std::make_unique<DX::GlyphTable[]>(Descriptors::Count);
+    for (size_t j = 0; j < Descriptors::Count; ++j)
+    {
+        m_glyphTables[j].Build(*fonts[j]);
+        m_textLayouts.SetGlyphTable(*fonts[j], &m_glyphTables[j]);
+    }
+
     auto uploadResourcesFinished = resourceUpload.End(m_deviceResources->GetCommandQueue());
 
     uploadResourcesFinished.wait();
@@ -613,6 +670,10 @@ void Game::OnDeviceLost()
     m_ctrlOneFont.reset();
     m_consolasFont.reset();
 
+    // Layouts and glyph tables point into the fonts' glyphs.
+    m_textLayouts.Reset();
+    m_glyphTables.reset();
+
     m_resourceDescriptors.reset();
     m_spriteBatch.reset();
     m_graphicsMemory.reset();
@@ -629,6 +690,23 @@ void Game::OnDeviceRestored()
 #endif
 #pragma endregion
 
+namespace
+{
+    // Stands in for SpriteBatch to capture what a text layout queues.
+    struct GlyphRecorder
+    {
+        D3D12_GPU_DESCRIPTOR_HANDLE     texture = {};
+        std::vector<const RECT*>        sources;
+
+        void XM_CALLCONV Draw(D3D12_GPU_DESCRIPTOR_HANDLE textureHandle, XMUINT2 const&, FXMVECTOR,
+            RECT const* sourceRectangle, FXMVECTOR, float, FXMVECTOR, GXMVECTOR, SpriteEffects, float)
+        {
+            texture = textureHandle;
+            sources.push_back(sourceRectangle);
+        }
+    };
+}
+
 void Game::UnitTests()
 {
     OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
@@ -905,6 +983,416 @@ void Game::UnitTests()
         }
     }
 
+    // TextLayout tests
+    {
+        const wchar_t* japanese = L"\x79C1\x306F\x65E5\x672C\x8A9E\x304C\x8A71\x305B\x306A\x3044\x306E\x3067\x3001\n\x79C1\x306F\x3053\x308C\x304C\x4F55\x3092\x610F\x5473\x3059\x308B\x306E\x304B\x308F\x304B\x308A\x307E\x305B\x3093";
+
+        const struct
+        {
+            const SpriteFont* font;
+            const wchar_t* text;
+        } layoutTests[] =
+        {
+            { m_comicFont.get(), L"Spinning\nlike a cat" },
+            { m_comicFont.get(), L"  Spinning like a cat " },
+            { m_comicFont.get(), L"aeiou" },
+            { m_comicFont.get(), L"a e i o u" },
+            { m_comicFont.get(), L"aeiou " },
+            { m_comicFont.get(), L"  " },
+            { m_comicFont.get(), L"" },
+            { m_comicFont.get(), L"\r\nCarriage\r\nreturns\r\n" },
+            { m_comicFont.get(), L"Some c\x1234ha\x1543rac\x2453te\x1634r\x1563s are not in the font" },
+            { m_italicFont.get(), L"This text is in italics.\nIs it well spaced?" },
+            { m_scriptFont.get(), L"Script font, yo..." },
+            { m_nonproportionalFont.get(), L"1234567 frames" },
+            { m_japaneseFont.get(), japanese },
+            { m_ctrlFont.get(), L" !\"\n#$%\n&'()\n*+,-" },
+        };
+
+        const auto testPos = XMFLOAT2{ 10.5f, 15.25f };
+
+        char buff[256] = {};
+        for (size_t j = 0; j < std::size(layoutTests); ++j)
+        {
+            auto const& test = layoutTests[j];
+            const DX::TextLayout layout(*test.font, test.text);
+
+            for (const bool ignoreWhitespace : { true, false })
+            {
+                const RECT expected = test.font->MeasureDrawBounds(test.text, testPos, ignoreWhitespace);
+                const RECT bounds = layout.MeasureDrawBounds(testPos, ignoreWhitespace);
+
+                if (!XMVector2Equal(layout.Measure(ignoreWhitespace), test.font->MeasureString(test.text, ignoreWhitespace))
+                    || bounds.left != expected.left || bounds.top != expected.top
+                    || bounds.right != expected.right || bounds.bottom != expected.bottom)
+                {
+                    sprintf_s(buff, "FAILED: TextLayout measure #%zu (%s)\n", j, ignoreWhitespace ? "ignoreSpace" : "!ignoreSpace");
+                    OutputDebugStringA(buff);
+                    success = false;
+                }
+            }
+        }
+
+        // Replay queues one sprite per glyph from the font's sprite sheet, in string order,
+        // skipping blank whitespace glyphs as DrawString does.
+        for (auto const text : { L"Hello\nworld", L" Hello, wide\n world \t!" })
+        {
+            const DX::TextLayout layout(*m_comicFont, text);
+
+            GlyphRecorder recorder;
+            layout.Draw(&recorder, XMFLOAT2(100, 100));
+
+            std::vector<const RECT*> expected;
+            for (size_t j = 0; text[j]; ++j)
+            {
+                if (text[j] == L'\n')
+                    continue;
+
+                auto const glyph = m_comicFont->FindGlyph(text[j]);
+                if (!iswspace(text[j])
+                    || (glyph->Subrect.right - glyph->Subrect.left) > 1
+                    || (glyph->Subrect.bottom - glyph->Subrect.top) > 1)
+                {
+                    expected.push_back(&glyph->Subrect);
+                }
+            }
+
+            if (recorder.texture.ptr != m_comicFont->GetSpriteSheet().ptr
+                || recorder.sources != expected
+                || layout.GetGlyphCount() != wcslen(text) - 1)
+            {
+                sprintf_s(buff, "FAILED: TextLayout draw \"%ls\"\n", text);
+                OutputDebugStringA(buff);
+                success = false;
+            }
+        }
+
+        // The cache hits on font and string, keeps UTF-8 and UTF-16 apart, and rebuilds after a font change.
+        {
+            DX::TextLayoutCache cache(2);
+
+            auto const& first = cache.Get(*m_comicFont, L"It's a\nmirror...");
+            auto const& second = cache.Get(*m_comicFont, L"It's a\nmirror...");
+            auto const& utf8 = cache.Get(*m_comicFont, "It's a\nmirror...");
+
+            if (&first != &second || &first == &utf8
+                || cache.GetHits() != 1 || cache.GetMisses() != 2
+                || !XMVector2Equal(first.Measure(), utf8.Measure()))
+            {
+                OutputDebugStringA("FAILED: TextLayoutCache hits\n");
+                success = false;
+            }
+
+            std::ignore = cache.Get(*m_italicFont, L"It's a\nmirror...");
+            if (cache.GetCount() != 2 || cache.GetEvictions() != 1)
+            {
+                OutputDebugStringA("FAILED: TextLayoutCache eviction\n");
+                success = false;
+            }
+
+            const float lineSpacing = m_comicFont->GetLineSpacing();
+            m_comicFont->SetLineSpacing(lineSpacing * 2.f);
+
+            auto const& respaced = cache.Get(*m_comicFont, "It's a\nmirror...");
+            if (!XMVector2Equal(respaced.Measure(), m_comicFont->MeasureString("It's a\nmirror...")))
+            {
+                OutputDebugStringA("FAILED: TextLayoutCache font change\n");
+                success = false;
+            }
+
+            m_comicFont->SetLineSpacing(lineSpacing);
+        }
+
+        // Benchmark: long ASCII (UTF-8) and Japanese (UTF-16) strings, every frame through
+        // SpriteFont, a cache hit, or a layout the caller owns.
+        if (g_benchmarks)
+        {
+            std::string ascii;
+            for (size_t j = 0; ascii.size() < 4000; ++j)
+            {
+                ascii += (j & 1) ? "The quick brown fox jumps over the lazy dog.\n" : "The quick brown fox jumps over the lazy dog. ";
+            }
+
+            std::wstring longJapanese;
+            while (longJapanese.size() < 4000)
+            {
+                longJapanese += japanese;
+                longJapanese += L'\n';
+            }
+
+            auto device = m_deviceResources->GetD3DDevice();
+
+            ComPtr<ID3D12CommandAllocator> allocator;
+            DX::ThrowIfFailed(device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT,
+                IID_GRAPHICS_PPV_ARGS(allocator.GetAddressOf())));
+
+            ComPtr<ID3D12GraphicsCommandList> commandList;
+            DX::ThrowIfFailed(device->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, allocator.Get(), nullptr,
+                IID_GRAPHICS_PPV_ARGS(commandList.GetAddressOf())));
+
+            ID3D12DescriptorHeap* heaps[] = { m_resourceDescriptors->Heap() };
+
+            constexpr size_t c_measureIterations = 200;
+            constexpr size_t c_drawIterations = 20;
+
+            // Milliseconds per iteration.
+            auto timeMeasure = [&](auto&& measure)
+                {
+                    float sink = 0;
+
+                    DX::CpuTimer timer;
+                    timer.Start();
+                    for (size_t j = 0; j < c_measureIterations; ++j)
+                    {
+                        sink += XMVectorGetX(measure());
+                    }
+                    timer.Stop();
+
+                    std::ignore = sink;
+                    return timer.GetElapsedMilliseconds() / double(c_measureIterations);
+                };
+
+            // The command list is only recorded, never executed.
+            auto timeDraw = [&](auto&& draw)
+                {
+                    commandList->SetDescriptorHeaps(static_cast<UINT>(std::size(heaps)), heaps);
+
+                    DX::CpuTimer timer;
+                    timer.Start();
+                    for (size_t j = 0; j < c_drawIterations; ++j)
+                    {
+                        m_spriteBatch->Begin(commandList.Get());
+                        draw();
+                        m_spriteBatch->End();
+                    }
+                    timer.Stop();
+
+                    // Retire this pass's upload pages before the next one.
+                    DX::ThrowIfFailed(commandList->Close());
+                    m_graphicsMemory->Commit(m_deviceResources->GetCommandQueue());
+                    m_deviceResources->WaitForGpu();
+                    DX::ThrowIfFailed(allocator->Reset());
+                    DX::ThrowIfFailed(commandList->Reset(allocator.Get(), nullptr));
+
+                    return timer.GetElapsedMilliseconds() / double(c_drawIterations);
+                };
+
+            auto benchmark = [&](const char* name, const SpriteFont& font, auto text)
+                {
+                    DX::TextLayoutCache cache;
+                    const DX::TextLayout owned = cache.Get(font, text);
+
+                    DX::CpuTimer timer;
+                    timer.Start();
+                    DX::TextLayoutCache rebuild;
+                    for (size_t j = 0; j < c_measureIterations; ++j)
+                    {
+                        rebuild.Clear();
+                        std::ignore = rebuild.Get(font, text);
+                    }
+                    timer.Stop();
+                    const double build = timer.GetElapsedMilliseconds() / double(c_measureIterations);
+
+                    const double measureFont = timeMeasure([&] { return font.MeasureString(text); });
+                    const double measureCache = timeMeasure([&] { return cache.Get(font, text).Measure(); });
+                    const double measureLayout = timeMeasure([&] { return owned.Measure(); });
+
+                    const double drawFont = timeDraw([&] { font.DrawString(m_spriteBatch.get(), text, XMFLOAT2(0, 0)); });
+                    const double drawCache = timeDraw([&] { cache.Get(font, text).Draw(m_spriteBatch.get(), XMFLOAT2(0, 0)); });
+                    const double drawLayout = timeDraw([&] { owned.Draw(m_spriteBatch.get(), XMFLOAT2(0, 0)); });
+
+                    sprintf_s(buff, "TextLayout %s (%zu glyphs): build %.4f ms\n", name, owned.GetGlyphCount(), build);
+                    OutputDebugStringA(buff);
+                    sprintf_s(buff, "    MeasureString %.4f ms, cached %.4f ms, owned %.4f ms\n", measureFont, measureCache, measureLayout);
+                    OutputDebugStringA(buff);
+                    sprintf_s(buff, "    DrawString %.4f ms, cached %.4f ms, owned %.4f ms\n", drawFont, drawCache, drawLayout);
+                    OutputDebugStringA(buff);
+                };
+
+            benchmark("ASCII UTF-8", *m_comicFont, ascii.c_str());
+            benchmark("Japanese UTF-16", *m_japaneseFont, longJapanese.c_str());
+
+            m_graphicsMemory->GarbageCollect();
+        }
+    }
+
+    // GlyphTable tests
+    {
+        char buff[256] = {};
+
+        const SpriteFont* fonts[] =
+        {
+            m_comicFont.get(), m_italicFont.get(), m_scriptFont.get(), m_nonproportionalFont.get(), m_multicoloredFont.get(),
+            m_japaneseFont.get(), m_ctrlFont.get(), m_ctrlOneFont.get(), m_consolasFont.get()
+        };
+
+        // Every UTF-16 code unit maps to FindGlyph's glyph, or to nothing.
+        auto checkTable = [&](const DX::GlyphTable& table, const SpriteFont& font)
+            {
+                size_t glyphs = 0;
+                for (uint32_t character = 0; character < 0x10000u; ++character)
+                {
+                    const auto c = static_cast<wchar_t>(character);
+                    const bool contains = font.ContainsCharacter(c);
+                    glyphs += contains ? 1 : 0;
+
+                    if (table.Find(character) != (contains ? font.FindGlyph(c) : nullptr))
+                        return false;
+                }
+                return table.GetGlyphCount() == glyphs && !table.Find(0x10000u);
+            };
+
+        for (size_t j = 0; j < std::size(fonts); ++j)
+        {
+            if (!checkTable(m_glyphTables[j], *fonts[j]))
+            {
+                sprintf_s(buff, "FAILED: GlyphTable font #%zu\n", j);
+                OutputDebugStringA(buff);
+                success = false;
+            }
+        }
+
+        // A 10K-glyph font (Latin, Greek, Cyrillic, kana, CJK) and mixed-script text, some of it
+        // missing from the font. Only timing runs use the full text and repeat it.
+        std::vector<SpriteFont::Glyph> glyphs;
+        {
+            auto const& source = *m_comicFont->FindGlyph('-');
+            auto addRange = [&](uint32_t first, uint32_t last)
+                {
+                    for (uint32_t c = first; c <= last && glyphs.size() < 10000; ++c)
+                    {
+                        SpriteFont::Glyph glyph = source;
+                        glyph.Character = c;
+                        glyph.XAdvance = float(c % 3);
+                        glyphs.push_back(glyph);
+                    }
+                };
+
+            addRange(0x20, 0x7E);
+            addRange(0xA0, 0xFF);
+            addRange(0x370, 0x3FF);
+            addRange(0x400, 0x4FF);
+            addRange(0x3040, 0x30FF);
+            addRange(0x4E00, 0x9FFF);
+        }
+
+        SpriteFont bigFont(m_comicFont->GetSpriteSheet(), m_comicFont->GetSpriteSheetSize(), glyphs.data(), glyphs.size(), 30.f);
+        bigFont.SetDefaultCharacter('?');
+
+        DX::CpuTimer timer;
+        timer.Start();
+        DX::GlyphTable bigTable;
+        bigTable.Build(bigFont);
+        timer.Stop();
+        const double buildTime = timer.GetElapsedMilliseconds();
+
+        if (bigTable.GetGlyphCount() != 10000 || !checkTable(bigTable, bigFont))
+        {
+            OutputDebugStringA("FAILED: GlyphTable 10K glyphs\n");
+            success = false;
+        }
+
+        std::wstring text;
+        {
+            std::default_random_engine generator(47);
+            std::uniform_int_distribution<uint32_t> script(0, 19);
+            std::uniform_int_distribution<uint32_t> offset(0, 0x7FF);
+
+            constexpr wchar_t c_scriptBase[] =
+            {
+                0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20,     // ASCII
+                0x400, 0x400,                                       // Cyrillic
+                0x3040, 0x3040, 0x3040,                             // kana
+                0x4E00, 0x4E00, 0x4E00, 0x4E00,                     // CJK, partly past the font's last glyph
+                0xAC00,                                             // Hangul: missing
+                0x370,                                              // Greek
+                0x0A,                                               // line breaks
+            };
+
+            const size_t textLength = g_benchmarks ? 65536 : 4096;
+            while (text.size() < textLength)
+            {
+                const wchar_t base = c_scriptBase[script(generator)];
+                switch (base)
+                {
+                case 0x20:      text += static_cast<wchar_t>(0x20 + offset(generator) % 0x5F); break;
+                case 0x0A:      text += L'\n'; break;
+                case 0x4E00:    text += static_cast<wchar_t>(0x4E00 + offset(generator) * 8); break;
+                default:        text += static_cast<wchar_t>(base + offset(generator) % 0x60); break;
+                }
+            }
+        }
+
+        const size_t iterations = g_benchmarks ? 20 : 1;
+        auto const defaultGlyph = bigFont.FindGlyph('?');
+
+        uintptr_t sink = 0;
+        timer.Start();
+        for (size_t j = 0; j < iterations; ++j)
+        {
+            for (auto c : text)
+            {
+                sink += reinterpret_cast<uintptr_t>(bigFont.FindGlyph(c));
+            }
+        }
+        timer.Stop();
+        const double findGlyph = timer.GetElapsedMilliseconds();
+
+        uintptr_t tableSink = 0;
+        timer.Start();
+        for (size_t j = 0; j < iterations; ++j)
+        {
+            for (auto c : text)
+            {
+                auto glyph = bigTable.Find(static_cast<uint32_t>(c));
+                tableSink += reinterpret_cast<uintptr_t>(glyph ? glyph : defaultGlyph);
+            }
+        }
+        timer.Stop();
+        const double tableFind = timer.GetElapsedMilliseconds();
+
+        if (sink != tableSink)
+        {
+            OutputDebugStringA("FAILED: GlyphTable mixed-script lookup\n");
+            success = false;
+        }
+
+        DX::TextLayout layout;
+        timer.Start();
+        for (size_t j = 0; j < iterations; ++j)
+        {
+            layout.Build(bigFont, text.c_str());
+        }
+        timer.Stop();
+        const double layoutSearch = timer.GetElapsedMilliseconds();
+        const XMVECTOR searchSize = layout.Measure();
+
+        timer.Start();
+        for (size_t j = 0; j < iterations; ++j)
+        {
+            layout.Build(bigFont, text.c_str(), &bigTable);
+        }
+        timer.Stop();
+        const double layoutTable = timer.GetElapsedMilliseconds();
+
+        if (!XMVector2Equal(searchSize, layout.Measure()))
+        {
+            OutputDebugStringA("FAILED: GlyphTable layout\n");
+            success = false;
+        }
+
+        if (g_benchmarks)
+        {
+            const double perCharacter = 1e6 / double(iterations * text.size());
+            sprintf_s(buff, "GlyphTable 10K glyphs: built in %.3f ms, %zu pages, %zu bytes\n",
+                buildTime, bigTable.GetPageCount(), bigTable.GetSizeInBytes());
+            OutputDebugStringA(buff);
+            sprintf_s(buff, "    lookup %.2f ns/char (FindGlyph %.2f ns/char), layout %.2f ns/char (FindGlyph %.2f ns/char)\n",
+                tableFind * perCharacter, findGlyph * perCharacter, layoutTable * perCharacter, layoutSearch * perCharacter);
+            OutputDebugStringA(buff);
+        }
+    }
+
     OutputDebugStringA(success ? "Passed\n" : "Failed\n");
     OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
 
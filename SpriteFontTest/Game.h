@@ -12,6 +12,7 @@
 
 #include "DirectXTKTest.h"
 #include "StepTimer.h"
+#include "TextLayout.h"
 
 constexpr uint32_t c_testTimeout = 15000;
 
@@ -116,6 +117,9 @@ private:
     std::unique_ptr<DirectX::SpriteFont> m_ctrlOneFont;
     std::unique_ptr<DirectX::SpriteFont> m_consolasFont;
 
+    std::unique_ptr<DX::GlyphTable[]>   m_glyphTables;      // indexed by Descriptors
+    DX::TextLayoutCache                 m_textLayouts;
+
     enum Descriptors
     {
         ComicFont,
@@ -132,5 +136,6 @@ private:
 
     uint64_t    m_frame;
     bool        m_showUTF8;
+    bool        m_useTextLayouts;
     float       m_delay;
 };
@@ -97,13 +97,16 @@
 #include <exception>
 #include <iterator>
 #include <memory>
+#include <random>
 #include <stdexcept>
 #include <string>
 #include <system_error>
 #include <tuple>
 #include <type_traits>
+#include <vector>
 
 #include "DescriptorHeap.h"
+#include "DirectXHelpers.h"
 #include "GamePad.h"
 #include "GraphicsMemory.h"
 #include "Keyboard.h"
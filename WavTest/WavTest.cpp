@@ -35,11 +35,13 @@ struct TestInfo
 
 extern bool Test01();
 extern bool Test02();
+extern bool Test03();
 
 TestInfo g_Tests[] =
 {
     { "WAVFileReader", Test01 },
     { "WaveBankReader", Test02 },
+    { "SoftwareMixer", Test03 },
 };
 
 
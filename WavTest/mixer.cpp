@@ -0,0 +1,338 @@
+//-------------------------------------------------------------------------------------
+// mixer.cpp
+//
+// Copyright (c) Microsoft Corporation.
+//-------------------------------------------------------------------------------------
+
+#pragma warning(push)
+#pragma warning(disable : 4005)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX 1
+#define NODRAWTEXT
+#define NOMCX
+#define NOSERVICE
+#define NOHELP
+#pragma warning(pop)
+
+#include <Windows.h>
+
+#include "WAVFileReader.h"
+#include "WaveBankReader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+#include "SoundCommon.h"
+#include "SoftwareMixer.h"
+
+using namespace DirectX;
+
+namespace
+{
+    struct TestMedia
+    {
+        uint32_t tag;
+        const wchar_t *fname;
+    };
+
+    const TestMedia g_TestMedia[] =
+    {
+        // FormatTag | Filename
+        { WAVE_FORMAT_PCM, L"Audio3DTest\\heli.wav" },
+        { WAVE_FORMAT_PCM, L"SimpleAudioTest\\Alarm01.wav" },
+        { WAVE_FORMAT_ADPCM, L"SimpleAudioTest\\Alarm01_adpcm.wav" },
+        { WAVE_FORMAT_IEEE_FLOAT, L"SimpleAudioTest\\Alarm01_float.wav" },
+        { WAVE_FORMAT_PCM, L"SimpleAudioTest\\tada.wav" },
+    };
+
+    const wchar_t* c_WaveBank = L"SimpleAudioTest\\ADPCMdroid.xwb";
+
+    std::shared_ptr<const DX::SoftwareSound> DecodeWave(_In_ const WAVEFORMATEX* wfx, _In_reads_bytes_(bytes) const uint8_t* data, size_t bytes)
+    {
+        const uint32_t tag = GetFormatTag(wfx);
+        const uint32_t samplesPerBlock = (tag == WAVE_FORMAT_ADPCM)
+            ? reinterpret_cast<const ADPCMWAVEFORMAT*>(wfx)->wSamplesPerBlock : 0u;
+
+        const auto format = DX::SoftwareWaveFormat::Make(tag, wfx->nChannels, wfx->wBitsPerSample,
+            wfx->nSamplesPerSec, wfx->nBlockAlign, samplesPerBlock);
+
+        return std::make_shared<const DX::SoftwareSound>(format, data, bytes);
+    }
+
+    // Mono 16-bit PCM from a list of sample values.
+    std::shared_ptr<const DX::SoftwareSound> MakeSound(const std::vector<int16_t>& samples, uint32_t rate)
+    {
+        const auto format = DX::SoftwareWaveFormat::Make(WAVE_FORMAT_PCM, 1, 16, rate, 2);
+        return std::make_shared<const DX::SoftwareSound>(format,
+            reinterpret_cast<const uint8_t*>(samples.data()), samples.size() * sizeof(int16_t));
+    }
+
+    bool Near(float a, float b)
+    {
+        return fabsf(a - b) <= 1e-5f;
+    }
+
+    // Mono voices playing one of 'sounds' each, spread over 'submixes' and panned across a
+    // stereo output, at a mix of frequency ratios.
+    DX::SoftwareMixer MakeScene(const std::vector<std::shared_ptr<const DX::SoftwareSound>>& sounds,
+        size_t voices, uint32_t submixes)
+    {
+        DX::SoftwareMixer mixer(2, 48000);
+        for (uint32_t j = 1; j < submixes; ++j)
+        {
+            std::ignore = mixer.CreateSubmix(0.5f);
+        }
+
+        for (size_t j = 0; j < voices; ++j)
+        {
+            auto const& sound = sounds[j % sounds.size()];
+            const auto voice = mixer.CreateVoice(sound, uint32_t(j % submixes), true);
+
+            const float pan = float(j % 17) / 16.f;
+            std::vector<float> matrix(size_t(2) * sound->GetChannelCount(), 0.f);
+            for (uint32_t c = 0; c < sound->GetChannelCount(); ++c)
+            {
+                matrix[c] = 1.f - pan;
+                matrix[sound->GetChannelCount() + c] = pan;
+            }
+            mixer.SetVoiceOutputMatrix(voice, matrix.data());
+            mixer.SetVoiceVolume(voice, 1.f / float(voices));
+            mixer.SetVoiceFrequencyRatio(voice, 0.75f + float(j % 5) * 0.125f);
+        }
+
+        return mixer;
+    }
+}
+
+//-------------------------------------------------------------------------------------
+//
+bool Test03()
+{
+    bool success = true;
+
+    // MS ADPCM block: predictor 0, delta 16, samples 200 and 100, then nibbles 1, -1, 7, 7.
+    {
+        const uint8_t block[] = { 0, 16, 0, 200, 0, 100, 0, 0x1F, 0x77 };
+        const int16_t expected[] = { 100, 200, 216, 200, 312, 578 };
+
+        int16_t decoded[6] = {};
+        DX::DecodeMSADPCMBlock(block, 1, 6, decoded);
+        if (memcmp(decoded, expected, sizeof(expected)) != 0)
+        {
+            success = false;
+            printf("ERROR: MS ADPCM block decoded to %d %d %d %d %d %d\n",
+                decoded[0], decoded[1], decoded[2], decoded[3], decoded[4], decoded[5]);
+        }
+    }
+
+    // Routing, volume, and resampling against hand-computed output.
+    {
+        const std::vector<int16_t> ramp = { 0, 1024, 2048, 3072, 4096, 5120, 6144, 7168 };
+        const auto rampSound = MakeSound(ramp, 1000);
+        const auto constant = MakeSound(std::vector<int16_t>(8, 16384), 1000);
+
+        DX::SoftwareMixer mixer(2, 1000, 4);
+        const auto a = mixer.CreateVoice(rampSound);
+        const auto b = mixer.CreateVoice(constant, mixer.CreateSubmix(0.5f));
+
+        const float right[] = { 0.f, 1.f };
+        mixer.SetVoiceOutputMatrix(b, right);
+        mixer.SetVoiceFrequencyRatio(a, 0.5f);
+
+        float output[2 * 10] = {};
+        mixer.Render(output, 10);
+
+        // Half rate walks the ramp in half steps, to both channels by default. The constant
+        // voice only reaches the right channel, at the submix volume, and ends after 8 frames.
+        bool pass = true;
+        for (size_t f = 0; f < 10; ++f)
+        {
+            const float left = float(f) * 512.f / 32768.f;
+            const float rightValue = left + ((f < 8) ? 0.25f : 0.f);
+            if (!Near(output[2 * f], left) || !Near(output[2 * f + 1], rightValue))
+            {
+                pass = false;
+            }
+        }
+
+        if (!pass || mixer.IsVoicePlaying(b) || !mixer.IsVoicePlaying(a))
+        {
+            success = false;
+            printf("ERROR: SoftwareMixer routing or resampling mismatch\n");
+        }
+
+        // A looping voice wraps without a gap.
+        DX::SoftwareMixer looped(1, 1000, 3);
+        std::ignore = looped.CreateVoice(rampSound, DX::SoftwareMixer::MasterSubmix, true);
+
+        float wrapped[20] = {};
+        looped.Render(wrapped, 20);
+        for (size_t f = 0; f < 20; ++f)
+        {
+            if (!Near(wrapped[f], float(ramp[f % ramp.size()]) / 32768.f))
+            {
+                success = false;
+                printf("ERROR: SoftwareMixer loop mismatch at frame %zu\n", f);
+                break;
+            }
+        }
+    }
+
+    // Decode the test media through the existing readers.
+    std::vector<std::shared_ptr<const DX::SoftwareSound>> sounds;
+
+    for (size_t index = 0; index < std::size(g_TestMedia); ++index)
+    {
+        wchar_t szPath[MAX_PATH] = {};
+        DWORD ret = ExpandEnvironmentStringsW(g_TestMedia[index].fname, szPath, MAX_PATH);
+        if (!ret || ret > MAX_PATH)
+        {
+            printf("ERROR: ExpandEnvironmentStrings FAILED\n");
+            return false;
+        }
+
+        std::unique_ptr<uint8_t[]> wavData;
+        WAVData result = {};
+        HRESULT hr = LoadWAVAudioFromFileEx(szPath, wavData, result);
+        if (FAILED(hr))
+        {
+            success = false;
+            printf("Failed loading wav from file (HRESULT %08X):\n%ls\n", static_cast<unsigned int>(hr), szPath);
+            continue;
+        }
+
+        if (GetFormatTag(result.wfx) != g_TestMedia[index].tag)
+        {
+            success = false;
+            printf("ERROR: Unexpected format tag in wav file:\n%ls\n", szPath);
+            continue;
+        }
+
+        try
+        {
+            auto sound = DecodeWave(result.wfx, result.startAudio, result.audioBytes);
+
+            float peak = 0.f;
+            for (uint32_t c = 0; c < sound->GetChannelCount(); ++c)
+            {
+                const float* samples = sound->GetChannel(c);
+                for (size_t f = 0; f < sound->GetFrameCount(); ++f)
+                {
+                    peak = std::max(peak, fabsf(samples[f]));
+                }
+            }
+
+            if (!sound->GetFrameCount() || sound->GetChannelCount() != result.wfx->nChannels
+                || peak <= 0.f || peak > 1.f)
+            {
+                success = false;
+                printf("ERROR: Decoded wave is empty or out of range (peak %f):\n%ls\n", double(peak), szPath);
+            }
+            else
+            {
+                sounds.emplace_back(std::move(sound));
+            }
+        }
+        catch (const std::exception& e)
+        {
+            success = false;
+            printf("ERROR: Failed decoding %ls: %s\n", szPath, e.what());
+        }
+    }
+
+    {
+        wchar_t szPath[MAX_PATH] = {};
+        DWORD ret = ExpandEnvironmentStringsW(c_WaveBank, szPath, MAX_PATH);
+        if (!ret || ret > MAX_PATH)
+        {
+            printf("ERROR: ExpandEnvironmentStrings FAILED\n");
+            return false;
+        }
+
+        auto wb = std::make_unique<DirectX::WaveBankReader>();
+        HRESULT hr = wb->Open(szPath);
+        if (FAILED(hr))
+        {
+            success = false;
+            printf("Failed loading wavebank from file (HRESULT %08X):\n%ls\n", static_cast<unsigned int>(hr), szPath);
+        }
+        else
+        {
+            wb->WaitOnPrepare();
+
+            for (uint32_t j = 0; j < wb->Count(); ++j)
+            {
+                char formatData[64] = {};
+                auto wfx = reinterpret_cast<WAVEFORMATEX*>(formatData);
+
+                const uint8_t* wavData = nullptr;
+                uint32_t audioBytes = 0;
+                if (FAILED(wb->GetFormat(j, wfx, sizeof(formatData))) || FAILED(wb->GetWaveData(j, &wavData, audioBytes)))
+                {
+                    success = false;
+                    printf("ERROR: Failed reading wavebank entry %u:\n%ls\n", j, szPath);
+                    continue;
+                }
+
+                try
+                {
+                    sounds.emplace_back(DecodeWave(wfx, wavData, audioBytes));
+                }
+                catch (const std::exception& e)
+                {
+                    success = false;
+                    printf("ERROR: Failed decoding %ls entry %u: %s\n", szPath, j, e.what());
+                }
+            }
+        }
+    }
+
+    if (sounds.empty())
+        return false;
+
+    // Submixes rendered on workers must match the serial mix exactly.
+    DX::RecordingJobSystem jobs;
+    {
+        constexpr size_t c_frames = 4800;
+
+        auto serialMixer = MakeScene(sounds, 256, 8);
+        auto parallelMixer = MakeScene(sounds, 256, 8);
+
+        std::vector<float> serial(c_frames * 2);
+        std::vector<float> parallel(c_frames * 2);
+        serialMixer.Render(serial.data(), c_frames);
+        parallelMixer.Render(parallel.data(), c_frames, &jobs);
+
+        if (serial != parallel)
+        {
+            success = false;
+            printf("ERROR: SoftwareMixer parallel submixes differ from serial mix\n");
+        }
+    }
+
+    // Throughput by voice count: one second of 48 kHz stereo per run.
+    for (size_t voices : { 16u, 64u, 256u, 1024u })
+    {
+        constexpr size_t c_frames = 48000;
+
+        auto mixer = MakeScene(sounds, voices, 1);
+        const auto serial = DX::MeasureSoftwareMix(mixer, c_frames);
+
+        auto submixed = MakeScene(sounds, voices, uint32_t(jobs.GetWorkerCount()));
+        const auto parallel = DX::MeasureSoftwareMix(submixed, c_frames, &jobs);
+
+        printf("\n\t%5zu voices: %8.2f ms serial (%6.0f voices/core), %8.2f ms on %zu workers (%6.0f voices/core)",
+            voices, serial.renderMilliseconds, serial.GetVoicesPerCore(),
+            parallel.renderMilliseconds, parallel.workers, parallel.GetVoicesPerCore());
+    }
+    printf("\n%zu sounds decoded ", sounds.size());
+
+    return success;
+}
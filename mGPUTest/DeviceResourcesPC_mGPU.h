@@ -48,6 +48,22 @@ namespace DX
         void Prepare(D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_PRESENT,
                      D3D12_RESOURCE_STATES afterState = D3D12_RESOURCE_STATE_RENDER_TARGET);
         void Present(D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+        // Per-adapter halves of Prepare and Present. Different adapters may be prepared and
+        // submitted from different threads; Present submits any adapter still recording.
+        void PrepareAdapter(unsigned int idx,
+                            D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_PRESENT,
+                            D3D12_RESOURCE_STATES afterState = D3D12_RESOURCE_STATE_RENDER_TARGET);
+        void SubmitAdapter(unsigned int idx, D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET);
+
+        // Split-frame and alternate-frame rendering. A secondary adapter copies 'region' of its render
+        // target into memory shared with the present adapter while recording; Composite then copies
+        // each adapter's region into the back buffer on the present adapter, whose queue must already
+        // wait for those adapters' work on the frame.
+        void CopyToPresentAdapter(unsigned int idx, const D3D12_RECT& region,
+                                  D3D12_RESOURCE_STATES beforeState = D3D12_RESOURCE_STATE_RENDER_TARGET);
+        void Composite(_In_reads_(count) const unsigned int* adapters, _In_reads_(count) const D3D12_RECT* regions, unsigned int count);
+
         void WaitForGpu() noexcept;
         void UpdateColorSpace();
 
@@ -153,6 +169,12 @@ namespace DX
         // DeviceResources options (see flags above)
         unsigned int                                        m_options;
 
+        // Cross-adapter composite: the layout of a frame in the shared buffers, and the present
+        // adapter's command list that copies the other adapters' output into the back buffer.
+        D3D12_PLACED_SUBRESOURCE_FOOTPRINT                  m_crossAdapterFootprint;
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator>      m_compositeAllocators[MAX_BACK_BUFFER_COUNT];
+        Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>   m_compositeCommandList;
+
         // Hold features that are per device in a multi GPU setup.
         struct PerAdapter
         {
@@ -175,15 +197,24 @@ namespace DX
             Microsoft::WRL::ComPtr<ID3D12Resource>                  m_renderTargets[MAX_BACK_BUFFER_COUNT];
             Microsoft::WRL::ComPtr<ID3D12Resource>                  m_depthStencil;
 
+            // Secondary adapters: this adapter's output for each back buffer, in a heap shared with
+            // the present adapter, and the same heap and buffers as opened on the present adapter.
+            Microsoft::WRL::ComPtr<ID3D12Heap>                      m_crossAdapterHeap;
+            Microsoft::WRL::ComPtr<ID3D12Heap>                      m_presentCrossAdapterHeap;
+            Microsoft::WRL::ComPtr<ID3D12Resource>                  m_crossAdapterBuffers[MAX_BACK_BUFFER_COUNT];
+            Microsoft::WRL::ComPtr<ID3D12Resource>                  m_presentCrossAdapterBuffers[MAX_BACK_BUFFER_COUNT];
+
             // Command
             Microsoft::WRL::ComPtr<ID3D12CommandAllocator>          m_commandAllocators[MAX_BACK_BUFFER_COUNT];
             Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList>       m_commandList;
             Microsoft::WRL::ComPtr<ID3D12CommandQueue>              m_commandQueue;
+            bool                                                    m_recording;
 
             PerAdapter() :
                 m_deviceNotify(nullptr),
                 m_rtvDescriptorSize(0),
-                m_fenceValues{}
+                m_fenceValues{},
+                m_recording(false)
             {}
         };
         PerAdapter* m_pAdaptersD3D;
@@ -101,6 +101,7 @@ DeviceResources::DeviceResources(
         m_orientationTransform3D(ScreenRotation::Rotation0),
         m_colorSpace(DXGI_COLOR_SPACE_RGB_FULL_G22_NONE_P709),
         m_options(flags),
+        m_crossAdapterFootprint{},
         m_pAdaptersD3D(nullptr)
 {
     if (backBufferCount < 2 || backBufferCount > MAX_BACK_BUFFER_COUNT)
@@ -289,6 +290,25 @@ void DeviceResources::CreateDeviceResources()
 
         m_pAdaptersD3D[adapterIdx].m_commandList->SetName(L"DeviceResources");
 
+        if (adapterIdx == DT_Primary && m_deviceCount > 1)
+        {
+            // The composite of the other adapters' output is recorded on its own command list, so it
+            // can be submitted after the present queue waits for them.
+            for (UINT n = 0; n < m_backBufferCount; n++)
+            {
+                ThrowIfFailed(m_pAdaptersD3D[adapterIdx].m_d3dDevice->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(m_compositeAllocators[n].ReleaseAndGetAddressOf())));
+
+                wchar_t name[25] = {};
+                swprintf_s(name, L"Composite %u", n);
+                m_compositeAllocators[n]->SetName(name);
+            }
+
+            ThrowIfFailed(m_pAdaptersD3D[adapterIdx].m_d3dDevice->CreateCommandList(0, D3D12_COMMAND_LIST_TYPE_DIRECT, m_compositeAllocators[0].Get(), nullptr, IID_PPV_ARGS(m_compositeCommandList.ReleaseAndGetAddressOf())));
+            ThrowIfFailed(m_compositeCommandList->Close());
+
+            m_compositeCommandList->SetName(L"Composite");
+        }
+
         // Create a fence for tracking GPU execution progress.
         ThrowIfFailed(m_pAdaptersD3D[adapterIdx].m_d3dDevice->CreateFence(m_pAdaptersD3D[adapterIdx].m_fenceValues[m_backBufferIndex], D3D12_FENCE_FLAG_NONE, IID_PPV_ARGS(m_pAdaptersD3D[adapterIdx].m_fence.ReleaseAndGetAddressOf())));
         m_pAdaptersD3D[adapterIdx].m_fenceValues[m_backBufferIndex]++;
@@ -323,6 +343,8 @@ void DeviceResources::CreateWindowSizeDependentResources()
         for (UINT n = 0; n < m_backBufferCount; n++)
         {
             m_pAdaptersD3D[adapterIdx].m_renderTargets[n].Reset();
+            m_pAdaptersD3D[adapterIdx].m_crossAdapterBuffers[n].Reset();
+            m_pAdaptersD3D[adapterIdx].m_presentCrossAdapterBuffers[n].Reset();
             m_pAdaptersD3D[adapterIdx].m_fenceValues[n] = m_pAdaptersD3D[adapterIdx].m_fenceValues[m_backBufferIndex];
         }
     }
@@ -440,6 +462,13 @@ void DeviceResources::CreateWindowSizeDependentResources()
         m_pAdaptersD3D[DT_Primary].m_d3dDevice->CreateRenderTargetView(m_pAdaptersD3D[DT_Primary].m_renderTargets[n].Get(), &rtvDesc, rtvDescriptor);
     }
 
+    // Secondary adapters hand their output to the present adapter in buffers laid out as a copy of
+    // the back buffer, one per back buffer, placed in a heap shared across the two adapters.
+    const D3D12_RESOURCE_DESC frameDesc = CD3DX12_RESOURCE_DESC::Tex2D(m_backBufferFormat, backBufferWidth, backBufferHeight, 1, 1);
+    UINT64 crossAdapterSize = 0;
+    m_pAdaptersD3D[DT_Primary].m_d3dDevice->GetCopyableFootprints(&frameDesc, 0, 1, 0, &m_crossAdapterFootprint, nullptr, nullptr, &crossAdapterSize);
+    const UINT64 crossAdapterStride = (crossAdapterSize + D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1) & ~UINT64(D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT - 1);
+
     // Second adapter
     for (unsigned int adapterIdx = 1; adapterIdx != m_deviceCount; ++adapterIdx)
     {
@@ -468,6 +497,32 @@ void DeviceResources::CreateWindowSizeDependentResources()
                 static_cast<INT>(n), m_pAdaptersD3D[adapterIdx].m_rtvDescriptorSize);
             m_pAdaptersD3D[adapterIdx].m_d3dDevice->CreateRenderTargetView(m_pAdaptersD3D[adapterIdx].m_renderTargets[n].Get(), &rtvDesc, rtvDescriptor);
         }
+
+        auto& adapter = m_pAdaptersD3D[adapterIdx];
+        auto presentDevice = m_pAdaptersD3D[DT_Primary].m_d3dDevice.Get();
+
+        const CD3DX12_HEAP_DESC heapDesc(crossAdapterStride * m_backBufferCount, D3D12_HEAP_TYPE_DEFAULT, 0,
+            D3D12_HEAP_FLAG_SHARED | D3D12_HEAP_FLAG_SHARED_CROSS_ADAPTER | D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS);
+        ThrowIfFailed(adapter.m_d3dDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(adapter.m_crossAdapterHeap.ReleaseAndGetAddressOf())));
+        adapter.m_crossAdapterHeap->SetName(L"Cross-adapter output");
+
+        HANDLE heapHandle = nullptr;
+        ThrowIfFailed(adapter.m_d3dDevice->CreateSharedHandle(adapter.m_crossAdapterHeap.Get(), nullptr, GENERIC_ALL, nullptr, &heapHandle));
+        const HRESULT hr = presentDevice->OpenSharedHandle(heapHandle, IID_PPV_ARGS(adapter.m_presentCrossAdapterHeap.ReleaseAndGetAddressOf()));
+        std::ignore = CloseHandle(heapHandle);
+        ThrowIfFailed(hr);
+
+        // Buffers promote from and decay to COMMON, so neither adapter needs a barrier for the copies.
+        const D3D12_RESOURCE_DESC bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(crossAdapterSize, D3D12_RESOURCE_FLAG_ALLOW_CROSS_ADAPTER);
+        for (UINT n = 0; n < m_backBufferCount; n++)
+        {
+            ThrowIfFailed(adapter.m_d3dDevice->CreatePlacedResource(
+                adapter.m_crossAdapterHeap.Get(), crossAdapterStride * n, &bufferDesc,
+                D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(adapter.m_crossAdapterBuffers[n].GetAddressOf())));
+            ThrowIfFailed(presentDevice->CreatePlacedResource(
+                adapter.m_presentCrossAdapterHeap.Get(), crossAdapterStride * n, &bufferDesc,
+                D3D12_RESOURCE_STATE_COMMON, nullptr, IID_PPV_ARGS(adapter.m_presentCrossAdapterBuffers[n].GetAddressOf())));
+        }
     }
 
     // Reset the index to the current back buffer.
@@ -609,17 +664,28 @@ void DeviceResources::HandleDeviceLost()
         m_pAdaptersD3D[DT_Primary].m_deviceNotify->OnDeviceLost();
     }
 
+    for (UINT n = 0; n < m_backBufferCount; n++)
+    {
+        m_compositeAllocators[n].Reset();
+    }
+    m_compositeCommandList.Reset();
+
     for (unsigned int adapterIdx = 0; adapterIdx != m_deviceCount; ++adapterIdx)
     {
         for (UINT n = 0; n < m_backBufferCount; n++)
         {
             m_pAdaptersD3D[adapterIdx].m_commandAllocators[n].Reset();
             m_pAdaptersD3D[adapterIdx].m_renderTargets[n].Reset();
+            m_pAdaptersD3D[adapterIdx].m_crossAdapterBuffers[n].Reset();
+            m_pAdaptersD3D[adapterIdx].m_presentCrossAdapterBuffers[n].Reset();
         }
 
+        m_pAdaptersD3D[adapterIdx].m_crossAdapterHeap.Reset();
+        m_pAdaptersD3D[adapterIdx].m_presentCrossAdapterHeap.Reset();
         m_pAdaptersD3D[adapterIdx].m_depthStencil.Reset();
         m_pAdaptersD3D[adapterIdx].m_commandQueue.Reset();
         m_pAdaptersD3D[adapterIdx].m_commandList.Reset();
+        m_pAdaptersD3D[adapterIdx].m_recording = false;
         m_pAdaptersD3D[adapterIdx].m_fence.Reset();
         m_pAdaptersD3D[adapterIdx].m_rtvDescriptorHeap.Reset();
         m_pAdaptersD3D[adapterIdx].m_dsvDescriptorHeap.Reset();
@@ -653,38 +719,122 @@ void DeviceResources::Prepare(D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_
 {
     for (unsigned int adapterIdx = 0; adapterIdx != m_deviceCount; ++adapterIdx)
     {
-        // Reset command list and allocator.
-        ThrowIfFailed(m_pAdaptersD3D[adapterIdx].m_commandAllocators[m_backBufferIndex]->Reset());
-        ThrowIfFailed(m_pAdaptersD3D[adapterIdx].m_commandList->Reset(m_pAdaptersD3D[adapterIdx].m_commandAllocators[m_backBufferIndex].Get(), nullptr));
+        PrepareAdapter(adapterIdx, beforeState, afterState);
+    }
+}
 
-        if (beforeState != afterState)
-        {
-            // Transition the render target into the correct state to allow for drawing into it.
-            const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-                m_pAdaptersD3D[adapterIdx].m_renderTargets[m_backBufferIndex].Get(),
-                beforeState, afterState);
-            m_pAdaptersD3D[adapterIdx].m_commandList->ResourceBarrier(1, &barrier);
-        }
+// Prepare one adapter's command list and render target for rendering.
+void DeviceResources::PrepareAdapter(unsigned int idx, D3D12_RESOURCE_STATES beforeState, D3D12_RESOURCE_STATES afterState)
+{
+    auto& adapter = m_pAdaptersD3D[idx];
+
+    // Reset command list and allocator.
+    ThrowIfFailed(adapter.m_commandAllocators[m_backBufferIndex]->Reset());
+    ThrowIfFailed(adapter.m_commandList->Reset(adapter.m_commandAllocators[m_backBufferIndex].Get(), nullptr));
+    adapter.m_recording = true;
+
+    if (beforeState != afterState)
+    {
+        // Transition the render target into the correct state to allow for drawing into it.
+        const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+            adapter.m_renderTargets[m_backBufferIndex].Get(),
+            beforeState, afterState);
+        adapter.m_commandList->ResourceBarrier(1, &barrier);
     }
 }
 
+// Close and execute one adapter's command list.
+void DeviceResources::SubmitAdapter(unsigned int idx, D3D12_RESOURCE_STATES beforeState)
+{
+    auto& adapter = m_pAdaptersD3D[idx];
+
+    if (beforeState != D3D12_RESOURCE_STATE_PRESENT)
+    {
+        // Transition the render target to the state that allows it to be presented to the display.
+        const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
+            adapter.m_renderTargets[m_backBufferIndex].Get(),
+            beforeState, D3D12_RESOURCE_STATE_PRESENT);
+        adapter.m_commandList->ResourceBarrier(1, &barrier);
+    }
+
+    // Send the command list off to the GPU for processing.
+    ThrowIfFailed(adapter.m_commandList->Close());
+    adapter.m_commandQueue->ExecuteCommandLists(1, CommandListCast(adapter.m_commandList.GetAddressOf()));
+    adapter.m_recording = false;
+}
+
+// Copy part of a secondary adapter's render target to the memory it shares with the present adapter.
+void DeviceResources::CopyToPresentAdapter(unsigned int idx, const D3D12_RECT& region, D3D12_RESOURCE_STATES beforeState)
+{
+    assert(idx != DT_Primary && idx < m_deviceCount);
+
+    if (region.left >= region.right || region.top >= region.bottom)
+        return;
+
+    auto& adapter = m_pAdaptersD3D[idx];
+    auto renderTarget = adapter.m_renderTargets[m_backBufferIndex].Get();
+
+    D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(renderTarget, beforeState, D3D12_RESOURCE_STATE_COPY_SOURCE);
+    adapter.m_commandList->ResourceBarrier(1, &barrier);
+
+    const CD3DX12_TEXTURE_COPY_LOCATION dest(adapter.m_crossAdapterBuffers[m_backBufferIndex].Get(), m_crossAdapterFootprint);
+    const CD3DX12_TEXTURE_COPY_LOCATION src(renderTarget, 0);
+    const D3D12_BOX box = { UINT(region.left), UINT(region.top), 0, UINT(region.right), UINT(region.bottom), 1 };
+    adapter.m_commandList->CopyTextureRegion(&dest, box.left, box.top, 0, &src, &box);
+
+    barrier = CD3DX12_RESOURCE_BARRIER::Transition(renderTarget, D3D12_RESOURCE_STATE_COPY_SOURCE, beforeState);
+    adapter.m_commandList->ResourceBarrier(1, &barrier);
+}
+
+// Copy the other adapters' output into the back buffer on the present adapter.
+void DeviceResources::Composite(const unsigned int* adapters, const D3D12_RECT* regions, unsigned int count)
+{
+    if (!count)
+        return;
+
+    auto& present = m_pAdaptersD3D[DT_Primary];
+    auto allocator = m_compositeAllocators[m_backBufferIndex].Get();
+    ThrowIfFailed(allocator->Reset());
+    ThrowIfFailed(m_compositeCommandList->Reset(allocator, nullptr));
+
+    auto backBuffer = present.m_renderTargets[m_backBufferIndex].Get();
+    D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_COPY_DEST);
+    m_compositeCommandList->ResourceBarrier(1, &barrier);
+
+    // The swap chain buffers are not sRGB; the bytes are the same either way.
+    D3D12_PLACED_SUBRESOURCE_FOOTPRINT footprint = m_crossAdapterFootprint;
+    footprint.Footprint.Format = NoSRGB(m_backBufferFormat);
+
+    const CD3DX12_TEXTURE_COPY_LOCATION dest(backBuffer, 0);
+    for (unsigned int j = 0; j < count; ++j)
+    {
+        assert(adapters[j] != DT_Primary && adapters[j] < m_deviceCount);
+
+        const D3D12_RECT& region = regions[j];
+        if (region.left >= region.right || region.top >= region.bottom)
+            continue;
+
+        const CD3DX12_TEXTURE_COPY_LOCATION src(m_pAdaptersD3D[adapters[j]].m_presentCrossAdapterBuffers[m_backBufferIndex].Get(), footprint);
+        const D3D12_BOX box = { UINT(region.left), UINT(region.top), 0, UINT(region.right), UINT(region.bottom), 1 };
+        m_compositeCommandList->CopyTextureRegion(&dest, box.left, box.top, 0, &src, &box);
+    }
+
+    barrier = CD3DX12_RESOURCE_BARRIER::Transition(backBuffer, D3D12_RESOURCE_STATE_COPY_DEST, D3D12_RESOURCE_STATE_PRESENT);
+    m_compositeCommandList->ResourceBarrier(1, &barrier);
+
+    ThrowIfFailed(m_compositeCommandList->Close());
+    present.m_commandQueue->ExecuteCommandLists(1, CommandListCast(m_compositeCommandList.GetAddressOf()));
+}
+
 // Present the contents of the swap chain to the screen.
 void DeviceResources::Present(D3D12_RESOURCE_STATES beforeState)
 {
     for (unsigned int adapterIdx = 0; adapterIdx != m_deviceCount; ++adapterIdx)
     {
-        if (beforeState != D3D12_RESOURCE_STATE_PRESENT)
+        if (m_pAdaptersD3D[adapterIdx].m_recording)
         {
-            // Transition the render target to the state that allows it to be presented to the display.
-            const D3D12_RESOURCE_BARRIER barrier = CD3DX12_RESOURCE_BARRIER::Transition(
-                m_pAdaptersD3D[adapterIdx].m_renderTargets[m_backBufferIndex].Get(),
-                beforeState, D3D12_RESOURCE_STATE_PRESENT);
-            m_pAdaptersD3D[adapterIdx].m_commandList->ResourceBarrier(1, &barrier);
+            SubmitAdapter(adapterIdx, beforeState);
         }
-
-        // Send the command list off to the GPU for processing.
-        ThrowIfFailed(m_pAdaptersD3D[adapterIdx].m_commandList->Close());
-        m_pAdaptersD3D[adapterIdx].m_commandQueue->ExecuteCommandLists(1, CommandListCast(m_pAdaptersD3D[adapterIdx].m_commandList.GetAddressOf()));
     }
 
     HRESULT hr;
@@ -752,15 +902,18 @@ void DeviceResources::WaitForGpu() noexcept
 // Prepare to render the next frame.
 void DeviceResources::MoveToNextFrame()
 {
+    // Schedule a Signal command in each queue.
+    const UINT currentIndex = m_backBufferIndex;
     for (unsigned int adapterIdx = 0; adapterIdx != m_deviceCount; ++adapterIdx)
     {
-        // Schedule a Signal command in the queue.
-        const UINT64 currentFenceValue = m_pAdaptersD3D[adapterIdx].m_fenceValues[m_backBufferIndex];
-        ThrowIfFailed(m_pAdaptersD3D[adapterIdx].m_commandQueue->Signal(m_pAdaptersD3D[adapterIdx].m_fence.Get(), currentFenceValue));
+        ThrowIfFailed(m_pAdaptersD3D[adapterIdx].m_commandQueue->Signal(m_pAdaptersD3D[adapterIdx].m_fence.Get(), m_pAdaptersD3D[adapterIdx].m_fenceValues[currentIndex]));
+    }
 
-    // Update the back buffer index.
+    // Update the back buffer index once every adapter has signaled the frame it just finished.
     m_backBufferIndex = m_swapChain->GetCurrentBackBufferIndex();
 
+    for (unsigned int adapterIdx = 0; adapterIdx != m_deviceCount; ++adapterIdx)
+    {
         // If the next frame is not ready to be rendered yet, wait until it is ready.
         if (m_pAdaptersD3D[adapterIdx].m_fence->GetCompletedValue() < m_pAdaptersD3D[adapterIdx].m_fenceValues[m_backBufferIndex])
         {
@@ -769,7 +922,7 @@ void DeviceResources::MoveToNextFrame()
         }
 
         // Set the fence value for the next frame.
-        m_pAdaptersD3D[adapterIdx].m_fenceValues[m_backBufferIndex] = currentFenceValue + 1;
+        m_pAdaptersD3D[adapterIdx].m_fenceValues[m_backBufferIndex] = m_pAdaptersD3D[adapterIdx].m_fenceValues[currentIndex] + 1;
     }
 }
 
@@ -30,7 +30,8 @@ namespace
 }
 
 // Constructor.
-Game::Game() noexcept(false)
+Game::Game() noexcept(false) :
+    m_regions{}
 {
 #ifdef GAMMA_CORRECT_RENDERING
     DXGI_FORMAT s_format = DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
@@ -77,6 +78,8 @@ void Game::Initialize(
 
     m_deviceResources->CreateWindowSizeDependentResources();
     CreateWindowSizeDependentResources();
+
+    UnitTests();
 }
 
 #pragma region Frame Update
@@ -104,6 +107,14 @@ void Game::Update(DX::StepTimer const&)
         ExitGame();
     }
 
+    m_keyboardButtons.Update(kb);
+
+    if (m_keyboardButtons.IsKeyPressed(Keyboard::Space))
+    {
+        m_scheduler->SetMode(m_scheduler->GetMode() == DX::MultiAdapterMode::SplitFrame
+            ? DX::MultiAdapterMode::AlternateFrame : DX::MultiAdapterMode::SplitFrame);
+    }
+
     PIXEndEvent();
 }
 #pragma endregion
@@ -118,10 +129,85 @@ void Game::Render()
         return;
     }
 
-    // Prepare the command list to render a new frame.
-    m_deviceResources->Prepare();
-    Clear();
+    // Each adapter that renders this frame prepares, records, and submits its part on its own thread.
+    auto const scissorRect = m_deviceResources->GetScissorRect();
+    const auto slot = m_deviceResources->GetCurrentFrameIndex();
+    m_scheduler->RenderFrame([&](const DX::AdapterFrameWork& work)
+        {
+            // Split-frame bands come from the balancer; an alternate frame is one band of one.
+            const bool balanced = work.regionCount == m_balancer->GetRegionCount();
+            const auto height = static_cast<uint32_t>(scissorRect.bottom - scissorRect.top);
+            const auto band = balanced
+                ? m_balancer->GetBand(work.region, height)
+                : DX::GetSplitFrameBand(work.region, work.regionCount, height);
+
+            D3D12_RECT& region = m_regions[work.adapter];
+            region = scissorRect;
+            region.top = scissorRect.top + LONG(band.top);
+            region.bottom = scissorRect.top + LONG(band.bottom);
+
+            m_deviceResources->PrepareAdapter(work.adapter);
+            auto commandList = m_deviceResources->GetCommandList(work.adapter);
+            auto& timer = *m_frameTimer[work.adapter];
+            auto& shares = m_bandShares[work.adapter];
+
+            // The device has waited for this back buffer's last frame, so its timing can be read back.
+            double ms = 0.0;
+            m_bandTiming[work.adapter] = (shares[slot] >= 0.0 && timer.GetMilliseconds(slot, ms))
+                ? std::make_pair(shares[slot], ms)
+                : std::make_pair(0.0, -1.0);
+            shares[slot] = balanced ? m_balancer->GetShare(work.region) : -1.0;
+
+            timer.Start(commandList, slot);
+            Clear(work.adapter, region);
+            RenderAdapter(work.adapter);
+            if (work.adapter != m_scheduler->GetPresentAdapter())
+            {
+                m_deviceResources->CopyToPresentAdapter(work.adapter, region);
+            }
+            timer.Stop(commandList, slot);
+
+            m_deviceResources->SubmitAdapter(work.adapter);
+        });
+
+    // Move the band boundaries toward equal finish times. In alternate-frame mode there is
+    // nothing to read back, so the bands stay where they were.
+    if (m_scheduler->GetMode() == DX::MultiAdapterMode::SplitFrame)
+    {
+        for (uint32_t adapterIdx = 0; adapterIdx < m_balancer->GetRegionCount(); ++adapterIdx)
+        {
+            if (m_bandTiming[adapterIdx].second >= 0.0)
+            {
+                m_balancer->Observe(adapterIdx, m_bandTiming[adapterIdx].first, m_bandTiming[adapterIdx].second);
+            }
+        }
+        m_balancer->Rebalance();
+    }
+
+    // Copy the other adapters' parts into the back buffer; the present queue already waits for them.
+    auto const& adapters = m_scheduler->GetCompositeAdapters();
+    D3D12_RECT regions[MAX_DEVICES] = {};
+    for (size_t j = 0; j < adapters.size(); ++j)
+    {
+        regions[j] = m_regions[adapters[j]];
+    }
+    m_deviceResources->Composite(adapters.data(), regions, static_cast<unsigned int>(adapters.size()));
 
+    // Show the new frame.
+    PIXBeginEvent(m_deviceResources->GetCommandQueue(0), PIX_COLOR_DEFAULT, L"Present");
+    m_deviceResources->Present();
+    
+    for (unsigned int adapterIdx = 0; adapterIdx != m_deviceResources->GetDeviceCount(); ++adapterIdx)
+    {
+        m_graphicsMemory[adapterIdx]->Commit(m_deviceResources->GetCommandQueue(adapterIdx));
+    }
+
+    PIXEndEvent(m_deviceResources->GetCommandQueue(0));
+}
+
+// Draws the scene on one adapter.
+void Game::RenderAdapter(unsigned int adapterIdx)
+{
     XMVECTORF32 red, green, blue, dred, dgreen, dblue, yellow, cyan, magenta, gray, dgray;
 #ifdef GAMMA_CORRECT_RENDERING
     red.v = XMColorSRGBToRGB(Colors::Red);
@@ -149,103 +235,85 @@ void Game::Render()
     dgray.v = Colors::DarkGray;
 #endif
 
-    for (unsigned int adapterIdx = 0; adapterIdx != m_deviceResources->GetDeviceCount(); ++adapterIdx)
-    {
-        auto commandList = m_deviceResources->GetCommandList(adapterIdx);
-        PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Render");
+    auto commandList = m_deviceResources->GetCommandList(adapterIdx);
+    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Render");
 
-        // Point
-        m_effectPoint[adapterIdx]->Apply(commandList);
+    // Point
+    m_effectPoint[adapterIdx]->Apply(commandList);
 
-        m_batch[adapterIdx]->Begin(commandList);
+    m_batch[adapterIdx]->Begin(commandList);
 
-        {
-            VertexPositionColor points[] = {{ Vector3(-0.75f, -0.75f, 0.5f), red },			{ Vector3(-0.75f, -0.5f,  0.5f), green },
-                                            { Vector3(-0.75f, -0.25f, 0.5f), blue },		{ Vector3(-0.75f,  0.0f,  0.5f), yellow },
-                                            { Vector3(-0.75f,  0.25f, 0.5f), magenta },		{ Vector3(-0.75f,  0.5f,  0.5f), cyan },
-                                            { Vector3(-0.75f,  0.75f, 0.5f), Colors::White} };
-
-            m_batch[adapterIdx]->Draw(D3D_PRIMITIVE_TOPOLOGY_POINTLIST, points, static_cast<UINT>(std::size(points)));
-        }
+    {
+        VertexPositionColor points[] = {{ Vector3(-0.75f, -0.75f, 0.5f), red },			{ Vector3(-0.75f, -0.5f,  0.5f), green },
+                                        { Vector3(-0.75f, -0.25f, 0.5f), blue },		{ Vector3(-0.75f,  0.0f,  0.5f), yellow },
+                                        { Vector3(-0.75f,  0.25f, 0.5f), magenta },		{ Vector3(-0.75f,  0.5f,  0.5f), cyan },
+                                        { Vector3(-0.75f,  0.75f, 0.5f), Colors::White} };
 
-        m_batch[adapterIdx]->End();
+        m_batch[adapterIdx]->Draw(D3D_PRIMITIVE_TOPOLOGY_POINTLIST, points, static_cast<UINT>(std::size(points)));
+    }
 
-        // Lines
-        m_effectLine[adapterIdx]->Apply(commandList);
+    m_batch[adapterIdx]->End();
 
-        m_batch[adapterIdx]->Begin(commandList);
+    // Lines
+    m_effectLine[adapterIdx]->Apply(commandList);
 
-        {
-            VertexPositionColor lines[] = { { Vector3(-0.75f, -0.85f, 0.5f), red },			{ Vector3(0.75f, -0.85f, 0.5f), dred },
-                                            { Vector3(-0.75f, -0.90f, 0.5f), green },		{ Vector3(0.75f, -0.90f, 0.5f), dgreen },
-                                            { Vector3(-0.75f, -0.95f, 0.5f), blue },		{ Vector3(0.75f, -0.95f, 0.5f), dblue }};
+    m_batch[adapterIdx]->Begin(commandList);
 
-            m_batch[adapterIdx]->DrawLine(lines[0], lines[1]);
-            m_batch[adapterIdx]->DrawLine(lines[2], lines[3]);
-            m_batch[adapterIdx]->DrawLine(lines[4], lines[5]);
-        }
+    {
+        VertexPositionColor lines[] = { { Vector3(-0.75f, -0.85f, 0.5f), red },			{ Vector3(0.75f, -0.85f, 0.5f), dred },
+                                        { Vector3(-0.75f, -0.90f, 0.5f), green },		{ Vector3(0.75f, -0.90f, 0.5f), dgreen },
+                                        { Vector3(-0.75f, -0.95f, 0.5f), blue },		{ Vector3(0.75f, -0.95f, 0.5f), dblue }};
 
-        m_batch[adapterIdx]->End();
+        m_batch[adapterIdx]->DrawLine(lines[0], lines[1]);
+        m_batch[adapterIdx]->DrawLine(lines[2], lines[3]);
+        m_batch[adapterIdx]->DrawLine(lines[4], lines[5]);
+    }
 
-        // Triangle
-        m_effectTri[adapterIdx]->Apply(commandList);
+    m_batch[adapterIdx]->End();
 
-        m_batch[adapterIdx]->Begin(commandList);
+    // Triangle
+    m_effectTri[adapterIdx]->Apply(commandList);
 
-        VertexPositionColor tri[]   = {{ Vector3(0.f, 0.5f, 0.5f), red},                    {Vector3(0.5f, -0.5f, 0.5f), green},
-                                       { Vector3(-0.5f, -0.5f, 0.5f), blue}};
-        
-        m_batch[adapterIdx]->DrawTriangle(tri[0], tri[1], tri[2]);
+    m_batch[adapterIdx]->Begin(commandList);
 
-        // Quad (same type as triangle)
-        
-        VertexPositionColor quad[]  = {{ Vector3(0.75f, 0.75f, 0.5), gray },				{ Vector3(0.95f, 0.75f, 0.5), gray },
-                                       { Vector3(0.95f, -0.75f, 0.5), dgray },			    { Vector3(0.75f, -0.75f, 0.5), dgray }};
+    VertexPositionColor tri[]   = {{ Vector3(0.f, 0.5f, 0.5f), red},                    {Vector3(0.5f, -0.5f, 0.5f), green},
+                                   { Vector3(-0.5f, -0.5f, 0.5f), blue}};
+    
+    m_batch[adapterIdx]->DrawTriangle(tri[0], tri[1], tri[2]);
 
-        m_batch[adapterIdx]->DrawQuad(quad[0], quad[1], quad[2], quad[3]);
+    // Quad (same type as triangle)
     
-        m_batch[adapterIdx]->End();
+    VertexPositionColor quad[]  = {{ Vector3(0.75f, 0.75f, 0.5), gray },				{ Vector3(0.95f, 0.75f, 0.5), gray },
+                                   { Vector3(0.95f, -0.75f, 0.5), dgray },			    { Vector3(0.75f, -0.75f, 0.5), dgray }};
 
-        PIXEndEvent(commandList);
-    }
+    m_batch[adapterIdx]->DrawQuad(quad[0], quad[1], quad[2], quad[3]);
 
-    // Show the new frame.
-    PIXBeginEvent(m_deviceResources->GetCommandQueue(0), PIX_COLOR_DEFAULT, L"Present");
-    m_deviceResources->Present();
-    
-    for (unsigned int adapterIdx = 0; adapterIdx != m_deviceResources->GetDeviceCount(); ++adapterIdx)
-    {
-        m_graphicsMemory[adapterIdx]->Commit(m_deviceResources->GetCommandQueue(adapterIdx));
-    }
+    m_batch[adapterIdx]->End();
 
-    PIXEndEvent(m_deviceResources->GetCommandQueue(0));
+    PIXEndEvent(commandList);
 }
 
-// Helper method to clear the back buffers.
-void Game::Clear()
+// Helper method to clear the part of one adapter's back buffer it renders.
+void Game::Clear(unsigned int adapterIdx, const D3D12_RECT& region)
 {
-    for (unsigned int adapterIdx = 0; adapterIdx != m_deviceResources->GetDeviceCount(); ++adapterIdx)
-    {
-        auto commandList = m_deviceResources->GetCommandList(adapterIdx);
-        PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Clear");
+    auto commandList = m_deviceResources->GetCommandList(adapterIdx);
+    PIXBeginEvent(commandList, PIX_COLOR_DEFAULT, L"Clear");
 
-        // Clear the views.
-        auto const rtvDescriptor = m_deviceResources->GetRenderTargetView(adapterIdx);
-        auto const dsvDescriptor = m_deviceResources->GetDepthStencilView(adapterIdx);
+    // Clear the views.
+    auto const rtvDescriptor = m_deviceResources->GetRenderTargetView(adapterIdx);
+    auto const dsvDescriptor = m_deviceResources->GetDepthStencilView(adapterIdx);
 
-        commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, &dsvDescriptor);
-        commandList->ClearRenderTargetView(rtvDescriptor, c_clearColor, 0, nullptr);
-        commandList->ClearDepthStencilView(dsvDescriptor, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 0, nullptr);
+    commandList->OMSetRenderTargets(1, &rtvDescriptor, FALSE, &dsvDescriptor);
+    commandList->ClearRenderTargetView(rtvDescriptor, c_clearColor, 1, &region);
+    commandList->ClearDepthStencilView(dsvDescriptor, D3D12_CLEAR_FLAG_DEPTH, 1.0f, 0, 1, &region);
 
-        // Set the viewport and scissor rect.
-        auto const viewport = m_deviceResources->GetScreenViewport();
-        commandList->RSSetViewports(1, &viewport);
+    // Set the viewport and scissor rect. The viewport is the whole frame, so every band lines up.
+    auto const viewport = m_deviceResources->GetScreenViewport();
+    commandList->RSSetViewports(1, &viewport);
 
-        auto const scissorRect = m_deviceResources->GetScissorRect();
-        commandList->RSSetScissorRects(1, &scissorRect);
+    commandList->RSSetScissorRects(1, &region);
 
-        PIXEndEvent(commandList);
-    }
+    PIXEndEvent(commandList);
 }
 #pragma endregion
 
@@ -321,6 +389,27 @@ void Game::CreateDeviceDependentResources()
         pd.primitiveTopology			= D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE;
         m_effectLine[adapterIdx]		= std::make_unique<BasicEffect>(device, EffectFlags::VertexColor, pd);
     }
+
+    const auto adapterCount = static_cast<uint32_t>(std::min<size_t>(m_deviceResources->GetDeviceCount(), MAX_DEVICES));
+
+    ID3D12Device* devices[MAX_DEVICES] = {};
+    ID3D12CommandQueue* commandQueues[MAX_DEVICES] = {};
+    for (uint32_t adapterIdx = 0; adapterIdx < adapterCount; ++adapterIdx)
+    {
+        devices[adapterIdx] = m_deviceResources->GetD3DDevice(adapterIdx);
+        commandQueues[adapterIdx] = m_deviceResources->GetCommandQueue(adapterIdx);
+    }
+
+    m_scheduler = std::make_unique<DX::D3D12MultiAdapterScheduler>(
+        DX::D3D12MultiAdapterBackend(devices, commandQueues, adapterCount),
+        adapterCount);
+
+    m_balancer = std::make_unique<DX::SplitFrameBalancer<DX::AffineCostModel>>(adapterCount);
+    for (uint32_t adapterIdx = 0; adapterIdx < adapterCount; ++adapterIdx)
+    {
+        m_frameTimer[adapterIdx] = std::make_unique<DX::D3D12AdapterFrameTimer>(devices[adapterIdx], commandQueues[adapterIdx], m_deviceResources->GetBackBufferCount());
+        m_bandShares[adapterIdx].assign(m_deviceResources->GetBackBufferCount(), -1.0);
+    }
 }
 
 // Allocate all memory resources that change on a window SizeChanged event.
@@ -335,6 +424,13 @@ void Game::CreateWindowSizeDependentResources()
 
 void Game::OnDeviceLost()
 {
+    m_scheduler.reset();
+    m_balancer.reset();
+    for (auto& timer : m_frameTimer)
+    {
+        timer.reset();
+    }
+
     for (unsigned int adapterIdx = 0; adapterIdx != m_deviceResources->GetDeviceCount(); ++adapterIdx)
     {
         m_batch[adapterIdx].reset();
@@ -351,3 +447,516 @@ void Game::OnDeviceRestored()
     CreateWindowSizeDependentResources();
 }
 #pragma endregion
+
+#pragma region Unit Tests
+namespace
+{
+    // Adapters whose GPU work only completes when the CPU waits for it, so every stall is deterministic.
+    struct SimulatedAdapters
+    {
+        struct Adapter
+        {
+            uint64_t    completed;
+            uint64_t    signaled;
+            uint64_t    waits;
+            bool        outOfOrder;
+        };
+
+        explicit SimulatedAdapters(uint32_t adapterCount) : adapters(adapterCount, Adapter{}) {}
+
+        uint64_t GetCompletedValue(uint32_t adapter) const { return adapters[adapter].completed; }
+
+        void WaitForValue(uint32_t adapter, uint64_t value)
+        {
+            auto& state = adapters[adapter];
+            ++state.waits;
+            state.completed = std::max(state.completed, value);
+        }
+
+        void Signal(uint32_t adapter, uint64_t value)
+        {
+            auto& state = adapters[adapter];
+            if (value != state.signaled + 1)
+            {
+                state.outOfOrder = true;
+            }
+            state.signaled = value;
+        }
+
+        void WaitOnPresentQueue(uint32_t adapter, uint64_t value)
+        {
+            presentWaits.emplace_back(adapter, value);
+        }
+
+        std::vector<Adapter>                            adapters;
+        std::vector<std::pair<uint32_t, uint64_t>>      presentWaits;
+    };
+
+    using SimulatedScheduler = DX::MultiAdapterScheduler<SimulatedAdapters>;
+
+    // GPU time of an adapter for a band: fixedMs + frameMs * share, with a little jitter.
+    struct SyntheticAdapter
+    {
+        double  fixedMs;
+        double  frameMs;
+    };
+
+    // Replays a set of synthetic adapters through a balancer. As on a real GPU, each frame's
+    // timing is only read back once its frame in flight retires, two frames later.
+    class SyntheticTrace
+    {
+    public:
+        SyntheticTrace(const SyntheticAdapter* adapters, uint32_t count) :
+            moves(0),
+            m_adapters(adapters),
+            m_count(count),
+            m_frame(0),
+            m_seed(12345)
+        {
+        }
+
+        // Returns the time the slowest adapter took for this frame.
+        template<typename TBalancer>
+        double RunFrame(TBalancer& balancer)
+        {
+            auto& pending = m_pending[m_frame % c_FramesInFlight];
+            if (m_frame >= c_FramesInFlight)
+            {
+                for (uint32_t j = 0; j < m_count; ++j)
+                {
+                    balancer.Observe(j, pending[j].first, pending[j].second);
+                }
+                if (balancer.Rebalance())
+                {
+                    ++moves;
+                }
+            }
+
+            double slowest = 0.0;
+            for (uint32_t j = 0; j < m_count; ++j)
+            {
+                const double share = balancer.GetShare(j);
+                const double ms = (m_adapters[j].fixedMs + m_adapters[j].frameMs * share) * (1.0 + 0.01 * Jitter());
+                pending[j] = std::make_pair(share, ms);
+                slowest = std::max(slowest, ms);
+            }
+
+            ++m_frame;
+            return slowest;
+        }
+
+        uint32_t moves;
+
+    private:
+        static constexpr uint32_t c_FramesInFlight = 2;
+
+        // [-1, 1), repeatable from run to run.
+        double Jitter() noexcept
+        {
+            m_seed = m_seed * 1664525u + 1013904223u;
+            return double(m_seed >> 8) / double(1u << 23) - 1.0;
+        }
+
+        const SyntheticAdapter*             m_adapters;
+        uint32_t                            m_count;
+        uint32_t                            m_frame;
+        uint32_t                            m_seed;
+        std::pair<double, double>           m_pending[c_FramesInFlight][3];
+    };
+
+    bool AnyOutOfOrder(SimulatedScheduler& scheduler)
+    {
+        for (auto const& adapter : scheduler.GetBackend().adapters)
+        {
+            if (adapter.outOfOrder)
+                return true;
+        }
+        return false;
+    }
+}
+
+void Game::UnitTests()
+{
+    bool success = true;
+    OutputDebugStringA("*********** UNIT TESTS BEGIN ***************\n");
+
+    // GetSplitFrameBand
+    {
+        const DX::SplitFrameBand expected[] = { { 0, 240 }, { 240, 480 }, { 480, 720 } };
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            const auto band = DX::GetSplitFrameBand(j, 3, 720);
+            if (band.top != expected[j].top || band.bottom != expected[j].bottom)
+            {
+                OutputDebugStringA("ERROR: Failed GetSplitFrameBand even split\n");
+                success = false;
+            }
+        }
+
+        const auto top = DX::GetSplitFrameBand(0, 2, 1081);
+        const auto bottom = DX::GetSplitFrameBand(1, 2, 1081);
+        if (top.top != 0 || top.bottom != bottom.top || bottom.bottom != 1081)
+        {
+            OutputDebugStringA("ERROR: Failed GetSplitFrameBand odd split\n");
+            success = false;
+        }
+    }
+
+    // Split-frame: every adapter records its band of every frame.
+    {
+        SimulatedScheduler scheduler(SimulatedAdapters(3), 3);
+
+        std::mutex lock;
+        std::vector<DX::AdapterFrameWork> work;
+        for (int frame = 0; frame < 5; ++frame)
+        {
+            scheduler.RenderFrame([&](const DX::AdapterFrameWork& item)
+                {
+                    std::lock_guard<std::mutex> guard(lock);
+                    work.push_back(item);
+                });
+        }
+
+        if (work.size() != 15 || scheduler.GetFrameCount() != 5 || AnyOutOfOrder(scheduler))
+        {
+            OutputDebugStringA("ERROR: Failed MultiAdapterScheduler submission\n");
+            success = false;
+        }
+
+        for (auto const& item : work)
+        {
+            if (item.adapter >= 3 || item.frame >= 5 || item.region != item.adapter || item.regionCount != 3)
+            {
+                OutputDebugStringA("ERROR: Failed MultiAdapterScheduler split-frame bands\n");
+                success = false;
+                break;
+            }
+        }
+
+        // Frames in flight are the device's business: the scheduler never blocks the CPU.
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            const auto stats = scheduler.GetAdapterStats(j);
+            if (stats.frames != 5 || stats.fenceValue != 5
+                || scheduler.GetBackend().adapters[j].waits != 0)
+            {
+                OutputDebugStringA("ERROR: Failed MultiAdapterScheduler fences\n");
+                success = false;
+            }
+        }
+
+        // The present queue waits for both secondary adapters every frame, never for itself.
+        auto const& presentWaits = scheduler.GetBackend().presentWaits;
+        bool ordered = presentWaits.size() == 10;
+        for (size_t j = 0; ordered && j < presentWaits.size(); ++j)
+        {
+            ordered = presentWaits[j].first == uint32_t(1 + (j % 2)) && presentWaits[j].second == uint64_t(j / 2 + 1);
+        }
+        auto const& composite = scheduler.GetCompositeAdapters();
+        if (!ordered || composite.size() != 2 || composite[0] != 1 || composite[1] != 2)
+        {
+            OutputDebugStringA("ERROR: Failed MultiAdapterScheduler present waits\n");
+            success = false;
+        }
+
+        scheduler.WaitForIdle();
+        for (auto const& adapter : scheduler.GetBackend().adapters)
+        {
+            if (adapter.completed != 5)
+            {
+                OutputDebugStringA("ERROR: Failed MultiAdapterScheduler WaitForIdle\n");
+                success = false;
+            }
+        }
+    }
+
+    // Alternate-frame: adapters take turns, and the present queue only waits for the one that rendered.
+    {
+        SimulatedScheduler scheduler(SimulatedAdapters(3), 3, DX::MultiAdapterMode::AlternateFrame);
+
+        std::vector<DX::AdapterFrameWork> work;
+        bool composited = true;
+        for (int frame = 0; frame < 6; ++frame)
+        {
+            scheduler.RenderFrame([&](const DX::AdapterFrameWork& item)
+                {
+                    work.push_back(item);
+                });
+
+            auto const& composite = scheduler.GetCompositeAdapters();
+            const uint32_t adapter = uint32_t(frame % 3);
+            if (adapter == 0 ? !composite.empty() : (composite.size() != 1 || composite[0] != adapter))
+            {
+                composited = false;
+            }
+        }
+
+        bool alternated = work.size() == 6;
+        for (size_t j = 0; alternated && j < work.size(); ++j)
+        {
+            alternated = work[j].adapter == j % 3 && work[j].frame == j && work[j].region == 0 && work[j].regionCount == 1;
+        }
+
+        const std::pair<uint32_t, uint64_t> expected[] = { { 1, 1 }, { 2, 1 }, { 1, 2 }, { 2, 2 } };
+        auto const& presentWaits = scheduler.GetBackend().presentWaits;
+        if (!alternated || !composited || AnyOutOfOrder(scheduler)
+            || !std::equal(presentWaits.cbegin(), presentWaits.cend(), std::cbegin(expected), std::cend(expected))
+            || scheduler.GetAdapterStats(0).frames != 2 || scheduler.GetAdapterStats(2).fenceValue != 2)
+        {
+            OutputDebugStringA("ERROR: Failed MultiAdapterScheduler alternate-frame\n");
+            success = false;
+        }
+    }
+
+    // Adapters record concurrently: each waits for all of the others to start.
+    {
+        SimulatedScheduler scheduler(SimulatedAdapters(3), 3);
+
+        std::mutex lock;
+        std::condition_variable arrived;
+        uint32_t count = 0;
+        bool concurrent = true;
+        scheduler.RenderFrame([&](const DX::AdapterFrameWork&)
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                ++count;
+                arrived.notify_all();
+                if (!arrived.wait_for(guard, std::chrono::seconds(5), [&] { return count == 3; }))
+                {
+                    concurrent = false;
+                }
+            });
+
+        if (!concurrent || count != 3)
+        {
+            OutputDebugStringA("ERROR: Failed MultiAdapterScheduler concurrent recording\n");
+            success = false;
+        }
+    }
+
+    // An adapter that fails to record is neither signaled nor waited on, and the next frame is unaffected.
+    {
+        SimulatedScheduler scheduler(SimulatedAdapters(3), 3);
+
+        bool threw = false;
+        try
+        {
+            scheduler.RenderFrame([](const DX::AdapterFrameWork& item)
+                {
+                    if (item.adapter == 1)
+                        throw std::runtime_error("record failed");
+                });
+        }
+        catch (const std::runtime_error&)
+        {
+            threw = true;
+        }
+
+        auto const& backend = scheduler.GetBackend();
+        if (!threw
+            || scheduler.GetAdapterStats(1).fenceValue != 0 || backend.adapters[1].signaled != 0
+            || scheduler.GetAdapterStats(2).fenceValue != 1
+            || backend.presentWaits.size() != 1 || backend.presentWaits[0].first != 2
+            || scheduler.GetCompositeAdapters().size() != 1 || scheduler.GetCompositeAdapters()[0] != 2)
+        {
+            OutputDebugStringA("ERROR: Failed MultiAdapterScheduler record exception\n");
+            success = false;
+        }
+
+        scheduler.RenderFrame([](const DX::AdapterFrameWork&) {});
+        if (scheduler.GetFrameCount() != 2
+            || scheduler.GetAdapterStats(1).fenceValue != 1
+            || scheduler.GetAdapterStats(2).fenceValue != 2
+            || AnyOutOfOrder(scheduler))
+        {
+            OutputDebugStringA("ERROR: Failed MultiAdapterScheduler frame after exception\n");
+            success = false;
+        }
+    }
+
+    // Invalid configurations
+    {
+        const uint32_t configs[][2] = { { 0, 0 }, { 2, 2 } };
+        for (auto const& config : configs)
+        {
+            try
+            {
+                SimulatedScheduler scheduler(SimulatedAdapters(config[0]), config[0], DX::MultiAdapterMode::SplitFrame, config[1]);
+                OutputDebugStringA("ERROR: Failed MultiAdapterScheduler invalid configuration\n");
+                success = false;
+            }
+            catch (const std::invalid_argument&)
+            {
+            }
+        }
+    }
+
+    // Split-frame balancing against synthetic traces
+    {
+        // Equal bands to start, contiguous, aligned, and covering the frame.
+        DX::SplitFrameBalancer<> balancer(3);
+        uint32_t next = 0;
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            const auto band = balancer.GetBand(j, 1080, 8);
+            if (band.top != next || (j < 2 && (band.bottom % 8) != 0) || std::abs(double(band.bottom - band.top) - 360.0) > 8.0)
+            {
+                OutputDebugStringA("ERROR: Failed SplitFrameBalancer initial bands\n");
+                success = false;
+            }
+            next = band.bottom;
+        }
+        if (next != 1080 || balancer.Rebalance())
+        {
+            OutputDebugStringA("ERROR: Failed SplitFrameBalancer initial bands\n");
+            success = false;
+        }
+    }
+
+    {
+        // A card three times faster than its partner ends up with three quarters of the frame.
+        const SyntheticAdapter adapters[] = { { 0.0, 10.0 }, { 0.0, 30.0 } };
+        DX::SplitFrameBalancer<> balancer(2);
+        SyntheticTrace trace(adapters, 2);
+
+        double first = 0.0;
+        double last = 0.0;
+        for (int frame = 0; frame < 120; ++frame)
+        {
+            const double ms = trace.RunFrame(balancer);
+            if (frame == 0)
+                first = ms;
+            last = ms;
+        }
+
+        if (std::abs(balancer.GetShare(0) - 0.75) > 0.02 || first < 14.0 || last > 8.0)
+        {
+            OutputDebugStringA("ERROR: Failed SplitFrameBalancer proportional trace\n");
+            success = false;
+        }
+    }
+
+    {
+        // The present adapter has a large cost that does not depend on its band, e.g. a composite,
+        // which the affine model separates from the cost of its rows.
+        const SyntheticAdapter adapters[] = { { 8.0, 8.0 }, { 1.0, 16.0 } };
+
+        DX::SplitFrameBalancer<DX::AffineCostModel> balancer(2);
+        SyntheticTrace trace(adapters, 2);
+        double last = 0.0;
+        for (int frame = 0; frame < 200; ++frame)
+        {
+            last = trace.RunFrame(balancer);
+        }
+
+        // 8 + 8s = 1 + 16(1 - s)  =>  s = 3/8
+        if (std::abs(balancer.GetShare(0) - 0.375) > 0.03
+            || std::abs(balancer.GetCostModel().GetFixedMilliseconds(0) - 8.0) > 1.0
+            || last > 11.5)
+        {
+            OutputDebugStringA("ERROR: Failed SplitFrameBalancer affine trace\n");
+            success = false;
+        }
+    }
+
+    {
+        // Three adapters; the first one throttles to a quarter of its speed partway through.
+        SyntheticAdapter adapters[] = { { 0.0, 10.0 }, { 0.0, 20.0 }, { 0.0, 20.0 } };
+        DX::SplitFrameBalancer<> balancer(3);
+        SyntheticTrace trace(adapters, 3);
+
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            trace.RunFrame(balancer);
+        }
+        const bool before = std::abs(balancer.GetShare(0) - 0.5) < 0.02 && std::abs(balancer.GetShare(1) - 0.25) < 0.02;
+
+        adapters[0].frameMs = 40.0;
+        double last = 0.0;
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            last = trace.RunFrame(balancer);
+        }
+
+        // 1/40 : 1/20 : 1/20
+        if (!before
+            || std::abs(balancer.GetShare(0) - 0.2) > 0.02 || std::abs(balancer.GetShare(2) - 0.4) > 0.02
+            || last > 8.0 * 1.06)
+        {
+            OutputDebugStringA("ERROR: Failed SplitFrameBalancer throttle trace\n");
+            success = false;
+        }
+    }
+
+    {
+        // A much slower card is held at the minimum share rather than dropped.
+        const SyntheticAdapter adapters[] = { { 0.0, 10.0 }, { 0.0, 1000.0 } };
+        DX::SplitFrameBalancer<> balancer(2);
+        balancer.SetMinimumShare(0.1);
+        SyntheticTrace trace(adapters, 2);
+        for (int frame = 0; frame < 100; ++frame)
+        {
+            trace.RunFrame(balancer);
+        }
+
+        if (std::abs(balancer.GetShare(1) - 0.1) > 1e-6 || balancer.GetBand(1, 1000).top != 900)
+        {
+            OutputDebugStringA("ERROR: Failed SplitFrameBalancer minimum share\n");
+            success = false;
+        }
+    }
+
+    {
+        // Matched cards stay inside the deadband and never move.
+        const SyntheticAdapter adapters[] = { { 0.5, 12.0 }, { 0.5, 12.0 } };
+        DX::SplitFrameBalancer<DX::AffineCostModel> balancer(2);
+        SyntheticTrace trace(adapters, 2);
+        for (int frame = 0; frame < 50; ++frame)
+        {
+            trace.RunFrame(balancer);
+        }
+
+        if (balancer.GetShare(0) != 0.5 || trace.moves != 0)
+        {
+            OutputDebugStringA("ERROR: Failed SplitFrameBalancer deadband\n");
+            success = false;
+        }
+    }
+
+    {
+        bool threw = false;
+        try
+        {
+            DX::SplitFrameBalancer<> balancer(0);
+        }
+        catch (const std::invalid_argument&)
+        {
+            threw = true;
+        }
+
+        DX::SplitFrameBalancer<> balancer(4);
+        try
+        {
+            balancer.SetMinimumShare(0.3);
+            threw = false;
+        }
+        catch (const std::invalid_argument&)
+        {
+        }
+
+        if (!threw)
+        {
+            OutputDebugStringA("ERROR: Failed SplitFrameBalancer invalid arguments\n");
+            success = false;
+        }
+    }
+
+    OutputDebugStringA(success ? "Passed\n" : "Failed\n");
+    OutputDebugStringA("***********  UNIT TESTS END  ***************\n");
+
+    if (!success)
+    {
+        throw std::runtime_error("Unit Tests Failed");
+    }
+}
+#pragma endregion
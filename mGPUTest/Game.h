@@ -17,6 +17,9 @@
 #endif
 #include "StepTimer.h"
 
+#include "MultiAdapterSchedulerD3D12.h"
+#include "SplitFrameBalancer.h"
+
 constexpr uint32_t c_testTimeout = 5000;
 
 // A basic game implementation that creates a D3D12 device and provides a game loop.
@@ -73,12 +76,15 @@ private:
 
     void Update(DX::StepTimer const& timer);
     void Render();
+    void RenderAdapter(unsigned int adapterIdx);
 
-    void Clear();
+    void Clear(unsigned int adapterIdx, const D3D12_RECT& region);
 
     void CreateDeviceDependentResources();
     void CreateWindowSizeDependentResources();
 
+    void UnitTests();
+
     // Device resources.
     std::unique_ptr<DX::DeviceResources>									m_deviceResources;
 
@@ -89,6 +95,8 @@ private:
     std::unique_ptr<DirectX::GamePad>										m_gamePad;
     std::unique_ptr<DirectX::Keyboard>										m_keyboard;
 
+    DirectX::Keyboard::KeyboardStateTracker                                 m_keyboardButtons;
+
     // DirectXTK Test Objects
     static constexpr size_t MAX_DEVICES = 3;
 
@@ -97,4 +105,16 @@ private:
     std::unique_ptr<DirectX::BasicEffect>                                   m_effectLine[MAX_DEVICES];
     std::unique_ptr<DirectX::BasicEffect>                                   m_effectTri[MAX_DEVICES];
     std::unique_ptr<DirectX::PrimitiveBatch<DirectX::VertexPositionColor>>  m_batch[MAX_DEVICES];
+
+    std::unique_ptr<DX::D3D12MultiAdapterScheduler>                         m_scheduler;
+
+    // Part of the frame each adapter rendered this frame.
+    D3D12_RECT                                                              m_regions[MAX_DEVICES];
+
+    // Split-frame bands sized by measured GPU time. The present adapter also composites the
+    // other bands, a cost that does not scale with its own band, so the affine model is used.
+    std::unique_ptr<DX::SplitFrameBalancer<DX::AffineCostModel>>            m_balancer;
+    std::unique_ptr<DX::D3D12AdapterFrameTimer>                             m_frameTimer[MAX_DEVICES];
+    std::vector<double>                                                     m_bandShares[MAX_DEVICES];  // share each back buffer was rendered with; < 0 if not split-frame
+    std::pair<double, double>                                               m_bandTiming[MAX_DEVICES];  // (share, ms) read back this frame; ms < 0 if none
 };
@@ -0,0 +1,235 @@
+//--------------------------------------------------------------------------------------
+// File: MultiAdapterScheduler.h
+//
+// Records and submits each adapter's work for a frame on its own thread, in split-frame
+// (every adapter renders a band of every frame) or alternate-frame (adapters take turns)
+// mode, and orders the present adapter's queue after the adapters whose output it shows
+//
+// Each adapter signals its own fence after its work is submitted. The present adapter's
+// queue waits (on the GPU) only for the other adapters that rendered the frame; the caller
+// then composites their output into the back buffer (see GetCompositeAdapters). Reuse of
+// an adapter's per-frame resources is left to the device layer, which already waits for a
+// back buffer's previous frame on every adapter before that frame is recorded again.
+// The device calls are made through the backend (see MultiAdapterSchedulerD3D12.h), so
+// the scheduling can be driven by simulated adapters.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "ParallelRecording.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    enum class MultiAdapterMode : uint32_t
+    {
+        SplitFrame,
+        AlternateFrame,
+    };
+
+    // One adapter's share of a frame.
+    struct AdapterFrameWork
+    {
+        uint32_t    adapter;
+        uint64_t    frame;
+        uint32_t    region;         // split-frame band; always 0 of 1 for alternate-frame
+        uint32_t    regionCount;
+    };
+
+    struct AdapterScheduleStats
+    {
+        uint64_t    frames;             // frames this adapter has rendered
+        uint64_t    fenceValue;         // last value signaled
+        double      lastRecordMs;       // CPU time of the last record call, including submission
+    };
+
+    // TBackend must provide:
+    //
+    //  uint64_t GetCompletedValue(uint32_t adapter);
+    //  void WaitForValue(uint32_t adapter, uint64_t value);            // blocks the calling thread
+    //  void Signal(uint32_t adapter, uint64_t value);                  // on the adapter's queue
+    //  void WaitOnPresentQueue(uint32_t adapter, uint64_t value);      // the present adapter's queue waits for 'adapter'
+    //
+    // Signal is called from the thread recording 'adapter' and must be safe to call
+    // concurrently for different adapters.
+    template<typename TBackend>
+    class MultiAdapterScheduler
+    {
+    public:
+        MultiAdapterScheduler(TBackend backend, uint32_t adapterCount,
+            MultiAdapterMode mode = MultiAdapterMode::SplitFrame, uint32_t presentAdapter = 0) :
+            m_backend(std::move(backend)),
+            m_jobs(adapterCount > 0 ? adapterCount - 1 : 0),
+            m_adapters(adapterCount),
+            m_mode(mode),
+            m_presentAdapter(presentAdapter),
+            m_frame(0),
+            m_lastFrameMs(0.0)
+        {
+            if (!adapterCount || presentAdapter >= adapterCount)
+                throw std::invalid_argument("Invalid MultiAdapterScheduler configuration");
+        }
+
+        MultiAdapterScheduler(MultiAdapterScheduler const&) = delete;
+        MultiAdapterScheduler& operator= (MultiAdapterScheduler const&) = delete;
+
+        // Takes effect from the next frame. Fence tracking is per adapter, so no drain is needed.
+        void SetMode(MultiAdapterMode mode) noexcept { m_mode = mode; }
+        MultiAdapterMode GetMode() const noexcept { return m_mode; }
+
+        uint32_t GetAdapterCount() const noexcept { return static_cast<uint32_t>(m_adapters.size()); }
+        uint32_t GetPresentAdapter() const noexcept { return m_presentAdapter; }
+        uint64_t GetFrameCount() const noexcept { return m_frame; }
+
+        // Adapters that render frame 'frame', in ascending order.
+        void GetFrameAdapters(uint64_t frame, std::vector<uint32_t>& adapters) const
+        {
+            adapters.clear();
+            if (m_mode == MultiAdapterMode::AlternateFrame)
+            {
+                adapters.push_back(static_cast<uint32_t>(frame % m_adapters.size()));
+                return;
+            }
+
+            for (uint32_t j = 0; j < GetAdapterCount(); ++j)
+            {
+                adapters.push_back(j);
+            }
+        }
+
+        // Calls record(work) for each adapter that renders this frame, one thread per adapter.
+        // 'record' must record and submit all of that adapter's work for the frame, and must
+        // not touch another adapter's objects. The first exception thrown is rethrown once
+        // every adapter has finished; adapters that threw are not signaled or waited on.
+        template<typename TFunc>
+        void RenderFrame(TFunc&& record)
+        {
+            const auto start = std::chrono::steady_clock::now();
+
+            GetFrameAdapters(m_frame, m_frameAdapters);
+            const uint32_t regionCount = static_cast<uint32_t>(m_frameAdapters.size());
+
+            m_submitted.assign(m_frameAdapters.size(), 0);
+
+            std::exception_ptr error;
+            try
+            {
+                m_jobs.Run(m_frameAdapters.size(), [&](size_t index, size_t)
+                    {
+                        const uint32_t adapter = m_frameAdapters[index];
+                        auto& state = m_adapters[adapter];
+
+                        AdapterFrameWork work = {};
+                        work.adapter = adapter;
+                        work.frame = m_frame;
+                        work.region = (m_mode == MultiAdapterMode::SplitFrame) ? static_cast<uint32_t>(index) : 0u;
+                        work.regionCount = (m_mode == MultiAdapterMode::SplitFrame) ? regionCount : 1u;
+
+                        const auto recordStart = std::chrono::steady_clock::now();
+                        record(work);
+                        state.lastRecordMs = ToMilliseconds(std::chrono::steady_clock::now() - recordStart);
+
+                        const uint64_t value = ++state.fenceValue;
+                        m_backend.Signal(adapter, value);
+                        ++state.frames;
+
+                        m_submitted[index] = value;
+                    });
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            // The present adapter shows the other adapters' bands (or their alternate frame), so its
+            // queue waits for exactly those adapters, and for none that did not render the frame.
+            m_compositeAdapters.clear();
+            for (size_t j = 0; j < m_frameAdapters.size(); ++j)
+            {
+                if (m_frameAdapters[j] != m_presentAdapter && m_submitted[j])
+                {
+                    m_backend.WaitOnPresentQueue(m_frameAdapters[j], m_submitted[j]);
+                    m_compositeAdapters.push_back(m_frameAdapters[j]);
+                }
+            }
+
+            ++m_frame;
+            m_lastFrameMs = ToMilliseconds(std::chrono::steady_clock::now() - start);
+
+            if (error)
+            {
+                std::rethrow_exception(error);
+            }
+        }
+
+        // Blocks until every adapter has finished all submitted work, e.g. before a resize.
+        void WaitForIdle()
+        {
+            for (uint32_t j = 0; j < GetAdapterCount(); ++j)
+            {
+                const uint64_t value = m_adapters[j].fenceValue;
+                if (value && m_backend.GetCompletedValue(j) < value)
+                {
+                    m_backend.WaitForValue(j, value);
+                }
+            }
+        }
+
+        // Adapters other than the present adapter that rendered the last frame, in ascending order.
+        // The present adapter's queue already waits for them, so copies of their output submitted
+        // to it next are ordered after their work.
+        const std::vector<uint32_t>& GetCompositeAdapters() const noexcept { return m_compositeAdapters; }
+
+        AdapterScheduleStats GetAdapterStats(uint32_t adapter) const noexcept
+        {
+            assert(adapter < m_adapters.size());
+            const auto& state = m_adapters[adapter];
+            return { state.frames, state.fenceValue, state.lastRecordMs };
+        }
+
+        // Wall-clock CPU time of the last RenderFrame.
+        double GetLastFrameMilliseconds() const noexcept { return m_lastFrameMs; }
+
+        TBackend& GetBackend() noexcept { return m_backend; }
+
+    private:
+        template<typename TDuration>
+        static double ToMilliseconds(TDuration duration) noexcept
+        {
+            return std::chrono::duration<double, std::milli>(duration).count();
+        }
+
+        struct AdapterState
+        {
+            AdapterState() noexcept : frames(0), fenceValue(0), lastRecordMs(0.0) {}
+
+            uint64_t                frames;
+            uint64_t                fenceValue;
+            double                  lastRecordMs;
+        };
+
+        TBackend                    m_backend;
+        RecordingJobSystem          m_jobs;
+        std::vector<AdapterState>   m_adapters;
+        MultiAdapterMode            m_mode;
+        uint32_t                    m_presentAdapter;
+        uint64_t                    m_frame;
+        double                      m_lastFrameMs;
+
+        std::vector<uint32_t>       m_frameAdapters;
+        std::vector<uint64_t>       m_submitted;            // per frame adapter; 0 if it threw
+        std::vector<uint32_t>       m_compositeAdapters;
+    };
+}
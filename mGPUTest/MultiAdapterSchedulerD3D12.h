@@ -0,0 +1,163 @@
+//--------------------------------------------------------------------------------------
+// File: MultiAdapterSchedulerD3D12.h
+//
+// Direct3D 12 backend for DX::MultiAdapterScheduler
+//
+// Each adapter gets its own fence. Fences of the other adapters are created shared
+// across adapters and opened on the present adapter's device, so its queue can wait
+// for them on the GPU. D3D12AdapterFrameTimer times each adapter's share of a frame
+// with timestamp queries, for SplitFrameBalancer.
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include "MultiAdapterScheduler.h"
+
+#include <vector>
+
+#include <wrl/client.h>
+
+
+namespace DX
+{
+    class D3D12MultiAdapterBackend
+    {
+    public:
+        D3D12MultiAdapterBackend(
+            _In_reads_(adapterCount) ID3D12Device* const* devices,
+            _In_reads_(adapterCount) ID3D12CommandQueue* const* commandQueues,
+            uint32_t adapterCount,
+            uint32_t presentAdapter = 0) :
+            m_presentAdapter(presentAdapter)
+        {
+            m_adapters.resize(adapterCount);
+            for (uint32_t j = 0; j < adapterCount; ++j)
+            {
+                auto& adapter = m_adapters[j];
+                adapter.commandQueue = commandQueues[j];
+
+                const D3D12_FENCE_FLAGS flags = (j == presentAdapter)
+                    ? D3D12_FENCE_FLAG_NONE
+                    : (D3D12_FENCE_FLAG_SHARED | D3D12_FENCE_FLAG_SHARED_CROSS_ADAPTER);
+                ThrowIfFailed(devices[j]->CreateFence(0, flags, IID_PPV_ARGS(adapter.fence.GetAddressOf())));
+                adapter.fence->SetName(L"MultiAdapterScheduler");
+
+                if (j == presentAdapter)
+                {
+                    adapter.presentFence = adapter.fence;
+                    continue;
+                }
+
+                HANDLE sharedHandle = nullptr;
+                ThrowIfFailed(devices[j]->CreateSharedHandle(adapter.fence.Get(), nullptr, GENERIC_ALL, nullptr, &sharedHandle));
+                const HRESULT hr = devices[presentAdapter]->OpenSharedHandle(sharedHandle, IID_PPV_ARGS(adapter.presentFence.GetAddressOf()));
+                std::ignore = CloseHandle(sharedHandle);
+                ThrowIfFailed(hr);
+            }
+        }
+
+        uint64_t GetCompletedValue(uint32_t adapter) const
+        {
+            return m_adapters[adapter].fence->GetCompletedValue();
+        }
+
+        void WaitForValue(uint32_t adapter, uint64_t value)
+        {
+            // A null event makes SetEventOnCompletion block until the fence reaches the value.
+            ThrowIfFailed(m_adapters[adapter].fence->SetEventOnCompletion(value, nullptr));
+        }
+
+        void Signal(uint32_t adapter, uint64_t value)
+        {
+            ThrowIfFailed(m_adapters[adapter].commandQueue->Signal(m_adapters[adapter].fence.Get(), value));
+        }
+
+        void WaitOnPresentQueue(uint32_t adapter, uint64_t value)
+        {
+            ThrowIfFailed(m_adapters[m_presentAdapter].commandQueue->Wait(m_adapters[adapter].presentFence.Get(), value));
+        }
+
+    private:
+        struct Adapter
+        {
+            Microsoft::WRL::ComPtr<ID3D12CommandQueue>  commandQueue;
+            Microsoft::WRL::ComPtr<ID3D12Fence>         fence;
+            Microsoft::WRL::ComPtr<ID3D12Fence>         presentFence;   // 'fence' as opened on the present adapter's device
+        };
+
+        uint32_t                m_presentAdapter;
+        std::vector<Adapter>    m_adapters;
+    };
+
+    using D3D12MultiAdapterScheduler = MultiAdapterScheduler<D3D12MultiAdapterBackend>;
+
+    // GPU time of one adapter's work for each frame in flight, from a pair of timestamps.
+    // A slot's result may only be read once the work last timed in it has completed on the
+    // adapter, e.g. per back buffer after DeviceResources has waited for that back buffer.
+    class D3D12AdapterFrameTimer
+    {
+    public:
+        D3D12AdapterFrameTimer(_In_ ID3D12Device* device, _In_ ID3D12CommandQueue* commandQueue, uint32_t framesInFlight) :
+            m_frequency(0),
+            m_resolved(framesInFlight, false)
+        {
+            ThrowIfFailed(commandQueue->GetTimestampFrequency(&m_frequency));
+
+            D3D12_QUERY_HEAP_DESC desc = {};
+            desc.Type = D3D12_QUERY_HEAP_TYPE_TIMESTAMP;
+            desc.Count = framesInFlight * 2;
+            ThrowIfFailed(device->CreateQueryHeap(&desc, IID_PPV_ARGS(m_queryHeap.ReleaseAndGetAddressOf())));
+
+            const CD3DX12_HEAP_PROPERTIES readbackHeap(D3D12_HEAP_TYPE_READBACK);
+            const auto bufferDesc = CD3DX12_RESOURCE_DESC::Buffer(sizeof(uint64_t) * desc.Count);
+            ThrowIfFailed(device->CreateCommittedResource(
+                &readbackHeap,
+                D3D12_HEAP_FLAG_NONE,
+                &bufferDesc,
+                D3D12_RESOURCE_STATE_COPY_DEST,
+                nullptr,
+                IID_PPV_ARGS(m_readback.ReleaseAndGetAddressOf())));
+            m_readback->SetName(L"AdapterFrameTimer");
+        }
+
+        void Start(_In_ ID3D12GraphicsCommandList* commandList, uint32_t slot)
+        {
+            commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, slot * 2);
+        }
+
+        void Stop(_In_ ID3D12GraphicsCommandList* commandList, uint32_t slot)
+        {
+            commandList->EndQuery(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, slot * 2 + 1);
+            commandList->ResolveQueryData(m_queryHeap.Get(), D3D12_QUERY_TYPE_TIMESTAMP, slot * 2, 2,
+                m_readback.Get(), sizeof(uint64_t) * slot * 2);
+            m_resolved[slot] = true;
+        }
+
+        // Returns false if nothing has been timed in this slot yet.
+        bool GetMilliseconds(uint32_t slot, double& ms) const
+        {
+            if (!m_resolved[slot])
+                return false;
+
+            const D3D12_RANGE range = { sizeof(uint64_t) * slot * 2, sizeof(uint64_t) * (slot * 2 + 2) };
+            void* data = nullptr;
+            ThrowIfFailed(m_readback->Map(0, &range, &data));
+            auto const timestamps = reinterpret_cast<const uint64_t*>(static_cast<const uint8_t*>(data) + range.Begin);
+            const uint64_t ticks = (timestamps[1] > timestamps[0]) ? timestamps[1] - timestamps[0] : 0;
+
+            const D3D12_RANGE written = {};
+            m_readback->Unmap(0, &written);
+
+            ms = double(ticks) * 1000.0 / double(m_frequency);
+            return true;
+        }
+
+    private:
+        uint64_t                                    m_frequency;
+        std::vector<bool>                           m_resolved;
+        Microsoft::WRL::ComPtr<ID3D12QueryHeap>     m_queryHeap;
+        Microsoft::WRL::ComPtr<ID3D12Resource>      m_readback;
+    };
+}
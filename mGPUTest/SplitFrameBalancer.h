@@ -0,0 +1,354 @@
+//--------------------------------------------------------------------------------------
+// File: SplitFrameBalancer.h
+//
+// Moves the split-frame band boundaries so that adapters of different speeds finish
+// their bands at the same time
+//
+// Each adapter's measured GPU time for its band is fed to a cost model, which predicts
+// how long that adapter would take for any share of the frame. Rebalance then solves for
+// the shares whose predicted times are equal, and moves toward them a limited step at a
+// time, since the measurements lag the shares by the frames in flight.
+//
+// A cost model must provide:
+//
+//   void   Reset(uint32_t regionCount);
+//   void   Observe(uint32_t region, double share, double ms);
+//   bool   IsReady(uint32_t region) const;                 // has enough samples to predict
+//   double Predict(uint32_t region, double share) const;   // ms; non-decreasing in 'share'
+//
+// Copyright (c) Microsoft Corporation.
+// Licensed under the MIT License.
+//--------------------------------------------------------------------------------------
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace DX
+{
+    // Rows [top, bottom) of band 'region' when 'height' rows are split into 'regionCount' equal bands.
+    struct SplitFrameBand
+    {
+        uint32_t    top;
+        uint32_t    bottom;
+    };
+
+    inline SplitFrameBand GetSplitFrameBand(uint32_t region, uint32_t regionCount, uint32_t height) noexcept
+    {
+        assert(region < regionCount);
+        const uint64_t top = uint64_t(height) * region / regionCount;
+        const uint64_t bottom = uint64_t(height) * (region + 1) / regionCount;
+        return { static_cast<uint32_t>(top), static_cast<uint32_t>(bottom) };
+    }
+
+    // Time proportional to the share of the frame: ms = rate * share.
+    class ProportionalCostModel
+    {
+    public:
+        // 'smoothing' is the weight of each new sample.
+        explicit ProportionalCostModel(double smoothing = 0.25) noexcept : m_smoothing(smoothing) {}
+
+        void Reset(uint32_t regionCount)
+        {
+            m_rates.assign(regionCount, 0.0);
+        }
+
+        void Observe(uint32_t region, double share, double ms)
+        {
+            assert(region < m_rates.size());
+            if (share <= 0.0 || ms < 0.0)
+                return;
+
+            const double rate = ms / share;
+            m_rates[region] = (m_rates[region] > 0.0) ? m_rates[region] + m_smoothing * (rate - m_rates[region]) : rate;
+        }
+
+        bool IsReady(uint32_t region) const noexcept { return m_rates[region] > 0.0; }
+
+        double Predict(uint32_t region, double share) const noexcept { return m_rates[region] * share; }
+
+    private:
+        double              m_smoothing;
+        std::vector<double> m_rates;        // ms for the whole frame
+    };
+
+    // Time with a per-adapter overhead that does not scale with the share: ms = fixed + rate * share.
+    // Fitted by exponentially-weighted least squares. Once the shares settle there is too little
+    // spread to separate the two terms, so the last overhead is kept and only the rate is refitted.
+    class AffineCostModel
+    {
+    public:
+        explicit AffineCostModel(double forgetting = 0.9) noexcept : m_forgetting(forgetting) {}
+
+        void Reset(uint32_t regionCount)
+        {
+            m_regions.assign(regionCount, Region{});
+        }
+
+        void Observe(uint32_t region, double share, double ms)
+        {
+            assert(region < m_regions.size());
+            if (share <= 0.0 || ms < 0.0)
+                return;
+
+            auto& r = m_regions[region];
+            r.weight = r.weight * m_forgetting + 1.0;
+            r.sumX = r.sumX * m_forgetting + share;
+            r.sumY = r.sumY * m_forgetting + ms;
+            r.sumXX = r.sumXX * m_forgetting + share * share;
+            r.sumXY = r.sumXY * m_forgetting + share * ms;
+
+            const double meanX = r.sumX / r.weight;
+            const double meanY = r.sumY / r.weight;
+            const double varX = r.sumXX / r.weight - meanX * meanX;
+
+            if (varX > c_MinShareVariance)
+            {
+                const double covXY = r.sumXY / r.weight - meanX * meanY;
+                const double rate = std::max(covXY / varX, 0.0);
+                r.fixed = std::max(meanY - rate * meanX, 0.0);
+            }
+            else
+            {
+                r.fixed = std::min(r.fixed, meanY);
+            }
+
+            r.rate = std::max((meanY - r.fixed) / meanX, 0.0);
+            r.ready = true;
+        }
+
+        bool IsReady(uint32_t region) const noexcept { return m_regions[region].ready; }
+
+        double Predict(uint32_t region, double share) const noexcept
+        {
+            const auto& r = m_regions[region];
+            return r.fixed + r.rate * share;
+        }
+
+        double GetFixedMilliseconds(uint32_t region) const noexcept { return m_regions[region].fixed; }
+        double GetRate(uint32_t region) const noexcept { return m_regions[region].rate; }
+
+    private:
+        static constexpr double c_MinShareVariance = 1e-4;
+
+        struct Region
+        {
+            double  weight;
+            double  sumX;
+            double  sumY;
+            double  sumXX;
+            double  sumXY;
+            double  fixed;
+            double  rate;
+            bool    ready;
+        };
+
+        double              m_forgetting;
+        std::vector<Region> m_regions;
+    };
+
+    template<typename TCostModel = ProportionalCostModel>
+    class SplitFrameBalancer
+    {
+    public:
+        explicit SplitFrameBalancer(uint32_t regionCount, TCostModel model = TCostModel()) :
+            m_model(std::move(model)),
+            m_minShare(0.05),
+            m_maxStep(0.05),
+            m_deadband(0.02),
+            m_predictedMs(0.0)
+        {
+            if (!regionCount)
+                throw std::invalid_argument("SplitFrameBalancer needs at least one region");
+
+            m_shares.resize(regionCount);
+            Reset();
+        }
+
+        // Equal bands, and forgets every measurement.
+        void Reset()
+        {
+            std::fill(m_shares.begin(), m_shares.end(), 1.0 / double(m_shares.size()));
+            m_model.Reset(GetRegionCount());
+            m_predictedMs = 0.0;
+        }
+
+        // No band is ever shrunk below this, so every adapter keeps being measured.
+        void SetMinimumShare(double share)
+        {
+            if (share < 0.0 || share * double(m_shares.size()) > 1.0)
+                throw std::invalid_argument("Minimum share must be in [0, 1 / regionCount]");
+            m_minShare = share;
+        }
+
+        // Largest change to any share per Rebalance.
+        void SetMaximumStep(double step) noexcept { m_maxStep = std::max(step, 0.0); }
+
+        // Predicted finish times within this fraction of each other are left alone.
+        void SetDeadband(double fraction) noexcept { m_deadband = std::max(fraction, 0.0); }
+
+        uint32_t GetRegionCount() const noexcept { return static_cast<uint32_t>(m_shares.size()); }
+        double GetShare(uint32_t region) const noexcept { assert(region < m_shares.size()); return m_shares[region]; }
+
+        // Rows [top, bottom) of 'region'. Inner boundaries are rounded to a multiple of 'alignment'.
+        SplitFrameBand GetBand(uint32_t region, uint32_t height, uint32_t alignment = 1) const noexcept
+        {
+            assert(region < m_shares.size());
+            return { GetBoundary(region, height, alignment), GetBoundary(region + 1, height, alignment) };
+        }
+
+        // 'ms' is the GPU time 'region' took for a frame rendered with 'share'; pass the share that
+        // frame actually used, not the current one.
+        void Observe(uint32_t region, double share, double ms)
+        {
+            m_model.Observe(region, share, ms);
+        }
+
+        // Returns true if the shares moved. Does nothing until every region has been observed.
+        bool Rebalance()
+        {
+            const uint32_t count = GetRegionCount();
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                if (!m_model.IsReady(j))
+                    return false;
+            }
+
+            double fastest = 0.0;
+            double slowest = 0.0;
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                const double ms = m_model.Predict(j, m_shares[j]);
+                fastest = (j == 0) ? ms : std::min(fastest, ms);
+                slowest = std::max(slowest, ms);
+            }
+            m_predictedMs = slowest;
+
+            if (count == 1 || slowest <= 0.0 || (slowest - fastest) <= m_deadband * slowest)
+                return false;
+
+            SolveEqualFinish(m_targets);
+
+            // Scaling the whole move keeps the shares summing to one.
+            double largest = 0.0;
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                largest = std::max(largest, std::abs(m_targets[j] - m_shares[j]));
+            }
+            if (largest <= 0.0)
+                return false;
+
+            const double scale = std::min(1.0, m_maxStep / largest);
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                m_shares[j] += (m_targets[j] - m_shares[j]) * scale;
+            }
+            return true;
+        }
+
+        // The slowest region's predicted time at the shares before the last Rebalance.
+        double GetPredictedMilliseconds() const noexcept { return m_predictedMs; }
+
+        TCostModel& GetCostModel() noexcept { return m_model; }
+        const TCostModel& GetCostModel() const noexcept { return m_model; }
+
+    private:
+        static constexpr int c_Iterations = 40;
+
+        uint32_t GetBoundary(uint32_t index, uint32_t height, uint32_t alignment) const noexcept
+        {
+            if (index == 0)
+                return 0;
+            if (index >= m_shares.size())
+                return height;
+
+            double prefix = 0.0;
+            for (uint32_t j = 0; j < index; ++j)
+            {
+                prefix += m_shares[j];
+            }
+
+            alignment = std::max(alignment, 1u);
+            const double rows = double(height) * prefix / double(alignment);
+            const auto boundary = static_cast<uint32_t>(std::llround(rows)) * alignment;
+            return std::min(boundary, height);
+        }
+
+        // Largest share of 'region' predicted to finish by 'ms', within [m_minShare, 1].
+        double ShareForTime(uint32_t region, double ms) const
+        {
+            if (m_model.Predict(region, 1.0) <= ms)
+                return 1.0;
+            if (m_model.Predict(region, m_minShare) >= ms)
+                return m_minShare;
+
+            double lo = m_minShare;
+            double hi = 1.0;
+            for (int j = 0; j < c_Iterations; ++j)
+            {
+                const double mid = (lo + hi) * 0.5;
+                if (m_model.Predict(region, mid) <= ms)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
+
+        // Finds the finish time whose shares sum to one.
+        void SolveEqualFinish(std::vector<double>& shares) const
+        {
+            const uint32_t count = GetRegionCount();
+            shares.resize(count);
+
+            double lo = 0.0;
+            double hi = 0.0;
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                hi = std::max(hi, m_model.Predict(j, 1.0));
+            }
+
+            for (int k = 0; k < c_Iterations; ++k)
+            {
+                const double mid = (lo + hi) * 0.5;
+                double total = 0.0;
+                for (uint32_t j = 0; j < count; ++j)
+                {
+                    total += ShareForTime(j, mid);
+                }
+
+                if (total < 1.0)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+
+            double total = 0.0;
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                shares[j] = ShareForTime(j, hi);
+                total += shares[j];
+            }
+
+            // Flat costs make the sum jump at their finish time; scale what is above the minimum to close the gap.
+            for (uint32_t j = 0; j < count; ++j)
+            {
+                shares[j] = m_minShare + (shares[j] - m_minShare) * (1.0 - m_minShare * count) / std::max(total - m_minShare * count, 1e-12);
+            }
+        }
+
+        TCostModel          m_model;
+        std::vector<double> m_shares;
+        std::vector<double> m_targets;
+        double              m_minShare;
+        double              m_maxStep;
+        double              m_deadband;
+        double              m_predictedMs;
+    };
+}